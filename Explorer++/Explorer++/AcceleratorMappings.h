@@ -36,6 +36,7 @@ const std::unordered_map<std::wstring, int> ACCELERATOR_MAPPINGS = {
 	{L"close_tab", IDM_FILE_CLOSETAB},
 	{L"clone_window", IDM_FILE_CLONEWINDOW},
 	{L"save_directory_listing", IDM_FILE_SAVEDIRECTORYLISTING},
+	{L"save_directory_listing_recursive", IDM_FILE_SAVEDIRECTORYLISTINGRECURSIVE},
 	{L"open_command_prompt", IDM_FILE_OPENCOMMANDPROMPT},
 	{L"open_command_prompt_as_administrator", IDM_FILE_OPENCOMMANDPROMPTADMINISTRATOR},
 	{L"copy_folder_path", IDM_FILE_COPYFOLDERPATH},
@@ -53,6 +53,45 @@ std::vector<NColorRuleHelper::ColorRule> NColorRuleHelper::GetDefaultColorRules(
 	return colorRules;
 }
 
+NColorRuleHelper::ColorRuleMatcher::ColorRuleMatcher(const std::vector<ColorRule> &colorRules)
+{
+	for (const auto &colorRule : colorRules)
+	{
+		CompiledColorRule compiledColorRule;
+
+		if (!colorRule.strFilterPattern.empty())
+		{
+			compiledColorRule.filenameMatcher.emplace(
+				colorRule.strFilterPattern, !colorRule.caseInsensitive);
+		}
+
+		compiledColorRule.attributes = colorRule.dwFilterAttributes;
+		compiledColorRule.color = colorRule.rgbColour;
+		m_colorRules.push_back(std::move(compiledColorRule));
+	}
+}
+
+std::optional<COLORREF> NColorRuleHelper::ColorRuleMatcher::GetColorForItem(
+	std::wstring_view fileName, DWORD attributes) const
+{
+	for (const auto &colorRule : m_colorRules)
+	{
+		if (colorRule.filenameMatcher && !colorRule.filenameMatcher->Match(fileName))
+		{
+			continue;
+		}
+
+		if (colorRule.attributes != 0 && (colorRule.attributes & attributes) == 0)
+		{
+			continue;
+		}
+
+		return colorRule.color;
+	}
+
+	return std::nullopt;
+}
+
 void NColorRuleHelper::LoadColorRulesFromRegistry(
 	std::vector<NColorRuleHelper::ColorRule> &ColorRules)
 {
@@ -4,8 +4,11 @@
 
 #pragma once
 
+#include "../Helper/WildcardMatcher.h"
 #include <MsXml2.h>
 #include <objbase.h>
+#include <optional>
+#include <string_view>
 
 namespace NColorRuleHelper
 {
@@ -21,6 +24,30 @@ namespace NColorRuleHelper
 		COLORREF rgbColour;
 	};
 
+	/* Holds a set of color rules in a form that can be
+	evaluated efficiently against a large number of items. */
+	class ColorRuleMatcher
+	{
+	public:
+		ColorRuleMatcher() = default;
+		explicit ColorRuleMatcher(const std::vector<ColorRule> &colorRules);
+
+		/* Returns the color of the first rule that matches
+		the item, if any. */
+		std::optional<COLORREF> GetColorForItem(std::wstring_view fileName, DWORD attributes) const;
+
+	private:
+		struct CompiledColorRule
+		{
+			/* Empty if the rule doesn't filter by filename. */
+			std::optional<WildcardMatcher> filenameMatcher;
+			DWORD attributes;
+			COLORREF color;
+		};
+
+		std::vector<CompiledColorRule> m_colorRules;
+	};
+
 	std::vector<ColorRule> GetDefaultColorRules();
 
 	void LoadColorRulesFromRegistry(std::vector<ColorRule> &ColorRules);
@@ -86,6 +86,8 @@ struct Config
 		forceSameTabWidth.set(FALSE);
 		openTabsInForeground = false;
 
+		useNativeCopyEngine = false;
+
 		displayWindowSurroundColor = Gdiplus::Color(0, 94, 138);
 		displayWindowCentreColor = Gdiplus::Color(255, 255, 255);
 		displayWindowTextColor = RGB(0, 0, 0);
@@ -195,6 +197,9 @@ struct Config
 	ValueWrapper<BOOL> forceSameTabWidth;
 	bool openTabsInForeground;
 
+	// File operations
+	bool useNativeCopyEngine;
+
 	// Display window
 	Gdiplus::Color displayWindowCentreColor;
 	Gdiplus::Color displayWindowSurroundColor;
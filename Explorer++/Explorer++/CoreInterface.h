@@ -34,9 +34,12 @@ using ToolbarContextMenuSignal =
 	boost::signals2::signal<void(HMENU menu, HWND sourceWindow, const POINT &pt)>;
 using FocusChangedSignal = boost::signals2::signal<void(WindowFocusSource windowFocusSource)>;
 using ApplicationShuttingDownSignal = boost::signals2::signal<void()>;
+using ColorRulesUpdatedSignal = boost::signals2::signal<void()>;
 
 class CachedIcons;
 struct Config;
+class FileOperationQueue;
+class FolderSizeService;
 class IconResourceLoader;
 __interface IDirectoryMonitor;
 class ShellBrowser;
@@ -44,6 +47,11 @@ class StatusBar;
 class TabContainer;
 class TabRestorer;
 
+namespace NColorRuleHelper
+{
+	class ColorRuleMatcher;
+}
+
 /* Basic interface between Explorerplusplus
 and some of the other components (such as the
 dialogs and toolbars). */
@@ -63,6 +71,12 @@ __interface IExplorerplusplus
 
 	IconResourceLoader *GetIconResourceLoader() const;
 	CachedIcons *GetCachedIcons();
+	FolderSizeService *GetFolderSizeService();
+	FileOperationQueue *GetFileOperationQueue();
+
+	// The returned object remains valid for the lifetime of the application. It's updated in place
+	// whenever the color rules change, after which the observers below are notified.
+	const NColorRuleHelper::ColorRuleMatcher *GetColorRuleMatcher() const;
 
 	HWND GetTreeView() const;
 
@@ -109,4 +123,6 @@ __interface IExplorerplusplus
 		const FocusChangedSignal::slot_type &observer);
 	boost::signals2::connection AddApplicationShuttingDownObserver(
 		const ApplicationShuttingDownSignal::slot_type &observer);
+	boost::signals2::connection AddColorRulesUpdatedObserver(
+		const ColorRulesUpdatedSignal::slot_type &observer);
 };
\ No newline at end of file
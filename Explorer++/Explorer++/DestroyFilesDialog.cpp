@@ -28,6 +28,17 @@ DestroyFilesDialog::DestroyFilesDialog(HINSTANCE hInstance, HWND hParent,
 	m_pdfdps = &DestroyFilesDialogPersistentSettings::GetInstance();
 }
 
+DestroyFilesDialog::~DestroyFilesDialog()
+{
+	// The destroyer checks whether it's been stopped between each block it writes, so this won't
+	// block for long.
+	if (m_thread.joinable())
+	{
+		m_fileDestroyer->Stop();
+		m_thread.join();
+	}
+}
+
 INT_PTR DestroyFilesDialog::OnInitDialog()
 {
 	m_icon.reset(LoadIcon(GetModuleHandle(nullptr), MAKEINTRESOURCE(IDI_MAIN)));
@@ -174,6 +185,16 @@ void DestroyFilesDialog::GetResizableControlInformation(
 	control.Constraint = ResizableDialog::ControlConstraint::X;
 	ControlList.push_back(control);
 
+	control.iID = IDC_DESTROYFILES_PROGRESS;
+	control.Type = ResizableDialog::ControlType::Move;
+	control.Constraint = ResizableDialog::ControlConstraint::Y;
+	ControlList.push_back(control);
+
+	control.iID = IDC_DESTROYFILES_PROGRESS;
+	control.Type = ResizableDialog::ControlType::Resize;
+	control.Constraint = ResizableDialog::ControlConstraint::X;
+	ControlList.push_back(control);
+
 	control.iID = IDOK;
 	control.Type = ResizableDialog::ControlType::Move;
 	control.Constraint = ResizableDialog::ControlConstraint::None;
@@ -217,7 +238,7 @@ INT_PTR DestroyFilesDialog::OnCommand(WPARAM wParam, LPARAM lParam)
 
 INT_PTR DestroyFilesDialog::OnClose()
 {
-	EndDialog(m_hDlg, 0);
+	OnCancel();
 	return 0;
 }
 
@@ -262,6 +283,13 @@ void DestroyFilesDialog::OnOk()
 
 void DestroyFilesDialog::OnCancel()
 {
+	if (m_thread.joinable())
+	{
+		// The thread will still post its finished message, which is where the dialog is closed.
+		m_fileDestroyer->Stop();
+		return;
+	}
+
 	EndDialog(m_hDlg, 0);
 }
 
@@ -278,15 +306,99 @@ void DestroyFilesDialog::OnConfirmDestroy()
 		overwriteMethod = NFileOperations::OverwriteMethod::ThreePass;
 	}
 
-	/* TODO: Perform in background thread. */
-	for (const auto &strFullFilename : m_FullFilenameList)
+	EnableWindow(GetDlgItem(m_hDlg, IDOK), FALSE);
+	EnableWindow(GetDlgItem(m_hDlg, IDC_DESTROYFILES_RADIO_ONEPASS), FALSE);
+	EnableWindow(GetDlgItem(m_hDlg, IDC_DESTROYFILES_RADIO_THREEPASS), FALSE);
+
+	HWND hProgressBar = GetDlgItem(m_hDlg, IDC_DESTROYFILES_PROGRESS);
+	SendMessage(hProgressBar, PBM_SETRANGE32, 0, PROGRESS_RANGE);
+	SendMessage(hProgressBar, PBM_SETPOS, 0, 0);
+	ShowWindow(hProgressBar, SW_SHOW);
+
+	m_fileDestroyer = std::make_unique<FileDestroyer>(
+		overwriteMethod, static_cast<int>(std::thread::hardware_concurrency()));
+
+	SetTimer(m_hDlg, PROGRESS_TIMER_ID, PROGRESS_TIMER_ELAPSED, nullptr);
+
+	m_thread = std::thread([this, fileDestroyer = m_fileDestroyer.get(),
+							   files = std::vector<std::wstring>(
+								   m_FullFilenameList.begin(), m_FullFilenameList.end()),
+							   hDlg = m_hDlg] {
+		m_threadResults = fileDestroyer->Destroy(files);
+		PostMessage(hDlg, WM_APP_DESTROY_FINISHED, 0, 0);
+	});
+}
+
+INT_PTR DestroyFilesDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+	UNREFERENCED_PARAMETER(wParam);
+	UNREFERENCED_PARAMETER(lParam);
+
+	switch (uMsg)
 	{
-		DeleteFileSecurely(strFullFilename, overwriteMethod);
+	case WM_APP_DESTROY_FINISHED:
+		OnFinished();
+		break;
+	}
+
+	return 0;
+}
+
+void DestroyFilesDialog::OnFinished()
+{
+	m_thread.join();
+
+	KillTimer(m_hDlg, PROGRESS_TIMER_ID);
+
+	bool stopped = m_fileDestroyer->IsStopped();
+	m_fileDestroyer.reset();
+
+	// If the operation was cancelled, the files that remain are expected, so there's nothing
+	// further to report.
+	if (!stopped && !m_threadResults.empty())
+	{
+		TCHAR szTemp[128];
+		LoadString(GetInstance(), IDS_DESTROY_FILES_FAILED, szTemp, SIZEOF_ARRAY(szTemp));
+
+		TCHAR szMessage[256];
+		StringCchPrintf(
+			szMessage, SIZEOF_ARRAY(szMessage), szTemp, static_cast<int>(m_threadResults.size()));
+		MessageBox(m_hDlg, szMessage, NExplorerplusplus::APP_NAME, MB_ICONWARNING | MB_OK);
 	}
 
 	EndDialog(m_hDlg, 1);
 }
 
+INT_PTR DestroyFilesDialog::OnTimer(int iTimerID)
+{
+	if (iTimerID != PROGRESS_TIMER_ID)
+	{
+		return 1;
+	}
+
+	// A timer message may already be queued when the operation finishes.
+	if (m_fileDestroyer)
+	{
+		UpdateProgress();
+	}
+
+	return 0;
+}
+
+void DestroyFilesDialog::UpdateProgress()
+{
+	auto progress = m_fileDestroyer->GetProgress();
+
+	int position = PROGRESS_RANGE;
+
+	if (progress.bytesToWrite != 0)
+	{
+		position = static_cast<int>(progress.bytesWritten * PROGRESS_RANGE / progress.bytesToWrite);
+	}
+
+	SendDlgItemMessage(m_hDlg, IDC_DESTROYFILES_PROGRESS, PBM_SETPOS, position, 0);
+}
+
 DestroyFilesDialogPersistentSettings::DestroyFilesDialogPersistentSettings() :
 	DialogSettings(SETTINGS_KEY)
 {
@@ -6,9 +6,13 @@
 
 #include "DarkModeDialogBase.h"
 #include "../Helper/DialogSettings.h"
+#include "../Helper/FileDestroyer.h"
 #include "../Helper/FileOperations.h"
 #include "../Helper/ResizableDialog.h"
 #include <wil/resource.h>
+#include <memory>
+#include <thread>
+#include <vector>
 
 class DestroyFilesDialog;
 
@@ -38,19 +42,35 @@ private:
 	NFileOperations::OverwriteMethod m_overwriteMethod;
 };
 
+// The files are destroyed on a background thread, with the dialog polling for progress. Closing
+// the dialog while that's happening stops the operation, leaving any files that haven't been fully
+// overwritten in place.
 class DestroyFilesDialog : public DarkModeDialogBase
 {
 public:
 	DestroyFilesDialog(HINSTANCE hInstance, HWND hParent,
 		const std::list<std::wstring> &FullFilenameList, BOOL bShowFriendlyDates);
+	~DestroyFilesDialog();
 
 protected:
 	INT_PTR OnInitDialog() override;
+	INT_PTR OnTimer(int iTimerID) override;
 	INT_PTR OnCtlColorStaticExtra(HWND hwnd, HDC hdc) override;
 	INT_PTR OnCommand(WPARAM wParam, LPARAM lParam) override;
 	INT_PTR OnClose() override;
 
+	INT_PTR OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam) override;
+
 private:
+	static const int WM_APP_DESTROY_FINISHED = WM_APP + 1;
+
+	static const int PROGRESS_TIMER_ID = 0;
+	static const int PROGRESS_TIMER_ELAPSED = 100;
+
+	// Progress is measured in bytes, which can easily exceed the (32-bit) range of the progress
+	// bar, so it's scaled to this range instead.
+	static const int PROGRESS_RANGE = 1000;
+
 	void GetResizableControlInformation(BaseDialog::DialogSizeConstraint &dsc,
 		std::list<ResizableDialog::Control> &ControlList) override;
 	void SaveState() override;
@@ -58,9 +78,17 @@ private:
 	void OnOk();
 	void OnCancel();
 	void OnConfirmDestroy();
+	void OnFinished();
+	void UpdateProgress();
 
 	std::list<std::wstring> m_FullFilenameList;
 
+	std::unique_ptr<FileDestroyer> m_fileDestroyer;
+	std::thread m_thread;
+
+	// Written by the background thread. Only read once the thread has been joined.
+	std::vector<std::wstring> m_threadResults;
+
 	wil::unique_hicon m_icon;
 
 	DestroyFilesDialogPersistentSettings *m_pdfdps;
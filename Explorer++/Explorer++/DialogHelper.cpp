@@ -10,6 +10,7 @@
 #include "CustomizeColorsDialog.h"
 #include "DestroyFilesDialog.h"
 #include "DisplayColoursDialog.h"
+#include "DuplicateFilesDialog.h"
 #include "FilterDialog.h"
 #include "MassRenameDialog.h"
 #include "MergeFilesDialog.h"
@@ -50,6 +51,7 @@ namespace
 		&AddBookmarkDialogPersistentSettings::GetInstance(),
 		&ManageBookmarksDialogPersistentSettings::GetInstance(),
 		&DisplayColoursDialogPersistentSettings::GetInstance(),
+		&DuplicateFilesDialogPersistentSettings::GetInstance(),
 		&UpdateCheckDialogPersistentSettings::GetInstance() };
 }
 
@@ -9,7 +9,6 @@
 #include "MainResource.h"
 #include "ShellBrowser/ShellBrowser.h"
 #include "TabContainer.h"
-#include "../Helper/FolderSize.h"
 #include "../Helper/ShellHelper.h"
 
 void Explorerplusplus::UpdateDisplayWindow(const Tab &tab)
@@ -122,54 +121,63 @@ void Explorerplusplus::UpdateDisplayWindowForOneFile(const Tab &tab)
 			if (((dwAttributes & FILE_ATTRIBUTE_DIRECTORY) == FILE_ATTRIBUTE_DIRECTORY)
 				&& m_config->globalFolderSettings.showFolderSizes)
 			{
-				FolderSize_t *pfs = nullptr;
-				FolderSizeExtraInfo *pfsei = nullptr;
-				DWFolderSize displayWindowFolderSize;
 				TCHAR szDisplayText[256];
 				TCHAR szTotalSize[64];
-				TCHAR szCalculating[64];
-				DWORD threadId;
 
-				pfs = (FolderSize_t *) malloc(sizeof(FolderSize_t));
-
-				if (pfs != nullptr)
+				LoadString(m_hLanguageModule, IDS_GENERAL_TOTALSIZE, szTotalSize,
+					SIZEOF_ARRAY(szTotalSize));
+
+				int uniqueId = m_iDWFolderSizeUniqueId;
+
+				auto folderInfo = m_folderSizeService.GetFolderInfo(fullItemName,
+					[hContainer = m_hContainer, uniqueId](const FolderInfo &folderInfo) {
+						auto *pDWFolderSizeCompletion = new DWFolderSizeCompletion();
+						pDWFolderSizeCompletion->liFolderSize.QuadPart = folderInfo.size;
+						pDWFolderSizeCompletion->uId = uniqueId;
+
+						/* Queue the result back to the main thread, so that
+						the folder size can be displayed. It is up to the main
+						thread to determine whether the folder size should actually
+						be shown. */
+						if (!PostMessage(hContainer, WM_APP_FOLDERSIZECOMPLETED,
+								reinterpret_cast<WPARAM>(pDWFolderSizeCompletion), 0))
+						{
+							delete pDWFolderSizeCompletion;
+						}
+					});
+
+				if (folderInfo)
 				{
-					pfsei = (FolderSizeExtraInfo *) malloc(sizeof(FolderSizeExtraInfo));
-
-					if (pfsei != nullptr)
-					{
-						pfsei->pContainer = (void *) this;
-						pfsei->uId = m_iDWFolderSizeUniqueId;
-						pfs->pData = (LPVOID) pfsei;
-
-						pfs->pfnCallback = FolderSizeCallbackStub;
-
-						StringCchCopy(pfs->szPath, SIZEOF_ARRAY(pfs->szPath), fullItemName.c_str());
-
-						LoadString(m_hLanguageModule, IDS_GENERAL_TOTALSIZE, szTotalSize,
-							SIZEOF_ARRAY(szTotalSize));
-						LoadString(m_hLanguageModule, IDS_GENERAL_CALCULATING, szCalculating,
-							SIZEOF_ARRAY(szCalculating));
-						StringCchPrintf(szDisplayText, SIZEOF_ARRAY(szDisplayText), _T("%s: %s"),
-							szTotalSize, szCalculating);
-						DisplayWindow_BufferText(m_hDisplayWindow, szDisplayText);
-
-						/* Maintain a global list of folder size operations. */
-						displayWindowFolderSize.uId = m_iDWFolderSizeUniqueId;
-						displayWindowFolderSize.iTabId = m_tabContainer->GetSelectedTab().GetId();
-						displayWindowFolderSize.bValid = TRUE;
-						m_DWFolderSizes.push_back(displayWindowFolderSize);
-
-						HANDLE hThread = CreateThread(
-							nullptr, 0, Thread_CalculateFolderSize, (LPVOID) pfs, 0, &threadId);
-						CloseHandle(hThread);
-
-						m_iDWFolderSizeUniqueId++;
-					}
-					else
-					{
-						free(pfs);
-					}
+					// The size was calculated previously and nothing within the folder has
+					// changed since, so it can be shown straight away.
+					TCHAR szFolderSize[32];
+					ULARGE_INTEGER folderSize;
+					folderSize.QuadPart = folderInfo->size;
+					FormatSizeString(folderSize, szFolderSize, SIZEOF_ARRAY(szFolderSize),
+						m_config->globalFolderSettings.forceSize,
+						m_config->globalFolderSettings.sizeDisplayFormat);
+
+					StringCchPrintf(szDisplayText, SIZEOF_ARRAY(szDisplayText), _T("%s: %s"),
+						szTotalSize, szFolderSize);
+					DisplayWindow_BufferText(m_hDisplayWindow, szDisplayText);
+				}
+				else
+				{
+					TCHAR szCalculating[64];
+					LoadString(m_hLanguageModule, IDS_GENERAL_CALCULATING, szCalculating,
+						SIZEOF_ARRAY(szCalculating));
+					StringCchPrintf(szDisplayText, SIZEOF_ARRAY(szDisplayText), _T("%s: %s"),
+						szTotalSize, szCalculating);
+					DisplayWindow_BufferText(m_hDisplayWindow, szDisplayText);
+
+					/* Maintain a global list of folder size operations. */
+					DWFolderSize displayWindowFolderSize;
+					displayWindowFolderSize.uId = uniqueId;
+					displayWindowFolderSize.iTabId = m_tabContainer->GetSelectedTab().GetId();
+					displayWindowFolderSize.bValid = TRUE;
+					m_DWFolderSizes.push_back(displayWindowFolderSize);
+
+					m_iDWFolderSizeUniqueId++;
 				}
 			}
 			else
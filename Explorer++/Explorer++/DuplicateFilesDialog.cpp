@@ -0,0 +1,460 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "DuplicateFilesDialog.h"
+#include "CoreInterface.h"
+#include "MainResource.h"
+#include "../Helper/Controls.h"
+#include "../Helper/Macros.h"
+#include "../Helper/ParallelDirectoryWalker.h"
+#include "../Helper/RegistrySettings.h"
+#include "../Helper/StringHelper.h"
+#include "../Helper/WindowHelper.h"
+#include "../Helper/XMLSettings.h"
+#include <wil/common.h>
+
+const TCHAR DuplicateFilesDialogPersistentSettings::SETTINGS_KEY[] = _T("DuplicateFiles");
+
+const TCHAR DuplicateFilesDialogPersistentSettings::SETTING_SEARCH_SUB_FOLDERS[] =
+	_T("SearchSubFolders");
+
+DuplicateFilesDialog::DuplicateFilesDialog(
+	HINSTANCE hInstance, HWND hParent, IExplorerplusplus *pexpp, std::wstring_view directory) :
+	DarkModeDialogBase(hInstance, IDD_DUPLICATEFILES, hParent, true),
+	m_pexpp(pexpp),
+	m_directory(directory)
+{
+	m_persistentSettings = &DuplicateFilesDialogPersistentSettings::GetInstance();
+}
+
+DuplicateFilesDialog::~DuplicateFilesDialog()
+{
+	// The dialog may be closed while a search is still running. The finder checks whether it's
+	// been stopped between each read, so this won't block for long.
+	if (m_thread.joinable())
+	{
+		m_finder->Stop();
+		m_thread.join();
+	}
+}
+
+INT_PTR DuplicateFilesDialog::OnInitDialog()
+{
+	HWND hListView = GetDlgItem(m_hDlg, IDC_DUPLICATES_LISTVIEW);
+
+	ListView_SetExtendedListViewStyleEx(hListView,
+		LVS_EX_GRIDLINES | LVS_EX_DOUBLEBUFFER | LVS_EX_FULLROWSELECT,
+		LVS_EX_GRIDLINES | LVS_EX_DOUBLEBUFFER | LVS_EX_FULLROWSELECT);
+
+	HIMAGELIST himlSmall;
+	Shell_GetImageLists(nullptr, &himlSmall);
+	ListView_SetImageList(hListView, himlSmall, LVSIL_SMALL);
+
+	SetWindowTheme(hListView, L"Explorer", nullptr);
+
+	const UINT columnStringIds[] = { IDS_DUPLICATES_COLUMN_NAME, IDS_DUPLICATES_COLUMN_FOLDER,
+		IDS_DUPLICATES_COLUMN_SIZE, IDS_DUPLICATES_COLUMN_SET };
+	const double columnWidths[] = { 0.3, 0.45, 0.15, 0.1 };
+
+	RECT rc;
+	GetClientRect(hListView, &rc);
+
+	for (size_t i = 0; i < SIZEOF_ARRAY(columnStringIds); i++)
+	{
+		TCHAR szTemp[128];
+		LoadString(GetInstance(), columnStringIds[i], szTemp, SIZEOF_ARRAY(szTemp));
+
+		LVCOLUMN lvColumn;
+		lvColumn.mask = LVCF_TEXT;
+		lvColumn.pszText = szTemp;
+		ListView_InsertColumn(hListView, static_cast<int>(i), &lvColumn);
+
+		ListView_SetColumnWidth(hListView, static_cast<int>(i),
+			static_cast<int>(columnWidths[i] * GetRectWidth(&rc)));
+	}
+
+	SetDlgItemText(m_hDlg, IDC_DUPLICATES_EDIT_DIRECTORY, m_directory.c_str());
+	lCheckDlgButton(
+		m_hDlg, IDC_DUPLICATES_CHECK_SUBFOLDERS, m_persistentSettings->m_bSearchSubFolders);
+
+	AllowDarkModeForControls({ IDC_DUPLICATES_BUTTON_FIND, IDCANCEL });
+	AllowDarkModeForListView(IDC_DUPLICATES_LISTVIEW);
+	AllowDarkModeForCheckboxes({ IDC_DUPLICATES_CHECK_SUBFOLDERS });
+
+	m_persistentSettings->RestoreDialogPosition(m_hDlg, true);
+
+	return 0;
+}
+
+void DuplicateFilesDialog::GetResizableControlInformation(
+	BaseDialog::DialogSizeConstraint &dsc, std::list<ResizableDialog::Control> &ControlList)
+{
+	dsc = BaseDialog::DialogSizeConstraint::None;
+
+	ResizableDialog::Control control;
+
+	control.iID = IDC_DUPLICATES_EDIT_DIRECTORY;
+	control.Type = ResizableDialog::ControlType::Resize;
+	control.Constraint = ResizableDialog::ControlConstraint::X;
+	ControlList.push_back(control);
+
+	control.iID = IDC_DUPLICATES_LISTVIEW;
+	control.Type = ResizableDialog::ControlType::Resize;
+	control.Constraint = ResizableDialog::ControlConstraint::None;
+	ControlList.push_back(control);
+
+	control.iID = IDC_STATIC_STATUSLABEL;
+	control.Type = ResizableDialog::ControlType::Move;
+	control.Constraint = ResizableDialog::ControlConstraint::Y;
+	ControlList.push_back(control);
+
+	control.iID = IDC_DUPLICATES_STATIC_STATUS;
+	control.Type = ResizableDialog::ControlType::Move;
+	control.Constraint = ResizableDialog::ControlConstraint::Y;
+	ControlList.push_back(control);
+
+	control.iID = IDC_DUPLICATES_STATIC_STATUS;
+	control.Type = ResizableDialog::ControlType::Resize;
+	control.Constraint = ResizableDialog::ControlConstraint::X;
+	ControlList.push_back(control);
+
+	control.iID = IDC_STATIC_ETCHEDHORZ;
+	control.Type = ResizableDialog::ControlType::Move;
+	control.Constraint = ResizableDialog::ControlConstraint::Y;
+	ControlList.push_back(control);
+
+	control.iID = IDC_STATIC_ETCHEDHORZ;
+	control.Type = ResizableDialog::ControlType::Resize;
+	control.Constraint = ResizableDialog::ControlConstraint::X;
+	ControlList.push_back(control);
+
+	control.iID = IDC_DUPLICATES_BUTTON_FIND;
+	control.Type = ResizableDialog::ControlType::Move;
+	control.Constraint = ResizableDialog::ControlConstraint::None;
+	ControlList.push_back(control);
+
+	control.iID = IDCANCEL;
+	control.Type = ResizableDialog::ControlType::Move;
+	control.Constraint = ResizableDialog::ControlConstraint::None;
+	ControlList.push_back(control);
+}
+
+INT_PTR DuplicateFilesDialog::OnCommand(WPARAM wParam, LPARAM lParam)
+{
+	UNREFERENCED_PARAMETER(lParam);
+
+	switch (LOWORD(wParam))
+	{
+	case IDC_DUPLICATES_BUTTON_FIND:
+		OnFind();
+		break;
+
+	case IDCANCEL:
+		EndDialog(m_hDlg, 0);
+		break;
+	}
+
+	return 0;
+}
+
+void DuplicateFilesDialog::OnFind()
+{
+	if (!m_thread.joinable())
+	{
+		StartFinding();
+	}
+	else
+	{
+		StopFinding();
+	}
+}
+
+void DuplicateFilesDialog::StartFinding()
+{
+	TCHAR szDirectory[MAX_PATH];
+	GetDlgItemText(m_hDlg, IDC_DUPLICATES_EDIT_DIRECTORY, szDirectory, SIZEOF_ARRAY(szDirectory));
+	PathRemoveBlanks(szDirectory);
+
+	bool recursive = IsDlgButtonChecked(m_hDlg, IDC_DUPLICATES_CHECK_SUBFOLDERS) == BST_CHECKED;
+
+	m_duplicateSets.clear();
+	m_rows.clear();
+	ListView_SetItemCount(GetDlgItem(m_hDlg, IDC_DUPLICATES_LISTVIEW), 0);
+
+	GetDlgItemText(
+		m_hDlg, IDC_DUPLICATES_BUTTON_FIND, m_szFindButton, SIZEOF_ARRAY(m_szFindButton));
+
+	TCHAR szTemp[64];
+	LoadString(GetInstance(), IDS_STOP, szTemp, SIZEOF_ARRAY(szTemp));
+	SetDlgItemText(m_hDlg, IDC_DUPLICATES_BUTTON_FIND, szTemp);
+
+	m_finder =
+		std::make_unique<DuplicateFileFinder>(ParallelDirectoryWalker::GetDefaultNumWorkers());
+
+	SetTimer(m_hDlg, PROGRESS_TIMER_ID, PROGRESS_TIMER_ELAPSED, nullptr);
+
+	m_thread = std::thread([this, finder = m_finder.get(), directory = std::wstring(szDirectory),
+							   recursive, hDlg = m_hDlg] {
+		m_threadResults = finder->Find(directory, recursive);
+		PostMessage(hDlg, WM_APP_DUPLICATES_FINISHED, 0, 0);
+	});
+}
+
+void DuplicateFilesDialog::StopFinding()
+{
+	// The thread will still post its finished message, which is where the search is cleaned up.
+	m_finder->Stop();
+}
+
+INT_PTR DuplicateFilesDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+	UNREFERENCED_PARAMETER(wParam);
+	UNREFERENCED_PARAMETER(lParam);
+
+	switch (uMsg)
+	{
+	case WM_APP_DUPLICATES_FINISHED:
+		OnFinished();
+		break;
+	}
+
+	return 0;
+}
+
+void DuplicateFilesDialog::OnFinished()
+{
+	m_thread.join();
+
+	KillTimer(m_hDlg, PROGRESS_TIMER_ID);
+
+	bool stopped = m_finder->IsStopped();
+	m_finder.reset();
+
+	SetDlgItemText(m_hDlg, IDC_DUPLICATES_BUTTON_FIND, m_szFindButton);
+
+	if (stopped)
+	{
+		TCHAR szTemp[128];
+		LoadString(GetInstance(), IDS_DUPLICATES_CANCELLED, szTemp, SIZEOF_ARRAY(szTemp));
+		SetDlgItemText(m_hDlg, IDC_DUPLICATES_STATIC_STATUS, szTemp);
+		return;
+	}
+
+	m_duplicateSets = std::move(m_threadResults);
+
+	ULONGLONG wastedSpace = 0;
+
+	for (size_t i = 0; i < m_duplicateSets.size(); i++)
+	{
+		const auto &duplicateSet = m_duplicateSets[i];
+		wastedSpace += duplicateSet.size * (duplicateSet.paths.size() - 1);
+
+		for (size_t j = 0; j < duplicateSet.paths.size(); j++)
+		{
+			m_rows.push_back({ static_cast<int>(i), static_cast<int>(j) });
+		}
+	}
+
+	ListView_SetItemCount(
+		GetDlgItem(m_hDlg, IDC_DUPLICATES_LISTVIEW), static_cast<int>(m_rows.size()));
+
+	TCHAR szWastedSpace[32];
+	ULARGE_INTEGER wastedSpaceLarge;
+	wastedSpaceLarge.QuadPart = wastedSpace;
+	FormatSizeString(wastedSpaceLarge, szWastedSpace, SIZEOF_ARRAY(szWastedSpace));
+
+	TCHAR szTemp[128];
+	LoadString(GetInstance(), IDS_DUPLICATES_FINISHED, szTemp, SIZEOF_ARRAY(szTemp));
+
+	TCHAR szStatus[256];
+	StringCchPrintf(szStatus, SIZEOF_ARRAY(szStatus), szTemp,
+		static_cast<int>(m_duplicateSets.size()), szWastedSpace);
+	SetDlgItemText(m_hDlg, IDC_DUPLICATES_STATIC_STATUS, szStatus);
+}
+
+INT_PTR DuplicateFilesDialog::OnTimer(int iTimerID)
+{
+	if (iTimerID != PROGRESS_TIMER_ID)
+	{
+		return 1;
+	}
+
+	// A timer message may already be queued when the search finishes.
+	if (m_finder)
+	{
+		UpdateStatus();
+	}
+
+	return 0;
+}
+
+void DuplicateFilesDialog::UpdateStatus()
+{
+	auto progress = m_finder->GetProgress();
+
+	TCHAR szTemp[128];
+	TCHAR szStatus[256];
+
+	switch (progress.stage)
+	{
+	case DuplicateFileFinder::Stage::Scanning:
+		LoadString(GetInstance(), IDS_DUPLICATES_SCANNING, szTemp, SIZEOF_ARRAY(szTemp));
+		StringCchPrintf(szStatus, SIZEOF_ARRAY(szStatus), szTemp, progress.filesFound);
+		break;
+
+	case DuplicateFileFinder::Stage::ComparingPartialContents:
+	case DuplicateFileFinder::Stage::ComparingFullContents:
+		LoadString(GetInstance(), IDS_DUPLICATES_COMPARING, szTemp, SIZEOF_ARRAY(szTemp));
+		StringCchPrintf(szStatus, SIZEOF_ARRAY(szStatus), szTemp, progress.filesCompared,
+			progress.filesToCompare);
+		break;
+
+	default:
+		return;
+	}
+
+	SetDlgItemText(m_hDlg, IDC_DUPLICATES_STATIC_STATUS, szStatus);
+}
+
+INT_PTR DuplicateFilesDialog::OnNotify(NMHDR *pnmhdr)
+{
+	if (pnmhdr->hwndFrom != GetDlgItem(m_hDlg, IDC_DUPLICATES_LISTVIEW))
+	{
+		return 0;
+	}
+
+	switch (pnmhdr->code)
+	{
+	case LVN_GETDISPINFO:
+		OnGetDispInfo(reinterpret_cast<NMLVDISPINFO *>(pnmhdr));
+		break;
+
+	case NM_DBLCLK:
+	{
+		int item = ListView_GetNextItem(pnmhdr->hwndFrom, -1, LVNI_ALL | LVNI_SELECTED);
+
+		if (item != -1)
+		{
+			const auto &row = m_rows[item];
+			m_pexpp->OpenItem(m_duplicateSets[row.setIndex].paths[row.pathIndex].c_str());
+		}
+	}
+	break;
+	}
+
+	return 0;
+}
+
+void DuplicateFilesDialog::OnGetDispInfo(NMLVDISPINFO *dispInfo)
+{
+	auto &row = m_rows[dispInfo->item.iItem];
+	const auto &duplicateSet = m_duplicateSets[row.setIndex];
+	const auto &path = duplicateSet.paths[row.pathIndex];
+
+	if (WI_IsFlagSet(dispInfo->item.mask, LVIF_TEXT))
+	{
+		const TCHAR *fileName = PathFindFileName(path.c_str());
+		std::wstring text;
+
+		switch (dispInfo->item.iSubItem)
+		{
+		case 0:
+			text = fileName;
+			break;
+
+		case 1:
+		{
+			TCHAR szFolder[MAX_PATH];
+			StringCchCopy(szFolder, SIZEOF_ARRAY(szFolder), path.c_str());
+			PathRemoveFileSpec(szFolder);
+			text = szFolder;
+		}
+		break;
+
+		case 2:
+		{
+			TCHAR szSize[32];
+			ULARGE_INTEGER size;
+			size.QuadPart = duplicateSet.size;
+			FormatSizeString(size, szSize, SIZEOF_ARRAY(szSize));
+			text = szSize;
+		}
+		break;
+
+		case 3:
+			text = std::to_wstring(row.setIndex + 1);
+			break;
+		}
+
+		StringCchCopy(dispInfo->item.pszText, dispInfo->item.cchTextMax, text.c_str());
+	}
+
+	if (WI_IsFlagSet(dispInfo->item.mask, LVIF_IMAGE))
+	{
+		if (row.iconIndex == -1)
+		{
+			SHFILEINFO shfi;
+			DWORD_PTR res =
+				SHGetFileInfo(path.c_str(), 0, &shfi, sizeof(shfi), SHGFI_SYSICONINDEX);
+			row.iconIndex = res ? shfi.iIcon : 0;
+		}
+
+		dispInfo->item.iImage = row.iconIndex;
+	}
+}
+
+INT_PTR DuplicateFilesDialog::OnClose()
+{
+	EndDialog(m_hDlg, 0);
+	return 0;
+}
+
+void DuplicateFilesDialog::SaveState()
+{
+	m_persistentSettings->SaveDialogPosition(m_hDlg);
+
+	m_persistentSettings->m_bSearchSubFolders =
+		IsDlgButtonChecked(m_hDlg, IDC_DUPLICATES_CHECK_SUBFOLDERS) == BST_CHECKED;
+
+	m_persistentSettings->m_bStateSaved = TRUE;
+}
+
+DuplicateFilesDialogPersistentSettings::DuplicateFilesDialogPersistentSettings() :
+	DialogSettings(SETTINGS_KEY)
+{
+	m_bSearchSubFolders = TRUE;
+}
+
+DuplicateFilesDialogPersistentSettings &DuplicateFilesDialogPersistentSettings::GetInstance()
+{
+	static DuplicateFilesDialogPersistentSettings dfdps;
+	return dfdps;
+}
+
+void DuplicateFilesDialogPersistentSettings::SaveExtraRegistrySettings(HKEY hKey)
+{
+	RegistrySettings::SaveDword(hKey, SETTING_SEARCH_SUB_FOLDERS, m_bSearchSubFolders);
+}
+
+void DuplicateFilesDialogPersistentSettings::LoadExtraRegistrySettings(HKEY hKey)
+{
+	RegistrySettings::ReadDword(
+		hKey, SETTING_SEARCH_SUB_FOLDERS, reinterpret_cast<LPDWORD>(&m_bSearchSubFolders));
+}
+
+void DuplicateFilesDialogPersistentSettings::SaveExtraXMLSettings(
+	IXMLDOMDocument *pXMLDom, IXMLDOMElement *pParentNode)
+{
+	NXMLSettings::AddAttributeToNode(pXMLDom, pParentNode, SETTING_SEARCH_SUB_FOLDERS,
+		NXMLSettings::EncodeBoolValue(m_bSearchSubFolders));
+}
+
+void DuplicateFilesDialogPersistentSettings::LoadExtraXMLSettings(BSTR bstrName, BSTR bstrValue)
+{
+	if (lstrcmpi(bstrName, SETTING_SEARCH_SUB_FOLDERS) == 0)
+	{
+		m_bSearchSubFolders = NXMLSettings::DecodeBoolValue(bstrValue);
+	}
+}
@@ -0,0 +1,104 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "DarkModeDialogBase.h"
+#include "../Helper/DialogSettings.h"
+#include "../Helper/DuplicateFileFinder.h"
+#include "../Helper/Macros.h"
+#include "../Helper/ResizableDialog.h"
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+__interface IExplorerplusplus;
+class DuplicateFilesDialog;
+
+class DuplicateFilesDialogPersistentSettings : public DialogSettings
+{
+public:
+	static DuplicateFilesDialogPersistentSettings &GetInstance();
+
+private:
+	friend DuplicateFilesDialog;
+
+	static const TCHAR SETTINGS_KEY[];
+
+	static const TCHAR SETTING_SEARCH_SUB_FOLDERS[];
+
+	DuplicateFilesDialogPersistentSettings();
+
+	DISALLOW_COPY_AND_ASSIGN(DuplicateFilesDialogPersistentSettings);
+
+	void SaveExtraRegistrySettings(HKEY hKey) override;
+	void LoadExtraRegistrySettings(HKEY hKey) override;
+
+	void SaveExtraXMLSettings(IXMLDOMDocument *pXMLDom, IXMLDOMElement *pParentNode) override;
+	void LoadExtraXMLSettings(BSTR bstrName, BSTR bstrValue) override;
+
+	BOOL m_bSearchSubFolders;
+};
+
+// Lists the sets of files within a directory that have identical contents. The comparison runs on
+// a background thread, with the dialog polling it for progress.
+class DuplicateFilesDialog : public DarkModeDialogBase
+{
+public:
+	DuplicateFilesDialog(HINSTANCE hInstance, HWND hParent, IExplorerplusplus *pexpp,
+		std::wstring_view directory);
+	~DuplicateFilesDialog();
+
+protected:
+	INT_PTR OnInitDialog() override;
+	INT_PTR OnTimer(int iTimerID) override;
+	INT_PTR OnCommand(WPARAM wParam, LPARAM lParam) override;
+	INT_PTR OnNotify(NMHDR *pnmhdr) override;
+	INT_PTR OnClose() override;
+
+	INT_PTR OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam) override;
+
+private:
+	static const int WM_APP_DUPLICATES_FINISHED = WM_APP + 1;
+
+	static const int PROGRESS_TIMER_ID = 0;
+	static const int PROGRESS_TIMER_ELAPSED = 100;
+
+	// Each row in the listview is a single file. The listview is virtual, so the rows simply
+	// refer back to the sets returned by the finder.
+	struct Row
+	{
+		int setIndex;
+		int pathIndex;
+		int iconIndex = -1;
+	};
+
+	void GetResizableControlInformation(BaseDialog::DialogSizeConstraint &dsc,
+		std::list<ResizableDialog::Control> &ControlList) override;
+	void SaveState() override;
+
+	void OnFind();
+	void StartFinding();
+	void StopFinding();
+	void OnFinished();
+	void UpdateStatus();
+	void OnGetDispInfo(NMLVDISPINFO *dispInfo);
+
+	IExplorerplusplus *m_pexpp;
+	std::wstring m_directory;
+
+	std::unique_ptr<DuplicateFileFinder> m_finder;
+	std::thread m_thread;
+
+	// Written by the background thread. Only read once the thread has been joined.
+	std::vector<DuplicateFileFinder::DuplicateSet> m_threadResults;
+
+	std::vector<DuplicateFileFinder::DuplicateSet> m_duplicateSets;
+	std::vector<Row> m_rows;
+
+	TCHAR m_szFindButton[32];
+
+	DuplicateFilesDialogPersistentSettings *m_persistentSettings;
+};
@@ -37,7 +37,8 @@ Explorerplusplus::Explorerplusplus(HWND hwnd) :
 	m_acceleratorUpdater(&g_hAccl),
 	m_pluginCommandManager(&g_hAccl, ACCELERATOR_PLUGIN_STARTID, ACCELERATOR_PLUGIN_ENDID),
 	m_bookmarkIconFetcher(hwnd, &m_cachedIcons),
-	m_tabBarBackgroundBrush(CreateSolidBrush(TAB_BAR_DARK_MODE_BACKGROUND_COLOR))
+	m_tabBarBackgroundBrush(CreateSolidBrush(TAB_BAR_DARK_MODE_BACKGROUND_COLOR)),
+	m_directoryListingThreadPool(1)
 {
 	m_hLanguageModule = nullptr;
 
@@ -70,6 +71,7 @@ Explorerplusplus::Explorerplusplus(HWND hwnd) :
 	m_blockNextListViewSelection = false;
 
 	m_ColorRules = NColorRuleHelper::GetDefaultColorRules();
+	m_colorRuleMatcher = std::make_unique<NColorRuleHelper::ColorRuleMatcher>(m_ColorRules);
 
 	m_iDWFolderSizeUniqueId = 0;
 }
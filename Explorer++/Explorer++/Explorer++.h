@@ -20,6 +20,8 @@
 #include "../Helper/DropHandler.h"
 #include "../Helper/FileActionHandler.h"
 #include "../Helper/FileContextMenuManager.h"
+#include "../Helper/FileOperationQueue.h"
+#include "../Helper/FolderSizeService.h"
 #include "../Helper/IconFetcher.h"
 #include <boost/signals2.hpp>
 #include <wil/resource.h>
@@ -28,6 +30,13 @@
 /* Sent when a folder size calculation has finished. */
 #define WM_APP_FOLDERSIZECOMPLETED WM_APP + 3
 
+/* Sent when a directory listing has been saved (or
+has failed to save). */
+#define WM_APP_DIRECTORYLISTINGSAVED WM_APP + 4
+
+/* Sent when a queued file operation has failed. */
+#define WM_APP_FILEOPERATIONFAILED WM_APP + 5
+
 /* Private definitions. */
 #define FROM_LISTVIEW 0
 #define FROM_TREEVIEW 1
@@ -60,6 +69,7 @@ class WindowSubclassWrapper;
 namespace NColorRuleHelper
 {
 	struct ColorRule;
+	class ColorRuleMatcher;
 }
 
 namespace Plugins
@@ -151,10 +161,10 @@ private:
 		BOOL bValid;
 	};
 
-	struct FolderSizeExtraInfo
+	struct DirectoryListingSaveResult
 	{
-		void *pContainer;
-		int uId;
+		std::wstring outputPath;
+		bool succeeded;
 	};
 
 	LRESULT CALLBACK WindowProcedure(HWND hwnd, UINT Msg, WPARAM wParam, LPARAM lParam);
@@ -189,7 +199,8 @@ private:
 	/* Main menu handlers. */
 	void OnNewTab();
 	bool OnCloseTab();
-	void OnSaveDirectoryListing() const;
+	void OnSaveDirectoryListing(bool recursive);
+	void OnDirectoryListingSaved(const DirectoryListingSaveResult &result);
 	void OnCloneWindow();
 	void OnCopyItemPath() const;
 	void OnCopyUniversalPaths() const;
@@ -216,7 +227,9 @@ private:
 	void OnSplitFile();
 	void OnDestroyFiles();
 	void OnSearch();
+	void OnFindDuplicateFiles();
 	void OnCustomizeColors();
+	void OnColorRulesUpdated();
 	void OnRunScript();
 	void OnShowOptions();
 	void OnShowHelp();
@@ -406,6 +419,7 @@ private:
 
 	/* File operations. */
 	void CopyToFolder(bool move);
+	void OnFileOperationFailed(HRESULT result);
 	void OpenAllSelectedItems(
 		OpenFolderDisposition openFolderDisposition = OpenFolderDisposition::CurrentTab);
 	void OpenListViewItem(
@@ -469,6 +483,9 @@ private:
 	IDirectoryMonitor *GetDirectoryMonitor() const override;
 	IconResourceLoader *GetIconResourceLoader() const override;
 	CachedIcons *GetCachedIcons() override;
+	FolderSizeService *GetFolderSizeService() override;
+	FileOperationQueue *GetFileOperationQueue() override;
+	const NColorRuleHelper::ColorRuleMatcher *GetColorRuleMatcher() const override;
 	BOOL GetSavePreferencesToXmlFile() const override;
 	void SetSavePreferencesToXmlFile(BOOL savePreferencesToXmlFile) override;
 	void FocusChanged(WindowFocusSource windowFocusSource) override;
@@ -476,6 +493,8 @@ private:
 		const FocusChangedSignal::slot_type &observer) override;
 	boost::signals2::connection AddApplicationShuttingDownObserver(
 		const ApplicationShuttingDownSignal::slot_type &observer) override;
+	boost::signals2::connection AddColorRulesUpdatedObserver(
+		const ColorRulesUpdatedSignal::slot_type &observer) override;
 
 	/* Menus. */
 	void InitializeMainMenu();
@@ -502,11 +521,6 @@ private:
 	void HandleDirectoryMonitoring(int iTabId);
 	int DetermineListViewObjectIndex(HWND hListView);
 
-	static void FolderSizeCallbackStub(
-		int nFolders, int nFiles, PULARGE_INTEGER lTotalFolderSize, LPVOID pData);
-	void FolderSizeCallback(
-		FolderSizeExtraInfo *pfsei, int nFolders, int nFiles, PULARGE_INTEGER lTotalFolderSize);
-
 	HWND m_hContainer;
 	HWND m_hStatusBar;
 	HWND m_hMainRebar;
@@ -607,6 +621,8 @@ private:
 
 	/* Customize colors. */
 	std::vector<NColorRuleHelper::ColorRule> m_ColorRules;
+	std::unique_ptr<NColorRuleHelper::ColorRuleMatcher> m_colorRuleMatcher;
+	ColorRulesUpdatedSignal m_colorRulesUpdatedSignal;
 
 	/* Undo support. */
 	FileActionHandler m_FileActionHandler;
@@ -618,9 +634,17 @@ private:
 	ApplicationToolbar *m_pApplicationToolbar;
 
 	/* Display window folder sizes. */
+	FolderSizeService m_folderSizeService;
 	std::list<DWFolderSize> m_DWFolderSizes;
 	int m_iDWFolderSizeUniqueId;
 
+	/* Background copies and moves. */
+	FileOperationQueue m_fileOperationQueue;
+
+	/* Directory listings are saved in the background,
+	one at a time. */
+	ctpl::thread_pool m_directoryListingThreadPool;
+
 	/* Drag and drop. */
 	bool m_bDragging;
 	bool m_bDragCancelled;
@@ -0,0 +1,495 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "FilenameIndexManager.h"
+#include "../Helper/Macros.h"
+#include "../Helper/iDirectoryMonitor.h"
+#include <wil/resource.h>
+#include <algorithm>
+
+namespace
+{
+	const TCHAR INDEX_DIRECTORY[] = _T("Explorer++\\SearchIndex");
+	const TCHAR INDEX_FILE_EXTENSION[] = _T(".idx");
+
+	// Times are in FILETIME units (100 nanosecond intervals).
+	const ULONGLONG FILETIME_TICKS_PER_DAY = 24ULL * 60 * 60 * 10000000;
+
+	// A saved index that's older than this is rebuilt, rather than loaded.
+	const ULONGLONG MAX_INDEX_AGE = FILETIME_TICKS_PER_DAY;
+
+	// Since each index is rebuilt at least once a day while it's in use, a saved index that
+	// hasn't been written to in this long is no longer being used.
+	const ULONGLONG MAX_UNUSED_INDEX_AGE = 30 * FILETIME_TICKS_PER_DAY;
+
+	const size_t MAX_INDEX_FILES = 16;
+
+	// The entries found within the directory a worker is currently enumerating. They're added to
+	// the index in a single batch once the worker moves on.
+	struct WorkerEntries
+	{
+		std::wstring directory;
+		std::vector<FilenameIndex::Entry> entries;
+	};
+
+	ULONGLONG FileTimeToTicks(const FILETIME &fileTime)
+	{
+		return (static_cast<ULONGLONG>(fileTime.dwHighDateTime) << 32) | fileTime.dwLowDateTime;
+	}
+
+	ULONGLONG GetCurrentTicks()
+	{
+		FILETIME currentTime;
+		GetSystemTimeAsFileTime(&currentTime);
+		return FileTimeToTicks(currentTime);
+	}
+
+	DWORD GetVolumeSerialNumber(const std::wstring &path)
+	{
+		TCHAR volumePath[MAX_PATH];
+		DWORD serialNumber;
+
+		if (!GetVolumePathName(path.c_str(), volumePath, SIZEOF_ARRAY(volumePath))
+			|| !GetVolumeInformation(
+				volumePath, nullptr, 0, &serialNumber, nullptr, nullptr, nullptr, 0))
+		{
+			return 0;
+		}
+
+		return serialNumber;
+	}
+}
+
+FilenameIndexManager &FilenameIndexManager::GetInstance()
+{
+	static FilenameIndexManager filenameIndexManager;
+	return filenameIndexManager;
+}
+
+std::shared_ptr<FilenameIndex> FilenameIndexManager::GetIndex(const std::wstring &rootDirectory,
+	IDirectoryMonitor *directoryMonitor, ParallelDirectoryWalker &walker,
+	ParallelDirectoryWalker::DirectoryCallback directoryCallback)
+{
+	auto indexKey = GetIndexKey(rootDirectory);
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		auto itr = m_indexes.find(indexKey);
+
+		if (itr != m_indexes.end())
+		{
+			auto &existingIndexInfo = *itr->second;
+			lock.unlock();
+
+			if (existingIndexInfo.rebuildRequested.exchange(false))
+			{
+				return RebuildIndex(existingIndexInfo, walker, directoryCallback);
+			}
+
+			return std::atomic_load(&existingIndexInfo.index);
+		}
+	}
+
+	auto indexInfo = std::make_unique<IndexInfo>();
+	indexInfo->filePath = GetIndexFilePath(indexKey);
+
+	if (!indexInfo->filePath.empty())
+	{
+		std::call_once(m_cleanUpFlag, CleanUpIndexFiles, indexInfo->filePath);
+
+		indexInfo->index = FilenameIndex::Load(indexInfo->filePath);
+	}
+
+	// The file name is derived from a hash of the directory, so it's possible (if unlikely) for
+	// the file to belong to a different directory. A saved index that's out of date is rebuilt.
+	if (indexInfo->index
+		&& (GetIndexKey(indexInfo->index->GetRootDirectory()) != indexKey
+			|| !IsIndexCurrent(*indexInfo->index)))
+	{
+		indexInfo->index.reset();
+	}
+
+	if (!indexInfo->index)
+	{
+		indexInfo->index = std::make_shared<FilenameIndex>(rootDirectory);
+
+		if (!BuildIndex(*indexInfo->index, walker, directoryCallback))
+		{
+			return nullptr;
+		}
+
+		SaveBuiltIndex(*indexInfo);
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// Another search may have loaded or built the same index in the meantime, in which case
+	// that index is the one that's being kept up to date.
+	auto [itr, inserted] = m_indexes.emplace(indexKey, std::move(indexInfo));
+
+	if (inserted)
+	{
+		// Changes made while the index was being built can be missed here. The directory isn't
+		// watched any earlier, since there's no way to synchronously stop watching it if the
+		// build is cancelled.
+		WatchIndexDirectory(directoryMonitor, itr->second.get());
+	}
+
+	return std::atomic_load(&itr->second->index);
+}
+
+// The directory continues to be watched while the new index is built. Any changes that occur in
+// the meantime are applied to the previous index and may be missed by the new one, in the same
+// way that changes made while an index is first built can be missed.
+std::shared_ptr<FilenameIndex> FilenameIndexManager::RebuildIndex(IndexInfo &indexInfo,
+	ParallelDirectoryWalker &walker, ParallelDirectoryWalker::DirectoryCallback directoryCallback)
+{
+	auto index =
+		std::make_shared<FilenameIndex>(std::atomic_load(&indexInfo.index)->GetRootDirectory());
+
+	if (!BuildIndex(*index, walker, directoryCallback))
+	{
+		// The rebuild will be attempted again on the next search.
+		indexInfo.rebuildRequested = true;
+		return nullptr;
+	}
+
+	std::atomic_store(&indexInfo.index, index);
+	SaveBuiltIndex(indexInfo);
+
+	return index;
+}
+
+void FilenameIndexManager::SaveIndex(const std::wstring &rootDirectory)
+{
+	IndexInfo *indexInfo;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto itr = m_indexes.find(GetIndexKey(rootDirectory));
+
+		if (itr == m_indexes.end())
+		{
+			return;
+		}
+
+		indexInfo = itr->second.get();
+	}
+
+	if (indexInfo->filePath.empty() || !indexInfo->modified.exchange(false))
+	{
+		return;
+	}
+
+	if (!std::atomic_load(&indexInfo->index)->Save(indexInfo->filePath))
+	{
+		indexInfo->modified = true;
+	}
+}
+
+void FilenameIndexManager::RequestRebuild(const std::wstring &rootDirectory)
+{
+	auto indexKey = GetIndexKey(rootDirectory);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto itr = m_indexes.find(indexKey);
+
+		if (itr != m_indexes.end())
+		{
+			itr->second->rebuildRequested = true;
+			return;
+		}
+	}
+
+	// The index hasn't been loaded, so removing the saved copy is enough to have it rebuilt.
+	auto filePath = GetIndexFilePath(indexKey);
+
+	if (!filePath.empty())
+	{
+		DeleteFile(filePath.c_str());
+	}
+}
+
+// If the index can't be saved now, another attempt will be made after the next search.
+void FilenameIndexManager::SaveBuiltIndex(IndexInfo &indexInfo)
+{
+	indexInfo.modified = indexInfo.filePath.empty()
+		|| !std::atomic_load(&indexInfo.index)->Save(indexInfo.filePath);
+}
+
+std::wstring FilenameIndexManager::GetIndexKey(const std::wstring &rootDirectory)
+{
+	std::wstring indexKey = rootDirectory;
+
+	if (indexKey.size() > 1 && indexKey.back() == '\\')
+	{
+		indexKey.pop_back();
+	}
+
+	CharLowerBuff(indexKey.data(), static_cast<DWORD>(indexKey.size()));
+
+	return indexKey;
+}
+
+std::wstring FilenameIndexManager::GetIndexDirectory()
+{
+	wil::unique_cotaskmem_string localAppData;
+	HRESULT hr =
+		SHGetKnownFolderPath(FOLDERID_LocalAppData, KF_FLAG_DEFAULT, nullptr, &localAppData);
+
+	if (FAILED(hr))
+	{
+		return std::wstring();
+	}
+
+	std::wstring indexDirectory = std::wstring(localAppData.get()) + _T("\\") + INDEX_DIRECTORY;
+	int res = SHCreateDirectoryEx(nullptr, indexDirectory.c_str(), nullptr);
+
+	if (res != ERROR_SUCCESS && res != ERROR_ALREADY_EXISTS)
+	{
+		return std::wstring();
+	}
+
+	return indexDirectory;
+}
+
+std::wstring FilenameIndexManager::GetIndexFilePath(const std::wstring &indexKey)
+{
+	std::wstring indexDirectory = GetIndexDirectory();
+
+	if (indexDirectory.empty())
+	{
+		return std::wstring();
+	}
+
+	return indexDirectory + _T("\\") + std::to_wstring(std::hash<std::wstring>()(indexKey))
+		+ INDEX_FILE_EXTENSION;
+}
+
+// Run once per session, before the first saved index is loaded. The file that's about to be
+// loaded is always kept.
+void FilenameIndexManager::CleanUpIndexFiles(const std::wstring &keepFilePath)
+{
+	struct IndexFile
+	{
+		std::wstring path;
+		ULONGLONG lastWriteTime;
+	};
+
+	std::wstring indexDirectory = GetIndexDirectory();
+
+	if (indexDirectory.empty())
+	{
+		return;
+	}
+
+	WIN32_FIND_DATA findData;
+	wil::unique_hfind findFile(FindFirstFile(
+		(indexDirectory + _T("\\*") + INDEX_FILE_EXTENSION).c_str(), &findData));
+
+	if (!findFile)
+	{
+		return;
+	}
+
+	std::vector<IndexFile> indexFiles;
+
+	do
+	{
+		std::wstring path = indexDirectory + _T("\\") + findData.cFileName;
+
+		if (lstrcmpi(path.c_str(), keepFilePath.c_str()) != 0)
+		{
+			indexFiles.push_back({ path, FileTimeToTicks(findData.ftLastWriteTime) });
+		}
+	} while (FindNextFile(findFile.get(), &findData));
+
+	std::sort(indexFiles.begin(), indexFiles.end(),
+		[](const IndexFile &indexFile1, const IndexFile &indexFile2) {
+			return indexFile1.lastWriteTime > indexFile2.lastWriteTime;
+		});
+
+	ULONGLONG currentTime = GetCurrentTicks();
+
+	for (size_t i = 0; i < indexFiles.size(); i++)
+	{
+		// One of the available slots is taken by the file that's being kept.
+		bool unused = indexFiles[i].lastWriteTime < currentTime
+			&& currentTime - indexFiles[i].lastWriteTime > MAX_UNUSED_INDEX_AGE;
+
+		if (i + 1 >= MAX_INDEX_FILES || unused)
+		{
+			DeleteFile(indexFiles[i].path.c_str());
+		}
+	}
+}
+
+bool FilenameIndexManager::IsIndexCurrent(const FilenameIndex &index)
+{
+	auto buildInfo = index.GetBuildInfo();
+	ULONGLONG currentTime = GetCurrentTicks();
+
+	if (buildInfo.buildTime > currentTime || currentTime - buildInfo.buildTime > MAX_INDEX_AGE)
+	{
+		return false;
+	}
+
+	// A different volume may now be mounted at the same path (e.g. in the case of a removable
+	// drive).
+	return buildInfo.volumeSerialNumber == GetVolumeSerialNumber(index.GetRootDirectory());
+}
+
+bool FilenameIndexManager::BuildIndex(FilenameIndex &index, ParallelDirectoryWalker &walker,
+	ParallelDirectoryWalker::DirectoryCallback directoryCallback)
+{
+	// The start time is recorded, since changes made during the walk may not be reflected in the
+	// index.
+	FilenameIndex::BuildInfo buildInfo;
+	buildInfo.buildTime = GetCurrentTicks();
+	buildInfo.volumeSerialNumber = GetVolumeSerialNumber(index.GetRootDirectory());
+
+	std::vector<WorkerEntries> workerEntries(walker.GetNumWorkers());
+
+	auto addEntries = [&index](WorkerEntries &current) {
+		if (!current.entries.empty())
+		{
+			index.AddEntries(current.directory, current.entries);
+			current.entries.clear();
+		}
+	};
+
+	// The index always covers the entire tree, regardless of whether the search that triggered
+	// the build includes subfolders.
+	walker.Walk(index.GetRootDirectory(), true,
+		[&](int workerIndex, const std::wstring &directory) {
+			auto &current = workerEntries[workerIndex];
+			addEntries(current);
+			current.directory = directory;
+
+			if (directoryCallback)
+			{
+				directoryCallback(workerIndex, directory);
+			}
+		},
+		[&](int workerIndex, const std::wstring &directory, const WIN32_FIND_DATA &findData) {
+			UNREFERENCED_PARAMETER(directory);
+
+			workerEntries[workerIndex].entries.push_back(
+				FilenameIndex::EntryFromFindData(findData));
+		});
+
+	if (walker.IsStopped())
+	{
+		return false;
+	}
+
+	for (auto &current : workerEntries)
+	{
+		addEntries(current);
+	}
+
+	index.SetBuildInfo(buildInfo);
+
+	return true;
+}
+
+void FilenameIndexManager::WatchIndexDirectory(
+	IDirectoryMonitor *directoryMonitor, IndexInfo *indexInfo)
+{
+	if (!directoryMonitor)
+	{
+		return;
+	}
+
+	auto *monitorData = static_cast<MonitorData *>(malloc(sizeof(MonitorData)));
+
+	if (!monitorData)
+	{
+		return;
+	}
+
+	monitorData->indexInfo = indexInfo;
+
+	auto index = std::atomic_load(&indexInfo->index);
+	directoryMonitor->WatchDirectory(index->GetRootDirectory().c_str(),
+		FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE
+			| FILE_NOTIFY_CHANGE_ATTRIBUTES | FILE_NOTIFY_CHANGE_LAST_WRITE,
+		OnDirectoryAltered, TRUE, monitorData);
+}
+
+// Runs on the directory monitor thread. szFileName is relative to the root of the index.
+void FilenameIndexManager::OnDirectoryAltered(
+	const TCHAR *szFileName, DWORD dwAction, void *pData)
+{
+	auto *indexInfo = reinterpret_cast<MonitorData *>(pData)->indexInfo;
+	auto indexPointer = std::atomic_load(&indexInfo->index);
+	auto &index = *indexPointer;
+
+	std::wstring path = index.GetRootDirectory();
+
+	if (!path.empty() && path.back() != '\\')
+	{
+		path += '\\';
+	}
+
+	path += szFileName;
+
+	switch (dwAction)
+	{
+	case FILE_ACTION_ADDED:
+	case FILE_ACTION_RENAMED_NEW_NAME:
+		// A folder that's moved or renamed only generates a notification for the folder itself,
+		// so its contents need to be indexed as well.
+		UpdateEntry(index, path, true);
+		break;
+
+	case FILE_ACTION_MODIFIED:
+		UpdateEntry(index, path, false);
+		break;
+
+	case FILE_ACTION_REMOVED:
+	case FILE_ACTION_RENAMED_OLD_NAME:
+		index.RemoveEntry(path);
+		break;
+	}
+
+	indexInfo->modified = true;
+}
+
+void FilenameIndexManager::UpdateEntry(
+	FilenameIndex &index, const std::wstring &path, bool indexContents)
+{
+	WIN32_FIND_DATA findData;
+	wil::unique_hfind findFile(FindFirstFile(path.c_str(), &findData));
+
+	// The item may have been removed again by the time the notification is processed, in which
+	// case there will be a separate notification for that.
+	if (!findFile)
+	{
+		return;
+	}
+
+	index.AddEntry(path.substr(0, path.find_last_of('\\')),
+		FilenameIndex::EntryFromFindData(findData));
+
+	if (!indexContents || WI_IsFlagClear(findData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+	{
+		return;
+	}
+
+	// This is done on the calling thread, since the walker only starts additional workers when
+	// there's more than one of them.
+	ParallelDirectoryWalker walker(1);
+	walker.Walk(path, true, nullptr,
+		[&index](int workerIndex, const std::wstring &directory, const WIN32_FIND_DATA &wfd) {
+			UNREFERENCED_PARAMETER(workerIndex);
+
+			index.AddEntry(directory, FilenameIndex::EntryFromFindData(wfd));
+		});
+}
@@ -0,0 +1,93 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "../Helper/FilenameIndex.h"
+#include "../Helper/ParallelDirectoryWalker.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+__interface IDirectoryMonitor;
+
+// Owns the filename index for each directory that's been searched with the index enabled. An
+// index is loaded from disk the first time it's needed (or built, if there's no saved copy) and
+// is then kept up to date through directory change notifications for as long as the application
+// is running.
+//
+// Changes made while the application isn't running aren't reflected in an index that's loaded
+// from disk. To limit how out of date the results can be, a saved index is only used if it was
+// built within the last day, on the same volume. A rebuild can also be requested explicitly.
+//
+// Saved indexes that haven't been used in a while are deleted, as are the least recently used
+// ones once there are more than a fixed number of them.
+class FilenameIndexManager
+{
+public:
+	static FilenameIndexManager &GetInstance();
+
+	// Returns the index for the specified directory. If the index needs to be built, the walker
+	// will be used to do so and the directory callback will be invoked as each directory is
+	// enumerated. Returns null if the walker is stopped before the index has been built.
+	//
+	// Can be called from any thread.
+	std::shared_ptr<FilenameIndex> GetIndex(const std::wstring &rootDirectory,
+		IDirectoryMonitor *directoryMonitor, ParallelDirectoryWalker &walker,
+		ParallelDirectoryWalker::DirectoryCallback directoryCallback);
+
+	// Writes the index for the specified directory back to disk, if it's changed since it was
+	// last saved.
+	void SaveIndex(const std::wstring &rootDirectory);
+
+	// Causes the index for the specified directory to be rebuilt the next time it's requested.
+	void RequestRebuild(const std::wstring &rootDirectory);
+
+private:
+	struct IndexInfo
+	{
+		// Replaced when the index is rebuilt, so this should only be accessed through
+		// std::atomic_load() and std::atomic_store().
+		std::shared_ptr<FilenameIndex> index;
+
+		std::wstring filePath;
+		std::atomic<bool> modified = false;
+		std::atomic<bool> rebuildRequested = false;
+	};
+
+	// Passed to the directory monitor, which frees it once the directory is no longer being
+	// watched. The IndexInfo itself is never destroyed while the monitor is running.
+	struct MonitorData
+	{
+		IndexInfo *indexInfo;
+	};
+
+	FilenameIndexManager() = default;
+
+	FilenameIndexManager(const FilenameIndexManager &) = delete;
+	FilenameIndexManager &operator=(const FilenameIndexManager &) = delete;
+
+	std::shared_ptr<FilenameIndex> RebuildIndex(IndexInfo &indexInfo,
+		ParallelDirectoryWalker &walker,
+		ParallelDirectoryWalker::DirectoryCallback directoryCallback);
+
+	static std::wstring GetIndexKey(const std::wstring &rootDirectory);
+	static std::wstring GetIndexDirectory();
+	static std::wstring GetIndexFilePath(const std::wstring &indexKey);
+	static void CleanUpIndexFiles(const std::wstring &keepFilePath);
+	static bool IsIndexCurrent(const FilenameIndex &index);
+	static bool BuildIndex(FilenameIndex &index, ParallelDirectoryWalker &walker,
+		ParallelDirectoryWalker::DirectoryCallback directoryCallback);
+	static void SaveBuiltIndex(IndexInfo &indexInfo);
+	static void WatchIndexDirectory(IDirectoryMonitor *directoryMonitor, IndexInfo *indexInfo);
+
+	static void OnDirectoryAltered(const TCHAR *szFileName, DWORD dwAction, void *pData);
+	static void UpdateEntry(FilenameIndex &index, const std::wstring &path, bool indexContents);
+
+	std::mutex m_mutex;
+	std::unordered_map<std::wstring, std::unique_ptr<IndexInfo>> m_indexes;
+	std::once_flag m_cleanUpFlag;
+};
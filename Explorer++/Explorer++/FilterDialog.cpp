@@ -38,13 +38,16 @@ INT_PTR FilterDialog::OnInitDialog()
 			reinterpret_cast<LPARAM>(strFilter.c_str()));
 	}
 
-	std::wstring filter = m_pexpp->GetActiveShellBrowser()->GetFilter();
+	auto shellBrowser = m_pexpp->GetActiveShellBrowser();
+	m_originalFilter = shellBrowser->GetFilter();
+	m_originalFilterCaseSensitive = shellBrowser->GetFilterCaseSensitive();
+	m_originalFilterStatus = shellBrowser->GetFilterStatus();
 
-	ComboBox_SelectString(hComboBox, -1, filter.c_str());
+	ComboBox_SelectString(hComboBox, -1, m_originalFilter.c_str());
 
 	SendMessage(hComboBox, CB_SETEDITSEL, 0, MAKELPARAM(0, -1));
 
-	if (m_pexpp->GetActiveShellBrowser()->GetFilterCaseSensitive())
+	if (m_originalFilterCaseSensitive)
 	{
 		CheckDlgButton(m_hDlg, IDC_FILTERS_CASESENSITIVE, BST_CHECKED);
 	}
@@ -90,8 +93,19 @@ INT_PTR FilterDialog::OnCommand(WPARAM wParam, LPARAM lParam)
 {
 	UNREFERENCED_PARAMETER(lParam);
 
+	// The filter is applied as it's edited, so that its effect can be seen while typing.
+	if (LOWORD(wParam) == IDC_FILTER_COMBOBOX && HIWORD(wParam) == CBN_EDITCHANGE)
+	{
+		ApplyFilter();
+		return 0;
+	}
+
 	switch (LOWORD(wParam))
 	{
+	case IDC_FILTERS_CASESENSITIVE:
+		ApplyFilter();
+		break;
+
 	case IDOK:
 		OnOk();
 		break;
@@ -106,7 +120,7 @@ INT_PTR FilterDialog::OnCommand(WPARAM wParam, LPARAM lParam)
 
 INT_PTR FilterDialog::OnClose()
 {
-	EndDialog(m_hDlg, 0);
+	OnCancel();
 	return 0;
 }
 
@@ -138,22 +152,55 @@ void FilterDialog::OnOk()
 		m_persistentSettings->m_FilterList.push_front(filter);
 	}
 
-	m_pexpp->GetActiveShellBrowser()->SetFilterCaseSensitive(
-		IsDlgButtonChecked(m_hDlg, IDC_FILTERS_CASESENSITIVE) == BST_CHECKED);
+	ApplyFilter();
+
+	EndDialog(m_hDlg, 1);
+}
+
+void FilterDialog::OnCancel()
+{
+	auto shellBrowser = m_pexpp->GetActiveShellBrowser();
 
-	m_pexpp->GetActiveShellBrowser()->SetFilter(filter);
+	if (shellBrowser->GetFilterCaseSensitive() != m_originalFilterCaseSensitive)
+	{
+		shellBrowser->SetFilterCaseSensitive(m_originalFilterCaseSensitive);
+	}
 
-	if (!m_pexpp->GetActiveShellBrowser()->GetFilterStatus())
+	if (shellBrowser->GetFilter() != m_originalFilter)
 	{
-		m_pexpp->GetActiveShellBrowser()->SetFilterStatus(TRUE);
+		shellBrowser->SetFilter(m_originalFilter);
 	}
 
-	EndDialog(m_hDlg, 1);
+	if (shellBrowser->GetFilterStatus() != m_originalFilterStatus)
+	{
+		shellBrowser->SetFilterStatus(m_originalFilterStatus);
+	}
+
+	EndDialog(m_hDlg, 0);
 }
 
-void FilterDialog::OnCancel()
+void FilterDialog::ApplyFilter()
 {
-	EndDialog(m_hDlg, 0);
+	auto shellBrowser = m_pexpp->GetActiveShellBrowser();
+
+	BOOL caseSensitive = (IsDlgButtonChecked(m_hDlg, IDC_FILTERS_CASESENSITIVE) == BST_CHECKED);
+
+	if (shellBrowser->GetFilterCaseSensitive() != caseSensitive)
+	{
+		shellBrowser->SetFilterCaseSensitive(caseSensitive);
+	}
+
+	std::wstring filter = GetWindowString(GetDlgItem(m_hDlg, IDC_FILTER_COMBOBOX));
+
+	if (shellBrowser->GetFilter() != filter)
+	{
+		shellBrowser->SetFilter(filter);
+	}
+
+	if (!shellBrowser->GetFilterStatus())
+	{
+		shellBrowser->SetFilterStatus(TRUE);
+	}
 }
 
 void FilterDialog::SaveState()
@@ -58,8 +58,15 @@ private:
 
 	void OnOk();
 	void OnCancel();
+	void ApplyFilter();
 
 	IExplorerplusplus *m_pexpp;
 
+	// The filter settings in place when the dialog was opened. These are restored if the dialog
+	// is cancelled.
+	std::wstring m_originalFilter;
+	BOOL m_originalFilterCaseSensitive;
+	BOOL m_originalFilterStatus;
+
 	FilterDialogPersistentSettings *m_persistentSettings;
 };
\ No newline at end of file
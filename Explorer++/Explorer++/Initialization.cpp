@@ -59,6 +59,20 @@ void Explorerplusplus::OnCreate()
 
 	CreateDirectoryMonitor(&m_pDirMon);
 
+	m_folderSizeService.SetDeviceNotificationWindow(m_hContainer);
+
+	m_fileOperationQueue.SetOperationFinishedCallback(
+		[hContainer = m_hContainer](FileOperationQueue::OperationId id, HRESULT result) {
+			UNREFERENCED_PARAMETER(id);
+
+			// Operations that are stopped (either by the user or because the application is
+			// closing) aren't reported.
+			if (FAILED(result) && result != HRESULT_FROM_WIN32(ERROR_CANCELLED))
+			{
+				PostMessage(hContainer, WM_APP_FILEOPERATIONFAILED, static_cast<WPARAM>(result), 0);
+			}
+		});
+
 	CreateStatusBar();
 	CreateMainControls();
 	InitializeDisplayWindow();
@@ -889,7 +889,7 @@ void Explorerplusplus::OnListViewPaste()
 		/* Also, the string must be double NULL terminated. */
 		szDestination[lstrlen(szDestination) + 1] = '\0';
 
-		DropHandler *pDropHandler = DropHandler::CreateNew();
+		DropHandler *pDropHandler = DropHandler::CreateNew(&m_fileOperationQueue);
 		auto *dropFilesCallback = new DropFilesCallback(this);
 		pDropHandler->CopyClipboardData(pClipboardObject, m_hContainer, szDestination,
 			dropFilesCallback, !m_config->overwriteExistingFilesConfirmation);
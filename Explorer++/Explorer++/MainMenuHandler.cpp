@@ -9,6 +9,7 @@
 #include "CustomizeColorsDialog.h"
 #include "DestroyFilesDialog.h"
 #include "DisplayColoursDialog.h"
+#include "DuplicateFilesDialog.h"
 #include "Explorer++_internal.h"
 #include "FileProgressSink.h"
 #include "FilterDialog.h"
@@ -18,6 +19,7 @@
 #include "MergeFilesDialog.h"
 #include "ModelessDialogs.h"
 #include "OptionsDialog.h"
+#include "ResourceHelper.h"
 #include "ScriptingDialog.h"
 #include "SearchDialog.h"
 #include "ShellBrowser/ShellBrowser.h"
@@ -26,9 +28,11 @@
 #include "TabContainer.h"
 #include "UpdateCheckDialog.h"
 #include "WildcardSelectDialog.h"
+#include "../Helper/DirectoryListing.h"
 #include "../Helper/ListViewHelper.h"
 #include "../Helper/ProcessHelper.h"
 #include "../Helper/ShellHelper.h"
+#include <boost/format.hpp>
 #include <wil/com.h>
 
 void Explorerplusplus::OnChangeDisplayColors()
@@ -115,15 +119,31 @@ void Explorerplusplus::OnSearch()
 	}
 }
 
+void Explorerplusplus::OnFindDuplicateFiles()
+{
+	std::wstring currentDirectory = m_pActiveShellBrowser->GetDirectory();
+
+	DuplicateFilesDialog duplicateFilesDialog(
+		m_hLanguageModule, m_hContainer, this, currentDirectory);
+	duplicateFilesDialog.ShowModalDialog();
+}
+
 void Explorerplusplus::OnCustomizeColors()
 {
 	CustomizeColorsDialog customizeColorsDialog(
 		m_hLanguageModule, m_hContainer, this, &m_ColorRules);
 	customizeColorsDialog.ShowModalDialog();
 
-	/* Causes the active listview to redraw (therefore
-	applying any updated color schemes). */
-	InvalidateRect(m_hActiveListView, nullptr, FALSE);
+	OnColorRulesUpdated();
+}
+
+void Explorerplusplus::OnColorRulesUpdated()
+{
+	/* The matcher is updated in place, so that any
+	existing references to it remain valid. */
+	*m_colorRuleMatcher = NColorRuleHelper::ColorRuleMatcher(m_ColorRules);
+
+	m_colorRulesUpdatedSignal();
 }
 
 void Explorerplusplus::OnRunScript()
@@ -194,7 +214,7 @@ void Explorerplusplus::OnAbout()
 	aboutDialog.ShowModalDialog();
 }
 
-void Explorerplusplus::OnSaveDirectoryListing() const
+void Explorerplusplus::OnSaveDirectoryListing(bool recursive)
 {
 	TCHAR fileName[MAX_PATH];
 	LoadString(m_hLanguageModule, IDS_GENERAL_DIRECTORY_LISTING_FILENAME, fileName,
@@ -208,10 +228,41 @@ void Explorerplusplus::OnSaveDirectoryListing() const
 
 	if (bSaveNameRetrieved)
 	{
-		NFileOperations::SaveDirectoryListing(directory, fileName);
+		DirectoryListing::Options options;
+		options.format = DirectoryListing::GetFormatForFileName(fileName);
+		options.recursive = recursive;
+
+		std::wstring outputPath = fileName;
+
+		// Listing a large directory (particularly when subfolders are included) can take a
+		// while, so the listing is saved in the background and the result is reported once it's
+		// done.
+		m_directoryListingThreadPool.push([hContainer = m_hContainer, directory, outputPath,
+											  options](int id) {
+			UNREFERENCED_PARAMETER(id);
+
+			bool succeeded = DirectoryListing::Save(directory, outputPath, options);
+			auto *result = new DirectoryListingSaveResult{ outputPath, succeeded };
+
+			if (!PostMessage(hContainer, WM_APP_DIRECTORYLISTINGSAVED, 0,
+					reinterpret_cast<LPARAM>(result)))
+			{
+				delete result;
+			}
+		});
 	}
 }
 
+void Explorerplusplus::OnDirectoryListingSaved(const DirectoryListingSaveResult &result)
+{
+	std::wstring message = ResourceHelper::LoadString(m_hLanguageModule,
+		result.succeeded ? IDS_DIRECTORY_LISTING_SAVED : IDS_DIRECTORY_LISTING_SAVE_FAILED);
+	message = (boost::wformat(message) % result.outputPath).str();
+
+	MessageBox(m_hContainer, message.c_str(), NExplorerplusplus::APP_NAME,
+		result.succeeded ? (MB_ICONINFORMATION | MB_OK) : (MB_ICONERROR | MB_OK));
+}
+
 void Explorerplusplus::OnCreateNewFolder()
 {
 	auto pidlDirectory = m_pActiveShellBrowser->GetDirectoryIdl();
@@ -164,6 +164,18 @@ LRESULT CALLBACK Explorerplusplus::WindowProcedure(HWND hwnd,UINT Msg,WPARAM wPa
 		}
 		break;
 
+	case WM_APP_DIRECTORYLISTINGSAVED:
+	{
+		std::unique_ptr<DirectoryListingSaveResult> result(
+			reinterpret_cast<DirectoryListingSaveResult *>(lParam));
+		OnDirectoryListingSaved(*result);
+	}
+	break;
+
+	case WM_APP_FILEOPERATIONFAILED:
+		OnFileOperationFailed(static_cast<HRESULT>(wParam));
+		break;
+
 	case WM_APP_FOLDERSIZECOMPLETED:
 		{
 			DWFolderSizeCompletion *pDWFolderSizeCompletion = nullptr;
@@ -211,7 +223,7 @@ LRESULT CALLBACK Explorerplusplus::WindowProcedure(HWND hwnd,UINT Msg,WPARAM wPa
 				DisplayWindow_SetLine(m_hDisplayWindow,FOLDER_SIZE_LINE_INDEX,szSizeString);
 			}
 
-			free(pDWFolderSizeCompletion);
+			delete pDWFolderSizeCompletion;
 		}
 		break;
 
@@ -338,7 +350,11 @@ LRESULT Explorerplusplus::HandleMenuOrAccelerator(HWND hwnd, WPARAM wParam)
 		break;
 
 	case IDM_FILE_SAVEDIRECTORYLISTING:
-		OnSaveDirectoryListing();
+		OnSaveDirectoryListing(false);
+		break;
+
+	case IDM_FILE_SAVEDIRECTORYLISTINGRECURSIVE:
+		OnSaveDirectoryListing(true);
 		break;
 
 	case ToolbarButton::OpenCommandPrompt:
@@ -398,7 +414,7 @@ LRESULT Explorerplusplus::HandleMenuOrAccelerator(HWND hwnd, WPARAM wParam)
 		break;
 
 	case IDM_EDIT_UNDO:
-		m_FileActionHandler.Undo();
+		m_FileActionHandler.Undo(m_hContainer);
 		break;
 
 	case ToolbarButton::Copy:
@@ -1271,6 +1287,10 @@ LRESULT Explorerplusplus::HandleMenuOrAccelerator(HWND hwnd, WPARAM wParam)
 		OnSearch();
 		break;
 
+	case IDM_TOOLS_FINDDUPLICATES:
+		OnFindDuplicateFiles();
+		break;
+
 	case IDM_TOOLS_CUSTOMIZECOLORS:
 		OnCustomizeColors();
 		break;
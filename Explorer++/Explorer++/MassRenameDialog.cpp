@@ -4,13 +4,13 @@
 
 /*
  * Provides support for the mass renaming of files.
- * The following special characters are supported:
- * /N	- Counter
- * /F	- Filename
- * /B	- Basename (filename without extension)
- * /E	- Extension
- * /L	- Lowercase filename
- * /U	- Uppercase filename
+ * The supported special characters are listed in
+ * MassRenamePattern.h.
+ *
+ * The listview is virtual, with the preview names
+ * generated on demand, so that only the names that
+ * are actually visible are generated as the pattern
+ * is edited.
  */
 
 #include "stdafx.h"
@@ -23,10 +23,8 @@
 #include "../Helper/Macros.h"
 #include "../Helper/RegistrySettings.h"
 #include "../Helper/XMLSettings.h"
-#include <boost/locale.hpp>
-#include <iomanip>
+#include <wil/common.h>
 #include <list>
-#include <regex>
 
 const TCHAR MassRenameDialogPersistentSettings::SETTINGS_KEY[] = _T("MassRename");
 
@@ -37,10 +35,14 @@ MassRenameDialog::MassRenameDialog(HINSTANCE hInstance, HWND hParent,
 	const std::list<std::wstring> &FullFilenameList, IconResourceLoader *iconResourceLoader,
 	FileActionHandler *pFileActionHandler) :
 	DarkModeDialogBase(hInstance, IDD_MASSRENAME, hParent, true),
-	m_FullFilenameList(FullFilenameList),
 	m_iconResourceLoader(iconResourceLoader),
 	m_pFileActionHandler(pFileActionHandler)
 {
+	for (const auto &fullFilename : FullFilenameList)
+	{
+		m_items.push_back({ fullFilename, PathFindFileName(fullFilename.c_str()), std::nullopt });
+	}
+
 	m_persistentSettings = &MassRenameDialogPersistentSettings::GetInstance();
 }
 
@@ -79,34 +81,10 @@ INT_PTR MassRenameDialog::OnInitDialog()
 	SendMessage(hListView, LVM_SETCOLUMNWIDTH, 0, m_persistentSettings->m_iColumnWidth1);
 	SendMessage(hListView, LVM_SETCOLUMNWIDTH, 1, m_persistentSettings->m_iColumnWidth2);
 
-	LVITEM lvItem;
-	SHFILEINFO shfi;
-	TCHAR szFilename[MAX_PATH];
-	int iItem = 0;
-
-	/* Add each file to the listview, along with its icon. */
-	for (const auto &strFilename : m_FullFilenameList)
-	{
-		SHGetFileInfo(strFilename.c_str(), 0, &shfi, sizeof(SHFILEINFO), SHGFI_SYSICONINDEX);
-
-		StringCchCopy(szFilename, SIZEOF_ARRAY(szFilename), strFilename.c_str());
-		PathStripPath(szFilename);
-
-		lvItem.mask = LVIF_TEXT | LVIF_IMAGE;
-		lvItem.iItem = iItem;
-		lvItem.iSubItem = 0;
-		lvItem.iImage = shfi.iIcon;
-		lvItem.pszText = szFilename;
-		ListView_InsertItem(hListView, &lvItem);
-
-		lvItem.mask = LVIF_TEXT;
-		lvItem.iItem = iItem;
-		lvItem.iSubItem = 1;
-		lvItem.pszText = szFilename;
-		ListView_SetItem(hListView, &lvItem);
-
-		iItem++;
-	}
+	/* The text and icon for each item are only
+	retrieved once the item is displayed. */
+	m_pattern.emplace(_T("/F"));
+	ListView_SetItemCountEx(hListView, static_cast<int>(m_items.size()), LVSICF_NOSCROLL);
 
 	SetDlgItemText(m_hDlg, IDC_MASSRENAME_EDIT, _T("/F"));
 	SendMessage(GetDlgItem(m_hDlg, IDC_MASSRENAME_EDIT), EM_SETSEL, 0, -1);
@@ -167,37 +145,8 @@ INT_PTR MassRenameDialog::OnCommand(WPARAM wParam, LPARAM lParam)
 		switch (HIWORD(wParam))
 		{
 		case EN_CHANGE:
-		{
-			TCHAR szNamePattern[MAX_PATH];
-			GetDlgItemText(m_hDlg, IDC_MASSRENAME_EDIT, szNamePattern, SIZEOF_ARRAY(szNamePattern));
-
-			HWND hListView = GetDlgItem(m_hDlg, IDC_MASSRENAME_FILELISTVIEW);
-
-			LVITEM lvItem;
-			std::wstring strNewFilename;
-			TCHAR szFilename[MAX_PATH];
-			TCHAR szNewFilename[MAX_PATH];
-			int iItem = 0;
-
-			for (const auto &strFilename : m_FullFilenameList)
-			{
-				StringCchCopy(szFilename, SIZEOF_ARRAY(szFilename), strFilename.c_str());
-				PathStripPath(szFilename);
-
-				ProcessFileName(szNamePattern, szFilename, iItem, strNewFilename);
-
-				StringCchCopy(szNewFilename, SIZEOF_ARRAY(szNewFilename), strNewFilename.c_str());
-
-				lvItem.mask = LVIF_TEXT;
-				lvItem.iItem = iItem;
-				lvItem.iSubItem = 1;
-				lvItem.pszText = szNewFilename;
-				ListView_SetItem(hListView, &lvItem);
-
-				iItem++;
-			}
-		}
-		break;
+			OnPatternChanged();
+			break;
 		}
 	}
 	else
@@ -263,6 +212,72 @@ INT_PTR MassRenameDialog::OnCommand(WPARAM wParam, LPARAM lParam)
 	return 0;
 }
 
+INT_PTR MassRenameDialog::OnNotify(NMHDR *pnmhdr)
+{
+	switch (pnmhdr->code)
+	{
+	case LVN_GETDISPINFO:
+		if (pnmhdr->hwndFrom == GetDlgItem(m_hDlg, IDC_MASSRENAME_FILELISTVIEW))
+		{
+			OnGetDispInfo(reinterpret_cast<NMLVDISPINFO *>(pnmhdr));
+		}
+		break;
+	}
+
+	return 0;
+}
+
+void MassRenameDialog::OnGetDispInfo(NMLVDISPINFO *dispInfo)
+{
+	auto &item = m_items[dispInfo->item.iItem];
+
+	if (WI_IsFlagSet(dispInfo->item.mask, LVIF_TEXT))
+	{
+		std::wstring text;
+
+		switch (dispInfo->item.iSubItem)
+		{
+		case 0:
+			text = item.filename;
+			break;
+
+		case 1:
+			text = m_pattern->Apply(item.filename, dispInfo->item.iItem);
+			break;
+		}
+
+		StringCchCopy(dispInfo->item.pszText, dispInfo->item.cchTextMax, text.c_str());
+	}
+
+	if (WI_IsFlagSet(dispInfo->item.mask, LVIF_IMAGE))
+	{
+		if (!item.iconIndex)
+		{
+			SHFILEINFO shfi;
+			DWORD_PTR res = SHGetFileInfo(
+				item.fullFilename.c_str(), 0, &shfi, sizeof(shfi), SHGFI_SYSICONINDEX);
+			item.iconIndex = res ? shfi.iIcon : 0;
+		}
+
+		dispInfo->item.iImage = *item.iconIndex;
+	}
+}
+
+/* The pattern is only parsed once per change. Since
+the listview is virtual, redrawing the visible items
+is enough to update the preview. */
+void MassRenameDialog::OnPatternChanged()
+{
+	TCHAR szNamePattern[MAX_PATH];
+	GetDlgItemText(m_hDlg, IDC_MASSRENAME_EDIT, szNamePattern, SIZEOF_ARRAY(szNamePattern));
+
+	m_pattern.emplace(szNamePattern);
+
+	HWND hListView = GetDlgItem(m_hDlg, IDC_MASSRENAME_FILELISTVIEW);
+	int topIndex = ListView_GetTopIndex(hListView);
+	ListView_RedrawItems(hListView, topIndex, topIndex + ListView_GetCountPerPage(hListView));
+}
+
 INT_PTR MassRenameDialog::OnClose()
 {
 	EndDialog(m_hDlg, 0);
@@ -281,31 +296,25 @@ void MassRenameDialog::OnOk()
 		return;
 	}
 
+	MassRenamePattern pattern(szNamePattern);
 	std::list<FileActionHandler::RenamedItem_t> renamedItemList;
 	int iItem = 0;
 
-	for (const auto &strOldFilename : m_FullFilenameList)
+	for (const auto &item : m_items)
 	{
-		TCHAR szFilename[MAX_PATH];
-		StringCchCopy(szFilename, SIZEOF_ARRAY(szFilename), strOldFilename.c_str());
-		PathStripPath(szFilename);
-
-		std::wstring strNewFilename;
-		ProcessFileName(szNamePattern, szFilename, iItem, strNewFilename);
-
-		StringCchCopy(szFilename, SIZEOF_ARRAY(szFilename), strOldFilename.c_str());
-		PathRemoveFileSpec(szFilename);
-		strNewFilename = szFilename + std::wstring(_T("\\")) + strNewFilename;
-
+		/* The new name is placed in the same folder
+		as the original item. */
 		FileActionHandler::RenamedItem_t renamedItem;
-		renamedItem.strOldFilename = strOldFilename;
-		renamedItem.strNewFilename = strNewFilename;
+		renamedItem.strOldFilename = item.fullFilename;
+		renamedItem.strNewFilename =
+			item.fullFilename.substr(0, item.fullFilename.size() - item.filename.size())
+			+ pattern.Apply(item.filename, iItem);
 		renamedItemList.push_back(renamedItem);
 
 		iItem++;
 	}
 
-	m_pFileActionHandler->RenameFiles(renamedItemList);
+	m_pFileActionHandler->RenameFiles(m_hDlg, renamedItemList);
 
 	EndDialog(m_hDlg, 1);
 }
@@ -326,73 +335,6 @@ void MassRenameDialog::SaveState()
 	m_persistentSettings->m_bStateSaved = TRUE;
 }
 
-void MassRenameDialog::ProcessFileName(const std::wstring &strTarget,
-	const std::wstring &strFilename, int iFileIndex, std::wstring &strOutput)
-{
-	TCHAR szBaseName[MAX_PATH];
-	StringCchCopy(szBaseName, SIZEOF_ARRAY(szBaseName), strFilename.c_str());
-	PathRemoveExtension(szBaseName);
-
-	TCHAR *pExt = PathFindExtension(strFilename.c_str());
-
-	size_t iPos;
-
-	strOutput = strTarget;
-
-	std::wregex rxPattern;
-	rxPattern.assign(_T("/[0]*N"));
-
-	bool bStop = false;
-
-	while (!bStop)
-	{
-		std::match_results<std::wstring::const_iterator> mr;
-		std::wstring::const_iterator itrStart = strOutput.begin();
-		std::wstring::const_iterator itrEnd = strOutput.end();
-
-		if (std::regex_search(itrStart, itrEnd, mr, rxPattern))
-		{
-			std::wstringstream ss;
-
-			/* The minimum length is the number of zeros present plus one. */
-			ss << std::setfill(_T('0')) << std::setw((mr.length() - 2) + 1) << iFileIndex;
-
-			strOutput.replace(mr.position(), mr.length(), ss.str());
-		}
-		else
-		{
-			bStop = true;
-		}
-	}
-
-	while ((iPos = strOutput.find(_T("/F"))) != std::wstring::npos)
-	{
-		strOutput.replace(iPos, 2, strFilename);
-	}
-
-	while ((iPos = strOutput.find(_T("/B"))) != std::wstring::npos)
-	{
-		strOutput.replace(iPos, 2, szBaseName);
-	}
-
-	while ((iPos = strOutput.find(_T("/E"))) != std::wstring::npos)
-	{
-		strOutput.replace(iPos, 2, pExt);
-	}
-
-	while ((iPos = strOutput.find(_T("/L"))) != std::wstring::npos)
-	{
-		strOutput.replace(iPos, 2, strFilename);
-		strOutput = boost::locale::to_lower(strOutput);
-	}
-
-	while ((iPos = strOutput.find(_T("/U"))) != std::wstring::npos)
-	{
-		strOutput.replace(iPos, 2, strFilename);
-		strOutput = boost::locale::to_upper(strOutput);
-	}
-}
-
 MassRenameDialogPersistentSettings::MassRenameDialogPersistentSettings() :
 	DialogSettings(SETTINGS_KEY)
 {
@@ -5,9 +5,12 @@
 #pragma once
 
 #include "DarkModeDialogBase.h"
+#include "MassRenamePattern.h"
 #include "../Helper/DialogSettings.h"
 #include "../Helper/FileActionHandler.h"
 #include "../Helper/ResizableDialog.h"
+#include <optional>
+#include <vector>
 
 class IconResourceLoader;
 class MassRenameDialog;
@@ -52,22 +55,32 @@ public:
 protected:
 	INT_PTR OnInitDialog() override;
 	INT_PTR OnCommand(WPARAM wParam, LPARAM lParam) override;
+	INT_PTR OnNotify(NMHDR *pnmhdr) override;
 	INT_PTR OnClose() override;
 
 	virtual wil::unique_hicon GetDialogIcon(int iconWidth, int iconHeight) const override;
 
 private:
+	struct Item
+	{
+		std::wstring fullFilename;
+		std::wstring filename;
+
+		// Only retrieved once the item is displayed.
+		std::optional<int> iconIndex;
+	};
+
 	void GetResizableControlInformation(BaseDialog::DialogSizeConstraint &dsc,
 		std::list<ResizableDialog::Control> &ControlList) override;
 	void SaveState() override;
 
+	void OnGetDispInfo(NMLVDISPINFO *dispInfo);
+	void OnPatternChanged();
 	void OnOk();
 	void OnCancel();
 
-	void ProcessFileName(const std::wstring &strTarget, const std::wstring &strFilename,
-		int iFileIndex, std::wstring &strOutput);
-
-	std::list<std::wstring> m_FullFilenameList;
+	std::vector<Item> m_items;
+	std::optional<MassRenamePattern> m_pattern;
 	wil::unique_hicon m_moreIcon;
 	IconResourceLoader *m_iconResourceLoader;
 	FileActionHandler *m_pFileActionHandler;
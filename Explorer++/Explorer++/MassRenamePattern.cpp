@@ -0,0 +1,179 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "MassRenamePattern.h"
+#include <boost/locale.hpp>
+
+MassRenamePattern::MassRenamePattern(const std::wstring &pattern, const std::locale &locale) :
+	m_locale(locale)
+{
+	std::vector<size_t> uppercaseTokens;
+	size_t i = 0;
+
+	while (i < pattern.size())
+	{
+		if (pattern[i] != '/')
+		{
+			AddLiteral(pattern[i]);
+			i++;
+			continue;
+		}
+
+		size_t numZeros = 0;
+
+		while (i + 1 + numZeros < pattern.size() && pattern[i + 1 + numZeros] == '0')
+		{
+			numZeros++;
+		}
+
+		size_t tokenEnd = i + 1 + numZeros;
+
+		if (tokenEnd < pattern.size() && pattern[tokenEnd] == 'N')
+		{
+			AddToken(TokenType::Counter, numZeros + 1);
+			i = tokenEnd + 1;
+			continue;
+		}
+
+		// Zeros are only meaningful before an N, so anything else is treated as literal text,
+		// starting at the character after the slash.
+		if (numZeros > 0 || i + 1 == pattern.size())
+		{
+			AddLiteral(pattern[i]);
+			i++;
+			continue;
+		}
+
+		switch (pattern[i + 1])
+		{
+		case 'F':
+			AddToken(TokenType::Filename);
+			break;
+
+		case 'B':
+			AddToken(TokenType::Basename);
+			break;
+
+		case 'E':
+			AddToken(TokenType::Extension);
+			break;
+
+		// Only the first /L is replaced. Any later /L is left as is (and ends up lowercased
+		// along with everything else).
+		case 'L':
+			if (m_caseConversion == CaseConversion::Lowercase)
+			{
+				AddLiteral(pattern[i]);
+				AddLiteral(pattern[i + 1]);
+				break;
+			}
+
+			AddToken(TokenType::Filename);
+			m_caseConversion = CaseConversion::Lowercase;
+			break;
+
+		case 'U':
+			uppercaseTokens.push_back(m_tokens.size());
+			AddToken(TokenType::Filename);
+			break;
+
+		default:
+			AddLiteral(pattern[i]);
+			i++;
+			continue;
+		}
+
+		i += 2;
+	}
+
+	// Lowercase conversion takes precedence, regardless of the order in which the tokens appear.
+	// In that case, each /U is left as is.
+	for (size_t index : uppercaseTokens)
+	{
+		if (m_caseConversion == CaseConversion::Lowercase)
+		{
+			m_tokens[index] = { TokenType::Literal, L"/U", 0 };
+		}
+	}
+
+	if (!uppercaseTokens.empty() && m_caseConversion == CaseConversion::None)
+	{
+		m_caseConversion = CaseConversion::Uppercase;
+	}
+}
+
+void MassRenamePattern::AddToken(TokenType type, size_t width)
+{
+	m_tokens.push_back({ type, L"", width });
+}
+
+// Adjacent literal characters are merged into a single token.
+void MassRenamePattern::AddLiteral(wchar_t character)
+{
+	if (m_tokens.empty() || m_tokens.back().type != TokenType::Literal)
+	{
+		AddToken(TokenType::Literal);
+	}
+
+	m_tokens.back().text += character;
+}
+
+std::wstring MassRenamePattern::Apply(const std::wstring &filename, int index) const
+{
+	// The extension is located in the same way as PathFindExtension() would locate it.
+	const wchar_t *extension = PathFindExtension(filename.c_str());
+	size_t basenameLength = extension - filename.c_str();
+
+	std::wstring output;
+	output.reserve(filename.size() * 2);
+
+	for (const auto &token : m_tokens)
+	{
+		switch (token.type)
+		{
+		case TokenType::Literal:
+			output += token.text;
+			break;
+
+		case TokenType::Counter:
+		{
+			std::wstring counter = std::to_wstring(index);
+
+			if (counter.size() < token.width)
+			{
+				output.append(token.width - counter.size(), '0');
+			}
+
+			output += counter;
+		}
+		break;
+
+		case TokenType::Filename:
+			output += filename;
+			break;
+
+		case TokenType::Basename:
+			output.append(filename, 0, basenameLength);
+			break;
+
+		case TokenType::Extension:
+			output += extension;
+			break;
+		}
+	}
+
+	switch (m_caseConversion)
+	{
+	case CaseConversion::Lowercase:
+		return boost::locale::to_lower(output, m_locale);
+
+	case CaseConversion::Uppercase:
+		return boost::locale::to_upper(output, m_locale);
+
+	case CaseConversion::None:
+	default:
+		return output;
+	}
+}
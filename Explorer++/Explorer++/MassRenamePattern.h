@@ -0,0 +1,69 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <locale>
+#include <string>
+#include <vector>
+
+// A mass rename pattern. The pattern is parsed once, into a list of tokens, which means that it
+// can then be applied to a large number of names cheaply. The following special tokens are
+// supported:
+//
+// /N - Counter. Any zeros between the slash and the N set the minimum width of the counter (the
+//      number of zeros plus one), with the counter being padded with zeros up to that width.
+// /F - Filename
+// /B - Basename (filename without extension)
+// /E - Extension
+// /L - Filename, with the whole of the new name then converted to lowercase
+// /U - Filename, with the whole of the new name then converted to uppercase
+//
+// Everything else in the pattern is copied into the new name as is. Only the first /L is
+// replaced, and if there is one, each /U is treated as literal text. That is, lowercase
+// conversion takes precedence.
+class MassRenamePattern
+{
+public:
+	// The locale is used to convert the case of the name, if the pattern requires it.
+	explicit MassRenamePattern(
+		const std::wstring &pattern, const std::locale &locale = std::locale());
+
+	std::wstring Apply(const std::wstring &filename, int index) const;
+
+private:
+	enum class TokenType
+	{
+		Literal,
+		Counter,
+		Filename,
+		Basename,
+		Extension
+	};
+
+	enum class CaseConversion
+	{
+		None,
+		Lowercase,
+		Uppercase
+	};
+
+	struct Token
+	{
+		TokenType type;
+
+		// Only used for literal tokens.
+		std::wstring text;
+
+		// Only used for counter tokens.
+		size_t width;
+	};
+
+	void AddToken(TokenType type, size_t width = 0);
+	void AddLiteral(wchar_t character);
+
+	std::vector<Token> m_tokens;
+	CaseConversion m_caseConversion = CaseConversion::None;
+	std::locale m_locale;
+};
@@ -17,15 +17,20 @@
 #include "../Helper/ShellHelper.h"
 #include "../Helper/StringHelper.h"
 #include "../Helper/WindowHelper.h"
+#include "../Helper/XxHash64.h"
 #include <wil/resource.h>
+#include <algorithm>
 #include <regex>
 
 namespace NMergeFilesDialog
 {
-	const int WM_APP_SETTOTALMERGECOUNT = WM_APP + 1;
-	const int WM_APP_SETCURRENTMERGECOUNT = WM_APP + 2;
-	const int WM_APP_MERGINGFINISHED = WM_APP + 3;
-	const int WM_APP_OUTPUTFILEINVALID = WM_APP + 4;
+	const int WM_APP_SETMERGEPROGRESS = WM_APP + 1;
+	const int WM_APP_MERGINGFINISHED = WM_APP + 2;
+	const int WM_APP_OUTPUTFILEINVALID = WM_APP + 3;
+
+	// Progress is measured in bytes, which won't fit into the (32-bit) range of the progress bar
+	// once the parts get large enough, so it's scaled to this range instead.
+	const int PROGRESS_RANGE = 1000;
 
 	DWORD WINAPI MergeFilesThread(LPVOID pParam);
 }
@@ -316,16 +321,12 @@ INT_PTR MergeFilesDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lPar
 
 	switch (uMsg)
 	{
-	case NMergeFilesDialog::WM_APP_SETTOTALMERGECOUNT:
-		SendDlgItemMessage(m_hDlg, IDC_MERGE_PROGRESS, PBM_SETRANGE32, 0, wParam);
-		break;
-
-	case NMergeFilesDialog::WM_APP_SETCURRENTMERGECOUNT:
+	case NMergeFilesDialog::WM_APP_SETMERGEPROGRESS:
 		SendDlgItemMessage(m_hDlg, IDC_MERGE_PROGRESS, PBM_SETPOS, wParam, 0);
 		break;
 
 	case NMergeFilesDialog::WM_APP_MERGINGFINISHED:
-		OnFinished();
+		OnFinished(static_cast<MergeFiles::Result>(wParam));
 		break;
 
 	case NMergeFilesDialog::WM_APP_OUTPUTFILEINVALID:
@@ -375,6 +376,8 @@ void MergeFilesDialog::OnOk()
 
 		m_pMergeFiles = new MergeFiles(m_hDlg, outputFileName, m_FullFilenameList);
 
+		SendDlgItemMessage(m_hDlg, IDC_MERGE_PROGRESS, PBM_SETRANGE32, 0,
+			NMergeFilesDialog::PROGRESS_RANGE);
 		SendDlgItemMessage(m_hDlg, IDC_MERGE_PROGRESS, PBM_SETPOS, 0, 0);
 
 		GetDlgItemText(m_hDlg, IDOK, m_szOk, SIZEOF_ARRAY(m_szOk));
@@ -385,6 +388,10 @@ void MergeFilesDialog::OnOk()
 
 		m_bMergingFiles = true;
 
+		// The thread holds its own reference, since the dialog may be destroyed (and release its
+		// reference) before the merge has finished.
+		m_pMergeFiles->AddRef();
+
 		HANDLE hThread = CreateThread(nullptr, 0, NMergeFilesDialog::MergeFilesThread,
 			reinterpret_cast<LPVOID>(m_pMergeFiles), 0, nullptr);
 		SetThreadPriority(hThread, THREAD_PRIORITY_LOWEST);
@@ -477,7 +484,7 @@ void MergeFilesDialog::OnMove(bool bUp)
 	}
 }
 
-void MergeFilesDialog::OnFinished()
+void MergeFilesDialog::OnFinished(MergeFiles::Result result)
 {
 	assert(m_pMergeFiles != nullptr);
 
@@ -487,12 +494,29 @@ void MergeFilesDialog::OnFinished()
 	m_bMergingFiles = false;
 	m_bStopMerging = false;
 
-	/* Set the progress bar position to the end. */
-	int iHighLimit =
-		static_cast<int>(SendDlgItemMessage(m_hDlg, IDC_MERGE_PROGRESS, PBM_GETRANGE, FALSE, 0));
-	SendDlgItemMessage(m_hDlg, IDC_MERGE_PROGRESS, PBM_SETPOS, iHighLimit, 0);
+	if (result == MergeFiles::Result::Succeeded)
+	{
+		/* Set the progress bar position to the end. */
+		int iHighLimit = static_cast<int>(
+			SendDlgItemMessage(m_hDlg, IDC_MERGE_PROGRESS, PBM_GETRANGE, FALSE, 0));
+		SendDlgItemMessage(m_hDlg, IDC_MERGE_PROGRESS, PBM_SETPOS, iHighLimit, 0);
+	}
+	else
+	{
+		SendDlgItemMessage(m_hDlg, IDC_MERGE_PROGRESS, PBM_SETPOS, 0, 0);
+	}
 
 	SetDlgItemText(m_hDlg, IDOK, m_szOk);
+
+	if (result == MergeFiles::Result::Failed || result == MergeFiles::Result::ChecksumMismatch)
+	{
+		UINT stringId = (result == MergeFiles::Result::Failed) ? IDS_MERGE_FILES_FAILED
+															   : IDS_MERGE_FILES_CHECKSUM_MISMATCH;
+
+		TCHAR szTemp[128];
+		LoadString(GetInstance(), stringId, szTemp, SIZEOF_ARRAY(szTemp));
+		MessageBox(m_hDlg, szTemp, NExplorerplusplus::APP_NAME, MB_ICONWARNING | MB_OK);
+	}
 }
 
 DWORD WINAPI NMergeFilesDialog::MergeFilesThread(LPVOID pParam)
@@ -501,97 +525,253 @@ DWORD WINAPI NMergeFilesDialog::MergeFilesThread(LPVOID pParam)
 
 	auto *pMergeFiles = reinterpret_cast<MergeFiles *>(pParam);
 	pMergeFiles->StartMerging();
+	pMergeFiles->Release();
 
 	return 0;
 }
 
 MergeFiles::MergeFiles(HWND hDlg, const std::wstring &strOutputFilename,
-	const std::list<std::wstring> &FullFilenameList)
-{
-	m_hDlg = hDlg;
-	m_strOutputFilename = strOutputFilename;
-	m_FullFilenameList = FullFilenameList;
-
-	m_bstopMerging = false;
-
-	InitializeCriticalSection(&m_csStop);
-}
-
-MergeFiles::~MergeFiles()
+	const std::list<std::wstring> &FullFilenameList) :
+	m_hDlg(hDlg),
+	m_strOutputFilename(strOutputFilename),
+	m_FullFilenameList(FullFilenameList),
+	m_progressPosition(0)
 {
-	DeleteCriticalSection(&m_csStop);
 }
 
 void MergeFiles::StartMerging()
 {
-	LARGE_INTEGER lMergeFileSize;
-	int nFilesMerged = 1;
-	bool bStop = false;
-
-	HANDLE hOutputFile = CreateFile(m_strOutputFilename.c_str(), GENERIC_WRITE, 0, nullptr,
-		CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+	wil::unique_hfile outputFile(CreateFile(m_strOutputFilename.c_str(), GENERIC_WRITE | DELETE, 0,
+		nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr));
 
-	if (hOutputFile == INVALID_HANDLE_VALUE)
+	if (!outputFile)
 	{
 		PostMessage(m_hDlg, NMergeFilesDialog::WM_APP_OUTPUTFILEINVALID, 0, 0);
 		return;
 	}
 
-	PostMessage(m_hDlg, NMergeFilesDialog::WM_APP_SETTOTALMERGECOUNT,
-		static_cast<WPARAM>(m_FullFilenameList.size()), 0);
+	Result result = MergeInto(outputFile.get());
+
+	if (result != Result::Succeeded)
+	{
+		// A partially merged file is of no use, so it's removed once it's closed.
+		FILE_DISPOSITION_INFO dispositionInfo;
+		dispositionInfo.DeleteFile = TRUE;
+		SetFileInformationByHandle(
+			outputFile.get(), FileDispositionInfo, &dispositionInfo, sizeof(dispositionInfo));
+	}
+
+	outputFile.reset();
+
+	SendMessage(m_hDlg, NMergeFilesDialog::WM_APP_MERGINGFINISHED, static_cast<WPARAM>(result), 0);
+}
+
+MergeFiles::Result MergeFiles::MergeInto(HANDLE outputFile)
+{
+	ULONGLONG totalSize = 0;
 
 	for (const auto &strFullFilename : m_FullFilenameList)
 	{
-		if (bStop)
+		WIN32_FILE_ATTRIBUTE_DATA attributeData;
+
+		if (!GetFileAttributesEx(strFullFilename.c_str(), GetFileExInfoStandard, &attributeData))
 		{
+			return Result::Failed;
+		}
+
+		totalSize += (static_cast<ULONGLONG>(attributeData.nFileSizeHigh) << 32)
+			| attributeData.nFileSizeLow;
+	}
+
+	// Reserving all the space up front allows the file system to allocate the output in as few
+	// pieces as possible. This is only an optimization, so a failure here can be ignored.
+	FILE_ALLOCATION_INFO allocationInfo;
+	allocationInfo.AllocationSize.QuadPart = totalSize;
+	SetFileInformationByHandle(
+		outputFile, FileAllocationInfo, &allocationInfo, sizeof(allocationInfo));
+
+	auto manifests = LoadManifests();
+	auto write = StreamCopier::WriteToFile(outputFile);
+	ULONGLONG bytesMerged = 0;
+
+	for (const auto &strFullFilename : m_FullFilenameList)
+	{
+		wil::unique_hfile inputFile(CreateFile(strFullFilename.c_str(), GENERIC_READ,
+			FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+
+		if (!inputFile)
+		{
+			return Result::Failed;
+		}
+
+		uint64_t partBytesMerged = 0;
+		XxHash64 partHash;
+
+		auto copyResult = m_streamCopier.Copy(StreamCopier::ReadFromFile(inputFile.get()),
+			[&write, &partHash](const void *buffer, size_t size) {
+				partHash.Update(buffer, size);
+				return write(buffer, size);
+			},
+			[this, bytesMerged, totalSize, &partBytesMerged](uint64_t bytesCopied) {
+				partBytesMerged = bytesCopied;
+				UpdateProgress(bytesMerged + bytesCopied, totalSize);
+			});
+
+		switch (copyResult)
+		{
+		case StreamCopier::Result::Succeeded:
 			break;
+
+		case StreamCopier::Result::Stopped:
+			return Result::Stopped;
+
+		default:
+			return Result::Failed;
+		}
+
+		if (!IsPartHashValid(manifests, strFullFilename, partHash.GetHash()))
+		{
+			return Result::ChecksumMismatch;
 		}
 
-		HANDLE hInputFile = CreateFile(strFullFilename.c_str(), GENERIC_READ, FILE_SHARE_READ,
-			nullptr, OPEN_EXISTING, 0, nullptr);
+		bytesMerged += partBytesMerged;
+	}
+
+	return Result::Succeeded;
+}
+
+// Parts are checked against any manifests that were written when they were created (see
+// SplitFile). A manifest is stored alongside the parts it lists and names them relative to its
+// own directory, so the returned entries contain full paths instead.
+std::vector<MergeFiles::Manifest> MergeFiles::LoadManifests() const
+{
+	std::wstring outputManifestName = PathFindFileName(m_strOutputFilename.c_str());
+	outputManifestName += ChecksumManifest::FILE_EXTENSION;
+
+	std::vector<std::wstring> directories;
 
-		if (hInputFile != INVALID_HANDLE_VALUE)
+	for (const auto &strFullFilename : m_FullFilenameList)
+	{
+		std::wstring directory = strFullFilename.substr(0, strFullFilename.find_last_of('\\'));
+
+		bool found = std::any_of(directories.begin(), directories.end(),
+			[&directory](const std::wstring &existingDirectory) {
+				return lstrcmpi(existingDirectory.c_str(), directory.c_str()) == 0;
+			});
+
+		if (!found)
 		{
-			GetFileSizeEx(hInputFile, &lMergeFileSize);
+			directories.push_back(directory);
+		}
+	}
+
+	std::vector<Manifest> manifests;
+
+	for (const auto &directory : directories)
+	{
+		WIN32_FIND_DATA findData;
+		wil::unique_hfind findFile(FindFirstFile(
+			(directory + L"\\*" + ChecksumManifest::FILE_EXTENSION).c_str(), &findData));
+
+		if (!findFile)
+		{
+			continue;
+		}
+
+		do
+		{
+			auto entries = ChecksumManifest::Load(directory + L"\\" + findData.cFileName);
+
+			if (!entries)
+			{
+				continue;
+			}
+
+			Manifest manifest;
+			manifest.namedAfterOutput =
+				(lstrcmpi(findData.cFileName, outputManifestName.c_str()) == 0);
 
-			if (lMergeFileSize.QuadPart != 0)
+			for (const auto &entry : *entries)
 			{
-				auto buffer = std::make_unique<char[]>(lMergeFileSize.LowPart);
+				manifest.entries.push_back({ directory + L"\\" + entry.filename, entry.hash });
+			}
+
+			manifests.push_back(std::move(manifest));
+		} while (FindNextFile(findFile.get(), &findData));
+	}
 
-				DWORD dwNumberOfBytesRead;
-				ReadFile(hInputFile, reinterpret_cast<LPVOID>(buffer.get()),
-					static_cast<DWORD>(lMergeFileSize.LowPart), &dwNumberOfBytesRead, nullptr);
+	return manifests;
+}
 
-				DWORD dwNumberOfBytesWritten;
-				WriteFile(hOutputFile, reinterpret_cast<LPCVOID>(buffer.get()), dwNumberOfBytesRead,
-					&dwNumberOfBytesWritten, nullptr);
+// A directory can contain manifests left over from earlier splits, some of which may list parts
+// with the same names as the parts being merged. If the manifest named after the output file
+// lists the part, that's the only manifest that's checked. Otherwise, the part is only considered
+// invalid if none of the manifests that list it agree with its hash.
+bool MergeFiles::IsPartHashValid(
+	const std::vector<Manifest> &manifests, const std::wstring &partPath, uint64_t hash)
+{
+	bool listed = false;
+
+	for (bool namedAfterOutput : { true, false })
+	{
+		for (const auto &manifest : manifests)
+		{
+			if (manifest.namedAfterOutput != namedAfterOutput)
+			{
+				continue;
 			}
 
-			CloseHandle(hInputFile);
+			auto itr = std::find_if(manifest.entries.begin(), manifest.entries.end(),
+				[&partPath](const ChecksumManifest::Entry &entry) {
+					return lstrcmpi(entry.filename.c_str(), partPath.c_str()) == 0;
+				});
 
-			PostMessage(m_hDlg, NMergeFilesDialog::WM_APP_SETCURRENTMERGECOUNT, nFilesMerged, 0);
+			if (itr == manifest.entries.end())
+			{
+				continue;
+			}
 
-			nFilesMerged++;
+			if (namedAfterOutput)
+			{
+				return itr->hash == hash;
+			}
 
-			EnterCriticalSection(&m_csStop);
-			if (m_bstopMerging)
+			if (itr->hash == hash)
 			{
-				bStop = true;
+				return true;
 			}
-			LeaveCriticalSection(&m_csStop);
+
+			listed = true;
 		}
 	}
 
-	CloseHandle(hOutputFile);
+	return !listed;
+}
+
+void MergeFiles::UpdateProgress(ULONGLONG bytesMerged, ULONGLONG totalSize)
+{
+	int position = NMergeFilesDialog::PROGRESS_RANGE;
+
+	// A part may have grown since its size was retrieved.
+	if (totalSize != 0 && bytesMerged < totalSize)
+	{
+		position = static_cast<int>(bytesMerged * NMergeFilesDialog::PROGRESS_RANGE / totalSize);
+	}
+
+	// There's no need to flood the dialog with messages that won't change what it shows.
+	if (position == m_progressPosition)
+	{
+		return;
+	}
+
+	m_progressPosition = position;
 
-	SendMessage(m_hDlg, NMergeFilesDialog::WM_APP_MERGINGFINISHED, 0, 0);
+	PostMessage(m_hDlg, NMergeFilesDialog::WM_APP_SETMERGEPROGRESS, position, 0);
 }
 
 void MergeFiles::StopMerging()
 {
-	EnterCriticalSection(&m_csStop);
-	m_bstopMerging = true;
-	LeaveCriticalSection(&m_csStop);
+	m_streamCopier.Stop();
 }
 
 MergeFilesDialogPersistentSettings::MergeFilesDialogPersistentSettings() :
@@ -603,4 +783,4 @@ MergeFilesDialogPersistentSettings &MergeFilesDialogPersistentSettings::GetInsta
 {
 	static MergeFilesDialogPersistentSettings mfdps;
 	return mfdps;
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -5,9 +5,11 @@
 #pragma once
 
 #include "DarkModeDialogBase.h"
+#include "../Helper/ChecksumManifest.h"
 #include "../Helper/DialogSettings.h"
 #include "../Helper/ReferenceCount.h"
 #include "../Helper/ResizableDialog.h"
+#include "../Helper/StreamCopier.h"
 
 __interface IExplorerplusplus;
 class MergeFilesDialog;
@@ -31,21 +33,47 @@ private:
 class MergeFiles : public ReferenceCount
 {
 public:
+	enum class Result
+	{
+		Succeeded,
+		Failed,
+		ChecksumMismatch,
+		Stopped
+	};
+
 	MergeFiles(HWND hDlg, const std::wstring &strOutputFilename,
 		const std::list<std::wstring> &FullFilenameList);
-	~MergeFiles();
 
 	void StartMerging();
 	void StopMerging();
 
 private:
+	struct Manifest
+	{
+		// Set if the manifest is named after the output file, in which case it was most likely
+		// written when the parts being merged were created.
+		bool namedAfterOutput;
+
+		// Each entry contains the full path to the file, rather than a relative path.
+		std::vector<ChecksumManifest::Entry> entries;
+	};
+
+	Result MergeInto(HANDLE outputFile);
+	std::vector<Manifest> LoadManifests() const;
+	static bool IsPartHashValid(
+		const std::vector<Manifest> &manifests, const std::wstring &partPath, uint64_t hash);
+	void UpdateProgress(ULONGLONG bytesMerged, ULONGLONG totalSize);
+
 	HWND m_hDlg;
 
 	std::wstring m_strOutputFilename;
 	std::list<std::wstring> m_FullFilenameList;
 
-	CRITICAL_SECTION m_csStop;
-	bool m_bstopMerging;
+	// Each part is streamed through a fixed set of buffers, so the amount of memory used doesn't
+	// depend on the size of the parts.
+	StreamCopier m_streamCopier;
+
+	int m_progressPosition;
 };
 
 class MergeFilesDialog : public DarkModeDialogBase
@@ -74,7 +102,7 @@ private:
 	void OnCancel();
 	void OnChangeOutputDirectory();
 	void OnMove(bool bUp);
-	void OnFinished();
+	void OnFinished(MergeFiles::Result result);
 
 	IExplorerplusplus *m_expp;
 
@@ -88,4 +116,4 @@ private:
 	TCHAR m_szOk[32];
 
 	MergeFilesDialogPersistentSettings *m_persistentSettings;
-};
\ No newline at end of file
+};
\ No newline at end of file
@@ -9,6 +9,7 @@
 #include "Explorer++_internal.h"
 #include "HardwareChangeNotifier.h"
 #include "MainResource.h"
+#include "ResourceHelper.h"
 #include "SelectColumnsDialog.h"
 #include "ShellBrowser/ShellBrowser.h"
 #include "ShellTreeView/ShellTreeView.h"
@@ -18,7 +19,9 @@
 #include "../Helper/Logging.h"
 #include "../Helper/Macros.h"
 #include "../Helper/WindowHelper.h"
+#include <boost/format.hpp>
 #include <boost/range/adaptor/map.hpp>
+#include <comdef.h>
 
 void Explorerplusplus::ValidateLoadedSettings()
 {
@@ -274,7 +277,18 @@ void Explorerplusplus::CopyToFolder(bool move)
 
 	TCHAR szTemp[128];
 	LoadString(m_hLanguageModule, IDS_GENERAL_COPY_TO_FOLDER_TITLE, szTemp, SIZEOF_ARRAY(szTemp));
-	NFileOperations::CopyFilesToFolder(m_hContainer, szTemp, pidls, move);
+	NFileOperations::CopyFilesToFolder(m_hContainer, szTemp, pidls, move, &m_fileOperationQueue,
+		m_config->useNativeCopyEngine);
+}
+
+void Explorerplusplus::OnFileOperationFailed(HRESULT result)
+{
+	std::wstring messageTemplate =
+		ResourceHelper::LoadString(m_hLanguageModule, IDS_FILE_OPERATION_FAILED);
+	_com_error error(result);
+	std::wstring message = (boost::wformat(messageTemplate) % error.ErrorMessage()).str();
+
+	MessageBox(m_hContainer, message.c_str(), NExplorerplusplus::APP_NAME, MB_ICONERROR | MB_OK);
 }
 
 LRESULT Explorerplusplus::OnDeviceChange(WPARAM wParam, LPARAM lParam)
@@ -293,12 +307,21 @@ LRESULT Explorerplusplus::OnDeviceChange(WPARAM wParam, LPARAM lParam)
 
 	switch (wParam)
 	{
+	case DBT_DEVICEQUERYREMOVE:
+		// Cached folder sizes hold handles open on the volume, which would otherwise prevent it
+		// from being removed.
+		m_folderSizeService.OnDeviceRemoval(reinterpret_cast<DEV_BROADCAST_HDR *>(lParam));
+		break;
+
 	case DBT_DEVICEARRIVAL:
 		HardwareChangeNotifier::GetInstance().NotifyDeviceArrival(
 			reinterpret_cast<DEV_BROADCAST_HDR *>(lParam));
 		break;
 
 	case DBT_DEVICEREMOVECOMPLETE:
+		// The volume may have been removed without a query (e.g. if it was unplugged).
+		m_folderSizeService.OnDeviceRemoval(reinterpret_cast<DEV_BROADCAST_HDR *>(lParam));
+
 		HardwareChangeNotifier::GetInstance().NotifyDeviceRemovalComplete(
 			reinterpret_cast<DEV_BROADCAST_HDR *>(lParam));
 		break;
@@ -345,35 +368,6 @@ void Explorerplusplus::DirectoryAlteredCallback(
 	}
 }
 
-void Explorerplusplus::FolderSizeCallbackStub(
-	int nFolders, int nFiles, PULARGE_INTEGER lTotalFolderSize, LPVOID pData)
-{
-	auto *pfsei = reinterpret_cast<Explorerplusplus::FolderSizeExtraInfo *>(pData);
-	reinterpret_cast<Explorerplusplus *>(pfsei->pContainer)
-		->FolderSizeCallback(pfsei, nFolders, nFiles, lTotalFolderSize);
-	free(pfsei);
-}
-
-void Explorerplusplus::FolderSizeCallback(
-	FolderSizeExtraInfo *pfsei, int nFolders, int nFiles, PULARGE_INTEGER lTotalFolderSize)
-{
-	UNREFERENCED_PARAMETER(nFolders);
-	UNREFERENCED_PARAMETER(nFiles);
-
-	DWFolderSizeCompletion *pDWFolderSizeCompletion = nullptr;
-
-	pDWFolderSizeCompletion = (DWFolderSizeCompletion *) malloc(sizeof(DWFolderSizeCompletion));
-
-	pDWFolderSizeCompletion->liFolderSize = *lTotalFolderSize;
-	pDWFolderSizeCompletion->uId = pfsei->uId;
-
-	/* Queue the result back to the main thread, so that
-	the folder size can be displayed. It is up to the main
-	thread to determine whether the folder size should actually
-	be shown. */
-	PostMessage(m_hContainer, WM_APP_FOLDERSIZECOMPLETED, (WPARAM) pDWFolderSizeCompletion, 0);
-}
-
 void Explorerplusplus::OnSelectColumns()
 {
 	SelectColumnsDialog selectColumnsDialog(m_hLanguageModule, m_hContainer,
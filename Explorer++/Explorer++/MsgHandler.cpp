@@ -16,6 +16,7 @@
 #include "Navigation.h"
 #include "Plugins/PluginManager.h"
 #include "ResourceHelper.h"
+#include "ShellBrowser/SearchResultsFolder.h"
 #include "ShellBrowser/ShellBrowser.h"
 #include "ShellBrowser/ShellNavigationController.h"
 #include "ShellBrowser/ViewModes.h"
@@ -116,6 +117,8 @@ void Explorerplusplus::LoadAllSettings(ILoadSave **pLoadSave)
 	(*pLoadSave)->LoadDialogStates();
 
 	ValidateLoadedSettings();
+
+	OnColorRulesUpdated();
 }
 
 void Explorerplusplus::OpenItem(const TCHAR *itemPath, OpenFolderDisposition openFolderDisposition)
@@ -564,6 +567,12 @@ boost::signals2::connection Explorerplusplus::AddApplicationShuttingDownObserver
 	return m_applicationShuttingDownSignal.connect(observer);
 }
 
+boost::signals2::connection Explorerplusplus::AddColorRulesUpdatedObserver(
+	const ColorRulesUpdatedSignal::slot_type &observer)
+{
+	return m_colorRulesUpdatedSignal.connect(observer);
+}
+
 int Explorerplusplus::OnDestroy()
 {
 	m_applicationShuttingDownSignal();
@@ -595,6 +604,21 @@ int Explorerplusplus::OnClose()
 			return 1;
 	}
 
+	// Closing the queue cancels any operations that haven't started and stops the ones that are
+	// running, so it's worth checking first.
+	if (!m_fileOperationQueue.GetOperations().empty())
+	{
+		std::wstring message =
+			ResourceHelper::LoadString(m_hLanguageModule, IDS_GENERAL_CLOSE_FILE_OPERATIONS);
+		int response = MessageBox(m_hContainer, message.c_str(), NExplorerplusplus::APP_NAME,
+			MB_ICONWARNING | MB_YESNO);
+
+		if (response == IDNO)
+		{
+			return 1;
+		}
+	}
+
 	// It's important that the plugins are destroyed before the main
 	// window is destroyed and before this class is destroyed.
 	// The first because the API binding classes may interact with the
@@ -648,6 +672,11 @@ void Explorerplusplus::HandleDirectoryMonitoring(int iTabId)
 		pDirectoryAltered->iFolderIndex = tab.GetShellBrowser()->GetUniqueFolderId();
 		pDirectoryAltered->pData = this;
 
+		/* The results of a recursive search can come from
+		anywhere below the directory. */
+		auto searchResults = tab.GetShellBrowser()->GetSearchResults();
+		BOOL watchSubtree = searchResults && searchResults->recursive;
+
 		/* Start monitoring the directory that was opened. */
 		LOG(debug) << _T("Starting directory monitoring for \"") << directoryToWatch << _T("\"");
 		iDirMonitorId = m_pDirMon->WatchDirectory(directoryToWatch.c_str(),
@@ -655,7 +684,7 @@ void Explorerplusplus::HandleDirectoryMonitoring(int iTabId)
 				| FILE_NOTIFY_CHANGE_ATTRIBUTES | FILE_NOTIFY_CHANGE_LAST_WRITE
 				| FILE_NOTIFY_CHANGE_LAST_ACCESS | FILE_NOTIFY_CHANGE_CREATION
 				| FILE_NOTIFY_CHANGE_SECURITY,
-			DirectoryAlteredCallback, FALSE, (void *) pDirectoryAltered);
+			DirectoryAlteredCallback, watchSubtree, (void *) pDirectoryAltered);
 	}
 
 	tab.GetShellBrowser()->SetDirMonitorId(iDirMonitorId);
@@ -896,7 +925,7 @@ void Explorerplusplus::OnAppCommand(UINT cmd)
 		break;
 
 	case APPCOMMAND_UNDO:
-		m_FileActionHandler.Undo();
+		m_FileActionHandler.Undo(m_hContainer);
 		break;
 
 	case APPCOMMAND_REDO:
@@ -1239,56 +1268,16 @@ LRESULT Explorerplusplus::OnCustomDraw(LPARAM lParam)
 
 		case CDDS_ITEMPREPAINT:
 		{
-			DWORD dwAttributes =
-				m_pActiveShellBrowser->GetItemFileFindData(static_cast<int>(pnmcd->dwItemSpec))
-					.dwFileAttributes;
+			/* The color rules are evaluated ahead of time, when
+			items are added or changed, so all that's needed
+			here is to look up the result. */
+			auto color = m_pActiveShellBrowser->GetItemColorRuleColor(
+				static_cast<int>(pnmcd->dwItemSpec));
 
-			std::wstring fullFileName =
-				m_pActiveShellBrowser->GetItemFullName(static_cast<int>(pnmcd->dwItemSpec));
-
-			TCHAR fileName[MAX_PATH];
-			StringCchCopy(fileName, SIZEOF_ARRAY(fileName), fullFileName.c_str());
-			PathStripPath(fileName);
-
-			/* Loop through each filter. Decide whether to change the font of the
-			current item based on its filename and/or attributes. */
-			for (const auto &colorRule : m_ColorRules)
+			if (color)
 			{
-				BOOL bMatchFileName = FALSE;
-				BOOL bMatchAttributes = FALSE;
-
-				/* Only match against the filename if it's not empty. */
-				if (!colorRule.strFilterPattern.empty())
-				{
-					if (CheckWildcardMatch(colorRule.strFilterPattern.c_str(), fileName,
-							!colorRule.caseInsensitive)
-						== 1)
-					{
-						bMatchFileName = TRUE;
-					}
-				}
-				else
-				{
-					bMatchFileName = TRUE;
-				}
-
-				if (colorRule.dwFilterAttributes != 0)
-				{
-					if (colorRule.dwFilterAttributes & dwAttributes)
-					{
-						bMatchAttributes = TRUE;
-					}
-				}
-				else
-				{
-					bMatchAttributes = TRUE;
-				}
-
-				if (bMatchFileName && bMatchAttributes)
-				{
-					pnmlvcd->clrText = colorRule.rgbColour;
-					return CDRF_NEWFONT;
-				}
+				pnmlvcd->clrText = *color;
+				return CDRF_NEWFONT;
 			}
 		}
 		break;
@@ -1422,6 +1411,21 @@ CachedIcons *Explorerplusplus::GetCachedIcons()
 	return &m_cachedIcons;
 }
 
+FolderSizeService *Explorerplusplus::GetFolderSizeService()
+{
+	return &m_folderSizeService;
+}
+
+FileOperationQueue *Explorerplusplus::GetFileOperationQueue()
+{
+	return &m_fileOperationQueue;
+}
+
+const NColorRuleHelper::ColorRuleMatcher *Explorerplusplus::GetColorRuleMatcher() const
+{
+	return m_colorRuleMatcher.get();
+}
+
 BOOL Explorerplusplus::GetSavePreferencesToXmlFile() const
 {
 	return m_bSavePreferencesToXMLFile;
@@ -1797,6 +1797,14 @@ std::vector<OptionsDialog::AdvancedOption> OptionsDialog::InitializeAdvancedOpti
 		m_instance, IDS_ADVANCED_OPTION_OPEN_TABS_IN_FOREGROUND_DESCRIPTION);
 	advancedOptions.push_back(option);
 
+	option.id = AdvancedOptionId::UseNativeCopyEngine;
+	option.name =
+		ResourceHelper::LoadString(m_instance, IDS_ADVANCED_OPTION_USE_NATIVE_COPY_ENGINE_NAME);
+	option.type = AdvancedOptionType::Boolean;
+	option.description = ResourceHelper::LoadString(
+		m_instance, IDS_ADVANCED_OPTION_USE_NATIVE_COPY_ENGINE_DESCRIPTION);
+	advancedOptions.push_back(option);
+
 	return advancedOptions;
 }
 
@@ -1845,6 +1853,9 @@ bool OptionsDialog::GetBooleanConfigValue(OptionsDialog::AdvancedOptionId id)
 	case AdvancedOptionId::OpenTabsInForeground:
 		return m_config->openTabsInForeground;
 
+	case AdvancedOptionId::UseNativeCopyEngine:
+		return m_config->useNativeCopyEngine;
+
 	default:
 		assert(false);
 		break;
@@ -1869,6 +1880,10 @@ void OptionsDialog::SetBooleanConfigValue(OptionsDialog::AdvancedOptionId id, bo
 		m_config->openTabsInForeground = value;
 		break;
 
+	case AdvancedOptionId::UseNativeCopyEngine:
+		m_config->useNativeCopyEngine = value;
+		break;
+
 	default:
 		assert(false);
 		break;
@@ -31,7 +31,8 @@ private:
 	{
 		CheckSystemIsPinnedToNameSpaceTree,
 		EnableDarkMode,
-		OpenTabsInForeground
+		OpenTabsInForeground,
+		UseNativeCopyEngine
 	};
 
 	enum class AdvancedOptionType
@@ -184,6 +184,8 @@ LONG Explorerplusplus::SaveGenericSettingsToRegistry()
 		RegistrySettings::SaveDword(hSettingsKey, _T("Language"), m_config->language);
 		RegistrySettings::SaveDword(
 			hSettingsKey, _T("OpenTabsInForeground"), m_config->openTabsInForeground);
+		RegistrySettings::SaveDword(
+			hSettingsKey, _T("UseNativeCopyEngine"), m_config->useNativeCopyEngine);
 
 		RegistrySettings::SaveDword(hSettingsKey, _T("DisplayMixedFilesAndFolders"),
 			m_config->globalFolderSettings.displayMixedFilesAndFolders);
@@ -418,6 +420,8 @@ LONG Explorerplusplus::LoadGenericSettingsFromRegistry()
 
 		RegistrySettings::Read32BitValueFromRegistry(
 			hSettingsKey, _T("OpenTabsInForeground"), m_config->openTabsInForeground);
+		RegistrySettings::Read32BitValueFromRegistry(
+			hSettingsKey, _T("UseNativeCopyEngine"), m_config->useNativeCopyEngine);
 
 		RegistrySettings::Read32BitValueFromRegistry(hSettingsKey,
 			_T("DisplayMixedFilesAndFolders"),
@@ -7,9 +7,11 @@
 #include "CoreInterface.h"
 #include "DarkModeHelper.h"
 #include "DialogConstants.h"
+#include "FilenameIndexManager.h"
 #include "IconResourceLoader.h"
 #include "MainResource.h"
 #include "ResourceHelper.h"
+#include "ShellBrowser/SearchResultsFolder.h"
 #include "ShellBrowser/ShellBrowser.h"
 #include "TabContainer.h"
 #include "../Helper/BaseDialog.h"
@@ -19,21 +21,21 @@
 #include "../Helper/FileContextMenuManager.h"
 #include "../Helper/Helper.h"
 #include "../Helper/Macros.h"
+#include "../Helper/RegexMatcher.h"
 #include "../Helper/RegistrySettings.h"
 #include "../Helper/ShellHelper.h"
+#include "../Helper/StringHelper.h"
+#include "../Helper/WildcardMatcher.h"
 #include "../Helper/WindowHelper.h"
 #include "../Helper/XMLSettings.h"
-#include <regex>
+#include <numeric>
 
 namespace NSearchDialog
 {
-	const int WM_APP_SEARCHITEMFOUND = WM_APP + 1;
+	const int WM_APP_SEARCHITEMSFOUND = WM_APP + 1;
 	const int WM_APP_SEARCHFINISHED = WM_APP + 2;
-	const int WM_APP_SEARCHCHANGEDDIRECTORY = WM_APP + 3;
 	const int WM_APP_REGULAREXPRESSIONINVALID = WM_APP + 4;
 
-	int CALLBACK SortResultsStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort);
-
 	DWORD WINAPI SearchThread(LPVOID pParam);
 	int CALLBACK BrowseCallbackProc(HWND hwnd, UINT uMsg, LPARAM lParam, LPARAM lpData);
 }
@@ -42,6 +44,7 @@ const TCHAR SearchDialogPersistentSettings::SETTINGS_KEY[] = _T("Search");
 
 const TCHAR SearchDialogPersistentSettings::SETTING_COLUMN_WIDTH_1[] = _T("ColumnWidth1");
 const TCHAR SearchDialogPersistentSettings::SETTING_COLUMN_WIDTH_2[] = _T("ColumnWidth2");
+const TCHAR SearchDialogPersistentSettings::SETTING_COLUMN_WIDTH_3[] = _T("ColumnWidth3");
 const TCHAR SearchDialogPersistentSettings::SETTING_SEARCH_DIRECTORY_TEXT[] =
 	_T("SearchDirectoryText");
 const TCHAR SearchDialogPersistentSettings::SETTING_SEARCH_SUB_FOLDERS[] = _T("SearchSubFolders");
@@ -52,6 +55,12 @@ const TCHAR SearchDialogPersistentSettings::SETTING_ARCHIVE[] = _T("Archive");
 const TCHAR SearchDialogPersistentSettings::SETTING_HIDDEN[] = _T("Hidden");
 const TCHAR SearchDialogPersistentSettings::SETTING_READ_ONLY[] = _T("ReadOnly");
 const TCHAR SearchDialogPersistentSettings::SETTING_SYSTEM[] = _T("System");
+const TCHAR SearchDialogPersistentSettings::SETTING_USE_INDEX[] = _T("UseIndex");
+const TCHAR SearchDialogPersistentSettings::SETTING_CONTENT_TEXT[] = _T("ContentText");
+const TCHAR SearchDialogPersistentSettings::SETTING_CONTENT_MAX_FILE_SIZE[] =
+	_T("ContentMaxFileSize");
+const TCHAR SearchDialogPersistentSettings::SETTING_CONTENT_READ_LIMIT[] = _T("ContentReadLimit");
+const TCHAR SearchDialogPersistentSettings::SETTING_FILTER_TEXT[] = _T("FilterText");
 const TCHAR SearchDialogPersistentSettings::SETTING_SORT_MODE[] = _T("SortMode");
 const TCHAR SearchDialogPersistentSettings::SETTING_SORT_ASCENDING[] = _T("SortAscending");
 const TCHAR SearchDialogPersistentSettings::SETTING_DIRECTORY_LIST[] = _T("Directory");
@@ -65,10 +74,9 @@ SearchDialog::SearchDialog(HINSTANCE hInstance, HWND hParent, std::wstring_view
 	m_tabContainer(tabContainer),
 	m_bSearching(FALSE),
 	m_bStopSearching(FALSE),
-	m_bSetSearchTimer(TRUE),
-	m_iInternalIndex(0),
 	m_iPreviousSelectedColumn(-1),
-	m_pSearch(nullptr)
+	m_pSearch(nullptr),
+	m_completedSearch(nullptr)
 {
 	m_persistentSettings = &SearchDialogPersistentSettings::GetInstance();
 }
@@ -80,6 +88,11 @@ SearchDialog::~SearchDialog()
 		m_pSearch->StopSearching();
 		m_pSearch->Release();
 	}
+
+	if (m_completedSearch != nullptr)
+	{
+		m_completedSearch->Release();
+	}
 }
 
 INT_PTR SearchDialog::OnInitDialog()
@@ -120,7 +133,8 @@ INT_PTR SearchDialog::OnInitDialog()
 	GetClientRect(hListView, &rc);
 
 	ListView_SetColumnWidth(hListView, 0, (1.0 / 3.0) * GetRectWidth(&rc));
-	ListView_SetColumnWidth(hListView, 1, (1.80 / 3.0) * GetRectWidth(&rc));
+	ListView_SetColumnWidth(hListView, 1, (1.30 / 3.0) * GetRectWidth(&rc));
+	ListView_SetColumnWidth(hListView, 2, (0.50 / 3.0) * GetRectWidth(&rc));
 
 	UpdateListViewHeader();
 
@@ -132,6 +146,7 @@ INT_PTR SearchDialog::OnInitDialog()
 	lCheckDlgButton(m_hDlg, IDC_CHECK_CASEINSENSITIVE, m_persistentSettings->m_bCaseInsensitive);
 	lCheckDlgButton(
 		m_hDlg, IDC_CHECK_USEREGULAREXPRESSIONS, m_persistentSettings->m_bUseRegularExpressions);
+	lCheckDlgButton(m_hDlg, IDC_CHECK_USEINDEX, m_persistentSettings->m_bUseIndex);
 
 	for (const auto &strDirectory : m_persistentSettings->m_searchDirectories)
 	{
@@ -147,6 +162,8 @@ INT_PTR SearchDialog::OnInitDialog()
 
 	SetDlgItemText(m_hDlg, IDC_COMBO_NAME, m_persistentSettings->m_szSearchPattern);
 	SetDlgItemText(m_hDlg, IDC_COMBO_DIRECTORY, m_searchDirectory.c_str());
+	SetDlgItemText(m_hDlg, IDC_EDIT_CONTENTTEXT, m_persistentSettings->m_szContentText);
+	SetDlgItemText(m_hDlg, IDC_EDIT_FILTER, m_persistentSettings->m_szFilterText);
 
 	ComboBox::CreateNew(GetDlgItem(m_hDlg, IDC_COMBO_NAME));
 	ComboBox::CreateNew(GetDlgItem(m_hDlg, IDC_COMBO_DIRECTORY));
@@ -161,15 +178,24 @@ INT_PTR SearchDialog::OnInitDialog()
 			ListView_SetColumnWidth(hListView, 0, m_persistentSettings->m_iColumnWidth1);
 			ListView_SetColumnWidth(hListView, 1, m_persistentSettings->m_iColumnWidth2);
 		}
+
+		if (m_persistentSettings->m_iColumnWidth3 != -1)
+		{
+			ListView_SetColumnWidth(hListView, 2, m_persistentSettings->m_iColumnWidth3);
+		}
 	}
 
+	// There are no results to open until a search has been run.
+	EnableWindow(GetDlgItem(m_hDlg, IDC_BUTTON_OPENINTAB), FALSE);
+
 	SetFocus(GetDlgItem(m_hDlg, IDC_COMBO_NAME));
 
-	AllowDarkModeForControls({ IDC_BUTTON_DIRECTORY, IDSEARCH, IDEXIT });
+	AllowDarkModeForControls({ IDC_BUTTON_DIRECTORY, IDC_BUTTON_REBUILDINDEX, IDC_BUTTON_OPENINTAB,
+		IDSEARCH, IDEXIT });
 	AllowDarkModeForListView(IDC_LISTVIEW_SEARCHRESULTS);
 	AllowDarkModeForCheckboxes({ IDC_CHECK_ARCHIVE, IDC_CHECK_HIDDEN, IDC_CHECK_READONLY,
 		IDC_CHECK_SYSTEM, IDC_CHECK_CASEINSENSITIVE, IDC_CHECK_USEREGULAREXPRESSIONS,
-		IDC_CHECK_SEARCHSUBFOLDERS });
+		IDC_CHECK_SEARCHSUBFOLDERS, IDC_CHECK_USEINDEX });
 	AllowDarkModeForGroupBoxes({ IDC_GROUP_ATTRIBUTES, IDC_GROUP_SEARCH_TYPE });
 	AllowDarkModeForComboBoxes({ IDC_COMBO_NAME, IDC_COMBO_DIRECTORY });
 
@@ -206,6 +232,16 @@ void SearchDialog::GetResizableControlInformation(
 	control.Constraint = ResizableDialog::ControlConstraint::X;
 	ControlList.push_back(control);
 
+	control.iID = IDC_EDIT_CONTENTTEXT;
+	control.Type = ResizableDialog::ControlType::Resize;
+	control.Constraint = ResizableDialog::ControlConstraint::X;
+	ControlList.push_back(control);
+
+	control.iID = IDC_EDIT_FILTER;
+	control.Type = ResizableDialog::ControlType::Resize;
+	control.Constraint = ResizableDialog::ControlConstraint::X;
+	ControlList.push_back(control);
+
 	control.iID = IDC_LISTVIEW_SEARCHRESULTS;
 	control.Type = ResizableDialog::ControlType::Resize;
 	control.Constraint = ResizableDialog::ControlConstraint::None;
@@ -246,6 +282,16 @@ void SearchDialog::GetResizableControlInformation(
 	control.Constraint = ResizableDialog::ControlConstraint::X;
 	ControlList.push_back(control);
 
+	control.iID = IDC_BUTTON_REBUILDINDEX;
+	control.Type = ResizableDialog::ControlType::Move;
+	control.Constraint = ResizableDialog::ControlConstraint::Y;
+	ControlList.push_back(control);
+
+	control.iID = IDC_BUTTON_OPENINTAB;
+	control.Type = ResizableDialog::ControlType::Move;
+	control.Constraint = ResizableDialog::ControlConstraint::None;
+	ControlList.push_back(control);
+
 	control.iID = IDSEARCH;
 	control.Type = ResizableDialog::ControlType::Move;
 	control.Constraint = ResizableDialog::ControlConstraint::None;
@@ -267,6 +313,14 @@ INT_PTR SearchDialog::OnCommand(WPARAM wParam, LPARAM lParam)
 		OnSearch();
 		break;
 
+	case IDC_BUTTON_OPENINTAB:
+		OnOpenInTab();
+		break;
+
+	case IDC_BUTTON_REBUILDINDEX:
+		OnRebuildIndex();
+		break;
+
 	case IDC_BUTTON_DIRECTORY:
 	{
 		BROWSEINFO bi;
@@ -338,18 +392,77 @@ void SearchDialog::OnSearch()
 	}
 }
 
+// The index is rebuilt the next time the directory is searched with the index enabled, so that
+// the rebuild shows progress (and can be cancelled) in the same way as any other search.
+void SearchDialog::OnRebuildIndex()
+{
+	TCHAR szBaseDirectory[MAX_PATH];
+	GetDlgItemText(m_hDlg, IDC_COMBO_DIRECTORY, szBaseDirectory, SIZEOF_ARRAY(szBaseDirectory));
+	PathRemoveBlanks(szBaseDirectory);
+
+	FilenameIndexManager::GetInstance().RequestRebuild(szBaseDirectory);
+
+	ShowWindow(GetDlgItem(m_hDlg, IDC_LINK_STATUS), SW_HIDE);
+	ShowWindow(GetDlgItem(m_hDlg, IDC_STATIC_STATUS), SW_SHOW);
+
+	TCHAR szStatus[256];
+	LoadString(
+		GetInstance(), IDS_SEARCH_INDEX_REBUILD_REQUESTED, szStatus, SIZEOF_ARRAY(szStatus));
+	SetDlgItemText(m_hDlg, IDC_STATIC_STATUS, szStatus);
+}
+
 void SearchDialog::StartSearching()
 {
+	// The filter is parsed here, rather than on the search thread, so that an invalid filter can
+	// be reported without a search ever being started.
+	TCHAR szFilterText[MAX_PATH];
+	GetDlgItemText(m_hDlg, IDC_EDIT_FILTER, szFilterText, SIZEOF_ARRAY(szFilterText));
+
+	FILETIME currentTime;
+	GetSystemTimeAsFileTime(&currentTime);
+
+	std::wstring invalidTerm;
+	auto filter = ParseSearchFilter(
+		szFilterText, SearchEntry::FileTimeToTicks(currentTime), invalidTerm);
+
+	if (!filter)
+	{
+		ShowWindow(GetDlgItem(m_hDlg, IDC_LINK_STATUS), SW_SHOW);
+		ShowWindow(GetDlgItem(m_hDlg, IDC_STATIC_STATUS), SW_HIDE);
+
+		TCHAR szTemp[128];
+		LoadString(GetInstance(), IDS_SEARCH_FILTER_INVALID, szTemp, SIZEOF_ARRAY(szTemp));
+
+		TCHAR szError[512];
+		StringCchPrintf(szError, SIZEOF_ARRAY(szError), szTemp, invalidTerm.c_str());
+		SetDlgItemText(m_hDlg, IDC_LINK_STATUS, szError);
+
+		return;
+	}
+
 	ShowWindow(GetDlgItem(m_hDlg, IDC_LINK_STATUS), SW_HIDE);
 	ShowWindow(GetDlgItem(m_hDlg, IDC_STATIC_STATUS), SW_SHOW);
 
-	m_AwaitingSearchItems.clear();
-	m_SearchItemsMapInternal.clear();
+	if (m_completedSearch != nullptr)
+	{
+		m_completedSearch->Release();
+		m_completedSearch = nullptr;
+	}
+
+	EnableWindow(GetDlgItem(m_hDlg, IDC_BUTTON_OPENINTAB), FALSE);
+
+	m_pendingResultBlocks.clear();
+	m_results.clear();
+	m_resultOrder.clear();
+	m_resultDirectories.clear();
+	m_resultDirectorySortKeys.clear();
+	m_resultDirectoryRanks.clear();
 
-	ListView_DeleteAllItems(GetDlgItem(m_hDlg, IDC_LISTVIEW_SEARCHRESULTS));
+	ListView_SetItemCount(GetDlgItem(m_hDlg, IDC_LISTVIEW_SEARCHRESULTS), 0);
 
 	TCHAR szBaseDirectory[MAX_PATH];
 	TCHAR szSearchPattern[MAX_PATH];
+	TCHAR szContentText[MAX_PATH];
 
 	/* Get the directory and name, and remove leading and
 	trailing whitespace. */
@@ -359,6 +472,10 @@ void SearchDialog::StartSearching()
 	GetDlgItemText(m_hDlg, IDC_COMBO_NAME, szSearchPattern, SIZEOF_ARRAY(szSearchPattern));
 	PathRemoveBlanks(szSearchPattern);
 
+	// Leading and trailing whitespace is left as-is here, since it may be part of the text being
+	// searched for.
+	GetDlgItemText(m_hDlg, IDC_EDIT_CONTENTTEXT, szContentText, SIZEOF_ARRAY(szContentText));
+
 	BOOL bSearchSubFolders = IsDlgButtonChecked(m_hDlg, IDC_CHECK_SEARCHSUBFOLDERS) == BST_CHECKED;
 
 	BOOL bUseRegularExpressions =
@@ -366,6 +483,8 @@ void SearchDialog::StartSearching()
 
 	BOOL bCaseInsensitive = IsDlgButtonChecked(m_hDlg, IDC_CHECK_CASEINSENSITIVE) == BST_CHECKED;
 
+	BOOL bUseIndex = IsDlgButtonChecked(m_hDlg, IDC_CHECK_USEINDEX) == BST_CHECKED;
+
 	/* Turn search patterns of the form '???' into '*???*', and
 	use this modified string to search. */
 	if (!bUseRegularExpressions && lstrlen(szSearchPattern) > 0)
@@ -402,7 +521,11 @@ void SearchDialog::StartSearching()
 	}
 
 	m_pSearch = new Search(m_hDlg, szBaseDirectory, szSearchPattern, dwAttributes,
-		bUseRegularExpressions, bCaseInsensitive, bSearchSubFolders);
+		bUseRegularExpressions, bCaseInsensitive, bSearchSubFolders, bUseIndex,
+		m_pexpp->GetDirectoryMonitor(), szContentText,
+		static_cast<ULONGLONG>(m_persistentSettings->m_dwContentMaxFileSize) * 1024 * 1024,
+		static_cast<ULONGLONG>(m_persistentSettings->m_dwContentReadLimit) * 1024,
+		std::move(*filter));
 	m_pSearch->AddRef();
 
 	/* Save the search directory and search pattern (only if they are not
@@ -442,6 +565,11 @@ void SearchDialog::StartSearching()
 	SetDlgItemText(m_hDlg, IDSEARCH, szTemp);
 
 	m_bSearching = TRUE;
+	m_searchStartTime = std::chrono::steady_clock::now();
+
+	// The timer is used both to add results to the listview and to update the status text. It
+	// will be stopped once the search has finished and all the results have been added.
+	SetTimer(m_hDlg, SEARCH_PROCESSITEMS_TIMER_ID, SEARCH_PROCESSITEMS_TIMER_ELAPSED, nullptr);
 
 	/* Create a background thread, and search using it... */
 	HANDLE hThread = CreateThread(
@@ -449,6 +577,64 @@ void SearchDialog::StartSearching()
 	CloseHandle(hThread);
 }
 
+// Opens the results in a tab, where they can be sorted, grouped and filtered like the contents of
+// any other folder. The tab watches the searched directory and updates the results as items change.
+void SearchDialog::OnOpenInTab()
+{
+	if (m_completedSearch == nullptr)
+	{
+		return;
+	}
+
+	unique_pidl_absolute pidlDirectory;
+	HRESULT hr = SHParseDisplayName(m_completedSearch->GetBaseDirectory().c_str(), nullptr,
+		wil::out_param(pidlDirectory), 0, nullptr);
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	// Results can still be waiting to be added, since they may arrive after the search has
+	// finished.
+	AddPendingResults();
+
+	auto searchResults = std::make_shared<SearchResultsFolder>();
+	searchResults->rootDirectory = m_completedSearch->GetBaseDirectory();
+	searchResults->recursive = m_completedSearch->GetSearchSubFolders();
+	searchResults->results.reserve(m_results.size());
+
+	for (const auto &result : m_results)
+	{
+		searchResults->results.push_back(GetResultPath(result));
+	}
+
+	// The tab can outlive both this dialog and any subsequent searches, so it holds its own
+	// reference to the search.
+	m_completedSearch->AddRef();
+	std::shared_ptr<Search> searchReference(m_completedSearch, [](Search *search) {
+		search->Release();
+	});
+
+	searchResults->matches = [searchReference](const std::wstring &directory,
+								 const WIN32_FIND_DATA &wfd) {
+		return searchReference->DoesItemMatch(directory, wfd);
+	};
+
+	if (m_completedSearch->HasContentCriteria())
+	{
+		searchResults->matchesContent = [searchReference](const std::wstring &directory,
+											const WIN32_FIND_DATA &wfd) {
+			return searchReference->DoesItemContentMatch(directory, wfd);
+		};
+	}
+
+	int newTabId;
+	m_tabContainer->CreateNewTab(
+		pidlDirectory.get(), TabSettings(_selected = true), nullptr, std::nullopt, &newTabId);
+	m_tabContainer->GetTab(newTabId).GetShellBrowser()->BrowseSearchResults(searchResults);
+}
+
 void SearchDialog::SaveEntry(int comboBoxId, boost::circular_buffer<std::wstring> &buffer)
 {
 	TCHAR entry[MAX_PATH];
@@ -553,70 +739,115 @@ void SearchDialog::UpdateListViewHeader()
 	m_iPreviousSelectedColumn = iColumn;
 }
 
-int CALLBACK NSearchDialog::SortResultsStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort)
+void SearchDialog::SortResults()
 {
-	assert(lParamSort != NULL);
+	BuildSortKeys();
 
-	auto *psd = reinterpret_cast<SearchDialog *>(lParamSort);
+	// Only the order is sorted, so the results themselves never have to be moved.
+	std::stable_sort(m_resultOrder.begin(), m_resultOrder.end(),
+		[this](int resultIndex1, int resultIndex2) {
+			int iRes = CompareResults(m_results[resultIndex1], m_results[resultIndex2]);
+
+			if (!m_persistentSettings->m_bSortAscending)
+			{
+				iRes = -iRes;
+			}
 
-	return psd->SortResults(lParam1, lParam2);
+			return iRes < 0;
+		});
+
+	// The items have been reordered underneath the listview, so any existing selection no longer
+	// refers to the same items.
+	HWND hListView = GetDlgItem(m_hDlg, IDC_LISTVIEW_SEARCHRESULTS);
+	ListView_SetItemState(hListView, -1, 0, LVIS_SELECTED | LVIS_FOCUSED);
+	InvalidateRect(hListView, nullptr, TRUE);
 }
 
-int CALLBACK SearchDialog::SortResults(LPARAM lParam1, LPARAM lParam2)
+// The keys are built once for each result (or directory) and then reused by every subsequent sort.
+// Only the keys for results that have arrived since the last sort need to be built.
+void SearchDialog::BuildSortKeys()
 {
-	int iRes = 0;
-
 	switch (m_persistentSettings->m_SortMode)
 	{
 	case SearchDialogPersistentSettings::SortMode::Name:
-		iRes = SortResultsByName(lParam1, lParam2);
+		for (auto &result : m_results)
+		{
+			if (result.nameSortKey.empty())
+			{
+				result.nameSortKey = CreateNaturalSortKey(result.name);
+			}
+		}
 		break;
 
 	case SearchDialogPersistentSettings::SortMode::Path:
-		iRes = SortResultsByPath(lParam1, lParam2);
-		break;
-	}
-
-	if (!m_persistentSettings->m_bSortAscending)
 	{
-		iRes = -iRes;
-	}
-
-	return iRes;
-}
-
-int CALLBACK SearchDialog::SortResultsByName(LPARAM lParam1, LPARAM lParam2)
-{
-	auto itr1 = m_SearchItemsMapInternal.find(static_cast<int>(lParam1));
-	auto itr2 = m_SearchItemsMapInternal.find(static_cast<int>(lParam2));
+		if (m_resultDirectoryRanks.size() == m_resultDirectories.size())
+		{
+			break;
+		}
 
-	TCHAR szFilename1[MAX_PATH];
-	TCHAR szFilename2[MAX_PATH];
+		for (size_t i = m_resultDirectorySortKeys.size(); i < m_resultDirectories.size(); i++)
+		{
+			m_resultDirectorySortKeys.push_back(CreateNaturalSortKey(m_resultDirectories[i]));
+		}
 
-	StringCchCopy(szFilename1, SIZEOF_ARRAY(szFilename1), itr1->second.c_str());
-	StringCchCopy(szFilename2, SIZEOF_ARRAY(szFilename2), itr2->second.c_str());
+		// There are generally far fewer directories than results, so the directories are ranked
+		// up front and the results are then sorted by rank. Each directory can appear more than
+		// once, in which case each instance is given the same rank.
+		std::vector<int> directoryIndexes(m_resultDirectories.size());
+		std::iota(directoryIndexes.begin(), directoryIndexes.end(), 0);
+		std::sort(directoryIndexes.begin(), directoryIndexes.end(),
+			[this](int directoryIndex1, int directoryIndex2) {
+				return m_resultDirectorySortKeys[directoryIndex1]
+					< m_resultDirectorySortKeys[directoryIndex2];
+			});
+
+		m_resultDirectoryRanks.resize(m_resultDirectories.size());
+		int rank = 0;
+
+		for (size_t i = 0; i < directoryIndexes.size(); i++)
+		{
+			if (i > 0
+				&& m_resultDirectorySortKeys[directoryIndexes[i]]
+					!= m_resultDirectorySortKeys[directoryIndexes[i - 1]])
+			{
+				rank++;
+			}
 
-	PathStripPath(szFilename1);
-	PathStripPath(szFilename2);
+			m_resultDirectoryRanks[directoryIndexes[i]] = rank;
+		}
+	}
+	break;
 
-	return StrCmpLogicalW(szFilename1, szFilename2);
+	default:
+		break;
+	}
 }
 
-int CALLBACK SearchDialog::SortResultsByPath(LPARAM lParam1, LPARAM lParam2)
+int SearchDialog::CompareResults(const SearchResult &result1, const SearchResult &result2) const
 {
-	auto itr1 = m_SearchItemsMapInternal.find(static_cast<int>(lParam1));
-	auto itr2 = m_SearchItemsMapInternal.find(static_cast<int>(lParam2));
+	switch (m_persistentSettings->m_SortMode)
+	{
+	case SearchDialogPersistentSettings::SortMode::Name:
+		return result1.nameSortKey.compare(result2.nameSortKey);
 
-	TCHAR szPath1[MAX_PATH];
-	TCHAR szPath2[MAX_PATH];
+	case SearchDialogPersistentSettings::SortMode::Path:
+		return m_resultDirectoryRanks[result1.directoryIndex]
+			- m_resultDirectoryRanks[result2.directoryIndex];
 
-	StringCchCopy(szPath1, SIZEOF_ARRAY(szPath1), itr1->second.c_str());
-	StringCchCopy(szPath2, SIZEOF_ARRAY(szPath2), itr2->second.c_str());
+	case SearchDialogPersistentSettings::SortMode::Lines:
+		// Results are ordered by the first line on which the text appears. Results without any
+		// lines (i.e. from a search that didn't include file contents) are equivalent.
+		if (result1.lineNumbers.empty() || result2.lineNumbers.empty())
+		{
+			return static_cast<int>(result2.lineNumbers.empty())
+				- static_cast<int>(result1.lineNumbers.empty());
+		}
 
-	PathRemoveFileSpec(szPath1);
-	PathRemoveFileSpec(szPath2);
+		return result1.lineNumbers.front() - result2.lineNumbers.front();
+	}
 
-	return StrCmpLogicalW(szPath1, szPath2);
+	return 0;
 }
 
 void SearchDialog::AddMenuEntries(PCIDLIST_ABSOLUTE pidlParent,
@@ -689,34 +920,17 @@ INT_PTR SearchDialog::OnNotify(NMHDR *pnmhdr)
 	case NM_DBLCLK:
 		if (pnmhdr->hwndFrom == GetDlgItem(m_hDlg, IDC_LISTVIEW_SEARCHRESULTS))
 		{
-			HWND hListView = GetDlgItem(m_hDlg, IDC_LISTVIEW_SEARCHRESULTS);
-			int iSelected = ListView_GetNextItem(hListView, -1, LVNI_ALL | LVNI_SELECTED);
+			int iSelected = GetSelectedResultIndex();
 
 			if (iSelected != -1)
 			{
-				LVITEM lvItem;
-
-				lvItem.mask = LVIF_PARAM;
-				lvItem.iItem = iSelected;
-				lvItem.iSubItem = 0;
-
-				BOOL bRet = ListView_GetItem(hListView, &lvItem);
+				unique_pidl_absolute pidlFull;
+				HRESULT hr = SHParseDisplayName(GetResultPath(m_results[iSelected]).c_str(),
+					nullptr, wil::out_param(pidlFull), 0, nullptr);
 
-				if (bRet)
+				if (hr == S_OK)
 				{
-					auto itr = m_SearchItemsMapInternal.find(static_cast<int>(lvItem.lParam));
-
-					/* Item should always exist. */
-					assert(itr != m_SearchItemsMapInternal.end());
-
-					unique_pidl_absolute pidlFull;
-					HRESULT hr = SHParseDisplayName(
-						itr->second.c_str(), nullptr, wil::out_param(pidlFull), 0, nullptr);
-
-					if (hr == S_OK)
-					{
-						m_pexpp->OpenItem(pidlFull.get());
-					}
+					m_pexpp->OpenItem(pidlFull.get());
 				}
 			}
 		}
@@ -737,59 +951,52 @@ INT_PTR SearchDialog::OnNotify(NMHDR *pnmhdr)
 	{
 		if (pnmhdr->hwndFrom == GetDlgItem(m_hDlg, IDC_LISTVIEW_SEARCHRESULTS))
 		{
-			HWND hListView = GetDlgItem(m_hDlg, IDC_LISTVIEW_SEARCHRESULTS);
-			int iSelected = ListView_GetNextItem(hListView, -1, LVNI_ALL | LVNI_SELECTED);
+			int iSelected = GetSelectedResultIndex();
 
 			if (iSelected != -1)
 			{
-				LVITEM lvItem;
-				lvItem.mask = LVIF_PARAM;
-				lvItem.iItem = iSelected;
-				lvItem.iSubItem = 0;
-				BOOL bRet = ListView_GetItem(hListView, &lvItem);
+				unique_pidl_absolute pidlFull;
+				HRESULT hr = SHParseDisplayName(GetResultPath(m_results[iSelected]).c_str(),
+					nullptr, wil::out_param(pidlFull), 0, nullptr);
 
-				if (bRet)
+				if (hr == S_OK)
 				{
-					auto itr = m_SearchItemsMapInternal.find(static_cast<int>(lvItem.lParam));
-					assert(itr != m_SearchItemsMapInternal.end());
+					// The only reason this pidl is cloned at all is that ILFindLastID returns an
+					// unaligned pointer. Inserting that into the pidlItems vector then triggers a
+					// warning due to the underlying types having different __unaligned
+					// qualifiers. This only affects Itanium (which isn't supported), but cloning
+					// the pidl here is a simple way of producing an aligned version.
+					unique_pidl_child pidlItem(ILCloneChild(ILFindLastID(pidlFull.get())));
 
-					unique_pidl_absolute pidlFull;
-					HRESULT hr = SHParseDisplayName(
-						itr->second.c_str(), nullptr, wil::out_param(pidlFull), 0, nullptr);
+					std::vector<PCITEMID_CHILD> pidlItems;
+					pidlItems.push_back(pidlItem.get());
 
-					if (hr == S_OK)
-					{
-						// The only reason this pidl is cloned at all is that ILFindLastID returns
-						// an unaligned pointer. Inserting that into the pidlItems vector then
-						// triggers a warning due to the underlying types having different
-						// __unaligned qualifiers. This only affects Itanium (which isn't
-						// supported), but cloning the pidl here is a simple way of producing an
-						// aligned version.
-						unique_pidl_child pidlItem(ILCloneChild(ILFindLastID(pidlFull.get())));
+					unique_pidl_absolute pidlDirectory(ILCloneFull(pidlFull.get()));
+					ILRemoveLastID(pidlDirectory.get());
 
-						std::vector<PCITEMID_CHILD> pidlItems;
-						pidlItems.push_back(pidlItem.get());
+					FileContextMenuManager fcmm(m_hDlg, pidlDirectory.get(), pidlItems);
 
-						unique_pidl_absolute pidlDirectory(ILCloneFull(pidlFull.get()));
-						ILRemoveLastID(pidlDirectory.get());
+					DWORD dwCursorPos = GetMessagePos();
 
-						FileContextMenuManager fcmm(m_hDlg, pidlDirectory.get(), pidlItems);
+					POINT ptCursor;
+					ptCursor.x = GET_X_LPARAM(dwCursorPos);
+					ptCursor.y = GET_Y_LPARAM(dwCursorPos);
 
-						DWORD dwCursorPos = GetMessagePos();
-
-						POINT ptCursor;
-						ptCursor.x = GET_X_LPARAM(dwCursorPos);
-						ptCursor.y = GET_Y_LPARAM(dwCursorPos);
-
-						fcmm.ShowMenu(this, MIN_SHELL_MENU_ID, MAX_SHELL_MENU_ID, &ptCursor,
-							m_pexpp->GetStatusBar(), NULL, FALSE, IsKeyDown(VK_SHIFT));
-					}
+					fcmm.ShowMenu(this, MIN_SHELL_MENU_ID, MAX_SHELL_MENU_ID, &ptCursor,
+						m_pexpp->GetStatusBar(), NULL, FALSE, IsKeyDown(VK_SHIFT));
 				}
 			}
 		}
 	}
 	break;
 
+	case LVN_GETDISPINFO:
+		if (pnmhdr->hwndFrom == GetDlgItem(m_hDlg, IDC_LISTVIEW_SEARCHRESULTS))
+		{
+			OnGetDispInfo(reinterpret_cast<NMLVDISPINFO *>(pnmhdr));
+		}
+		break;
+
 	case LVN_COLUMNCLICK:
 	{
 		/* A listview header has been clicked,
@@ -811,9 +1018,7 @@ INT_PTR SearchDialog::OnNotify(NMHDR *pnmhdr)
 				m_persistentSettings->m_Columns[pnmlv->iSubItem].bSortAscending;
 		}
 
-		ListView_SortItems(GetDlgItem(m_hDlg, IDC_LISTVIEW_SEARCHRESULTS),
-			NSearchDialog::SortResultsStub, reinterpret_cast<LPARAM>(this));
-
+		SortResults();
 		UpdateListViewHeader();
 	}
 	break;
@@ -826,23 +1031,21 @@ INT_PTR SearchDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
 	switch (uMsg)
 	{
-	/* We won't actually process the item here. Instead, we'll
-	add it onto the list of current items, which will be processed
+	/* We won't actually process the results here. Instead, we'll
+	add them onto the list of pending results, which will be processed
 	in batch. This is done to stop this message from blocking the
 	main GUI (also see http://www.flounder.com/iocompletion.htm). */
-	case NSearchDialog::WM_APP_SEARCHITEMFOUND:
-	{
-		m_AwaitingSearchItems.push_back(reinterpret_cast<PIDLIST_ABSOLUTE>(wParam));
+	case NSearchDialog::WM_APP_SEARCHITEMSFOUND:
+		m_pendingResultBlocks.emplace_back(reinterpret_cast<SearchResultBlock *>(wParam));
 
-		if (m_bSetSearchTimer)
+		// Messages sent from another thread are processed ahead of posted messages, so the
+		// final results can arrive after the search has finished (at which point the timer may
+		// no longer be running).
+		if (m_pSearch == nullptr)
 		{
-			SetTimer(
-				m_hDlg, SEARCH_PROCESSITEMS_TIMER_ID, SEARCH_PROCESSITEMS_TIMER_ELAPSED, nullptr);
-
-			m_bSetSearchTimer = FALSE;
+			AddPendingResults();
 		}
-	}
-	break;
+		break;
 
 	case NSearchDialog::WM_APP_SEARCHFINISHED:
 	{
@@ -867,7 +1070,18 @@ INT_PTR SearchDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
 
 		assert(m_pSearch != nullptr);
 
-		m_pSearch->Release();
+		// A search that was stopped will only have found some of the matching items, so its
+		// results aren't worth keeping up to date.
+		if (!m_bStopSearching)
+		{
+			m_completedSearch = m_pSearch;
+			EnableWindow(GetDlgItem(m_hDlg, IDC_BUTTON_OPENINTAB), TRUE);
+		}
+		else
+		{
+			m_pSearch->Release();
+		}
+
 		m_pSearch = nullptr;
 
 		m_bSearching = FALSE;
@@ -876,20 +1090,6 @@ INT_PTR SearchDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
 	}
 	break;
 
-	case NSearchDialog::WM_APP_SEARCHCHANGEDDIRECTORY:
-	{
-		TCHAR szStatus[512];
-		TCHAR *pszDirectory = nullptr;
-
-		pszDirectory = reinterpret_cast<TCHAR *>(wParam);
-
-		TCHAR szTemp[64];
-		LoadString(GetInstance(), IDS_SEARCHING, szTemp, SIZEOF_ARRAY(szTemp));
-		StringCchPrintf(szStatus, SIZEOF_ARRAY(szStatus), szTemp, pszDirectory);
-		SetDlgItemText(m_hDlg, IDC_STATIC_STATUS, szStatus);
-	}
-	break;
-
 	case NSearchDialog::WM_APP_REGULAREXPRESSIONINVALID:
 	{
 		/* The link/status controls are in the same position, and
@@ -927,58 +1127,160 @@ INT_PTR SearchDialog::OnTimer(int iTimerID)
 		return 1;
 	}
 
-	HWND hListView = GetDlgItem(m_hDlg, IDC_LISTVIEW_SEARCHRESULTS);
-	int nListViewItems = ListView_GetItemCount(hListView);
+	AddPendingResults();
 
-	int nItems =
-		min(static_cast<int>(m_AwaitingSearchItems.size()), SEARCH_MAX_ITEMS_BATCH_PROCESS);
-	int i = 0;
+	if (m_pSearch != nullptr)
+	{
+		UpdateSearchStatus();
+	}
+	else
+	{
+		KillTimer(m_hDlg, SEARCH_PROCESSITEMS_TIMER_ID);
+	}
 
-	auto itr = m_AwaitingSearchItems.begin();
+	return 0;
+}
 
-	while (i < nItems)
+void SearchDialog::AddPendingResults()
+{
+	if (m_pendingResultBlocks.empty())
 	{
-		LVITEM lvItem;
-		SHFILEINFO shfi;
-		int iIndex;
+		return;
+	}
 
-		PIDLIST_ABSOLUTE pidl = *itr;
+	for (auto &block : m_pendingResultBlocks)
+	{
+		int directoryIndex = static_cast<int>(m_resultDirectories.size());
+		m_resultDirectories.push_back(std::move(block->directory));
 
-		std::wstring fullFileName;
-		GetDisplayName(pidl, SHGDN_FORPARSING, fullFileName);
+		for (auto &result : block->results)
+		{
+			result.directoryIndex = directoryIndex;
+			m_resultOrder.push_back(static_cast<int>(m_results.size()));
+			m_results.push_back(std::move(result));
+		}
+	}
 
-		TCHAR directory[MAX_PATH];
-		StringCchCopy(directory, SIZEOF_ARRAY(directory), fullFileName.c_str());
-		PathRemoveFileSpec(directory);
+	m_pendingResultBlocks.clear();
 
-		std::wstring fileName;
-		GetDisplayName(pidl, SHGDN_INFOLDER | SHGDN_FORPARSING, fileName);
+	// Nothing is retrieved for the new items at this point. The listview will only request
+	// information for the items that are actually visible.
+	ListView_SetItemCountEx(GetDlgItem(m_hDlg, IDC_LISTVIEW_SEARCHRESULTS),
+		static_cast<int>(m_results.size()), LVSICF_NOINVALIDATEALL | LVSICF_NOSCROLL);
+}
 
-		SHGetFileInfo((LPCWSTR) pidl, 0, &shfi, sizeof(shfi), SHGFI_PIDL | SHGFI_SYSICONINDEX);
+void SearchDialog::OnGetDispInfo(NMLVDISPINFO *dispInfo)
+{
+	auto &result = m_results[m_resultOrder[dispInfo->item.iItem]];
 
-		m_SearchItemsMapInternal.insert(
-			std::unordered_map<int, std::wstring>::value_type(m_iInternalIndex, fullFileName));
+	if (WI_IsFlagSet(dispInfo->item.mask, LVIF_TEXT))
+	{
+		std::wstring text;
 
-		lvItem.mask = LVIF_IMAGE | LVIF_TEXT | LVIF_PARAM;
-		lvItem.pszText = fileName.data();
-		lvItem.iItem = nListViewItems + i;
-		lvItem.iSubItem = 0;
-		lvItem.iImage = shfi.iIcon;
-		lvItem.lParam = m_iInternalIndex++;
-		iIndex = ListView_InsertItem(hListView, &lvItem);
+		switch (dispInfo->item.iSubItem)
+		{
+		case 0:
+			text = result.name;
+			break;
 
-		ListView_SetItemText(hListView, iIndex, 1, directory);
+		case 1:
+			text = m_resultDirectories[result.directoryIndex];
+			break;
 
-		CoTaskMemFree(pidl);
+		case 2:
+			text = FormatLineNumbers(result.lineNumbers);
+			break;
+		}
 
-		itr = m_AwaitingSearchItems.erase(itr);
+		StringCchCopy(dispInfo->item.pszText, dispInfo->item.cchTextMax, text.c_str());
+	}
 
-		i++;
+	if (WI_IsFlagSet(dispInfo->item.mask, LVIF_IMAGE))
+	{
+		if (!result.iconIndex)
+		{
+			SHFILEINFO shfi;
+			DWORD_PTR res = SHGetFileInfo(
+				GetResultPath(result).c_str(), 0, &shfi, sizeof(shfi), SHGFI_SYSICONINDEX);
+			result.iconIndex = res ? shfi.iIcon : 0;
+		}
+
+		dispInfo->item.iImage = *result.iconIndex;
 	}
+}
 
-	m_bSetSearchTimer = TRUE;
+int SearchDialog::GetSelectedResultIndex() const
+{
+	int item = ListView_GetNextItem(
+		GetDlgItem(m_hDlg, IDC_LISTVIEW_SEARCHRESULTS), -1, LVNI_ALL | LVNI_SELECTED);
 
-	return 0;
+	if (item == -1)
+	{
+		return -1;
+	}
+
+	return m_resultOrder[item];
+}
+
+std::wstring SearchDialog::GetResultPath(const SearchResult &result) const
+{
+	TCHAR szFullFileName[MAX_PATH];
+	PathCombine(
+		szFullFileName, m_resultDirectories[result.directoryIndex].c_str(), result.name.c_str());
+	return szFullFileName;
+}
+
+std::wstring SearchDialog::FormatLineNumbers(const std::vector<int> &lineNumbers)
+{
+	std::wstring text;
+
+	for (int lineNumber : lineNumbers)
+	{
+		if (!text.empty())
+		{
+			text += _T(", ");
+		}
+
+		text += std::to_wstring(lineNumber);
+	}
+
+	// The list of lines is capped, so there may be more matching lines than are shown.
+	if (lineNumbers.size() >= FileContentSearcher::MAX_LINE_NUMBERS)
+	{
+		text += _T(", ...");
+	}
+
+	return text;
+}
+
+void SearchDialog::UpdateSearchStatus()
+{
+	auto status = m_pSearch->GetStatus();
+
+	// The directory can be empty if the search hasn't entered a directory yet, or if it was being
+	// updated at the time. Either way, the status will be updated on the next tick.
+	if (status.currentDirectory.empty())
+	{
+		return;
+	}
+
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now() - m_searchStartTime);
+	int entriesPerSecond = 0;
+
+	if (elapsed.count() > 0)
+	{
+		entriesPerSecond = static_cast<int>(
+			static_cast<long long>(status.entriesSearched) * 1000 / elapsed.count());
+	}
+
+	TCHAR szTemp[128];
+	LoadString(GetInstance(), IDS_SEARCH_PROGRESS_MESSAGE, szTemp, SIZEOF_ARRAY(szTemp));
+
+	TCHAR szStatus[512];
+	StringCchPrintf(szStatus, SIZEOF_ARRAY(szStatus), szTemp, status.currentDirectory.c_str(),
+		status.foldersFound, status.filesFound, entriesPerSecond);
+	SetDlgItemText(m_hDlg, IDC_STATIC_STATUS, szStatus);
 }
 
 INT_PTR SearchDialog::OnClose()
@@ -1006,43 +1308,47 @@ DWORD WINAPI NSearchDialog::SearchThread(LPVOID pParam)
 }
 
 Search::Search(HWND hDlg, TCHAR *szBaseDirectory, TCHAR *szPattern, DWORD dwAttributes,
-	BOOL bUseRegularExpressions, BOOL bCaseInsensitive, BOOL bSearchSubFolders)
+	BOOL bUseRegularExpressions, BOOL bCaseInsensitive, BOOL bSearchSubFolders,
+	BOOL bUseIndex, IDirectoryMonitor *directoryMonitor, TCHAR *szContentText,
+	ULONGLONG contentMaxFileSize, ULONGLONG contentReadLimit, SearchFilter filter) :
+	m_directoryPruner(filter.excludedDirectories, filter.maxDepth),
+	m_walker(ParallelDirectoryWalker::GetDefaultNumWorkers()),
+	m_workerResults(m_walker.GetNumWorkers())
 {
 	m_hDlg = hDlg;
 	m_dwAttributes = dwAttributes;
 	m_bUseRegularExpressions = bUseRegularExpressions;
 	m_bCaseInsensitive = bCaseInsensitive;
 	m_bSearchSubFolders = bSearchSubFolders;
+	m_bUseIndex = bUseIndex;
+	m_directoryMonitor = directoryMonitor;
+	m_contentMaxFileSize = contentMaxFileSize;
+	m_contentReadLimit = contentReadLimit;
 
 	StringCchCopy(m_szBaseDirectory, SIZEOF_ARRAY(m_szBaseDirectory), szBaseDirectory);
 	StringCchCopy(m_szSearchPattern, SIZEOF_ARRAY(m_szSearchPattern), szPattern);
+	StringCchCopy(m_szContentText, SIZEOF_ARRAY(m_szContentText), szContentText);
 
-	InitializeCriticalSection(&m_csStop);
-	m_bStopSearching = FALSE;
-}
+	if (m_dwAttributes != 0)
+	{
+		m_predicate.Add(std::make_unique<AttributePredicate>(m_dwAttributes, 0));
+	}
 
-Search::~Search()
-{
-	DeleteCriticalSection(&m_csStop);
+	for (auto &predicate : filter.predicates)
+	{
+		m_predicate.Add(std::move(predicate));
+	}
 }
 
 void Search::StartSearching()
 {
-	m_iFoldersFound = 0;
-	m_iFilesFound = 0;
+	std::unique_ptr<FilenameMatcher> matcher;
 
 	if (lstrcmp(m_szSearchPattern, EMPTY_STRING) != 0 && m_bUseRegularExpressions)
 	{
 		try
 		{
-			if (m_bCaseInsensitive)
-			{
-				m_rxPattern.assign(m_szSearchPattern, std::regex_constants::icase);
-			}
-			else
-			{
-				m_rxPattern.assign(m_szSearchPattern);
-			}
+			matcher = std::make_unique<RegexMatcher>(m_szSearchPattern, !m_bCaseInsensitive);
 		}
 		catch (std::exception)
 		{
@@ -1051,160 +1357,380 @@ void Search::StartSearching()
 			return;
 		}
 	}
+	else if (lstrcmp(m_szSearchPattern, EMPTY_STRING) != 0)
+	{
+		matcher = std::make_unique<WildcardMatcher>(m_szSearchPattern, !m_bCaseInsensitive);
+	}
+
+	/* Only match against the filename if it's not empty. */
+	if (matcher)
+	{
+		m_requiredLiterals = matcher->GetRequiredLiterals();
+		m_predicate.Add(std::make_unique<NamePredicate>(std::move(matcher), !m_bCaseInsensitive));
+	}
+
+	if (lstrcmp(m_szContentText, EMPTY_STRING) != 0)
+	{
+		if (m_contentReadLimit != 0)
+		{
+			m_throughputLimiter.emplace(m_contentReadLimit);
+		}
+
+		m_contentSearcher.emplace(m_szContentText, !m_bCaseInsensitive, m_contentMaxFileSize,
+			m_throughputLimiter ? &*m_throughputLimiter : nullptr);
+	}
+
+	if (m_bUseIndex)
+	{
+		SearchIndex();
+	}
+	else
+	{
+		ParallelDirectoryWalker::SubdirectoryFilter subdirectoryFilter;
+
+		if (!m_directoryPruner.IsEmpty())
+		{
+			subdirectoryFilter = [this](int workerIndex, const std::wstring &directory,
+									 const WIN32_FIND_DATA &wfd, int depth) {
+				UNREFERENCED_PARAMETER(workerIndex);
+				UNREFERENCED_PARAMETER(directory);
+
+				return ShouldSearchSubdirectory(wfd, depth);
+			};
+		}
+
+		// The predicates are only read from this point on, so entries can be matched
+		// concurrently on each of the workers.
+		m_walker.Walk(m_szBaseDirectory, m_bSearchSubFolders,
+			[this](int workerIndex, const std::wstring &directory) {
+				OnDirectoryEntered(workerIndex, directory);
+			},
+			[this](int workerIndex, const std::wstring &directory, const WIN32_FIND_DATA &wfd) {
+				OnEntryFound(workerIndex, directory, wfd);
+			},
+			subdirectoryFilter);
+	}
+
+	for (int i = 0; i < m_walker.GetNumWorkers(); i++)
+	{
+		SendPendingResults(i);
+	}
 
-	SearchDirectory(m_szBaseDirectory);
+	auto status = GetStatus();
 
 	SendMessage(m_hDlg, NSearchDialog::WM_APP_SEARCHFINISHED, 0,
-		MAKELPARAM(m_iFoldersFound, m_iFilesFound));
+		MAKELPARAM(status.foldersFound, status.filesFound));
 
 	Release();
 }
 
-void Search::SearchDirectory(const TCHAR *szDirectory)
+void Search::SearchIndex()
 {
-	SendMessage(m_hDlg, NSearchDialog::WM_APP_SEARCHCHANGEDDIRECTORY,
-		reinterpret_cast<WPARAM>(szDirectory), 0);
+	auto &indexManager = FilenameIndexManager::GetInstance();
 
-	std::list<std::wstring> subFolderList;
+	// If the index has to be built first, the walker is used to do that, with the progress
+	// reported in the same way as for a regular search.
+	auto index = indexManager.GetIndex(m_szBaseDirectory, m_directoryMonitor, m_walker,
+		[this](int workerIndex, const std::wstring &directory) {
+			OnDirectoryEntered(workerIndex, directory);
+		});
 
-	SearchDirectoryInternal(szDirectory, &subFolderList);
+	if (!index)
+	{
+		return;
+	}
+
+	auto &workerResults = m_workerResults[0];
+
+	// The index can only rule out names that don't contain the literal parts of the pattern.
+	// Each candidate is still matched in full below.
+	index->Query(m_requiredLiterals, m_bSearchSubFolders,
+		[this, &workerResults](const std::wstring &directory, const FilenameIndex::Entry &entry) {
+			workerResults.entriesSearched.fetch_add(1, std::memory_order_relaxed);
+
+			SearchEntry searchEntry = { entry.name, entry.attributes, entry.size,
+				SearchEntry::FileTimeToTicks(entry.lastWriteTime) };
+
+			if (!IsDirectoryPruned(directory) && DoesEntryMatch(searchEntry))
+			{
+				SearchResult result;
+				result.name = entry.name;
+				result.attributes = entry.attributes;
+				result.size = entry.size;
+				result.lastWriteTime = entry.lastWriteTime;
+
+				if (!m_contentSearcher || DoesContentMatch(directory, result))
+				{
+					AddResult(0, directory, std::move(result));
+				}
+			}
+
+			return !m_walker.IsStopped();
+		});
+
+	indexManager.SaveIndex(m_szBaseDirectory);
+}
 
-	bool bStop = false;
+void Search::OnDirectoryEntered(int workerIndex, const std::wstring &directory)
+{
+	// Each block only holds results from a single directory.
+	SendPendingResults(workerIndex);
+
+	std::unique_lock<std::mutex> lock(m_currentDirectoryMutex, std::try_to_lock);
 
-	EnterCriticalSection(&m_csStop);
-	if (m_bStopSearching)
+	if (!lock.owns_lock())
 	{
-		bStop = true;
+		return;
 	}
-	LeaveCriticalSection(&m_csStop);
 
-	if (bStop)
+	m_currentDirectory = directory;
+}
+
+void Search::OnEntryFound(
+	int workerIndex, const std::wstring &directory, const WIN32_FIND_DATA &wfd)
+{
+	auto &workerResults = m_workerResults[workerIndex];
+	workerResults.entriesSearched.fetch_add(1, std::memory_order_relaxed);
+
+	if (!DoesEntryMatch(SearchEntry::FromFindData(wfd)))
 	{
 		return;
 	}
 
-	if (m_bSearchSubFolders)
+	SearchResult result;
+	result.name = wfd.cFileName;
+	result.attributes = wfd.dwFileAttributes;
+	result.size = (static_cast<ULONGLONG>(wfd.nFileSizeHigh) << 32) | wfd.nFileSizeLow;
+	result.lastWriteTime = wfd.ftLastWriteTime;
+
+	// The contents are only read once everything else about the entry has matched, since reading
+	// them is far more expensive than any of the other checks.
+	if (m_contentSearcher && !DoesContentMatch(directory, result))
 	{
-		for (const auto &strSubFolder : subFolderList)
-		{
-			SearchDirectory(strSubFolder.c_str());
-		}
+		return;
 	}
+
+	AddResult(workerIndex, directory, std::move(result));
 }
 
-/* Can't recurse, as it would overflow the stack. */
-void Search::SearchDirectoryInternal(
-	const TCHAR *szSearchDirectory, std::list<std::wstring> *pSubFolderList)
+void Search::AddResult(int workerIndex, const std::wstring &directory, SearchResult result)
 {
-	assert(szSearchDirectory != nullptr);
-	assert(pSubFolderList != nullptr);
+	auto &workerResults = m_workerResults[workerIndex];
 
-	WIN32_FIND_DATA wfd;
-	TCHAR szSearchTerm[MAX_PATH];
+	if (WI_IsFlagSet(result.attributes, FILE_ATTRIBUTE_DIRECTORY))
+	{
+		workerResults.foldersFound.fetch_add(1, std::memory_order_relaxed);
+	}
+	else
+	{
+		workerResults.filesFound.fetch_add(1, std::memory_order_relaxed);
+	}
 
-	PathCombine(szSearchTerm, szSearchDirectory, _T("*"));
+	auto &pendingBlock = workerResults.pendingBlock;
 
-	HANDLE hFindFile = FindFirstFile(szSearchTerm, &wfd);
+	// Results from the index aren't grouped by directory, so the directory can change without
+	// OnDirectoryEntered() being called.
+	if (pendingBlock && pendingBlock->directory != directory)
+	{
+		SendPendingResults(workerIndex);
+	}
 
-	if (hFindFile != INVALID_HANDLE_VALUE)
+	if (!pendingBlock)
 	{
-		bool bStop = false;
+		pendingBlock = std::make_unique<SearchResultBlock>();
+		pendingBlock->directory = directory;
+	}
 
-		while (FindNextFile(hFindFile, &wfd) != 0 && !bStop)
-		{
-			if (lstrcmpi(wfd.cFileName, _T(".")) != 0 && lstrcmpi(wfd.cFileName, _T("..")) != 0)
-			{
-				BOOL bMatchFileName = FALSE;
-				BOOL bMatchAttributes = FALSE;
+	pendingBlock->results.push_back(std::move(result));
 
-				/* Only match against the filename if it's not empty. */
-				if (lstrcmp(m_szSearchPattern, EMPTY_STRING) != 0)
-				{
-					if (m_bUseRegularExpressions)
-					{
-						if (std::regex_match(wfd.cFileName, m_rxPattern))
-						{
-							bMatchFileName = TRUE;
-						}
-					}
-					else
-					{
-						if (CheckWildcardMatch(
-								m_szSearchPattern, wfd.cFileName, !m_bCaseInsensitive))
-						{
-							bMatchFileName = TRUE;
-						}
-					}
-				}
-				else
-				{
-					/* No filename constraint, so all filenames match. */
-					bMatchFileName = TRUE;
-				}
+	if (pendingBlock->results.size() >= MAX_RESULTS_PER_BLOCK)
+	{
+		SendPendingResults(workerIndex);
+	}
+}
 
-				if (m_dwAttributes != 0)
-				{
-					if ((wfd.dwFileAttributes & m_dwAttributes) == m_dwAttributes)
-					{
-						bMatchAttributes = TRUE;
-					}
-				}
-				else
-				{
-					bMatchAttributes = TRUE;
-				}
+void Search::SendPendingResults(int workerIndex)
+{
+	auto &pendingBlock = m_workerResults[workerIndex].pendingBlock;
 
-				BOOL bItemMatch = bMatchFileName && bMatchAttributes;
+	if (!pendingBlock)
+	{
+		return;
+	}
 
-				if (bItemMatch)
-				{
-					if ((wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-						== FILE_ATTRIBUTE_DIRECTORY)
-					{
-						m_iFoldersFound++;
-					}
-					else
-					{
-						m_iFilesFound++;
-					}
-
-					TCHAR szFullFileName[MAX_PATH];
-					PathCombine(szFullFileName, szSearchDirectory, wfd.cFileName);
-
-					unique_pidl_absolute pidl;
-					SHParseDisplayName(szFullFileName, nullptr, wil::out_param(pidl), 0, nullptr);
-
-					PostMessage(m_hDlg, NSearchDialog::WM_APP_SEARCHITEMFOUND,
-						reinterpret_cast<WPARAM>(ILCloneFull(pidl.get())), 0);
-				}
+	// Ownership of the block passes to the dialog if the message is posted successfully.
+	BOOL res = PostMessage(m_hDlg, NSearchDialog::WM_APP_SEARCHITEMSFOUND,
+		reinterpret_cast<WPARAM>(pendingBlock.get()), 0);
 
-				if ((wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == FILE_ATTRIBUTE_DIRECTORY)
-				{
-					TCHAR szSubFolder[MAX_PATH];
+	if (res)
+	{
+		pendingBlock.release();
+	}
+	else
+	{
+		pendingBlock.reset();
+	}
+}
 
-					PathCombine(szSubFolder, szSearchDirectory, wfd.cFileName);
+bool Search::ShouldSearchSubdirectory(const WIN32_FIND_DATA &wfd, int depth) const
+{
+	return m_directoryPruner.ShouldDescend(wfd.cFileName, depth);
+}
 
-					pSubFolderList->push_back(szSubFolder);
-				}
-			}
+// The index holds every directory below the root, so the pruning that the walker would otherwise
+// have done has to be applied to each of the entries retrieved from it.
+bool Search::IsDirectoryPruned(const std::wstring &directory) const
+{
+	if (m_directoryPruner.IsEmpty())
+	{
+		return false;
+	}
 
-			EnterCriticalSection(&m_csStop);
-			if (m_bStopSearching)
-			{
-				bStop = true;
-			}
-			LeaveCriticalSection(&m_csStop);
+	std::wstring_view baseDirectory(m_szBaseDirectory);
+	std::wstring_view relativePath(directory);
+
+	if (relativePath.size() <= baseDirectory.size())
+	{
+		return false;
+	}
+
+	relativePath.remove_prefix(baseDirectory.size());
+
+	int depth = 0;
+
+	while (!relativePath.empty())
+	{
+		if (relativePath[0] == '\\')
+		{
+			relativePath.remove_prefix(1);
+			continue;
 		}
 
-		FindClose(hFindFile);
+		auto componentEnd = relativePath.find('\\');
+		auto component = relativePath.substr(0, componentEnd);
+		depth++;
+
+		if (!m_directoryPruner.ShouldDescend(component, depth))
+		{
+			return true;
+		}
+
+		relativePath.remove_prefix(component.size());
+	}
+
+	return false;
+}
+
+bool Search::DoesEntryMatch(const SearchEntry &entry) const
+{
+	// An excluded folder is left out of the results, along with everything in it.
+	if (WI_IsFlagSet(entry.attributes, FILE_ATTRIBUTE_DIRECTORY)
+		&& m_directoryPruner.IsExcluded(entry.name))
+	{
+		return false;
+	}
+
+	return m_predicate.Matches(entry);
+}
+
+std::wstring Search::GetBaseDirectory() const
+{
+	return m_szBaseDirectory;
+}
+
+bool Search::GetSearchSubFolders() const
+{
+	return m_bSearchSubFolders;
+}
+
+bool Search::HasContentCriteria() const
+{
+	return m_contentSearcher.has_value();
+}
+
+// The predicates are no longer modified once the search has finished, so they can be used here on
+// the UI thread.
+bool Search::DoesItemMatch(const std::wstring &directory, const WIN32_FIND_DATA &wfd) const
+{
+	return !IsDirectoryPruned(directory) && DoesEntryMatch(SearchEntry::FromFindData(wfd));
+}
+
+// A completed search is never stopped, so the content search won't be cancelled.
+bool Search::DoesItemContentMatch(const std::wstring &directory, const WIN32_FIND_DATA &wfd) const
+{
+	if (!m_contentSearcher)
+	{
+		return true;
+	}
+
+	SearchResult result;
+	result.name = wfd.cFileName;
+	result.attributes = wfd.dwFileAttributes;
+	result.size = (static_cast<ULONGLONG>(wfd.nFileSizeHigh) << 32) | wfd.nFileSizeLow;
+	result.lastWriteTime = wfd.ftLastWriteTime;
+
+	return DoesContentMatch(directory, result);
+}
+
+bool Search::DoesContentMatch(const std::wstring &directory, SearchResult &result) const
+{
+	// Reading an offline file (e.g. one that's only stored in the cloud) would cause the entire
+	// file to be downloaded.
+	if (WI_IsAnyFlagSet(result.attributes,
+			FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_OFFLINE
+				| FILE_ATTRIBUTE_RECALL_ON_DATA_ACCESS))
+	{
+		return false;
+	}
+
+	// The size reported by the enumeration allows most large files to be skipped without having
+	// to open them. The searcher will still check the actual size.
+	if (result.size > m_contentMaxFileSize)
+	{
+		return false;
+	}
+
+	std::wstring path = directory;
+
+	if (!path.empty() && path.back() != '\\')
+	{
+		path += '\\';
 	}
+
+	path += result.name;
+
+	result.lineNumbers =
+		m_contentSearcher->SearchFile(path, [this] { return m_walker.IsStopped(); });
+
+	return !result.lineNumbers.empty();
 }
 
 void Search::StopSearching()
 {
-	EnterCriticalSection(&m_csStop);
-	m_bStopSearching = TRUE;
-	LeaveCriticalSection(&m_csStop);
+	m_walker.Stop();
+}
+
+Search::Status Search::GetStatus() const
+{
+	Status status;
+
+	for (const auto &workerResults : m_workerResults)
+	{
+		status.foldersFound += workerResults.foldersFound.load(std::memory_order_relaxed);
+		status.filesFound += workerResults.filesFound.load(std::memory_order_relaxed);
+		status.entriesSearched += workerResults.entriesSearched.load(std::memory_order_relaxed);
+	}
+
+	// This is called periodically from the UI thread, so rather than waiting on a worker, the
+	// directory is simply left out. It will be picked up the next time the status is retrieved.
+	std::unique_lock<std::mutex> lock(m_currentDirectoryMutex, std::try_to_lock);
+
+	if (lock.owns_lock())
+	{
+		status.currentDirectory = m_currentDirectory;
+	}
+
+	return status;
 }
 
 void SearchDialog::SaveState()
@@ -1231,13 +1757,21 @@ void SearchDialog::SaveState()
 
 	m_persistentSettings->m_bSystem = IsDlgButtonChecked(m_hDlg, IDC_CHECK_SYSTEM) == BST_CHECKED;
 
+	m_persistentSettings->m_bUseIndex =
+		IsDlgButtonChecked(m_hDlg, IDC_CHECK_USEINDEX) == BST_CHECKED;
+
 	hListView = GetDlgItem(m_hDlg, IDC_LISTVIEW_SEARCHRESULTS);
 
 	m_persistentSettings->m_iColumnWidth1 = ListView_GetColumnWidth(hListView, 0);
 	m_persistentSettings->m_iColumnWidth2 = ListView_GetColumnWidth(hListView, 1);
+	m_persistentSettings->m_iColumnWidth3 = ListView_GetColumnWidth(hListView, 2);
 
 	GetDlgItemText(m_hDlg, IDC_COMBO_NAME, m_persistentSettings->m_szSearchPattern,
 		SIZEOF_ARRAY(m_persistentSettings->m_szSearchPattern));
+	GetDlgItemText(m_hDlg, IDC_EDIT_CONTENTTEXT, m_persistentSettings->m_szContentText,
+		SIZEOF_ARRAY(m_persistentSettings->m_szContentText));
+	GetDlgItemText(m_hDlg, IDC_EDIT_FILTER, m_persistentSettings->m_szFilterText,
+		SIZEOF_ARRAY(m_persistentSettings->m_szFilterText));
 
 	m_persistentSettings->m_bStateSaved = TRUE;
 }
@@ -1254,10 +1788,17 @@ SearchDialogPersistentSettings::SearchDialogPersistentSettings() :
 	m_bHidden = FALSE;
 	m_bReadOnly = FALSE;
 	m_bSystem = FALSE;
+	m_bUseIndex = FALSE;
+	m_dwContentMaxFileSize =
+		static_cast<DWORD>(FileContentSearcher::DEFAULT_MAX_FILE_SIZE / (1024 * 1024));
+	m_dwContentReadLimit = 0;
 	m_iColumnWidth1 = -1;
 	m_iColumnWidth2 = -1;
+	m_iColumnWidth3 = -1;
 
 	StringCchCopy(m_szSearchPattern, SIZEOF_ARRAY(m_szSearchPattern), EMPTY_STRING);
+	StringCchCopy(m_szContentText, SIZEOF_ARRAY(m_szContentText), EMPTY_STRING);
+	StringCchCopy(m_szFilterText, SIZEOF_ARRAY(m_szFilterText), EMPTY_STRING);
 
 	ColumnInfo ci;
 	ci.sortMode = SortMode::Name;
@@ -1270,6 +1811,11 @@ SearchDialogPersistentSettings::SearchDialogPersistentSettings() :
 	ci.bSortAscending = true;
 	m_Columns.push_back(ci);
 
+	ci.sortMode = SortMode::Lines;
+	ci.uStringID = IDS_SEARCH_COLUMN_LINES;
+	ci.bSortAscending = true;
+	m_Columns.push_back(ci);
+
 	m_SortMode = m_Columns.front().sortMode;
 	m_bSortAscending = m_Columns.front().bSortAscending;
 }
@@ -1284,6 +1830,7 @@ void SearchDialogPersistentSettings::SaveExtraRegistrySettings(HKEY hKey)
 {
 	RegistrySettings::SaveDword(hKey, SETTING_COLUMN_WIDTH_1, m_iColumnWidth1);
 	RegistrySettings::SaveDword(hKey, SETTING_COLUMN_WIDTH_2, m_iColumnWidth2);
+	RegistrySettings::SaveDword(hKey, SETTING_COLUMN_WIDTH_3, m_iColumnWidth3);
 	RegistrySettings::SaveString(hKey, SETTING_SEARCH_DIRECTORY_TEXT, m_szSearchPattern);
 	RegistrySettings::SaveDword(hKey, SETTING_SEARCH_SUB_FOLDERS, m_bSearchSubFolders);
 	RegistrySettings::SaveDword(hKey, SETTING_USE_REGULAR_EXPRESSIONS, m_bUseRegularExpressions);
@@ -1292,6 +1839,11 @@ void SearchDialogPersistentSettings::SaveExtraRegistrySettings(HKEY hKey)
 	RegistrySettings::SaveDword(hKey, SETTING_HIDDEN, m_bHidden);
 	RegistrySettings::SaveDword(hKey, SETTING_READ_ONLY, m_bReadOnly);
 	RegistrySettings::SaveDword(hKey, SETTING_SYSTEM, m_bSystem);
+	RegistrySettings::SaveDword(hKey, SETTING_USE_INDEX, m_bUseIndex);
+	RegistrySettings::SaveString(hKey, SETTING_CONTENT_TEXT, m_szContentText);
+	RegistrySettings::SaveDword(hKey, SETTING_CONTENT_MAX_FILE_SIZE, m_dwContentMaxFileSize);
+	RegistrySettings::SaveDword(hKey, SETTING_CONTENT_READ_LIMIT, m_dwContentReadLimit);
+	RegistrySettings::SaveString(hKey, SETTING_FILTER_TEXT, m_szFilterText);
 	RegistrySettings::SaveDword(hKey, SETTING_SORT_MODE, static_cast<DWORD>(m_SortMode));
 	RegistrySettings::SaveDword(hKey, SETTING_SORT_ASCENDING, m_bSortAscending);
 
@@ -1310,6 +1862,8 @@ void SearchDialogPersistentSettings::LoadExtraRegistrySettings(HKEY hKey)
 		hKey, SETTING_COLUMN_WIDTH_1, reinterpret_cast<LPDWORD>(&m_iColumnWidth1));
 	RegistrySettings::ReadDword(
 		hKey, SETTING_COLUMN_WIDTH_2, reinterpret_cast<LPDWORD>(&m_iColumnWidth2));
+	RegistrySettings::ReadDword(
+		hKey, SETTING_COLUMN_WIDTH_3, reinterpret_cast<LPDWORD>(&m_iColumnWidth3));
 	RegistrySettings::ReadString(
 		hKey, SETTING_SEARCH_DIRECTORY_TEXT, m_szSearchPattern, SIZEOF_ARRAY(m_szSearchPattern));
 	RegistrySettings::ReadDword(
@@ -1322,6 +1876,13 @@ void SearchDialogPersistentSettings::LoadExtraRegistrySettings(HKEY hKey)
 	RegistrySettings::ReadDword(hKey, SETTING_HIDDEN, reinterpret_cast<LPDWORD>(&m_bHidden));
 	RegistrySettings::ReadDword(hKey, SETTING_READ_ONLY, reinterpret_cast<LPDWORD>(&m_bReadOnly));
 	RegistrySettings::ReadDword(hKey, SETTING_SYSTEM, reinterpret_cast<LPDWORD>(&m_bSystem));
+	RegistrySettings::ReadDword(hKey, SETTING_USE_INDEX, reinterpret_cast<LPDWORD>(&m_bUseIndex));
+	RegistrySettings::ReadString(
+		hKey, SETTING_CONTENT_TEXT, m_szContentText, SIZEOF_ARRAY(m_szContentText));
+	RegistrySettings::ReadDword(hKey, SETTING_CONTENT_MAX_FILE_SIZE, &m_dwContentMaxFileSize);
+	RegistrySettings::ReadDword(hKey, SETTING_CONTENT_READ_LIMIT, &m_dwContentReadLimit);
+	RegistrySettings::ReadString(
+		hKey, SETTING_FILTER_TEXT, m_szFilterText, SIZEOF_ARRAY(m_szFilterText));
 	RegistrySettings::ReadDword(
 		hKey, SETTING_SORT_ASCENDING, reinterpret_cast<LPDWORD>(&m_bSortAscending));
 
@@ -1345,6 +1906,8 @@ void SearchDialogPersistentSettings::SaveExtraXMLSettings(
 		NXMLSettings::EncodeIntValue(m_iColumnWidth1));
 	NXMLSettings::AddAttributeToNode(pXMLDom, pParentNode, SETTING_COLUMN_WIDTH_2,
 		NXMLSettings::EncodeIntValue(m_iColumnWidth2));
+	NXMLSettings::AddAttributeToNode(pXMLDom, pParentNode, SETTING_COLUMN_WIDTH_3,
+		NXMLSettings::EncodeIntValue(m_iColumnWidth3));
 	NXMLSettings::AddAttributeToNode(
 		pXMLDom, pParentNode, SETTING_SEARCH_DIRECTORY_TEXT, m_szSearchPattern);
 	NXMLSettings::AddAttributeToNode(pXMLDom, pParentNode, SETTING_SEARCH_SUB_FOLDERS,
@@ -1361,6 +1924,14 @@ void SearchDialogPersistentSettings::SaveExtraXMLSettings(
 		pXMLDom, pParentNode, SETTING_READ_ONLY, NXMLSettings::EncodeBoolValue(m_bReadOnly));
 	NXMLSettings::AddAttributeToNode(
 		pXMLDom, pParentNode, SETTING_SYSTEM, NXMLSettings::EncodeBoolValue(m_bSystem));
+	NXMLSettings::AddAttributeToNode(
+		pXMLDom, pParentNode, SETTING_USE_INDEX, NXMLSettings::EncodeBoolValue(m_bUseIndex));
+	NXMLSettings::AddAttributeToNode(pXMLDom, pParentNode, SETTING_CONTENT_TEXT, m_szContentText);
+	NXMLSettings::AddAttributeToNode(pXMLDom, pParentNode, SETTING_CONTENT_MAX_FILE_SIZE,
+		NXMLSettings::EncodeIntValue(static_cast<int>(m_dwContentMaxFileSize)));
+	NXMLSettings::AddAttributeToNode(pXMLDom, pParentNode, SETTING_CONTENT_READ_LIMIT,
+		NXMLSettings::EncodeIntValue(static_cast<int>(m_dwContentReadLimit)));
+	NXMLSettings::AddAttributeToNode(pXMLDom, pParentNode, SETTING_FILTER_TEXT, m_szFilterText);
 	NXMLSettings::AddAttributeToNode(pXMLDom, pParentNode, SETTING_SORT_MODE,
 		NXMLSettings::EncodeIntValue(static_cast<int>(m_SortMode)));
 	NXMLSettings::AddAttributeToNode(pXMLDom, pParentNode, SETTING_SORT_ASCENDING,
@@ -1387,6 +1958,10 @@ void SearchDialogPersistentSettings::LoadExtraXMLSettings(BSTR bstrName, BSTR bs
 	{
 		m_iColumnWidth2 = NXMLSettings::DecodeIntValue(bstrValue);
 	}
+	else if (lstrcmpi(bstrName, SETTING_COLUMN_WIDTH_3) == 0)
+	{
+		m_iColumnWidth3 = NXMLSettings::DecodeIntValue(bstrValue);
+	}
 	else if (lstrcmpi(bstrName, SETTING_SEARCH_DIRECTORY_TEXT) == 0)
 	{
 		StringCchCopy(m_szSearchPattern, SIZEOF_ARRAY(m_szSearchPattern), bstrValue);
@@ -1419,6 +1994,26 @@ void SearchDialogPersistentSettings::LoadExtraXMLSettings(BSTR bstrName, BSTR bs
 	{
 		m_bSystem = NXMLSettings::DecodeBoolValue(bstrValue);
 	}
+	else if (lstrcmpi(bstrName, SETTING_USE_INDEX) == 0)
+	{
+		m_bUseIndex = NXMLSettings::DecodeBoolValue(bstrValue);
+	}
+	else if (lstrcmpi(bstrName, SETTING_CONTENT_TEXT) == 0)
+	{
+		StringCchCopy(m_szContentText, SIZEOF_ARRAY(m_szContentText), bstrValue);
+	}
+	else if (lstrcmpi(bstrName, SETTING_CONTENT_MAX_FILE_SIZE) == 0)
+	{
+		m_dwContentMaxFileSize = NXMLSettings::DecodeIntValue(bstrValue);
+	}
+	else if (lstrcmpi(bstrName, SETTING_CONTENT_READ_LIMIT) == 0)
+	{
+		m_dwContentReadLimit = NXMLSettings::DecodeIntValue(bstrValue);
+	}
+	else if (lstrcmpi(bstrName, SETTING_FILTER_TEXT) == 0)
+	{
+		StringCchCopy(m_szFilterText, SIZEOF_ARRAY(m_szFilterText), bstrValue);
+	}
 	else if (lstrcmpi(bstrName, SETTING_SORT_MODE) == 0)
 	{
 		m_SortMode = static_cast<SortMode>(NXMLSettings::DecodeIntValue(bstrValue));
@@ -6,17 +6,26 @@
 
 #include "DarkModeDialogBase.h"
 #include "../Helper/DialogSettings.h"
+#include "../Helper/FileContentSearcher.h"
 #include "../Helper/FileContextMenuManager.h"
+#include "../Helper/ParallelDirectoryWalker.h"
 #include "../Helper/ReferenceCount.h"
+#include "../Helper/SearchFilter.h"
+#include "../Helper/SearchPredicate.h"
+#include "../Helper/ThroughputLimiter.h"
 #include <boost/circular_buffer.hpp>
 #include <MsXml2.h>
 #include <objbase.h>
+#include <atomic>
+#include <chrono>
 #include <list>
-#include <regex>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
+__interface IDirectoryMonitor;
 __interface IExplorerplusplus;
 class SearchDialog;
 class TabContainer;
@@ -34,6 +43,7 @@ private:
 
 	static const TCHAR SETTING_COLUMN_WIDTH_1[];
 	static const TCHAR SETTING_COLUMN_WIDTH_2[];
+	static const TCHAR SETTING_COLUMN_WIDTH_3[];
 	static const TCHAR SETTING_SEARCH_DIRECTORY_TEXT[];
 	static const TCHAR SETTING_SEARCH_SUB_FOLDERS[];
 	static const TCHAR SETTING_USE_REGULAR_EXPRESSIONS[];
@@ -42,6 +52,11 @@ private:
 	static const TCHAR SETTING_HIDDEN[];
 	static const TCHAR SETTING_READ_ONLY[];
 	static const TCHAR SETTING_SYSTEM[];
+	static const TCHAR SETTING_USE_INDEX[];
+	static const TCHAR SETTING_CONTENT_TEXT[];
+	static const TCHAR SETTING_CONTENT_MAX_FILE_SIZE[];
+	static const TCHAR SETTING_CONTENT_READ_LIMIT[];
+	static const TCHAR SETTING_FILTER_TEXT[];
 	static const TCHAR SETTING_DIRECTORY_LIST[];
 	static const TCHAR SETTING_PATTERN_LIST[];
 	static const TCHAR SETTING_SORT_MODE[];
@@ -50,7 +65,8 @@ private:
 	enum class SortMode
 	{
 		Name = 1,
-		Path = 2
+		Path = 2,
+		Lines = 3
 	};
 
 	struct ColumnInfo
@@ -81,6 +97,8 @@ private:
 	void ListToCircularBuffer(const std::list<T> &list, boost::circular_buffer<T> &cb);
 
 	TCHAR m_szSearchPattern[MAX_PATH];
+	TCHAR m_szContentText[MAX_PATH];
+	TCHAR m_szFilterText[MAX_PATH];
 	boost::circular_buffer<std::wstring> m_searchPatterns;
 	boost::circular_buffer<std::wstring> m_searchDirectories;
 	BOOL m_bSearchSubFolders;
@@ -90,6 +108,12 @@ private:
 	BOOL m_bHidden;
 	BOOL m_bReadOnly;
 	BOOL m_bSystem;
+	BOOL m_bUseIndex;
+
+	// These two aren't exposed in the dialog. The size limit is in MB, while the read limit is
+	// in KB/s (with 0 meaning that reads aren't limited).
+	DWORD m_dwContentMaxFileSize;
+	DWORD m_dwContentReadLimit;
 
 	std::vector<ColumnInfo> m_Columns;
 	SortMode m_SortMode;
@@ -97,22 +121,101 @@ private:
 
 	int m_iColumnWidth1;
 	int m_iColumnWidth2;
+	int m_iColumnWidth3;
+};
+
+// A single search result. Only the information returned by the directory enumeration is stored.
+// Everything else (e.g. the icon) is retrieved once the result is actually displayed.
+struct SearchResult
+{
+	std::wstring name;
+	DWORD attributes;
+	ULONGLONG size;
+	FILETIME lastWriteTime;
+
+	// The lines that contain the text being searched for. Only set when searching file contents.
+	std::vector<int> lineNumbers;
+
+	// An index into the list of directories held by the dialog. This is only set once the result
+	// has been received by the dialog.
+	int directoryIndex = -1;
+
+	std::optional<int> iconIndex;
+
+	// Built the first time the results are sorted by name.
+	std::string nameSortKey;
+};
+
+// Results are sent to the dialog in blocks, with each block containing results from a single
+// directory.
+struct SearchResultBlock
+{
+	std::wstring directory;
+	std::vector<SearchResult> results;
 };
 
 class Search : public ReferenceCount
 {
 public:
 	Search(HWND hDlg, TCHAR *szBaseDirectory, TCHAR *szPattern, DWORD dwAttributes,
-		BOOL bUseRegularExpressions, BOOL bCaseInsensitive, BOOL bSearchSubFolders);
-	~Search();
+		BOOL bUseRegularExpressions, BOOL bCaseInsensitive, BOOL bSearchSubFolders,
+		BOOL bUseIndex, IDirectoryMonitor *directoryMonitor, TCHAR *szContentText,
+		ULONGLONG contentMaxFileSize, ULONGLONG contentReadLimit, SearchFilter filter);
+
+	// A snapshot of the progress of a search.
+	struct Status
+	{
+		std::wstring currentDirectory;
+		int foldersFound = 0;
+		int filesFound = 0;
+		int entriesSearched = 0;
+	};
 
 	void StartSearching();
 	void StopSearching();
 
+	// Can be called from any thread while the search is running. Neither the workers nor the
+	// caller ever wait on each other, so the current directory will be left empty if it happens
+	// to be being updated at the time.
+	Status GetStatus() const;
+
+	std::wstring GetBaseDirectory() const;
+	bool GetSearchSubFolders() const;
+
+	// Checks a single item against the search, once the search has finished. This is used to keep
+	// the results up to date as items change. The contents of the item aren't checked, so this is
+	// cheap enough to call on the UI thread.
+	bool DoesItemMatch(const std::wstring &directory, const WIN32_FIND_DATA &wfd) const;
+
+	// Checks the contents of an item that's already matched above. This reads the item, so it
+	// shouldn't be called on the UI thread.
+	bool DoesItemContentMatch(const std::wstring &directory, const WIN32_FIND_DATA &wfd) const;
+	bool HasContentCriteria() const;
+
 private:
-	void SearchDirectory(const TCHAR *szDirectory);
-	void SearchDirectoryInternal(
-		const TCHAR *szSearchDirectory, std::list<std::wstring> *pSubFolderList);
+	// Each worker counts its own progress, so that the workers never contend over the counts.
+	// The counts are atomic only so that they can be read while the search is running.
+	struct alignas(64) WorkerResults
+	{
+		std::atomic<int> foldersFound = 0;
+		std::atomic<int> filesFound = 0;
+		std::atomic<int> entriesSearched = 0;
+
+		// Matches from the directory the worker is currently enumerating.
+		std::unique_ptr<SearchResultBlock> pendingBlock;
+	};
+
+	static const size_t MAX_RESULTS_PER_BLOCK = 256;
+
+	void SearchIndex();
+	void OnDirectoryEntered(int workerIndex, const std::wstring &directory);
+	void OnEntryFound(int workerIndex, const std::wstring &directory, const WIN32_FIND_DATA &wfd);
+	bool ShouldSearchSubdirectory(const WIN32_FIND_DATA &wfd, int depth) const;
+	bool IsDirectoryPruned(const std::wstring &directory) const;
+	bool DoesEntryMatch(const SearchEntry &entry) const;
+	bool DoesContentMatch(const std::wstring &directory, SearchResult &result) const;
+	void AddResult(int workerIndex, const std::wstring &directory, SearchResult result);
+	void SendPendingResults(int workerIndex);
 
 	HWND m_hDlg;
 
@@ -122,14 +225,36 @@ private:
 	BOOL m_bUseRegularExpressions;
 	BOOL m_bCaseInsensitive;
 	BOOL m_bSearchSubFolders;
-
-	std::wregex m_rxPattern;
-
-	CRITICAL_SECTION m_csStop;
-	BOOL m_bStopSearching;
-
-	int m_iFoldersFound;
-	int m_iFilesFound;
+	BOOL m_bUseIndex;
+	IDirectoryMonitor *m_directoryMonitor;
+	TCHAR m_szContentText[MAX_PATH];
+	ULONGLONG m_contentMaxFileSize;
+	ULONGLONG m_contentReadLimit;
+
+	// Holds the attribute checks, followed by the predicates from the filter and finally the
+	// pattern (if any), so that the cheapest checks are made first.
+	AllOfPredicate m_predicate;
+
+	// The literals that any matching name has to contain. Used to narrow down the entries
+	// retrieved from the index.
+	std::vector<std::wstring> m_requiredLiterals;
+
+	// Decides which subdirectories are searched at all, based on the exclude and depth terms in
+	// the filter.
+	DirectoryPruner m_directoryPruner;
+
+	// Only set if there's text to search for within files. Files are searched on whichever worker
+	// found them, with the limiter (if any) shared between the workers.
+	std::optional<ThroughputLimiter> m_throughputLimiter;
+	std::optional<FileContentSearcher> m_contentSearcher;
+
+	ParallelDirectoryWalker m_walker;
+	std::vector<WorkerResults> m_workerResults;
+
+	// The directory most recently entered by any of the workers. A worker that finds the mutex
+	// already held simply skips its update, since a more recent directory will follow shortly.
+	mutable std::mutex m_currentDirectoryMutex;
+	std::wstring m_currentDirectory;
 };
 
 class SearchDialog : public DarkModeDialogBase, public IFileContextMenuExternal
@@ -147,11 +272,6 @@ public:
 	void HandleCustomMenuItem(PCIDLIST_ABSOLUTE pidlParent,
 		const std::vector<PITEMID_CHILD> &pidlItems, int iCmd) override;
 
-	/* Sorting methods. */
-	int CALLBACK SortResults(LPARAM lParam1, LPARAM lParam2);
-	int CALLBACK SortResultsByName(LPARAM lParam1, LPARAM lParam2);
-	int CALLBACK SortResultsByPath(LPARAM lParam1, LPARAM lParam2);
-
 protected:
 	INT_PTR OnInitDialog() override;
 	INT_PTR OnTimer(int iTimerID) override;
@@ -167,7 +287,6 @@ protected:
 private:
 	static const int SEARCH_PROCESSITEMS_TIMER_ID = 0;
 	static const int SEARCH_PROCESSITEMS_TIMER_ELAPSED = 50;
-	static const int SEARCH_MAX_ITEMS_BATCH_PROCESS = 100;
 
 	static const int MIN_SHELL_MENU_ID = 1;
 	static const int MAX_SHELL_MENU_ID = 1000;
@@ -181,8 +300,21 @@ private:
 	void OnSearch();
 	void StartSearching();
 	void StopSearching();
+	void OnOpenInTab();
+	void OnRebuildIndex();
 	void SaveEntry(int comboBoxId, boost::circular_buffer<std::wstring> &buffer);
 	void UpdateListViewHeader();
+	void UpdateSearchStatus();
+	void AddPendingResults();
+	void OnGetDispInfo(NMLVDISPINFO *dispInfo);
+	int GetSelectedResultIndex() const;
+	std::wstring GetResultPath(const SearchResult &result) const;
+	static std::wstring FormatLineNumbers(const std::vector<int> &lineNumbers);
+
+	/* Sorting methods. */
+	void SortResults();
+	void BuildSortKeys();
+	int CompareResults(const SearchResult &result1, const SearchResult &result2) const;
 
 	std::wstring m_searchDirectory;
 	wil::unique_hicon m_directoryIcon;
@@ -191,15 +323,26 @@ private:
 	TCHAR m_szSearchButton[32];
 
 	Search *m_pSearch;
-
-	/* Listview item information. */
-	std::list<PIDLIST_ABSOLUTE> m_AwaitingSearchItems;
-	std::unordered_map<int, std::wstring> m_SearchItemsMapInternal;
-	int m_iInternalIndex;
+	std::chrono::steady_clock::time_point m_searchStartTime;
+
+	// The most recent search, if it ran to completion. The results of the search can then be
+	// opened in a tab.
+	Search *m_completedSearch;
+
+	/* Listview item information. The listview is virtual, so each
+	item simply corresponds to an index into m_resultOrder, which in
+	turn holds the index of the result. Results are never reordered
+	once they've been added. */
+	std::vector<std::unique_ptr<SearchResultBlock>> m_pendingResultBlocks;
+	std::vector<SearchResult> m_results;
+	std::vector<int> m_resultOrder;
+	std::vector<std::wstring> m_resultDirectories;
+
+	// Used when sorting by path. Both are indexed in the same way as m_resultDirectories.
+	std::vector<std::string> m_resultDirectorySortKeys;
+	std::vector<int> m_resultDirectoryRanks;
 	int m_iPreviousSelectedColumn;
 
-	BOOL m_bSetSearchTimer;
-
 	IExplorerplusplus *m_pexpp;
 	TabContainer *m_tabContainer;
 
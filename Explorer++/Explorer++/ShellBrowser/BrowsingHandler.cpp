@@ -4,10 +4,12 @@
 
 #include "stdafx.h"
 #include "ShellBrowser.h"
+#include "ColorRuleHelper.h"
 #include "Config.h"
 #include "HistoryEntry.h"
 #include "ItemData.h"
 #include "MainResource.h"
+#include "SearchResultsFolder.h"
 #include "ShellNavigationController.h"
 #include "ViewModes.h"
 #include "../Helper/Helper.h"
@@ -22,7 +24,17 @@
 
 HRESULT ShellBrowser::BrowseFolder(const HistoryEntry &entry)
 {
-	HRESULT hr = BrowseFolder(entry.GetPidl().get(), false);
+	HRESULT hr;
+	auto searchResults = entry.GetSearchResults();
+
+	if (searchResults)
+	{
+		hr = BrowseSearchResults(searchResults, false);
+	}
+	else
+	{
+		hr = BrowseFolder(entry.GetPidl().get(), false);
+	}
 
 	if (SUCCEEDED(hr))
 	{
@@ -51,6 +63,218 @@ HRESULT ShellBrowser::BrowseFolder(PCIDLIST_ABSOLUTE pidlDirectory, bool addHist
 		return hr;
 	}
 
+	FinishBrowsing(pidlDirectory);
+
+	return hr;
+}
+
+HRESULT ShellBrowser::BrowseSearchResults(
+	std::shared_ptr<const SearchResultsFolder> searchResults, bool addHistoryEntry)
+{
+	unique_pidl_absolute pidlDirectory;
+	HRESULT hr = SHParseDisplayName(searchResults->rootDirectory.c_str(), nullptr,
+		wil::out_param(pidlDirectory), 0, nullptr);
+
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	SetCursor(LoadCursor(nullptr, IDC_WAIT));
+
+	auto resetCursor = wil::scope_exit([] {
+		SetCursor(LoadCursor(nullptr, IDC_ARROW));
+	});
+
+	m_navigationStartedSignal(pidlDirectory.get());
+
+	PrepareToChangeFolders();
+
+	m_directoryState.pidlDirectory.reset(ILCloneFull(pidlDirectory.get()));
+	m_directoryState.directory = searchResults->rootDirectory;
+	m_directoryState.searchResults = searchResults;
+	m_uniqueFolderId++;
+
+	m_navigationCommittedSignal(pidlDirectory.get(), addHistoryEntry);
+
+	// The history entry is only created (or selected) in response to the signal above. Storing the
+	// results in the entry means that going back to it, or refreshing it, will show the results
+	// again, rather than the contents of the root directory.
+	auto *entry = m_navigationController->GetCurrentEntry();
+
+	if (entry)
+	{
+		entry->SetSearchResults(searchResults);
+	}
+
+	QueueSearchResultsTask(searchResults);
+
+	FinishBrowsing(pidlDirectory.get());
+
+	return hr;
+}
+
+std::shared_ptr<const SearchResultsFolder> ShellBrowser::GetSearchResults() const
+{
+	return m_directoryState.searchResults;
+}
+
+// Parsing each result and retrieving its details can take a while when there are a large number of
+// results, so that's done in the background. The items are then added in batches, as they become
+// available.
+void ShellBrowser::QueueSearchResultsTask(std::shared_ptr<const SearchResultsFolder> searchResults)
+{
+	int searchResultsId = m_searchResultsIdCounter++;
+	m_latestSearchResultsId = searchResultsId;
+
+	m_searchResultsThreadPool.push(
+		[listView = m_hListView, searchResultsId, &latestSearchResultsId = m_latestSearchResultsId,
+			searchResults](int id) {
+			UNREFERENCED_PARAMETER(id);
+
+			BuildSearchResultsAsync(
+				listView, searchResultsId, latestSearchResultsId, searchResults->results);
+		});
+}
+
+// Each result is added with its own parent, so that the items behave exactly as they would in
+// their actual folder. The results arrive grouped by directory, so each parent folder generally
+// only needs to be bound to once.
+void ShellBrowser::BuildSearchResultsAsync(HWND listView, int searchResultsId,
+	const std::atomic<int> &latestSearchResultsId, const std::vector<std::wstring> &results)
+{
+	std::wstring currentDirectory;
+	unique_pidl_absolute pidlParent;
+	wil::com_ptr_nothrow<IShellFolder> parentFolder;
+	auto batch = std::make_unique<SearchResultsBatch>();
+	batch->searchResultsId = searchResultsId;
+
+	auto postBatch = [listView, searchResultsId, &batch]() {
+		auto *pendingBatch = batch.release();
+
+		batch = std::make_unique<SearchResultsBatch>();
+		batch->searchResultsId = searchResultsId;
+
+		// If the message can't be posted, the listview has been destroyed, so there's no point
+		// in continuing.
+		if (!PostMessage(listView, WM_APP_SEARCH_RESULTS_READY, 0,
+				reinterpret_cast<LPARAM>(pendingBatch)))
+		{
+			delete pendingBatch;
+			return false;
+		}
+
+		return true;
+	};
+
+	for (const auto &path : results)
+	{
+		// The user may have navigated away, in which case the results are no longer needed.
+		if (latestSearchResultsId != searchResultsId)
+		{
+			return;
+		}
+
+		TCHAR directory[MAX_PATH];
+		HRESULT hr = StringCchCopy(directory, SIZEOF_ARRAY(directory), path.c_str());
+
+		if (FAILED(hr) || !PathRemoveFileSpec(directory))
+		{
+			continue;
+		}
+
+		if (currentDirectory != directory)
+		{
+			currentDirectory = directory;
+			parentFolder.reset();
+
+			hr = SHParseDisplayName(directory, nullptr, wil::out_param(pidlParent), 0, nullptr);
+
+			if (SUCCEEDED(hr))
+			{
+				BindToIdl(pidlParent.get(), IID_PPV_ARGS(&parentFolder));
+			}
+		}
+
+		if (!parentFolder)
+		{
+			continue;
+		}
+
+		// The item may have been removed since the search was run.
+		unique_pidl_absolute pidlItem;
+		hr = SHParseDisplayName(path.c_str(), nullptr, wil::out_param(pidlItem), 0, nullptr);
+
+		if (FAILED(hr))
+		{
+			continue;
+		}
+
+		// Search results are always filesystem items, so none of them can be in the recycle bin.
+		unique_pidl_child pidlChild(ILCloneChild(ILFindLastID(pidlItem.get())));
+		auto itemInfo =
+			BuildItemInformation(parentFolder.get(), pidlParent.get(), pidlChild.get(), false);
+
+		if (!itemInfo)
+		{
+			continue;
+		}
+
+		batch->items.push_back(std::move(*itemInfo));
+
+		if (batch->items.size() >= SEARCH_RESULTS_BATCH_SIZE && !postBatch())
+		{
+			return;
+		}
+	}
+
+	if (!batch->items.empty())
+	{
+		postBatch();
+	}
+}
+
+void ShellBrowser::ProcessSearchResultsBatch(SearchResultsBatch &batch)
+{
+	if (batch.searchResultsId != m_latestSearchResultsId)
+	{
+		// This batch is for a previous folder.
+		return;
+	}
+
+	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
+
+	for (auto &itemInfo : batch.items)
+	{
+		// The item may already have been added in response to a change notification.
+		if (GetItemInternalIndexForPath(itemInfo.parsingName))
+		{
+			continue;
+		}
+
+		itemInfo.colorRuleColor = m_colorRuleMatcher->GetColorForItem(
+			PathFindFileName(itemInfo.parsingName.c_str()), itemInfo.wfd.dwFileAttributes);
+
+		AddItemInternal(-1, std::move(itemInfo), FALSE);
+	}
+
+	InsertAwaitingItems(FALSE);
+	SortFolder(m_folderSettings.sortMode);
+
+	SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
+
+	SendMessage(m_hOwner, WM_USER_UPDATEWINDOWS, 0, 0);
+}
+
+void ShellBrowser::ClearPendingSearchResults()
+{
+	m_latestSearchResultsId = -1;
+	m_searchResultsThreadPool.clear_queue();
+	m_searchContentThreadPool.clear_queue();
+}
+
+void ShellBrowser::FinishBrowsing(PCIDLIST_ABSOLUTE pidlDirectory)
+{
 	/* Stop the list view from redrawing itself each time is inserted.
 	Redrawing will be allowed once all items have being inserted.
 	(reduces lag when a large number of items are going to be inserted). */
@@ -80,8 +304,6 @@ HRESULT ShellBrowser::BrowseFolder(PCIDLIST_ABSOLUTE pidlDirectory, bool addHist
 	m_bFolderVisited = TRUE;
 
 	m_navigationCompletedSignal(pidlDirectory);
-
-	return hr;
 }
 
 void ShellBrowser::PrepareToChangeFolders()
@@ -126,6 +348,14 @@ void ShellBrowser::ClearPendingResults()
 
 	m_infoTipsThreadPool.clear_queue();
 	m_infoTipResults.clear();
+
+	// The items in the new folder will be filtered using the current filter as they're added.
+	ClearPendingFilterResults();
+	m_appliedFilterMatcher = m_filterMatcher;
+
+	ClearPendingFolderSizes();
+
+	ClearPendingSearchResults();
 }
 
 void ShellBrowser::ResetFolderState()
@@ -263,6 +493,7 @@ int ShellBrowser::AddItemInternal(int itemIndex, ItemInfo_t itemInfo, BOOL setPo
 {
 	int itemId = GenerateUniqueItemId();
 	m_itemInfoMap.insert({ itemId, std::move(itemInfo) });
+	IndexSearchResult(itemId);
 
 	AwaitingAdd_t awaitingAdd;
 
@@ -287,6 +518,31 @@ int ShellBrowser::AddItemInternal(int itemIndex, ItemInfo_t itemInfo, BOOL setPo
 
 std::optional<ShellBrowser::ItemInfo_t> ShellBrowser::GetItemInformation(
 	IShellFolder *shellFolder, PCIDLIST_ABSOLUTE pidlDirectory, PCITEMID_CHILD pidlChild)
+{
+	bool isRecycleBin = m_recycleBinPidl
+		&& m_desktopFolder->CompareIDs(SHCIDS_CANONICALONLY, pidlDirectory, m_recycleBinPidl.get())
+			== 0;
+
+	auto itemInfo = BuildItemInformation(shellFolder, pidlDirectory, pidlChild, isRecycleBin);
+
+	if (!itemInfo)
+	{
+		return std::nullopt;
+	}
+
+	// Since this method is used whenever an item is added, modified or renamed, the color rules
+	// only need to be evaluated here (and when the rules themselves change).
+	itemInfo->colorRuleColor = m_colorRuleMatcher->GetColorForItem(
+		PathFindFileName(itemInfo->parsingName.c_str()), itemInfo->wfd.dwFileAttributes);
+
+	return itemInfo;
+}
+
+// This doesn't depend on any of the state of the browser, so it can be called from a background
+// thread.
+std::optional<ShellBrowser::ItemInfo_t> ShellBrowser::BuildItemInformation(
+	IShellFolder *shellFolder, PCIDLIST_ABSOLUTE pidlDirectory, PCITEMID_CHILD pidlChild,
+	bool isRecycleBin)
 {
 	ItemInfo_t itemInfo;
 
@@ -316,10 +572,6 @@ std::optional<ShellBrowser::ItemInfo_t> ShellBrowser::GetItemInformation(
 
 	SHGDNF displayNameFlags = SHGDN_INFOLDER;
 
-	bool isRecycleBin = m_recycleBinPidl
-		&& m_desktopFolder->CompareIDs(SHCIDS_CANONICALONLY, pidlDirectory, m_recycleBinPidl.get())
-			== 0;
-
 	// SHGDN_INFOLDER | SHGDN_FORPARSING is used to ensure that the name retrieved for a filesystem
 	// file contains an extension, even if extensions are hidden in Windows Explorer. When using
 	// SHGDN_INFOLDER by itself, the resulting name won't contain an extension if extensions are
@@ -564,6 +816,8 @@ void ShellBrowser::InsertAwaitingItems(BOOL bInsertIntoGroup)
 
 		m_directoryState.totalDirSize.QuadPart += ulFileSize.QuadPart;
 
+		QueueFolderSizeTask(awaitingItem.iItemInternal);
+
 		nAdded++;
 	}
 
@@ -578,6 +832,8 @@ void ShellBrowser::InsertAwaitingItems(BOOL bInsertIntoGroup)
 
 	m_directoryState.awaitingAddList.clear();
 
+	ScheduleFolderSizeTasks();
+
 	if (itemToRename)
 	{
 		m_queuedRenameItem.reset();
@@ -665,6 +921,8 @@ void ShellBrowser::RemoveItem(int iItemInternal)
 		ListView_DeleteItem(m_hListView, iItem);
 	}
 
+	RemovePendingFolderSize(iItemInternal);
+	RemoveSearchResultFromIndex(iItemInternal);
 	m_itemInfoMap.erase(iItemInternal);
 
 	nItems = ListView_GetItemCount(m_hListView);
@@ -9,7 +9,6 @@
 #include "ItemData.h"
 #include "../Helper/DriveInfo.h"
 #include "../Helper/FileOperations.h"
-#include "../Helper/FolderSize.h"
 #include "../Helper/Helper.h"
 #include "../Helper/Macros.h"
 #include "../Helper/StringHelper.h"
@@ -256,19 +255,9 @@ std::wstring GetSizeColumnText(
 
 	if ((itemInfo.wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == FILE_ATTRIBUTE_DIRECTORY)
 	{
-		TCHAR drive[MAX_PATH];
-		StringCchCopy(drive, SIZEOF_ARRAY(drive), itemInfo.getFullPath().c_str());
-		PathStripToRoot(drive);
-
-		bool bNetworkRemovable = false;
-
-		if (GetDriveType(drive) == DRIVE_REMOVABLE || GetDriveType(drive) == DRIVE_REMOTE)
-		{
-			bNetworkRemovable = true;
-		}
-
-		if (globalFolderSettings.showFolderSizes
-			&& !(globalFolderSettings.disableFolderSizesNetworkRemovable && bNetworkRemovable))
+		// Folder sizes are calculated in the background. Until the size of a folder is known (or
+		// if it's never going to be calculated), the column is left blank.
+		if (globalFolderSettings.showFolderSizes && itemInfo.folderSize)
 		{
 			return GetFolderSizeColumnText(itemInfo, globalFolderSettings);
 		}
@@ -290,16 +279,8 @@ std::wstring GetSizeColumnText(
 std::wstring GetFolderSizeColumnText(
 	const BasicItemInfo_t &itemInfo, const GlobalFolderSettings &globalFolderSettings)
 {
-	auto folderInfo = GetFolderInfo(itemInfo.getFullPath());
-
-	/* TODO: This should
-	be done some other way.
-	Shouldn't depend on
-	the internal index. */
-	// m_cachedFolderSizes.insert({internalIndex, totalFolderSize.QuadPart});
-
 	ULARGE_INTEGER size;
-	size.QuadPart = folderInfo.size;
+	size.QuadPart = itemInfo.folderSize.value_or(0);
 
 	TCHAR fileSizeText[64];
 	FormatSizeString(size, fileSizeText, SIZEOF_ARRAY(fileSizeText), globalFolderSettings.forceSize,
@@ -6,7 +6,9 @@
 #include "ShellBrowser.h"
 #include "Config.h"
 #include "ItemData.h"
+#include "SearchResultsFolder.h"
 #include "ShellNavigationController.h"
+#include "SortHelper.h"
 #include "ViewModes.h"
 #include "../Helper/ListViewHelper.h"
 #include "../Helper/Logging.h"
@@ -16,11 +18,28 @@
 
 int g_iRenamedItem = -1;
 
+namespace
+{
+	std::optional<std::wstring> GetParentDirectory(const std::wstring &path)
+	{
+		TCHAR directory[MAX_PATH];
+		HRESULT hr = StringCchCopy(directory, SIZEOF_ARRAY(directory), path.c_str());
+
+		if (FAILED(hr) || !PathRemoveFileSpec(directory))
+		{
+			return std::nullopt;
+		}
+
+		return std::wstring(directory);
+	}
+}
+
 void ShellBrowser::StartDirectoryMonitoring(PCIDLIST_ABSOLUTE pidl)
 {
+	// The results of a recursive search can come from anywhere below the root directory.
 	SHChangeNotifyEntry shcne;
 	shcne.pidl = pidl;
-	shcne.fRecursive = FALSE;
+	shcne.fRecursive = m_directoryState.searchResults && m_directoryState.searchResults->recursive;
 	m_shChangeNotifyId = SHChangeNotifyRegister(m_hListView,
 		SHCNRF_ShellLevel | SHCNRF_InterruptLevel | SHCNRF_NewDelivery,
 		SHCNE_ATTRIBUTES | SHCNE_CREATE | SHCNE_DELETE | SHCNE_MKDIR | SHCNE_RENAMEFOLDER
@@ -86,7 +105,7 @@ void ShellBrowser::ProcessShellChangeNotification(const ShellChangeNotification
 	{
 	case SHCNE_MKDIR:
 	case SHCNE_CREATE:
-		if (ILIsParent(m_directoryState.pidlDirectory.get(), change.pidl1.get(), TRUE))
+		if (IsWithinCurrentFolder(change.pidl1.get()))
 		{
 			AddItem(change.pidl1.get());
 		}
@@ -94,8 +113,7 @@ void ShellBrowser::ProcessShellChangeNotification(const ShellChangeNotification
 
 	case SHCNE_RENAMEFOLDER:
 	case SHCNE_RENAMEITEM:
-		if (ILIsParent(m_directoryState.pidlDirectory.get(), change.pidl1.get(), TRUE)
-			&& ILIsParent(m_directoryState.pidlDirectory.get(), change.pidl2.get(), TRUE))
+		if (IsWithinCurrentFolder(change.pidl1.get()) && IsWithinCurrentFolder(change.pidl2.get()))
 		{
 			// The pidls provided to these change notifications are always simple pidls. When an
 			// item is updated, the WIN32_FIND_DATA information cached in the pidl will be
@@ -114,7 +132,7 @@ void ShellBrowser::ProcessShellChangeNotification(const ShellChangeNotification
 		break;
 
 	case SHCNE_UPDATEITEM:
-		if (ILIsParent(m_directoryState.pidlDirectory.get(), change.pidl1.get(), TRUE))
+		if (IsWithinCurrentFolder(change.pidl1.get()))
 		{
 			unique_pidl_absolute pidlFull;
 			HRESULT hr = SimplePidlToFullPidl(change.pidl1.get(), wil::out_param(pidlFull));
@@ -127,7 +145,10 @@ void ShellBrowser::ProcessShellChangeNotification(const ShellChangeNotification
 		break;
 
 	case SHCNE_UPDATEDIR:
-		if (ArePidlsEquivalent(m_directoryState.pidlDirectory.get(), change.pidl1.get()))
+		// Refreshing a set of search results would only show the original results again, so the
+		// individual changes are relied on instead.
+		if (!m_directoryState.searchResults
+			&& ArePidlsEquivalent(m_directoryState.pidlDirectory.get(), change.pidl1.get()))
 		{
 			m_navigationController->Refresh();
 		}
@@ -139,7 +160,7 @@ void ShellBrowser::ProcessShellChangeNotification(const ShellChangeNotification
 		// that directory. However, if the user has just changed directories, a notification could
 		// still come in for the previous directory. Therefore, it's important to verify that the
 		// item is actually a child of the current directory.
-		if (ILIsParent(m_directoryState.pidlDirectory.get(), change.pidl1.get(), TRUE))
+		if (IsWithinCurrentFolder(change.pidl1.get()))
 		{
 			OnItemRemoved(change.pidl1.get());
 		}
@@ -308,7 +329,7 @@ void ShellBrowser::OnFileAdded(const TCHAR *szFileName)
 	}
 }
 
-void ShellBrowser::AddItem(PCIDLIST_ABSOLUTE pidl)
+void ShellBrowser::AddItem(PCIDLIST_ABSOLUTE pidl, bool searchContentChecked)
 {
 	wil::com_ptr_nothrow<IShellFolder> shellFolder;
 	PCITEMID_CHILD pidlChild = nullptr;
@@ -319,15 +340,23 @@ void ShellBrowser::AddItem(PCIDLIST_ABSOLUTE pidl)
 		return;
 	}
 
-	auto itemId = AddItemInternal(
-		shellFolder.get(), m_directoryState.pidlDirectory.get(), pidlChild, -1, FALSE);
+	auto itemInfo = GetItemInformation(shellFolder.get(), GetItemParentIdl(pidl).get(), pidlChild);
+
+	if (!itemInfo || !DoesItemMatchSearch(*itemInfo))
+	{
+		return;
+	}
 
-	if (!itemId)
+	// If the contents of the item also need to be checked, the item will only be added once that
+	// check has completed.
+	if (!searchContentChecked && QueueSearchContentCheck(*itemInfo))
 	{
 		return;
 	}
 
-	const std::wstring displayName = m_itemInfoMap.at(*itemId).displayName;
+	int itemId = AddItemInternal(-1, std::move(*itemInfo), FALSE);
+
+	const std::wstring displayName = m_itemInfoMap.at(itemId).displayName;
 	auto droppedFilesItr = std::find_if(m_droppedFileNameList.begin(), m_droppedFileNameList.end(),
 		[&displayName](const DroppedFile_t &droppedFile) {
 			return displayName == droppedFile.szFileName;
@@ -340,11 +369,11 @@ void ShellBrowser::AddItem(PCIDLIST_ABSOLUTE pidl)
 	{
 		// TODO: It would be better to pass the items details to this function directly
 		// instead (before the item is added to the awaiting list).
-		int sortedPosition = DetermineItemSortedPosition(*itemId);
+		int sortedPosition = DetermineItemSortedPosition(itemId);
 
 		auto itr = std::find_if(m_directoryState.awaitingAddList.begin(),
 			m_directoryState.awaitingAddList.end(), [itemId](const AwaitingAdd_t &awaitingItem) {
-				return *itemId == awaitingItem.iItemInternal;
+				return itemId == awaitingItem.iItemInternal;
 			});
 
 		// The item was added successfully above, so should be in the list of awaiting
@@ -367,10 +396,41 @@ void ShellBrowser::OnItemRemoved(PCIDLIST_ABSOLUTE pidl)
 	{
 		RemoveItem(*internalIndex);
 	}
+
+	if (m_directoryState.searchResults)
+	{
+		std::wstring path;
+		HRESULT hr = GetDisplayName(pidl, SHGDN_FORPARSING, path);
+
+		if (SUCCEEDED(hr))
+		{
+			RemoveSearchResultsWithin(path);
+		}
+	}
 }
 
 void ShellBrowser::OnFileRemoved(const TCHAR *szFileName)
 {
+	// When a set of search results is being shown, the name may be relative to a subdirectory, so
+	// it can't simply be compared against the name of each item.
+	if (m_directoryState.searchResults)
+	{
+		TCHAR fullFileName[MAX_PATH];
+		StringCchCopy(fullFileName, SIZEOF_ARRAY(fullFileName), m_directoryState.directory.c_str());
+		PathAppend(fullFileName, szFileName);
+
+		auto internalIndex = GetItemInternalIndexForPath(fullFileName);
+
+		if (internalIndex)
+		{
+			RemoveItem(*internalIndex);
+		}
+
+		RemoveSearchResultsWithin(fullFileName);
+
+		return;
+	}
+
 	int iItemInternal = LocateFileItemInternalIndex(szFileName);
 
 	if (iItemInternal != -1)
@@ -396,12 +456,19 @@ void ShellBrowser::OnFileModified(const TCHAR *fileName)
 	ModifyItem(pidlFull.get());
 }
 
-void ShellBrowser::ModifyItem(PCIDLIST_ABSOLUTE pidl)
+void ShellBrowser::ModifyItem(PCIDLIST_ABSOLUTE pidl, bool searchContentChecked)
 {
 	auto internalIndex = GetItemInternalIndexForPidl(pidl);
 
 	if (!internalIndex)
 	{
+		// A change to an item (e.g. to its size or contents) can cause it to start matching the
+		// search.
+		if (m_directoryState.searchResults)
+		{
+			AddItem(pidl, searchContentChecked);
+		}
+
 		return;
 	}
 
@@ -414,23 +481,40 @@ void ShellBrowser::ModifyItem(PCIDLIST_ABSOLUTE pidl)
 		return;
 	}
 
-	auto itemInfo =
-		GetItemInformation(shellFolder.get(), m_directoryState.pidlDirectory.get(), pidlChild);
+	auto itemInfo = GetItemInformation(shellFolder.get(), GetItemParentIdl(pidl).get(), pidlChild);
 
 	if (!itemInfo)
 	{
 		return;
 	}
 
+	if (!DoesItemMatchSearch(*itemInfo))
+	{
+		RemoveItem(*internalIndex);
+		return;
+	}
+
+	// The item is left as is until its updated contents have been checked.
+	if (!searchContentChecked && QueueSearchContentCheck(*itemInfo))
+	{
+		return;
+	}
+
 	ULARGE_INTEGER oldFileSize = { m_itemInfoMap[*internalIndex].wfd.nFileSizeLow,
 		m_itemInfoMap[*internalIndex].wfd.nFileSizeHigh };
 	ULARGE_INTEGER newFileSize = { itemInfo->wfd.nFileSizeLow, itemInfo->wfd.nFileSizeHigh };
 
 	m_directoryState.totalDirSize.QuadPart += newFileSize.QuadPart - oldFileSize.QuadPart;
 
+	CarryOverCachedItemData(m_itemInfoMap[*internalIndex], *itemInfo, true);
+	RemoveSearchResultFromIndex(*internalIndex);
 	m_itemInfoMap[*internalIndex] = std::move(*itemInfo);
+	IndexSearchResult(*internalIndex);
 	const ItemInfo_t &updatedItemInfo = m_itemInfoMap[*internalIndex];
 
+	// A change to a folder can mean that its size has changed as well.
+	InvalidateFolderSize(*internalIndex);
+
 	auto itemIndex = LocateItemByInternalIndex(*internalIndex);
 
 	if (!itemIndex)
@@ -478,6 +562,17 @@ void ShellBrowser::ModifyItem(PCIDLIST_ABSOLUTE pidl)
 
 void ShellBrowser::OnItemRenamed(PCIDLIST_ABSOLUTE pidlOld, PCIDLIST_ABSOLUTE pidlNew)
 {
+	if (m_directoryState.searchResults)
+	{
+		std::wstring oldPath;
+		HRESULT hr = GetDisplayName(pidlOld, SHGDN_FORPARSING, oldPath);
+
+		if (SUCCEEDED(hr))
+		{
+			RemoveSearchResultsWithin(oldPath);
+		}
+	}
+
 	auto internalIndex = GetItemInternalIndexForPidl(pidlOld);
 
 	if (internalIndex)
@@ -513,6 +608,8 @@ void ShellBrowser::OnFileRenamedOldName(const TCHAR *szFileName)
 		return;
 	}
 
+	RemoveSearchResultsWithin(fullFileName);
+
 	unique_pidl_absolute pidl;
 	hr = CreateSimplePidl(fullFileName, wil::out_param(pidl));
 
@@ -578,14 +675,24 @@ void ShellBrowser::RenameItem(int internalIndex, PCIDLIST_ABSOLUTE pidlNew)
 	}
 
 	auto itemInfo =
-		GetItemInformation(shellFolder.get(), m_directoryState.pidlDirectory.get(), pidlChild);
+		GetItemInformation(shellFolder.get(), GetItemParentIdl(pidlNew).get(), pidlChild);
 
 	if (!itemInfo)
 	{
 		return;
 	}
 
+	// Renaming an item doesn't change its contents, so only its name needs to be checked again.
+	if (!DoesItemMatchSearch(*itemInfo))
+	{
+		RemoveItem(internalIndex);
+		return;
+	}
+
+	CarryOverCachedItemData(m_itemInfoMap[internalIndex], *itemInfo, false);
+	RemoveSearchResultFromIndex(internalIndex);
 	m_itemInfoMap[internalIndex] = std::move(*itemInfo);
+	IndexSearchResult(internalIndex);
 	const ItemInfo_t &updatedItemInfo = m_itemInfoMap[internalIndex];
 
 	auto itemIndex = LocateItemByInternalIndex(internalIndex);
@@ -633,6 +740,223 @@ void ShellBrowser::RenameItem(int internalIndex, PCIDLIST_ABSOLUTE pidlNew)
 	}
 }
 
+bool ShellBrowser::IsWithinCurrentFolder(PCIDLIST_ABSOLUTE pidl) const
+{
+	// The results of a recursive search can come from anywhere below the root directory, whereas a
+	// regular folder only contains its immediate children.
+	bool immediate = !(m_directoryState.searchResults && m_directoryState.searchResults->recursive);
+
+	return ILIsParent(m_directoryState.pidlDirectory.get(), pidl, immediate);
+}
+
+// Items in a regular folder are always treated as children of that folder. That's important for
+// folders like the desktop, where the items can be reported using their actual filesystem paths.
+// Search results, on the other hand, each have their own parent.
+unique_pidl_absolute ShellBrowser::GetItemParentIdl(PCIDLIST_ABSOLUTE pidl) const
+{
+	if (!m_directoryState.searchResults)
+	{
+		return unique_pidl_absolute(ILCloneFull(m_directoryState.pidlDirectory.get()));
+	}
+
+	unique_pidl_absolute pidlParent(ILCloneFull(pidl));
+	ILRemoveLastID(pidlParent.get());
+
+	return pidlParent;
+}
+
+bool ShellBrowser::DoesItemMatchSearch(const ItemInfo_t &itemInfo) const
+{
+	if (!m_directoryState.searchResults)
+	{
+		return true;
+	}
+
+	auto directory = GetParentDirectory(itemInfo.parsingName);
+
+	if (!directory)
+	{
+		return false;
+	}
+
+	return m_directoryState.searchResults->matches(*directory, itemInfo.wfd);
+}
+
+// Returns true if the check was queued, in which case the result will be processed once the check
+// has completed.
+bool ShellBrowser::QueueSearchContentCheck(const ItemInfo_t &itemInfo)
+{
+	if (!m_directoryState.searchResults || !m_directoryState.searchResults->matchesContent)
+	{
+		return false;
+	}
+
+	auto directory = GetParentDirectory(itemInfo.parsingName);
+
+	if (!directory)
+	{
+		return false;
+	}
+
+	m_searchContentThreadPool.push(
+		[listView = m_hListView, searchResultsId = m_latestSearchResultsId.load(),
+			&latestSearchResultsId = m_latestSearchResultsId,
+			searchResults = m_directoryState.searchResults, directory = *directory,
+			path = itemInfo.parsingName, wfd = itemInfo.wfd](int id) {
+			UNREFERENCED_PARAMETER(id);
+
+			// There's no need to read the item if the user has navigated away.
+			if (latestSearchResultsId != searchResultsId)
+			{
+				return;
+			}
+
+			auto *result = new SearchContentResult{ searchResultsId, path,
+				searchResults->matchesContent(directory, wfd) };
+
+			if (!PostMessage(listView, WM_APP_SEARCH_CONTENT_RESULT_READY, 0,
+					reinterpret_cast<LPARAM>(result)))
+			{
+				delete result;
+			}
+		});
+
+	return true;
+}
+
+void ShellBrowser::ProcessSearchContentResult(const SearchContentResult &result)
+{
+	if (result.searchResultsId != m_latestSearchResultsId)
+	{
+		// This result is for a previous folder.
+		return;
+	}
+
+	if (!result.matches)
+	{
+		auto internalIndex = GetItemInternalIndexForPath(result.path);
+
+		if (internalIndex)
+		{
+			RemoveItem(*internalIndex);
+		}
+
+		return;
+	}
+
+	// The item may have changed again in the meantime, so its current details are retrieved. Any
+	// further change will queue another check.
+	unique_pidl_absolute pidl;
+	HRESULT hr = SHParseDisplayName(result.path.c_str(), nullptr, wil::out_param(pidl), 0, nullptr);
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	ModifyItem(pidl.get(), true);
+}
+
+// When a folder is removed or renamed, only a single notification is sent for the folder itself.
+// Any search results from within the folder are now stale and are removed here.
+void ShellBrowser::RemoveSearchResultsWithin(const std::wstring &directory)
+{
+	if (!m_directoryState.searchResults)
+	{
+		return;
+	}
+
+	std::wstring prefix = GetSearchResultKey(directory);
+
+	if (prefix.empty())
+	{
+		return;
+	}
+
+	if (prefix.back() != '\\')
+	{
+		prefix += '\\';
+	}
+
+	// Every directory at or below the removed directory starts with the prefix, so they're all
+	// contiguous in the map.
+	std::vector<int> itemsToRemove;
+	const auto &directories = m_directoryState.searchResultDirectories;
+
+	for (auto itr = directories.lower_bound(prefix);
+		 itr != directories.end() && itr->first.compare(0, prefix.size(), prefix) == 0; ++itr)
+	{
+		itemsToRemove.insert(itemsToRemove.end(), itr->second.begin(), itr->second.end());
+	}
+
+	for (int internalIndex : itemsToRemove)
+	{
+		RemoveItem(internalIndex);
+	}
+}
+
+void ShellBrowser::IndexSearchResult(int internalIndex)
+{
+	if (!m_directoryState.searchResults)
+	{
+		return;
+	}
+
+	std::wstring key = GetSearchResultKey(m_itemInfoMap.at(internalIndex).parsingName);
+	auto separator = key.find_last_of('\\');
+
+	if (separator == std::wstring::npos)
+	{
+		return;
+	}
+
+	m_directoryState.searchResultDirectories[key.substr(0, separator + 1)].insert(internalIndex);
+	m_directoryState.searchResultPaths[std::move(key)] = internalIndex;
+}
+
+void ShellBrowser::RemoveSearchResultFromIndex(int internalIndex)
+{
+	if (!m_directoryState.searchResults)
+	{
+		return;
+	}
+
+	std::wstring key = GetSearchResultKey(m_itemInfoMap.at(internalIndex).parsingName);
+	auto separator = key.find_last_of('\\');
+
+	if (separator == std::wstring::npos)
+	{
+		return;
+	}
+
+	auto pathItr = m_directoryState.searchResultPaths.find(key);
+
+	if (pathItr != m_directoryState.searchResultPaths.end() && pathItr->second == internalIndex)
+	{
+		m_directoryState.searchResultPaths.erase(pathItr);
+	}
+
+	auto directoryItr = m_directoryState.searchResultDirectories.find(key.substr(0, separator + 1));
+
+	if (directoryItr != m_directoryState.searchResultDirectories.end())
+	{
+		directoryItr->second.erase(internalIndex);
+
+		if (directoryItr->second.empty())
+		{
+			m_directoryState.searchResultDirectories.erase(directoryItr);
+		}
+	}
+}
+
+// Paths are compared case-insensitively.
+std::wstring ShellBrowser::GetSearchResultKey(const std::wstring &path)
+{
+	std::wstring key = path;
+	CharLowerBuff(key.data(), static_cast<DWORD>(key.size()));
+	return key;
+}
+
 void ShellBrowser::InvalidateAllColumnsForItem(int itemIndex)
 {
 	if (m_folderSettings.viewMode != +ViewMode::Details)
@@ -659,4 +983,39 @@ void ShellBrowser::InvalidateIconForItem(int itemIndex)
 	lvItem.iSubItem = 0;
 	lvItem.iImage = I_IMAGECALLBACK;
 	ListView_SetItem(m_hListView, &lvItem);
-}
\ No newline at end of file
+}
+
+// When an item is updated, the data cached for it only needs to be discarded if it depends on one
+// of the properties that actually changed. For example, an item sorted by name doesn't need to
+// have its sort key recalculated when its size changes.
+void ShellBrowser::CarryOverCachedItemData(
+	ItemInfo_t &previousItemInfo, ItemInfo_t &updatedItemInfo, bool contentsModified)
+{
+	const WIN32_FIND_DATA &previousData = previousItemInfo.wfd;
+	const WIN32_FIND_DATA &updatedData = updatedItemInfo.wfd;
+
+	ItemChanges changes;
+	changes.name = (previousItemInfo.displayName != updatedItemInfo.displayName
+		|| previousItemInfo.parsingName != updatedItemInfo.parsingName);
+	changes.size = (previousItemInfo.isFindDataValid != updatedItemInfo.isFindDataValid
+		|| previousData.nFileSizeLow != updatedData.nFileSizeLow
+		|| previousData.nFileSizeHigh != updatedData.nFileSizeHigh);
+	changes.dates = (previousItemInfo.isFindDataValid != updatedItemInfo.isFindDataValid
+		|| CompareFileTime(&previousData.ftCreationTime, &updatedData.ftCreationTime) != 0
+		|| CompareFileTime(&previousData.ftLastWriteTime, &updatedData.ftLastWriteTime) != 0
+		|| CompareFileTime(&previousData.ftLastAccessTime, &updatedData.ftLastAccessTime) != 0);
+	changes.attributes = (previousData.dwFileAttributes != updatedData.dwFileAttributes);
+	changes.contents = contentsModified;
+
+	if (previousItemInfo.cachedSortText
+		&& !IsSortModeAffectedByChanges(previousItemInfo.cachedSortText->sortMode, changes))
+	{
+		updatedItemInfo.cachedSortText = std::move(previousItemInfo.cachedSortText);
+	}
+
+	if (previousItemInfo.cachedGroupInfo
+		&& !IsSortModeAffectedByChanges(previousItemInfo.cachedGroupInfo->sortMode, changes))
+	{
+		updatedItemInfo.cachedGroupInfo = std::move(previousItemInfo.cachedGroupInfo);
+	}
+}
@@ -480,7 +480,7 @@ HRESULT _stdcall ShellBrowser::Drop(
 
 		if (!bHandled)
 		{
-			DropHandler *pDropHandler = DropHandler::CreateNew();
+			DropHandler *pDropHandler = DropHandler::CreateNew(m_fileOperationQueue);
 
 			/* The drop handler will call Release(), so we
 			need to AddRef() here. In the future, this should
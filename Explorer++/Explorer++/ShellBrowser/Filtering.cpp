@@ -5,8 +5,15 @@
 #include "stdafx.h"
 #include "ShellBrowser.h"
 #include "MainResource.h"
+#include "Config.h"
 #include "../Helper/ListViewHelper.h"
 
+namespace
+{
+	// The number of items a filter task will process between checks for cancellation.
+	const size_t FILTER_CANCELLATION_CHECK_INTERVAL = 256;
+}
+
 std::wstring ShellBrowser::GetFilter() const
 {
 	return m_folderSettings.filter;
@@ -15,11 +22,12 @@ std::wstring ShellBrowser::GetFilter() const
 void ShellBrowser::SetFilter(std::wstring_view filter)
 {
 	m_folderSettings.filter = filter;
+	m_filterMatcher =
+		WildcardMatcher(m_folderSettings.filter, m_folderSettings.filterCaseSensitive);
 
 	if (m_folderSettings.applyFilter)
 	{
-		UnfilterAllItems();
-		UpdateFiltering();
+		QueueFilterTask();
 	}
 }
 
@@ -38,6 +46,13 @@ BOOL ShellBrowser::GetFilterStatus() const
 void ShellBrowser::SetFilterCaseSensitive(BOOL filterCaseSensitive)
 {
 	m_folderSettings.filterCaseSensitive = filterCaseSensitive;
+	m_filterMatcher =
+		WildcardMatcher(m_folderSettings.filter, m_folderSettings.filterCaseSensitive);
+
+	if (m_folderSettings.applyFilter)
+	{
+		QueueFilterTask();
+	}
 }
 
 BOOL ShellBrowser::GetFilterCaseSensitive() const
@@ -47,6 +62,9 @@ BOOL ShellBrowser::GetFilterCaseSensitive() const
 
 void ShellBrowser::UpdateFiltering()
 {
+	// The items are about to be filtered synchronously, so any pending results are obsolete.
+	ClearPendingFilterResults();
+
 	if (m_folderSettings.applyFilter)
 	{
 		RemoveFilteredItems();
@@ -91,6 +109,8 @@ void ShellBrowser::RemoveFilteredItems()
 		}
 	}
 
+	m_appliedFilterMatcher = m_filterMatcher;
+
 	SendMessage(m_hOwner, WM_USER_UPDATEWINDOWS, 0, 0);
 }
 
@@ -126,8 +146,7 @@ void ShellBrowser::RemoveFilteredItem(int iItem, int iItemInternal)
 
 BOOL ShellBrowser::IsFilenameFiltered(const TCHAR *FileName) const
 {
-	if (CheckWildcardMatch(
-			m_folderSettings.filter.c_str(), FileName, m_folderSettings.filterCaseSensitive))
+	if (m_filterMatcher.Match(FileName))
 	{
 		return FALSE;
 	}
@@ -179,4 +198,178 @@ void ShellBrowser::ApplyFilteringBackgroundImage(bool apply)
 	{
 		ListViewHelper::SetBackgroundImage(m_hListView, NULL);
 	}
-}
\ No newline at end of file
+}
+
+// Rather than restoring every item and then filtering the entire folder again, only the items
+// whose visibility could change are tested. The tests themselves are run in the background, so
+// that a filter that's updated on every keystroke doesn't block the UI.
+void ShellBrowser::QueueFilterTask()
+{
+	ClearPendingFilterResults();
+
+	// If the new filter only matches a subset of what the applied filter matched, none of the
+	// items that are currently filtered out can match it. Similarly, if it matches a superset,
+	// all of the items that are currently shown will continue to match.
+	bool narrowed = m_filterMatcher.IsSubsetOf(m_appliedFilterMatcher);
+	bool widened = m_appliedFilterMatcher.IsSubsetOf(m_filterMatcher);
+
+	if (narrowed && widened)
+	{
+		m_appliedFilterMatcher = m_filterMatcher;
+		return;
+	}
+
+	std::vector<FilterCandidate> shownItems;
+	std::vector<FilterCandidate> hiddenItems;
+
+	for (const auto &[internalIndex, itemInfo] : m_itemInfoMap)
+	{
+		// Folders are never filtered and hidden system files remain hidden regardless of the
+		// filter, so neither needs to be tested.
+		if (WI_IsFlagSet(itemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY)
+			|| (m_config->globalFolderSettings.hideSystemFiles
+				&& WI_IsFlagSet(itemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_SYSTEM)))
+		{
+			continue;
+		}
+
+		bool filtered = (m_directoryState.filteredItemsList.count(internalIndex) > 0);
+
+		if (filtered && !narrowed)
+		{
+			hiddenItems.push_back({ internalIndex, itemInfo.displayName });
+		}
+		else if (!filtered && !widened)
+		{
+			shownItems.push_back({ internalIndex, itemInfo.displayName });
+		}
+	}
+
+	int filterResultId = m_filterResultIDCounter++;
+	m_latestFilterResultId = filterResultId;
+
+	auto result = m_filterThreadPool.push(
+		[listView = m_hListView, filterResultId, &latestFilterResultId = m_latestFilterResultId,
+			filterMatcher = m_filterMatcher, shownItems = std::move(shownItems),
+			hiddenItems = std::move(hiddenItems)](int id) {
+			UNREFERENCED_PARAMETER(id);
+
+			return FilterItemsAsync(listView, filterResultId, latestFilterResultId,
+				filterMatcher, shownItems, hiddenItems);
+		});
+
+	// As with the column results, the result can't be processed until this function has
+	// returned, so it doesn't matter if the task finishes first.
+	m_filterResults.insert({ filterResultId, std::move(result) });
+}
+
+std::optional<ShellBrowser::FilterResult> ShellBrowser::FilterItemsAsync(HWND listView,
+	int filterResultId, const std::atomic<int> &latestFilterResultId,
+	const WildcardMatcher &filterMatcher, const std::vector<FilterCandidate> &shownItems,
+	const std::vector<FilterCandidate> &hiddenItems)
+{
+	FilterResult result;
+
+	for (size_t i = 0; i < shownItems.size(); i++)
+	{
+		if (i % FILTER_CANCELLATION_CHECK_INTERVAL == 0 && latestFilterResultId != filterResultId)
+		{
+			return std::nullopt;
+		}
+
+		if (!filterMatcher.Match(shownItems[i].displayName))
+		{
+			result.itemsToRemove.push_back(shownItems[i].itemInternalIndex);
+		}
+	}
+
+	for (size_t i = 0; i < hiddenItems.size(); i++)
+	{
+		if (i % FILTER_CANCELLATION_CHECK_INTERVAL == 0 && latestFilterResultId != filterResultId)
+		{
+			return std::nullopt;
+		}
+
+		if (filterMatcher.Match(hiddenItems[i].displayName))
+		{
+			result.itemsToRestore.push_back(hiddenItems[i].itemInternalIndex);
+		}
+	}
+
+	// This message may be delivered before this function has returned. That doesn't matter, since
+	// the message handler will simply wait for the result to be returned.
+	PostMessage(listView, WM_APP_FILTER_RESULT_READY, filterResultId, 0);
+
+	return result;
+}
+
+void ShellBrowser::ProcessFilterResult(int filterResultId)
+{
+	auto itr = m_filterResults.find(filterResultId);
+
+	if (itr == m_filterResults.end())
+	{
+		// This result has been superseded by a more recent filter change, or is for a previous
+		// folder.
+		return;
+	}
+
+	auto result = itr->second.get();
+	m_filterResults.erase(itr);
+
+	if (!result)
+	{
+		return;
+	}
+
+	// Every change to the filter queues a new task, so this result reflects the current filter.
+	m_appliedFilterMatcher = m_filterMatcher;
+
+	if (result->itemsToRemove.empty() && result->itemsToRestore.empty())
+	{
+		return;
+	}
+
+	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
+
+	if (!result->itemsToRemove.empty())
+	{
+		std::unordered_set<int> itemsToRemove(
+			result->itemsToRemove.begin(), result->itemsToRemove.end());
+
+		int nItems = ListView_GetItemCount(m_hListView);
+
+		for (int i = nItems - 1; i >= 0; i--)
+		{
+			int internalIndex = GetItemInternalIndex(i);
+
+			if (itemsToRemove.count(internalIndex) > 0)
+			{
+				RemoveFilteredItem(i, internalIndex);
+			}
+		}
+	}
+
+	for (int internalIndex : result->itemsToRestore)
+	{
+		// The item may have been deleted since the task was queued.
+		if (m_directoryState.filteredItemsList.count(internalIndex) == 0)
+		{
+			continue;
+		}
+
+		RestoreFilteredItem(internalIndex);
+		m_directoryState.filteredItemsList.erase(internalIndex);
+	}
+
+	SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
+
+	SendMessage(m_hOwner, WM_USER_UPDATEWINDOWS, 0, 0);
+}
+
+void ShellBrowser::ClearPendingFilterResults()
+{
+	m_latestFilterResultId = -1;
+	m_filterThreadPool.clear_queue();
+	m_filterResults.clear();
+}
@@ -0,0 +1,277 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ShellBrowser.h"
+#include "ColumnDataRetrieval.h"
+#include "Config.h"
+#include "ItemData.h"
+#include "SortModes.h"
+#include "ViewModes.h"
+#include "../Helper/FolderSizeService.h"
+#include "../Helper/Macros.h"
+#include "../Helper/ShellHelper.h"
+#include <wil/common.h>
+
+bool ShellBrowser::ShouldCalculateFolderSize(const ItemInfo_t &itemInfo) const
+{
+	const auto &globalFolderSettings = m_config->globalFolderSettings;
+
+	if (!globalFolderSettings.showFolderSizes || !itemInfo.isFindDataValid
+		|| WI_IsFlagClear(itemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+	{
+		return false;
+	}
+
+	if (globalFolderSettings.disableFolderSizesNetworkRemovable)
+	{
+		std::wstring path;
+		HRESULT hr = GetDisplayName(itemInfo.pidlComplete.get(), SHGDN_FORPARSING, path);
+
+		if (FAILED(hr))
+		{
+			return false;
+		}
+
+		TCHAR drive[MAX_PATH];
+		StringCchCopy(drive, SIZEOF_ARRAY(drive), path.c_str());
+		PathStripToRoot(drive);
+
+		UINT driveType = GetDriveType(drive);
+
+		if (driveType == DRIVE_REMOVABLE || driveType == DRIVE_REMOTE)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void ShellBrowser::QueueFolderSizeTask(int internalIndex)
+{
+	if (m_directoryState.cachedFolderSizes.count(internalIndex) > 0)
+	{
+		return;
+	}
+
+	for (const auto &[requestId, requestInternalIndex] : m_folderSizeRequests)
+	{
+		if (requestInternalIndex == internalIndex)
+		{
+			return;
+		}
+	}
+
+	if (!ShouldCalculateFolderSize(m_itemInfoMap.at(internalIndex)))
+	{
+		return;
+	}
+
+	m_pendingFolderSizes.insert(internalIndex);
+}
+
+void ShellBrowser::ScheduleFolderSizeTasks()
+{
+	while (m_folderSizeRequests.size() < MAX_FOLDER_SIZE_REQUESTS)
+	{
+		auto internalIndex = TakeNextFolderSizeTask();
+
+		if (!internalIndex)
+		{
+			break;
+		}
+
+		RequestFolderSize(*internalIndex);
+	}
+}
+
+std::optional<int> ShellBrowser::TakeNextFolderSizeTask()
+{
+	if (m_pendingFolderSizes.empty())
+	{
+		return std::nullopt;
+	}
+
+	// Folders that are currently visible go first, so that the sizes the user can actually see
+	// are filled in before the rest.
+	int topIndex = ListView_GetTopIndex(m_hListView);
+	int numVisible = ListView_GetCountPerPage(m_hListView);
+	int numItems = ListView_GetItemCount(m_hListView);
+
+	for (int i = topIndex; i <= topIndex + numVisible && i < numItems; i++)
+	{
+		int internalIndex = GetItemInternalIndex(i);
+		auto itr = m_pendingFolderSizes.find(internalIndex);
+
+		if (itr != m_pendingFolderSizes.end())
+		{
+			m_pendingFolderSizes.erase(itr);
+			return internalIndex;
+		}
+	}
+
+	int internalIndex = *m_pendingFolderSizes.begin();
+	m_pendingFolderSizes.erase(m_pendingFolderSizes.begin());
+
+	return internalIndex;
+}
+
+void ShellBrowser::RequestFolderSize(int internalIndex)
+{
+	std::wstring path;
+	HRESULT hr =
+		GetDisplayName(m_itemInfoMap.at(internalIndex).pidlComplete.get(), SHGDN_FORPARSING, path);
+
+	if (FAILED(hr))
+	{
+		return;
+	}
+
+	int requestId = m_folderSizeRequestIdCounter++;
+	m_directoryState.folderSizePaths[internalIndex] = path;
+
+	// The result is passed back to the main thread, where it's only processed if the request is
+	// still outstanding (i.e. the user hasn't navigated away in the meantime).
+	auto folderInfo = m_folderSizeService->GetFolderInfo(
+		path, [listView = m_hListView, requestId](const FolderInfo &folderInfo) {
+			auto *result = new FolderSizeResult{ requestId, folderInfo.size };
+
+			if (!PostMessage(listView, WM_APP_FOLDER_SIZE_RESULT_READY, 0,
+					reinterpret_cast<LPARAM>(result)))
+			{
+				delete result;
+			}
+		});
+
+	if (folderInfo)
+	{
+		OnFolderSizeCalculated(internalIndex, folderInfo->size);
+		return;
+	}
+
+	m_folderSizeRequests.insert({ requestId, internalIndex });
+}
+
+void ShellBrowser::ProcessFolderSizeResult(const FolderSizeResult &result)
+{
+	auto itr = m_folderSizeRequests.find(result.requestId);
+
+	if (itr == m_folderSizeRequests.end())
+	{
+		// This result is for a previous folder. It can be ignored.
+		return;
+	}
+
+	int internalIndex = itr->second;
+	m_folderSizeRequests.erase(itr);
+
+	OnFolderSizeCalculated(internalIndex, result.size);
+
+	ScheduleFolderSizeTasks();
+}
+
+void ShellBrowser::OnFolderSizeCalculated(int internalIndex, ULONGLONG size)
+{
+	auto itemItr = m_itemInfoMap.find(internalIndex);
+
+	if (itemItr == m_itemInfoMap.end())
+	{
+		// The item may have been removed while its size was being calculated.
+		return;
+	}
+
+	m_directoryState.cachedFolderSizes[internalIndex] = size;
+
+	// Until now, the folder will have been grouped based on its size being unknown.
+	itemItr->second.cachedGroupInfo.reset();
+
+	auto index = LocateItemByInternalIndex(internalIndex);
+
+	if (!index)
+	{
+		// The item may be filtered, in which case it's not in the listview at all.
+		return;
+	}
+
+	if (m_folderSettings.viewMode == +ViewMode::Details)
+	{
+		auto columnIndex = GetColumnIndexByType(ColumnType::Size);
+
+		if (columnIndex)
+		{
+			std::wstring columnText = GetColumnText(
+				ColumnType::Size, getBasicItemInfo(internalIndex), m_config->globalFolderSettings);
+			ListView_SetItemText(m_hListView, *index, *columnIndex, columnText.data());
+		}
+	}
+
+	if (m_folderSettings.sortMode != +SortMode::Size)
+	{
+		return;
+	}
+
+	if (m_folderSettings.showInGroups)
+	{
+		InsertItemIntoGroup(*index, DetermineItemGroup(internalIndex));
+	}
+
+	if (!m_folderSizeSortQueued)
+	{
+		SetTimer(m_hListView, FOLDER_SIZE_SORT_TIMER_ID, FOLDER_SIZE_SORT_TIMEOUT, nullptr);
+		m_folderSizeSortQueued = true;
+	}
+}
+
+void ShellBrowser::OnFolderSizeInvalidated(const std::wstring &path)
+{
+	for (const auto &[internalIndex, folderSizePath] : m_directoryState.folderSizePaths)
+	{
+		if (CompareStringOrdinal(folderSizePath.c_str(), -1, path.c_str(), -1, TRUE)
+			== CSTR_EQUAL)
+		{
+			InvalidateFolderSize(internalIndex);
+			break;
+		}
+	}
+}
+
+// Discards the size that was previously calculated for the folder (if any) and queues the folder
+// so that its size is calculated again.
+void ShellBrowser::InvalidateFolderSize(int internalIndex)
+{
+	m_directoryState.cachedFolderSizes.erase(internalIndex);
+
+	QueueFolderSizeTask(internalIndex);
+	ScheduleFolderSizeTasks();
+}
+
+void ShellBrowser::OnFolderSizeSortTimer()
+{
+	KillTimer(m_hListView, FOLDER_SIZE_SORT_TIMER_ID);
+	m_folderSizeSortQueued = false;
+
+	if (m_folderSettings.sortMode == +SortMode::Size)
+	{
+		ListView_SortItems(m_hListView, SortStub, this);
+	}
+}
+
+void ShellBrowser::RemovePendingFolderSize(int internalIndex)
+{
+	m_pendingFolderSizes.erase(internalIndex);
+	m_directoryState.cachedFolderSizes.erase(internalIndex);
+	m_directoryState.folderSizePaths.erase(internalIndex);
+}
+
+void ShellBrowser::ClearPendingFolderSizes()
+{
+	// Any calculations that are in progress are left to finish, since their results will still
+	// be cached by the service.
+	m_pendingFolderSizes.clear();
+	m_folderSizeRequests.clear();
+
+	KillTimer(m_hListView, FOLDER_SIZE_SORT_TIMER_ID);
+	m_folderSizeSortQueued = false;
+}
\ No newline at end of file
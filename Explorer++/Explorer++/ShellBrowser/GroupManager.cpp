@@ -144,6 +144,41 @@ const ShellBrowser::ListViewGroup ShellBrowser::GetListViewGroupById(int groupId
 }
 
 int ShellBrowser::DetermineItemGroup(int iItemInternal)
+{
+	const ItemInfo_t &itemInfo = m_itemInfoMap.at(iItemInternal);
+	std::optional<GroupInfo> groupInfo;
+
+	// Date groups (e.g. "Today") are relative to the current date, so they're always redetermined.
+	bool relativeToCurrentDate = (m_folderSettings.sortMode == +SortMode::DateModified
+		|| m_folderSettings.sortMode == +SortMode::Created
+		|| m_folderSettings.sortMode == +SortMode::Accessed);
+
+	if (relativeToCurrentDate)
+	{
+		groupInfo = DetermineItemGroupInfo(iItemInternal);
+	}
+	else
+	{
+		if (!itemInfo.cachedGroupInfo
+			|| itemInfo.cachedGroupInfo->sortMode != m_folderSettings.sortMode)
+		{
+			itemInfo.cachedGroupInfo =
+				CachedGroupInfo{ m_folderSettings.sortMode, DetermineItemGroupInfo(iItemInternal) };
+		}
+
+		groupInfo = itemInfo.cachedGroupInfo->groupInfo;
+	}
+
+	if (!groupInfo)
+	{
+		groupInfo = GroupInfo(
+			ResourceHelper::LoadString(m_hResourceModule, IDS_GROUPBY_UNSPECIFIED), INT_MIN);
+	}
+
+	return GetOrCreateListViewGroup(*groupInfo);
+}
+
+std::optional<ShellBrowser::GroupInfo> ShellBrowser::DetermineItemGroupInfo(int iItemInternal)
 {
 	BasicItemInfo_t basicItemInfo = getBasicItemInfo(iItemInternal);
 	std::optional<GroupInfo> groupInfo;
@@ -301,13 +336,7 @@ int ShellBrowser::DetermineItemGroup(int iItemInternal)
 		break;
 	}
 
-	if (!groupInfo)
-	{
-		groupInfo = GroupInfo(
-			ResourceHelper::LoadString(m_hResourceModule, IDS_GROUPBY_UNSPECIFIED), INT_MIN);
-	}
-
-	return GetOrCreateListViewGroup(*groupInfo);
+	return groupInfo;
 }
 
 int ShellBrowser::GetOrCreateListViewGroup(const GroupInfo &groupInfo)
@@ -350,7 +379,11 @@ std::optional<ShellBrowser::GroupInfo> ShellBrowser::DetermineItemNameGroup(
 std::optional<ShellBrowser::GroupInfo> ShellBrowser::DetermineItemSizeGroup(
 	const BasicItemInfo_t &itemInfo) const
 {
-	if ((itemInfo.wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == FILE_ATTRIBUTE_DIRECTORY)
+	bool isFolder =
+		(itemInfo.wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == FILE_ATTRIBUTE_DIRECTORY;
+
+	// Once the size of a folder has been calculated, it's grouped in the same way as a file.
+	if (isFolder && !itemInfo.folderSize)
 	{
 		return GroupInfo(
 			ResourceHelper::LoadString(m_hResourceModule, IDS_GROUPBY_SIZE_FOLDERS), 0);
@@ -374,6 +407,12 @@ std::optional<ShellBrowser::GroupInfo> ShellBrowser::DetermineItemSizeGroup(
 		{ IDS_GROUPBY_SIZE_GIGANTIC, boost::integer_traits<uint64_t>::const_max } };
 
 	ULARGE_INTEGER fileSize = { itemInfo.wfd.nFileSizeLow, itemInfo.wfd.nFileSizeHigh };
+
+	if (isFolder)
+	{
+		fileSize.QuadPart = *itemInfo.folderSize;
+	}
+
 	int currentIndex = 0;
 
 	while (fileSize.QuadPart > sizeGroups[currentIndex].upperLimit
@@ -21,7 +21,8 @@ HistoryEntry::HistoryEntry(const PreservedHistoryEntry &preservedHistoryEntry) :
 	m_id(idCounter++),
 	m_pidl(ILCloneFull(preservedHistoryEntry.pidl.get())),
 	m_displayName(preservedHistoryEntry.displayName),
-	m_systemIconIndex(preservedHistoryEntry.systemIconIndex)
+	m_systemIconIndex(preservedHistoryEntry.systemIconIndex),
+	m_searchResults(preservedHistoryEntry.searchResults)
 {
 }
 
@@ -75,4 +76,14 @@ std::vector<unique_pidl_absolute> HistoryEntry::GetSelectedItems() const
 void HistoryEntry::SetSelectedItems(const std::vector<PCIDLIST_ABSOLUTE> &pidls)
 {
 	m_selectedItems = DeepCopyPidls(pidls);
+}
+
+std::shared_ptr<const SearchResultsFolder> HistoryEntry::GetSearchResults() const
+{
+	return m_searchResults;
+}
+
+void HistoryEntry::SetSearchResults(std::shared_ptr<const SearchResultsFolder> searchResults)
+{
+	m_searchResults = std::move(searchResults);
 }
\ No newline at end of file
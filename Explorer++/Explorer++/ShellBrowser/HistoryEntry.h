@@ -7,10 +7,12 @@
 #include "SignalWrapper.h"
 #include "../Helper/Macros.h"
 #include "../Helper/ShellHelper.h"
+#include <memory>
 #include <optional>
 #include <vector>
 
 struct PreservedHistoryEntry;
+struct SearchResultsFolder;
 
 class HistoryEntry
 {
@@ -33,6 +35,8 @@ public:
 	void SetSystemIconIndex(int iconIndex);
 	std::vector<unique_pidl_absolute> GetSelectedItems() const;
 	void SetSelectedItems(const std::vector<PCIDLIST_ABSOLUTE> &pidls);
+	std::shared_ptr<const SearchResultsFolder> GetSearchResults() const;
+	void SetSearchResults(std::shared_ptr<const SearchResultsFolder> searchResults);
 
 	SignalWrapper<HistoryEntry, void(const HistoryEntry &entry, PropertyType propertyType)>
 		historyEntryUpdatedSignal;
@@ -48,4 +52,7 @@ private:
 	std::optional<std::wstring> m_fullPathForDisplay;
 	std::optional<int> m_systemIconIndex;
 	std::vector<unique_pidl_absolute> m_selectedItems;
+
+	// Set if the entry is for a set of search results, rather than the folder itself.
+	std::shared_ptr<const SearchResultsFolder> m_searchResults;
 };
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include "../Helper/Macros.h"
 #include "../Helper/ShellHelper.h"
 #include <wil/resource.h>
+#include <optional>
 
 struct BasicItemInfo_t
 {
@@ -26,6 +27,7 @@ struct BasicItemInfo_t
 		isFindDataValid = other.isFindDataValid;
 		StringCchCopy(szDisplayName, SIZEOF_ARRAY(szDisplayName), other.szDisplayName);
 		isRoot = other.isRoot;
+		folderSize = other.folderSize;
 	}
 
 	unique_pidl_absolute pidlComplete;
@@ -35,6 +37,9 @@ struct BasicItemInfo_t
 	TCHAR szDisplayName[MAX_PATH];
 	bool isRoot;
 
+	// Only set for folders whose size has been calculated.
+	std::optional<ULONGLONG> folderSize;
+
 	std::wstring getFullPath() const
 	{
 		std::wstring fullPath;
@@ -84,6 +84,10 @@ LRESULT CALLBACK ShellBrowser::ListViewProc(HWND hwnd, UINT uMsg, WPARAM wParam,
 		{
 			OnProcessShellChangeNotifications();
 		}
+		else if (wParam == FOLDER_SIZE_SORT_TIMER_ID)
+		{
+			OnFolderSizeSortTimer();
+		}
 		break;
 
 	case WM_NOTIFY:
@@ -128,6 +132,39 @@ LRESULT CALLBACK ShellBrowser::ListViewProc(HWND hwnd, UINT uMsg, WPARAM wParam,
 	case WM_APP_SHELL_NOTIFY:
 		OnShellNotify(wParam, lParam);
 		break;
+
+	case WM_APP_FILTER_RESULT_READY:
+		ProcessFilterResult(static_cast<int>(wParam));
+		break;
+
+	case WM_APP_FOLDER_SIZE_RESULT_READY:
+	{
+		std::unique_ptr<FolderSizeResult> result(reinterpret_cast<FolderSizeResult *>(lParam));
+		ProcessFolderSizeResult(*result);
+	}
+	break;
+
+	case WM_APP_FOLDER_SIZE_INVALIDATED:
+	{
+		std::unique_ptr<std::wstring> path(reinterpret_cast<std::wstring *>(lParam));
+		OnFolderSizeInvalidated(*path);
+	}
+	break;
+
+	case WM_APP_SEARCH_RESULTS_READY:
+	{
+		std::unique_ptr<SearchResultsBatch> batch(reinterpret_cast<SearchResultsBatch *>(lParam));
+		ProcessSearchResultsBatch(*batch);
+	}
+	break;
+
+	case WM_APP_SEARCH_CONTENT_RESULT_READY:
+	{
+		std::unique_ptr<SearchContentResult> result(
+			reinterpret_cast<SearchContentResult *>(lParam));
+		ProcessSearchContentResult(*result);
+	}
+	break;
 	}
 
 	return DefSubclassProc(hwnd, uMsg, wParam, lParam);
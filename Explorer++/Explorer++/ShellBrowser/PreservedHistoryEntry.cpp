@@ -10,6 +10,7 @@ PreservedHistoryEntry::PreservedHistoryEntry(const HistoryEntry &entry) :
 	id(entry.GetId()),
 	pidl(ILCloneFull(entry.GetPidl().get())),
 	displayName(entry.GetDisplayName()),
-	systemIconIndex(entry.GetSystemIconIndex())
+	systemIconIndex(entry.GetSystemIconIndex()),
+	searchResults(entry.GetSearchResults())
 {
 }
\ No newline at end of file
@@ -6,9 +6,11 @@
 
 #include "../Helper/Macros.h"
 #include "../Helper/ShellHelper.h"
+#include <memory>
 #include <optional>
 
 class HistoryEntry;
+struct SearchResultsFolder;
 
 struct PreservedHistoryEntry
 {
@@ -20,6 +22,7 @@ public:
 	unique_pidl_absolute pidl;
 	std::wstring displayName;
 	std::optional<int> systemIconIndex;
+	std::shared_ptr<const SearchResultsFolder> searchResults;
 
 private:
 	DISALLOW_COPY_AND_ASSIGN(PreservedHistoryEntry);
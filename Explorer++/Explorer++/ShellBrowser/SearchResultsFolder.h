@@ -0,0 +1,35 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// A set of search results that's shown in a tab as if it were a folder. Rather than re-running the
+// search, the results are kept up to date by watching the root directory (along with everything
+// below it, for a recursive search) and checking each item that's added, modified or renamed
+// against the original search criteria.
+struct SearchResultsFolder
+{
+	// Decides whether an item in the specified directory matches the search.
+	using MatchFunction =
+		std::function<bool(const std::wstring &directory, const WIN32_FIND_DATA &wfd)>;
+
+	std::wstring rootDirectory;
+	bool recursive = false;
+
+	// The full path of each item found by the original search.
+	std::vector<std::wstring> results;
+
+	// Checks everything other than the contents of the item. This is cheap, so it's called on the
+	// UI thread, once for each item that changes.
+	MatchFunction matches;
+
+	// Checks the contents of an item that's already matched above. Reading the item can take a
+	// while, so this is only ever called on a background thread. Empty if the search doesn't
+	// look at the contents of items.
+	MatchFunction matchesContent;
+};
@@ -4,6 +4,7 @@
 
 #include "stdafx.h"
 #include "ShellBrowser.h"
+#include "ColorRuleHelper.h"
 #include "Config.h"
 #include "CoreInterface.h"
 #include "DarkModeHelper.h"
@@ -19,6 +20,7 @@
 #include "../Helper/DriveInfo.h"
 #include "../Helper/FileActionHandler.h"
 #include "../Helper/FileOperations.h"
+#include "../Helper/FolderSizeService.h"
 #include "../Helper/IconFetcher.h"
 #include "../Helper/ListViewHelper.h"
 #include "../Helper/Macros.h"
@@ -106,9 +108,14 @@ ShellBrowser::ShellBrowser(int id, HWND hOwner, IExplorerplusplus *coreInterface
 	m_cachedIcons(coreInterface->GetCachedIcons()),
 	m_iconResourceLoader(coreInterface->GetIconResourceLoader()),
 	m_config(coreInterface->GetConfig()),
+	m_colorRuleMatcher(coreInterface->GetColorRuleMatcher()),
+	m_folderSizeService(coreInterface->GetFolderSizeService()),
+	m_fileOperationQueue(coreInterface->GetFileOperationQueue()),
 	m_tabNavigation(tabNavigation),
 	m_fileActionHandler(fileActionHandler),
 	m_folderSettings(folderSettings),
+	m_filterMatcher(folderSettings.filter, folderSettings.filterCaseSensitive),
+	m_appliedFilterMatcher(m_filterMatcher),
 	m_folderColumns(initialColumns
 			? *initialColumns
 			: coreInterface->GetConfig()->globalFolderSettings.folderColumns),
@@ -120,7 +127,17 @@ ShellBrowser::ShellBrowser(int id, HWND hOwner, IExplorerplusplus *coreInterface
 	m_thumbnailResultIDCounter(0),
 	m_infoTipsThreadPool(
 		1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED), CoUninitialize),
-	m_infoTipResultIDCounter(0)
+	m_infoTipResultIDCounter(0),
+	m_latestFilterResultId(-1),
+	m_filterThreadPool(1),
+	m_filterResultIDCounter(0),
+	m_latestSearchResultsId(-1),
+	m_searchResultsThreadPool(
+		1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED), CoUninitialize),
+	m_searchResultsIdCounter(0),
+	m_searchContentThreadPool(1),
+	m_folderSizeRequestIdCounter(0),
+	m_folderSizeSortQueued(false)
 {
 	m_iRefCount = 1;
 
@@ -166,6 +183,21 @@ ShellBrowser::ShellBrowser(int id, HWND hOwner, IExplorerplusplus *coreInterface
 
 	m_connections.push_back(coreInterface->AddApplicationShuttingDownObserver(
 		std::bind(&ShellBrowser::OnApplicationShuttingDown, this)));
+	m_connections.push_back(coreInterface->AddColorRulesUpdatedObserver(
+		std::bind(&ShellBrowser::OnColorRulesUpdated, this)));
+
+	// The service notifies its observers on a background thread, so the path is passed back to
+	// the main thread, where it's matched against the folders in the current listing.
+	m_connections.push_back(m_folderSizeService->AddInvalidatedObserver(
+		[listView = m_hListView](const std::wstring &path) {
+			auto *invalidatedPath = new std::wstring(path);
+
+			if (!PostMessage(listView, WM_APP_FOLDER_SIZE_INVALIDATED, 0,
+					reinterpret_cast<LPARAM>(invalidatedPath)))
+			{
+				delete invalidatedPath;
+			}
+		}));
 }
 
 ShellBrowser::~ShellBrowser()
@@ -182,6 +214,8 @@ ShellBrowser::~ShellBrowser()
 	m_columnThreadPool.clear_queue();
 	m_thumbnailThreadPool.clear_queue();
 	m_infoTipsThreadPool.clear_queue();
+	m_filterThreadPool.clear_queue();
+	ClearPendingSearchResults();
 
 	/* Release the drag and drop helpers. */
 	m_pDropTargetHelper->Release();
@@ -551,6 +585,11 @@ std::wstring ShellBrowser::GetItemFullName(int index) const
 	return GetItemByIndex(index).parsingName;
 }
 
+std::optional<COLORREF> ShellBrowser::GetItemColorRuleColor(int index) const
+{
+	return GetItemByIndex(index).colorRuleColor;
+}
+
 std::wstring ShellBrowser::GetDirectory() const
 {
 	return m_directoryState.directory;
@@ -646,6 +685,19 @@ std::optional<int> ShellBrowser::GetItemInternalIndexForPidl(PCIDLIST_ABSOLUTE p
 	return itr->first;
 }
 
+// Only items in a set of search results are indexed by path.
+std::optional<int> ShellBrowser::GetItemInternalIndexForPath(const std::wstring &path) const
+{
+	auto itr = m_directoryState.searchResultPaths.find(GetSearchResultKey(path));
+
+	if (itr == m_directoryState.searchResultPaths.end())
+	{
+		return std::nullopt;
+	}
+
+	return itr->second;
+}
+
 std::optional<int> ShellBrowser::LocateItemByInternalIndex(int internalIndex) const
 {
 	LVFINDINFO lvfi;
@@ -722,6 +774,14 @@ part of the filesystem, or if it is the root of
 the namespace (i.e. the desktop). */
 BOOL ShellBrowser::CanCreate() const
 {
+	/* A new item would be created in the root
+	directory of the search, where it may not
+	even match the search. */
+	if (m_directoryState.searchResults)
+	{
+		return FALSE;
+	}
+
 	BOOL bCanCreate = FALSE;
 	unique_pidl_absolute pidl;
 	HRESULT hr = SHGetFolderLocation(nullptr, CSIDL_DESKTOP, nullptr, 0, wil::out_param(pidl));
@@ -1347,6 +1407,13 @@ BasicItemInfo_t ShellBrowser::getBasicItemInfo(int internalIndex) const
 		itemInfo.displayName.c_str());
 	basicItemInfo.isRoot = itemInfo.bDrive;
 
+	auto itr = m_directoryState.cachedFolderSizes.find(internalIndex);
+
+	if (itr != m_directoryState.cachedFolderSizes.end())
+	{
+		basicItemInfo.folderSize = itr->second;
+	}
+
 	return basicItemInfo;
 }
 
@@ -1521,4 +1588,16 @@ void ShellBrowser::OnApplicationShuttingDown()
 		// running, any clipboard objects will still be available.
 		OleFlushClipboard();
 	}
+}
+
+void ShellBrowser::OnColorRulesUpdated()
+{
+	for (auto &item : m_itemInfoMap)
+	{
+		auto &itemInfo = item.second;
+		itemInfo.colorRuleColor = m_colorRuleMatcher->GetColorForItem(
+			PathFindFileName(itemInfo.parsingName.c_str()), itemInfo.wfd.dwFileAttributes);
+	}
+
+	InvalidateRect(m_hListView, nullptr, FALSE);
 }
\ No newline at end of file
@@ -14,6 +14,7 @@
 #include "../Helper/DropHandler.h"
 #include "../Helper/Macros.h"
 #include "../Helper/ShellHelper.h"
+#include "../Helper/WildcardMatcher.h"
 #include "../ThirdParty/CTPL/cpl_stl.h"
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/member.hpp>
@@ -22,9 +23,13 @@
 #include <wil/com.h>
 #include <wil/resource.h>
 #include <thumbcache.h>
+#include <atomic>
 #include <future>
 #include <list>
+#include <map>
+#include <memory>
 #include <optional>
+#include <set>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -35,15 +40,23 @@ struct BasicItemInfo_t;
 class CachedIcons;
 struct Config;
 class FileActionHandler;
+class FileOperationQueue;
+class FolderSizeService;
 class IconFetcher;
 class IconResourceLoader;
 __interface IExplorerplusplus;
 struct PreservedFolderState;
 struct PreservedHistoryEntry;
+struct SearchResultsFolder;
 class ShellNavigationController;
 __interface TabNavigationInterface;
 class WindowSubclassWrapper;
 
+namespace NColorRuleHelper
+{
+	class ColorRuleMatcher;
+}
+
 typedef struct
 {
 	ULARGE_INTEGER TotalFolderSize;
@@ -71,6 +84,9 @@ public:
 	FolderSettings GetFolderSettings() const;
 
 	ShellNavigationController *GetNavigationController() const;
+	HRESULT BrowseSearchResults(
+		std::shared_ptr<const SearchResultsFolder> searchResults, bool addHistoryEntry = true);
+	std::shared_ptr<const SearchResultsFolder> GetSearchResults() const;
 	boost::signals2::connection AddNavigationStartedObserver(
 		const NavigationStartedSignal::slot_type &observer,
 		boost::signals2::connect_position position = boost::signals2::at_back) override;
@@ -132,6 +148,7 @@ public:
 	std::wstring GetItemDisplayName(int index) const;
 	std::wstring GetItemEditingName(int index) const;
 	std::wstring GetItemFullName(int index) const;
+	std::optional<COLORREF> GetItemColorRuleColor(int index) const;
 
 	void ShowPropertiesForSelectedFiles() const;
 
@@ -188,6 +205,34 @@ public:
 private:
 	DISALLOW_COPY_AND_ASSIGN(ShellBrowser);
 
+	struct GroupInfo
+	{
+		std::wstring name;
+		int relativeSortPosition;
+
+		explicit GroupInfo(const std::wstring &name) : name(name), relativeSortPosition(0)
+		{
+		}
+
+		GroupInfo(const std::wstring &name, int relativeSortPosition) :
+			name(name),
+			relativeSortPosition(relativeSortPosition)
+		{
+		}
+	};
+
+	struct CachedSortText
+	{
+		SortMode sortMode;
+		std::wstring text;
+	};
+
+	struct CachedGroupInfo
+	{
+		SortMode sortMode;
+		std::optional<GroupInfo> groupInfo;
+	};
+
 	struct ItemInfo_t
 	{
 		unique_pidl_absolute pidlComplete;
@@ -199,6 +244,18 @@ private:
 		std::wstring editingName;
 		int iIcon;
 
+		/* The color assigned to the item by the first matching
+		color rule (if any). This is determined when the item is
+		added or updated, rather than every time it's drawn. */
+		std::optional<COLORREF> colorRuleColor;
+
+		/* Sort keys and groups can be expensive to determine
+		(e.g. when sorting by owner), so they're cached once
+		determined. When the item is updated, they're only
+		discarded if something they depend on has changed. */
+		mutable std::optional<CachedSortText> cachedSortText;
+		mutable std::optional<CachedGroupInfo> cachedGroupInfo;
+
 		/* These are only used for drives. They are
 		needed for when a drive is removed from the
 		system, in which case the drive name is needed
@@ -280,20 +337,19 @@ private:
 		std::wstring infoTip;
 	};
 
-	struct GroupInfo
+	struct FilterCandidate
 	{
-		std::wstring name;
-		int relativeSortPosition;
+		int itemInternalIndex;
+		std::wstring displayName;
+	};
 
-		explicit GroupInfo(const std::wstring &name) : name(name), relativeSortPosition(0)
-		{
-		}
+	struct FilterResult
+	{
+		// Items that are currently shown, but no longer match the filter.
+		std::vector<int> itemsToRemove;
 
-		GroupInfo(const std::wstring &name, int relativeSortPosition) :
-			name(name),
-			relativeSortPosition(relativeSortPosition)
-		{
-		}
+		// Items that are currently filtered out, but now match the filter.
+		std::vector<int> itemsToRestore;
 	};
 
 	struct ListViewGroup
@@ -339,11 +395,29 @@ private:
 		ULARGE_INTEGER totalDirSize;
 		ULARGE_INTEGER fileSelectionSize;
 
-		/* Cached folder size data. */
-		mutable std::unordered_map<int, ULONGLONG> cachedFolderSizes;
+		/* The sizes of the folders (keyed by internal index)
+		that have been calculated so far. */
+		std::unordered_map<int, ULONGLONG> cachedFolderSizes;
+
+		// The paths of the folders whose sizes have been requested. Used to find the item a
+		// folder size invalidation refers to.
+		std::unordered_map<int, std::wstring> folderSizePaths;
 
 		std::vector<ShellChangeNotification> shellChangeNotifications;
 
+		/* Only set when the folder is showing a set of
+		search results, rather than the contents of
+		pidlDirectory. */
+		std::shared_ptr<const SearchResultsFolder> searchResults;
+
+		// Search results can come from any number of directories, so each item is also indexed
+		// by its case-folded path and by the directory that contains it. That allows the items
+		// affected by a change notification to be found without scanning the entire folder. The
+		// directories end in a backslash, so that the items within a directory (and its
+		// subdirectories) form a single range.
+		std::unordered_map<std::wstring, int> searchResultPaths;
+		std::map<std::wstring, std::unordered_set<int>> searchResultDirectories;
+
 		DirectoryState() :
 			virtualFolder(false),
 			itemIDCounter(0),
@@ -375,6 +449,11 @@ private:
 	static const UINT WM_APP_THUMBNAIL_RESULT_READY = WM_APP + 151;
 	static const UINT WM_APP_INFO_TIP_READY = WM_APP + 152;
 	static const UINT WM_APP_SHELL_NOTIFY = WM_APP + 153;
+	static const UINT WM_APP_FILTER_RESULT_READY = WM_APP + 154;
+	static const UINT WM_APP_FOLDER_SIZE_RESULT_READY = WM_APP + 155;
+	static const UINT WM_APP_SEARCH_RESULTS_READY = WM_APP + 156;
+	static const UINT WM_APP_SEARCH_CONTENT_RESULT_READY = WM_APP + 157;
+	static const UINT WM_APP_FOLDER_SIZE_INVALIDATED = WM_APP + 158;
 
 	static const int THUMBNAIL_ITEM_WIDTH = 120;
 	static const int THUMBNAIL_ITEM_HEIGHT = 120;
@@ -382,6 +461,38 @@ private:
 	static const UINT PROCESS_SHELL_CHANGES_TIMER_ID = 1;
 	static const UINT PROCESS_SHELL_CHANGES_TIMEOUT = 100;
 
+	// When sorting by size, the folder is resorted at most this often while folder sizes are
+	// arriving, rather than after every individual result.
+	static const UINT FOLDER_SIZE_SORT_TIMER_ID = 2;
+	static const UINT FOLDER_SIZE_SORT_TIMEOUT = 500;
+
+	// The number of folders whose sizes are requested at any one time. The remaining folders wait
+	// here, so that whichever folders are visible when a request slot frees up can go first.
+	static const size_t MAX_FOLDER_SIZE_REQUESTS = 4;
+
+	struct FolderSizeResult
+	{
+		int requestId;
+		ULONGLONG size;
+	};
+
+	// The items in a set of search results are built in the background and passed back to the
+	// main thread in batches of this size.
+	static const size_t SEARCH_RESULTS_BATCH_SIZE = 256;
+
+	struct SearchResultsBatch
+	{
+		int searchResultsId;
+		std::vector<ItemInfo_t> items;
+	};
+
+	struct SearchContentResult
+	{
+		int searchResultsId;
+		std::wstring path;
+		bool matches;
+	};
+
 	ShellBrowser(int id, HWND hOwner, IExplorerplusplus *coreInterface,
 		TabNavigationInterface *tabNavigation, FileActionHandler *fileActionHandler,
 		const std::vector<std::unique_ptr<PreservedHistoryEntry>> &history, int currentEntry,
@@ -402,6 +513,12 @@ private:
 
 	/* Browsing support. */
 	HRESULT EnumerateFolder(PCIDLIST_ABSOLUTE pidlDirectory, bool addHistoryEntry);
+	void QueueSearchResultsTask(std::shared_ptr<const SearchResultsFolder> searchResults);
+	static void BuildSearchResultsAsync(HWND listView, int searchResultsId,
+		const std::atomic<int> &latestSearchResultsId, const std::vector<std::wstring> &results);
+	void ProcessSearchResultsBatch(SearchResultsBatch &batch);
+	void ClearPendingSearchResults();
+	void FinishBrowsing(PCIDLIST_ABSOLUTE pidlDirectory);
 	void PrepareToChangeFolders();
 	void ClearPendingResults();
 	void ResetFolderState();
@@ -413,6 +530,8 @@ private:
 	int AddItemInternal(int itemIndex, ItemInfo_t itemInfo, BOOL setPosition);
 	std::optional<ItemInfo_t> GetItemInformation(
 		IShellFolder *shellFolder, PCIDLIST_ABSOLUTE pidlDirectory, PCITEMID_CHILD pidlChild);
+	static std::optional<ItemInfo_t> BuildItemInformation(IShellFolder *shellFolder,
+		PCIDLIST_ABSOLUTE pidlDirectory, PCITEMID_CHILD pidlChild, bool isRecycleBin);
 	static HRESULT ExtractFindDataUsingPropertyStore(
 		IShellFolder *shellFolder, PCITEMID_CHILD pidlChild, WIN32_FIND_DATA &output);
 	void SetViewModeInternal(ViewMode viewMode);
@@ -470,6 +589,8 @@ private:
 
 	/* Sorting. */
 	int CALLBACK Sort(int InternalIndex1, int InternalIndex2) const;
+	int CompareItemsBySortText(int internalIndex1, int internalIndex2) const;
+	const std::wstring &GetItemSortText(int internalIndex) const;
 
 	/* Listview column support. */
 	void SetUpListViewColumns();
@@ -497,19 +618,30 @@ private:
 	void OnProcessShellChangeNotifications();
 	void ProcessShellChangeNotification(const ShellChangeNotification &change);
 	void OnFileAdded(const TCHAR *szFileName);
-	void AddItem(PCIDLIST_ABSOLUTE pidl);
+	void AddItem(PCIDLIST_ABSOLUTE pidl, bool searchContentChecked = false);
 	void RemoveItem(int iItemInternal);
 	void OnItemRemoved(PCIDLIST_ABSOLUTE pidl);
 	void OnFileRemoved(const TCHAR *szFileName);
 	void OnFileModified(const TCHAR *fileName);
-	void ModifyItem(PCIDLIST_ABSOLUTE pidl);
+	void ModifyItem(PCIDLIST_ABSOLUTE pidl, bool searchContentChecked = false);
 	void OnItemRenamed(PCIDLIST_ABSOLUTE pidlOld, PCIDLIST_ABSOLUTE pidlNew);
 	void OnFileRenamedOldName(const TCHAR *szFileName);
 	void OnFileRenamedNewName(const TCHAR *szFileName);
 	void RenameItem(int internalIndex, const TCHAR *szNewFileName);
 	void RenameItem(int internalIndex, PCIDLIST_ABSOLUTE pidlNew);
+	bool IsWithinCurrentFolder(PCIDLIST_ABSOLUTE pidl) const;
+	unique_pidl_absolute GetItemParentIdl(PCIDLIST_ABSOLUTE pidl) const;
+	bool DoesItemMatchSearch(const ItemInfo_t &itemInfo) const;
+	bool QueueSearchContentCheck(const ItemInfo_t &itemInfo);
+	void ProcessSearchContentResult(const SearchContentResult &result);
+	void RemoveSearchResultsWithin(const std::wstring &directory);
+	void IndexSearchResult(int internalIndex);
+	void RemoveSearchResultFromIndex(int internalIndex);
+	static std::wstring GetSearchResultKey(const std::wstring &path);
 	void InvalidateAllColumnsForItem(int itemIndex);
 	void InvalidateIconForItem(int itemIndex);
+	static void CarryOverCachedItemData(
+		ItemInfo_t &previousItemInfo, ItemInfo_t &updatedItemInfo, bool contentsModified);
 	int DetermineItemSortedPosition(LPARAM lParam) const;
 
 	/* Filtering support. */
@@ -521,6 +653,27 @@ private:
 	void UnfilterItem(int internalIndex);
 	void RestoreFilteredItem(int internalIndex);
 	void ApplyFilteringBackgroundImage(bool apply);
+	void QueueFilterTask();
+	static std::optional<FilterResult> FilterItemsAsync(HWND listView, int filterResultId,
+		const std::atomic<int> &latestFilterResultId, const WildcardMatcher &filterMatcher,
+		const std::vector<FilterCandidate> &shownItems,
+		const std::vector<FilterCandidate> &hiddenItems);
+	void ProcessFilterResult(int filterResultId);
+	void ClearPendingFilterResults();
+
+	/* Folder size support. */
+	bool ShouldCalculateFolderSize(const ItemInfo_t &itemInfo) const;
+	void QueueFolderSizeTask(int internalIndex);
+	void ScheduleFolderSizeTasks();
+	std::optional<int> TakeNextFolderSizeTask();
+	void RequestFolderSize(int internalIndex);
+	void ProcessFolderSizeResult(const FolderSizeResult &result);
+	void OnFolderSizeCalculated(int internalIndex, ULONGLONG size);
+	void OnFolderSizeInvalidated(const std::wstring &path);
+	void InvalidateFolderSize(int internalIndex);
+	void OnFolderSizeSortTimer();
+	void RemovePendingFolderSize(int internalIndex);
+	void ClearPendingFolderSizes();
 
 	/* Listview group support. */
 	static int CALLBACK GroupComparisonStub(int id1, int id2, void *data);
@@ -529,6 +682,7 @@ private:
 	int GroupRelativePositionComparison(const ListViewGroup &group1, const ListViewGroup &group2);
 	const ListViewGroup GetListViewGroupById(int groupId);
 	int DetermineItemGroup(int iItemInternal);
+	std::optional<GroupInfo> DetermineItemGroupInfo(int iItemInternal);
 	std::optional<GroupInfo> DetermineItemNameGroup(const BasicItemInfo_t &itemInfo) const;
 	std::optional<GroupInfo> DetermineItemSizeGroup(const BasicItemInfo_t &itemInfo) const;
 	std::optional<GroupInfo> DetermineItemTotalSizeGroup(const BasicItemInfo_t &itemInfo) const;
@@ -598,11 +752,13 @@ private:
 	void OnDropFile(const std::list<std::wstring> &PastedFileList, const POINT *ppt) override;
 
 	void OnApplicationShuttingDown();
+	void OnColorRulesUpdated();
 
 	/* Miscellaneous. */
 	BOOL CompareVirtualFolders(UINT uFolderCSIDL) const;
 	int LocateFileItemInternalIndex(const TCHAR *szFileName) const;
 	std::optional<int> GetItemInternalIndexForPidl(PCIDLIST_ABSOLUTE pidl) const;
+	std::optional<int> GetItemInternalIndexForPath(const std::wstring &path) const;
 	std::optional<int> LocateItemByInternalIndex(int internalIndex) const;
 	void ApplyHeaderSortArrow();
 
@@ -655,6 +811,30 @@ private:
 	std::unordered_map<int, std::future<std::optional<InfoTipResult>>> m_infoTipResults;
 	int m_infoTipResultIDCounter;
 
+	// Only the most recently queued filter task is of any interest. Earlier tasks check this and
+	// stop early, since their results would be discarded anyway.
+	std::atomic<int> m_latestFilterResultId;
+	ctpl::thread_pool m_filterThreadPool;
+	std::unordered_map<int, std::future<std::optional<FilterResult>>> m_filterResults;
+	int m_filterResultIDCounter;
+
+	// As with filtering, only the most recently queued set of search results is of interest.
+	std::atomic<int> m_latestSearchResultsId;
+	ctpl::thread_pool m_searchResultsThreadPool;
+	int m_searchResultsIdCounter;
+
+	// Items that change while a set of search results is shown have their contents checked here,
+	// so that reading them doesn't block the UI.
+	ctpl::thread_pool m_searchContentThreadPool;
+
+	// Folders whose sizes are yet to be requested, along with the requests that are outstanding
+	// (mapped to the internal index of the folder).
+	FolderSizeService *m_folderSizeService;
+	std::set<int> m_pendingFolderSizes;
+	std::unordered_map<int, int> m_folderSizeRequests;
+	int m_folderSizeRequestIdCounter;
+	bool m_folderSizeSortQueued;
+
 	/* Internal state. */
 	const HINSTANCE m_hResourceModule;
 	BOOL m_bFolderVisited;
@@ -670,8 +850,17 @@ private:
 	int m_uniqueFolderId;
 
 	const Config *m_config;
+	const NColorRuleHelper::ColorRuleMatcher *m_colorRuleMatcher;
 	FolderSettings m_folderSettings;
 
+	/* The current filter, compiled once whenever it changes. */
+	WildcardMatcher m_filterMatcher;
+
+	/* The filter that the items in the listview currently
+	reflect. This will lag behind the current filter while
+	a filter task is pending. */
+	WildcardMatcher m_appliedFilterMatcher;
+
 	/* ID. */
 	const int m_ID;
 
@@ -723,6 +912,7 @@ private:
 	BOOL m_bOnSameDrive;
 	int m_bOverFolder;
 	int m_iDropFolder;
+	FileOperationQueue *m_fileOperationQueue;
 
 	ListViewGroupSet m_listViewGroups;
 	int m_groupIdCounter;
@@ -7,44 +7,6 @@
 #include <wil/common.h>
 #include <propvarutil.h>
 
-int SortByName(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	const GlobalFolderSettings &globalFolderSettings)
-{
-	if (itemInfo1.isRoot && !itemInfo2.isRoot)
-	{
-		return -1;
-	}
-	else if (!itemInfo1.isRoot && itemInfo2.isRoot)
-	{
-		return 1;
-	}
-	else if (itemInfo1.isRoot && itemInfo2.isRoot)
-	{
-		/* If the items been compared are both drives,
-		sort by drive letter, rather than display name. */
-		if (globalFolderSettings.useNaturalSortOrder)
-		{
-			return StrCmpLogicalW(itemInfo1.getFullPath().c_str(), itemInfo2.getFullPath().c_str());
-		}
-		else
-		{
-			return StrCmpIW(itemInfo1.getFullPath().c_str(), itemInfo2.getFullPath().c_str());
-		}
-	}
-
-	std::wstring name1 = GetNameColumnText(itemInfo1, globalFolderSettings);
-	std::wstring name2 = GetNameColumnText(itemInfo2, globalFolderSettings);
-
-	if (globalFolderSettings.useNaturalSortOrder)
-	{
-		return StrCmpLogicalW(name1.c_str(), name2.c_str());
-	}
-	else
-	{
-		return StrCmpIW(name1.c_str(), name2.c_str());
-	}
-}
-
 int SortBySize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
 {
 	if (!itemInfo1.isFindDataValid && itemInfo2.isFindDataValid)
@@ -68,28 +30,23 @@ int SortBySize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo
 
 	if (isFolder1 && isFolder2)
 	{
-		// Temporarily disabled.
-		/*auto itr1 = m_cachedFolderSizes.find(InternalIndex1);
-		auto itr2 = m_cachedFolderSizes.find(InternalIndex2);
-
-		if (itr1 == m_cachedFolderSizes.end() && itr2 == m_cachedFolderSizes.end())
+		// Folders whose size hasn't been calculated (yet) are treated as being smaller than any
+		// folder whose size is known.
+		if (!itemInfo1.folderSize && !itemInfo2.folderSize)
 		{
 			return 0;
 		}
-		else if (itr1 != m_cachedFolderSizes.end() && itr2 == m_cachedFolderSizes.end())
+		else if (itemInfo1.folderSize && !itemInfo2.folderSize)
 		{
 			return 1;
 		}
-		else if (itr1 == m_cachedFolderSizes.end() && itr2 != m_cachedFolderSizes.end())
+		else if (!itemInfo1.folderSize && itemInfo2.folderSize)
 		{
 			return -1;
 		}
 
-		size1 = itr1->second;
-		size2 = itr2->second;*/
-
-		size1 = 0;
-		size2 = 0;
+		size1 = *itemInfo1.folderSize;
+		size2 = *itemInfo2.folderSize;
 	}
 	else
 	{
@@ -113,23 +70,6 @@ int SortBySize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo
 	return 0;
 }
 
-int SortByType(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
-{
-	if (itemInfo1.isRoot && !itemInfo2.isRoot)
-	{
-		return -1;
-	}
-	else if (!itemInfo1.isRoot && itemInfo2.isRoot)
-	{
-		return 1;
-	}
-
-	std::wstring type1 = GetTypeColumnText(itemInfo1);
-	std::wstring type2 = GetTypeColumnText(itemInfo2);
-
-	return StrCmpLogicalW(type1.c_str(), type2.c_str());
-}
-
 int SortByDate(
 	const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2, DateType dateType)
 {
@@ -199,14 +139,6 @@ int SortByTotalSize(
 	return 0;
 }
 
-int SortByAttributes(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
-{
-	std::wstring attributeString1 = GetAttributeColumnText(itemInfo1);
-	std::wstring attributeString2 = GetAttributeColumnText(itemInfo2);
-
-	return StrCmpLogicalW(attributeString1.c_str(), attributeString2.c_str());
-}
-
 int SortByRealSize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
 {
 	ULARGE_INTEGER realFileSize1;
@@ -240,39 +172,6 @@ int SortByRealSize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &item
 	return 0;
 }
 
-int SortByShortName(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
-{
-	std::wstring shortName1 = GetShortNameColumnText(itemInfo1);
-	std::wstring shortName2 = GetShortNameColumnText(itemInfo2);
-
-	return StrCmpLogicalW(shortName1.c_str(), shortName2.c_str());
-}
-
-int SortByOwner(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
-{
-	std::wstring owner1 = GetOwnerColumnText(itemInfo1);
-	std::wstring owner2 = GetOwnerColumnText(itemInfo2);
-
-	return StrCmpLogicalW(owner1.c_str(), owner2.c_str());
-}
-
-int SortByVersionInfo(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	VersionInfoType versionInfoType)
-{
-	std::wstring versionInfo1 = GetVersionColumnText(itemInfo1, versionInfoType);
-	std::wstring versionInfo2 = GetVersionColumnText(itemInfo2, versionInfoType);
-
-	return StrCmpLogicalW(versionInfo1.c_str(), versionInfo2.c_str());
-}
-
-int SortByShortcutTo(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
-{
-	std::wstring resolvedLinkPath1 = GetShortcutToColumnText(itemInfo1);
-	std::wstring resolvedLinkPath2 = GetShortcutToColumnText(itemInfo2);
-
-	return StrCmpLogicalW(resolvedLinkPath1.c_str(), resolvedLinkPath2.c_str());
-}
-
 int SortByHardlinks(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
 {
 	DWORD numHardLinks1 = GetHardLinksColumnRawData(itemInfo1);
@@ -281,14 +180,6 @@ int SortByHardlinks(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &ite
 	return numHardLinks1 - numHardLinks2;
 }
 
-int SortByExtension(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
-{
-	std::wstring extension1 = GetExtensionColumnText(itemInfo1);
-	std::wstring extension2 = GetExtensionColumnText(itemInfo2);
-
-	return StrCmpLogicalW(extension1.c_str(), extension2.c_str());
-}
-
 int SortByItemDetails(
 	const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2, const SHCOLUMNID *pscid)
 {
@@ -318,53 +209,233 @@ int SortByItemDetails(
 	return ret;
 }
 
-int SortByImageProperty(
-	const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2, PROPID PropertyId)
+bool IsSortModeTextBased(SortMode sortMode)
 {
-	std::wstring imageProperty1 = GetImageColumnText(itemInfo1, PropertyId);
-	std::wstring imageProperty2 = GetImageColumnText(itemInfo2, PropertyId);
+	switch (sortMode)
+	{
+	case SortMode::Size:
+	case SortMode::DateModified:
+	case SortMode::TotalSize:
+	case SortMode::FreeSpace:
+	case SortMode::DateDeleted:
+	case SortMode::OriginalLocation:
+	case SortMode::RealSize:
+	case SortMode::HardLinks:
+	case SortMode::Created:
+	case SortMode::Accessed:
+	case SortMode::Title:
+	case SortMode::Subject:
+	case SortMode::Authors:
+	case SortMode::Keywords:
+	case SortMode::Comments:
+		return false;
 
-	return StrCmpLogicalW(imageProperty1.c_str(), imageProperty2.c_str());
+	default:
+		return true;
+	}
 }
 
-int SortByVirtualComments(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
+std::wstring GetSortText(const BasicItemInfo_t &itemInfo, SortMode sortMode,
+	const GlobalFolderSettings &globalFolderSettings)
 {
-	std::wstring comments1 = GetControlPanelCommentsColumnText(itemInfo1);
-	std::wstring comments2 = GetControlPanelCommentsColumnText(itemInfo2);
+	switch (sortMode)
+	{
+	case SortMode::Name:
+		/* If the items being compared are drives,
+		sort by drive letter, rather than display name. */
+		if (itemInfo.isRoot)
+		{
+			return itemInfo.getFullPath();
+		}
 
-	return StrCmpLogicalW(comments1.c_str(), comments2.c_str());
-}
+		return GetNameColumnText(itemInfo, globalFolderSettings);
 
-int SortByFileSystem(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
-{
-	std::wstring fileSystemName1 = GetFileSystemColumnText(itemInfo1);
-	std::wstring fileSystemName2 = GetFileSystemColumnText(itemInfo2);
+	case SortMode::Type:
+		return GetTypeColumnText(itemInfo);
 
-	return StrCmpLogicalW(fileSystemName1.c_str(), fileSystemName2.c_str());
-}
+	case SortMode::Attributes:
+		return GetAttributeColumnText(itemInfo);
 
-int SortByPrinterProperty(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	PrinterInformationType printerInformationType)
-{
-	std::wstring printerInformation1 = GetPrinterColumnText(itemInfo1, printerInformationType);
-	std::wstring printerInformation2 = GetPrinterColumnText(itemInfo2, printerInformationType);
+	case SortMode::ShortName:
+		return GetShortNameColumnText(itemInfo);
+
+	case SortMode::Owner:
+		return GetOwnerColumnText(itemInfo);
+
+	case SortMode::ProductName:
+		return GetVersionColumnText(itemInfo, VersionInfoType::ProductName);
+
+	case SortMode::Company:
+		return GetVersionColumnText(itemInfo, VersionInfoType::Company);
+
+	case SortMode::Description:
+		return GetVersionColumnText(itemInfo, VersionInfoType::Description);
+
+	case SortMode::FileVersion:
+		return GetVersionColumnText(itemInfo, VersionInfoType::FileVersion);
+
+	case SortMode::ProductVersion:
+		return GetVersionColumnText(itemInfo, VersionInfoType::ProductVersion);
+
+	case SortMode::ShortcutTo:
+		return GetShortcutToColumnText(itemInfo);
+
+	case SortMode::Extension:
+		return GetExtensionColumnText(itemInfo);
+
+	case SortMode::CameraModel:
+		return GetImageColumnText(itemInfo, PropertyTagEquipModel);
+
+	case SortMode::DateTaken:
+		return GetImageColumnText(itemInfo, PropertyTagDateTime);
+
+	case SortMode::Width:
+		return GetImageColumnText(itemInfo, PropertyTagImageWidth);
+
+	case SortMode::Height:
+		return GetImageColumnText(itemInfo, PropertyTagImageHeight);
+
+	case SortMode::VirtualComments:
+		return GetControlPanelCommentsColumnText(itemInfo);
+
+	case SortMode::FileSystem:
+		return GetFileSystemColumnText(itemInfo);
+
+	case SortMode::NumPrinterDocuments:
+		return GetPrinterColumnText(itemInfo, PrinterInformationType::NumJobs);
+
+	case SortMode::PrinterStatus:
+		return GetPrinterColumnText(itemInfo, PrinterInformationType::Status);
+
+	case SortMode::PrinterComments:
+		return GetPrinterColumnText(itemInfo, PrinterInformationType::Comments);
+
+	case SortMode::PrinterLocation:
+		return GetPrinterColumnText(itemInfo, PrinterInformationType::Location);
+
+	case SortMode::NetworkAdapterStatus:
+		return GetNetworkAdapterColumnText(itemInfo);
+
+	case SortMode::MediaBitrate:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Bitrate);
+
+	case SortMode::MediaCopyright:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Copyright);
+
+	case SortMode::MediaDuration:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Duration);
+
+	case SortMode::MediaProtected:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Protected);
+
+	case SortMode::MediaRating:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Rating);
+
+	case SortMode::MediaAlbumArtist:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::AlbumArtist);
+
+	case SortMode::MediaAlbum:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::AlbumTitle);
+
+	case SortMode::MediaBeatsPerMinute:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::BeatsPerMinute);
 
-	return StrCmpLogicalW(printerInformation1.c_str(), printerInformation2.c_str());
+	case SortMode::MediaComposer:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Composer);
+
+	case SortMode::MediaConductor:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Conductor);
+
+	case SortMode::MediaDirector:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Director);
+
+	case SortMode::MediaGenre:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Genre);
+
+	case SortMode::MediaLanguage:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Language);
+
+	case SortMode::MediaBroadcastDate:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::BroadcastDate);
+
+	case SortMode::MediaChannel:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Channel);
+
+	case SortMode::MediaStationName:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::StationName);
+
+	case SortMode::MediaMood:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Mood);
+
+	case SortMode::MediaParentalRating:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::ParentalRating);
+
+	case SortMode::MediaParentalRatingReason:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::ParentalRatingReason);
+
+	case SortMode::MediaPeriod:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Period);
+
+	case SortMode::MediaProducer:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Producer);
+
+	case SortMode::MediaPublisher:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Publisher);
+
+	case SortMode::MediaWriter:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Writer);
+
+	case SortMode::MediaYear:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Year);
+
+	default:
+		assert(false);
+		break;
+	}
+
+	return std::wstring();
 }
 
-int SortByNetworkAdapterStatus(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
+int CompareSortText(const std::wstring &text1, const std::wstring &text2, SortMode sortMode,
+	const GlobalFolderSettings &globalFolderSettings)
 {
-	std::wstring status1 = GetNetworkAdapterColumnText(itemInfo1);
-	std::wstring status2 = GetNetworkAdapterColumnText(itemInfo2);
+	if (sortMode == +SortMode::Name && !globalFolderSettings.useNaturalSortOrder)
+	{
+		return StrCmpIW(text1.c_str(), text2.c_str());
+	}
 
-	return StrCmpLogicalW(status1.c_str(), status2.c_str());
+	return StrCmpLogicalW(text1.c_str(), text2.c_str());
 }
 
-int SortByMediaMetadata(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	MediaMetadataType mediaMetadataType)
+bool IsSortModeAffectedByChanges(SortMode sortMode, const ItemChanges &changes)
 {
-	std::wstring mediaMetadata1 = GetMediaMetadataColumnText(itemInfo1, mediaMetadataType);
-	std::wstring mediaMetadata2 = GetMediaMetadataColumnText(itemInfo2, mediaMetadataType);
+	switch (sortMode)
+	{
+	case SortMode::Name:
+	case SortMode::ShortName:
+	case SortMode::Extension:
+		return changes.name;
 
-	return StrCmpLogicalW(mediaMetadata1.c_str(), mediaMetadata2.c_str());
-}
\ No newline at end of file
+	case SortMode::Type:
+		// The type of an item depends on its extension and on whether or not it's a folder.
+		return changes.name || changes.attributes;
+
+	case SortMode::Attributes:
+		return changes.attributes;
+
+	case SortMode::Size:
+		return changes.size;
+
+	case SortMode::DateModified:
+	case SortMode::Created:
+	case SortMode::Accessed:
+		return changes.dates;
+
+	case SortMode::RealSize:
+		return changes.size || changes.contents;
+
+	default:
+		// Everything else is read from the item itself.
+		return changes.contents;
+	}
+}
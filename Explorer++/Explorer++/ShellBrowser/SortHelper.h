@@ -7,6 +7,7 @@
 #include "ColumnDataRetrieval.h"
 #include "FolderSettings.h"
 #include "ItemData.h"
+#include "SortModes.h"
 
 enum class DateType
 {
@@ -15,31 +16,38 @@ enum class DateType
 	Accessed
 };
 
-int SortByName(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
+// Describes which properties of an item changed when the item was updated.
+struct ItemChanges
+{
+	bool name;
+	bool size;
+	bool dates;
+	bool attributes;
+
+	// Set if the item itself may have been written to, in which case anything read from the item
+	// (e.g. its owner or version information) may also have changed.
+	bool contents;
+};
+
+// In most sort modes, items are ordered by comparing a piece of text associated with each item.
+// Retrieving that text can be expensive (e.g. the owner of a file or its version information), so
+// it's retrieved once per item, rather than once per comparison.
+bool IsSortModeTextBased(SortMode sortMode);
+std::wstring GetSortText(const BasicItemInfo_t &itemInfo, SortMode sortMode,
 	const GlobalFolderSettings &globalFolderSettings);
+int CompareSortText(const std::wstring &text1, const std::wstring &text2, SortMode sortMode,
+	const GlobalFolderSettings &globalFolderSettings);
+
+// Returns true if the changes could affect the position or group of an item sorted in the
+// specified mode.
+bool IsSortModeAffectedByChanges(SortMode sortMode, const ItemChanges &changes);
+
 int SortBySize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByType(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
 int SortByDate(
 	const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2, DateType dateType);
 int SortByTotalSize(
 	const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2, bool TotalSize);
-int SortByAttributes(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
 int SortByRealSize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByShortName(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByOwner(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByVersionInfo(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	VersionInfoType versionInfoType);
-int SortByShortcutTo(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
 int SortByHardlinks(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByExtension(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
 int SortByItemDetails(
 	const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2, const SHCOLUMNID *pscid);
-int SortByImageProperty(
-	const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2, PROPID PropertyId);
-int SortByVirtualComments(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByFileSystem(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByPrinterProperty(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	PrinterInformationType printerInformationType);
-int SortByNetworkAdapterStatus(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
-int SortByMediaMetadata(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
-	MediaMetadataType mediaMetadataType);
\ No newline at end of file
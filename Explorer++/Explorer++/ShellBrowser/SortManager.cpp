@@ -47,17 +47,11 @@ int CALLBACK ShellBrowser::Sort(int InternalIndex1, int InternalIndex2) const
 {
 	int comparisonResult = 0;
 
-	BasicItemInfo_t basicItemInfo1 = getBasicItemInfo(InternalIndex1);
-	BasicItemInfo_t basicItemInfo2 = getBasicItemInfo(InternalIndex2);
-
-	bool isFolder1 = ((basicItemInfo1.wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-						 == FILE_ATTRIBUTE_DIRECTORY)
-		? true
-		: false;
-	bool isFolder2 = ((basicItemInfo2.wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-						 == FILE_ATTRIBUTE_DIRECTORY)
-		? true
-		: false;
+	const ItemInfo_t &itemInfo1 = m_itemInfoMap.at(InternalIndex1);
+	const ItemInfo_t &itemInfo2 = m_itemInfoMap.at(InternalIndex2);
+
+	bool isFolder1 = WI_IsFlagSet(itemInfo1.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY);
+	bool isFolder2 = WI_IsFlagSet(itemInfo2.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY);
 
 	/* Folders will by default be sorted separately from files,
 	except in the recycle bin. */
@@ -71,19 +65,17 @@ int CALLBACK ShellBrowser::Sort(int InternalIndex1, int InternalIndex2) const
 	{
 		comparisonResult = 1;
 	}
+	else if (IsSortModeTextBased(m_folderSettings.sortMode))
+	{
+		comparisonResult = CompareItemsBySortText(InternalIndex1, InternalIndex2);
+	}
 	else
 	{
+		BasicItemInfo_t basicItemInfo1 = getBasicItemInfo(InternalIndex1);
+		BasicItemInfo_t basicItemInfo2 = getBasicItemInfo(InternalIndex2);
+
 		switch (m_folderSettings.sortMode)
 		{
-		case SortMode::Name:
-			comparisonResult =
-				SortByName(basicItemInfo1, basicItemInfo2, m_config->globalFolderSettings);
-			break;
-
-		case SortMode::Type:
-			comparisonResult = SortByType(basicItemInfo1, basicItemInfo2);
-			break;
-
 		case SortMode::Size:
 			comparisonResult = SortBySize(basicItemInfo1, basicItemInfo2);
 			break;
@@ -110,59 +102,14 @@ int CALLBACK ShellBrowser::Sort(int InternalIndex1, int InternalIndex2) const
 				SortByItemDetails(basicItemInfo1, basicItemInfo2, &SCID_ORIGINAL_LOCATION);
 			break;
 
-		case SortMode::Attributes:
-			comparisonResult = SortByAttributes(basicItemInfo1, basicItemInfo2);
-			break;
-
 		case SortMode::RealSize:
 			comparisonResult = SortByRealSize(basicItemInfo1, basicItemInfo2);
 			break;
 
-		case SortMode::ShortName:
-			comparisonResult = SortByShortName(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::Owner:
-			comparisonResult = SortByOwner(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::ProductName:
-			comparisonResult =
-				SortByVersionInfo(basicItemInfo1, basicItemInfo2, VersionInfoType::ProductName);
-			break;
-
-		case SortMode::Company:
-			comparisonResult =
-				SortByVersionInfo(basicItemInfo1, basicItemInfo2, VersionInfoType::Company);
-			break;
-
-		case SortMode::Description:
-			comparisonResult =
-				SortByVersionInfo(basicItemInfo1, basicItemInfo2, VersionInfoType::Description);
-			break;
-
-		case SortMode::FileVersion:
-			comparisonResult =
-				SortByVersionInfo(basicItemInfo1, basicItemInfo2, VersionInfoType::FileVersion);
-			break;
-
-		case SortMode::ProductVersion:
-			comparisonResult =
-				SortByVersionInfo(basicItemInfo1, basicItemInfo2, VersionInfoType::ProductVersion);
-			break;
-
-		case SortMode::ShortcutTo:
-			comparisonResult = SortByShortcutTo(basicItemInfo1, basicItemInfo2);
-			break;
-
 		case SortMode::HardLinks:
 			comparisonResult = SortByHardlinks(basicItemInfo1, basicItemInfo2);
 			break;
 
-		case SortMode::Extension:
-			comparisonResult = SortByExtension(basicItemInfo1, basicItemInfo2);
-			break;
-
 		case SortMode::Created:
 			comparisonResult = SortByDate(basicItemInfo1, basicItemInfo2, DateType::Created);
 			break;
@@ -191,178 +138,6 @@ int CALLBACK ShellBrowser::Sort(int InternalIndex1, int InternalIndex2) const
 			comparisonResult = SortByItemDetails(basicItemInfo1, basicItemInfo2, &PKEY_Comment);
 			break;
 
-		case SortMode::CameraModel:
-			comparisonResult =
-				SortByImageProperty(basicItemInfo1, basicItemInfo2, PropertyTagEquipModel);
-			break;
-
-		case SortMode::DateTaken:
-			comparisonResult =
-				SortByImageProperty(basicItemInfo1, basicItemInfo2, PropertyTagDateTime);
-			break;
-
-		case SortMode::Width:
-			comparisonResult =
-				SortByImageProperty(basicItemInfo1, basicItemInfo2, PropertyTagImageWidth);
-			break;
-
-		case SortMode::Height:
-			comparisonResult =
-				SortByImageProperty(basicItemInfo1, basicItemInfo2, PropertyTagImageHeight);
-			break;
-
-		case SortMode::VirtualComments:
-			comparisonResult = SortByVirtualComments(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::FileSystem:
-			comparisonResult = SortByFileSystem(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::NumPrinterDocuments:
-			comparisonResult = SortByPrinterProperty(
-				basicItemInfo1, basicItemInfo2, PrinterInformationType::NumJobs);
-			break;
-
-		case SortMode::PrinterStatus:
-			comparisonResult = SortByPrinterProperty(
-				basicItemInfo1, basicItemInfo2, PrinterInformationType::Status);
-			break;
-
-		case SortMode::PrinterComments:
-			comparisonResult = SortByPrinterProperty(
-				basicItemInfo1, basicItemInfo2, PrinterInformationType::Comments);
-			break;
-
-		case SortMode::PrinterLocation:
-			comparisonResult = SortByPrinterProperty(
-				basicItemInfo1, basicItemInfo2, PrinterInformationType::Location);
-			break;
-
-		case SortMode::NetworkAdapterStatus:
-			comparisonResult = SortByNetworkAdapterStatus(basicItemInfo1, basicItemInfo2);
-			break;
-
-		case SortMode::MediaBitrate:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Bitrate);
-			break;
-
-		case SortMode::MediaCopyright:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Copyright);
-			break;
-
-		case SortMode::MediaDuration:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Duration);
-			break;
-
-		case SortMode::MediaProtected:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Protected);
-			break;
-
-		case SortMode::MediaRating:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Rating);
-			break;
-
-		case SortMode::MediaAlbumArtist:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::AlbumArtist);
-			break;
-
-		case SortMode::MediaAlbum:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::AlbumTitle);
-			break;
-
-		case SortMode::MediaBeatsPerMinute:
-			comparisonResult = SortByMediaMetadata(
-				basicItemInfo1, basicItemInfo2, MediaMetadataType::BeatsPerMinute);
-			break;
-
-		case SortMode::MediaComposer:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Composer);
-			break;
-
-		case SortMode::MediaConductor:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Conductor);
-			break;
-
-		case SortMode::MediaDirector:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Director);
-			break;
-
-		case SortMode::MediaGenre:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Genre);
-			break;
-
-		case SortMode::MediaLanguage:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Language);
-			break;
-
-		case SortMode::MediaBroadcastDate:
-			comparisonResult = SortByMediaMetadata(
-				basicItemInfo1, basicItemInfo2, MediaMetadataType::BroadcastDate);
-			break;
-
-		case SortMode::MediaChannel:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Channel);
-			break;
-
-		case SortMode::MediaStationName:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::StationName);
-			break;
-
-		case SortMode::MediaMood:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Mood);
-			break;
-
-		case SortMode::MediaParentalRating:
-			comparisonResult = SortByMediaMetadata(
-				basicItemInfo1, basicItemInfo2, MediaMetadataType::ParentalRating);
-			break;
-
-		case SortMode::MediaParentalRatingReason:
-			comparisonResult = SortByMediaMetadata(
-				basicItemInfo1, basicItemInfo2, MediaMetadataType::ParentalRatingReason);
-			break;
-
-		case SortMode::MediaPeriod:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Period);
-			break;
-
-		case SortMode::MediaProducer:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Producer);
-			break;
-
-		case SortMode::MediaPublisher:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Publisher);
-			break;
-
-		case SortMode::MediaWriter:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Writer);
-			break;
-
-		case SortMode::MediaYear:
-			comparisonResult =
-				SortByMediaMetadata(basicItemInfo1, basicItemInfo2, MediaMetadataType::Year);
-			break;
-
 		default:
 			assert(false);
 			break;
@@ -376,11 +151,12 @@ int CALLBACK ShellBrowser::Sort(int InternalIndex1, int InternalIndex2) const
 		if (m_config->globalFolderSettings.useNaturalSortOrder)
 		{
 			comparisonResult =
-				StrCmpLogicalW(basicItemInfo1.szDisplayName, basicItemInfo2.szDisplayName);
+				StrCmpLogicalW(itemInfo1.displayName.c_str(), itemInfo2.displayName.c_str());
 		}
 		else
 		{
-			comparisonResult = StrCmpIW(basicItemInfo1.szDisplayName, basicItemInfo2.szDisplayName);
+			comparisonResult =
+				StrCmpIW(itemInfo1.displayName.c_str(), itemInfo2.displayName.c_str());
 		}
 	}
 
@@ -390,4 +166,36 @@ int CALLBACK ShellBrowser::Sort(int InternalIndex1, int InternalIndex2) const
 	}
 
 	return comparisonResult;
-}
\ No newline at end of file
+}
+int ShellBrowser::CompareItemsBySortText(int internalIndex1, int internalIndex2) const
+{
+	const ItemInfo_t &itemInfo1 = m_itemInfoMap.at(internalIndex1);
+	const ItemInfo_t &itemInfo2 = m_itemInfoMap.at(internalIndex2);
+
+	/* Drives are always shown before any other items
+	when sorting by name or type. */
+	bool drivesFirst = (m_folderSettings.sortMode == +SortMode::Name
+		|| m_folderSettings.sortMode == +SortMode::Type);
+
+	if (drivesFirst && itemInfo1.bDrive != itemInfo2.bDrive)
+	{
+		return itemInfo1.bDrive ? -1 : 1;
+	}
+
+	return CompareSortText(GetItemSortText(internalIndex1), GetItemSortText(internalIndex2),
+		m_folderSettings.sortMode, m_config->globalFolderSettings);
+}
+
+const std::wstring &ShellBrowser::GetItemSortText(int internalIndex) const
+{
+	const ItemInfo_t &itemInfo = m_itemInfoMap.at(internalIndex);
+
+	if (!itemInfo.cachedSortText || itemInfo.cachedSortText->sortMode != m_folderSettings.sortMode)
+	{
+		BasicItemInfo_t basicItemInfo = getBasicItemInfo(internalIndex);
+		itemInfo.cachedSortText = CachedSortText{ m_folderSettings.sortMode,
+			GetSortText(basicItemInfo, m_folderSettings.sortMode, m_config->globalFolderSettings) };
+	}
+
+	return itemInfo.cachedSortText->text;
+}
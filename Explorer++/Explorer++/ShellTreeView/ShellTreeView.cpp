@@ -43,6 +43,7 @@ ShellTreeView::ShellTreeView(HWND hParent, IExplorerplusplus *coreInterface,
 	m_tabContainer(tabContainer),
 	m_fileActionHandler(fileActionHandler),
 	m_cachedIcons(cachedIcons),
+	m_fileOperationQueue(coreInterface->GetFileOperationQueue()),
 	m_iRefCount(1),
 	m_itemIDCounter(0),
 	m_bDragDropRegistered(FALSE),
@@ -1944,7 +1945,7 @@ bool ShellTreeView::OnEndLabelEdit(const NMTVDISPINFO *dispInfo)
 
 	std::list<FileActionHandler::RenamedItem_t> renamedItemList;
 	renamedItemList.push_back(renamedItem);
-	m_fileActionHandler->RenameFiles(renamedItemList);
+	m_fileActionHandler->RenameFiles(m_hTreeView, renamedItemList);
 
 	return true;
 }
@@ -2008,7 +2009,7 @@ void ShellTreeView::PasteClipboardData()
 		return;
 	}
 
-	DropHandler *dropHandler = DropHandler::CreateNew();
+	DropHandler *dropHandler = DropHandler::CreateNew(m_fileOperationQueue);
 	dropHandler->CopyClipboardData(clipboardObject.get(), m_hTreeView, destinationPath.c_str(),
 		nullptr, !m_config->overwriteExistingFilesConfirmation);
 	dropHandler->Release();
@@ -16,6 +16,7 @@
 class CachedIcons;
 struct Config;
 class FileActionHandler;
+class FileOperationQueue;
 __interface IExplorerplusplus;
 class TabContainer;
 
@@ -254,6 +255,7 @@ private:
 	BOOL m_bDragAllowed;
 	BOOL m_bDataAccept;
 	DragType m_DragType;
+	FileOperationQueue *m_fileOperationQueue;
 
 	HTREEITEM m_cutItem;
 	wil::com_ptr_nothrow<IDataObject> m_clipboardDataObject;
@@ -276,7 +276,7 @@ HRESULT _stdcall ShellTreeView::Drop(
 		std::wstring destDirectory;
 		GetDisplayName(pidlDirectory.get(), SHGDN_FORPARSING, destDirectory);
 
-		DropHandler *pDropHandler = DropHandler::CreateNew();
+		DropHandler *pDropHandler = DropHandler::CreateNew(m_fileOperationQueue);
 		pDropHandler->Drop(pDataObject, grfKeyState, pt, pdwEffect, m_hTreeView, m_DragType,
 			destDirectory.c_str(), nullptr, FALSE);
 		pDropHandler->Release();
@@ -19,14 +19,17 @@
 #include "../Helper/XMLSettings.h"
 #include <wil/resource.h>
 #include <comdef.h>
+#include <algorithm>
 #include <unordered_map>
 
 namespace NSplitFileDialog
 {
-	const int WM_APP_SETTOTALSPLITCOUNT = WM_APP + 1;
-	const int WM_APP_SETCURRENTSPLITCOUNT = WM_APP + 2;
-	const int WM_APP_SPLITFINISHED = WM_APP + 3;
-	const int WM_APP_INPUTFILEINVALID = WM_APP + 4;
+	const int WM_APP_SETSPLITPROGRESS = WM_APP + 1;
+	const int WM_APP_SPLITFINISHED = WM_APP + 2;
+	const int WM_APP_INPUTFILEINVALID = WM_APP + 3;
+
+	// As with merging, progress is measured in bytes and scaled to this range.
+	const int PROGRESS_RANGE = 1000;
 
 	const TCHAR COUNTER_PATTERN[] = _T("/N");
 
@@ -37,6 +40,7 @@ const TCHAR SplitFileDialogPersistentSettings::SETTINGS_KEY[] = _T("SplitFile");
 
 const TCHAR SplitFileDialogPersistentSettings::SETTING_SIZE[] = _T("Size");
 const TCHAR SplitFileDialogPersistentSettings::SETTING_SIZE_GROUP[] = _T("SizeGroup");
+const TCHAR SplitFileDialogPersistentSettings::SETTING_WRITE_CHECKSUMS[] = _T("WriteChecksums");
 
 SplitFileDialog::SplitFileDialog(HINSTANCE hInstance, HWND hParent, IExplorerplusplus *expp,
 	const std::wstring &strFullFilename) :
@@ -153,7 +157,13 @@ INT_PTR SplitFileDialog::OnInitDialog()
 
 	SetDlgItemText(m_hDlg, IDC_SPLIT_STATIC_ELAPSEDTIME, _T("00:00:00"));
 
+	if (m_persistentSettings->m_bWriteChecksums)
+	{
+		CheckDlgButton(m_hDlg, IDC_SPLIT_CHECK_CHECKSUMS, BST_CHECKED);
+	}
+
 	AllowDarkModeForControls({ IDC_SPLIT_BUTTON_OUTPUT });
+	AllowDarkModeForCheckboxes({ IDC_SPLIT_CHECK_CHECKSUMS });
 	AllowDarkModeForGroupBoxes({ IDC_GROUP_FILE_INFORMATION, IDC_GROUP_SPLIT_INFORMATION });
 	AllowDarkModeForComboBoxes({ IDC_SPLIT_COMBOBOX_SIZES });
 
@@ -282,6 +292,8 @@ void SplitFileDialog::SaveState()
 	m_persistentSettings->m_strSplitSize = GetWindowString(GetDlgItem(m_hDlg, IDC_SPLIT_EDIT_SIZE));
 	m_persistentSettings->m_strSplitGroup =
 		GetWindowString(GetDlgItem(m_hDlg, IDC_SPLIT_COMBOBOX_SIZES));
+	m_persistentSettings->m_bWriteChecksums =
+		(IsDlgButtonChecked(m_hDlg, IDC_SPLIT_CHECK_CHECKSUMS) == BST_CHECKED);
 
 	m_persistentSettings->m_bStateSaved = TRUE;
 }
@@ -292,16 +304,12 @@ INT_PTR SplitFileDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lPara
 
 	switch (uMsg)
 	{
-	case NSplitFileDialog::WM_APP_SETTOTALSPLITCOUNT:
-		SendDlgItemMessage(m_hDlg, IDC_SPLIT_PROGRESS, PBM_SETRANGE32, 0, wParam);
-		break;
-
-	case NSplitFileDialog::WM_APP_SETCURRENTSPLITCOUNT:
+	case NSplitFileDialog::WM_APP_SETSPLITPROGRESS:
 		SendDlgItemMessage(m_hDlg, IDC_SPLIT_PROGRESS, PBM_SETPOS, wParam, 0);
 		break;
 
 	case NSplitFileDialog::WM_APP_SPLITFINISHED:
-		OnSplitFinished();
+		OnSplitFinished(static_cast<SplitFile::Result>(wParam));
 		break;
 
 	case NSplitFileDialog::WM_APP_INPUTFILEINVALID:
@@ -390,9 +398,9 @@ void SplitFileDialog::OnOk()
 		std::wstring strOutputDirectory = GetWindowString(hEditOutputDirectory);
 
 		BOOL bTranslated;
-		UINT uSplitSize = GetDlgItemInt(m_hDlg, IDC_SPLIT_EDIT_SIZE, &bTranslated, FALSE);
+		ULONGLONG splitSize = GetDlgItemInt(m_hDlg, IDC_SPLIT_EDIT_SIZE, &bTranslated, FALSE);
 
-		if (!bTranslated)
+		if (!bTranslated || splitSize == 0)
 		{
 			TCHAR szTemp[128];
 
@@ -421,21 +429,28 @@ void SplitFileDialog::OnOk()
 				break;
 
 			case SizeType::KB:
-				uSplitSize *= KB;
+				splitSize *= KB;
 				break;
 
 			case SizeType::MB:
-				uSplitSize *= MB;
+				splitSize *= MB;
 				break;
 
 			case SizeType::GB:
-				uSplitSize *= GB;
+				splitSize *= GB;
 				break;
 			}
 		}
 
-		m_pSplitFile = new SplitFile(
-			m_hDlg, m_strFullFilename, strOutputFilename, strOutputDirectory, uSplitSize);
+		bool writeChecksums =
+			(IsDlgButtonChecked(m_hDlg, IDC_SPLIT_CHECK_CHECKSUMS) == BST_CHECKED);
+
+		m_pSplitFile = new SplitFile(m_hDlg, m_strFullFilename, strOutputFilename,
+			strOutputDirectory, splitSize, writeChecksums);
+
+		SendDlgItemMessage(m_hDlg, IDC_SPLIT_PROGRESS, PBM_SETRANGE32, 0,
+			NSplitFileDialog::PROGRESS_RANGE);
+		SendDlgItemMessage(m_hDlg, IDC_SPLIT_PROGRESS, PBM_SETPOS, 0, 0);
 
 		GetDlgItemText(m_hDlg, IDOK, m_szOk, SIZEOF_ARRAY(m_szOk));
 
@@ -451,6 +466,10 @@ void SplitFileDialog::OnOk()
 		LoadString(GetInstance(), IDS_SPLITFILEDIALOG_SPLITTING, szTemp, SIZEOF_ARRAY(szTemp));
 		SetDlgItemText(m_hDlg, IDC_SPLIT_STATIC_MESSAGE, szTemp);
 
+		// The thread holds its own reference, since the dialog may be destroyed (and release its
+		// reference) before the split has finished.
+		m_pSplitFile->AddRef();
+
 		HANDLE hThread = CreateThread(nullptr, 0, NSplitFileDialog::SplitFileThreadProcStub,
 			reinterpret_cast<LPVOID>(m_pSplitFile), 0, nullptr);
 		SetThreadPriority(hThread, THREAD_PRIORITY_LOWEST);
@@ -503,17 +522,23 @@ void SplitFileDialog::OnChangeOutputDirectory()
 	SetDlgItemText(m_hDlg, IDC_SPLIT_EDIT_OUTPUT, parsingName.c_str());
 }
 
-void SplitFileDialog::OnSplitFinished()
+void SplitFileDialog::OnSplitFinished(SplitFile::Result result)
 {
-	TCHAR szTemp[64];
+	TCHAR szTemp[128];
 
-	if (!m_bStopSplitting)
+	switch (result)
 	{
+	case SplitFile::Result::Succeeded:
 		LoadString(GetInstance(), IDS_SPLITFILEDIALOG_FINISHED, szTemp, SIZEOF_ARRAY(szTemp));
-	}
-	else
-	{
+		break;
+
+	case SplitFile::Result::Stopped:
 		LoadString(GetInstance(), IDS_SPLITFILEDIALOG_CANCELLED, szTemp, SIZEOF_ARRAY(szTemp));
+		break;
+
+	default:
+		LoadString(GetInstance(), IDS_SPLITFILEDIALOG_FAILED, szTemp, SIZEOF_ARRAY(szTemp));
+		break;
 	}
 
 	SetDlgItemText(m_hDlg, IDC_SPLIT_STATIC_MESSAGE, szTemp);
@@ -528,9 +553,12 @@ void SplitFileDialog::OnSplitFinished()
 
 	KillTimer(m_hDlg, ELPASED_TIMER_ID);
 
-	int iHighLimit =
-		static_cast<int>(SendDlgItemMessage(m_hDlg, IDC_SPLIT_PROGRESS, PBM_GETRANGE, FALSE, 0));
-	SendDlgItemMessage(m_hDlg, IDC_SPLIT_PROGRESS, PBM_SETPOS, iHighLimit, 0);
+	if (result == SplitFile::Result::Succeeded)
+	{
+		int iHighLimit = static_cast<int>(
+			SendDlgItemMessage(m_hDlg, IDC_SPLIT_PROGRESS, PBM_GETRANGE, FALSE, 0));
+		SendDlgItemMessage(m_hDlg, IDC_SPLIT_PROGRESS, PBM_SETPOS, iHighLimit, 0);
+	}
 
 	SetDlgItemText(m_hDlg, IDOK, m_szOk);
 }
@@ -541,105 +569,174 @@ DWORD WINAPI NSplitFileDialog::SplitFileThreadProcStub(LPVOID pParam)
 
 	auto *pSplitFile = reinterpret_cast<SplitFile *>(pParam);
 	pSplitFile->Split();
+	pSplitFile->Release();
 
 	return 0;
 }
 
 SplitFile::SplitFile(HWND hDlg, const std::wstring &strFullFilename,
-	const std::wstring &strOutputFilename, const std::wstring &strOutputDirectory, UINT uSplitSize)
-{
-	m_hDlg = hDlg;
-	m_strFullFilename = strFullFilename;
-	m_strOutputFilename = strOutputFilename;
-	m_strOutputDirectory = strOutputDirectory;
-	m_uSplitSize = uSplitSize;
-
-	m_bStopSplitting = false;
-
-	InitializeCriticalSection(&m_csStop);
-}
-
-SplitFile::~SplitFile()
+	const std::wstring &strOutputFilename, const std::wstring &strOutputDirectory,
+	ULONGLONG splitSize, bool writeChecksums) :
+	m_hDlg(hDlg),
+	m_strFullFilename(strFullFilename),
+	m_strOutputFilename(strOutputFilename),
+	m_strOutputDirectory(strOutputDirectory),
+	m_splitSize(splitSize),
+	m_writeChecksums(writeChecksums),
+	m_partBytesWritten(0),
+	m_nSplitsMade(0),
+	m_progressPosition(0)
 {
-	DeleteCriticalSection(&m_csStop);
 }
 
 void SplitFile::Split()
 {
-	HANDLE hInputFile = CreateFile(m_strFullFilename.c_str(), GENERIC_READ, FILE_SHARE_READ,
-		nullptr, OPEN_EXISTING, 0, nullptr);
+	wil::unique_hfile inputFile(CreateFile(m_strFullFilename.c_str(), GENERIC_READ,
+		FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
 
-	if (hInputFile == INVALID_HANDLE_VALUE)
+	if (!inputFile)
 	{
 		PostMessage(m_hDlg, NSplitFileDialog::WM_APP_INPUTFILEINVALID, 0, 0);
 		return;
 	}
 
 	LARGE_INTEGER lFileSize;
-	GetFileSizeEx(hInputFile, &lFileSize);
+	GetFileSizeEx(inputFile.get(), &lFileSize);
+
+	Result result = SplitInternal(inputFile.get(), lFileSize.QuadPart);
+
+	SendMessage(m_hDlg, NSplitFileDialog::WM_APP_SPLITFINISHED, static_cast<WPARAM>(result), 0);
+}
+
+SplitFile::Result SplitFile::SplitInternal(HANDLE hInputFile, ULONGLONG fileSize)
+{
+	auto copyResult = m_streamCopier.Copy(StreamCopier::ReadFromFile(hInputFile),
+		[this](const void *buffer, size_t size) { return WriteToParts(buffer, size); },
+		[this, fileSize](uint64_t bytesCopied) { UpdateProgress(bytesCopied, fileSize); });
 
-	LONGLONG nSplits = lFileSize.QuadPart / m_uSplitSize;
+	FinishPart();
 
-	if ((lFileSize.QuadPart % m_uSplitSize) != 0)
+	switch (copyResult)
 	{
-		nSplits++;
-	}
+	case StreamCopier::Result::Succeeded:
+		break;
 
-	PostMessage(
-		m_hDlg, NSplitFileDialog::WM_APP_SETTOTALSPLITCOUNT, static_cast<WPARAM>(nSplits), 0);
+	case StreamCopier::Result::Stopped:
+		return Result::Stopped;
+
+	default:
+		return Result::Failed;
+	}
 
-	SplitInternal(hInputFile, lFileSize);
+	if (m_writeChecksums && !m_checksums.empty())
+	{
+		std::wstring manifestPath = m_strOutputDirectory + _T("\\")
+			+ PathFindFileName(m_strFullFilename.c_str()) + ChecksumManifest::FILE_EXTENSION;
 
-	CloseHandle(hInputFile);
+		if (!ChecksumManifest::Save(manifestPath, m_checksums))
+		{
+			return Result::Failed;
+		}
+	}
 
-	SendMessage(m_hDlg, NSplitFileDialog::WM_APP_SPLITFINISHED, 0, 0);
+	return Result::Succeeded;
 }
 
-void SplitFile::SplitInternal(HANDLE hInputFile, const LARGE_INTEGER &lFileSize)
+// Writes a block of the input, which may span the end of one part and the start of the next.
+bool SplitFile::WriteToParts(const void *buffer, size_t size)
 {
-	LARGE_INTEGER lRunningSplitSize = { 0 };
-
-	char *pBuffer = new char[m_uSplitSize];
-	bool bStop = false;
-	int nSplitsMade = 1;
+	auto *data = static_cast<const std::byte *>(buffer);
 
-	while (lRunningSplitSize.QuadPart < lFileSize.QuadPart && !bStop)
+	while (size > 0)
 	{
-		DWORD dwNumberOfBytesRead;
-		ReadFile(hInputFile, reinterpret_cast<LPVOID>(pBuffer), m_uSplitSize, &dwNumberOfBytesRead,
-			nullptr);
+		if (m_partFile && m_partBytesWritten == m_splitSize)
+		{
+			FinishPart();
+		}
 
-		std::wstring strOutputFullFilename;
-		ProcessFilename(nSplitsMade, strOutputFullFilename);
+		if (!m_partFile && !StartPart())
+		{
+			return false;
+		}
 
-		HANDLE hOutputFile = CreateFile(strOutputFullFilename.c_str(), GENERIC_WRITE, 0, nullptr,
-			CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+		auto bytesToWrite =
+			static_cast<size_t>(std::min<ULONGLONG>(size, m_splitSize - m_partBytesWritten));
 
-		if (hOutputFile != INVALID_HANDLE_VALUE)
+		if (!m_writePart(data, bytesToWrite))
 		{
-			DWORD dwNumberOfBytesWritten;
-			WriteFile(hOutputFile, reinterpret_cast<LPCVOID>(pBuffer), dwNumberOfBytesRead,
-				&dwNumberOfBytesWritten, nullptr);
+			return false;
+		}
 
-			CloseHandle(hOutputFile);
+		if (m_writeChecksums)
+		{
+			m_partHash.Update(data, bytesToWrite);
 		}
 
-		/* TODO: Wait for a set period of time before sending message
-		(so as not to block the GUI). */
-		PostMessage(m_hDlg, NSplitFileDialog::WM_APP_SETCURRENTSPLITCOUNT, nSplitsMade, 0);
+		m_partBytesWritten += bytesToWrite;
+		data += bytesToWrite;
+		size -= bytesToWrite;
+	}
 
-		lRunningSplitSize.QuadPart += dwNumberOfBytesRead;
-		nSplitsMade++;
+	return true;
+}
 
-		EnterCriticalSection(&m_csStop);
-		if (m_bStopSplitting)
-		{
-			bStop = true;
-		}
-		LeaveCriticalSection(&m_csStop);
+bool SplitFile::StartPart()
+{
+	m_nSplitsMade++;
+
+	std::wstring strOutputFullFilename;
+	ProcessFilename(m_nSplitsMade, strOutputFullFilename);
+
+	m_partFile.reset(CreateFile(strOutputFullFilename.c_str(), GENERIC_WRITE, 0, nullptr,
+		CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr));
+
+	if (!m_partFile)
+	{
+		return false;
+	}
+
+	m_writePart = StreamCopier::WriteToFile(m_partFile.get());
+	m_partFilename = PathFindFileName(strOutputFullFilename.c_str());
+	m_partBytesWritten = 0;
+	m_partHash = XxHash64();
+
+	return true;
+}
+
+void SplitFile::FinishPart()
+{
+	if (!m_partFile)
+	{
+		return;
+	}
+
+	m_partFile.reset();
+	m_writePart = nullptr;
+
+	if (m_writeChecksums)
+	{
+		m_checksums.push_back({ m_partFilename, m_partHash.GetHash() });
+	}
+}
+
+void SplitFile::UpdateProgress(ULONGLONG bytesSplit, ULONGLONG fileSize)
+{
+	int position = NSplitFileDialog::PROGRESS_RANGE;
+
+	// The file may have grown since its size was retrieved.
+	if (fileSize != 0 && bytesSplit < fileSize)
+	{
+		position = static_cast<int>(bytesSplit * NSplitFileDialog::PROGRESS_RANGE / fileSize);
+	}
+
+	if (position == m_progressPosition)
+	{
+		return;
 	}
 
-	delete[] pBuffer;
+	m_progressPosition = position;
+
+	PostMessage(m_hDlg, NSplitFileDialog::WM_APP_SETSPLITPROGRESS, position, 0);
 }
 
 void SplitFile::ProcessFilename(int nSplitsMade, std::wstring &strOutputFullFilename)
@@ -656,9 +753,7 @@ void SplitFile::ProcessFilename(int nSplitsMade, std::wstring &strOutputFullFile
 
 void SplitFile::StopSplitting()
 {
-	EnterCriticalSection(&m_csStop);
-	m_bStopSplitting = true;
-	LeaveCriticalSection(&m_csStop);
+	m_streamCopier.Stop();
 }
 
 SplitFileDialogPersistentSettings::SplitFileDialogPersistentSettings() :
@@ -666,6 +761,7 @@ SplitFileDialogPersistentSettings::SplitFileDialogPersistentSettings() :
 {
 	m_strSplitSize = _T("10");
 	m_strSplitGroup = _T("KB");
+	m_bWriteChecksums = FALSE;
 }
 
 SplitFileDialogPersistentSettings &SplitFileDialogPersistentSettings::GetInstance()
@@ -678,12 +774,15 @@ void SplitFileDialogPersistentSettings::SaveExtraRegistrySettings(HKEY hKey)
 {
 	RegistrySettings::SaveString(hKey, SETTING_SIZE, m_strSplitSize.c_str());
 	RegistrySettings::SaveString(hKey, SETTING_SIZE_GROUP, m_strSplitGroup.c_str());
+	RegistrySettings::SaveDword(hKey, SETTING_WRITE_CHECKSUMS, m_bWriteChecksums);
 }
 
 void SplitFileDialogPersistentSettings::LoadExtraRegistrySettings(HKEY hKey)
 {
 	RegistrySettings::ReadString(hKey, SETTING_SIZE, m_strSplitSize);
 	RegistrySettings::ReadString(hKey, SETTING_SIZE_GROUP, m_strSplitGroup);
+	RegistrySettings::ReadDword(
+		hKey, SETTING_WRITE_CHECKSUMS, reinterpret_cast<LPDWORD>(&m_bWriteChecksums));
 }
 
 void SplitFileDialogPersistentSettings::SaveExtraXMLSettings(
@@ -692,6 +791,8 @@ void SplitFileDialogPersistentSettings::SaveExtraXMLSettings(
 	NXMLSettings::AddAttributeToNode(pXMLDom, pParentNode, SETTING_SIZE, m_strSplitSize.c_str());
 	NXMLSettings::AddAttributeToNode(
 		pXMLDom, pParentNode, SETTING_SIZE_GROUP, m_strSplitGroup.c_str());
+	NXMLSettings::AddAttributeToNode(pXMLDom, pParentNode, SETTING_WRITE_CHECKSUMS,
+		NXMLSettings::EncodeBoolValue(m_bWriteChecksums));
 }
 
 void SplitFileDialogPersistentSettings::LoadExtraXMLSettings(BSTR bstrName, BSTR bstrValue)
@@ -704,4 +805,8 @@ void SplitFileDialogPersistentSettings::LoadExtraXMLSettings(BSTR bstrName, BSTR
 	{
 		m_strSplitGroup = _bstr_t(bstrValue);
 	}
+	else if (lstrcmpi(bstrName, SETTING_WRITE_CHECKSUMS) == 0)
+	{
+		m_bWriteChecksums = NXMLSettings::DecodeBoolValue(bstrValue);
+	}
 }
\ No newline at end of file
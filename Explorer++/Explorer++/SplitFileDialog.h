@@ -6,9 +6,13 @@
 
 #include "DarkModeDialogBase.h"
 #include "../Helper/DialogSettings.h"
+#include "../Helper/ChecksumManifest.h"
 #include "../Helper/ReferenceCount.h"
+#include "../Helper/StreamCopier.h"
+#include "../Helper/XxHash64.h"
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 __interface IExplorerplusplus;
 class SplitFileDialog;
@@ -25,6 +29,7 @@ private:
 
 	static const TCHAR SETTING_SIZE[];
 	static const TCHAR SETTING_SIZE_GROUP[];
+	static const TCHAR SETTING_WRITE_CHECKSUMS[];
 
 	SplitFileDialogPersistentSettings();
 
@@ -39,20 +44,31 @@ private:
 
 	std::wstring m_strSplitSize;
 	std::wstring m_strSplitGroup;
+	BOOL m_bWriteChecksums;
 };
 
 class SplitFile : public ReferenceCount
 {
 public:
+	enum class Result
+	{
+		Succeeded,
+		Failed,
+		Stopped
+	};
+
 	SplitFile(HWND hDlg, const std::wstring &strFullFilename, const std::wstring &strOutputFilename,
-		const std::wstring &strOutputDirectory, UINT uSplitSize);
-	~SplitFile();
+		const std::wstring &strOutputDirectory, ULONGLONG splitSize, bool writeChecksums);
 
 	void Split();
 	void StopSplitting();
 
 private:
-	void SplitInternal(HANDLE hInputFile, const LARGE_INTEGER &lFileSize);
+	Result SplitInternal(HANDLE hInputFile, ULONGLONG fileSize);
+	bool WriteToParts(const void *buffer, size_t size);
+	bool StartPart();
+	void FinishPart();
+	void UpdateProgress(ULONGLONG bytesSplit, ULONGLONG fileSize);
 	void ProcessFilename(int nSplitsMade, std::wstring &strOutputFullFilename);
 
 	HWND m_hDlg;
@@ -60,10 +76,25 @@ private:
 	std::wstring m_strFullFilename;
 	std::wstring m_strOutputFilename;
 	std::wstring m_strOutputDirectory;
-	UINT m_uSplitSize;
-
-	CRITICAL_SECTION m_csStop;
-	bool m_bStopSplitting;
+	ULONGLONG m_splitSize;
+	bool m_writeChecksums;
+
+	// The input is streamed through a fixed set of buffers as a single copy, with the output
+	// switching to a new part whenever the current one is full. That way, the next part is
+	// already being read while the current one is being written, and the amount of memory used
+	// doesn't depend on the split size.
+	StreamCopier m_streamCopier;
+
+	// The part currently being written.
+	wil::unique_hfile m_partFile;
+	StreamCopier::WriteFunction m_writePart;
+	std::wstring m_partFilename;
+	ULONGLONG m_partBytesWritten;
+	XxHash64 m_partHash;
+	int m_nSplitsMade;
+
+	std::vector<ChecksumManifest::Entry> m_checksums;
+	int m_progressPosition;
 };
 
 class SplitFileDialog : public DarkModeDialogBase
@@ -117,7 +148,7 @@ private:
 	void OnOk();
 	void OnCancel();
 	void OnChangeOutputDirectory();
-	void OnSplitFinished();
+	void OnSplitFinished(SplitFile::Result result);
 
 	IExplorerplusplus *m_expp;
 
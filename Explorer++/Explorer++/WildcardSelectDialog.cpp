@@ -12,6 +12,7 @@
 #include "../Helper/ListViewHelper.h"
 #include "../Helper/Macros.h"
 #include "../Helper/RegistrySettings.h"
+#include "../Helper/WildcardMatcher.h"
 #include "../Helper/XMLSettings.h"
 
 const TCHAR WildcardSelectDialogPersistentSettings::SETTINGS_KEY[] = _T("WildcardSelect");
@@ -140,11 +141,13 @@ void WildcardSelectDialog::SelectItems(TCHAR *szPattern)
 
 	int nItems = ListView_GetItemCount(hListView);
 
+	WildcardMatcher matcher(szPattern, false);
+
 	for (int i = 0; i < nItems; i++)
 	{
 		std::wstring filename = m_pexpp->GetActiveShellBrowser()->GetItemName(i);
 
-		if (CheckWildcardMatch(szPattern, filename.c_str(), FALSE) == 1)
+		if (matcher.Match(filename))
 		{
 			ListViewHelper::SelectItem(hListView, i, m_bSelect);
 		}
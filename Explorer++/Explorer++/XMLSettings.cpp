@@ -116,6 +116,7 @@ will need to be changed correspondingly. */
 #define HASH_DISPLAY_MIXED_FILES_AND_FOLDERS 1168704423
 #define HASH_USE_NATURAL_SORT_ORDER 528323501
 #define HASH_OPEN_TABS_IN_FOREGROUND 2957281235
+#define HASH_USE_NATIVE_COPY_ENGINE 4090927210
 
 struct ColumnXMLSaveData
 {
@@ -738,6 +739,10 @@ void Explorerplusplus::SaveGenericSettingsToXML(IXMLDOMDocument *pXMLDom, IXMLDO
 	NXMLSettings::WriteStandardSetting(pXMLDom, pe.get(), _T("Setting"), _T("OpenTabsInForeground"),
 		NXMLSettings::EncodeBoolValue(m_config->openTabsInForeground));
 
+	NXMLSettings::AddWhiteSpaceToNode(pXMLDom, bstr_wsntt.get(), pe.get());
+	NXMLSettings::WriteStandardSetting(pXMLDom, pe.get(), _T("Setting"), _T("UseNativeCopyEngine"),
+		NXMLSettings::EncodeBoolValue(m_config->useNativeCopyEngine));
+
 	auto bstr_wsnt = wil::make_bstr_nothrow(L"\n\t");
 	NXMLSettings::AddWhiteSpaceToNode(pXMLDom, bstr_wsnt.get(), pe.get());
 
@@ -1830,6 +1835,10 @@ void Explorerplusplus::MapAttributeToValue(IXMLDOMNode *pNode, WCHAR *wszName, W
 	case HASH_OPEN_TABS_IN_FOREGROUND:
 		m_config->openTabsInForeground = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
+
+	case HASH_USE_NATIVE_COPY_ENGINE:
+		m_config->useNativeCopyEngine = NXMLSettings::DecodeBoolValue(wszValue);
+		break;
 	}
 }
 
@@ -145,6 +145,7 @@
 #define IDD_OPTIONS_ADVANCED            327
 #define IDS_BOOKMARKS_OTHER_BOOKMARKS   328
 #define IDS_ADD_BOOKMARK_TITLE_EDIT_FOLDER 329
+#define IDD_DUPLICATEFILES              329
 #define IDS_ADD_BOOKMARK_TITLE_ADD_BOOKMARK 330
 #define IDS_ADD_BOOKMARK_TITLE_ADD_FOLDER 331
 #define IDS_MENU_BOOKMARK_ALL_TABS      332
@@ -180,6 +181,8 @@
 #define IDS_USE_NATURAL_SORT_ORDER_TOOLTIP 362
 #define IDS_ADVANCED_OPTION_OPEN_TABS_IN_FOREGROUND_NAME 363
 #define IDS_ADVANCED_OPTION_OPEN_TABS_IN_FOREGROUND_DESCRIPTION 364
+#define IDS_ADVANCED_OPTION_USE_NATIVE_COPY_ENGINE_NAME 365
+#define IDS_ADVANCED_OPTION_USE_NATIVE_COPY_ENGINE_DESCRIPTION 366
 #define IDC_DEFAULTCOLUMNS_DESCRIPTION  1001
 #define IDC_COLUMNS_DESCRIPTION         1001
 #define IDC_SETTINGS_CHECK_EXTENSIONS   1002
@@ -385,6 +388,18 @@
 #define IDC_ADVANCED_OPTION_DESCRIPTION 1346
 #define IDC_DISPLAY_MIXED_FILES_AND_FOLDERS 1347
 #define IDC_USE_NATURAL_SORT_ORDER      1348
+#define IDC_CHECK_USEINDEX              1349
+#define IDC_EDIT_CONTENTTEXT            1350
+#define IDC_EDIT_FILTER                 1351
+#define IDC_DUPLICATES_EDIT_DIRECTORY   1352
+#define IDC_DUPLICATES_CHECK_SUBFOLDERS 1353
+#define IDC_DUPLICATES_LISTVIEW         1354
+#define IDC_DUPLICATES_STATIC_STATUS    1355
+#define IDC_DUPLICATES_BUTTON_FIND      1356
+#define IDC_BUTTON_OPENINTAB            1357
+#define IDC_SPLIT_CHECK_CHECKSUMS       1358
+#define IDC_DESTROYFILES_PROGRESS       1359
+#define IDC_BUTTON_REBUILDINDEX         1360
 #define IDS_COLUMN_DESCRIPTION_NAME     2000
 #define IDS_COLUMN_DESCRIPTION_TYPE     2001
 #define IDS_COLUMN_DESCRIPTION_SIZE     2002
@@ -623,6 +638,26 @@
 #define IDS_GENERAL_TOTALFILESIZE       8215
 #define IDS_GENERAL_CALCULATING         8216
 #define IDS_TAB_CLOSE_TIP               8217
+#define IDS_SEARCH_PROGRESS_MESSAGE     8218
+#define IDS_SEARCH_COLUMN_LINES         8219
+#define IDS_SEARCH_FILTER_INVALID       8220
+#define IDS_DUPLICATES_COLUMN_SET       8221
+#define IDS_DUPLICATES_COLUMN_NAME      8222
+#define IDS_DUPLICATES_COLUMN_FOLDER    8223
+#define IDS_DUPLICATES_COLUMN_SIZE      8224
+#define IDS_DUPLICATES_SCANNING         8225
+#define IDS_DUPLICATES_COMPARING        8226
+#define IDS_DUPLICATES_FINISHED         8227
+#define IDS_DUPLICATES_CANCELLED        8228
+#define IDS_MERGE_FILES_FAILED          8229
+#define IDS_SPLITFILEDIALOG_FAILED      8230
+#define IDS_MERGE_FILES_CHECKSUM_MISMATCH 8231
+#define IDS_DESTROY_FILES_FAILED        8232
+#define IDS_SEARCH_INDEX_REBUILD_REQUESTED 8233
+#define IDS_DIRECTORY_LISTING_SAVED     8234
+#define IDS_DIRECTORY_LISTING_SAVE_FAILED 8235
+#define IDS_FILE_OPERATION_FAILED       8236
+#define IDS_GENERAL_CLOSE_FILE_OPERATIONS 8237
 #define IDM_FILE_NEWTAB                 40056
 #define IDM_FILE_CLOSETAB               40057
 #define IDM_FILE_OPENCOMMANDPROMPT      40059
@@ -814,6 +849,8 @@
 #define IDM_MB_ORGANIZE_PASTE           40541
 #define IDM_DISPLAYWINDOW_VERTICAL      40542
 #define IDM_POPUP_SHOW_COLUMNS          40543
+#define IDM_TOOLS_FINDDUPLICATES        40544
+#define IDM_FILE_SAVEDIRECTORYLISTINGRECURSIVE 40545
 #define IDM_SORTBY_NAME                 50000
 #define IDM_SORTBY_SIZE                 50001
 #define IDM_SORTBY_TYPE                 50002
@@ -951,9 +988,9 @@
 // 
 #ifdef APSTUDIO_INVOKED
 #ifndef APSTUDIO_READONLY_SYMBOLS
-#define _APS_NEXT_RESOURCE_VALUE        329
-#define _APS_NEXT_COMMAND_VALUE         40544
-#define _APS_NEXT_CONTROL_VALUE         1349
+#define _APS_NEXT_RESOURCE_VALUE        330
+#define _APS_NEXT_COMMAND_VALUE         40546
+#define _APS_NEXT_CONTROL_VALUE         1361
 #define _APS_NEXT_SYMED_VALUE           101
 #endif
 #endif
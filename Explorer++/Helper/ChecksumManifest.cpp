@@ -0,0 +1,174 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ChecksumManifest.h"
+#include "StringHelper.h"
+#include <wil/resource.h>
+#include <stdexcept>
+
+namespace
+{
+	const int HASH_LENGTH = 16;
+
+	// A manifest only ever lists a handful of files, so anything larger than this isn't one.
+	const DWORD MAX_MANIFEST_SIZE = 1024 * 1024;
+
+	std::optional<uint64_t> ParseHash(const std::string &text)
+	{
+		uint64_t hash = 0;
+
+		for (char c : text)
+		{
+			int digit;
+
+			if (c >= '0' && c <= '9')
+			{
+				digit = c - '0';
+			}
+			else if (c >= 'a' && c <= 'f')
+			{
+				digit = c - 'a' + 10;
+			}
+			else if (c >= 'A' && c <= 'F')
+			{
+				digit = c - 'A' + 10;
+			}
+			else
+			{
+				return std::nullopt;
+			}
+
+			hash = (hash << 4) | static_cast<uint64_t>(digit);
+		}
+
+		return hash;
+	}
+}
+
+std::string ChecksumManifest::Format(const std::vector<Entry> &entries)
+{
+	const char digits[] = "0123456789abcdef";
+	std::string contents;
+
+	for (const auto &entry : entries)
+	{
+		for (int i = HASH_LENGTH - 1; i >= 0; i--)
+		{
+			contents += digits[(entry.hash >> (i * 4)) & 0xF];
+		}
+
+		contents += "  ";
+		contents += wstrToUtf8Str(entry.filename);
+		contents += '\n';
+	}
+
+	return contents;
+}
+
+std::vector<ChecksumManifest::Entry> ChecksumManifest::Parse(const std::string &contents)
+{
+	std::vector<Entry> entries;
+	size_t lineStart = 0;
+
+	while (lineStart < contents.size())
+	{
+		size_t lineEnd = contents.find('\n', lineStart);
+
+		if (lineEnd == std::string::npos)
+		{
+			lineEnd = contents.size();
+		}
+
+		std::string line = contents.substr(lineStart, lineEnd - lineStart);
+		lineStart = lineEnd + 1;
+
+		if (!line.empty() && line.back() == '\r')
+		{
+			line.pop_back();
+		}
+
+		// The hash is followed by a space and then either another space or, for files hashed
+		// in binary mode, an asterisk.
+		if (line.size() <= HASH_LENGTH + 2 || line[HASH_LENGTH] != ' '
+			|| (line[HASH_LENGTH + 1] != ' ' && line[HASH_LENGTH + 1] != '*'))
+		{
+			continue;
+		}
+
+		auto hash = ParseHash(line.substr(0, HASH_LENGTH));
+
+		if (!hash)
+		{
+			continue;
+		}
+
+		std::wstring filename;
+
+		try
+		{
+			filename = utf8StrToWstr(line.substr(HASH_LENGTH + 2));
+		}
+		catch (const std::range_error &)
+		{
+			continue;
+		}
+
+		entries.push_back({ filename, *hash });
+	}
+
+	return entries;
+}
+
+bool ChecksumManifest::Save(const std::wstring &path, const std::vector<Entry> &entries)
+{
+	wil::unique_hfile file(CreateFile(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+		FILE_ATTRIBUTE_NORMAL, nullptr));
+
+	if (!file)
+	{
+		return false;
+	}
+
+	std::string contents = Format(entries);
+
+	DWORD bytesWritten;
+	BOOL res = WriteFile(file.get(), contents.data(), static_cast<DWORD>(contents.size()),
+		&bytesWritten, nullptr);
+
+	return res && bytesWritten == contents.size();
+}
+
+std::optional<std::vector<ChecksumManifest::Entry>> ChecksumManifest::Load(const std::wstring &path)
+{
+	wil::unique_hfile file(CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+
+	if (!file)
+	{
+		return std::nullopt;
+	}
+
+	LARGE_INTEGER fileSize;
+
+	if (!GetFileSizeEx(file.get(), &fileSize) || fileSize.QuadPart > MAX_MANIFEST_SIZE)
+	{
+		return std::nullopt;
+	}
+
+	std::string contents(static_cast<size_t>(fileSize.QuadPart), '\0');
+
+	DWORD bytesRead;
+	BOOL res = ReadFile(file.get(), contents.data(), static_cast<DWORD>(contents.size()),
+		&bytesRead, nullptr);
+
+	if (!res)
+	{
+		return std::nullopt;
+	}
+
+	contents.resize(bytesRead);
+
+	return Parse(contents);
+}
@@ -0,0 +1,33 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Reads and writes lists of file checksums. The format is the one used by xxhsum (the xxHash
+// command-line tool), so a manifest can also be checked outside of the application: each line
+// holds the XXH64 hash of a file in hexadecimal, followed by two spaces and the name of the file,
+// encoded as UTF-8.
+namespace ChecksumManifest
+{
+	struct Entry
+	{
+		std::wstring filename;
+		uint64_t hash;
+	};
+
+	inline constexpr wchar_t FILE_EXTENSION[] = L".xxh64";
+
+	std::string Format(const std::vector<Entry> &entries);
+
+	// Lines that aren't in the expected format are skipped.
+	std::vector<Entry> Parse(const std::string &contents);
+
+	bool Save(const std::wstring &path, const std::vector<Entry> &entries);
+	std::optional<std::vector<Entry>> Load(const std::wstring &path);
+}
@@ -0,0 +1,449 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "DirectoryListing.h"
+#include "Helper.h"
+#include "Macros.h"
+#include "ParallelDirectoryWalker.h"
+#include "StringHelper.h"
+#include <wil/common.h>
+#include <wil/resource.h>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+	// Each worker formats entries into its own buffer, which is only written out (under a lock)
+	// once it's grown to this size. This is what bounds the amount of memory used.
+	const size_t WORKER_BUFFER_SIZE = 64 * 1024;
+
+	const char UTF8_BOM[] = "\xEF\xBB\xBF";
+
+	struct WorkerStatistics
+	{
+		uint64_t numFolders = 0;
+		uint64_t numFiles = 0;
+		ULONGLONG totalSize = 0;
+	};
+
+	// Shared between the workers. Once a write has failed, nothing else is written.
+	class OutputFile
+	{
+	public:
+		explicit OutputFile(HANDLE file) : m_file(file), m_failed(false)
+		{
+		}
+
+		bool Write(const std::string &data)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			if (m_failed || data.empty())
+			{
+				return !m_failed;
+			}
+
+			DWORD bytesWritten;
+			BOOL res = WriteFile(
+				m_file, data.data(), static_cast<DWORD>(data.size()), &bytesWritten, nullptr);
+
+			if (!res || bytesWritten != data.size())
+			{
+				m_failed = true;
+			}
+
+			return !m_failed;
+		}
+
+		bool HasFailed()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_failed;
+		}
+
+	private:
+		const HANDLE m_file;
+		std::mutex m_mutex;
+		bool m_failed;
+	};
+
+	// Unlike wstrToUtf8Str(), this never throws. Invalid UTF-16 (e.g. an unpaired surrogate,
+	// which NTFS will happily store in a file name) is replaced, rather than failing the listing.
+	void AppendUtf8(const wchar_t *text, size_t length, std::string &output)
+	{
+		if (length == 0)
+		{
+			return;
+		}
+
+		int size = WideCharToMultiByte(
+			CP_UTF8, 0, text, static_cast<int>(length), nullptr, 0, nullptr, nullptr);
+
+		if (size <= 0)
+		{
+			return;
+		}
+
+		size_t offset = output.size();
+		output.resize(offset + size);
+		WideCharToMultiByte(CP_UTF8, 0, text, static_cast<int>(length), output.data() + offset,
+			size, nullptr, nullptr);
+	}
+
+	void AppendUtf8(const std::wstring &text, std::string &output)
+	{
+		AppendUtf8(text.c_str(), text.size(), output);
+	}
+
+	void AppendCsvField(const std::wstring &text, std::string &output)
+	{
+		if (text.find_first_of(L",\"\r\n") == std::wstring::npos)
+		{
+			AppendUtf8(text, output);
+			return;
+		}
+
+		output += '"';
+
+		std::string field;
+		AppendUtf8(text, field);
+
+		for (char c : field)
+		{
+			if (c == '"')
+			{
+				output += '"';
+			}
+
+			output += c;
+		}
+
+		output += '"';
+	}
+
+	void AppendJsonString(const std::wstring &text, std::string &output)
+	{
+		std::string value;
+		AppendUtf8(text, value);
+
+		output += '"';
+
+		for (char c : value)
+		{
+			if (c == '"' || c == '\\')
+			{
+				output += '\\';
+				output += c;
+			}
+			else if (static_cast<unsigned char>(c) < 0x20)
+			{
+				char escaped[8];
+				StringCchPrintfA(escaped, SIZEOF_ARRAY(escaped), "\\u%04x", c);
+				output += escaped;
+			}
+			else
+			{
+				output += c;
+			}
+		}
+
+		output += '"';
+	}
+
+	void AppendTime(const FILETIME &fileTime, std::string &output)
+	{
+		SYSTEMTIME systemTime;
+
+		if (!FileTimeToSystemTime(&fileTime, &systemTime))
+		{
+			return;
+		}
+
+		char time[32];
+		StringCchPrintfA(time, SIZEOF_ARRAY(time), "%04u-%02u-%02uT%02u:%02u:%02uZ",
+			systemTime.wYear, systemTime.wMonth, systemTime.wDay, systemTime.wHour,
+			systemTime.wMinute, systemTime.wSecond);
+		output += time;
+	}
+
+	std::wstring TrimTrailingBackslashes(const std::wstring &path)
+	{
+		size_t end = path.find_last_not_of(L'\\');
+		return (end == std::wstring::npos) ? std::wstring() : path.substr(0, end + 1);
+	}
+
+	bool ArePathsEqual(const std::wstring &path1, const std::wstring &path2)
+	{
+		return CompareStringOrdinal(path1.c_str(), static_cast<int>(path1.size()), path2.c_str(),
+				   static_cast<int>(path2.size()), TRUE)
+			== CSTR_EQUAL;
+	}
+
+	std::wstring FormatNumber(uint64_t number)
+	{
+		std::wstringstream ss;
+		ss.imbue(std::locale(""));
+		ss << number;
+		return ss.str();
+	}
+
+	void AppendTextHeader(const std::wstring &directory, std::string &output)
+	{
+		FILETIME currentTime;
+		GetSystemTimeAsFileTime(&currentTime);
+
+		TCHAR time[128];
+		CreateFileTimeString(&currentTime, time, SIZEOF_ARRAY(time), FALSE);
+
+		AppendUtf8(L"Directory\r\n---------\r\n" + directory + L"\r\n\r\n", output);
+		AppendUtf8(L"Date\r\n----\r\n" + std::wstring(time) + L"\r\n\r\n", output);
+	}
+
+	void AppendTextStatistics(
+		const WorkerStatistics &statistics, bool recursive, std::string &output)
+	{
+		ULARGE_INTEGER totalSize;
+		totalSize.QuadPart = statistics.totalSize;
+
+		TCHAR totalSizeText[32];
+		FormatSizeString(totalSize, totalSizeText, SIZEOF_ARRAY(totalSizeText));
+
+		std::wstring text = L"\r\nStatistics\r\n----------\r\n";
+		text += L"Number of folders: " + FormatNumber(statistics.numFolders) + L"\r\n";
+		text += L"Number of files: " + FormatNumber(statistics.numFiles) + L"\r\n";
+		text += recursive ? L"Total size (including subfolders): "
+						  : L"Total size (not including subfolders): ";
+		text += totalSizeText;
+		text += L"\r\n";
+
+		AppendUtf8(text, output);
+	}
+}
+
+bool DirectoryListing::Save(
+	const std::wstring &directory, const std::wstring &outputPath, const Options &options)
+{
+	wil::unique_hfile file(CreateFile(outputPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+
+	if (!file)
+	{
+		return false;
+	}
+
+	OutputFile outputFile(file.get());
+
+	size_t separatorIndex = outputPath.find_last_of(L'\\');
+	std::wstring outputDirectory = TrimTrailingBackslashes(outputPath.substr(
+		0, (separatorIndex == std::wstring::npos) ? 0 : separatorIndex));
+	std::wstring outputFileName = (separatorIndex == std::wstring::npos)
+		? outputPath
+		: outputPath.substr(separatorIndex + 1);
+
+	std::wstring rootDirectory = TrimTrailingBackslashes(directory);
+
+	std::string header;
+
+	switch (options.format)
+	{
+	case Format::Text:
+		header = UTF8_BOM;
+		AppendTextHeader(directory, header);
+		break;
+
+	case Format::Csv:
+		// The byte order mark is what allows spreadsheet applications to detect the encoding.
+		header = UTF8_BOM;
+		header += "Path,Type,Size,Modified,Attributes\r\n";
+		break;
+
+	case Format::JsonLines:
+		break;
+	}
+
+	ParallelDirectoryWalker walker(
+		options.recursive ? ParallelDirectoryWalker::GetDefaultNumWorkers() : 1);
+
+	std::vector<std::string> workerBuffers(walker.GetNumWorkers());
+	std::vector<WorkerStatistics> workerStatistics(walker.GetNumWorkers());
+
+	for (auto &buffer : workerBuffers)
+	{
+		buffer.reserve(WORKER_BUFFER_SIZE + MAX_PATH * 4);
+	}
+
+	// Without subfolders, the text format lists all folders before any files, which is done by
+	// enumerating the directory twice, rather than holding on to the list of files.
+	auto walkDirectory = [&](std::optional<bool> listFolders) {
+		walker.Walk(directory, options.recursive, nullptr,
+			[&](int workerIndex, const std::wstring &currentDirectory,
+				const WIN32_FIND_DATA &findData) {
+				bool isFolder = WI_IsFlagSet(findData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY);
+
+				if (listFolders && *listFolders != isFolder)
+				{
+					return;
+				}
+
+				std::wstring trimmedDirectory = TrimTrailingBackslashes(currentDirectory);
+
+				if (!isFolder && ArePathsEqual(findData.cFileName, outputFileName)
+					&& ArePathsEqual(trimmedDirectory, outputDirectory))
+				{
+					return;
+				}
+
+				auto &statistics = workerStatistics[workerIndex];
+
+				if (isFolder)
+				{
+					statistics.numFolders++;
+				}
+				else
+				{
+					statistics.numFiles++;
+					statistics.totalSize +=
+						(static_cast<ULONGLONG>(findData.nFileSizeHigh) << 32)
+						| findData.nFileSizeLow;
+				}
+
+				std::wstring relativePath;
+
+				if (trimmedDirectory.size() > rootDirectory.size())
+				{
+					relativePath = trimmedDirectory.substr(rootDirectory.size() + 1) + L"\\";
+				}
+
+				relativePath += findData.cFileName;
+
+				if (options.format == Format::Text && options.recursive && isFolder)
+				{
+					relativePath += L"\\";
+				}
+
+				auto &buffer = workerBuffers[workerIndex];
+				AppendEntry(options.format, relativePath, findData, buffer);
+
+				if (buffer.size() >= WORKER_BUFFER_SIZE)
+				{
+					if (!outputFile.Write(buffer))
+					{
+						walker.Stop();
+					}
+
+					buffer.clear();
+				}
+			});
+
+		for (auto &buffer : workerBuffers)
+		{
+			outputFile.Write(buffer);
+			buffer.clear();
+		}
+	};
+
+	if (options.format == Format::Text && !options.recursive)
+	{
+		outputFile.Write(header + "Folders\r\n-------\r\n");
+		walkDirectory(true);
+		outputFile.Write("\r\nFiles\r\n-----\r\n");
+		walkDirectory(false);
+	}
+	else if (options.format == Format::Text)
+	{
+		outputFile.Write(header + "Contents\r\n--------\r\n");
+		walkDirectory(std::nullopt);
+	}
+	else
+	{
+		outputFile.Write(header);
+		walkDirectory(std::nullopt);
+	}
+
+	if (options.format == Format::Text)
+	{
+		WorkerStatistics statistics;
+
+		for (const auto &currentStatistics : workerStatistics)
+		{
+			statistics.numFolders += currentStatistics.numFolders;
+			statistics.numFiles += currentStatistics.numFiles;
+			statistics.totalSize += currentStatistics.totalSize;
+		}
+
+		std::string footer;
+		AppendTextStatistics(statistics, options.recursive, footer);
+		outputFile.Write(footer);
+	}
+
+	return !outputFile.HasFailed();
+}
+
+DirectoryListing::Format DirectoryListing::GetFormatForFileName(const std::wstring &fileName)
+{
+	const TCHAR *extension = PathFindExtension(fileName.c_str());
+
+	if (lstrcmpi(extension, L".csv") == 0)
+	{
+		return Format::Csv;
+	}
+	else if (lstrcmpi(extension, L".jsonl") == 0 || lstrcmpi(extension, L".json") == 0)
+	{
+		return Format::JsonLines;
+	}
+
+	return Format::Text;
+}
+
+void DirectoryListing::AppendEntry(Format format, const std::wstring &relativePath,
+	const WIN32_FIND_DATA &findData, std::string &output)
+{
+	if (format == Format::Text)
+	{
+		AppendUtf8(relativePath, output);
+		output += "\r\n";
+		return;
+	}
+
+	bool isFolder = WI_IsFlagSet(findData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY);
+	ULONGLONG size =
+		(static_cast<ULONGLONG>(findData.nFileSizeHigh) << 32) | findData.nFileSizeLow;
+
+	if (format == Format::Csv)
+	{
+		AppendCsvField(relativePath, output);
+		output += isFolder ? ",folder," : ",file,";
+
+		if (!isFolder)
+		{
+			output += std::to_string(size);
+		}
+
+		output += ',';
+		AppendTime(findData.ftLastWriteTime, output);
+		output += ',';
+		output += std::to_string(findData.dwFileAttributes);
+		output += "\r\n";
+		return;
+	}
+
+	output += "{\"path\":";
+	AppendJsonString(relativePath, output);
+	output += isFolder ? ",\"type\":\"folder\"" : ",\"type\":\"file\"";
+
+	if (!isFolder)
+	{
+		output += ",\"size\":";
+		output += std::to_string(size);
+	}
+
+	output += ",\"modified\":\"";
+	AppendTime(findData.ftLastWriteTime, output);
+	output += "\",\"attributes\":";
+	output += std::to_string(findData.dwFileAttributes);
+	output += "}\n";
+}
@@ -0,0 +1,53 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <string>
+
+// Saves a listing of a directory to a file. Entries are written out while the directory is being
+// enumerated, through a small buffer per worker thread, so the amount of memory used stays the
+// same no matter how many entries are listed. The output is always encoded as UTF-8.
+//
+// The following formats are supported:
+//
+// - Text: a listing meant to be read, followed by a short summary. Folders and files are listed
+//   separately, unless subfolders are included, in which case each item is listed by its path
+//   (relative to the directory) and folders end in a backslash.
+// - Csv: a header row, followed by one row per item.
+// - JsonLines: one JSON object per item, on a line of its own.
+//
+// Each item in the CSV and JSON lines formats has its path (relative to the directory), type
+// ("folder" or "file"), size in bytes (files only), last modified time (in UTC, as ISO 8601) and
+// attributes (the numeric FILE_ATTRIBUTE_* flags).
+namespace DirectoryListing
+{
+	enum class Format
+	{
+		Text,
+		Csv,
+		JsonLines
+	};
+
+	struct Options
+	{
+		Format format = Format::Text;
+
+		// If set, the contents of every subfolder are listed as well.
+		bool recursive = false;
+	};
+
+	// Blocks until the listing has been written. Returns false if the output file couldn't be
+	// created or written to. The output file itself is never included in the listing.
+	bool Save(const std::wstring &directory, const std::wstring &outputPath,
+		const Options &options);
+
+	// Determined by the extension of the file (.csv for Csv, .jsonl or .json for JsonLines), with
+	// all other files using the text format.
+	Format GetFormatForFileName(const std::wstring &fileName);
+
+	// Appends the line for a single item to the output.
+	void AppendEntry(Format format, const std::wstring &relativePath,
+		const WIN32_FIND_DATA &findData, std::string &output);
+}
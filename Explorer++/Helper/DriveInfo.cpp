@@ -3,6 +3,7 @@
 // See LICENSE in the top level directory
 
 #include "stdafx.h"
+#include "DriveInfo.h"
 #include "FileOperations.h"
 #include "Helper.h"
 #include "Macros.h"
@@ -44,4 +45,20 @@ TCHAR GetDriveLetterFromMask(ULONG unitmask)
 	}
 
 	return (TCHAR) bitNum + 'A';
+}
+
+std::wstring GetVolumeForPath(const std::wstring &path)
+{
+	TCHAR volumePath[MAX_PATH];
+
+	if (!GetVolumePathName(path.c_str(), volumePath, SIZEOF_ARRAY(volumePath)))
+	{
+		// The root of the path is the same thing in all but a few cases (e.g. mounted folders).
+		StringCchCopy(volumePath, SIZEOF_ARRAY(volumePath), path.c_str());
+		PathStripToRoot(volumePath);
+	}
+
+	CharLowerBuff(volumePath, lstrlen(volumePath));
+
+	return volumePath;
 }
\ No newline at end of file
@@ -5,6 +5,11 @@
 #pragma once
 
 #include <Windows.h>
+#include <string>
 
 BOOL GetClusterSize(const TCHAR *drive, DWORD *pdwClusterSize);
-TCHAR GetDriveLetterFromMask(ULONG unitmask);
\ No newline at end of file
+TCHAR GetDriveLetterFromMask(ULONG unitmask);
+
+// Returns the mount point of the volume the path is on, in lowercase. This identifies the volume
+// (and so, generally, the disk) that the path is on.
+std::wstring GetVolumeForPath(const std::wstring &path);
\ No newline at end of file
@@ -5,12 +5,16 @@
 #include "stdafx.h"
 #include "DropHandler.h"
 #include "ContextMenuManager.h"
+#include "DriveInfo.h"
+#include "FileOperationQueue.h"
 #include "FileOperations.h"
 #include "Helper.h"
 #include "Logging.h"
 #include "Macros.h"
 #include "RegistrySettings.h"
 #include "ShellHelper.h"
+#include <memory>
+#include <utility>
 
 #define WM_APP_COPYOPERATIONFINISHED	(WM_APP + 1)
 #define SUBCLASS_ID	10000
@@ -53,6 +57,59 @@ WPARAM wParam,LPARAM lParam,UINT_PTR uIdSubclass,DWORD_PTR dwRefData);
 /* TODO: */
 void CreateDropOptionsMenu(HWND hDrop,LPCITEMIDLIST pidlDirectory,IDataObject *pDataObject);
 
+namespace
+{
+	// Runs an asynchronous drop as part of a file operation queue. The operation takes over the
+	// role of the background thread that would otherwise be created for the copy.
+	class DroppedFilesOperation : public FileOperationQueue::Operation
+	{
+	public:
+		explicit DroppedFilesOperation(PastedFilesInfo_t *ppfi) : m_ppfi(ppfi)
+		{
+		}
+
+		~DroppedFilesOperation()
+		{
+			// If the operation was discarded without being run, the drop source still needs to
+			// be told that nothing was copied.
+			if (m_ppfi)
+			{
+				m_ppfi->pac->EndOperation(E_ABORT, nullptr, DROPEFFECT_NONE);
+				m_ppfi->pac->Release();
+				m_ppfi->pReferenceCount->Release();
+
+				if (m_ppfi->pDropFilesCallback != nullptr)
+				{
+					m_ppfi->pDropFilesCallback->Release();
+				}
+
+				delete m_ppfi;
+			}
+		}
+
+		HRESULT Run(FileOperationQueue::OperationContext &context) override
+		{
+			// SHFileOperation offers no way of interrupting a copy once it's started, so the
+			// only checkpoint is before the copy begins. If the queue is shutting down, the
+			// destructor tells the drop source that nothing was copied.
+			if (!context.Checkpoint())
+			{
+				return HRESULT_FROM_WIN32(ERROR_CANCELLED);
+			}
+
+			// The stub takes ownership of (and frees) the copy information. Failures are
+			// reported to the drop source (and, by SHFileOperation, to the user), so there's
+			// nothing further to report here.
+			CopyDroppedFilesInternalAsyncStub(std::exchange(m_ppfi, nullptr));
+
+			return S_OK;
+		}
+
+	private:
+		PastedFilesInfo_t *m_ppfi;
+	};
+}
+
 /* Drop formats supported. */
 FORMATETC	DropHandler::m_ftcHDrop = {CF_HDROP,nullptr,DVASPECT_CONTENT,-1,TYMED_HGLOBAL};
 FORMATETC	DropHandler::m_ftcFileDescriptorA = {(CLIPFORMAT)RegisterClipboardFormat(CFSTR_FILEDESCRIPTORA),nullptr,DVASPECT_CONTENT,-1,TYMED_HGLOBAL};
@@ -62,9 +119,14 @@ FORMATETC	DropHandler::m_ftcText = {CF_TEXT,nullptr,DVASPECT_CONTENT,-1,TYMED_HG
 FORMATETC	DropHandler::m_ftcUnicodeText = {CF_UNICODETEXT,nullptr,DVASPECT_CONTENT,-1,TYMED_HGLOBAL};
 FORMATETC	DropHandler::m_ftcDIBV5 = {CF_DIBV5,nullptr,DVASPECT_CONTENT,-1,TYMED_HGLOBAL};
 
-DropHandler *DropHandler::CreateNew()
+DropHandler *DropHandler::CreateNew(FileOperationQueue *fileOperationQueue)
+{
+	return new DropHandler(fileOperationQueue);
+}
+
+DropHandler::DropHandler(FileOperationQueue *fileOperationQueue) :
+	m_fileOperationQueue(fileOperationQueue)
 {
-	return new DropHandler();
 }
 
 HRESULT DropHandler::GetDropFormats(std::list<FORMATETC> &ftcList)
@@ -1011,6 +1073,13 @@ void DropHandler::CopyDroppedFilesInternal(const std::list<std::wstring> &FullFi
 		the thread that the object was created in. */
 		SetWindowSubclass(m_hwndDrop,DropWindowSubclass,SUBCLASS_ID,NULL);
 
+		if(m_fileOperationQueue != nullptr)
+		{
+			m_fileOperationQueue->QueueOperation(GetVolumeForPath(m_destDirectory),
+				std::make_unique<DroppedFilesOperation>(ppfi));
+			return;
+		}
+
 		HANDLE hThread = CreateThread(nullptr,0,CopyDroppedFilesInternalAsyncStub,
 			reinterpret_cast<LPVOID>(ppfi),0,nullptr);
 
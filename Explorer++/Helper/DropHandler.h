@@ -7,6 +7,8 @@
 #include "ReferenceCount.h"
 #include <list>
 
+class FileOperationQueue;
+
 enum class DragType
 {
 	LeftClick,
@@ -26,8 +28,10 @@ public:
 
 	/* As this class is reference counted, the constructor
 	and destructor are both private. Use this method to
-	get a new instance of this class. */
-	static DropHandler	*CreateNew();
+	get a new instance of this class. If a file operation
+	queue is provided, asynchronous copies are run through
+	it, rather than starting straight away. */
+	static DropHandler	*CreateNew(FileOperationQueue *fileOperationQueue = nullptr);
 
 	static HRESULT		GetDropFormats(std::list<FORMATETC> &ftcList);
 
@@ -36,7 +40,7 @@ public:
 
 private:
 
-	DropHandler() = default;
+	DropHandler(FileOperationQueue *fileOperationQueue);
 	~DropHandler() = default;
 
 	void	HandleLeftClickDrop(IDataObject *pDataObject,POINTL *pptl);
@@ -77,4 +81,5 @@ private:
 	DragType			m_DragType;
 	std::wstring		m_destDirectory;
 	BOOL				m_bRenameOnCollision;
+	FileOperationQueue	*m_fileOperationQueue;
 };
\ No newline at end of file
@@ -0,0 +1,393 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "DuplicateFileFinder.h"
+#include "XxHash64.h"
+#include <wil/common.h>
+#include <wil/resource.h>
+#include <algorithm>
+#include <iterator>
+#include <thread>
+#include <tuple>
+
+namespace
+{
+	std::wstring CombinePath(const std::wstring &directory, const wchar_t *name)
+	{
+		std::wstring path = directory;
+
+		if (!path.empty() && path.back() != '\\')
+		{
+			path += '\\';
+		}
+
+		path += name;
+
+		return path;
+	}
+}
+
+DuplicateFileFinder::DuplicateFileFinder(int numWorkers) :
+	m_numWorkers(std::max(numWorkers, 1)),
+	m_walker(m_numWorkers),
+	m_stopped(false),
+	m_stage(Stage::Scanning),
+	m_filesFound(0),
+	m_filesToCompare(0),
+	m_filesCompared(0)
+{
+}
+
+std::vector<DuplicateFileFinder::DuplicateSet> DuplicateFileFinder::Find(
+	const std::wstring &rootDirectory, bool recursive)
+{
+	// Each worker gathers its own list of files, so that the workers never contend over a single
+	// list.
+	std::vector<std::vector<File>> workerFiles(m_walker.GetNumWorkers());
+
+	m_walker.Walk(rootDirectory, recursive, nullptr,
+		[this, &workerFiles](int workerIndex, const std::wstring &directory,
+			const WIN32_FIND_DATA &findData) {
+			// Reading an offline file (e.g. one that's only stored in the cloud) would cause the
+			// entire file to be downloaded.
+			if (WI_IsAnyFlagSet(findData.dwFileAttributes,
+					FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_OFFLINE
+						| FILE_ATTRIBUTE_RECALL_ON_DATA_ACCESS))
+			{
+				return;
+			}
+
+			ULONGLONG size =
+				(static_cast<ULONGLONG>(findData.nFileSizeHigh) << 32) | findData.nFileSizeLow;
+
+			// Empty files are trivially identical, but there's no space to be gained by removing
+			// them.
+			if (size == 0)
+			{
+				return;
+			}
+
+			workerFiles[workerIndex].push_back(
+				{ CombinePath(directory, findData.cFileName), size });
+			m_filesFound.fetch_add(1, std::memory_order_relaxed);
+		});
+
+	if (m_stopped)
+	{
+		return {};
+	}
+
+	std::vector<File> files;
+
+	for (auto &currentWorkerFiles : workerFiles)
+	{
+		std::move(currentWorkerFiles.begin(), currentWorkerFiles.end(), std::back_inserter(files));
+	}
+
+	return FindAmongFiles(std::move(files));
+}
+
+std::vector<DuplicateFileFinder::DuplicateSet> DuplicateFileFinder::FindAmongFiles(
+	std::vector<File> files)
+{
+	// Sorting by size brings together the files that could be duplicates of each other. Sorting by
+	// path as well means that the results don't depend on the order in which the files were
+	// found.
+	std::sort(files.begin(), files.end(), [](const File &file1, const File &file2) {
+		return std::tie(file1.size, file1.path) < std::tie(file2.size, file2.path);
+	});
+
+	std::vector<HashedFile> partialCandidates;
+
+	for (size_t start = 0; start < files.size();)
+	{
+		size_t end = start + 1;
+
+		while (end < files.size() && files[end].size == files[start].size)
+		{
+			end++;
+		}
+
+		if (end - start > 1)
+		{
+			for (size_t i = start; i < end; i++)
+			{
+				partialCandidates.push_back({ i });
+			}
+		}
+
+		start = end;
+	}
+
+	auto createDuplicateSet = [&files](const std::vector<HashedFile> &group) {
+		DuplicateSet duplicateSet;
+		duplicateSet.size = files[group[0].fileIndex].size;
+
+		for (const auto &hashedFile : group)
+		{
+			duplicateSet.paths.push_back(files[hashedFile.fileIndex].path);
+		}
+
+		return duplicateSet;
+	};
+
+	m_stage = Stage::ComparingPartialContents;
+	HashFiles(files, partialCandidates, false);
+
+	if (m_stopped)
+	{
+		return {};
+	}
+
+	std::vector<DuplicateSet> duplicateSets;
+	std::vector<HashedFile> fullCandidates;
+
+	for (const auto &group : GroupByHash(partialCandidates, files))
+	{
+		// The partial hash of a file this small already covers the entire file.
+		if (files[group[0].fileIndex].size <= 2 * PARTIAL_HASH_SIZE)
+		{
+			duplicateSets.push_back(createDuplicateSet(group));
+			continue;
+		}
+
+		for (const auto &hashedFile : group)
+		{
+			fullCandidates.push_back({ hashedFile.fileIndex });
+		}
+	}
+
+	m_stage = Stage::ComparingFullContents;
+	HashFiles(files, fullCandidates, true);
+
+	if (m_stopped)
+	{
+		return {};
+	}
+
+	for (const auto &group : GroupByHash(fullCandidates, files))
+	{
+		duplicateSets.push_back(createDuplicateSet(group));
+	}
+
+	std::sort(duplicateSets.begin(), duplicateSets.end(),
+		[](const DuplicateSet &set1, const DuplicateSet &set2) {
+			ULONGLONG wastedSpace1 = set1.size * (set1.paths.size() - 1);
+			ULONGLONG wastedSpace2 = set2.size * (set2.paths.size() - 1);
+
+			return std::tie(wastedSpace2, set1.paths[0]) < std::tie(wastedSpace1, set2.paths[0]);
+		});
+
+	m_stage = Stage::Finished;
+
+	return duplicateSets;
+}
+
+void DuplicateFileFinder::HashFiles(
+	const std::vector<File> &files, std::vector<HashedFile> &hashedFiles, bool fullContents)
+{
+	m_filesToCompare = static_cast<int>(hashedFiles.size());
+	m_filesCompared = 0;
+
+	std::atomic<size_t> nextIndex = 0;
+
+	auto worker = [this, &files, &hashedFiles, fullContents, &nextIndex] {
+		std::vector<char> buffer(READ_BUFFER_SIZE);
+
+		while (!m_stopped)
+		{
+			size_t index = nextIndex++;
+
+			if (index >= hashedFiles.size())
+			{
+				break;
+			}
+
+			auto &hashedFile = hashedFiles[index];
+			hashedFile.hashed =
+				HashFile(files[hashedFile.fileIndex], hashedFile, fullContents, buffer);
+
+			m_filesCompared.fetch_add(1, std::memory_order_relaxed);
+		}
+	};
+
+	size_t numThreads = std::min<size_t>(std::min(m_numWorkers, MAX_HASH_WORKERS),
+		std::max<size_t>(hashedFiles.size(), 1));
+
+	std::vector<std::thread> threads;
+
+	for (size_t i = 1; i < numThreads; i++)
+	{
+		threads.emplace_back(worker);
+	}
+
+	worker();
+
+	for (auto &thread : threads)
+	{
+		thread.join();
+	}
+}
+
+bool DuplicateFileFinder::HashFile(const File &file, HashedFile &hashedFile, bool fullContents,
+	std::vector<char> &buffer) const
+{
+	wil::unique_hfile handle(CreateFile(file.path.c_str(), GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+		FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+
+	if (!handle)
+	{
+		return false;
+	}
+
+	BY_HANDLE_FILE_INFORMATION fileInfo;
+
+	if (!GetFileInformationByHandle(handle.get(), &fileInfo))
+	{
+		return false;
+	}
+
+	// The file may have been modified since it was found.
+	ULONGLONG size = (static_cast<ULONGLONG>(fileInfo.nFileSizeHigh) << 32) | fileInfo.nFileSizeLow;
+
+	if (size != file.size)
+	{
+		return false;
+	}
+
+	hashedFile.volumeSerialNumber = fileInfo.dwVolumeSerialNumber;
+	hashedFile.fileId =
+		(static_cast<ULONGLONG>(fileInfo.nFileIndexHigh) << 32) | fileInfo.nFileIndexLow;
+
+	XxHash64 hash;
+
+	auto hashRange = [this, &handle, &buffer, &hash](ULONGLONG offset, ULONGLONG length) {
+		LARGE_INTEGER distance;
+		distance.QuadPart = offset;
+
+		if (!SetFilePointerEx(handle.get(), distance, nullptr, FILE_BEGIN))
+		{
+			return false;
+		}
+
+		while (length > 0)
+		{
+			if (m_stopped)
+			{
+				return false;
+			}
+
+			auto bytesToRead = static_cast<DWORD>(std::min<ULONGLONG>(length, buffer.size()));
+			DWORD bytesRead;
+			BOOL res = ReadFile(handle.get(), buffer.data(), bytesToRead, &bytesRead, nullptr);
+
+			if (!res || bytesRead == 0)
+			{
+				return false;
+			}
+
+			hash.Update(buffer.data(), bytesRead);
+			length -= std::min<ULONGLONG>(bytesRead, length);
+		}
+
+		return true;
+	};
+
+	bool res;
+
+	if (fullContents || file.size <= 2 * PARTIAL_HASH_SIZE)
+	{
+		res = hashRange(0, file.size);
+	}
+	else
+	{
+		res = hashRange(0, PARTIAL_HASH_SIZE)
+			&& hashRange(file.size - PARTIAL_HASH_SIZE, PARTIAL_HASH_SIZE);
+	}
+
+	if (!res)
+	{
+		return false;
+	}
+
+	hashedFile.hash = hash.GetHash();
+
+	return true;
+}
+
+// Returns the groups of files that have the same size and hash. Files that couldn't be hashed are
+// left out, as are any additional links to a file that's already in a group.
+std::vector<std::vector<DuplicateFileFinder::HashedFile>> DuplicateFileFinder::GroupByHash(
+	std::vector<HashedFile> &hashedFiles, const std::vector<File> &files) const
+{
+	hashedFiles.erase(std::remove_if(hashedFiles.begin(), hashedFiles.end(),
+						  [](const HashedFile &hashedFile) { return !hashedFile.hashed; }),
+		hashedFiles.end());
+
+	auto getKey = [&files](const HashedFile &hashedFile) {
+		return std::make_tuple(files[hashedFile.fileIndex].size, hashedFile.hash,
+			hashedFile.volumeSerialNumber, hashedFile.fileId, hashedFile.fileIndex);
+	};
+
+	std::sort(hashedFiles.begin(), hashedFiles.end(),
+		[&getKey](const HashedFile &hashedFile1, const HashedFile &hashedFile2) {
+			return getKey(hashedFile1) < getKey(hashedFile2);
+		});
+
+	// Links to the same file necessarily have the same size and hash, so they'll now be adjacent.
+	// Only the first link (i.e. the one with the lowest path) is kept.
+	hashedFiles.erase(std::unique(hashedFiles.begin(), hashedFiles.end(),
+						  [](const HashedFile &hashedFile1, const HashedFile &hashedFile2) {
+							  return hashedFile1.volumeSerialNumber
+									  == hashedFile2.volumeSerialNumber
+								  && hashedFile1.fileId == hashedFile2.fileId;
+						  }),
+		hashedFiles.end());
+
+	std::vector<std::vector<HashedFile>> groups;
+
+	for (size_t start = 0; start < hashedFiles.size();)
+	{
+		size_t end = start + 1;
+
+		while (end < hashedFiles.size()
+			&& files[hashedFiles[end].fileIndex].size == files[hashedFiles[start].fileIndex].size
+			&& hashedFiles[end].hash == hashedFiles[start].hash)
+		{
+			end++;
+		}
+
+		if (end - start > 1)
+		{
+			groups.emplace_back(hashedFiles.begin() + start, hashedFiles.begin() + end);
+		}
+
+		start = end;
+	}
+
+	return groups;
+}
+
+void DuplicateFileFinder::Stop()
+{
+	m_stopped = true;
+	m_walker.Stop();
+}
+
+bool DuplicateFileFinder::IsStopped() const
+{
+	return m_stopped;
+}
+
+DuplicateFileFinder::Progress DuplicateFileFinder::GetProgress() const
+{
+	Progress progress;
+	progress.stage = m_stage;
+	progress.filesFound = m_filesFound;
+	progress.filesToCompare = m_filesToCompare;
+	progress.filesCompared = m_filesCompared;
+	return progress;
+}
@@ -0,0 +1,112 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "ParallelDirectoryWalker.h"
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Finds sets of files that have identical contents. Files are compared in stages, with each stage
+// only considering the files that the previous stage couldn't rule out:
+//
+// 1. Files are grouped by size. The size is returned by the directory enumeration, so this costs
+//    nothing, and a file with a unique size can't have a duplicate.
+// 2. Files of the same size are compared by a hash of their first and last 64 KiB. Most files
+//    that merely happen to share a size will differ somewhere in that range.
+// 3. The remaining files are compared by a hash of their full contents.
+//
+// Multiple hard links to a file all have the same contents, but removing one of them doesn't free
+// any space, so each file is only counted once, however many links to it are found.
+//
+// A finder can only be used for a single search.
+class DuplicateFileFinder
+{
+public:
+	struct File
+	{
+		std::wstring path;
+		ULONGLONG size;
+	};
+
+	struct DuplicateSet
+	{
+		ULONGLONG size;
+		std::vector<std::wstring> paths;
+	};
+
+	enum class Stage
+	{
+		Scanning,
+		ComparingPartialContents,
+		ComparingFullContents,
+		Finished
+	};
+
+	// A snapshot of the progress of a search.
+	struct Progress
+	{
+		Stage stage = Stage::Scanning;
+		int filesFound = 0;
+
+		// The number of files to be hashed in the current stage and the number hashed so far.
+		int filesToCompare = 0;
+		int filesCompared = 0;
+	};
+
+	// The amount of data hashed from each end of a file in the second stage.
+	static constexpr ULONGLONG PARTIAL_HASH_SIZE = 64 * 1024;
+
+	explicit DuplicateFileFinder(int numWorkers);
+
+	// Searches the tree rooted at the specified directory. The sets that waste the most space are
+	// returned first. If the search is stopped, an empty list is returned.
+	std::vector<DuplicateSet> Find(const std::wstring &rootDirectory, bool recursive);
+
+	// Compares a set of files that have already been gathered.
+	std::vector<DuplicateSet> FindAmongFiles(std::vector<File> files);
+
+	// Can be called from any thread.
+	void Stop();
+	bool IsStopped() const;
+	Progress GetProgress() const;
+
+private:
+	// Reading several files at once helps to hide the latency of SSDs and network drives, but
+	// reading too many at once causes a spinning disk to spend its time seeking.
+	static constexpr int MAX_HASH_WORKERS = 4;
+
+	static constexpr size_t READ_BUFFER_SIZE = 1024 * 1024;
+
+	struct HashedFile
+	{
+		size_t fileIndex;
+
+		// Identifies the underlying file, so that hard links to the same file can be detected.
+		DWORD volumeSerialNumber = 0;
+		ULONGLONG fileId = 0;
+
+		uint64_t hash = 0;
+		bool hashed = false;
+	};
+
+	void HashFiles(const std::vector<File> &files, std::vector<HashedFile> &hashedFiles,
+		bool fullContents);
+	bool HashFile(const File &file, HashedFile &hashedFile, bool fullContents,
+		std::vector<char> &buffer) const;
+	std::vector<std::vector<HashedFile>> GroupByHash(
+		std::vector<HashedFile> &hashedFiles, const std::vector<File> &files) const;
+
+	const int m_numWorkers;
+	ParallelDirectoryWalker m_walker;
+
+	std::atomic<bool> m_stopped;
+	std::atomic<Stage> m_stage;
+	std::atomic<int> m_filesFound;
+	std::atomic<int> m_filesToCompare;
+	std::atomic<int> m_filesCompared;
+};
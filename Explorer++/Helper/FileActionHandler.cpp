@@ -11,50 +11,124 @@
 #include "FileActionHandler.h"
 #include "../Helper/FileOperations.h"
 #include "../Helper/Macros.h"
+#include "../Helper/RenamePlan.h"
 
-BOOL FileActionHandler::RenameFiles(const RenamedItems_t &itemList)
+BOOL FileActionHandler::RenameFiles(HWND hwnd, const RenamedItems_t &itemList)
 {
-	RenamedItems_t renamedItems;
+	return PerformRenames(hwnd, itemList, true);
+}
+
+/* The renames are performed as a batch, rather
+than one by one. Any renames that would collide
+with each other (or with an existing item) are
+rejected up front, and the rest are ordered so
+that items can swap names. Everything is renamed
+in a single operation, except for items that
+were moved to a temporary name to break a cycle,
+which are given their final names in a second
+operation. */
+BOOL FileActionHandler::PerformRenames(HWND hwnd, const RenamedItems_t &itemList, bool recordUndo)
+{
+	std::vector<RenamePlan::Rename> renames;
 
 	for (const auto &item : itemList)
 	{
-		/* TODO: This should actually be done by the caller. */
-		IShellItem *shellItem = nullptr;
-		HRESULT hr = SHCreateItemFromParsingName(
-			item.strOldFilename.c_str(), nullptr, IID_PPV_ARGS(&shellItem));
+		/* Only the name of an item can be changed,
+		so the item always stays in the same folder. */
+		TCHAR newPath[MAX_PATH];
+		StringCchCopy(newPath, SIZEOF_ARRAY(newPath), item.strOldFilename.c_str());
+		PathRemoveFileSpec(newPath);
 
-		if (SUCCEEDED(hr))
+		if (!PathAppend(newPath, PathFindFileName(item.strNewFilename.c_str())))
 		{
-			TCHAR newFilename[MAX_PATH];
-			StringCchCopy(newFilename, SIZEOF_ARRAY(newFilename), item.strNewFilename.c_str());
-			PathStripPath(newFilename);
+			continue;
+		}
+
+		renames.push_back({ item.strOldFilename, newPath });
+	}
+
+	RenamePlan plan(renames, [](const std::wstring &path) {
+		return GetFileAttributes(path.c_str()) != INVALID_FILE_ATTRIBUTES;
+	});
+
+	std::vector<bool> renamed(renames.size(), false);
+
+	auto results = NFileOperations::RenameFiles(hwnd, plan.GetSteps());
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		renamed[plan.GetSteps()[i].renameIndex] = (results[i] == S_OK);
+	}
+
+	/* Items that were part of a cycle have only
+	been moved to a temporary name at this point. */
+	std::vector<RenamePlan::Step> finalSteps;
+
+	for (const auto &step : plan.GetFinalSteps())
+	{
+		if (renamed[step.renameIndex])
+		{
+			renamed[step.renameIndex] = false;
+			finalSteps.push_back(step);
+		}
+	}
+
+	if (!finalSteps.empty())
+	{
+		results = NFileOperations::RenameFiles(hwnd, finalSteps);
 
-			/* TODO: Could rename all files in the list in a single
-			operation, rather than one by one.*/
-			hr = NFileOperations::RenameFile(shellItem, newFilename);
+		std::vector<RenamePlan::Step> restoreSteps;
 
-			if (SUCCEEDED(hr))
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			size_t renameIndex = finalSteps[i].renameIndex;
+
+			if (results[i] == S_OK)
 			{
-				renamedItems.push_back(item);
+				renamed[renameIndex] = true;
 			}
+			else
+			{
+				restoreSteps.push_back(
+					{ renameIndex, finalSteps[i].oldPath, renames[renameIndex].oldPath });
+			}
+		}
+
+		/* Rather than leaving an item with its
+		temporary name, attempt to restore its
+		original name. */
+		if (!restoreSteps.empty())
+		{
+			NFileOperations::RenameFiles(hwnd, restoreSteps);
+		}
+	}
+
+	RenamedItems_t renamedItems;
 
-			shellItem->Release();
+	for (size_t i = 0; i < renames.size(); i++)
+	{
+		if (renamed[i])
+		{
+			renamedItems.push_back({ renames[i].oldPath, renames[i].newPath });
 		}
 	}
 
+	if (renamedItems.empty())
+	{
+		return FALSE;
+	}
+
 	/* Only store an undo operation if at least one
 	file was actually renamed. */
-	if (!renamedItems.empty())
+	if (recordUndo)
 	{
 		UndoItem_t undoItem;
 		undoItem.type = UndoType::Renamed;
 		undoItem.renamedItems = renamedItems;
 		m_stackFileActions.push(undoItem);
-
-		return TRUE;
 	}
 
-	return FALSE;
+	return TRUE;
 }
 
 HRESULT FileActionHandler::DeleteFiles(
@@ -73,16 +147,17 @@ HRESULT FileActionHandler::DeleteFiles(
 	return hr;
 }
 
-void FileActionHandler::Undo()
+void FileActionHandler::Undo(HWND hwnd)
 {
 	if (!m_stackFileActions.empty())
 	{
-		UndoItem_t &undoItem = m_stackFileActions.top();
+		UndoItem_t undoItem = m_stackFileActions.top();
+		m_stackFileActions.pop();
 
 		switch (undoItem.type)
 		{
 		case UndoType::Renamed:
-			UndoRenameOperation(undoItem.renamedItems);
+			UndoRenameOperation(hwnd, undoItem.renamedItems);
 			break;
 
 		case UndoType::Copied:
@@ -95,12 +170,10 @@ void FileActionHandler::Undo()
 			UndoDeleteOperation(undoItem.deletedItems);
 			break;
 		}
-
-		m_stackFileActions.pop();
 	}
 }
 
-void FileActionHandler::UndoRenameOperation(const RenamedItems_t &renamedItemList)
+void FileActionHandler::UndoRenameOperation(HWND hwnd, const RenamedItems_t &renamedItemList)
 {
 	RenamedItems_t undoList;
 
@@ -114,7 +187,10 @@ void FileActionHandler::UndoRenameOperation(const RenamedItems_t &renamedItemLis
 		undoList.push_back(undoItem);
 	}
 
-	RenameFiles(undoList);
+	/* Undoing the operation shouldn't itself be
+	recorded, otherwise the next undo would simply
+	redo the renames. */
+	PerformRenames(hwnd, undoList, false);
 }
 
 void FileActionHandler::UndoDeleteOperation(const DeletedItems_t &deletedItemList)
@@ -20,10 +20,10 @@ public:
 	typedef std::list<RenamedItem_t> RenamedItems_t;
 	typedef std::vector<PCIDLIST_ABSOLUTE> DeletedItems_t;
 
-	BOOL RenameFiles(const RenamedItems_t &itemList);
+	BOOL RenameFiles(HWND hwnd, const RenamedItems_t &itemList);
 	HRESULT DeleteFiles(HWND hwnd, DeletedItems_t &deletedItems, bool permanent, bool silent);
 
-	void Undo();
+	void Undo(HWND hwnd);
 	BOOL CanUndo() const;
 
 private:
@@ -43,7 +43,8 @@ private:
 		DeletedItems_t deletedItems;
 	};
 
-	void UndoRenameOperation(const RenamedItems_t &renamedItemList);
+	BOOL PerformRenames(HWND hwnd, const RenamedItems_t &itemList, bool recordUndo);
+	void UndoRenameOperation(HWND hwnd, const RenamedItems_t &renamedItemList);
 	void UndoDeleteOperation(const DeletedItems_t &deletedItemList);
 
 	std::stack<UndoItem_t> m_stackFileActions;
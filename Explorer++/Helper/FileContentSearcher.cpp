@@ -0,0 +1,391 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "FileContentSearcher.h"
+#include "LiteralPrefilter.h"
+#include "StringHelper.h"
+#include "ThroughputLimiter.h"
+#include <wil/resource.h>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	const unsigned char UTF16_BYTE_ORDER_MARK[] = { 0xFF, 0xFE };
+
+	template <typename T>
+	int CountNewlines(std::basic_string_view<T> text)
+	{
+		return static_cast<int>(std::count(text.begin(), text.end(), static_cast<T>('\n')));
+	}
+
+	// Returns the length of the UTF-8 sequence that starts with the specified byte, or 0 if the
+	// byte can't start a sequence.
+	size_t GetUtf8SequenceLength(unsigned char leadByte)
+	{
+		if (leadByte >= 0xC2 && leadByte <= 0xDF)
+		{
+			return 2;
+		}
+		else if (leadByte >= 0xE0 && leadByte <= 0xEF)
+		{
+			return 3;
+		}
+		else if (leadByte >= 0xF0 && leadByte <= 0xF4)
+		{
+			return 4;
+		}
+
+		return 0;
+	}
+
+	bool IsUtf8ContinuationByte(unsigned char byte)
+	{
+		return (byte & 0xC0) == 0x80;
+	}
+
+	// Folds a single UTF-8 sequence in place. Returns false if the sequence isn't valid.
+	bool FoldUtf8Sequence(unsigned char *bytes, size_t length)
+	{
+		if (!std::all_of(bytes + 1, bytes + length, IsUtf8ContinuationByte))
+		{
+			return false;
+		}
+
+		// Characters outside the Basic Multilingual Plane aren't folded (and aren't folded in
+		// UTF-16 text either, where they're represented by surrogate pairs).
+		if (length == 4)
+		{
+			return true;
+		}
+
+		if (length == 2)
+		{
+			auto codePoint = static_cast<wchar_t>(((bytes[0] & 0x1F) << 6) | (bytes[1] & 0x3F));
+			wchar_t folded = LiteralPrefilter::FoldCharacter(codePoint);
+
+			// The folded character can only be written back if it takes up the same number of
+			// bytes. Otherwise, the character is left as is.
+			if (folded >= 0x80 && folded < 0x800)
+			{
+				bytes[0] = static_cast<unsigned char>(0xC0 | (folded >> 6));
+				bytes[1] = static_cast<unsigned char>(0x80 | (folded & 0x3F));
+			}
+
+			return true;
+		}
+
+		auto codePoint = static_cast<wchar_t>(
+			((bytes[0] & 0x0F) << 12) | ((bytes[1] & 0x3F) << 6) | (bytes[2] & 0x3F));
+
+		// Overlong encodings and encoded surrogates aren't valid.
+		if (codePoint < 0x800 || (codePoint >= 0xD800 && codePoint <= 0xDFFF))
+		{
+			return false;
+		}
+
+		wchar_t folded = LiteralPrefilter::FoldCharacter(codePoint);
+
+		if (folded >= 0x800 && (folded < 0xD800 || folded > 0xDFFF))
+		{
+			bytes[0] = static_cast<unsigned char>(0xE0 | (folded >> 12));
+			bytes[1] = static_cast<unsigned char>(0x80 | ((folded >> 6) & 0x3F));
+			bytes[2] = static_cast<unsigned char>(0x80 | (folded & 0x3F));
+		}
+
+		return true;
+	}
+}
+
+FileContentSearcher::FileContentSearcher(const std::wstring &text, bool caseSensitive,
+	unsigned long long maxFileSize, ThroughputLimiter *throughputLimiter, size_t chunkSize) :
+	m_utf8Text(wstrToUtf8Str(text)),
+	m_utf16Text(text),
+	m_caseSensitive(caseSensitive),
+	m_maxFileSize(maxFileSize),
+	m_throughputLimiter(throughputLimiter),
+	m_chunkSize(chunkSize)
+{
+	if (!m_caseSensitive)
+	{
+		FoldUnits(m_utf8Text.data(), m_utf8Text.size());
+		FoldUnits(m_utf16Text.data(), m_utf16Text.size());
+	}
+}
+
+std::vector<int> FileContentSearcher::SearchFile(
+	const std::wstring &path, const StopCallback &stopCallback) const
+{
+	wil::unique_hfile file(CreateFile(path.c_str(), GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+		FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+
+	if (!file)
+	{
+		return {};
+	}
+
+	LARGE_INTEGER fileSize;
+
+	if (!GetFileSizeEx(file.get(), &fileSize)
+		|| static_cast<unsigned long long>(fileSize.QuadPart) > m_maxFileSize)
+	{
+		return {};
+	}
+
+	auto remainingBytes = static_cast<unsigned long long>(fileSize.QuadPart);
+
+	auto readCallback = [this, &file, &remainingBytes, &stopCallback](
+							char *buffer, size_t size) -> std::optional<size_t> {
+		// Only the bytes that will actually be read count towards the limit, so small files
+		// aren't charged for the full size of the buffer.
+		auto bytesToRead = static_cast<DWORD>(std::min<unsigned long long>(size, remainingBytes));
+
+		if (m_throughputLimiter && !m_throughputLimiter->Acquire(bytesToRead, stopCallback))
+		{
+			return std::nullopt;
+		}
+
+		DWORD numBytesRead;
+		BOOL res = ReadFile(file.get(), buffer, bytesToRead, &numBytesRead, nullptr);
+
+		if (!res)
+		{
+			return std::nullopt;
+		}
+
+		remainingBytes -= std::min<unsigned long long>(numBytesRead, remainingBytes);
+
+		return numBytesRead;
+	};
+
+	// There's no need for a buffer any larger than the file itself.
+	auto chunkSize = static_cast<size_t>(std::max<unsigned long long>(
+		std::min<unsigned long long>(m_chunkSize, fileSize.QuadPart), 1));
+
+	return Search(readCallback, stopCallback, chunkSize);
+}
+
+std::vector<int> FileContentSearcher::SearchContents(std::string_view contents) const
+{
+	auto readCallback = [&contents](char *buffer, size_t size) -> std::optional<size_t> {
+		size_t bytesToRead = std::min(size, contents.size());
+		std::memcpy(buffer, contents.data(), bytesToRead);
+		contents.remove_prefix(bytesToRead);
+		return bytesToRead;
+	};
+
+	return Search(readCallback, nullptr, m_chunkSize);
+}
+
+std::vector<int> FileContentSearcher::Search(
+	const ReadCallback &readCallback, const StopCallback &stopCallback, size_t chunkSize) const
+{
+	if (m_utf8Text.empty())
+	{
+		return {};
+	}
+
+	// Besides the chunk itself, the buffer needs to be able to hold the units carried over from
+	// the previous chunk, as well as the odd byte when a chunk ends part of the way through a
+	// UTF-16 code unit.
+	size_t maxCarriedBytes =
+		std::max(m_utf8Text.size(), m_utf16Text.size() * sizeof(wchar_t)) + sizeof(wchar_t);
+	std::vector<char> buffer(chunkSize + maxCarriedBytes);
+
+	auto bytesRead = readCallback(buffer.data(), chunkSize);
+
+	if (!bytesRead)
+	{
+		return {};
+	}
+
+	size_t bufferEnd = *bytesRead;
+
+	if (bufferEnd >= sizeof(UTF16_BYTE_ORDER_MARK)
+		&& std::memcmp(buffer.data(), UTF16_BYTE_ORDER_MARK, sizeof(UTF16_BYTE_ORDER_MARK)) == 0)
+	{
+		bufferEnd -= sizeof(UTF16_BYTE_ORDER_MARK);
+		std::memmove(buffer.data(), buffer.data() + sizeof(UTF16_BYTE_ORDER_MARK), bufferEnd);
+
+		return SearchUnits(
+			m_utf16Text, buffer, bufferEnd, readCallback, stopCallback, chunkSize);
+	}
+
+	// Text files (other than UTF-16 files, which were handled above) won't contain null bytes,
+	// while almost every binary format will contain them early on.
+	if (std::memchr(buffer.data(), 0, std::min(bufferEnd, BINARY_CHECK_SIZE)) != nullptr)
+	{
+		return {};
+	}
+
+	return SearchUnits(m_utf8Text, buffer, bufferEnd, readCallback, stopCallback, chunkSize);
+}
+
+// Searches the units in the buffer, then repeatedly refills the buffer from the read callback
+// until the end of the file is reached. A match can span two chunks, so the units at the end of
+// each chunk that could form the start of a match are carried over to the front of the buffer
+// before the next chunk is read.
+template <typename T>
+std::vector<int> FileContentSearcher::SearchUnits(const std::basic_string<T> &needle,
+	std::vector<char> &buffer, size_t bufferEnd, const ReadCallback &readCallback,
+	const StopCallback &stopCallback, size_t chunkSize) const
+{
+	std::vector<int> lineNumbers;
+	int lineNumber = 1;
+
+	// Set once a match has been found on the current line. Any further matches on the same line
+	// don't need to be found, so the rest of the line is skipped.
+	bool skipToLineEnd = false;
+
+	size_t numFoldedUnits = 0;
+	bool endOfFile = false;
+
+	while (true)
+	{
+		if (stopCallback && stopCallback())
+		{
+			return {};
+		}
+
+		auto *units = reinterpret_cast<T *>(buffer.data());
+		size_t numUnits = bufferEnd / sizeof(T);
+		size_t foldedEnd = numUnits;
+
+		if (!m_caseSensitive)
+		{
+			foldedEnd =
+				numFoldedUnits + FoldUnits(units + numFoldedUnits, numUnits - numFoldedUnits);
+		}
+
+		// The character searches used by string_view::find() are vectorized by the C runtime, so
+		// this scans the chunk considerably faster than a simple loop would.
+		std::basic_string_view<T> chunk(units, numUnits);
+		size_t position = 0;
+		size_t countedPosition = 0;
+
+		while (true)
+		{
+			if (skipToLineEnd)
+			{
+				size_t lineEnd = chunk.find(static_cast<T>('\n'), position);
+
+				if (lineEnd == chunk.npos)
+				{
+					position = numUnits;
+					break;
+				}
+
+				position = lineEnd;
+				skipToLineEnd = false;
+			}
+
+			size_t match = chunk.find(needle, position);
+
+			if (match == chunk.npos)
+			{
+				break;
+			}
+
+			lineNumber += CountNewlines(chunk.substr(countedPosition, match - countedPosition));
+			countedPosition = match;
+
+			lineNumbers.push_back(lineNumber);
+
+			if (lineNumbers.size() >= MAX_LINE_NUMBERS)
+			{
+				return lineNumbers;
+			}
+
+			skipToLineEnd = true;
+			position = match + needle.size();
+		}
+
+		if (endOfFile)
+		{
+			break;
+		}
+
+		// Any units at the end of the chunk that couldn't be folded yet (because they form an
+		// incomplete UTF-8 sequence) are always carried over, so that they can be folded once the
+		// rest of the sequence has been read. Those units can't be part of a match, since the
+		// needle only contains complete sequences.
+		size_t carryPosition = std::min(foldedEnd,
+			std::max(position, numUnits - std::min(numUnits, needle.size() - 1)));
+		lineNumber += CountNewlines(chunk.substr(countedPosition, carryPosition - countedPosition));
+
+		size_t carryOffset = carryPosition * sizeof(T);
+		bufferEnd -= carryOffset;
+		std::memmove(buffer.data(), buffer.data() + carryOffset, bufferEnd);
+		numFoldedUnits = foldedEnd - carryPosition;
+
+		auto bytesRead = readCallback(buffer.data() + bufferEnd, chunkSize);
+
+		if (!bytesRead)
+		{
+			return {};
+		}
+
+		bufferEnd += *bytesRead;
+		endOfFile = (*bytesRead == 0);
+	}
+
+	return lineNumbers;
+}
+
+size_t FileContentSearcher::FoldUnits(char *units, size_t numUnits)
+{
+	auto *bytes = reinterpret_cast<unsigned char *>(units);
+	size_t i = 0;
+
+	while (i < numUnits)
+	{
+		if (bytes[i] < 0x80)
+		{
+			if (bytes[i] >= 'A' && bytes[i] <= 'Z')
+			{
+				bytes[i] = static_cast<unsigned char>(bytes[i] - 'A' + 'a');
+			}
+
+			i++;
+			continue;
+		}
+
+		size_t length = GetUtf8SequenceLength(bytes[i]);
+
+		if (length == 0)
+		{
+			i++;
+			continue;
+		}
+
+		// If the units end part of the way through what could be a valid sequence, the sequence
+		// is folded once the rest of it has been read.
+		if (i + length > numUnits)
+		{
+			if (std::all_of(bytes + i + 1, bytes + numUnits, IsUtf8ContinuationByte))
+			{
+				break;
+			}
+
+			i++;
+			continue;
+		}
+
+		i += FoldUtf8Sequence(bytes + i, length) ? length : 1;
+	}
+
+	return i;
+}
+
+size_t FileContentSearcher::FoldUnits(wchar_t *units, size_t numUnits)
+{
+	for (size_t i = 0; i < numUnits; i++)
+	{
+		units[i] = LiteralPrefilter::FoldCharacter(units[i]);
+	}
+
+	return numUnits;
+}
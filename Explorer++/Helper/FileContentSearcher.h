@@ -0,0 +1,88 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class ThroughputLimiter;
+
+// Searches the contents of files for a piece of text and reports the lines it appears on. Files
+// are streamed through a fixed size buffer, so the amount of memory used doesn't depend on the
+// size of the file.
+//
+// Files that start with a UTF-16 byte order mark are searched for the UTF-16 form of the text.
+// All other files are searched for the UTF-8 form of the text (which is also the ASCII form, for
+// text that's plain ASCII). Files that appear to be binary are skipped, as are files that are
+// larger than the size limit.
+//
+// When case is ignored, UTF-8 text is decoded before being folded, so case is ignored for the
+// same characters in both UTF-8 and UTF-16 files. The exception is the small number of characters
+// (such as the Kelvin sign) whose lowercase form has a UTF-8 encoding of a different length.
+// Those characters only match text in the same case. Characters outside the Basic Multilingual
+// Plane aren't folded in either type of file. Non-ASCII text in files that use some other code
+// page won't be found, since those files are searched for the UTF-8 form of the text.
+//
+// A single instance can be used to search files on any number of threads concurrently.
+class FileContentSearcher
+{
+public:
+	// Returns true if the search should be abandoned.
+	using StopCallback = std::function<bool()>;
+
+	static constexpr unsigned long long DEFAULT_MAX_FILE_SIZE = 64 * 1024 * 1024;
+	static constexpr size_t DEFAULT_CHUNK_SIZE = 1024 * 1024;
+
+	// Once this many matching lines have been found in a file, the rest of the file is skipped.
+	static constexpr size_t MAX_LINE_NUMBERS = 100;
+
+	// If non-null, the throughput limiter is used to limit the rate at which files are read. It
+	// needs to remain alive for as long as this instance is in use.
+	FileContentSearcher(const std::wstring &text, bool caseSensitive,
+		unsigned long long maxFileSize = DEFAULT_MAX_FILE_SIZE,
+		ThroughputLimiter *throughputLimiter = nullptr, size_t chunkSize = DEFAULT_CHUNK_SIZE);
+
+	// Returns the (1-based) numbers of the lines in the file that contain the text. An empty list
+	// is returned if the text isn't found, if the file is skipped or can't be read, or if the
+	// search is stopped part of the way through.
+	std::vector<int> SearchFile(const std::wstring &path, const StopCallback &stopCallback) const;
+
+	// Searches a set of file contents that are already in memory. The contents are processed in
+	// chunks, in exactly the same way a file would be.
+	std::vector<int> SearchContents(std::string_view contents) const;
+
+private:
+	// Reads up to the specified number of bytes into the buffer. Returns the number of bytes
+	// read (0 at the end of the file), or an empty value if the read failed.
+	using ReadCallback = std::function<std::optional<size_t>(char *buffer, size_t size)>;
+
+	// A file containing a null byte within this many bytes of the start is treated as binary.
+	static constexpr size_t BINARY_CHECK_SIZE = 8000;
+
+	std::vector<int> Search(const ReadCallback &readCallback, const StopCallback &stopCallback,
+		size_t chunkSize) const;
+
+	template <typename T>
+	std::vector<int> SearchUnits(const std::basic_string<T> &needle, std::vector<char> &buffer,
+		size_t bufferEnd, const ReadCallback &readCallback, const StopCallback &stopCallback,
+		size_t chunkSize) const;
+
+	// Folds text to lowercase, in place, and returns the number of units that were folded. For
+	// UTF-8 text, that will be less than the number of units passed in if the units end part of
+	// the way through a multi-byte sequence, since the sequence can't be decoded until the rest of
+	// it has been read. Bytes that don't form a valid sequence are left as is.
+	static size_t FoldUnits(char *units, size_t numUnits);
+	static size_t FoldUnits(wchar_t *units, size_t numUnits);
+
+	std::string m_utf8Text;
+	std::wstring m_utf16Text;
+	const bool m_caseSensitive;
+	const unsigned long long m_maxFileSize;
+	ThroughputLimiter *const m_throughputLimiter;
+	const size_t m_chunkSize;
+};
@@ -0,0 +1,272 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "FileCopier.h"
+#include "DriveInfo.h"
+#include "XxHash64.h"
+#include <wil/resource.h>
+#include <cstring>
+
+namespace
+{
+	FileCopier::Result ConvertResult(StreamCopier::Result result)
+	{
+		switch (result)
+		{
+		case StreamCopier::Result::Succeeded:
+			return FileCopier::Result::Succeeded;
+
+		case StreamCopier::Result::ReadFailed:
+			return FileCopier::Result::ReadFailed;
+
+		case StreamCopier::Result::WriteFailed:
+			return FileCopier::Result::WriteFailed;
+
+		case StreamCopier::Result::Stopped:
+		default:
+			return FileCopier::Result::Stopped;
+		}
+	}
+}
+
+FileCopier::FileCopier(
+	bool verify, uint64_t unbufferedThreshold, size_t bufferSize, size_t numBuffers) :
+	m_verify(verify),
+	m_unbufferedThreshold(unbufferedThreshold),
+	m_streamCopier(bufferSize, numBuffers)
+{
+}
+
+FileCopier::Result FileCopier::Copy(const std::wstring &source, const std::wstring &destination,
+	const StreamCopier::ProgressCallback &progressCallback)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributeData;
+
+	if (!GetFileAttributesEx(source.c_str(), GetFileExInfoStandard, &attributeData))
+	{
+		return Result::ReadFailed;
+	}
+
+	uint64_t size =
+		(static_cast<uint64_t>(attributeData.nFileSizeHigh) << 32) | attributeData.nFileSizeLow;
+
+	bool unbuffered = size >= m_unbufferedThreshold && CanUseUnbufferedIo(source)
+		&& CanUseUnbufferedIo(destination);
+	DWORD bufferingFlag = unbuffered ? FILE_FLAG_NO_BUFFERING : FILE_FLAG_SEQUENTIAL_SCAN;
+
+	wil::unique_hfile sourceFile(CreateFile(source.c_str(), GENERIC_READ, FILE_SHARE_READ,
+		nullptr, OPEN_EXISTING, bufferingFlag, nullptr));
+
+	if (!sourceFile)
+	{
+		return Result::ReadFailed;
+	}
+
+	// Reading is allowed, so that the file can be read back once it's been written.
+	wil::unique_hfile destinationFile(CreateFile(destination.c_str(), GENERIC_WRITE,
+		FILE_SHARE_READ, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL | bufferingFlag, nullptr));
+
+	if (!destinationFile)
+	{
+		return Result::WriteFailed;
+	}
+
+	Result result = CopyContents(sourceFile.get(), destinationFile.get(), destination, size,
+		unbuffered, progressCallback);
+
+	if (result == Result::Succeeded)
+	{
+		SetFileTime(destinationFile.get(), &attributeData.ftCreationTime,
+			&attributeData.ftLastAccessTime, &attributeData.ftLastWriteTime);
+	}
+
+	destinationFile.reset();
+
+	if (result != Result::Succeeded)
+	{
+		DeleteFile(destination.c_str());
+		return result;
+	}
+
+	SetFileAttributes(destination.c_str(), attributeData.dwFileAttributes);
+
+	return result;
+}
+
+FileCopier::Result FileCopier::CopyContents(HANDLE sourceFile, HANDLE destinationFile,
+	const std::wstring &destination, uint64_t size, bool unbuffered,
+	const StreamCopier::ProgressCallback &progressCallback)
+{
+	// Reserving the space up front allows the filesystem to allocate the file in as few pieces
+	// as possible. This is only a hint, so a failure here isn't fatal.
+	FILE_ALLOCATION_INFO allocationInfo;
+	allocationInfo.AllocationSize.QuadPart = static_cast<LONGLONG>(size);
+	SetFileInformationByHandle(
+		destinationFile, FileAllocationInfo, &allocationInfo, sizeof(allocationInfo));
+
+	auto write = StreamCopier::WriteToFile(destinationFile);
+
+	std::byte *padding = nullptr;
+	uint64_t bytesWritten = 0;
+
+	auto freePadding = wil::scope_exit([&padding] {
+		if (padding)
+		{
+			VirtualFree(padding, 0, MEM_RELEASE);
+		}
+	});
+
+	if (unbuffered)
+	{
+		// Unbuffered writes have to cover whole sectors, so the final, partial block of the file
+		// is padded out with zeros from this buffer and the file then truncated to its real size.
+		padding = static_cast<std::byte *>(VirtualAlloc(
+			nullptr, StreamCopier::BUFFER_ALIGNMENT, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+
+		if (!padding)
+		{
+			return Result::WriteFailed;
+		}
+
+		write = [writeToFile = write, destinationFile, size, padding, &bytesWritten](
+					const void *buffer, size_t blockSize) {
+			auto *data = static_cast<const std::byte *>(buffer);
+			size_t alignedSize = blockSize - (blockSize % StreamCopier::BUFFER_ALIGNMENT);
+
+			if (alignedSize > 0 && !writeToFile(data, alignedSize))
+			{
+				return false;
+			}
+
+			bytesWritten += alignedSize;
+
+			size_t remainder = blockSize - alignedSize;
+
+			if (remainder == 0)
+			{
+				return true;
+			}
+
+			// Anything written after a partial block would start at an unaligned offset, so a
+			// partial block is only valid at the very end of the file.
+			if (bytesWritten + remainder != size)
+			{
+				return false;
+			}
+
+			std::memcpy(padding, data + alignedSize, remainder);
+			std::memset(padding + remainder, 0, StreamCopier::BUFFER_ALIGNMENT - remainder);
+
+			if (!writeToFile(padding, StreamCopier::BUFFER_ALIGNMENT))
+			{
+				return false;
+			}
+
+			bytesWritten += remainder;
+
+			FILE_END_OF_FILE_INFO endOfFileInfo;
+			endOfFileInfo.EndOfFile.QuadPart = static_cast<LONGLONG>(size);
+			return SetFileInformationByHandle(destinationFile, FileEndOfFileInfo, &endOfFileInfo,
+					   sizeof(endOfFileInfo))
+				!= FALSE;
+		};
+	}
+
+	wil::unique_hfile readBackFile;
+	StreamCopier::ReadFunction readBack;
+
+	if (m_verify)
+	{
+		// Where possible, the file is read back without going through the cache, so that what's
+		// checked is what actually made it to the disk.
+		DWORD bufferingFlag =
+			CanUseUnbufferedIo(destination) ? FILE_FLAG_NO_BUFFERING : FILE_FLAG_SEQUENTIAL_SCAN;
+		readBackFile.reset(CreateFile(destination.c_str(), GENERIC_READ,
+			FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, bufferingFlag, nullptr));
+
+		if (!readBackFile)
+		{
+			return Result::VerificationFailed;
+		}
+
+		readBack = StreamCopier::ReadFromFile(readBackFile.get());
+	}
+
+	return CopyStream(StreamCopier::ReadFromFile(sourceFile), write, readBack, progressCallback);
+}
+
+FileCopier::Result FileCopier::CopyStream(const StreamCopier::ReadFunction &read,
+	const StreamCopier::WriteFunction &write, const StreamCopier::ReadFunction &readBack,
+	const StreamCopier::ProgressCallback &progressCallback)
+{
+	// The data is hashed on its way to the destination, so the source never needs to be read a
+	// second time.
+	XxHash64 sourceHash;
+
+	auto result = m_streamCopier.Copy(
+		read,
+		[&write, &sourceHash](const void *buffer, size_t size) {
+			sourceHash.Update(buffer, size);
+			return write(buffer, size);
+		},
+		progressCallback);
+
+	if (result != StreamCopier::Result::Succeeded)
+	{
+		return ConvertResult(result);
+	}
+
+	if (!m_verify)
+	{
+		return Result::Succeeded;
+	}
+
+	XxHash64 destinationHash;
+
+	result = m_streamCopier.Copy(readBack, [&destinationHash](const void *buffer, size_t size) {
+		destinationHash.Update(buffer, size);
+		return true;
+	});
+
+	if (result == StreamCopier::Result::Stopped)
+	{
+		return Result::Stopped;
+	}
+
+	// The hash covers the length of the data, so a destination that's been truncated or extended
+	// won't match either.
+	if (result != StreamCopier::Result::Succeeded
+		|| destinationHash.GetHash() != sourceHash.GetHash())
+	{
+		return Result::VerificationFailed;
+	}
+
+	return Result::Succeeded;
+}
+
+void FileCopier::Stop()
+{
+	m_streamCopier.Stop();
+}
+
+bool FileCopier::CanUseUnbufferedIo(const std::wstring &path) const
+{
+	// Unbuffered reads and writes have to be a whole number of sectors, both in size and offset.
+	// Each block (other than the last, which is padded) is the size of a buffer, so that needs to
+	// be a multiple of the sector size.
+	if ((m_streamCopier.GetBufferSize() % StreamCopier::BUFFER_ALIGNMENT) != 0)
+	{
+		return false;
+	}
+
+	DWORD sectorsPerCluster;
+	DWORD bytesPerSector;
+	DWORD numberOfFreeClusters;
+	DWORD totalNumberOfClusters;
+	BOOL res = GetDiskFreeSpace(GetVolumeForPath(path).c_str(), &sectorsPerCluster,
+		&bytesPerSector, &numberOfFreeClusters, &totalNumberOfClusters);
+
+	return res && bytesPerSector != 0 && (StreamCopier::BUFFER_ALIGNMENT % bytesPerSector) == 0;
+}
@@ -0,0 +1,60 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "StreamCopier.h"
+#include <cstdint>
+#include <string>
+
+// Copies files through a StreamCopier, so that the next block of a file is read while the
+// previous one is being written. Large files are copied with unbuffered I/O, which bypasses the
+// system file cache; that's generally no slower for a file of that size, and it means that copying
+// the file doesn't push everything else out of the cache.
+//
+// Each copy can also be verified. The data is hashed (with XXH64) as it's written, after which the
+// destination is read back and its hash compared against the original.
+class FileCopier
+{
+public:
+	enum class Result
+	{
+		Succeeded,
+		ReadFailed,
+		WriteFailed,
+		VerificationFailed,
+		Stopped
+	};
+
+	static constexpr uint64_t DEFAULT_UNBUFFERED_THRESHOLD = 256 * 1024 * 1024;
+
+	// Files at least unbufferedThreshold bytes in size are copied with unbuffered I/O.
+	FileCopier(bool verify, uint64_t unbufferedThreshold = DEFAULT_UNBUFFERED_THRESHOLD,
+		size_t bufferSize = StreamCopier::DEFAULT_BUFFER_SIZE,
+		size_t numBuffers = StreamCopier::DEFAULT_NUM_BUFFERS);
+
+	// Copies the file to the destination, which mustn't already exist. The timestamps and
+	// attributes of the file are copied as well. If the copy doesn't succeed, the partially
+	// written destination file is removed.
+	Result Copy(const std::wstring &source, const std::wstring &destination,
+		const StreamCopier::ProgressCallback &progressCallback = nullptr);
+
+	// Copies the source stream to the destination. If verification is enabled, readBack is then
+	// used to read the destination back in full.
+	Result CopyStream(const StreamCopier::ReadFunction &read,
+		const StreamCopier::WriteFunction &write, const StreamCopier::ReadFunction &readBack,
+		const StreamCopier::ProgressCallback &progressCallback = nullptr);
+
+	// Can be called from any thread. As with StreamCopier, a copier stays stopped once stopped.
+	void Stop();
+
+private:
+	bool CanUseUnbufferedIo(const std::wstring &path) const;
+	Result CopyContents(HANDLE sourceFile, HANDLE destinationFile, const std::wstring &destination,
+		uint64_t size, bool unbuffered, const StreamCopier::ProgressCallback &progressCallback);
+
+	const bool m_verify;
+	const uint64_t m_unbufferedThreshold;
+	StreamCopier m_streamCopier;
+};
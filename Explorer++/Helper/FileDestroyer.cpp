@@ -0,0 +1,269 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "FileDestroyer.h"
+#include "DriveInfo.h"
+#include "Macros.h"
+#include <wil/common.h>
+#include <wil/resource.h>
+#include <algorithm>
+#include <optional>
+#include <thread>
+
+namespace
+{
+	// Returns the size of the file rounded up to the end of the nearest cluster, since that's the
+	// amount of space that may contain the file's data. If the cluster size can't be determined,
+	// the logical size is returned instead.
+	std::optional<ULONGLONG> GetSizeOnDisk(const std::wstring &path)
+	{
+		WIN32_FILE_ATTRIBUTE_DATA attributeData;
+
+		if (!GetFileAttributesEx(path.c_str(), GetFileExInfoStandard, &attributeData)
+			|| WI_IsFlagSet(attributeData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+		{
+			return std::nullopt;
+		}
+
+		ULONGLONG size = (static_cast<ULONGLONG>(attributeData.nFileSizeHigh) << 32)
+			| attributeData.nFileSizeLow;
+
+		TCHAR szRoot[MAX_PATH];
+		HRESULT hr = StringCchCopy(szRoot, SIZEOF_ARRAY(szRoot), path.c_str());
+
+		DWORD dwClusterSize;
+
+		if (FAILED(hr) || !PathStripToRoot(szRoot) || !GetClusterSize(szRoot, &dwClusterSize)
+			|| dwClusterSize == 0)
+		{
+			return size;
+		}
+
+		if ((size % dwClusterSize) != 0)
+		{
+			size += dwClusterSize - (size % dwClusterSize);
+		}
+
+		return size;
+	}
+}
+
+FileDestroyer::FileDestroyer(NFileOperations::OverwriteMethod overwriteMethod, int numWorkers) :
+	m_overwriteMethod(overwriteMethod),
+	m_numWorkers(std::clamp(numWorkers, 1, MAX_WORKERS)),
+	m_stopped(false),
+	m_bytesToWrite(0),
+	m_bytesWritten(0)
+{
+}
+
+std::vector<std::wstring> FileDestroyer::Destroy(const std::vector<std::wstring> &files)
+{
+	std::vector<File> filesToDestroy;
+	std::vector<std::wstring> filesNotDestroyed;
+	ULONGLONG bytesToWrite = 0;
+
+	for (const auto &path : files)
+	{
+		auto sizeOnDisk = GetSizeOnDisk(path);
+
+		if (!sizeOnDisk)
+		{
+			filesNotDestroyed.push_back(path);
+			continue;
+		}
+
+		filesToDestroy.push_back({ path, *sizeOnDisk });
+		bytesToWrite += *sizeOnDisk * GetNumPasses();
+	}
+
+	m_bytesToWrite = bytesToWrite;
+
+	// Each file is only ever touched by a single worker, so the results can be recorded without
+	// any further synchronization.
+	std::vector<char> destroyed(filesToDestroy.size(), false);
+	std::atomic<size_t> nextIndex = 0;
+
+	auto worker = [this, &filesToDestroy, &destroyed, &nextIndex] {
+		// Aligning the buffer to a page boundary means that every block is suitably aligned for
+		// the disk, whatever its sector size.
+		auto *buffer = static_cast<BYTE *>(
+			VirtualAlloc(nullptr, BLOCK_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+
+		if (!buffer)
+		{
+			return;
+		}
+
+		auto freeBuffer = wil::scope_exit([buffer] { VirtualFree(buffer, 0, MEM_RELEASE); });
+
+		HCRYPTPROV cryptProvider = 0;
+
+		if (m_overwriteMethod == NFileOperations::OverwriteMethod::ThreePass
+			&& !CryptAcquireContext(
+				&cryptProvider, nullptr, nullptr, PROV_RSA_AES, CRYPT_VERIFYCONTEXT))
+		{
+			return;
+		}
+
+		auto releaseCryptProvider = wil::scope_exit([cryptProvider] {
+			if (cryptProvider != 0)
+			{
+				CryptReleaseContext(cryptProvider, 0);
+			}
+		});
+
+		while (!m_stopped)
+		{
+			size_t index = nextIndex++;
+
+			if (index >= filesToDestroy.size())
+			{
+				break;
+			}
+
+			destroyed[index] = DestroyFile(filesToDestroy[index], buffer, cryptProvider);
+		}
+	};
+
+	size_t numThreads =
+		std::min<size_t>(m_numWorkers, std::max<size_t>(filesToDestroy.size(), 1));
+
+	std::vector<std::thread> threads;
+
+	for (size_t i = 1; i < numThreads; i++)
+	{
+		threads.emplace_back(worker);
+	}
+
+	worker();
+
+	for (auto &thread : threads)
+	{
+		thread.join();
+	}
+
+	for (size_t i = 0; i < filesToDestroy.size(); i++)
+	{
+		if (!destroyed[i])
+		{
+			filesNotDestroyed.push_back(filesToDestroy[i].path);
+		}
+	}
+
+	return filesNotDestroyed;
+}
+
+bool FileDestroyer::DestroyFile(const File &file, BYTE *buffer, HCRYPTPROV cryptProvider)
+{
+	{
+		// No sharing is allowed, so that the file can't be opened while it's being overwritten.
+		wil::unique_hfile hFile(CreateFile(file.path.c_str(), GENERIC_WRITE, 0, nullptr,
+			OPEN_EXISTING, FILE_FLAG_WRITE_THROUGH, nullptr));
+
+		if (!hFile)
+		{
+			return false;
+		}
+
+		// Extend the file out to the end of its last cluster.
+		LARGE_INTEGER distance;
+		distance.QuadPart = file.sizeOnDisk;
+
+		if (!SetFilePointerEx(hFile.get(), distance, nullptr, FILE_BEGIN)
+			|| !SetEndOfFile(hFile.get()))
+		{
+			return false;
+		}
+
+		if (!OverwriteFile(hFile.get(), file.sizeOnDisk, Fill::Zeros, buffer, cryptProvider))
+		{
+			return false;
+		}
+
+		if (m_overwriteMethod == NFileOperations::OverwriteMethod::ThreePass
+			&& (!OverwriteFile(hFile.get(), file.sizeOnDisk, Fill::Ones, buffer, cryptProvider)
+				|| !OverwriteFile(
+					hFile.get(), file.sizeOnDisk, Fill::Random, buffer, cryptProvider)))
+		{
+			return false;
+		}
+	}
+
+	return DeleteFile(file.path.c_str());
+}
+
+bool FileDestroyer::OverwriteFile(
+	HANDLE hFile, ULONGLONG size, Fill fill, BYTE *buffer, HCRYPTPROV cryptProvider)
+{
+	LARGE_INTEGER distance;
+	distance.QuadPart = 0;
+
+	if (!SetFilePointerEx(hFile, distance, nullptr, FILE_BEGIN))
+	{
+		return false;
+	}
+
+	// A fixed pattern only needs to be set up once for the whole pass.
+	if (fill != Fill::Random)
+	{
+		memset(buffer, (fill == Fill::Zeros) ? 0x00 : 0xFF, BLOCK_SIZE);
+	}
+
+	ULONGLONG remaining = size;
+
+	while (remaining > 0)
+	{
+		if (m_stopped)
+		{
+			return false;
+		}
+
+		auto blockSize = static_cast<DWORD>(std::min<ULONGLONG>(remaining, BLOCK_SIZE));
+
+		if (fill == Fill::Random && !CryptGenRandom(cryptProvider, blockSize, buffer))
+		{
+			return false;
+		}
+
+		DWORD bytesWritten;
+		BOOL res = WriteFile(hFile, buffer, blockSize, &bytesWritten, nullptr);
+
+		if (!res || bytesWritten != blockSize)
+		{
+			return false;
+		}
+
+		remaining -= blockSize;
+		m_bytesWritten.fetch_add(blockSize, std::memory_order_relaxed);
+	}
+
+	// Each pass needs to reach the disk before the next one starts, otherwise it may simply be
+	// replaced in the cache.
+	return FlushFileBuffers(hFile);
+}
+
+int FileDestroyer::GetNumPasses() const
+{
+	return (m_overwriteMethod == NFileOperations::OverwriteMethod::ThreePass) ? 3 : 1;
+}
+
+void FileDestroyer::Stop()
+{
+	m_stopped = true;
+}
+
+bool FileDestroyer::IsStopped() const
+{
+	return m_stopped;
+}
+
+FileDestroyer::Progress FileDestroyer::GetProgress() const
+{
+	Progress progress;
+	progress.bytesToWrite = m_bytesToWrite;
+	progress.bytesWritten = m_bytesWritten;
+	return progress;
+}
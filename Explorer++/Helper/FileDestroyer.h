@@ -0,0 +1,79 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "FileOperations.h"
+#include <atomic>
+#include <string>
+#include <vector>
+
+// Securely deletes files by overwriting their contents before deleting them. Each pass covers
+// the entire space allocated to the file (i.e. the file size rounded up to the end of its last
+// cluster):
+//
+// - A 1-pass overwrite writes zeros.
+// - A 3-pass overwrite writes zeros, then ones (0xFF) and finally random data.
+//
+// Data is written in large blocks, with each pass flushed to disk before the next one starts.
+// Several files are destroyed at once, which helps to keep the disk busy when there are many
+// small files.
+class FileDestroyer
+{
+public:
+	// A snapshot of the progress of a destroy operation, measured in bytes written across all
+	// passes.
+	struct Progress
+	{
+		ULONGLONG bytesToWrite = 0;
+		ULONGLONG bytesWritten = 0;
+	};
+
+	FileDestroyer(NFileOperations::OverwriteMethod overwriteMethod, int numWorkers);
+
+	// Destroys each of the files, blocking until they've all been processed. Returns the files
+	// that weren't destroyed, either because they couldn't be (folders, for example, are always
+	// skipped) or because the destroyer was stopped first. A file that was only partially
+	// overwritten when the destroyer was stopped is left in place.
+	std::vector<std::wstring> Destroy(const std::vector<std::wstring> &files);
+
+	// Can be called from any thread.
+	void Stop();
+	bool IsStopped() const;
+	Progress GetProgress() const;
+
+private:
+	// Writing to a file is largely limited by the disk, so there's little to be gained from
+	// destroying more files than this at once.
+	static constexpr int MAX_WORKERS = 4;
+
+	static constexpr size_t BLOCK_SIZE = 1024 * 1024;
+
+	enum class Fill
+	{
+		Zeros,
+		Ones,
+		Random
+	};
+
+	struct File
+	{
+		std::wstring path;
+
+		// The size of the file rounded up to the end of its last cluster.
+		ULONGLONG sizeOnDisk;
+	};
+
+	bool DestroyFile(const File &file, BYTE *buffer, HCRYPTPROV cryptProvider);
+	bool OverwriteFile(
+		HANDLE hFile, ULONGLONG size, Fill fill, BYTE *buffer, HCRYPTPROV cryptProvider);
+	int GetNumPasses() const;
+
+	const NFileOperations::OverwriteMethod m_overwriteMethod;
+	const int m_numWorkers;
+
+	std::atomic<bool> m_stopped;
+	std::atomic<ULONGLONG> m_bytesToWrite;
+	std::atomic<ULONGLONG> m_bytesWritten;
+};
@@ -0,0 +1,364 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "FileOperationQueue.h"
+#include <algorithm>
+
+class FileOperationQueue::Context : public OperationContext
+{
+public:
+	Context(FileOperationQueue *queue, Entry *entry) : m_queue(queue), m_entry(entry)
+	{
+	}
+
+	void ReportProgress(uint64_t numBytes) override
+	{
+		m_queue->OnProgress(m_entry, numBytes);
+	}
+
+	bool Checkpoint() override
+	{
+		return m_queue->WaitWhilePaused(m_entry);
+	}
+
+private:
+	FileOperationQueue *const m_queue;
+	Entry *const m_entry;
+};
+
+FileOperationQueue::FileOperationQueue(int maxConcurrentOperationsPerVolume) :
+	m_idCounter(0),
+	m_maxConcurrentOperationsPerVolume(std::max(maxConcurrentOperationsPerVolume, 1)),
+	m_paused(false),
+	m_stopping(false),
+	m_totalBytesTransferred(0)
+{
+}
+
+FileOperationQueue::~FileOperationQueue()
+{
+	std::vector<std::unique_ptr<Entry>> discardedOperations;
+	std::vector<std::thread> finishedThreads;
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		m_stopping = true;
+
+		// As in RunOperation(), the discarded operations are only destroyed once the lock has
+		// been released.
+		for (auto &[volume, volumeQueue] : m_volumeQueues)
+		{
+			for (OperationId id : volumeQueue.queuedOperations)
+			{
+				auto itr = m_operations.find(id);
+				discardedOperations.push_back(std::move(itr->second));
+				m_operations.erase(itr);
+			}
+
+			volumeQueue.queuedOperations.clear();
+		}
+
+		// Wakes any operations that are paused, so that they can stop.
+		m_stateChanged.notify_all();
+
+		m_stateChanged.wait(lock, [this] { return m_threads.empty(); });
+
+		finishedThreads = std::move(m_finishedThreads);
+	}
+
+	for (auto &thread : finishedThreads)
+	{
+		thread.join();
+	}
+}
+
+FileOperationQueue::OperationId FileOperationQueue::QueueOperation(
+	const std::wstring &volume, std::unique_ptr<Operation> operation)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	OperationId id = m_idCounter++;
+
+	auto entry = std::make_unique<Entry>();
+	entry->id = id;
+	entry->volume = volume;
+	entry->operation = std::move(operation);
+	m_operations.insert({ id, std::move(entry) });
+
+	m_volumeQueues[volume].queuedOperations.push_back(id);
+
+	StartOperationsLocked();
+
+	return id;
+}
+
+void FileOperationQueue::SetOperationFinishedCallback(OperationFinishedCallback callback)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_operationFinishedCallback = std::move(callback);
+}
+
+void FileOperationQueue::SetMaxConcurrentOperationsPerVolume(int maxConcurrentOperations)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_maxConcurrentOperationsPerVolume = std::max(maxConcurrentOperations, 1);
+	StartOperationsLocked();
+}
+
+int FileOperationQueue::GetMaxConcurrentOperationsPerVolume() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_maxConcurrentOperationsPerVolume;
+}
+
+bool FileOperationQueue::PauseOperation(OperationId id)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto itr = m_operations.find(id);
+
+	if (itr == m_operations.end())
+	{
+		return false;
+	}
+
+	itr->second->paused = true;
+
+	return true;
+}
+
+bool FileOperationQueue::ResumeOperation(OperationId id)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto itr = m_operations.find(id);
+
+	if (itr == m_operations.end())
+	{
+		return false;
+	}
+
+	itr->second->paused = false;
+
+	StartOperationsLocked();
+	m_stateChanged.notify_all();
+
+	return true;
+}
+
+void FileOperationQueue::Pause()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_paused = true;
+}
+
+void FileOperationQueue::Resume()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_paused = false;
+
+	StartOperationsLocked();
+	m_stateChanged.notify_all();
+}
+
+bool FileOperationQueue::IsPaused() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_paused;
+}
+
+bool FileOperationQueue::MoveOperation(OperationId id, size_t position)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto itr = m_operations.find(id);
+
+	if (itr == m_operations.end() || itr->second->state != OperationState::Queued)
+	{
+		return false;
+	}
+
+	auto &queuedOperations = m_volumeQueues.at(itr->second->volume).queuedOperations;
+	queuedOperations.erase(std::find(queuedOperations.begin(), queuedOperations.end(), id));
+	queuedOperations.insert(
+		queuedOperations.begin() + std::min(position, queuedOperations.size()), id);
+
+	return true;
+}
+
+std::vector<FileOperationQueue::OperationInfo> FileOperationQueue::GetOperations() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::vector<OperationInfo> operations;
+
+	for (const auto &[id, entry] : m_operations)
+	{
+		if (entry->state == OperationState::Running)
+		{
+			operations.push_back(
+				{ id, entry->volume, entry->state, entry->paused, entry->bytesTransferred });
+		}
+	}
+
+	std::sort(operations.begin(), operations.end(),
+		[](const OperationInfo &info1, const OperationInfo &info2) {
+			return info1.id < info2.id;
+		});
+
+	for (const auto &[volume, volumeQueue] : m_volumeQueues)
+	{
+		for (OperationId id : volumeQueue.queuedOperations)
+		{
+			const auto &entry = m_operations.at(id);
+			operations.push_back(
+				{ id, entry->volume, entry->state, entry->paused, entry->bytesTransferred });
+		}
+	}
+
+	return operations;
+}
+
+double FileOperationQueue::GetBytesPerSecond()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// Recording the current total means that the rate drops off once transfers stop, rather than
+	// staying at whatever it was when the last progress was reported.
+	m_rateMeter.AddSample(TransferRateMeter::Clock::now(), m_totalBytesTransferred);
+
+	return m_rateMeter.GetBytesPerSecond();
+}
+
+void FileOperationQueue::WaitForIdle()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_stateChanged.wait(lock, [this] { return m_operations.empty(); });
+}
+
+void FileOperationQueue::StartOperationsLocked()
+{
+	if (m_paused || m_stopping)
+	{
+		return;
+	}
+
+	for (auto &[volume, volumeQueue] : m_volumeQueues)
+	{
+		auto &queuedOperations = volumeQueue.queuedOperations;
+		auto itr = queuedOperations.begin();
+
+		while (volumeQueue.numRunning < m_maxConcurrentOperationsPerVolume
+			&& itr != queuedOperations.end())
+		{
+			Entry *entry = m_operations.at(*itr).get();
+
+			if (entry->paused)
+			{
+				++itr;
+				continue;
+			}
+
+			itr = queuedOperations.erase(itr);
+
+			entry->state = OperationState::Running;
+			volumeQueue.numRunning++;
+
+			// The thread can't finish (and so can't remove itself from the map) until the lock is
+			// released.
+			std::thread thread(&FileOperationQueue::RunOperation, this, entry);
+			m_threads.insert({ entry->id, std::move(thread) });
+		}
+	}
+}
+
+void FileOperationQueue::RunOperation(Entry *entry)
+{
+	Context context(this, entry);
+	HRESULT result = entry->operation->Run(context);
+
+	// The operation is destroyed on this thread, outside the lock, since that may involve
+	// releasing resources that take a while to clean up.
+	entry->operation.reset();
+
+	OperationFinishedCallback operationFinishedCallback;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		operationFinishedCallback = m_operationFinishedCallback;
+	}
+
+	// The operation is still listed as running at this point, so anything waiting for the queue
+	// to become idle will see the result reported first.
+	if (operationFinishedCallback)
+	{
+		operationFinishedCallback(entry->id, result);
+	}
+
+	OnOperationFinished(entry);
+}
+
+void FileOperationQueue::OnProgress(Entry *entry, uint64_t numBytes)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	entry->bytesTransferred += numBytes;
+	m_totalBytesTransferred += numBytes;
+
+	m_rateMeter.AddSample(TransferRateMeter::Clock::now(), m_totalBytesTransferred);
+}
+
+bool FileOperationQueue::WaitWhilePaused(Entry *entry)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	m_stateChanged.wait(
+		lock, [this, entry] { return m_stopping || (!m_paused && !entry->paused); });
+
+	return !m_stopping;
+}
+
+void FileOperationQueue::OnOperationFinished(Entry *entry)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// Threads in this list have already left this method, so joining them here won't block for
+	// any significant length of time. This thread can't join itself, so it's added afterwards.
+	JoinFinishedThreadsLocked();
+
+	auto threadItr = m_threads.find(entry->id);
+	m_finishedThreads.push_back(std::move(threadItr->second));
+	m_threads.erase(threadItr);
+
+	auto volumeItr = m_volumeQueues.find(entry->volume);
+	volumeItr->second.numRunning--;
+
+	if (volumeItr->second.numRunning == 0 && volumeItr->second.queuedOperations.empty())
+	{
+		m_volumeQueues.erase(volumeItr);
+	}
+
+	m_operations.erase(entry->id);
+
+	StartOperationsLocked();
+	m_stateChanged.notify_all();
+}
+
+void FileOperationQueue::JoinFinishedThreadsLocked()
+{
+	// During shutdown, the destructor takes care of joining the threads.
+	if (m_stopping)
+	{
+		return;
+	}
+
+	for (auto &thread : m_finishedThreads)
+	{
+		thread.join();
+	}
+
+	m_finishedThreads.clear();
+}
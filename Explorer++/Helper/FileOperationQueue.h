@@ -0,0 +1,173 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "TransferRateMeter.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Runs file operations (copies, moves and so on) in the background. Operations are queued by the
+// volume they write to and, within each volume, run in order, with only a limited number running
+// at once. That stops several large operations to the same disk from competing with (and slowing
+// down) each other, while operations to different disks can still proceed in parallel.
+//
+// The queue itself knows nothing about how an operation is performed; each operation is supplied
+// as an implementation of the Operation interface below.
+class FileOperationQueue
+{
+public:
+	using OperationId = int;
+
+	// Passed to an operation while it's running. This is how the operation reports its progress
+	// and how pausing is put into effect.
+	class OperationContext
+	{
+	public:
+		virtual ~OperationContext() = default;
+
+		// Adds to the number of bytes the operation has transferred.
+		virtual void ReportProgress(uint64_t numBytes) = 0;
+
+		// Operations should call this regularly (e.g. between blocks or items). Blocks while the
+		// operation is paused. Returns false if the queue is shutting down, in which case the
+		// operation should stop as soon as it can.
+		virtual bool Checkpoint() = 0;
+	};
+
+	class Operation
+	{
+	public:
+		virtual ~Operation() = default;
+
+		// Performs the operation, blocking until it's finished. Called on a background thread.
+		// The result is passed on to the callback set with SetOperationFinishedCallback(). An
+		// operation that stops because the queue is shutting down should return
+		// HRESULT_FROM_WIN32(ERROR_CANCELLED).
+		virtual HRESULT Run(OperationContext &context) = 0;
+	};
+
+	enum class OperationState
+	{
+		Queued,
+		Running
+	};
+
+	struct OperationInfo
+	{
+		OperationId id;
+		std::wstring volume;
+		OperationState state;
+		bool paused;
+		uint64_t bytesTransferred;
+	};
+
+	// Called on the operation's thread once the operation has finished running. Operations that
+	// are discarded without being run aren't reported.
+	using OperationFinishedCallback = std::function<void(OperationId id, HRESULT result)>;
+
+	static constexpr int DEFAULT_MAX_CONCURRENT_OPERATIONS_PER_VOLUME = 1;
+
+	explicit FileOperationQueue(
+		int maxConcurrentOperationsPerVolume = DEFAULT_MAX_CONCURRENT_OPERATIONS_PER_VOLUME);
+
+	// Operations that haven't started by this point are discarded without being run. Operations
+	// that are running are asked to stop (see OperationContext::Checkpoint()) and waited for.
+	~FileOperationQueue();
+
+	// Adds the operation to the back of the queue for the volume. The volume can be any string
+	// that identifies the destination disk; operations with the same volume share a queue.
+	OperationId QueueOperation(const std::wstring &volume, std::unique_ptr<Operation> operation);
+
+	void SetOperationFinishedCallback(OperationFinishedCallback callback);
+
+	// Changing the limit affects which operations are started from then on. Operations that are
+	// already running aren't stopped if the limit is lowered.
+	void SetMaxConcurrentOperationsPerVolume(int maxConcurrentOperations);
+	int GetMaxConcurrentOperationsPerVolume() const;
+
+	// A paused operation that's queued won't be started (later operations in the same queue may
+	// start ahead of it), while one that's running will block the next time it reaches a
+	// checkpoint. A running operation keeps its slot while paused. Returns false if there's no
+	// such operation (e.g. because it's already finished).
+	bool PauseOperation(OperationId id);
+	bool ResumeOperation(OperationId id);
+
+	// Pauses or resumes the queue as a whole. While the queue is paused, no operations are
+	// started and all running operations block at their next checkpoint.
+	void Pause();
+	void Resume();
+	bool IsPaused() const;
+
+	// Moves a queued operation to the specified position within the operations that are queued
+	// for the same volume, with 0 being the front. Positions past the end move the operation to
+	// the back. Returns false if the operation isn't queued.
+	bool MoveOperation(OperationId id, size_t position);
+
+	// Returns the operations that are running or queued. Running operations are listed first,
+	// with queued operations following in the order they'll be started (for each volume).
+	std::vector<OperationInfo> GetOperations() const;
+
+	// The combined transfer rate of all running operations, averaged over the last few seconds.
+	double GetBytesPerSecond();
+
+	// Blocks until there are no running or queued operations.
+	void WaitForIdle();
+
+private:
+	class Context;
+
+	struct Entry
+	{
+		OperationId id;
+		std::wstring volume;
+		std::unique_ptr<Operation> operation;
+		OperationState state = OperationState::Queued;
+		bool paused = false;
+		uint64_t bytesTransferred = 0;
+	};
+
+	struct VolumeQueue
+	{
+		std::deque<OperationId> queuedOperations;
+		int numRunning = 0;
+	};
+
+	void StartOperationsLocked();
+	void RunOperation(Entry *entry);
+	void OnProgress(Entry *entry, uint64_t numBytes);
+	bool WaitWhilePaused(Entry *entry);
+	void OnOperationFinished(Entry *entry);
+	void JoinFinishedThreadsLocked();
+
+	mutable std::mutex m_mutex;
+
+	// Signalled whenever an operation or the queue as a whole is resumed, whenever an operation
+	// finishes and on shutdown.
+	std::condition_variable m_stateChanged;
+
+	std::unordered_map<OperationId, std::unique_ptr<Entry>> m_operations;
+	std::unordered_map<std::wstring, VolumeQueue> m_volumeQueues;
+	OperationId m_idCounter;
+	int m_maxConcurrentOperationsPerVolume;
+	bool m_paused;
+	bool m_stopping;
+	OperationFinishedCallback m_operationFinishedCallback;
+
+	// Each running operation has its own thread. Once an operation has finished, its thread is
+	// joined the next time another thread finishes (or on shutdown).
+	std::unordered_map<OperationId, std::thread> m_threads;
+	std::vector<std::thread> m_finishedThreads;
+
+	uint64_t m_totalBytesTransferred;
+	TransferRateMeter m_rateMeter;
+};
@@ -5,14 +5,18 @@
 #include "stdafx.h"
 #include "FileOperations.h"
 #include "DriveInfo.h"
+#include "FileDestroyer.h"
+#include "FileOperationQueue.h"
 #include "Helper.h"
 #include "Macros.h"
+#include "NativeCopyOperation.h"
+#include "ShellFileOperation.h"
 #include "ShellHelper.h"
 #include "StringHelper.h"
 #include "iDataObject.h"
 #include <wil/com.h>
+#include <algorithm>
 #include <list>
-#include <sstream>
 
 enum class PasteType
 {
@@ -21,7 +25,138 @@ enum class PasteType
 };
 
 int PasteFilesFromClipboardSpecial(const TCHAR *szDestination, PasteType pasteType);
-BOOL GetFileClusterSize(const std::wstring &strFilename, PLARGE_INTEGER lpRealFileSize);
+
+namespace
+{
+	// Records the result of a single rename.
+	class RenameResultSink : public IFileOperationProgressSink
+	{
+	public:
+		explicit RenameResultSink(HRESULT *result) : m_refCount(1), m_result(result)
+		{
+		}
+
+		HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppvObject) override
+		{
+#pragma warning(push)
+#pragma warning(disable : 4838) // conversion from 'DWORD' to 'int' requires a narrowing conversion
+			static const QITAB qit[] = { QITABENT(RenameResultSink, IFileOperationProgressSink),
+				{ nullptr } };
+#pragma warning(pop)
+
+			return QISearch(this, qit, riid, ppvObject);
+		}
+
+		ULONG STDMETHODCALLTYPE AddRef() override
+		{
+			return InterlockedIncrement(&m_refCount);
+		}
+
+		ULONG STDMETHODCALLTYPE Release() override
+		{
+			ULONG refCount = InterlockedDecrement(&m_refCount);
+
+			if (refCount == 0)
+			{
+				delete this;
+			}
+
+			return refCount;
+		}
+
+		HRESULT STDMETHODCALLTYPE StartOperations() override
+		{
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE FinishOperations(HRESULT) override
+		{
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE PreRenameItem(DWORD, IShellItem *, LPCWSTR) override
+		{
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE PostRenameItem(
+			DWORD, IShellItem *, LPCWSTR, HRESULT hrRename, IShellItem *) override
+		{
+			*m_result = hrRename;
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE PreMoveItem(DWORD, IShellItem *, IShellItem *, LPCWSTR) override
+		{
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE PostMoveItem(
+			DWORD, IShellItem *, IShellItem *, LPCWSTR, HRESULT, IShellItem *) override
+		{
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE PreCopyItem(DWORD, IShellItem *, IShellItem *, LPCWSTR) override
+		{
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE PostCopyItem(
+			DWORD, IShellItem *, IShellItem *, LPCWSTR, HRESULT, IShellItem *) override
+		{
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE PreDeleteItem(DWORD, IShellItem *) override
+		{
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE PostDeleteItem(
+			DWORD, IShellItem *, HRESULT, IShellItem *) override
+		{
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE PreNewItem(DWORD, IShellItem *, LPCWSTR) override
+		{
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE PostNewItem(
+			DWORD, IShellItem *, LPCWSTR, LPCWSTR, DWORD, HRESULT, IShellItem *) override
+		{
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE UpdateProgress(UINT, UINT) override
+		{
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE ResetTimer() override
+		{
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE PauseTimer() override
+		{
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE ResumeTimer() override
+		{
+			return S_OK;
+		}
+
+	private:
+		~RenameResultSink() = default;
+
+		ULONG m_refCount;
+		HRESULT *const m_result;
+	};
+}
 
 HRESULT NFileOperations::RenameFile(IShellItem *item, const std::wstring &newName)
 {
@@ -52,6 +187,76 @@ HRESULT NFileOperations::RenameFile(IShellItem *item, const std::wstring &newNam
 	return hr;
 }
 
+std::vector<HRESULT> NFileOperations::RenameFiles(
+	HWND hwnd, const std::vector<RenamePlan::Step> &steps)
+{
+	// Any rename that's never attempted (e.g. because the operation was cancelled part way
+	// through) is treated as having been aborted.
+	std::vector<HRESULT> results(steps.size(), E_ABORT);
+
+	wil::com_ptr_nothrow<IFileOperation> fo;
+	HRESULT hr = CoCreateInstance(CLSID_FileOperation, nullptr, CLSCTX_ALL, IID_PPV_ARGS(&fo));
+
+	if (FAILED(hr))
+	{
+		std::fill(results.begin(), results.end(), hr);
+		return results;
+	}
+
+	// Unlike RenameFile(), progress is shown, since renaming a large number of items can take
+	// some time. The progress dialog is only displayed once the operation has been running for a
+	// few seconds.
+	hr = fo->SetOwnerWindow(hwnd);
+
+	if (SUCCEEDED(hr))
+	{
+		hr = fo->SetOperationFlags(FOF_ALLOWUNDO);
+	}
+
+	if (FAILED(hr))
+	{
+		std::fill(results.begin(), results.end(), hr);
+		return results;
+	}
+
+	bool anyQueued = false;
+
+	for (size_t i = 0; i < steps.size(); i++)
+	{
+		wil::com_ptr_nothrow<IShellItem> shellItem;
+		hr = SHCreateItemFromParsingName(
+			steps[i].oldPath.c_str(), nullptr, IID_PPV_ARGS(&shellItem));
+
+		if (FAILED(hr))
+		{
+			results[i] = hr;
+			continue;
+		}
+
+		// Each rename has its own sink, so that its result can be recorded.
+		wil::com_ptr_nothrow<IFileOperationProgressSink> resultSink;
+		resultSink.attach(new RenameResultSink(&results[i]));
+
+		hr = fo->RenameItem(
+			shellItem.get(), PathFindFileName(steps[i].newPath.c_str()), resultSink.get());
+
+		if (FAILED(hr))
+		{
+			results[i] = hr;
+			continue;
+		}
+
+		anyQueued = true;
+	}
+
+	if (anyQueued)
+	{
+		fo->PerformOperations();
+	}
+
+	return results;
+}
+
 HRESULT NFileOperations::DeleteFiles(
 	HWND hwnd, std::vector<PCIDLIST_ABSOLUTE> &pidls, bool permanent, bool silent)
 {
@@ -125,8 +330,9 @@ HRESULT NFileOperations::DeleteFiles(
 	return hr;
 }
 
-HRESULT NFileOperations::CopyFilesToFolder(
-	HWND hOwner, const std::wstring &strTitle, std::vector<PCIDLIST_ABSOLUTE> &pidls, bool move)
+HRESULT NFileOperations::CopyFilesToFolder(HWND hOwner, const std::wstring &strTitle,
+	std::vector<PCIDLIST_ABSOLUTE> &pidls, bool move, FileOperationQueue *fileOperationQueue,
+	bool useNativeCopyEngine)
 {
 	unique_pidl_absolute pidl;
 	BOOL bRes = NFileOperations::CreateBrowseDialog(hOwner, strTitle, wil::out_param(pidl));
@@ -136,17 +342,30 @@ HRESULT NFileOperations::CopyFilesToFolder(
 		return E_FAIL;
 	}
 
-	wil::com_ptr_nothrow<IShellItem> destinationFolder;
-	HRESULT hr = SHCreateItemFromIDList(pidl.get(), IID_PPV_ARGS(&destinationFolder));
+	std::wstring destinationPath;
+	HRESULT hr = GetDisplayName(pidl.get(), SHGDN_FORPARSING, destinationPath);
 
 	if (FAILED(hr))
 	{
-		return E_FAIL;
+		return hr;
 	}
 
-	hr = CopyFiles(hOwner, destinationFolder.get(), pidls, move);
+	std::unique_ptr<FileOperationQueue::Operation> operation;
 
-	return hr;
+	if (useNativeCopyEngine && !move)
+	{
+		operation = std::make_unique<NativeCopyOperation>(hOwner, pidls, pidl.get(), true);
+	}
+	else
+	{
+		operation = std::make_unique<ShellFileOperation>(hOwner,
+			move ? ShellFileOperation::Type::Move : ShellFileOperation::Type::Copy, pidls,
+			pidl.get());
+	}
+
+	fileOperationQueue->QueueOperation(GetVolumeForPath(destinationPath), std::move(operation));
+
+	return S_OK;
 }
 
 HRESULT NFileOperations::CopyFiles(
@@ -266,137 +485,6 @@ HRESULT NFileOperations::CreateNewFolder(IShellItem *destinationFolder,
 	return hr;
 }
 
-BOOL NFileOperations::SaveDirectoryListing(
-	const std::wstring &strDirectory, const std::wstring &strFilename)
-{
-	std::wstring strContents = _T("Directory\r\n---------\r\n") + strDirectory + _T("\r\n\r\n");
-
-	SYSTEMTIME st;
-	FILETIME ft;
-	FILETIME lft;
-	GetLocalTime(&st);
-	SystemTimeToFileTime(&st, &ft);
-	LocalFileTimeToFileTime(&ft, &lft);
-
-	TCHAR szTime[128];
-	CreateFileTimeString(&lft, szTime, SIZEOF_ARRAY(szTime), FALSE);
-	strContents += _T("Date\r\n----\r\n") + std::wstring(szTime) + _T("\r\n\r\n");
-
-	std::wstring strSearch = strDirectory + _T("\\*");
-
-	WIN32_FIND_DATA wfd;
-	HANDLE hFirstFile = FindFirstFile(strSearch.c_str(), &wfd);
-
-	std::list<std::wstring> folderList;
-	std::list<std::wstring> fileList;
-	ULARGE_INTEGER ulTotalSize;
-
-	ulTotalSize.QuadPart = 0;
-
-	if (hFirstFile != INVALID_HANDLE_VALUE)
-	{
-		ULARGE_INTEGER ulFileSize;
-
-		if (lstrcmpi(wfd.cFileName, _T(".")) != 0 && lstrcmpi(wfd.cFileName, _T("..")) != 0)
-		{
-			if ((wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == FILE_ATTRIBUTE_DIRECTORY)
-			{
-				folderList.emplace_back(wfd.cFileName);
-			}
-			else
-			{
-				fileList.emplace_back(wfd.cFileName);
-
-				ulFileSize.LowPart = wfd.nFileSizeLow;
-				ulFileSize.HighPart = wfd.nFileSizeHigh;
-
-				ulTotalSize.QuadPart += ulFileSize.QuadPart;
-			}
-		}
-
-		while (FindNextFile(hFirstFile, &wfd) != 0)
-		{
-			if (lstrcmpi(wfd.cFileName, _T(".")) != 0 && lstrcmpi(wfd.cFileName, _T("..")) != 0)
-			{
-				if ((wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == FILE_ATTRIBUTE_DIRECTORY)
-				{
-					folderList.emplace_back(wfd.cFileName);
-				}
-				else
-				{
-					fileList.emplace_back(wfd.cFileName);
-
-					ulFileSize.LowPart = wfd.nFileSizeLow;
-					ulFileSize.HighPart = wfd.nFileSizeHigh;
-
-					ulTotalSize.QuadPart += ulFileSize.QuadPart;
-				}
-			}
-		}
-
-		FindClose(hFirstFile);
-	}
-
-	std::wstringstream ss;
-	ss.imbue(std::locale(""));
-	ss.precision(0);
-
-	strContents += _T("Statistics\r\n----------\r\n");
-
-	ss << std::fixed << folderList.size();
-	strContents += _T("Number of folders: ") + ss.str() + std::wstring(_T("\r\n"));
-
-	ss.str(_T(""));
-	ss << std::fixed << fileList.size();
-	strContents += _T("Number of files: ") + ss.str() + std::wstring(_T("\r\n"));
-
-	TCHAR szTotalSize[32];
-	FormatSizeString(ulTotalSize, szTotalSize, SIZEOF_ARRAY(szTotalSize));
-	strContents += _T("Total size (not including subfolders): ") + std::wstring(szTotalSize)
-		+ std::wstring(_T("\r\n"));
-
-	strContents += _T("\r\nFolders\r\n-------\r\n");
-
-	for (const auto &folder : folderList)
-	{
-		strContents += folder + _T("\r\n");
-	}
-
-	strContents += _T("\r\nFiles\r\n-----\r\n");
-
-	for (const auto &file : fileList)
-	{
-		strContents += file + _T("\r\n");
-	}
-
-	/* Remove the trailing newline. */
-	strContents = strContents.substr(0, strContents.size() - 2);
-
-	HANDLE hFile = CreateFile(strFilename.c_str(), FILE_WRITE_DATA, 0, nullptr, CREATE_ALWAYS,
-		FILE_ATTRIBUTE_NORMAL, nullptr);
-
-	if (hFile != INVALID_HANDLE_VALUE)
-	{
-		DWORD nBytesWritten;
-
-		/* Write out the BOM for UTF-16 LE data.
-		See http://en.wikipedia.org/wiki/Byte-order_mark */
-		WriteFile(hFile, reinterpret_cast<LPCVOID>("\xFF\xFE"), 2, &nBytesWritten, nullptr);
-
-		WriteFile(hFile, reinterpret_cast<LPCVOID>(strContents.c_str()),
-			static_cast<DWORD>(strContents.size() * sizeof(WCHAR)), &nBytesWritten, nullptr);
-
-		if (nBytesWritten == strContents.size())
-		{
-			return TRUE;
-		}
-
-		CloseHandle(hFile);
-	}
-
-	return FALSE;
-}
-
 HRESULT CopyFiles(const std::vector<std::wstring> &FileNameList, IDataObject **pClipboardDataObject)
 {
 	return CopyFilesToClipboard(FileNameList, FALSE, pClipboardDataObject);
@@ -632,141 +720,9 @@ BOOL NFileOperations::CreateBrowseDialog(
 	return bSuccessful;
 }
 
-BOOL GetFileClusterSize(const std::wstring &strFilename, PLARGE_INTEGER lpRealFileSize)
-{
-	DWORD dwClusterSize;
-
-	LARGE_INTEGER lFileSize;
-	BOOL bRet = GetFileSizeEx(strFilename.c_str(), &lFileSize);
-
-	if (!bRet)
-	{
-		return FALSE;
-	}
-
-	TCHAR szRoot[MAX_PATH];
-	HRESULT hr = StringCchCopy(szRoot, SIZEOF_ARRAY(szRoot), strFilename.c_str());
-
-	if (FAILED(hr))
-	{
-		return FALSE;
-	}
-
-	bRet = PathStripToRoot(szRoot);
-
-	if (!bRet)
-	{
-		return FALSE;
-	}
-
-	bRet = GetClusterSize(szRoot, &dwClusterSize);
-
-	if (!bRet)
-	{
-		return FALSE;
-	}
-
-	if ((lFileSize.QuadPart % dwClusterSize) != 0)
-	{
-		/* The real size is the logical file size rounded up to the end of the
-		nearest cluster. */
-		lFileSize.QuadPart += dwClusterSize - (lFileSize.QuadPart % dwClusterSize);
-	}
-
-	*lpRealFileSize = lFileSize;
-
-	return TRUE;
-}
-
 void NFileOperations::DeleteFileSecurely(
 	const std::wstring &strFilename, OverwriteMethod overwriteMethod)
 {
-	HANDLE hFile;
-	WIN32_FIND_DATA wfd;
-	HANDLE hFindFile;
-	HCRYPTPROV hProv;
-	LARGE_INTEGER lRealFileSize;
-	BYTE pass1Data;
-	BYTE pass2Data;
-	BYTE pass3Data;
-	DWORD nBytesWritten;
-	BOOL bFolder;
-	int i = 0;
-
-	hFindFile = FindFirstFile(strFilename.c_str(), &wfd);
-
-	if (hFindFile == INVALID_HANDLE_VALUE)
-	{
-		return;
-	}
-
-	bFolder = (wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == FILE_ATTRIBUTE_DIRECTORY;
-
-	FindClose(hFindFile);
-
-	if (bFolder)
-	{
-		return;
-	}
-
-	/* Determine the actual size of the file on disk
-	(i.e. how many clusters it is allocated). */
-	GetFileClusterSize(strFilename, &lRealFileSize);
-
-	/* Open the file, block any sharing mode, to stop the file
-	been opened while it is overwritten. */
-	hFile =
-		CreateFile(strFilename.c_str(), FILE_WRITE_DATA, 0, nullptr, OPEN_EXISTING, NULL, nullptr);
-
-	if (hFile == INVALID_HANDLE_VALUE)
-	{
-		return;
-	}
-
-	/* Extend the file out to the end of its last sector. */
-	SetFilePointerEx(hFile, lRealFileSize, nullptr, FILE_BEGIN);
-	SetEndOfFile(hFile);
-
-	/* Start at the beginning of the file, and
-	write in the first-pass data, 0x00 over
-	the length of the whole file. */
-	SetFilePointer(hFile, 0, nullptr, FILE_BEGIN);
-	pass1Data = 0x00;
-
-	for (i = 0; i < lRealFileSize.QuadPart; i++)
-	{
-		WriteFile(hFile, (LPVOID) &pass1Data, 1, &nBytesWritten, nullptr);
-	}
-
-	if (overwriteMethod == OverwriteMethod::ThreePass)
-	{
-		/* Start at the beginning of the file, and
-		write in the second-pass data, 0xFF over
-		the length of the whole file. */
-		SetFilePointer(hFile, 0, nullptr, FILE_BEGIN);
-		pass2Data = 0xFF;
-
-		for (i = 0; i < lRealFileSize.QuadPart; i++)
-		{
-			WriteFile(hFile, (LPVOID) &pass2Data, 1, &nBytesWritten, nullptr);
-		}
-
-		SetFilePointer(hFile, 0, nullptr, FILE_BEGIN);
-
-		CryptAcquireContext(&hProv, _T("SecureDelete"), nullptr, PROV_RSA_AES, CRYPT_NEWKEYSET);
-
-		for (i = 0; i < lRealFileSize.QuadPart; i++)
-		{
-			CryptGenRandom(hProv, 1, (LPBYTE) &pass3Data);
-			WriteFile(hFile, (LPVOID) &pass3Data, 1, &nBytesWritten, nullptr);
-		}
-
-		CryptAcquireContext(&hProv, _T("SecureDelete"), nullptr, PROV_RSA_AES, CRYPT_DELETEKEYSET);
-	}
-
-	FlushFileBuffers(hFile);
-
-	CloseHandle(hFile);
-
-	DeleteFile(strFilename.c_str());
+	FileDestroyer fileDestroyer(overwriteMethod, 1);
+	fileDestroyer.Destroy({ strFilename });
 }
\ No newline at end of file
@@ -4,9 +4,12 @@
 
 #pragma once
 
+#include "RenamePlan.h"
 #include <list>
 #include <vector>
 
+class FileOperationQueue;
+
 namespace NFileOperations
 {
 	enum class OverwriteMethod
@@ -16,11 +19,20 @@ namespace NFileOperations
 	};
 
 	HRESULT RenameFile(IShellItem *item, const std::wstring &newName);
+
+	// Performs each of the renames, in the order given, within a single operation. Returns the
+	// result of each rename.
+	std::vector<HRESULT> RenameFiles(HWND hwnd, const std::vector<RenamePlan::Step> &steps);
 	HRESULT DeleteFiles(
 		HWND hwnd, std::vector<PCIDLIST_ABSOLUTE> &pidls, bool permanent, bool silent);
 	void DeleteFileSecurely(const std::wstring &strFilename, OverwriteMethod overwriteMethod);
+
+	// Prompts for the destination folder, then queues the operation. Returns once the operation
+	// has been queued. If useNativeCopyEngine is set, copies are performed (and verified) by
+	// NativeCopyOperation, rather than the shell.
 	HRESULT CopyFilesToFolder(HWND hOwner, const std::wstring &strTitle,
-		std::vector<PCIDLIST_ABSOLUTE> &pidls, bool move);
+		std::vector<PCIDLIST_ABSOLUTE> &pidls, bool move, FileOperationQueue *fileOperationQueue,
+		bool useNativeCopyEngine);
 	HRESULT CopyFiles(
 		HWND hwnd, IShellItem *destinationFolder, std::vector<PCIDLIST_ABSOLUTE> &pidls, bool move);
 
@@ -29,8 +41,6 @@ namespace NFileOperations
 
 	TCHAR *BuildFilenameList(const std::list<std::wstring> &FilenameList);
 
-	BOOL SaveDirectoryListing(const std::wstring &strDirectory, const std::wstring &strFilename);
-
 	HRESULT CreateLinkToFile(const std::wstring &strTargetFilename,
 		const std::wstring &strLinkFilename, const std::wstring &strLinkDescription);
 	HRESULT ResolveLink(HWND hwnd, DWORD fFlags, const TCHAR *szLinkFilename, TCHAR *szResolvedPath,
@@ -0,0 +1,643 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "FilenameIndex.h"
+#include <wil/common.h>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <optional>
+
+namespace
+{
+	const size_t TRIGRAM_LENGTH = 3;
+
+	std::wstring FoldCase(std::wstring_view str)
+	{
+		if (str.empty())
+		{
+			return std::wstring();
+		}
+
+		std::wstring output(str.size(), '\0');
+		int length = LCMapString(LOCALE_USER_DEFAULT, LCMAP_LOWERCASE, str.data(),
+			static_cast<int>(str.size()), output.data(), static_cast<int>(output.size()));
+		output.resize(length);
+
+		return output;
+	}
+
+	// Directories are keyed by their folded path, without any trailing backslash, so that the
+	// root of a drive ("C:\") and the parent of one of its items ("C:") are treated the same.
+	std::wstring GetDirectoryKey(std::wstring_view directory)
+	{
+		if (!directory.empty() && directory.back() == '\\')
+		{
+			directory.remove_suffix(1);
+		}
+
+		return FoldCase(directory);
+	}
+
+	// The directory shouldn't have a trailing backslash.
+	bool IsWithinDirectory(std::wstring_view path, std::wstring_view directory)
+	{
+		if (path.size() < directory.size()
+			|| CompareStringOrdinal(path.data(), static_cast<int>(directory.size()),
+				   directory.data(), static_cast<int>(directory.size()), TRUE)
+				!= CSTR_EQUAL)
+		{
+			return false;
+		}
+
+		return path.size() == directory.size() || path[directory.size()] == '\\';
+	}
+
+	uint64_t GetTrigram(std::wstring_view str, size_t pos)
+	{
+		return (static_cast<uint64_t>(static_cast<uint16_t>(str[pos])) << 32)
+			| (static_cast<uint64_t>(static_cast<uint16_t>(str[pos + 1])) << 16)
+			| static_cast<uint64_t>(static_cast<uint16_t>(str[pos + 2]));
+	}
+
+	template <typename T>
+	void WriteValue(std::ofstream &stream, const T &value)
+	{
+		stream.write(reinterpret_cast<const char *>(&value), sizeof(value));
+	}
+
+	void WriteString(std::ofstream &stream, std::wstring_view str)
+	{
+		WriteValue(stream, static_cast<uint32_t>(str.size()));
+		stream.write(
+			reinterpret_cast<const char *>(str.data()), str.size() * sizeof(wchar_t));
+	}
+
+	template <typename T>
+	bool ReadValue(std::ifstream &stream, T &value)
+	{
+		stream.read(reinterpret_cast<char *>(&value), sizeof(value));
+		return stream.good();
+	}
+
+	bool ReadString(std::ifstream &stream, std::wstring &str)
+	{
+		uint32_t length;
+
+		if (!ReadValue(stream, length) || length > 32767)
+		{
+			return false;
+		}
+
+		str.resize(length);
+		stream.read(reinterpret_cast<char *>(str.data()), length * sizeof(wchar_t));
+		return stream.good();
+	}
+}
+
+FilenameIndex::FilenameIndex(const std::wstring &rootDirectory) :
+	m_rootDirectory(rootDirectory),
+	m_numLiveEntries(0)
+{
+}
+
+FilenameIndex::Entry FilenameIndex::EntryFromFindData(const WIN32_FIND_DATA &findData)
+{
+	Entry entry;
+	entry.name = findData.cFileName;
+	entry.attributes = findData.dwFileAttributes;
+	entry.size = (static_cast<ULONGLONG>(findData.nFileSizeHigh) << 32) | findData.nFileSizeLow;
+	entry.lastWriteTime = findData.ftLastWriteTime;
+	return entry;
+}
+
+const std::wstring &FilenameIndex::GetRootDirectory() const
+{
+	return m_rootDirectory;
+}
+
+size_t FilenameIndex::GetNumEntries() const
+{
+	std::shared_lock<std::shared_mutex> lock(m_mutex);
+	return m_numLiveEntries;
+}
+
+FilenameIndex::BuildInfo FilenameIndex::GetBuildInfo() const
+{
+	std::shared_lock<std::shared_mutex> lock(m_mutex);
+	return m_buildInfo;
+}
+
+void FilenameIndex::SetBuildInfo(const BuildInfo &buildInfo)
+{
+	std::unique_lock<std::shared_mutex> lock(m_mutex);
+	m_buildInfo = buildInfo;
+}
+
+void FilenameIndex::AddEntries(const std::wstring &directory, const std::vector<Entry> &entries)
+{
+	std::unique_lock<std::shared_mutex> lock(m_mutex);
+
+	uint32_t directoryId = GetOrCreateDirectoryLocked(directory);
+
+	// Checking for an existing entry means scanning the directory, so that's skipped when the
+	// directory is new (as it is when the index is first built).
+	bool replaceExisting = !m_directories[directoryId].entryIds.empty();
+
+	for (const auto &entry : entries)
+	{
+		AddEntryLocked(directoryId, entry, replaceExisting);
+	}
+}
+
+void FilenameIndex::AddEntry(const std::wstring &directory, const Entry &entry)
+{
+	std::unique_lock<std::shared_mutex> lock(m_mutex);
+	AddEntryLocked(GetOrCreateDirectoryLocked(directory), entry, true);
+}
+
+uint32_t FilenameIndex::GetOrCreateDirectoryLocked(const std::wstring &directory)
+{
+	auto key = GetDirectoryKey(directory);
+	auto itr = m_directoryIds.find(key);
+
+	if (itr != m_directoryIds.end())
+	{
+		return itr->second;
+	}
+
+	auto directoryId = static_cast<uint32_t>(m_directories.size());
+	m_directories.push_back({ directory, {}, false });
+	m_directoryIds.emplace(std::move(key), directoryId);
+
+	return directoryId;
+}
+
+void FilenameIndex::AddEntryLocked(uint32_t directoryId, const Entry &entry, bool replaceExisting)
+{
+	auto &directory = m_directories[directoryId];
+
+	if (replaceExisting)
+	{
+		for (auto entryId : directory.entryIds)
+		{
+			auto &existingEntry = m_entries[entryId];
+
+			if (!existingEntry.removed
+				&& lstrcmpi(existingEntry.entry.name.c_str(), entry.name.c_str()) == 0)
+			{
+				existingEntry.entry = entry;
+				return;
+			}
+		}
+	}
+
+	auto entryId = static_cast<uint32_t>(m_entries.size());
+	m_entries.push_back({ entry, directoryId, false });
+	directory.entryIds.push_back(entryId);
+	m_numLiveEntries++;
+
+	IndexTrigramsLocked(entryId, FoldCase(entry.name));
+}
+
+void FilenameIndex::IndexTrigramsLocked(uint32_t entryId, std::wstring_view name)
+{
+	for (size_t i = 0; i + TRIGRAM_LENGTH <= name.size(); i++)
+	{
+		auto &entryIds = m_trigrams[GetTrigram(name, i)];
+
+		// Entry IDs are only ever added in ascending order, so a trigram that appears more than
+		// once in the same name will always be found at the back.
+		if (entryIds.empty() || entryIds.back() != entryId)
+		{
+			entryIds.push_back(entryId);
+		}
+	}
+}
+
+void FilenameIndex::RemoveEntry(const std::wstring &path)
+{
+	size_t separator = path.find_last_of('\\');
+
+	if (separator == std::wstring::npos)
+	{
+		return;
+	}
+
+	std::unique_lock<std::shared_mutex> lock(m_mutex);
+
+	// The item may not have an entry of its own (e.g. if it's the root directory), in which case
+	// it's treated as a folder.
+	bool isFolder = true;
+
+	auto itr = m_directoryIds.find(GetDirectoryKey(std::wstring_view(path).substr(0, separator)));
+
+	if (itr != m_directoryIds.end())
+	{
+		auto name = path.substr(separator + 1);
+
+		for (auto entryId : m_directories[itr->second].entryIds)
+		{
+			auto &entry = m_entries[entryId];
+
+			if (!entry.removed && lstrcmpi(entry.entry.name.c_str(), name.c_str()) == 0)
+			{
+				entry.removed = true;
+				m_numLiveEntries--;
+				isFolder = WI_IsFlagSet(entry.entry.attributes, FILE_ATTRIBUTE_DIRECTORY);
+				break;
+			}
+		}
+	}
+
+	// If the item was a folder, anything beneath it is now gone as well. That's the folder's own
+	// directory, along with the range of directories whose keys start with its key, followed by a
+	// backslash.
+	if (isFolder)
+	{
+		auto key = GetDirectoryKey(path);
+		auto prefix = key + L'\\';
+		std::vector<uint32_t> directoriesToRemove;
+
+		if (auto directoryItr = m_directoryIds.find(key); directoryItr != m_directoryIds.end())
+		{
+			directoriesToRemove.push_back(directoryItr->second);
+		}
+
+		for (auto directoryItr = m_directoryIds.lower_bound(prefix);
+			 directoryItr != m_directoryIds.end()
+			 && directoryItr->first.compare(0, prefix.size(), prefix) == 0;
+			 ++directoryItr)
+		{
+			directoriesToRemove.push_back(directoryItr->second);
+		}
+
+		for (auto directoryId : directoriesToRemove)
+		{
+			RemoveDirectoryLocked(directoryId);
+		}
+	}
+
+	size_t numRemovedEntries = m_entries.size() - m_numLiveEntries;
+
+	if (numRemovedEntries >= MIN_REMOVED_ENTRIES_TO_COMPACT && numRemovedEntries > m_numLiveEntries)
+	{
+		CompactLocked();
+	}
+}
+
+void FilenameIndex::RemoveDirectoryLocked(uint32_t directoryId)
+{
+	auto &directory = m_directories[directoryId];
+
+	for (auto entryId : directory.entryIds)
+	{
+		auto &entry = m_entries[entryId];
+
+		if (!entry.removed)
+		{
+			entry.removed = true;
+			m_numLiveEntries--;
+		}
+	}
+
+	// The entries and trigrams still refer to this directory, so it's left in place. It's simply
+	// no longer reachable by path, meaning that a folder recreated at the same path will get a
+	// new directory.
+	directory.removed = true;
+	m_directoryIds.erase(GetDirectoryKey(directory.path));
+}
+
+// Rebuilds the directories, entries and trigrams without anything that's been removed. The
+// remaining directories and entries are renumbered as a result. Since the trigrams are rebuilt
+// from scratch, this costs about as much as loading the index does.
+void FilenameIndex::CompactLocked()
+{
+	std::vector<Directory> directories;
+	std::vector<uint32_t> newDirectoryIds(m_directories.size(), UINT32_MAX);
+
+	for (uint32_t directoryId = 0; directoryId < m_directories.size(); directoryId++)
+	{
+		auto &directory = m_directories[directoryId];
+
+		if (directory.removed)
+		{
+			continue;
+		}
+
+		newDirectoryIds[directoryId] = static_cast<uint32_t>(directories.size());
+		directories.push_back({ std::move(directory.path), {}, false });
+	}
+
+	for (auto &[key, directoryId] : m_directoryIds)
+	{
+		directoryId = newDirectoryIds[directoryId];
+	}
+
+	std::vector<IndexedEntry> entries;
+	entries.swap(m_entries);
+	m_directories = std::move(directories);
+	m_trigrams.clear();
+
+	// Every entry within a removed directory is also removed, so each of the remaining entries
+	// has a new directory ID.
+	for (auto &entry : entries)
+	{
+		if (entry.removed)
+		{
+			continue;
+		}
+
+		auto entryId = static_cast<uint32_t>(m_entries.size());
+		uint32_t directoryId = newDirectoryIds[entry.directoryId];
+		m_entries.push_back({ std::move(entry.entry), directoryId, false });
+		m_directories[directoryId].entryIds.push_back(entryId);
+
+		IndexTrigramsLocked(entryId, FoldCase(m_entries[entryId].entry.name));
+	}
+}
+
+void FilenameIndex::Query(const std::vector<std::wstring> &requiredLiterals, bool recursive,
+	QueryCallback callback) const
+{
+	std::shared_lock<std::shared_mutex> lock(m_mutex);
+
+	std::optional<uint32_t> rootDirectoryId;
+	auto rootItr = m_directoryIds.find(GetDirectoryKey(m_rootDirectory));
+
+	if (rootItr != m_directoryIds.end())
+	{
+		rootDirectoryId = rootItr->second;
+	}
+
+	auto processEntry = [&](uint32_t entryId) {
+		const auto &entry = m_entries[entryId];
+
+		if (entry.removed || (!recursive && entry.directoryId != rootDirectoryId))
+		{
+			return true;
+		}
+
+		return callback(m_directories[entry.directoryId].path, entry.entry);
+	};
+
+	auto candidates = FindCandidatesLocked(requiredLiterals);
+
+	if (!candidates)
+	{
+		for (uint32_t entryId = 0; entryId < m_entries.size(); entryId++)
+		{
+			if (!processEntry(entryId))
+			{
+				return;
+			}
+		}
+
+		return;
+	}
+
+	for (auto entryId : *candidates)
+	{
+		if (!processEntry(entryId))
+		{
+			return;
+		}
+	}
+}
+
+// Returns the IDs of the entries that contain every trigram from the required literals. If none
+// of the literals are long enough to contain a trigram, there's nothing to narrow the search down
+// and every entry is a candidate, which is indicated by returning an empty optional.
+std::optional<std::vector<uint32_t>> FilenameIndex::FindCandidatesLocked(
+	const std::vector<std::wstring> &requiredLiterals) const
+{
+	std::vector<const std::vector<uint32_t> *> postingLists;
+
+	for (const auto &literal : requiredLiterals)
+	{
+		auto foldedLiteral = FoldCase(literal);
+
+		for (size_t i = 0; i + TRIGRAM_LENGTH <= foldedLiteral.size(); i++)
+		{
+			auto itr = m_trigrams.find(GetTrigram(foldedLiteral, i));
+
+			if (itr == m_trigrams.end())
+			{
+				// No entry contains this trigram, so nothing can match.
+				return std::vector<uint32_t>();
+			}
+
+			postingLists.push_back(&itr->second);
+		}
+	}
+
+	if (postingLists.empty())
+	{
+		return std::nullopt;
+	}
+
+	// Starting with the shortest list keeps each of the intersections as small as possible.
+	std::sort(postingLists.begin(), postingLists.end(),
+		[](const auto *list1, const auto *list2) { return list1->size() < list2->size(); });
+
+	std::vector<uint32_t> candidates = *postingLists[0];
+	std::vector<uint32_t> intersection;
+
+	for (size_t i = 1; i < postingLists.size() && !candidates.empty(); i++)
+	{
+		intersection.clear();
+		std::set_intersection(candidates.begin(), candidates.end(), postingLists[i]->begin(),
+			postingLists[i]->end(), std::back_inserter(intersection));
+		candidates.swap(intersection);
+	}
+
+	return candidates;
+}
+
+bool FilenameIndex::Save(const std::wstring &filePath) const
+{
+	std::shared_lock<std::shared_mutex> lock(m_mutex);
+
+	std::ofstream stream(filePath, std::ios::binary | std::ios::trunc);
+
+	if (!stream)
+	{
+		return false;
+	}
+
+	WriteValue(stream, FILE_SIGNATURE);
+	WriteValue(stream, FILE_VERSION);
+	WriteString(stream, m_rootDirectory);
+	WriteValue(stream, m_buildInfo.buildTime);
+	WriteValue(stream, m_buildInfo.volumeSerialNumber);
+
+	std::wstring_view rootDirectory = m_rootDirectory;
+
+	if (!rootDirectory.empty() && rootDirectory.back() == '\\')
+	{
+		rootDirectory.remove_suffix(1);
+	}
+
+	// Removed directories and entries are dropped here, so the IDs are renumbered. Each directory
+	// within the root is stored relative to it, which typically halves the size of the directory
+	// table.
+	std::vector<uint32_t> newDirectoryIds(m_directories.size(), UINT32_MAX);
+	uint32_t numLiveDirectories = 0;
+
+	for (uint32_t directoryId = 0; directoryId < m_directories.size(); directoryId++)
+	{
+		if (!m_directories[directoryId].removed)
+		{
+			newDirectoryIds[directoryId] = numLiveDirectories++;
+		}
+	}
+
+	WriteValue(stream, numLiveDirectories);
+
+	for (const auto &directory : m_directories)
+	{
+		if (directory.removed)
+		{
+			continue;
+		}
+
+		std::wstring_view relativePath = directory.path;
+
+		// Paths are compared case-insensitively throughout the index, so a directory may differ
+		// in case from the root directory.
+		if (IsWithinDirectory(relativePath, rootDirectory))
+		{
+			relativePath.remove_prefix(rootDirectory.size());
+
+			if (!relativePath.empty() && relativePath.front() == '\\')
+			{
+				relativePath.remove_prefix(1);
+			}
+		}
+
+		WriteString(stream, relativePath);
+	}
+
+	WriteValue(stream, static_cast<uint32_t>(m_numLiveEntries));
+
+	for (const auto &entry : m_entries)
+	{
+		if (entry.removed)
+		{
+			continue;
+		}
+
+		WriteValue(stream, newDirectoryIds[entry.directoryId]);
+		WriteString(stream, entry.entry.name);
+		WriteValue(stream, entry.entry.attributes);
+		WriteValue(stream, entry.entry.size);
+		WriteValue(stream, entry.entry.lastWriteTime);
+	}
+
+	return stream.good();
+}
+
+std::unique_ptr<FilenameIndex> FilenameIndex::Load(const std::wstring &filePath)
+{
+	std::ifstream stream(filePath, std::ios::binary);
+
+	if (!stream)
+	{
+		return nullptr;
+	}
+
+	uint32_t signature;
+	uint32_t version;
+	std::wstring rootDirectory;
+	BuildInfo buildInfo;
+
+	if (!ReadValue(stream, signature) || signature != FILE_SIGNATURE
+		|| !ReadValue(stream, version) || version != FILE_VERSION
+		|| !ReadString(stream, rootDirectory) || !ReadValue(stream, buildInfo.buildTime)
+		|| !ReadValue(stream, buildInfo.volumeSerialNumber))
+	{
+		return nullptr;
+	}
+
+	auto index = std::make_unique<FilenameIndex>(rootDirectory);
+	std::unique_lock<std::shared_mutex> lock(index->m_mutex);
+
+	index->m_buildInfo = buildInfo;
+
+	uint32_t numDirectories;
+
+	if (!ReadValue(stream, numDirectories))
+	{
+		return nullptr;
+	}
+
+	std::wstring rootPrefix = rootDirectory;
+
+	if (!rootPrefix.empty() && rootPrefix.back() != '\\')
+	{
+		rootPrefix += '\\';
+	}
+
+	for (uint32_t i = 0; i < numDirectories; i++)
+	{
+		std::wstring relativePath;
+
+		if (!ReadString(stream, relativePath))
+		{
+			return nullptr;
+		}
+
+		// Directories outside the root are stored with their full path.
+		std::wstring directory;
+
+		if (relativePath.empty())
+		{
+			directory = rootDirectory;
+		}
+		else if (!PathIsRelative(relativePath.c_str()))
+		{
+			directory = relativePath;
+		}
+		else
+		{
+			directory = rootPrefix + relativePath;
+		}
+
+		auto directoryId = index->GetOrCreateDirectoryLocked(directory);
+
+		if (directoryId != i)
+		{
+			// Each of the directories should be unique.
+			return nullptr;
+		}
+	}
+
+	uint32_t numEntries;
+
+	if (!ReadValue(stream, numEntries))
+	{
+		return nullptr;
+	}
+
+	for (uint32_t i = 0; i < numEntries; i++)
+	{
+		uint32_t directoryId;
+		Entry entry;
+
+		if (!ReadValue(stream, directoryId) || directoryId >= numDirectories
+			|| !ReadString(stream, entry.name) || !ReadValue(stream, entry.attributes)
+			|| !ReadValue(stream, entry.size) || !ReadValue(stream, entry.lastWriteTime))
+		{
+			return nullptr;
+		}
+
+		// The entries were unique when they were saved, so there's no need to check for
+		// existing entries here.
+		index->AddEntryLocked(directoryId, entry, false);
+	}
+
+	return index;
+}
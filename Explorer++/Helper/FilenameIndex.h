@@ -0,0 +1,129 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// An in-memory index of the names of every file and folder within a directory tree. Names are
+// indexed by their trigrams (each sequence of three consecutive characters, after case folding),
+// so that the entries containing a particular substring can be found without examining every
+// name in the tree.
+//
+// The index can be saved to and loaded from disk. Only the directories and entries (along with
+// the build information) are saved; the trigrams are rebuilt when the index is loaded.
+//
+// All methods can be called from any thread.
+class FilenameIndex
+{
+public:
+	struct Entry
+	{
+		std::wstring name;
+		DWORD attributes;
+		ULONGLONG size;
+		FILETIME lastWriteTime;
+	};
+
+	// Describes the walk that the index was built from, so that a saved index can be checked
+	// before it's used.
+	struct BuildInfo
+	{
+		// The time the walk started, in the same units as a FILETIME.
+		ULONGLONG buildTime;
+
+		// The serial number of the volume containing the root directory, or 0 if it's unknown.
+		DWORD volumeSerialNumber;
+	};
+
+	// Invoked with the full path of the directory containing the entry. Returning false ends the
+	// query.
+	using QueryCallback = std::function<bool(const std::wstring &directory, const Entry &entry)>;
+
+	explicit FilenameIndex(const std::wstring &rootDirectory);
+
+	static Entry EntryFromFindData(const WIN32_FIND_DATA &findData);
+
+	const std::wstring &GetRootDirectory() const;
+	size_t GetNumEntries() const;
+
+	BuildInfo GetBuildInfo() const;
+	void SetBuildInfo(const BuildInfo &buildInfo);
+
+	// Adds the entries within the specified directory (which should be a full path). If an entry
+	// with the same name already exists in the directory, it's updated instead.
+	void AddEntries(const std::wstring &directory, const std::vector<Entry> &entries);
+	void AddEntry(const std::wstring &directory, const Entry &entry);
+
+	// Removes the item with the specified path. If the item is a folder, everything within it is
+	// removed as well.
+	void RemoveEntry(const std::wstring &path);
+
+	// Calls the callback for every entry whose name contains all of the specified literals
+	// (compared case-insensitively), though it may also call it for some entries that don't. The
+	// caller is expected to run a full match on each of the entries it's given. If recursive is
+	// false, only entries directly within the root directory are returned.
+	void Query(const std::vector<std::wstring> &requiredLiterals, bool recursive,
+		QueryCallback callback) const;
+
+	bool Save(const std::wstring &filePath) const;
+	static std::unique_ptr<FilenameIndex> Load(const std::wstring &filePath);
+
+private:
+	static constexpr uint32_t FILE_SIGNATURE = 0x58444946;
+	static constexpr uint32_t FILE_VERSION = 2;
+
+	// Removed entries are only marked as removed, since the trigrams refer to them by ID. Once
+	// they outnumber the remaining entries (and there are at least this many of them), the index
+	// is compacted.
+	static constexpr size_t MIN_REMOVED_ENTRIES_TO_COMPACT = 4096;
+
+	struct IndexedEntry
+	{
+		Entry entry;
+		uint32_t directoryId;
+		bool removed;
+	};
+
+	struct Directory
+	{
+		std::wstring path;
+		std::vector<uint32_t> entryIds;
+		bool removed;
+	};
+
+	uint32_t GetOrCreateDirectoryLocked(const std::wstring &directory);
+	void AddEntryLocked(uint32_t directoryId, const Entry &entry, bool replaceExisting);
+	void IndexTrigramsLocked(uint32_t entryId, std::wstring_view name);
+	void RemoveDirectoryLocked(uint32_t directoryId);
+	void CompactLocked();
+	std::optional<std::vector<uint32_t>> FindCandidatesLocked(
+		const std::vector<std::wstring> &requiredLiterals) const;
+
+	const std::wstring m_rootDirectory;
+
+	mutable std::shared_mutex m_mutex;
+
+	BuildInfo m_buildInfo = {};
+
+	std::vector<Directory> m_directories;
+
+	// Maps the folded path of each directory to its index in m_directories. The map is ordered so
+	// that all the directories beneath a particular directory form a single range.
+	std::map<std::wstring, uint32_t> m_directoryIds;
+
+	std::vector<IndexedEntry> m_entries;
+	size_t m_numLiveEntries;
+
+	// Maps each trigram to the (ascending) IDs of the entries that contain it.
+	std::unordered_map<uint64_t, std::vector<uint32_t>> m_trigrams;
+};
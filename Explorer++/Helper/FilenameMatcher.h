@@ -0,0 +1,27 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The interface shared by each of the ways in which a filename can be matched against a pattern
+// (e.g. a wildcard pattern or a regular expression). Once constructed, a matcher is only ever
+// read, so Match() can be called concurrently from multiple threads.
+class FilenameMatcher
+{
+public:
+	virtual ~FilenameMatcher() = default;
+
+	virtual bool Match(std::wstring_view str) const = 0;
+
+	// Returns a set of literal strings that every matching string is guaranteed to contain. This
+	// allows a caller to cheaply rule out strings (e.g. through a substring index) before running
+	// the full match. When the matcher is case-insensitive, the literals are lowercase and need
+	// to be compared against lowercase strings. An empty result places no constraint on the
+	// strings that can match.
+	virtual std::vector<std::wstring> GetRequiredLiterals() const = 0;
+};
@@ -4,55 +4,47 @@
 
 #include "stdafx.h"
 #include "FolderSize.h"
-#include <filesystem>
+#include "ParallelDirectoryWalker.h"
+#include <wil/common.h>
+#include <vector>
 
 FolderInfo GetFolderInfo(const std::wstring &path)
 {
-	FolderInfo folderInfo = {};
-	std::error_code error;
-
-	for (const auto &entry : std::filesystem::directory_iterator(path, error))
-	{
-		if (std::filesystem::is_directory(entry.status()))
-		{
-			folderInfo.numFolders++;
-
-			FolderInfo subFolderInfo = GetFolderInfo(entry.path());
-
-			folderInfo.size += subFolderInfo.size;
-			folderInfo.numFolders += subFolderInfo.numFolders;
-			folderInfo.numFiles += subFolderInfo.numFiles;
-		}
-		else
-		{
-			std::error_code sizeErrorCode;
-			const auto size = std::filesystem::file_size(entry.path(), sizeErrorCode);
-
-			// If the size can't be retrieved, the error will be ignored and the current file will
-			// effectively be skipped over.
-			if (!sizeErrorCode)
-			{
-				folderInfo.size += size;
-				folderInfo.numFiles++;
-			}
-		}
-	}
-
-	return folderInfo;
+	ParallelDirectoryWalker walker(1);
+	return GetFolderInfo(walker, path);
 }
 
-DWORD WINAPI Thread_CalculateFolderSize(LPVOID lpParameter)
+FolderInfo GetFolderInfo(ParallelDirectoryWalker &walker, const std::wstring &path)
 {
-	FolderSize_t *pFolderSize = reinterpret_cast<FolderSize_t *>(lpParameter);
+	std::vector<FolderInfo> workerFolderInfo(walker.GetNumWorkers());
 
-	auto folderInfo = GetFolderInfo(pFolderSize->szPath);
+	walker.Walk(path, true, nullptr,
+		[&workerFolderInfo](
+			int workerIndex, const std::wstring &directory, const WIN32_FIND_DATA &findData) {
+			UNREFERENCED_PARAMETER(directory);
 
-	ULARGE_INTEGER size;
-	size.QuadPart = folderInfo.size;
+			auto &folderInfo = workerFolderInfo[workerIndex];
 
-	pFolderSize->pfnCallback(folderInfo.numFolders, folderInfo.numFiles, &size, pFolderSize->pData);
+			if (WI_IsFlagSet(findData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+			{
+				folderInfo.numFolders++;
+			}
+			else
+			{
+				folderInfo.size += (static_cast<std::uintmax_t>(findData.nFileSizeHigh) << 32)
+					| findData.nFileSizeLow;
+				folderInfo.numFiles++;
+			}
+		});
 
-	free(pFolderSize);
+	FolderInfo folderInfo = {};
 
-	return 1;
+	for (const auto &currentFolderInfo : workerFolderInfo)
+	{
+		folderInfo.size += currentFolderInfo.size;
+		folderInfo.numFolders += currentFolderInfo.numFolders;
+		folderInfo.numFiles += currentFolderInfo.numFiles;
+	}
+
+	return folderInfo;
 }
\ No newline at end of file
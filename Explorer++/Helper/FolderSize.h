@@ -4,6 +4,11 @@
 
 #pragma once
 
+#include <cstdint>
+#include <string>
+
+class ParallelDirectoryWalker;
+
 struct FolderInfo
 {
 	std::uintmax_t size;
@@ -11,13 +16,10 @@ struct FolderInfo
 	int numFiles;
 };
 
+// The size of each file is taken from the directory enumeration itself, so no additional calls are
+// made for individual files.
 FolderInfo GetFolderInfo(const std::wstring &path);
 
-typedef struct
-{
-	TCHAR szPath[MAX_PATH];
-	LPVOID pData;
-	void (*pfnCallback)(int nFolders, int nFiles, PULARGE_INTEGER lTotalFolderSize, LPVOID pData);
-} FolderSize_t;
-
-DWORD WINAPI Thread_CalculateFolderSize(LPVOID lpParameter);
\ No newline at end of file
+// Walks the folder using the specified walker. If the walker is stopped, the result will be
+// incomplete.
+FolderInfo GetFolderInfo(ParallelDirectoryWalker &walker, const std::wstring &path);
\ No newline at end of file
@@ -0,0 +1,436 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "FolderSizeService.h"
+#include "Macros.h"
+#include "ParallelDirectoryWalker.h"
+#include <algorithm>
+
+FolderSizeService::FolderSizeService() :
+	m_useCounter(0),
+	m_stopping(false),
+	m_cacheCheckTimerSet(false),
+	m_deviceNotificationWindow(nullptr),
+	m_threadPool(NUM_CONCURRENT_CALCULATIONS)
+{
+	// The timer is only set once a result has been cached.
+	m_cacheCheckTimer.reset(CreateThreadpoolTimer(OnCacheCheckTimer, this, nullptr));
+}
+
+FolderSizeService::~FolderSizeService()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		// Once this is set, the timer won't be set again.
+		m_stopping = true;
+
+		for (auto &[key, calculation] : m_calculations)
+		{
+			if (calculation.walker)
+			{
+				calculation.walker->Stop();
+			}
+		}
+	}
+
+	m_cacheCheckTimer.reset();
+
+	// Any calculations that haven't started yet are simply discarded, while the walks that are
+	// in progress will end shortly, since they've been stopped above.
+	m_threadPool.clear_queue();
+	m_threadPool.stop(true);
+}
+
+std::optional<FolderInfo> FolderSizeService::GetFolderInfo(
+	const std::wstring &path, Callback callback)
+{
+	std::wstring key = GetKey(path);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto cachedFolderInfo = GetCachedFolderInfoLocked(key);
+
+	if (cachedFolderInfo)
+	{
+		return cachedFolderInfo;
+	}
+
+	auto itr = m_calculations.find(key);
+
+	if (itr != m_calculations.end())
+	{
+		itr->second.callbacks.push_back(std::move(callback));
+		return std::nullopt;
+	}
+
+	m_calculations[key].callbacks.push_back(std::move(callback));
+
+	m_threadPool.push([this, key, path](int id) {
+		UNREFERENCED_PARAMETER(id);
+
+		Calculate(key, path);
+	});
+
+	return std::nullopt;
+}
+
+std::optional<FolderInfo> FolderSizeService::GetCachedFolderInfo(const std::wstring &path)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return GetCachedFolderInfoLocked(GetKey(path));
+}
+
+void FolderSizeService::ReleaseFolder(const std::wstring &path)
+{
+	std::wstring folderKey = GetKey(path);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for (auto itr = m_cachedResults.begin(); itr != m_cachedResults.end();)
+	{
+		if (IsKeyWithinFolder(itr->first, folderKey))
+		{
+			itr = m_cachedResults.erase(itr);
+		}
+		else
+		{
+			++itr;
+		}
+	}
+
+	for (auto &[key, calculation] : m_calculations)
+	{
+		if (IsKeyWithinFolder(key, folderKey))
+		{
+			calculation.changeNotification.reset();
+		}
+	}
+}
+
+void FolderSizeService::SetDeviceNotificationWindow(HWND hwnd)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_deviceNotificationWindow = hwnd;
+}
+
+void FolderSizeService::OnDeviceRemoval(const DEV_BROADCAST_HDR *dbh)
+{
+	if (dbh->dbch_devicetype != DBT_DEVTYP_HANDLE)
+	{
+		return;
+	}
+
+	auto *handleNotification = reinterpret_cast<const DEV_BROADCAST_HANDLE *>(dbh);
+	std::optional<VolumeRegistration> registration;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto itr = std::find_if(m_volumeRegistrations.begin(), m_volumeRegistrations.end(),
+			[handleNotification](const auto &entry) {
+				return entry.second.volume.get() == handleNotification->dbch_handle;
+			});
+
+		if (itr == m_volumeRegistrations.end())
+		{
+			return;
+		}
+
+		registration = std::move(itr->second);
+		m_volumeRegistrations.erase(itr);
+	}
+
+	ReleaseFolder(registration->volumePath);
+
+	// The volume handle itself is closed once the registration goes out of scope here.
+}
+
+boost::signals2::connection FolderSizeService::AddInvalidatedObserver(
+	const InvalidatedSignal::slot_type &observer)
+{
+	return m_invalidatedSignal.connect(observer);
+}
+
+void FolderSizeService::Calculate(const std::wstring &key, const std::wstring &path)
+{
+	ParallelDirectoryWalker walker(ParallelDirectoryWalker::GetDefaultNumWorkers());
+
+	// Registering for change notifications before the walk starts means that any changes made
+	// while the walk is in progress will still invalidate the result.
+	wil::unique_hfind_change changeNotification(FindFirstChangeNotification(path.c_str(), TRUE,
+		FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE));
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (m_stopping)
+		{
+			return;
+		}
+
+		auto &calculation = m_calculations[key];
+		calculation.walker = &walker;
+		calculation.changeNotification = std::move(changeNotification);
+	}
+
+	auto folderInfo = ::GetFolderInfo(walker, path);
+
+	std::vector<Callback> callbacks;
+	std::vector<std::wstring> changedPaths;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto itr = m_calculations.find(key);
+		callbacks = std::move(itr->second.callbacks);
+		changeNotification = std::move(itr->second.changeNotification);
+		m_calculations.erase(itr);
+
+		if (walker.IsStopped())
+		{
+			return;
+		}
+
+		// An out of date result for this folder may still be cached. It's removed (and reported)
+		// here, rather than being silently replaced below.
+		changedPaths = RemoveChangedResultsLocked();
+
+		// If it's not possible to monitor the folder for changes (which can be the case for some
+		// network shares, for example), there'd be no way of knowing when the result was out of
+		// date, so it's not cached. The same is true if the folder was released during the walk.
+		if (changeNotification)
+		{
+			CacheResultLocked(key, path, folderInfo, std::move(changeNotification));
+		}
+	}
+
+	for (const auto &callback : callbacks)
+	{
+		callback(folderInfo);
+	}
+
+	for (const auto &changedPath : changedPaths)
+	{
+		m_invalidatedSignal(changedPath);
+	}
+}
+
+std::optional<FolderInfo> FolderSizeService::GetCachedFolderInfoLocked(const std::wstring &key)
+{
+	auto itr = m_cachedResults.find(key);
+
+	if (itr == m_cachedResults.end())
+	{
+		return std::nullopt;
+	}
+
+	if (GetTickCount64() - itr->second.cacheTime >= MAX_CACHED_RESULT_AGE)
+	{
+		m_cachedResults.erase(itr);
+		return std::nullopt;
+	}
+
+	// The notification handle remains signaled once a change has occurred, so checking it is
+	// enough to determine whether the result is still valid. An out of date result is left in
+	// place, so that the change is still reported once the result is removed.
+	if (WaitForSingleObject(itr->second.changeNotification.get(), 0) != WAIT_TIMEOUT)
+	{
+		return std::nullopt;
+	}
+
+	itr->second.lastUsed = m_useCounter++;
+
+	return itr->second.folderInfo;
+}
+
+void FolderSizeService::CacheResultLocked(const std::wstring &key, const std::wstring &path,
+	const FolderInfo &folderInfo, wil::unique_hfind_change changeNotification)
+{
+	RemoveExpiredResultsLocked();
+
+	if (m_cachedResults.size() >= MAX_CACHED_RESULTS && m_cachedResults.count(key) == 0)
+	{
+		auto leastRecentlyUsed = std::min_element(m_cachedResults.begin(), m_cachedResults.end(),
+			[](const auto &first, const auto &second) {
+				return first.second.lastUsed < second.second.lastUsed;
+			});
+		m_cachedResults.erase(leastRecentlyUsed);
+	}
+
+	m_cachedResults[key] = { path, folderInfo, std::move(changeNotification), GetTickCount64(),
+		m_useCounter++ };
+
+	RegisterVolumeLocked(path);
+
+	if (!m_cacheCheckTimerSet && !m_stopping && m_cacheCheckTimer)
+	{
+		// A negative due time is relative to the current time, in 100-nanosecond intervals.
+		ULARGE_INTEGER dueTime;
+		dueTime.QuadPart =
+			static_cast<ULONGLONG>(-static_cast<LONGLONG>(CACHE_CHECK_INTERVAL) * 10000);
+		FILETIME dueFileTime = { dueTime.LowPart, dueTime.HighPart };
+
+		SetThreadpoolTimer(m_cacheCheckTimer.get(), &dueFileTime, CACHE_CHECK_INTERVAL, 1000);
+		m_cacheCheckTimerSet = true;
+	}
+}
+
+void FolderSizeService::RemoveExpiredResultsLocked()
+{
+	ULONGLONG now = GetTickCount64();
+
+	for (auto itr = m_cachedResults.begin(); itr != m_cachedResults.end();)
+	{
+		if (now - itr->second.cacheTime >= MAX_CACHED_RESULT_AGE)
+		{
+			itr = m_cachedResults.erase(itr);
+		}
+		else
+		{
+			++itr;
+		}
+	}
+}
+
+void FolderSizeService::RegisterVolumeLocked(const std::wstring &path)
+{
+	if (!m_deviceNotificationWindow)
+	{
+		return;
+	}
+
+	TCHAR volumePath[MAX_PATH];
+
+	if (!GetVolumePathName(path.c_str(), volumePath, SIZEOF_ARRAY(volumePath)))
+	{
+		return;
+	}
+
+	// A network share can't be removed in the way a local volume can, so there's no need to
+	// register it.
+	if (GetDriveType(volumePath) == DRIVE_REMOTE)
+	{
+		return;
+	}
+
+	std::wstring volumeKey = GetKey(volumePath);
+
+	if (m_volumeRegistrations.count(volumeKey) > 0)
+	{
+		return;
+	}
+
+	wil::unique_hfile volume(CreateFile(volumePath, FILE_LIST_DIRECTORY,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+		FILE_FLAG_BACKUP_SEMANTICS, nullptr));
+
+	if (!volume)
+	{
+		return;
+	}
+
+	DEV_BROADCAST_HANDLE broadcastHandle = {};
+	broadcastHandle.dbch_size = sizeof(broadcastHandle);
+	broadcastHandle.dbch_devicetype = DBT_DEVTYP_HANDLE;
+	broadcastHandle.dbch_handle = volume.get();
+
+	unique_hdevnotify deviceNotification(RegisterDeviceNotification(
+		m_deviceNotificationWindow, &broadcastHandle, DEVICE_NOTIFY_WINDOW_HANDLE));
+
+	if (!deviceNotification)
+	{
+		return;
+	}
+
+	m_volumeRegistrations[volumeKey] = { volumePath, std::move(volume),
+		std::move(deviceNotification) };
+}
+
+std::vector<std::wstring> FolderSizeService::RemoveChangedResultsLocked()
+{
+	std::vector<std::wstring> changedPaths;
+
+	for (auto itr = m_cachedResults.begin(); itr != m_cachedResults.end();)
+	{
+		if (WaitForSingleObject(itr->second.changeNotification.get(), 0) != WAIT_TIMEOUT)
+		{
+			changedPaths.push_back(std::move(itr->second.path));
+			itr = m_cachedResults.erase(itr);
+		}
+		else
+		{
+			++itr;
+		}
+	}
+
+	return changedPaths;
+}
+
+void CALLBACK FolderSizeService::OnCacheCheckTimer(PTP_CALLBACK_INSTANCE instance, void *context,
+	PTP_TIMER timer)
+{
+	UNREFERENCED_PARAMETER(instance);
+	UNREFERENCED_PARAMETER(timer);
+
+	auto *folderSizeService = static_cast<FolderSizeService *>(context);
+	folderSizeService->CheckCachedResults();
+}
+
+void FolderSizeService::CheckCachedResults()
+{
+	std::vector<std::wstring> changedPaths;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		RemoveExpiredResultsLocked();
+		changedPaths = RemoveChangedResultsLocked();
+
+		// There's nothing left to check, so the timer is cancelled until another result is
+		// cached.
+		if (m_cachedResults.empty() && m_cacheCheckTimerSet)
+		{
+			SetThreadpoolTimer(m_cacheCheckTimer.get(), nullptr, 0, 0);
+			m_cacheCheckTimerSet = false;
+		}
+	}
+
+	// The observers are notified without the lock held, so that they're free to request folder
+	// sizes in response.
+	for (const auto &changedPath : changedPaths)
+	{
+		m_invalidatedSignal(changedPath);
+	}
+}
+
+std::wstring FolderSizeService::GetKey(const std::wstring &path)
+{
+	std::wstring key = path;
+
+	// Paths are compared case-insensitively, with any trailing backslash ignored (other than for
+	// the root of a drive, such as "C:\").
+	if (key.size() > 3 && key.back() == '\\')
+	{
+		key.pop_back();
+	}
+
+	CharLowerBuff(key.data(), static_cast<DWORD>(key.size()));
+
+	return key;
+}
+
+// Both keys are normalized by GetKey(), so the only key that can end in a backslash is the root
+// of a drive.
+bool FolderSizeService::IsKeyWithinFolder(const std::wstring &key, const std::wstring &folderKey)
+{
+	if (folderKey.empty() || key.compare(0, folderKey.size(), folderKey) != 0)
+	{
+		return false;
+	}
+
+	return key.size() == folderKey.size() || folderKey.back() == '\\'
+		|| key[folderKey.size()] == '\\';
+}
@@ -0,0 +1,153 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "FolderSize.h"
+#include "../ThirdParty/CTPL/cpl_stl.h"
+#include <boost/signals2.hpp>
+#include <wil/resource.h>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ParallelDirectoryWalker;
+
+// Calculates folder sizes in the background, with each folder being walked by a set of worker
+// threads. Results are cached until a change is made somewhere within the folder (or until they
+// expire), and concurrent requests for the same folder share a single calculation.
+class FolderSizeService
+{
+public:
+	// Invoked on a background thread once the calculation is complete.
+	using Callback = std::function<void(const FolderInfo &folderInfo)>;
+
+	// Invoked on a background thread when a change is detected within a folder whose result was
+	// cached. The result is discarded at that point, so the size will be recalculated the next
+	// time it's requested.
+	using InvalidatedSignal = boost::signals2::signal<void(const std::wstring &path)>;
+
+	FolderSizeService();
+	~FolderSizeService();
+
+	// If an up-to-date result is cached, it's returned directly and the callback won't be invoked.
+	// Otherwise, the folder is queued for calculation (unless it's already being calculated) and
+	// the callback will be invoked once the result is available.
+	std::optional<FolderInfo> GetFolderInfo(const std::wstring &path, Callback callback);
+
+	std::optional<FolderInfo> GetCachedFolderInfo(const std::wstring &path);
+
+	// Closes any handles held on the specified folder or on anything within it, so that the
+	// volume can be removed. Cached results within the folder are discarded, while calculations
+	// that are in progress will still complete, but their results won't be cached.
+	void ReleaseFolder(const std::wstring &path);
+
+	// A top-level window isn't sent DBT_DEVICEQUERYREMOVE for a volume, unless it's registered
+	// for notifications on a handle to that volume. So, once this is set, each volume that a
+	// result is cached on is registered with the window. The window should then pass the
+	// DBT_DEVICEQUERYREMOVE and DBT_DEVICEREMOVECOMPLETE notifications it receives to
+	// OnDeviceRemoval().
+	void SetDeviceNotificationWindow(HWND hwnd);
+
+	// Releases everything held on the volume being removed, including the handle that was
+	// registered for notifications.
+	void OnDeviceRemoval(const DEV_BROADCAST_HDR *dbh);
+
+	boost::signals2::connection AddInvalidatedObserver(
+		const InvalidatedSignal::slot_type &observer);
+
+private:
+	// Walking a folder is mostly bound by I/O, so there's little to be gained from walking more
+	// than a few folders at once, particularly as each walk is itself split across several
+	// threads.
+	static const int NUM_CONCURRENT_CALCULATIONS = 2;
+
+	// Each cached result holds a change notification handle open, so the number of results is
+	// limited.
+	static const size_t MAX_CACHED_RESULTS = 64;
+
+	// Cached results are also discarded after a while, so that handles aren't held open
+	// indefinitely on folders that are no longer being viewed.
+	static const ULONGLONG MAX_CACHED_RESULT_AGE = 10 * 60 * 1000;
+
+	// How often the cached results are checked for changes (and for expiry). The check only runs
+	// while there are results cached.
+	static const DWORD CACHE_CHECK_INTERVAL = 5 * 1000;
+
+	struct CachedResult
+	{
+		std::wstring path;
+		FolderInfo folderInfo;
+
+		// Signaled once a change has been made within the folder, at which point the result is
+		// out of date.
+		wil::unique_hfind_change changeNotification;
+
+		ULONGLONG cacheTime;
+		ULONGLONG lastUsed;
+	};
+
+	using unique_hdevnotify = wil::unique_any<HDEVNOTIFY,
+		decltype(&::UnregisterDeviceNotification), ::UnregisterDeviceNotification>;
+
+	struct VolumeRegistration
+	{
+		std::wstring volumePath;
+
+		// Held open only so that it can be registered for device notifications.
+		wil::unique_hfile volume;
+
+		// Declared after the handle, so that the registration is removed before the handle is
+		// closed.
+		unique_hdevnotify deviceNotification;
+	};
+
+	struct Calculation
+	{
+		std::vector<Callback> callbacks;
+
+		// Set while the folder is being walked, so that the walk can be stopped on shutdown.
+		ParallelDirectoryWalker *walker = nullptr;
+
+		// Held here while the folder is being walked, so that it can be closed if the folder is
+		// released. In that case, the result won't be cached.
+		wil::unique_hfind_change changeNotification;
+	};
+
+	static std::wstring GetKey(const std::wstring &path);
+	static bool IsKeyWithinFolder(const std::wstring &key, const std::wstring &folderKey);
+	static void CALLBACK OnCacheCheckTimer(PTP_CALLBACK_INSTANCE instance, void *context,
+		PTP_TIMER timer);
+
+	void Calculate(const std::wstring &key, const std::wstring &path);
+	std::optional<FolderInfo> GetCachedFolderInfoLocked(const std::wstring &key);
+	void CacheResultLocked(const std::wstring &key, const std::wstring &path,
+		const FolderInfo &folderInfo, wil::unique_hfind_change changeNotification);
+	void RemoveExpiredResultsLocked();
+	std::vector<std::wstring> RemoveChangedResultsLocked();
+	void RegisterVolumeLocked(const std::wstring &path);
+	void CheckCachedResults();
+
+	std::mutex m_mutex;
+	std::unordered_map<std::wstring, CachedResult> m_cachedResults;
+	std::unordered_map<std::wstring, Calculation> m_calculations;
+
+	// Keyed by the volume path, as returned by GetKey().
+	std::unordered_map<std::wstring, VolumeRegistration> m_volumeRegistrations;
+	HWND m_deviceNotificationWindow;
+	ULONGLONG m_useCounter;
+	bool m_stopping;
+	bool m_cacheCheckTimerSet;
+
+	InvalidatedSignal m_invalidatedSignal;
+
+	ctpl::thread_pool m_threadPool;
+
+	// Declared last, so that it's destroyed (which waits for any callback that's in progress)
+	// before anything the callback uses.
+	wil::unique_threadpool_timer m_cacheCheckTimer;
+};
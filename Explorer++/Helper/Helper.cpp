@@ -443,7 +443,8 @@ BOOL GetFileNameFromUser(HWND hwnd, TCHAR *fullFileName, UINT cchMax, const TCHA
 	should be at least 256. */
 	assert(cchMax >= 256);
 
-	const TCHAR *filter = _T("Text Document (*.txt)\0*.txt\0All Files\0*.*\0\0");
+	const TCHAR *filter = _T("Text Document (*.txt)\0*.txt\0CSV (*.csv)\0*.csv\0")
+		_T("JSON Lines (*.jsonl)\0*.jsonl\0All Files\0*.*\0\0");
 	OPENFILENAME ofn;
 	BOOL bRet;
 
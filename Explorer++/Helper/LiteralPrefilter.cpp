@@ -0,0 +1,115 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "LiteralPrefilter.h"
+#include <algorithm>
+
+namespace
+{
+	const size_t FOLD_TABLE_SIZE = 0x10000;
+
+	std::vector<wchar_t> BuildFoldTable()
+	{
+		std::vector<wchar_t> characters(FOLD_TABLE_SIZE);
+
+		for (size_t i = 0; i < FOLD_TABLE_SIZE; i++)
+		{
+			characters[i] = static_cast<wchar_t>(i);
+		}
+
+		std::vector<wchar_t> foldTable(FOLD_TABLE_SIZE);
+		int length = LCMapString(LOCALE_USER_DEFAULT, LCMAP_LOWERCASE, characters.data(),
+			static_cast<int>(characters.size()), foldTable.data(),
+			static_cast<int>(foldTable.size()));
+
+		// Lowercasing maps each UTF-16 code unit to a single code unit, so this is only a
+		// safeguard. If the lengths differ, the table can't be trusted.
+		if (length != static_cast<int>(FOLD_TABLE_SIZE))
+		{
+			return characters;
+		}
+
+		return foldTable;
+	}
+}
+
+LiteralPrefilter::LiteralPrefilter(const std::vector<std::wstring> &literals, bool caseSensitive) :
+	m_caseSensitive(caseSensitive)
+{
+	for (const auto &literal : literals)
+	{
+		if (!literal.empty())
+		{
+			m_literals.push_back(literal);
+		}
+	}
+
+	std::stable_sort(m_literals.begin(), m_literals.end(),
+		[](const auto &literal1, const auto &literal2) {
+			return literal1.size() > literal2.size();
+		});
+}
+
+bool LiteralPrefilter::MayMatch(std::wstring_view str) const
+{
+	for (const auto &literal : m_literals)
+	{
+		bool found = m_caseSensitive ? (str.find(literal) != std::wstring_view::npos)
+									 : ContainsFolded(str, literal);
+
+		if (!found)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool LiteralPrefilter::ContainsFolded(std::wstring_view str, std::wstring_view literal)
+{
+	if (literal.size() > str.size())
+	{
+		return false;
+	}
+
+	size_t lastStart = str.size() - literal.size();
+
+	for (size_t i = 0; i <= lastStart; i++)
+	{
+		if (FoldCharacter(str[i]) != literal[0])
+		{
+			continue;
+		}
+
+		size_t j = 1;
+
+		while (j < literal.size() && FoldCharacter(str[i + j]) == literal[j])
+		{
+			j++;
+		}
+
+		if (j == literal.size())
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+wchar_t LiteralPrefilter::FoldCharacter(wchar_t c)
+{
+	static const std::vector<wchar_t> foldTable = BuildFoldTable();
+
+	auto index = static_cast<size_t>(c);
+
+	if (index >= FOLD_TABLE_SIZE)
+	{
+		return c;
+	}
+
+	return foldTable[index];
+}
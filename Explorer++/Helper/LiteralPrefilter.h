@@ -0,0 +1,38 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Rules out strings that can't possibly match a pattern, by checking that they contain each of
+// the literals required by the pattern (see FilenameMatcher::GetRequiredLiterals()). This is
+// considerably cheaper than running most matchers, since it never needs to fold or copy the
+// string being checked.
+class LiteralPrefilter
+{
+public:
+	// When caseSensitive is false, the literals are expected to have already been folded to
+	// lowercase.
+	LiteralPrefilter(const std::vector<std::wstring> &literals, bool caseSensitive);
+
+	// Returns false if the string definitely doesn't contain all of the literals.
+	bool MayMatch(std::wstring_view str) const;
+
+	// Returns the lowercase form of a single character, as it would be produced by folding a
+	// string containing it. The mapping is built once and then shared, so this is cheap enough to
+	// call for every character of a string.
+	static wchar_t FoldCharacter(wchar_t c);
+
+private:
+	static bool ContainsFolded(std::wstring_view str, std::wstring_view literal);
+
+	// Ordered from longest to shortest, since longer literals are less likely to be found and so
+	// rule strings out sooner.
+	std::vector<std::wstring> m_literals;
+
+	bool m_caseSensitive;
+};
@@ -0,0 +1,260 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "NativeCopyOperation.h"
+#include "FileCopier.h"
+#include "ShellFileOperation.h"
+#include <wil/common.h>
+#include <wil/resource.h>
+
+namespace
+{
+	std::wstring CombinePath(const std::wstring &directory, const std::wstring &name)
+	{
+		std::wstring path = directory;
+
+		if (!path.empty() && path.back() != '\\')
+		{
+			path += '\\';
+		}
+
+		path += name;
+
+		return path;
+	}
+
+	bool IsDotOrDotDot(const wchar_t *name)
+	{
+		return lstrcmp(name, L".") == 0 || lstrcmp(name, L"..") == 0;
+	}
+
+	// Returns true if the path is the same as the directory, or within it.
+	bool IsPathWithinDirectory(const std::wstring &path, const std::wstring &directory)
+	{
+		std::wstring prefix = CombinePath(directory, L"");
+
+		return lstrcmpi(CombinePath(path, L"").substr(0, prefix.size()).c_str(), prefix.c_str())
+			== 0;
+	}
+}
+
+NativeCopyOperation::NativeCopyOperation(HWND owner, const std::vector<PCIDLIST_ABSOLUTE> &items,
+	PCIDLIST_ABSOLUTE destinationFolder, bool verify) :
+	m_owner(owner),
+	m_items(DeepCopyPidls(items)),
+	m_destinationFolder(ILCloneFull(destinationFolder)),
+	m_verify(verify)
+{
+}
+
+HRESULT NativeCopyOperation::Run(FileOperationQueue::OperationContext &context)
+{
+	// The operation may have been paused while it was queued.
+	if (!context.Checkpoint())
+	{
+		return HRESULT_FROM_WIN32(ERROR_CANCELLED);
+	}
+
+	std::vector<PCIDLIST_ABSOLUTE> remainingItems;
+	std::wstring destinationDirectory;
+	HRESULT hr = GetDisplayName(m_destinationFolder.get(), SHGDN_FORPARSING, destinationDirectory);
+
+	if (SUCCEEDED(hr))
+	{
+		FileCopier fileCopier(m_verify);
+
+		for (const auto &item : m_items)
+		{
+			ItemResult result = CopyItem(item.get(), destinationDirectory, fileCopier, context);
+
+			if (result == ItemResult::Stopped)
+			{
+				return HRESULT_FROM_WIN32(ERROR_CANCELLED);
+			}
+
+			if (result == ItemResult::NotCopied)
+			{
+				remainingItems.push_back(item.get());
+			}
+		}
+	}
+	else
+	{
+		remainingItems = ShallowCopyPidls(m_items);
+	}
+
+	if (remainingItems.empty())
+	{
+		return S_OK;
+	}
+
+	ShellFileOperation shellFileOperation(
+		m_owner, ShellFileOperation::Type::Copy, remainingItems, m_destinationFolder.get());
+	return shellFileOperation.Run(context);
+}
+
+NativeCopyOperation::ItemResult NativeCopyOperation::CopyItem(PCIDLIST_ABSOLUTE item,
+	const std::wstring &destinationDirectory, FileCopier &fileCopier,
+	FileOperationQueue::OperationContext &context)
+{
+	SFGAOF attributes = SFGAO_FILESYSTEM;
+	HRESULT hr = GetItemAttributes(item, &attributes);
+
+	if (FAILED(hr) || WI_IsFlagClear(attributes, SFGAO_FILESYSTEM))
+	{
+		return ItemResult::NotCopied;
+	}
+
+	std::wstring sourcePath;
+	hr = GetDisplayName(item, SHGDN_FORPARSING, sourcePath);
+
+	if (FAILED(hr))
+	{
+		return ItemResult::NotCopied;
+	}
+
+	std::wstring destinationPath =
+		CombinePath(destinationDirectory, PathFindFileName(sourcePath.c_str()));
+
+	// Anything that would result in a conflict (which includes copying an item into the folder
+	// it's already in) is left to the shell, so that the user can decide what should happen.
+	if (GetFileAttributes(destinationPath.c_str()) != INVALID_FILE_ATTRIBUTES
+		|| IsPathWithinDirectory(destinationDirectory, sourcePath))
+	{
+		return ItemResult::NotCopied;
+	}
+
+	auto entries = BuildEntryList(sourcePath);
+
+	if (!entries)
+	{
+		return ItemResult::NotCopied;
+	}
+
+	for (const auto &entry : *entries)
+	{
+		if (!context.Checkpoint())
+		{
+			return ItemResult::Stopped;
+		}
+
+		std::wstring source =
+			entry.relativePath.empty() ? sourcePath : CombinePath(sourcePath, entry.relativePath);
+		std::wstring destination = entry.relativePath.empty()
+			? destinationPath
+			: CombinePath(destinationPath, entry.relativePath);
+
+		// If an item fails part way through, it's handed to the shell as it stands. The shell
+		// will then prompt about anything that was already copied.
+		if (entry.isDirectory)
+		{
+			if (!CreateDirectory(destination.c_str(), nullptr))
+			{
+				return ItemResult::NotCopied;
+			}
+
+			continue;
+		}
+
+		uint64_t bytesReported = 0;
+
+		auto result = fileCopier.Copy(source, destination, [&](uint64_t bytesCopied) {
+			context.ReportProgress(bytesCopied - bytesReported);
+			bytesReported = bytesCopied;
+
+			// Blocking here is what pauses the copy part way through a file.
+			if (!context.Checkpoint())
+			{
+				fileCopier.Stop();
+			}
+		});
+
+		if (result == FileCopier::Result::Stopped)
+		{
+			return ItemResult::Stopped;
+		}
+
+		if (result != FileCopier::Result::Succeeded)
+		{
+			return ItemResult::NotCopied;
+		}
+	}
+
+	return ItemResult::Copied;
+}
+
+// Lists the item and, if it's a folder, everything within it, with each folder listed before its
+// contents. Returns std::nullopt if anything can't be enumerated or is a reparse point (e.g. a
+// symbolic link or junction), since the shell has its own rules for copying those.
+std::optional<std::vector<NativeCopyOperation::Entry>> NativeCopyOperation::BuildEntryList(
+	const std::wstring &path)
+{
+	DWORD attributes = GetFileAttributes(path.c_str());
+
+	if (attributes == INVALID_FILE_ATTRIBUTES
+		|| WI_IsFlagSet(attributes, FILE_ATTRIBUTE_REPARSE_POINT))
+	{
+		return std::nullopt;
+	}
+
+	std::vector<Entry> entries;
+	entries.push_back({ L"", WI_IsFlagSet(attributes, FILE_ATTRIBUTE_DIRECTORY) });
+
+	std::vector<std::wstring> pendingDirectories;
+
+	if (entries[0].isDirectory)
+	{
+		pendingDirectories.push_back(L"");
+	}
+
+	while (!pendingDirectories.empty())
+	{
+		std::wstring relativeDirectory = pendingDirectories.back();
+		pendingDirectories.pop_back();
+
+		WIN32_FIND_DATA findData;
+		wil::unique_hfind findFile(
+			FindFirstFileEx(CombinePath(CombinePath(path, relativeDirectory), L"*").c_str(),
+				FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr,
+				FIND_FIRST_EX_LARGE_FETCH));
+
+		if (!findFile)
+		{
+			return std::nullopt;
+		}
+
+		do
+		{
+			if (IsDotOrDotDot(findData.cFileName))
+			{
+				continue;
+			}
+
+			if (WI_IsFlagSet(findData.dwFileAttributes, FILE_ATTRIBUTE_REPARSE_POINT))
+			{
+				return std::nullopt;
+			}
+
+			std::wstring relativePath =
+				relativeDirectory.empty() ? findData.cFileName
+										  : CombinePath(relativeDirectory, findData.cFileName);
+			bool isDirectory = WI_IsFlagSet(findData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY);
+
+			entries.push_back({ relativePath, isDirectory });
+
+			if (isDirectory)
+			{
+				pendingDirectories.push_back(relativePath);
+			}
+		} while (FindNextFile(findFile.get(), &findData));
+
+		if (GetLastError() != ERROR_NO_MORE_FILES)
+		{
+			return std::nullopt;
+		}
+	}
+
+	return entries;
+}
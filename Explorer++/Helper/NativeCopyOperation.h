@@ -0,0 +1,54 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "FileOperationQueue.h"
+#include "ShellHelper.h"
+#include <optional>
+#include <string>
+#include <vector>
+
+class FileCopier;
+
+// Copies items with FileCopier, rather than through the shell. That allows large files to be
+// copied without filling the system file cache, with the copy optionally verified afterwards.
+//
+// There's no conflict handling here, though, so an item is only copied this way if it's a plain
+// filesystem item (i.e. a file or folder with no reparse points) that doesn't already exist in the
+// destination. Everything else, along with any item that fails to copy, is passed on to
+// ShellFileOperation, which deals with it in the usual way.
+class NativeCopyOperation : public FileOperationQueue::Operation
+{
+public:
+	NativeCopyOperation(HWND owner, const std::vector<PCIDLIST_ABSOLUTE> &items,
+		PCIDLIST_ABSOLUTE destinationFolder, bool verify);
+
+	HRESULT Run(FileOperationQueue::OperationContext &context) override;
+
+private:
+	enum class ItemResult
+	{
+		Copied,
+		NotCopied,
+		Stopped
+	};
+
+	struct Entry
+	{
+		// Relative to the item being copied. Empty for the item itself.
+		std::wstring relativePath;
+
+		bool isDirectory;
+	};
+
+	ItemResult CopyItem(PCIDLIST_ABSOLUTE item, const std::wstring &destinationDirectory,
+		FileCopier &fileCopier, FileOperationQueue::OperationContext &context);
+	static std::optional<std::vector<Entry>> BuildEntryList(const std::wstring &path);
+
+	const HWND m_owner;
+	const std::vector<unique_pidl_absolute> m_items;
+	const unique_pidl_absolute m_destinationFolder;
+	const bool m_verify;
+};
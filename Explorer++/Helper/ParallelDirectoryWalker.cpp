@@ -0,0 +1,248 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ParallelDirectoryWalker.h"
+#include <wil/resource.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace
+{
+	// Enumerating a directory is usually bound by I/O latency (particularly on network shares),
+	// rather than the CPU, so it's worth using more workers than there are cores.
+	const int WORKERS_PER_CORE = 2;
+	const int MAX_DEFAULT_WORKERS = 16;
+
+	// Idle workers are woken when new directories are queued. The timeout is simply a backstop.
+	const auto IDLE_WAIT_TIMEOUT = std::chrono::milliseconds(10);
+
+	std::wstring CombinePath(const std::wstring &directory, const wchar_t *name)
+	{
+		std::wstring path = directory;
+
+		if (!path.empty() && path.back() != '\\')
+		{
+			path += '\\';
+		}
+
+		path += name;
+
+		return path;
+	}
+
+	bool IsDotOrDotDot(const wchar_t *name)
+	{
+		return lstrcmp(name, L".") == 0 || lstrcmp(name, L"..") == 0;
+	}
+}
+
+ParallelDirectoryWalker::ParallelDirectoryWalker(int numWorkers) :
+	m_numWorkers(std::max(numWorkers, 1)),
+	m_pendingDirectories(0),
+	m_queuedDirectories(0),
+	m_stopped(false),
+	m_recursive(true)
+{
+	for (int i = 0; i < m_numWorkers; i++)
+	{
+		m_queues.push_back(std::make_unique<WorkQueue>());
+	}
+}
+
+int ParallelDirectoryWalker::GetDefaultNumWorkers()
+{
+	int numCores = static_cast<int>(std::thread::hardware_concurrency());
+	return std::clamp(numCores * WORKERS_PER_CORE, 1, MAX_DEFAULT_WORKERS);
+}
+
+void ParallelDirectoryWalker::Walk(const std::wstring &rootDirectory, bool recursive,
+	DirectoryCallback directoryCallback, EntryCallback entryCallback,
+	SubdirectoryFilter subdirectoryFilter)
+{
+	m_recursive = recursive;
+	m_directoryCallback = std::move(directoryCallback);
+	m_entryCallback = std::move(entryCallback);
+	m_subdirectoryFilter = std::move(subdirectoryFilter);
+
+	m_pendingDirectories = 1;
+	m_queuedDirectories = 1;
+	m_queues[0]->directories.push_back({ rootDirectory, 0 });
+
+	// There's no point starting any other workers if only a single directory is going to be
+	// enumerated.
+	int numAdditionalWorkers = recursive ? m_numWorkers - 1 : 0;
+
+	std::vector<std::thread> threads;
+
+	for (int i = 1; i <= numAdditionalWorkers; i++)
+	{
+		threads.emplace_back(&ParallelDirectoryWalker::RunWorker, this, i);
+	}
+
+	RunWorker(0);
+
+	for (auto &thread : threads)
+	{
+		thread.join();
+	}
+
+	for (auto &queue : m_queues)
+	{
+		queue->directories.clear();
+	}
+}
+
+void ParallelDirectoryWalker::RunWorker(int workerIndex)
+{
+	while (!m_stopped && m_pendingDirectories > 0)
+	{
+		auto directory = TakeDirectory(workerIndex);
+
+		if (!directory)
+		{
+			std::unique_lock<std::mutex> lock(m_idleMutex);
+			m_idleCondition.wait_for(lock, IDLE_WAIT_TIMEOUT, [this] {
+				return m_stopped || m_pendingDirectories == 0 || m_queuedDirectories > 0;
+			});
+
+			continue;
+		}
+
+		EnumerateDirectory(workerIndex, *directory);
+		OnDirectoryFinished();
+	}
+}
+
+void ParallelDirectoryWalker::EnumerateDirectory(
+	int workerIndex, const QueuedDirectory &directory)
+{
+	if (m_directoryCallback)
+	{
+		m_directoryCallback(workerIndex, directory.path);
+	}
+
+	WIN32_FIND_DATA findData;
+	wil::unique_hfind findFile(FindFirstFileEx(CombinePath(directory.path, L"*").c_str(),
+		FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH));
+
+	if (!findFile)
+	{
+		return;
+	}
+
+	do
+	{
+		if (m_stopped)
+		{
+			break;
+		}
+
+		if (IsDotOrDotDot(findData.cFileName))
+		{
+			continue;
+		}
+
+		m_entryCallback(workerIndex, directory.path, findData);
+
+		if (!m_recursive || WI_IsFlagClear(findData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+		{
+			continue;
+		}
+
+		// Subdirectories that are filtered out here are never queued, so nothing within them is
+		// enumerated.
+		int depth = directory.depth + 1;
+
+		if (m_subdirectoryFilter
+			&& !m_subdirectoryFilter(workerIndex, directory.path, findData, depth))
+		{
+			continue;
+		}
+
+		QueueDirectory(workerIndex, { CombinePath(directory.path, findData.cFileName), depth });
+	} while (FindNextFile(findFile.get(), &findData));
+}
+
+void ParallelDirectoryWalker::QueueDirectory(int workerIndex, QueuedDirectory directory)
+{
+	m_pendingDirectories++;
+
+	{
+		auto &queue = *m_queues[workerIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.directories.push_back(std::move(directory));
+	}
+
+	m_queuedDirectories++;
+	m_idleCondition.notify_one();
+}
+
+std::optional<ParallelDirectoryWalker::QueuedDirectory> ParallelDirectoryWalker::TakeDirectory(
+	int workerIndex)
+{
+	if (m_queuedDirectories == 0)
+	{
+		return std::nullopt;
+	}
+
+	for (int i = 0; i < m_numWorkers; i++)
+	{
+		int queueIndex = (workerIndex + i) % m_numWorkers;
+		auto &queue = *m_queues[queueIndex];
+
+		std::lock_guard<std::mutex> lock(queue.mutex);
+
+		if (queue.directories.empty())
+		{
+			continue;
+		}
+
+		QueuedDirectory directory;
+
+		if (queueIndex == workerIndex)
+		{
+			directory = std::move(queue.directories.back());
+			queue.directories.pop_back();
+		}
+		else
+		{
+			directory = std::move(queue.directories.front());
+			queue.directories.pop_front();
+		}
+
+		m_queuedDirectories--;
+
+		return directory;
+	}
+
+	return std::nullopt;
+}
+
+void ParallelDirectoryWalker::OnDirectoryFinished()
+{
+	// Any subdirectories have already been counted, so if this reaches 0, there's nothing left to
+	// enumerate and the idle workers can exit.
+	if (--m_pendingDirectories == 0)
+	{
+		m_idleCondition.notify_all();
+	}
+}
+
+void ParallelDirectoryWalker::Stop()
+{
+	m_stopped = true;
+	m_idleCondition.notify_all();
+}
+
+bool ParallelDirectoryWalker::IsStopped() const
+{
+	return m_stopped;
+}
+
+int ParallelDirectoryWalker::GetNumWorkers() const
+{
+	return m_numWorkers;
+}
@@ -0,0 +1,99 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Enumerates a directory tree using a set of worker threads. Each worker owns a queue of
+// directories that are waiting to be enumerated. A worker takes directories from the back of its
+// own queue (so that it tends to stay in the same part of the tree) and, when its own queue is
+// empty, steals from the front of the other queues (where the directories closest to the root,
+// and therefore likely to contain the most work, are found).
+//
+// The callbacks are invoked concurrently, on the worker threads. Each invocation is passed the
+// index of the calling worker, so that callers can accumulate results in per-worker buffers and
+// merge them once the walk is complete, rather than synchronizing on every entry.
+class ParallelDirectoryWalker
+{
+public:
+	// Invoked before a worker starts enumerating a directory.
+	using DirectoryCallback = std::function<void(int workerIndex, const std::wstring &directory)>;
+
+	// Invoked for each entry (other than "." and "..") found within a directory.
+	using EntryCallback = std::function<void(
+		int workerIndex, const std::wstring &directory, const WIN32_FIND_DATA &findData)>;
+
+	// Invoked for each subdirectory found during a recursive walk. The subdirectory is only
+	// enumerated if this returns true. The depth is that of the subdirectory itself, with the root
+	// directory being at a depth of 0.
+	using SubdirectoryFilter = std::function<bool(int workerIndex, const std::wstring &directory,
+		const WIN32_FIND_DATA &findData, int depth)>;
+
+	explicit ParallelDirectoryWalker(int numWorkers);
+
+	// Walks the tree rooted at the specified directory and returns once every directory has been
+	// enumerated, or once the walk has been stopped. The calling thread acts as one of the
+	// workers. If recursive is false, only the root directory is enumerated.
+	void Walk(const std::wstring &rootDirectory, bool recursive,
+		DirectoryCallback directoryCallback, EntryCallback entryCallback,
+		SubdirectoryFilter subdirectoryFilter = nullptr);
+
+	// Can be called from any thread. Workers check the flag between entries, so the walk will end
+	// shortly afterwards. Once stopped, a walker remains stopped.
+	void Stop();
+	bool IsStopped() const;
+
+	int GetNumWorkers() const;
+
+	static int GetDefaultNumWorkers();
+
+private:
+	struct QueuedDirectory
+	{
+		std::wstring path;
+		int depth;
+	};
+
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<QueuedDirectory> directories;
+	};
+
+	void RunWorker(int workerIndex);
+	void EnumerateDirectory(int workerIndex, const QueuedDirectory &directory);
+	void QueueDirectory(int workerIndex, QueuedDirectory directory);
+	std::optional<QueuedDirectory> TakeDirectory(int workerIndex);
+	void OnDirectoryFinished();
+
+	const int m_numWorkers;
+	std::vector<std::unique_ptr<WorkQueue>> m_queues;
+
+	// The number of directories that have been queued, but not yet fully enumerated. The walk is
+	// complete once this drops to 0.
+	std::atomic<int> m_pendingDirectories;
+
+	// The number of directories currently sitting in one of the queues. Idle workers use this to
+	// determine whether there's anything to steal.
+	std::atomic<int> m_queuedDirectories;
+
+	std::atomic<bool> m_stopped;
+
+	std::mutex m_idleMutex;
+	std::condition_variable m_idleCondition;
+
+	bool m_recursive;
+	DirectoryCallback m_directoryCallback;
+	EntryCallback m_entryCallback;
+	SubdirectoryFilter m_subdirectoryFilter;
+};
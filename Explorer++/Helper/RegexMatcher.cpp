@@ -0,0 +1,1175 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "RegexMatcher.h"
+#include "LiteralPrefilter.h"
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <memory>
+
+namespace
+{
+	using CharacterRanges = std::vector<std::pair<uint32_t, uint32_t>>;
+
+	const uint32_t MAX_CHARACTER = static_cast<uint32_t>(std::numeric_limits<wchar_t>::max());
+	const uint32_t MAX_BMP_CHARACTER = 0xFFFF;
+
+	// These limits keep the cost of compiling a pattern reasonable. A pattern that exceeds the
+	// NFA limits (e.g. through very large repeat counts) is passed on to std::wregex, while a
+	// pattern that exceeds the DFA limits is matched by simulating the NFA.
+	const size_t MAX_NFA_STATES = 10000;
+	const int MAX_REPEAT_COUNT = 1000;
+	const size_t MAX_DFA_CLASSES = 4096;
+	const size_t MAX_DFA_STATES = 1000;
+	const size_t MAX_DFA_TRANSITIONS = 1 << 20;
+
+	void NormalizeRanges(CharacterRanges &ranges)
+	{
+		std::sort(ranges.begin(), ranges.end());
+
+		CharacterRanges merged;
+
+		for (const auto &range : ranges)
+		{
+			if (!merged.empty() && range.first <= merged.back().second + 1)
+			{
+				merged.back().second = std::max(merged.back().second, range.second);
+			}
+			else
+			{
+				merged.push_back(range);
+			}
+		}
+
+		ranges = std::move(merged);
+	}
+
+	// The ranges need to be normalized.
+	CharacterRanges InvertRanges(const CharacterRanges &ranges)
+	{
+		CharacterRanges inverted;
+		uint32_t next = 0;
+
+		for (const auto &[first, last] : ranges)
+		{
+			if (first > next)
+			{
+				inverted.emplace_back(next, first - 1);
+			}
+
+			next = last + 1;
+		}
+
+		if (next <= MAX_CHARACTER)
+		{
+			inverted.emplace_back(next, MAX_CHARACTER);
+		}
+
+		return inverted;
+	}
+
+	// Adds the folded form of each character in the ranges. Since the string being matched is
+	// folded as well, that's all that's needed to make the ranges case-insensitive.
+	void AddFoldedCharacters(CharacterRanges &ranges)
+	{
+		CharacterRanges foldedRanges;
+
+		for (const auto &[first, last] : ranges)
+		{
+			for (uint32_t c = first; c <= std::min(last, MAX_BMP_CHARACTER); c++)
+			{
+				auto folded =
+					static_cast<uint32_t>(LiteralPrefilter::FoldCharacter(static_cast<wchar_t>(c)));
+
+				if (folded != c)
+				{
+					foldedRanges.emplace_back(folded, folded);
+				}
+			}
+		}
+
+		ranges.insert(ranges.end(), foldedRanges.begin(), foldedRanges.end());
+		NormalizeRanges(ranges);
+	}
+
+	// The character classes are built using the same traits that std::wregex uses, so that \d, \w
+	// and \s match exactly the same characters they would there.
+	CharacterRanges BuildClassRanges(const std::wstring &className)
+	{
+		std::regex_traits<wchar_t> traits;
+		auto classMask = traits.lookup_classname(className.begin(), className.end());
+
+		CharacterRanges ranges;
+
+		for (uint32_t c = 0; c <= MAX_BMP_CHARACTER; c++)
+		{
+			if (!traits.isctype(static_cast<wchar_t>(c), classMask))
+			{
+				continue;
+			}
+
+			if (!ranges.empty() && ranges.back().second + 1 == c)
+			{
+				ranges.back().second = c;
+			}
+			else
+			{
+				ranges.emplace_back(c, c);
+			}
+		}
+
+		return ranges;
+	}
+
+	const CharacterRanges &GetClassRanges(wchar_t classEscape)
+	{
+		static const CharacterRanges digitRanges = BuildClassRanges(L"d");
+		static const CharacterRanges wordRanges = BuildClassRanges(L"w");
+		static const CharacterRanges spaceRanges = BuildClassRanges(L"s");
+
+		switch (classEscape)
+		{
+		case 'd':
+			return digitRanges;
+
+		case 'w':
+			return wordRanges;
+
+		default:
+			return spaceRanges;
+		}
+	}
+
+	bool IsAsciiAlphanumeric(wchar_t c)
+	{
+		return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+	}
+
+	std::optional<uint32_t> GetHexDigitValue(wchar_t c)
+	{
+		if (c >= '0' && c <= '9')
+		{
+			return c - '0';
+		}
+		else if (c >= 'a' && c <= 'f')
+		{
+			return c - 'a' + 10;
+		}
+		else if (c >= 'A' && c <= 'F')
+		{
+			return c - 'A' + 10;
+		}
+
+		return std::nullopt;
+	}
+}
+
+class RegexMatcher::Compiler
+{
+public:
+	Compiler(RegexMatcher &matcher, std::wstring_view pattern) :
+		m_matcher(matcher),
+		m_pattern(pattern),
+		m_position(0),
+		m_end(pattern.size()),
+		m_tooLarge(false)
+	{
+	}
+
+	// Returns false if the pattern is invalid, uses syntax that isn't supported, or is too large.
+	bool Compile()
+	{
+		// Since the entire string has to match, anchors at either end of the pattern have no
+		// effect.
+		if (m_end > 0 && m_pattern[0] == '^')
+		{
+			m_position = 1;
+		}
+
+		if (m_end > m_position && m_pattern[m_end - 1] == '$' && !IsEscaped(m_end - 1))
+		{
+			m_end--;
+		}
+
+		auto root = ParseAlternation();
+
+		if (!root || m_position != m_end)
+		{
+			return false;
+		}
+
+		int matchState = AddState(NfaStateType::Match, -1, -1, -1);
+		m_matcher.m_nfaStart = CompileNode(*root, matchState);
+
+		if (m_tooLarge)
+		{
+			return false;
+		}
+
+		std::wstring currentLiteral;
+		CollectRequiredLiterals(*root, currentLiteral);
+		EndLiteral(currentLiteral);
+
+		return true;
+	}
+
+private:
+	struct Node
+	{
+		enum class Type
+		{
+			Character,
+			Concatenation,
+			Alternation,
+			Repetition
+		};
+
+		Type type;
+
+		// For Character nodes. The literal is only set if the node matches a single character
+		// (folded, if the pattern is case-insensitive).
+		int characterSet = -1;
+		std::optional<wchar_t> literal;
+
+		std::vector<std::unique_ptr<Node>> children;
+
+		// For Repetition nodes. A maximum of -1 means there's no upper limit.
+		int minRepeat = 0;
+		int maxRepeat = 0;
+	};
+
+	bool AtEnd() const
+	{
+		return m_position >= m_end;
+	}
+
+	wchar_t Peek() const
+	{
+		return m_pattern[m_position];
+	}
+
+	bool IsEscaped(size_t position) const
+	{
+		size_t numBackslashes = 0;
+
+		while (position > numBackslashes && m_pattern[position - numBackslashes - 1] == '\\')
+		{
+			numBackslashes++;
+		}
+
+		return (numBackslashes % 2) == 1;
+	}
+
+	std::unique_ptr<Node> ParseAlternation()
+	{
+		auto first = ParseConcatenation();
+
+		if (!first || AtEnd() || Peek() != '|')
+		{
+			return first;
+		}
+
+		auto node = std::make_unique<Node>();
+		node->type = Node::Type::Alternation;
+		node->children.push_back(std::move(first));
+
+		while (!AtEnd() && Peek() == '|')
+		{
+			m_position++;
+
+			auto next = ParseConcatenation();
+
+			if (!next)
+			{
+				return nullptr;
+			}
+
+			node->children.push_back(std::move(next));
+		}
+
+		return node;
+	}
+
+	std::unique_ptr<Node> ParseConcatenation()
+	{
+		auto node = std::make_unique<Node>();
+		node->type = Node::Type::Concatenation;
+
+		while (!AtEnd() && Peek() != '|' && Peek() != ')')
+		{
+			auto child = ParseRepetition();
+
+			if (!child)
+			{
+				return nullptr;
+			}
+
+			node->children.push_back(std::move(child));
+		}
+
+		return node;
+	}
+
+	std::unique_ptr<Node> ParseRepetition()
+	{
+		auto atom = ParseAtom();
+
+		if (!atom || AtEnd())
+		{
+			return atom;
+		}
+
+		int minRepeat;
+		int maxRepeat;
+
+		switch (Peek())
+		{
+		case '*':
+			minRepeat = 0;
+			maxRepeat = -1;
+			m_position++;
+			break;
+
+		case '+':
+			minRepeat = 1;
+			maxRepeat = -1;
+			m_position++;
+			break;
+
+		case '?':
+			minRepeat = 0;
+			maxRepeat = 1;
+			m_position++;
+			break;
+
+		case '{':
+			m_position++;
+
+			if (!ParseBraceQuantifier(minRepeat, maxRepeat))
+			{
+				return nullptr;
+			}
+			break;
+
+		default:
+			return atom;
+		}
+
+		// A lazy quantifier matches exactly the same set of strings as a greedy one, so the
+		// distinction doesn't matter when the entire string has to match.
+		if (!AtEnd() && Peek() == '?')
+		{
+			m_position++;
+		}
+
+		auto node = std::make_unique<Node>();
+		node->type = Node::Type::Repetition;
+		node->minRepeat = minRepeat;
+		node->maxRepeat = maxRepeat;
+		node->children.push_back(std::move(atom));
+
+		return node;
+	}
+
+	bool ParseBraceQuantifier(int &minRepeat, int &maxRepeat)
+	{
+		auto min = ParseNumber();
+
+		if (!min)
+		{
+			return false;
+		}
+
+		minRepeat = *min;
+		maxRepeat = *min;
+
+		if (!AtEnd() && Peek() == ',')
+		{
+			m_position++;
+
+			if (!AtEnd() && Peek() == '}')
+			{
+				maxRepeat = -1;
+			}
+			else
+			{
+				auto max = ParseNumber();
+
+				if (!max)
+				{
+					return false;
+				}
+
+				maxRepeat = *max;
+			}
+		}
+
+		if (AtEnd() || Peek() != '}')
+		{
+			return false;
+		}
+
+		m_position++;
+
+		if (maxRepeat != -1 && maxRepeat < minRepeat)
+		{
+			return false;
+		}
+
+		return minRepeat <= MAX_REPEAT_COUNT && maxRepeat <= MAX_REPEAT_COUNT;
+	}
+
+	std::optional<int> ParseNumber()
+	{
+		size_t start = m_position;
+		int value = 0;
+
+		while (!AtEnd() && Peek() >= '0' && Peek() <= '9')
+		{
+			// Anything above the limit is rejected anyway, so there's no need to keep counting.
+			value = std::min(value * 10 + (Peek() - '0'), MAX_REPEAT_COUNT + 1);
+			m_position++;
+		}
+
+		if (m_position == start)
+		{
+			return std::nullopt;
+		}
+
+		return value;
+	}
+
+	std::unique_ptr<Node> ParseAtom()
+	{
+		wchar_t c = m_pattern[m_position++];
+
+		switch (c)
+		{
+		case '(':
+			return ParseGroup();
+
+		case '[':
+			return ParseBracketExpression();
+
+		case '.':
+			return MakeCharacterNode({ { '\n', '\n' }, { '\r', '\r' } }, true, std::nullopt);
+
+		case '\\':
+		{
+			CharacterRanges ranges;
+			std::optional<uint32_t> character;
+
+			if (!ParseEscape(ranges, character))
+			{
+				return nullptr;
+			}
+
+			if (character)
+			{
+				return MakeCharacterNode({ { *character, *character } }, false,
+					static_cast<wchar_t>(*character));
+			}
+
+			return MakeCharacterNode(std::move(ranges), false, std::nullopt);
+		}
+
+		// Anchors anywhere other than the ends of the pattern, quantifiers with nothing to
+		// repeat and stray brackets. Stray brackets are accepted as literals by some
+		// implementations, so they're left to std::wregex as well.
+		case '^':
+		case '$':
+		case '*':
+		case '+':
+		case '?':
+		case '{':
+		case '}':
+		case ']':
+			return nullptr;
+
+		default:
+			return MakeCharacterNode({ { static_cast<uint32_t>(c), static_cast<uint32_t>(c) } },
+				false, c);
+		}
+	}
+
+	std::unique_ptr<Node> ParseGroup()
+	{
+		if (!AtEnd() && Peek() == '?')
+		{
+			// Non-capturing groups are supported, but lookahead assertions aren't.
+			if (m_position + 1 >= m_end || m_pattern[m_position + 1] != ':')
+			{
+				return nullptr;
+			}
+
+			m_position += 2;
+		}
+
+		auto node = ParseAlternation();
+
+		if (!node || AtEnd() || Peek() != ')')
+		{
+			return nullptr;
+		}
+
+		m_position++;
+
+		return node;
+	}
+
+	std::unique_ptr<Node> ParseBracketExpression()
+	{
+		bool invert = false;
+
+		if (!AtEnd() && Peek() == '^')
+		{
+			invert = true;
+			m_position++;
+		}
+
+		CharacterRanges ranges;
+		bool first = true;
+
+		while (true)
+		{
+			if (AtEnd())
+			{
+				return nullptr;
+			}
+
+			if (Peek() == ']')
+			{
+				// Implementations differ in how they treat an empty bracket expression.
+				if (first)
+				{
+					return nullptr;
+				}
+
+				m_position++;
+				break;
+			}
+
+			first = false;
+
+			// POSIX character classes, equivalence classes and collating elements.
+			if (Peek() == '[' && m_position + 1 < m_end
+				&& (m_pattern[m_position + 1] == ':' || m_pattern[m_position + 1] == '='
+					|| m_pattern[m_position + 1] == '.'))
+			{
+				return nullptr;
+			}
+
+			std::optional<uint32_t> start;
+
+			if (!ParseBracketCharacter(ranges, start))
+			{
+				return nullptr;
+			}
+
+			// A class escape (e.g. \d) can't be the start of a range.
+			if (!start)
+			{
+				continue;
+			}
+
+			if (m_position + 1 < m_end && Peek() == '-' && m_pattern[m_position + 1] != ']')
+			{
+				m_position++;
+
+				std::optional<uint32_t> end;
+
+				if (!ParseBracketCharacter(ranges, end) || !end || *end < *start)
+				{
+					return nullptr;
+				}
+
+				ranges.emplace_back(*start, *end);
+			}
+			else
+			{
+				ranges.emplace_back(*start, *start);
+			}
+		}
+
+		return MakeCharacterNode(std::move(ranges), invert, std::nullopt);
+	}
+
+	bool ParseBracketCharacter(CharacterRanges &ranges, std::optional<uint32_t> &character)
+	{
+		wchar_t c = m_pattern[m_position++];
+
+		if (c != '\\')
+		{
+			character = c;
+			return true;
+		}
+
+		return ParseEscape(ranges, character);
+	}
+
+	// Parses the escape following a backslash. A character class escape (e.g. \d) is added to
+	// the ranges, while an escaped character is returned through the character parameter.
+	bool ParseEscape(CharacterRanges &ranges, std::optional<uint32_t> &character)
+	{
+		if (AtEnd())
+		{
+			return false;
+		}
+
+		wchar_t c = m_pattern[m_position++];
+
+		switch (c)
+		{
+		case 'd':
+		case 'w':
+		case 's':
+		{
+			const auto &classRanges = GetClassRanges(c);
+			ranges.insert(ranges.end(), classRanges.begin(), classRanges.end());
+			return true;
+		}
+
+		case 'D':
+		case 'W':
+		case 'S':
+		{
+			auto classRanges = InvertRanges(GetClassRanges(c - 'A' + 'a'));
+			ranges.insert(ranges.end(), classRanges.begin(), classRanges.end());
+			return true;
+		}
+
+		case 't':
+			character = '\t';
+			return true;
+
+		case 'n':
+			character = '\n';
+			return true;
+
+		case 'r':
+			character = '\r';
+			return true;
+
+		case 'f':
+			character = '\f';
+			return true;
+
+		case 'v':
+			character = '\v';
+			return true;
+
+		case 'x':
+			character = ParseHexDigits(2);
+			return character.has_value();
+
+		case 'u':
+			character = ParseHexDigits(4);
+			return character.has_value();
+		}
+
+		// Any other letter or digit is either a backreference or an escape that isn't supported
+		// here (e.g. \b).
+		if (IsAsciiAlphanumeric(c))
+		{
+			return false;
+		}
+
+		character = c;
+		return true;
+	}
+
+	std::optional<uint32_t> ParseHexDigits(int numDigits)
+	{
+		uint32_t value = 0;
+
+		for (int i = 0; i < numDigits; i++)
+		{
+			if (AtEnd())
+			{
+				return std::nullopt;
+			}
+
+			auto digitValue = GetHexDigitValue(m_pattern[m_position++]);
+
+			if (!digitValue)
+			{
+				return std::nullopt;
+			}
+
+			value = (value << 4) | *digitValue;
+		}
+
+		return value;
+	}
+
+	std::unique_ptr<Node> MakeCharacterNode(
+		CharacterRanges ranges, bool invert, std::optional<wchar_t> literal)
+	{
+		NormalizeRanges(ranges);
+
+		// Folding has to happen before the ranges are inverted, so that (for example) [^a]
+		// doesn't match 'A'.
+		if (!m_matcher.m_caseSensitive)
+		{
+			AddFoldedCharacters(ranges);
+
+			if (literal)
+			{
+				literal = LiteralPrefilter::FoldCharacter(*literal);
+			}
+		}
+
+		if (invert)
+		{
+			ranges = InvertRanges(ranges);
+		}
+
+		auto node = std::make_unique<Node>();
+		node->type = Node::Type::Character;
+		node->characterSet = static_cast<int>(m_matcher.m_characterSets.size());
+		node->literal = literal;
+
+		m_matcher.m_characterSets.push_back(std::move(ranges));
+
+		return node;
+	}
+
+	// Builds the NFA for the node, with the node's final state leading to next. The NFA is built
+	// backwards in this way, so that each state's successors already exist when it's created.
+	// Returns the entry state for the node.
+	int CompileNode(const Node &node, int next)
+	{
+		if (m_tooLarge)
+		{
+			return next;
+		}
+
+		switch (node.type)
+		{
+		case Node::Type::Character:
+			return AddState(NfaStateType::Character, node.characterSet, next, -1);
+
+		case Node::Type::Concatenation:
+			for (auto itr = node.children.rbegin(); itr != node.children.rend(); ++itr)
+			{
+				next = CompileNode(**itr, next);
+			}
+
+			return next;
+
+		case Node::Type::Alternation:
+		{
+			int start = CompileNode(*node.children.back(), next);
+
+			for (size_t i = node.children.size() - 1; i-- > 0;)
+			{
+				start = AddState(
+					NfaStateType::Split, -1, CompileNode(*node.children[i], next), start);
+			}
+
+			return start;
+		}
+
+		case Node::Type::Repetition:
+		{
+			const auto &child = *node.children[0];
+			int start = next;
+
+			if (node.maxRepeat == -1)
+			{
+				int loop = AddState(NfaStateType::Split, -1, -1, next);
+				int body = CompileNode(child, loop);
+
+				if (m_tooLarge)
+				{
+					return next;
+				}
+
+				m_matcher.m_nfaStates[loop].out1 = body;
+				start = loop;
+			}
+			else
+			{
+				for (int i = node.minRepeat; i < node.maxRepeat; i++)
+				{
+					int body = CompileNode(child, start);
+					start = AddState(NfaStateType::Split, -1, body, start);
+				}
+			}
+
+			for (int i = 0; i < node.minRepeat; i++)
+			{
+				start = CompileNode(child, start);
+			}
+
+			return start;
+		}
+		}
+
+		return next;
+	}
+
+	int AddState(NfaStateType type, int characterSet, int out1, int out2)
+	{
+		auto &states = m_matcher.m_nfaStates;
+
+		if (states.size() >= MAX_NFA_STATES)
+		{
+			m_tooLarge = true;
+			return 0;
+		}
+
+		states.push_back({ type, characterSet, out1, out2 });
+
+		return static_cast<int>(states.size() - 1);
+	}
+
+	// Only a sequence of literal characters that's guaranteed to appear in every match becomes
+	// a required literal. Anything optional or variable ends the current literal.
+	void CollectRequiredLiterals(const Node &node, std::wstring &currentLiteral)
+	{
+		switch (node.type)
+		{
+		case Node::Type::Character:
+			if (node.literal)
+			{
+				currentLiteral += *node.literal;
+				return;
+			}
+			break;
+
+		case Node::Type::Concatenation:
+			for (const auto &child : node.children)
+			{
+				CollectRequiredLiterals(*child, currentLiteral);
+			}
+			return;
+
+		case Node::Type::Repetition:
+			if (node.minRepeat > 0)
+			{
+				// The repeated item has to appear at least once, though what's on either side of
+				// it depends on how many times it's repeated.
+				EndLiteral(currentLiteral);
+				CollectRequiredLiterals(*node.children[0], currentLiteral);
+			}
+			break;
+
+		case Node::Type::Alternation:
+			break;
+		}
+
+		EndLiteral(currentLiteral);
+	}
+
+	void EndLiteral(std::wstring &currentLiteral)
+	{
+		if (!currentLiteral.empty())
+		{
+			m_matcher.m_requiredLiterals.push_back(currentLiteral);
+			currentLiteral.clear();
+		}
+	}
+
+	RegexMatcher &m_matcher;
+	std::wstring_view m_pattern;
+	size_t m_position;
+	size_t m_end;
+	bool m_tooLarge;
+};
+
+RegexMatcher::RegexMatcher(std::wstring_view pattern, bool caseSensitive) :
+	m_caseSensitive(caseSensitive),
+	m_nfaStart(0),
+	m_asciiClasses(),
+	m_numClasses(0)
+{
+	Compiler compiler(*this, pattern);
+
+	if (!compiler.Compile())
+	{
+		m_requiredLiterals.clear();
+		m_characterSets.clear();
+		m_nfaStates.clear();
+
+		auto flags = std::regex_constants::ECMAScript;
+
+		if (!caseSensitive)
+		{
+			flags |= std::regex_constants::icase;
+		}
+
+		m_fallbackRegex.emplace(std::wstring(pattern), flags);
+
+		return;
+	}
+
+	BuildDfa();
+}
+
+void RegexMatcher::BuildDfa()
+{
+	for (const auto &ranges : m_characterSets)
+	{
+		for (const auto &[first, last] : ranges)
+		{
+			m_classBoundaries.push_back(first);
+
+			if (last < MAX_CHARACTER)
+			{
+				m_classBoundaries.push_back(last + 1);
+			}
+		}
+	}
+
+	std::sort(m_classBoundaries.begin(), m_classBoundaries.end());
+	m_classBoundaries.erase(
+		std::unique(m_classBoundaries.begin(), m_classBoundaries.end()), m_classBoundaries.end());
+
+	// The first class always starts at 0.
+	if (!m_classBoundaries.empty() && m_classBoundaries[0] == 0)
+	{
+		m_classBoundaries.erase(m_classBoundaries.begin());
+	}
+
+	m_numClasses = m_classBoundaries.size() + 1;
+
+	if (m_numClasses > MAX_DFA_CLASSES)
+	{
+		return;
+	}
+
+	for (uint32_t c = 0; c < m_asciiClasses.size(); c++)
+	{
+		m_asciiClasses[c] = static_cast<uint16_t>(
+			std::upper_bound(m_classBoundaries.begin(), m_classBoundaries.end(), c)
+			- m_classBoundaries.begin());
+	}
+
+	// Every character in a class behaves identically, so the first character of each class can
+	// stand in for the rest of the class.
+	std::vector<uint32_t> representatives = { 0 };
+	representatives.insert(
+		representatives.end(), m_classBoundaries.begin(), m_classBoundaries.end());
+
+	ClosureState closureState;
+	closureState.marks.resize(m_nfaStates.size());
+
+	std::vector<int> startStates;
+	closureState.generation++;
+	AddClosure(m_nfaStart, startStates, closureState);
+	std::sort(startStates.begin(), startStates.end());
+
+	std::map<std::vector<int>, int> dfaStateIds;
+	std::vector<std::vector<int>> dfaStates;
+
+	dfaStateIds.emplace(startStates, 0);
+	dfaStates.push_back(startStates);
+
+	for (size_t i = 0; i < dfaStates.size(); i++)
+	{
+		auto currentStates = dfaStates[i];
+
+		for (size_t classIndex = 0; classIndex < m_numClasses; classIndex++)
+		{
+			std::vector<int> nextStates;
+			closureState.generation++;
+
+			for (int state : currentStates)
+			{
+				const auto &nfaState = m_nfaStates[state];
+
+				if (nfaState.type == NfaStateType::Character
+					&& ContainsCharacter(
+						m_characterSets[nfaState.characterSet], representatives[classIndex]))
+				{
+					AddClosure(nfaState.out1, nextStates, closureState);
+				}
+			}
+
+			if (nextStates.empty())
+			{
+				m_dfaTransitions.push_back(DEAD_STATE);
+				continue;
+			}
+
+			std::sort(nextStates.begin(), nextStates.end());
+
+			auto [itr, inserted] =
+				dfaStateIds.emplace(std::move(nextStates), static_cast<int>(dfaStates.size()));
+
+			if (inserted)
+			{
+				if (dfaStates.size() >= MAX_DFA_STATES
+					|| (dfaStates.size() + 1) * m_numClasses > MAX_DFA_TRANSITIONS)
+				{
+					m_dfaTransitions.clear();
+					m_dfaAcceptingStates.clear();
+					return;
+				}
+
+				dfaStates.push_back(itr->first);
+			}
+
+			m_dfaTransitions.push_back(itr->second);
+		}
+
+		m_dfaAcceptingStates.push_back(
+			std::any_of(currentStates.begin(), currentStates.end(), [this](int state) {
+				return m_nfaStates[state].type == NfaStateType::Match;
+			}));
+	}
+}
+
+// Adds the state to the set, following any split states. Only states that consume a character
+// (and the match state) end up in the set.
+void RegexMatcher::AddClosure(int state, std::vector<int> &states, ClosureState &closureState) const
+{
+	auto &stack = closureState.stack;
+	stack.push_back(state);
+
+	while (!stack.empty())
+	{
+		int current = stack.back();
+		stack.pop_back();
+
+		if (current == -1 || closureState.marks[current] == closureState.generation)
+		{
+			continue;
+		}
+
+		closureState.marks[current] = closureState.generation;
+
+		const auto &nfaState = m_nfaStates[current];
+
+		if (nfaState.type == NfaStateType::Split)
+		{
+			stack.push_back(nfaState.out2);
+			stack.push_back(nfaState.out1);
+		}
+		else
+		{
+			states.push_back(current);
+		}
+	}
+}
+
+size_t RegexMatcher::GetCharacterClass(uint32_t c) const
+{
+	if (c < m_asciiClasses.size())
+	{
+		return m_asciiClasses[c];
+	}
+
+	return std::upper_bound(m_classBoundaries.begin(), m_classBoundaries.end(), c)
+		- m_classBoundaries.begin();
+}
+
+bool RegexMatcher::ContainsCharacter(const CharacterRanges &ranges, uint32_t c)
+{
+	auto itr = std::upper_bound(ranges.begin(), ranges.end(), c,
+		[](uint32_t value, const auto &range) { return value < range.first; });
+
+	if (itr == ranges.begin())
+	{
+		return false;
+	}
+
+	return c <= std::prev(itr)->second;
+}
+
+uint32_t RegexMatcher::TranslateCharacter(wchar_t c) const
+{
+	if (m_caseSensitive)
+	{
+		return static_cast<uint32_t>(c);
+	}
+
+	return static_cast<uint32_t>(LiteralPrefilter::FoldCharacter(c));
+}
+
+bool RegexMatcher::Match(std::wstring_view str) const
+{
+	if (m_fallbackRegex)
+	{
+		return std::regex_match(str.begin(), str.end(), *m_fallbackRegex);
+	}
+
+	if (m_dfaAcceptingStates.empty())
+	{
+		return MatchNfa(str);
+	}
+
+	return MatchDfa(str);
+}
+
+bool RegexMatcher::MatchDfa(std::wstring_view str) const
+{
+	int state = 0;
+
+	for (wchar_t c : str)
+	{
+		state = m_dfaTransitions[state * m_numClasses + GetCharacterClass(TranslateCharacter(c))];
+
+		if (state == DEAD_STATE)
+		{
+			return false;
+		}
+	}
+
+	return m_dfaAcceptingStates[state];
+}
+
+bool RegexMatcher::MatchNfa(std::wstring_view str) const
+{
+	ClosureState closureState;
+	closureState.marks.resize(m_nfaStates.size());
+
+	std::vector<int> currentStates;
+	std::vector<int> nextStates;
+
+	closureState.generation++;
+	AddClosure(m_nfaStart, currentStates, closureState);
+
+	for (wchar_t c : str)
+	{
+		uint32_t translated = TranslateCharacter(c);
+
+		nextStates.clear();
+		closureState.generation++;
+
+		for (int state : currentStates)
+		{
+			const auto &nfaState = m_nfaStates[state];
+
+			if (nfaState.type == NfaStateType::Character
+				&& ContainsCharacter(m_characterSets[nfaState.characterSet], translated))
+			{
+				AddClosure(nfaState.out1, nextStates, closureState);
+			}
+		}
+
+		currentStates.swap(nextStates);
+
+		if (currentStates.empty())
+		{
+			return false;
+		}
+	}
+
+	return std::any_of(currentStates.begin(), currentStates.end(),
+		[this](int state) { return m_nfaStates[state].type == NfaStateType::Match; });
+}
+
+std::vector<std::wstring> RegexMatcher::GetRequiredLiterals() const
+{
+	return m_requiredLiterals;
+}
+
+bool RegexMatcher::IsCompiled() const
+{
+	return !m_fallbackRegex.has_value();
+}
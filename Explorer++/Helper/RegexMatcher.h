@@ -0,0 +1,108 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "FilenameMatcher.h"
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Matches strings against an ECMAScript regular expression. As with std::regex_match, the entire
+// string has to match.
+//
+// Patterns are compiled to a DFA, so a match never backtracks and its cost is linear in the
+// length of the string. The DFA is built in full up front, so that Match() only ever reads it.
+// Patterns whose DFA would be too large are matched by simulating the underlying NFA instead,
+// which is still linear, just slower.
+//
+// The commonly used subset of the syntax is supported: literals, '.', bracket expressions
+// (including \d, \w and \s), groups, alternation and each of the quantifiers, along with '^' and
+// '$' at the very start and end of the pattern. Anything else (e.g. backreferences, lookahead or
+// word boundaries) causes the pattern to be matched with std::wregex instead.
+class RegexMatcher : public FilenameMatcher
+{
+public:
+	// Throws std::regex_error if the pattern isn't a valid regular expression.
+	RegexMatcher(std::wstring_view pattern, bool caseSensitive);
+
+	bool Match(std::wstring_view str) const override;
+	std::vector<std::wstring> GetRequiredLiterals() const override;
+
+	// Indicates whether the pattern was compiled by this class (rather than falling back to
+	// std::wregex).
+	bool IsCompiled() const;
+
+private:
+	// Inclusive ranges of characters, sorted and non-overlapping.
+	using CharacterRanges = std::vector<std::pair<uint32_t, uint32_t>>;
+
+	enum class NfaStateType
+	{
+		// Consumes a single character from the character set and moves to out1.
+		Character,
+
+		// Moves to both out1 and out2, without consuming anything.
+		Split,
+
+		Match
+	};
+
+	struct NfaState
+	{
+		NfaStateType type;
+		int characterSet;
+		int out1;
+		int out2;
+	};
+
+	// Scratch space used while following the split states reachable from a set of NFA states.
+	struct ClosureState
+	{
+		std::vector<uint32_t> marks;
+		uint32_t generation = 0;
+		std::vector<int> stack;
+	};
+
+	static constexpr int DEAD_STATE = -1;
+
+	// Parses the pattern and builds the NFA.
+	class Compiler;
+
+	void BuildDfa();
+	void AddClosure(int state, std::vector<int> &states, ClosureState &closureState) const;
+	size_t GetCharacterClass(uint32_t c) const;
+	static bool ContainsCharacter(const CharacterRanges &ranges, uint32_t c);
+
+	bool MatchDfa(std::wstring_view str) const;
+	bool MatchNfa(std::wstring_view str) const;
+	uint32_t TranslateCharacter(wchar_t c) const;
+
+	bool m_caseSensitive;
+	std::vector<std::wstring> m_requiredLiterals;
+
+	std::vector<CharacterRanges> m_characterSets;
+	std::vector<NfaState> m_nfaStates;
+	int m_nfaStart;
+
+	// Characters are partitioned into classes, such that every character in a class belongs to
+	// exactly the same character sets. The DFA then only needs a transition for each class.
+	// Each entry here is the first character of a class (other than the first class, which
+	// starts at 0).
+	std::vector<uint32_t> m_classBoundaries;
+	std::array<uint16_t, 128> m_asciiClasses;
+
+	// The DFA, with numClasses transitions for each state. The start state is state 0. If the DFA
+	// would have been too large, there are no states and the NFA is used instead.
+	size_t m_numClasses;
+	std::vector<int> m_dfaTransitions;
+	std::vector<bool> m_dfaAcceptingStates;
+
+	std::optional<std::wregex> m_fallbackRegex;
+};
@@ -0,0 +1,205 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "RenamePlan.h"
+#include <algorithm>
+#include <unordered_map>
+
+RenamePlan::RenamePlan(const std::vector<Rename> &renames, const PathExistsFunction &pathExists)
+{
+	std::vector<std::wstring> oldKeys;
+	std::vector<std::wstring> newKeys;
+	std::vector<bool> accepted(renames.size(), false);
+	std::unordered_map<std::wstring, size_t> sources;
+	std::unordered_set<std::wstring> usedKeys;
+	std::unordered_set<std::wstring> duplicateSources;
+
+	for (size_t i = 0; i < renames.size(); i++)
+	{
+		oldKeys.push_back(GetKey(renames[i].oldPath));
+		newKeys.push_back(GetKey(renames[i].newPath));
+
+		usedKeys.insert(oldKeys[i]);
+		usedKeys.insert(newKeys[i]);
+
+		if (renames[i].oldPath == renames[i].newPath)
+		{
+			continue;
+		}
+
+		if (!sources.try_emplace(oldKeys[i], i).second)
+		{
+			duplicateSources.insert(oldKeys[i]);
+			m_rejectedRenames.push_back(i);
+			continue;
+		}
+
+		accepted[i] = true;
+	}
+
+	// If the same item is listed more than once, it's not clear what it should be renamed to, so
+	// it's not renamed at all.
+	for (const auto &duplicateSource : duplicateSources)
+	{
+		size_t index = sources[duplicateSource];
+		accepted[index] = false;
+		m_rejectedRenames.push_back(index);
+	}
+
+	// If two items would end up with the same name, neither is renamed.
+	std::unordered_map<std::wstring, std::vector<size_t>> targets;
+
+	for (size_t i = 0; i < renames.size(); i++)
+	{
+		if (accepted[i])
+		{
+			targets[newKeys[i]].push_back(i);
+		}
+	}
+
+	for (const auto &target : targets)
+	{
+		if (target.second.size() > 1)
+		{
+			for (size_t index : target.second)
+			{
+				accepted[index] = false;
+				m_rejectedRenames.push_back(index);
+			}
+		}
+	}
+
+	// Each item can only be renamed once the item currently holding its new name (its successor)
+	// has been renamed. Since the new names are unique, each item also has at most one
+	// predecessor.
+	std::vector<size_t> successors(renames.size(), NO_RENAME);
+	std::vector<size_t> predecessors(renames.size(), NO_RENAME);
+
+	for (size_t i = 0; i < renames.size(); i++)
+	{
+		// A change that only affects the case of the name doesn't depend on anything else.
+		if (!accepted[i] || newKeys[i] == oldKeys[i])
+		{
+			continue;
+		}
+
+		auto itr = sources.find(newKeys[i]);
+
+		if (itr == sources.end())
+		{
+			if (pathExists(renames[i].newPath))
+			{
+				accepted[i] = false;
+				m_rejectedRenames.push_back(i);
+			}
+
+			continue;
+		}
+
+		successors[i] = itr->second;
+		predecessors[itr->second] = i;
+	}
+
+	// An item whose successor isn't going to be renamed can't be renamed either. That in turn
+	// rules out its own predecessor, and so on, back along the chain.
+	for (size_t i = 0; i < renames.size(); i++)
+	{
+		auto itr = sources.find(oldKeys[i]);
+
+		if (accepted[i] || itr == sources.end() || itr->second != i)
+		{
+			continue;
+		}
+
+		for (size_t predecessor = predecessors[i];
+			 predecessor != NO_RENAME && accepted[predecessor];
+			 predecessor = predecessors[predecessor])
+		{
+			accepted[predecessor] = false;
+			m_rejectedRenames.push_back(predecessor);
+		}
+	}
+
+	std::sort(m_rejectedRenames.begin(), m_rejectedRenames.end());
+
+	std::vector<bool> planned(renames.size(), false);
+
+	// Once an item has been renamed, its predecessor can be renamed, followed by that item's
+	// predecessor, and so on.
+	auto planChain = [&](size_t index) {
+		for (; index != NO_RENAME && !planned[index]; index = predecessors[index])
+		{
+			m_steps.push_back({ index, renames[index].oldPath, renames[index].newPath });
+			planned[index] = true;
+		}
+	};
+
+	for (size_t i = 0; i < renames.size(); i++)
+	{
+		if (accepted[i] && successors[i] == NO_RENAME)
+		{
+			planChain(i);
+		}
+	}
+
+	// Every chain that ends in an item without a successor has now been planned. Since no item
+	// has more than one predecessor, nothing can lead into a cycle, so anything remaining is part
+	// of a cycle. Moving one item out of the way allows the rest of the cycle to be renamed.
+	for (size_t i = 0; i < renames.size(); i++)
+	{
+		if (!accepted[i] || planned[i])
+		{
+			continue;
+		}
+
+		std::wstring temporaryPath = GetTemporaryPath(renames[i].oldPath, pathExists, usedKeys);
+		usedKeys.insert(GetKey(temporaryPath));
+
+		m_steps.push_back({ i, renames[i].oldPath, temporaryPath });
+		planned[i] = true;
+
+		planChain(predecessors[i]);
+
+		m_finalSteps.push_back({ i, temporaryPath, renames[i].newPath });
+	}
+}
+
+const std::vector<RenamePlan::Step> &RenamePlan::GetSteps() const
+{
+	return m_steps;
+}
+
+const std::vector<RenamePlan::Step> &RenamePlan::GetFinalSteps() const
+{
+	return m_finalSteps;
+}
+
+const std::vector<size_t> &RenamePlan::GetRejectedRenames() const
+{
+	return m_rejectedRenames;
+}
+
+std::wstring RenamePlan::GetKey(const std::wstring &path)
+{
+	std::wstring key = path;
+	CharLowerBuff(key.data(), static_cast<DWORD>(key.size()));
+	return key;
+}
+
+// The temporary item is placed in the same folder as the original, since a rename can't move an
+// item to a different folder.
+std::wstring RenamePlan::GetTemporaryPath(const std::wstring &path,
+	const PathExistsFunction &pathExists, const std::unordered_set<std::wstring> &usedKeys)
+{
+	while (true)
+	{
+		std::wstring temporaryPath = path + L"~" + std::to_wstring(m_nextTemporaryId++) + L".tmp";
+
+		if (usedKeys.count(GetKey(temporaryPath)) == 0 && !pathExists(temporaryPath))
+		{
+			return temporaryPath;
+		}
+	}
+}
@@ -0,0 +1,68 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Works out how a set of renames can be performed, before any of them are actually carried out.
+//
+// Renames that would collide (either with each other, or with an existing item that isn't itself
+// being renamed) are rejected. The remaining renames are ordered so that each item is only
+// renamed once any item currently holding its new name has been moved out of the way. Renames
+// that form a cycle (e.g. A -> B and B -> A) can't be ordered in that way, so one item in each
+// cycle is first moved to a temporary name, then moved to its final name once the rest of the
+// cycle has been renamed.
+//
+// All paths are compared case-insensitively.
+class RenamePlan
+{
+public:
+	struct Rename
+	{
+		std::wstring oldPath;
+		std::wstring newPath;
+	};
+
+	struct Step
+	{
+		// The index of the rename (within the list passed in) that this step is part of.
+		size_t renameIndex;
+
+		std::wstring oldPath;
+		std::wstring newPath;
+	};
+
+	using PathExistsFunction = std::function<bool(const std::wstring &path)>;
+
+	RenamePlan(const std::vector<Rename> &renames, const PathExistsFunction &pathExists);
+
+	// The steps that can be performed straight away, in the order in which they need to be
+	// performed.
+	const std::vector<Step> &GetSteps() const;
+
+	// Moves each temporary item to its final name. These steps can only be performed once all of
+	// the steps above have been.
+	const std::vector<Step> &GetFinalSteps() const;
+
+	// The indexes of the renames that were rejected, in ascending order. Renames that wouldn't
+	// change the path at all are neither rejected nor included in any of the steps.
+	const std::vector<size_t> &GetRejectedRenames() const;
+
+private:
+	static constexpr size_t NO_RENAME = static_cast<size_t>(-1);
+
+	static std::wstring GetKey(const std::wstring &path);
+
+	std::wstring GetTemporaryPath(const std::wstring &path, const PathExistsFunction &pathExists,
+		const std::unordered_set<std::wstring> &usedKeys);
+
+	std::vector<Step> m_steps;
+	std::vector<Step> m_finalSteps;
+	std::vector<size_t> m_rejectedRenames;
+	unsigned int m_nextTemporaryId = 0;
+};
@@ -0,0 +1,529 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "SearchFilter.h"
+#include "TimeHelper.h"
+#include <wil/common.h>
+#include <algorithm>
+#include <cwctype>
+
+namespace
+{
+	enum class Comparison
+	{
+		Less,
+		LessOrEqual,
+		Equal,
+		GreaterOrEqual,
+		Greater
+	};
+
+	struct Unit
+	{
+		std::wstring_view name;
+		ULONGLONG multiplier;
+	};
+
+	const ULONGLONG TICKS_PER_HOUR = 60 * 60 * 10'000'000ULL;
+	const ULONGLONG TICKS_PER_DAY = 24 * TICKS_PER_HOUR;
+
+	// Tracks the things about the terms seen so far that affect how the filter as a whole is
+	// built.
+	struct ParseState
+	{
+		bool negatedSizeTerm = false;
+		bool foldersRequested = false;
+	};
+
+	const Unit SIZE_UNITS[] = { { L"b", 1ULL }, { L"kb", 1ULL << 10 }, { L"mb", 1ULL << 20 },
+		{ L"gb", 1ULL << 30 }, { L"tb", 1ULL << 40 } };
+
+	const Unit AGE_UNITS[] = { { L"h", TICKS_PER_HOUR }, { L"d", TICKS_PER_DAY },
+		{ L"w", 7 * TICKS_PER_DAY }, { L"m", 30 * TICKS_PER_DAY }, { L"y", 365 * TICKS_PER_DAY } };
+
+	// Splits the text on whitespace, except where the whitespace appears within double quotes.
+	// The quotes themselves are removed.
+	std::vector<std::wstring> SplitTerms(std::wstring_view text)
+	{
+		std::vector<std::wstring> terms;
+		std::wstring currentTerm;
+		bool inQuotes = false;
+
+		for (wchar_t c : text)
+		{
+			if (c == '"')
+			{
+				inQuotes = !inQuotes;
+			}
+			else if (std::iswspace(c) && !inQuotes)
+			{
+				if (!currentTerm.empty())
+				{
+					terms.push_back(std::move(currentTerm));
+					currentTerm.clear();
+				}
+			}
+			else
+			{
+				currentTerm.push_back(c);
+			}
+		}
+
+		if (!currentTerm.empty())
+		{
+			terms.push_back(std::move(currentTerm));
+		}
+
+		return terms;
+	}
+
+	std::wstring ToLower(std::wstring_view text)
+	{
+		std::wstring lower(text);
+		std::transform(lower.begin(), lower.end(), lower.begin(),
+			[](wchar_t c) { return static_cast<wchar_t>(std::towlower(c)); });
+		return lower;
+	}
+
+	// Removes the leading comparison operator (if any) from the value.
+	Comparison ParseComparison(std::wstring_view &value)
+	{
+		const std::pair<std::wstring_view, Comparison> operators[] = {
+			{ L">=", Comparison::GreaterOrEqual }, { L"<=", Comparison::LessOrEqual },
+			{ L">", Comparison::Greater }, { L"<", Comparison::Less }, { L"=", Comparison::Equal }
+		};
+
+		for (const auto &[text, comparison] : operators)
+		{
+			if (value.substr(0, text.size()) == text)
+			{
+				value.remove_prefix(text.size());
+				return comparison;
+			}
+		}
+
+		return Comparison::Equal;
+	}
+
+	// Parses a number (which may contain a fractional part), followed by one of the units. The
+	// default unit is used if no unit is given.
+	std::optional<ULONGLONG> ParseQuantity(
+		std::wstring_view value, const Unit *units, size_t numUnits, ULONGLONG defaultMultiplier)
+	{
+		size_t numberEnd = 0;
+		bool seenDecimalPoint = false;
+
+		while (numberEnd < value.size()
+			&& (std::iswdigit(value[numberEnd]) || (value[numberEnd] == '.' && !seenDecimalPoint)))
+		{
+			seenDecimalPoint |= (value[numberEnd] == '.');
+			numberEnd++;
+		}
+
+		std::wstring number(value.substr(0, numberEnd));
+
+		if (number.empty() || number == L".")
+		{
+			return std::nullopt;
+		}
+
+		std::wstring_view unit = value.substr(numberEnd);
+		ULONGLONG multiplier = defaultMultiplier;
+
+		if (!unit.empty())
+		{
+			auto *end = units + numUnits;
+			auto *match =
+				std::find_if(units, end, [unit](const Unit &entry) { return entry.name == unit; });
+
+			if (match == end)
+			{
+				return std::nullopt;
+			}
+
+			multiplier = match->multiplier;
+		}
+
+		double quantity = std::wcstod(number.c_str(), nullptr) * static_cast<double>(multiplier);
+
+		// Anything this large can't be represented and isn't a meaningful size or age anyway.
+		if (quantity >= 1e19)
+		{
+			return std::nullopt;
+		}
+
+		return static_cast<ULONGLONG>(quantity);
+	}
+
+	std::unique_ptr<SearchPredicate> ParseSizeTerm(std::wstring_view value)
+	{
+		Comparison comparison = ParseComparison(value);
+		auto size = ParseQuantity(value, SIZE_UNITS, std::size(SIZE_UNITS), 1);
+
+		if (!size)
+		{
+			return nullptr;
+		}
+
+		std::optional<ULONGLONG> minSize;
+		std::optional<ULONGLONG> maxSize;
+
+		switch (comparison)
+		{
+		case Comparison::Less:
+			if (*size == 0)
+			{
+				return nullptr;
+			}
+
+			maxSize = *size - 1;
+			break;
+
+		case Comparison::LessOrEqual:
+			maxSize = *size;
+			break;
+
+		case Comparison::Equal:
+			minSize = *size;
+			maxSize = *size;
+			break;
+
+		case Comparison::GreaterOrEqual:
+			minSize = *size;
+			break;
+
+		case Comparison::Greater:
+			minSize = *size + 1;
+			break;
+		}
+
+		return std::make_unique<SizePredicate>(minSize, maxSize);
+	}
+
+	// Parses a date of the form YYYY-MM-DD and returns the time at which the (local) day starts.
+	std::optional<ULONGLONG> ParseDate(std::wstring_view value)
+	{
+		if (value.size() != 10 || value[4] != '-' || value[7] != '-')
+		{
+			return std::nullopt;
+		}
+
+		auto parseField = [value](size_t start, size_t length) -> std::optional<WORD> {
+			WORD field = 0;
+
+			for (wchar_t c : value.substr(start, length))
+			{
+				if (!std::iswdigit(c))
+				{
+					return std::nullopt;
+				}
+
+				field = static_cast<WORD>(field * 10 + (c - '0'));
+			}
+
+			return field;
+		};
+
+		auto year = parseField(0, 4);
+		auto month = parseField(5, 2);
+		auto day = parseField(8, 2);
+
+		if (!year || !month || !day)
+		{
+			return std::nullopt;
+		}
+
+		SYSTEMTIME localTime = {};
+		localTime.wYear = *year;
+		localTime.wMonth = *month;
+		localTime.wDay = *day;
+
+		// This will fail for a date that doesn't exist (e.g. 2023-02-30).
+		FILETIME fileTime;
+
+		if (!LocalSystemTimeToFileTime(&localTime, &fileTime))
+		{
+			return std::nullopt;
+		}
+
+		return SearchEntry::FileTimeToTicks(fileTime);
+	}
+
+	// Returns the time at which the (local) day following the one that starts at dayStart starts.
+	// A local day isn't always 24 hours long (it can be shorter or longer on the days that
+	// daylight saving time starts or ends), so the start of the next day has to be determined by
+	// converting back to local time.
+	std::optional<ULONGLONG> GetNextDayStart(ULONGLONG dayStart)
+	{
+		// Every local day is between 23 and 25 hours long, so this will always be somewhere in
+		// the middle of the next day.
+		ULONGLONG middleOfNextDay = dayStart + TICKS_PER_DAY + 12 * TICKS_PER_HOUR;
+
+		FILETIME fileTime;
+		fileTime.dwLowDateTime = static_cast<DWORD>(middleOfNextDay);
+		fileTime.dwHighDateTime = static_cast<DWORD>(middleOfNextDay >> 32);
+
+		SYSTEMTIME localTime;
+
+		if (!FileTimeToLocalSystemTime(&fileTime, &localTime))
+		{
+			return std::nullopt;
+		}
+
+		localTime.wHour = 0;
+		localTime.wMinute = 0;
+		localTime.wSecond = 0;
+		localTime.wMilliseconds = 0;
+
+		if (!LocalSystemTimeToFileTime(&localTime, &fileTime))
+		{
+			return std::nullopt;
+		}
+
+		return SearchEntry::FileTimeToTicks(fileTime);
+	}
+
+	std::unique_ptr<SearchPredicate> ParseModifiedTerm(
+		std::wstring_view value, ULONGLONG currentTime)
+	{
+		Comparison comparison = ParseComparison(value);
+		std::optional<ULONGLONG> earliest;
+		std::optional<ULONGLONG> latest;
+
+		if (auto dayStart = ParseDate(value))
+		{
+			auto nextDayStart = GetNextDayStart(*dayStart);
+
+			if (!nextDayStart)
+			{
+				return nullptr;
+			}
+
+			ULONGLONG dayEnd = *nextDayStart - 1;
+
+			switch (comparison)
+			{
+			case Comparison::Less:
+				latest = *dayStart - 1;
+				break;
+
+			case Comparison::LessOrEqual:
+				latest = dayEnd;
+				break;
+
+			case Comparison::Equal:
+				earliest = *dayStart;
+				latest = dayEnd;
+				break;
+
+			case Comparison::GreaterOrEqual:
+				earliest = *dayStart;
+				break;
+
+			case Comparison::Greater:
+				earliest = dayEnd + 1;
+				break;
+			}
+
+			return std::make_unique<DatePredicate>(earliest, latest);
+		}
+
+		auto age = ParseQuantity(value, AGE_UNITS, std::size(AGE_UNITS), TICKS_PER_DAY);
+
+		// An age is only ever approximate, so there's no sensible way of matching it exactly.
+		if (!age || comparison == Comparison::Equal)
+		{
+			return nullptr;
+		}
+
+		ULONGLONG threshold = currentTime - std::min(*age, currentTime);
+
+		// A smaller age means a more recent modification time.
+		if (comparison == Comparison::Less || comparison == Comparison::LessOrEqual)
+		{
+			earliest = threshold;
+		}
+		else
+		{
+			latest = threshold;
+		}
+
+		return std::make_unique<DatePredicate>(earliest, latest);
+	}
+
+	std::unique_ptr<AttributePredicate> ParseAttributeTerm(std::wstring_view value)
+	{
+		const std::pair<wchar_t, DWORD> attributes[] = { { 'a', FILE_ATTRIBUTE_ARCHIVE },
+			{ 'c', FILE_ATTRIBUTE_COMPRESSED }, { 'd', FILE_ATTRIBUTE_DIRECTORY },
+			{ 'e', FILE_ATTRIBUTE_ENCRYPTED }, { 'h', FILE_ATTRIBUTE_HIDDEN },
+			{ 'r', FILE_ATTRIBUTE_READONLY }, { 's', FILE_ATTRIBUTE_SYSTEM } };
+
+		DWORD requiredAttributes = 0;
+		DWORD excludedAttributes = 0;
+		bool required = true;
+		bool seenAttribute = false;
+
+		for (wchar_t c : value)
+		{
+			if (c == '+' || c == '-')
+			{
+				required = (c == '+');
+				continue;
+			}
+
+			auto itr = std::find_if(std::begin(attributes), std::end(attributes),
+				[c](const auto &attribute) { return attribute.first == c; });
+
+			if (itr == std::end(attributes))
+			{
+				return nullptr;
+			}
+
+			(required ? requiredAttributes : excludedAttributes) |= itr->second;
+			seenAttribute = true;
+		}
+
+		if (!seenAttribute || (requiredAttributes & excludedAttributes) != 0)
+		{
+			return nullptr;
+		}
+
+		return std::make_unique<AttributePredicate>(requiredAttributes, excludedAttributes);
+	}
+
+	std::optional<int> ParseDepth(std::wstring_view value)
+	{
+		if (value.empty() || value.size() > 4)
+		{
+			return std::nullopt;
+		}
+
+		int depth = 0;
+
+		for (wchar_t c : value)
+		{
+			if (!std::iswdigit(c))
+			{
+				return std::nullopt;
+			}
+
+			depth = depth * 10 + (c - '0');
+		}
+
+		return depth;
+	}
+
+	bool ParseTerm(
+		std::wstring_view term, ULONGLONG currentTime, SearchFilter &filter, ParseState &state)
+	{
+		bool negated = false;
+
+		if (!term.empty() && term[0] == '-')
+		{
+			negated = true;
+			term.remove_prefix(1);
+		}
+
+		auto separator = term.find(':');
+
+		if (separator == term.npos)
+		{
+			return false;
+		}
+
+		std::wstring key = ToLower(term.substr(0, separator));
+		std::wstring_view originalValue = term.substr(separator + 1);
+		std::wstring value = ToLower(originalValue);
+
+		if (key == L"exclude" || key == L"depth")
+		{
+			if (negated || value.empty())
+			{
+				return false;
+			}
+
+			if (key == L"exclude")
+			{
+				filter.excludedDirectories.emplace_back(originalValue);
+				return true;
+			}
+
+			auto depth = ParseDepth(value);
+
+			if (!depth)
+			{
+				return false;
+			}
+
+			filter.maxDepth = depth;
+			return true;
+		}
+
+		std::unique_ptr<SearchPredicate> predicate;
+
+		if (key == L"size")
+		{
+			predicate = ParseSizeTerm(value);
+			state.negatedSizeTerm |= negated;
+		}
+		else if (key == L"modified")
+		{
+			predicate = ParseModifiedTerm(value, currentTime);
+		}
+		else if (key == L"attrib")
+		{
+			auto attributePredicate = ParseAttributeTerm(value);
+
+			if (attributePredicate && !negated
+				&& WI_IsFlagSet(
+					attributePredicate->GetRequiredAttributes(), FILE_ATTRIBUTE_DIRECTORY))
+			{
+				state.foldersRequested = true;
+			}
+
+			predicate = std::move(attributePredicate);
+		}
+
+		if (!predicate)
+		{
+			return false;
+		}
+
+		if (negated)
+		{
+			predicate = std::make_unique<NotPredicate>(std::move(predicate));
+		}
+
+		filter.predicates.push_back(std::move(predicate));
+		return true;
+	}
+}
+
+std::optional<SearchFilter> ParseSearchFilter(
+	std::wstring_view text, ULONGLONG currentTime, std::wstring &invalidTerm)
+{
+	SearchFilter filter;
+	ParseState state;
+
+	for (const auto &term : SplitTerms(text))
+	{
+		if (!ParseTerm(term, currentTime, filter, state))
+		{
+			invalidTerm = term;
+			return std::nullopt;
+		}
+	}
+
+	// Folders don't have a size, so they never match a size term and would therefore always match
+	// a negated one. Since a size term is really only about files, folders are left out entirely
+	// in that case, unless they've been explicitly asked for.
+	if (state.negatedSizeTerm && !state.foldersRequested)
+	{
+		filter.predicates.insert(filter.predicates.begin(),
+			std::make_unique<AttributePredicate>(0, FILE_ATTRIBUTE_DIRECTORY));
+	}
+
+	return filter;
+}
@@ -0,0 +1,40 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "SearchPredicate.h"
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The result of parsing the filter text entered alongside a search pattern. The filter consists of
+// a set of space-separated terms, all of which an entry has to satisfy:
+//
+// size:>1GB, size:<=500KB       File size (units B, KB, MB, GB, TB; bytes if omitted).
+// modified:<7d, modified:>1y    Time since the last modification (units h, d, w, m (30 days), y).
+// modified:>=2024-01-31         Last modification date (local time), compared as whole days.
+// attrib:+h-r                   Attributes that are required (+) or excluded (-). The attributes
+//                               are a(rchive), c(ompressed), d(irectory), e(ncrypted), h(idden),
+//                               r(ead-only) and s(ystem).
+// exclude:node_modules          Folders (which may contain wildcards) that aren't searched at all.
+// depth:2                       The maximum depth of the folders that are searched.
+//
+// A size, modified or attrib term can be negated by prefixing it with '-'. A negated size term
+// still only matches files, unless folders are explicitly requested with attrib:+d. Values
+// containing spaces can be placed in double quotes (e.g. exclude:"Program Files").
+struct SearchFilter
+{
+	std::vector<std::unique_ptr<SearchPredicate>> predicates;
+	std::vector<std::wstring> excludedDirectories;
+	std::optional<int> maxDepth;
+};
+
+// The current time is in 100-nanosecond intervals since January 1, 1601 (UTC) and is what relative
+// modification times are measured from. Returns an empty value if any of the terms are invalid, in
+// which case invalidTerm will be set to the first invalid term.
+std::optional<SearchFilter> ParseSearchFilter(
+	std::wstring_view text, ULONGLONG currentTime, std::wstring &invalidTerm);
@@ -0,0 +1,159 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "SearchPredicate.h"
+#include <wil/common.h>
+
+SearchEntry SearchEntry::FromFindData(const WIN32_FIND_DATA &findData)
+{
+	SearchEntry entry;
+	entry.name = findData.cFileName;
+	entry.attributes = findData.dwFileAttributes;
+	entry.size = (static_cast<ULONGLONG>(findData.nFileSizeHigh) << 32) | findData.nFileSizeLow;
+	entry.lastWriteTime = FileTimeToTicks(findData.ftLastWriteTime);
+	return entry;
+}
+
+ULONGLONG SearchEntry::FileTimeToTicks(const FILETIME &fileTime)
+{
+	return (static_cast<ULONGLONG>(fileTime.dwHighDateTime) << 32) | fileTime.dwLowDateTime;
+}
+
+NamePredicate::NamePredicate(std::unique_ptr<FilenameMatcher> matcher, bool caseSensitive) :
+	m_matcher(std::move(matcher)),
+	m_prefilter(m_matcher->GetRequiredLiterals(), caseSensitive)
+{
+}
+
+bool NamePredicate::Matches(const SearchEntry &entry) const
+{
+	if (!m_prefilter.MayMatch(entry.name))
+	{
+		return false;
+	}
+
+	return m_matcher->Match(entry.name);
+}
+
+const FilenameMatcher &NamePredicate::GetMatcher() const
+{
+	return *m_matcher;
+}
+
+SizePredicate::SizePredicate(std::optional<ULONGLONG> minSize, std::optional<ULONGLONG> maxSize) :
+	m_minSize(minSize),
+	m_maxSize(maxSize)
+{
+}
+
+bool SizePredicate::Matches(const SearchEntry &entry) const
+{
+	if (WI_IsFlagSet(entry.attributes, FILE_ATTRIBUTE_DIRECTORY))
+	{
+		return false;
+	}
+
+	return (!m_minSize || entry.size >= *m_minSize) && (!m_maxSize || entry.size <= *m_maxSize);
+}
+
+DatePredicate::DatePredicate(std::optional<ULONGLONG> earliest, std::optional<ULONGLONG> latest) :
+	m_earliest(earliest),
+	m_latest(latest)
+{
+}
+
+bool DatePredicate::Matches(const SearchEntry &entry) const
+{
+	return (!m_earliest || entry.lastWriteTime >= *m_earliest)
+		&& (!m_latest || entry.lastWriteTime <= *m_latest);
+}
+
+AttributePredicate::AttributePredicate(DWORD requiredAttributes, DWORD excludedAttributes) :
+	m_requiredAttributes(requiredAttributes),
+	m_excludedAttributes(excludedAttributes)
+{
+}
+
+bool AttributePredicate::Matches(const SearchEntry &entry) const
+{
+	return WI_AreAllFlagsSet(entry.attributes, m_requiredAttributes)
+		&& WI_AreAllFlagsClear(entry.attributes, m_excludedAttributes);
+}
+
+DWORD AttributePredicate::GetRequiredAttributes() const
+{
+	return m_requiredAttributes;
+}
+
+NotPredicate::NotPredicate(std::unique_ptr<SearchPredicate> predicate) :
+	m_predicate(std::move(predicate))
+{
+}
+
+bool NotPredicate::Matches(const SearchEntry &entry) const
+{
+	return !m_predicate->Matches(entry);
+}
+
+void AllOfPredicate::Add(std::unique_ptr<SearchPredicate> predicate)
+{
+	m_predicates.push_back(std::move(predicate));
+}
+
+bool AllOfPredicate::IsEmpty() const
+{
+	return m_predicates.empty();
+}
+
+bool AllOfPredicate::Matches(const SearchEntry &entry) const
+{
+	for (const auto &predicate : m_predicates)
+	{
+		if (!predicate->Matches(entry))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+DirectoryPruner::DirectoryPruner(
+	const std::vector<std::wstring> &excludedPatterns, std::optional<int> maxDepth) :
+	m_maxDepth(maxDepth)
+{
+	for (const auto &pattern : excludedPatterns)
+	{
+		m_excludedMatchers.emplace_back(pattern, false);
+	}
+}
+
+bool DirectoryPruner::IsExcluded(std::wstring_view name) const
+{
+	for (const auto &matcher : m_excludedMatchers)
+	{
+		if (matcher.Match(name))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool DirectoryPruner::ShouldDescend(std::wstring_view name, int depth) const
+{
+	if (m_maxDepth && depth > *m_maxDepth)
+	{
+		return false;
+	}
+
+	return !IsExcluded(name);
+}
+
+bool DirectoryPruner::IsEmpty() const
+{
+	return m_excludedMatchers.empty() && !m_maxDepth;
+}
@@ -0,0 +1,148 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "FilenameMatcher.h"
+#include "LiteralPrefilter.h"
+#include "WildcardMatcher.h"
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The information about an entry that a predicate is evaluated against. Everything here is
+// returned by the directory enumeration itself, so evaluating a predicate never requires any
+// additional I/O.
+struct SearchEntry
+{
+	std::wstring_view name;
+	DWORD attributes;
+	ULONGLONG size;
+
+	// In 100-nanosecond intervals since January 1, 1601 (UTC), as with a FILETIME.
+	ULONGLONG lastWriteTime;
+
+	static SearchEntry FromFindData(const WIN32_FIND_DATA &findData);
+	static ULONGLONG FileTimeToTicks(const FILETIME &fileTime);
+};
+
+class SearchPredicate
+{
+public:
+	virtual ~SearchPredicate() = default;
+
+	virtual bool Matches(const SearchEntry &entry) const = 0;
+};
+
+class NamePredicate : public SearchPredicate
+{
+public:
+	NamePredicate(std::unique_ptr<FilenameMatcher> matcher, bool caseSensitive);
+
+	bool Matches(const SearchEntry &entry) const override;
+
+	const FilenameMatcher &GetMatcher() const;
+
+private:
+	std::unique_ptr<FilenameMatcher> m_matcher;
+
+	// Checked before the matcher, since it can rule out most non-matching names without running
+	// the full match.
+	LiteralPrefilter m_prefilter;
+};
+
+// Matches files whose size lies within the (inclusive) range. Folders never match, since the
+// enumeration doesn't report a size for them.
+class SizePredicate : public SearchPredicate
+{
+public:
+	SizePredicate(std::optional<ULONGLONG> minSize, std::optional<ULONGLONG> maxSize);
+
+	bool Matches(const SearchEntry &entry) const override;
+
+private:
+	std::optional<ULONGLONG> m_minSize;
+	std::optional<ULONGLONG> m_maxSize;
+};
+
+// Matches entries whose last write time lies within the (inclusive) range.
+class DatePredicate : public SearchPredicate
+{
+public:
+	DatePredicate(std::optional<ULONGLONG> earliest, std::optional<ULONGLONG> latest);
+
+	bool Matches(const SearchEntry &entry) const override;
+
+private:
+	std::optional<ULONGLONG> m_earliest;
+	std::optional<ULONGLONG> m_latest;
+};
+
+// Matches entries that have all of the required attributes and none of the excluded ones.
+class AttributePredicate : public SearchPredicate
+{
+public:
+	AttributePredicate(DWORD requiredAttributes, DWORD excludedAttributes);
+
+	bool Matches(const SearchEntry &entry) const override;
+
+	DWORD GetRequiredAttributes() const;
+
+private:
+	DWORD m_requiredAttributes;
+	DWORD m_excludedAttributes;
+};
+
+class NotPredicate : public SearchPredicate
+{
+public:
+	explicit NotPredicate(std::unique_ptr<SearchPredicate> predicate);
+
+	bool Matches(const SearchEntry &entry) const override;
+
+private:
+	std::unique_ptr<SearchPredicate> m_predicate;
+};
+
+// Matches entries that match every one of the predicates it contains (and so matches everything
+// when it's empty). The predicates are evaluated in the order in which they were added, so the
+// cheapest and most selective predicates should be added first.
+class AllOfPredicate : public SearchPredicate
+{
+public:
+	void Add(std::unique_ptr<SearchPredicate> predicate);
+	bool IsEmpty() const;
+
+	bool Matches(const SearchEntry &entry) const override;
+
+private:
+	std::vector<std::unique_ptr<SearchPredicate>> m_predicates;
+};
+
+// Decides which directories a search descends into. Whole subtrees can then be skipped without
+// ever being enumerated.
+class DirectoryPruner
+{
+public:
+	// The patterns are matched (case-insensitively) against the names of directories, rather than
+	// their full paths. A maximum depth of 0 means that only the root directory is searched.
+	DirectoryPruner(const std::vector<std::wstring> &excludedPatterns, std::optional<int> maxDepth);
+
+	// Returns true if the directory, along with everything in it, should be left out of the
+	// search.
+	bool IsExcluded(std::wstring_view name) const;
+
+	// The depth here is the depth of the directory itself, with the root directory being at a
+	// depth of 0.
+	bool ShouldDescend(std::wstring_view name, int depth) const;
+
+	// Returns true if no directories will ever be pruned.
+	bool IsEmpty() const;
+
+private:
+	std::vector<WildcardMatcher> m_excludedMatchers;
+	std::optional<int> m_maxDepth;
+};
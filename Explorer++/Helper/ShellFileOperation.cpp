@@ -0,0 +1,334 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ShellFileOperation.h"
+#include "FolderSize.h"
+#include <wil/com.h>
+#include <wil/common.h>
+#include <wil/resource.h>
+#include <sherrors.h>
+#include <algorithm>
+
+namespace
+{
+	// Translates the progress reported by IFileOperation (which is in arbitrary units of work)
+	// into bytes and passes it on to the queue.
+	class ProgressSink : public IFileOperationProgressSink
+	{
+	public:
+		ProgressSink(FileOperationQueue::OperationContext &context, uint64_t totalBytes) :
+			m_refCount(1),
+			m_context(context),
+			m_totalBytes(totalBytes),
+			m_bytesReported(0)
+		{
+		}
+
+		HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppvObject) override
+		{
+#pragma warning(push)
+#pragma warning(disable : 4838) // conversion from 'DWORD' to 'int' requires a narrowing conversion
+			static const QITAB qit[] = { QITABENT(ProgressSink, IFileOperationProgressSink),
+				{ nullptr } };
+#pragma warning(pop)
+
+			return QISearch(this, qit, riid, ppvObject);
+		}
+
+		ULONG STDMETHODCALLTYPE AddRef() override
+		{
+			return InterlockedIncrement(&m_refCount);
+		}
+
+		ULONG STDMETHODCALLTYPE Release() override
+		{
+			ULONG refCount = InterlockedDecrement(&m_refCount);
+
+			if (refCount == 0)
+			{
+				delete this;
+			}
+
+			return refCount;
+		}
+
+		HRESULT STDMETHODCALLTYPE StartOperations() override
+		{
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE FinishOperations(HRESULT hrResult) override
+		{
+			// The progress updates don't necessarily add up to exactly the total, so whatever is
+			// left is accounted for here.
+			if (SUCCEEDED(hrResult))
+			{
+				ReportBytes(m_totalBytes);
+			}
+
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE PreRenameItem(DWORD, IShellItem *, LPCWSTR) override
+		{
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE PostRenameItem(
+			DWORD, IShellItem *, LPCWSTR, HRESULT, IShellItem *) override
+		{
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE PreMoveItem(DWORD, IShellItem *, IShellItem *, LPCWSTR) override
+		{
+			return OnCheckpoint();
+		}
+
+		HRESULT STDMETHODCALLTYPE PostMoveItem(
+			DWORD, IShellItem *, IShellItem *, LPCWSTR, HRESULT, IShellItem *) override
+		{
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE PreCopyItem(DWORD, IShellItem *, IShellItem *, LPCWSTR) override
+		{
+			return OnCheckpoint();
+		}
+
+		HRESULT STDMETHODCALLTYPE PostCopyItem(
+			DWORD, IShellItem *, IShellItem *, LPCWSTR, HRESULT, IShellItem *) override
+		{
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE PreDeleteItem(DWORD, IShellItem *) override
+		{
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE PostDeleteItem(
+			DWORD, IShellItem *, HRESULT, IShellItem *) override
+		{
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE PreNewItem(DWORD, IShellItem *, LPCWSTR) override
+		{
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE PostNewItem(
+			DWORD, IShellItem *, LPCWSTR, LPCWSTR, DWORD, HRESULT, IShellItem *) override
+		{
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE UpdateProgress(UINT iWorkTotal, UINT iWorkSoFar) override
+		{
+			if (iWorkTotal > 0)
+			{
+				ReportBytes(static_cast<uint64_t>(
+					static_cast<double>(m_totalBytes) * iWorkSoFar / iWorkTotal));
+			}
+
+			return OnCheckpoint();
+		}
+
+		HRESULT STDMETHODCALLTYPE ResetTimer() override
+		{
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE PauseTimer() override
+		{
+			return S_OK;
+		}
+
+		HRESULT STDMETHODCALLTYPE ResumeTimer() override
+		{
+			return S_OK;
+		}
+
+	private:
+		~ProgressSink() = default;
+
+		void ReportBytes(uint64_t bytesSoFar)
+		{
+			bytesSoFar = std::min(bytesSoFar, m_totalBytes);
+
+			if (bytesSoFar > m_bytesReported)
+			{
+				m_context.ReportProgress(bytesSoFar - m_bytesReported);
+				m_bytesReported = bytesSoFar;
+			}
+		}
+
+		// Blocking here is what pauses the operation. Failing any of the Pre* methods cancels
+		// the rest of the operation.
+		HRESULT OnCheckpoint()
+		{
+			return m_context.Checkpoint() ? S_OK : HRESULT_FROM_WIN32(ERROR_CANCELLED);
+		}
+
+		ULONG m_refCount;
+		FileOperationQueue::OperationContext &m_context;
+		const uint64_t m_totalBytes;
+		uint64_t m_bytesReported;
+	};
+}
+
+ShellFileOperation::ShellFileOperation(HWND owner, Type type,
+	const std::vector<PCIDLIST_ABSOLUTE> &items, PCIDLIST_ABSOLUTE destinationFolder) :
+	m_owner(owner),
+	m_type(type),
+	m_items(DeepCopyPidls(items)),
+	m_destinationFolder(ILCloneFull(destinationFolder))
+{
+}
+
+HRESULT ShellFileOperation::Run(FileOperationQueue::OperationContext &context)
+{
+	// The operation may have been paused while it was queued.
+	if (!context.Checkpoint())
+	{
+		return HRESULT_FROM_WIN32(ERROR_CANCELLED);
+	}
+
+	HRESULT hr = CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	hr = Perform(context);
+
+	CoUninitialize();
+
+	return hr;
+}
+
+HRESULT ShellFileOperation::Perform(FileOperationQueue::OperationContext &context)
+{
+	std::vector<PCIDLIST_ABSOLUTE> items;
+
+	for (const auto &item : m_items)
+	{
+		items.push_back(item.get());
+	}
+
+	wil::com_ptr_nothrow<IShellItemArray> shellItemArray;
+	HRESULT hr = SHCreateShellItemArrayFromIDLists(
+		static_cast<UINT>(items.size()), items.data(), &shellItemArray);
+
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	wil::com_ptr_nothrow<IShellItem> destinationFolder;
+	hr = SHCreateItemFromIDList(m_destinationFolder.get(), IID_PPV_ARGS(&destinationFolder));
+
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	wil::com_ptr_nothrow<IFileOperation> fo;
+	hr = CoCreateInstance(CLSID_FileOperation, nullptr, CLSCTX_ALL, IID_PPV_ARGS(&fo));
+
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	hr = fo->SetOwnerWindow(m_owner);
+
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	hr = fo->SetOperationFlags(FOF_ALLOWUNDO);
+
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	wil::com_ptr_nothrow<IFileOperationProgressSink> progressSink;
+	progressSink.attach(new ProgressSink(context, CalculateTotalSize()));
+
+	DWORD cookie;
+	hr = fo->Advise(progressSink.get(), &cookie);
+
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	auto unadvise = wil::scope_exit([&fo, cookie] { fo->Unadvise(cookie); });
+
+	if (m_type == Type::Move)
+	{
+		hr = fo->MoveItems(shellItemArray.get(), destinationFolder.get());
+	}
+	else
+	{
+		hr = fo->CopyItems(shellItemArray.get(), destinationFolder.get());
+	}
+
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	hr = fo->PerformOperations();
+
+	// Errors affecting individual items are shown by IFileOperation itself. Cancelling in
+	// response to one of those is treated the same way as the operation being stopped.
+	if (hr == COPYENGINE_E_USER_CANCELLED)
+	{
+		return HRESULT_FROM_WIN32(ERROR_CANCELLED);
+	}
+
+	return hr;
+}
+
+uint64_t ShellFileOperation::CalculateTotalSize() const
+{
+	uint64_t totalSize = 0;
+
+	for (const auto &item : m_items)
+	{
+		std::wstring path;
+		HRESULT hr = GetDisplayName(item.get(), SHGDN_FORPARSING, path);
+
+		if (FAILED(hr))
+		{
+			continue;
+		}
+
+		WIN32_FILE_ATTRIBUTE_DATA attributeData;
+
+		if (!GetFileAttributesEx(path.c_str(), GetFileExInfoStandard, &attributeData))
+		{
+			continue;
+		}
+
+		if (WI_IsFlagSet(attributeData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+		{
+			totalSize += GetFolderInfo(path).size;
+		}
+		else
+		{
+			totalSize += (static_cast<uint64_t>(attributeData.nFileSizeHigh) << 32)
+				| attributeData.nFileSizeLow;
+		}
+	}
+
+	return totalSize;
+}
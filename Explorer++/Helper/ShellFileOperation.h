@@ -0,0 +1,37 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "FileOperationQueue.h"
+#include "ShellHelper.h"
+#include <vector>
+
+// Copies or moves a set of items through IFileOperation, so that the operation behaves in the
+// same way as one started by the shell (with the same progress dialog, conflict handling and undo
+// support). Progress is reported to the queue in bytes, based on the total size of the items,
+// and the queue's checkpoints are honoured before each item and on each progress update.
+class ShellFileOperation : public FileOperationQueue::Operation
+{
+public:
+	enum class Type
+	{
+		Copy,
+		Move
+	};
+
+	ShellFileOperation(HWND owner, Type type, const std::vector<PCIDLIST_ABSOLUTE> &items,
+		PCIDLIST_ABSOLUTE destinationFolder);
+
+	HRESULT Run(FileOperationQueue::OperationContext &context) override;
+
+private:
+	HRESULT Perform(FileOperationQueue::OperationContext &context);
+	uint64_t CalculateTotalSize() const;
+
+	const HWND m_owner;
+	const Type m_type;
+	const std::vector<unique_pidl_absolute> m_items;
+	const unique_pidl_absolute m_destinationFolder;
+};
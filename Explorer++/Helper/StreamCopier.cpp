@@ -0,0 +1,242 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "StreamCopier.h"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <queue>
+#include <thread>
+
+StreamCopier::StreamCopier(size_t bufferSize, size_t numBuffers) :
+	m_bufferSize(std::max<size_t>(bufferSize, 1)),
+	m_stopped(false)
+{
+	// At least two buffers are needed for a read to be able to overlap with a write.
+	numBuffers = std::max<size_t>(numBuffers, 2);
+
+	for (size_t i = 0; i < numBuffers; i++)
+	{
+		// VirtualAlloc() always returns memory that starts on a page boundary.
+		auto *buffer = static_cast<std::byte *>(
+			VirtualAlloc(nullptr, m_bufferSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+
+		if (!buffer)
+		{
+			throw std::bad_alloc();
+		}
+
+		m_buffers.emplace_back(buffer);
+	}
+}
+
+void StreamCopier::BufferDeleter::operator()(std::byte *buffer) const
+{
+	VirtualFree(buffer, 0, MEM_RELEASE);
+}
+
+StreamCopier::Result StreamCopier::Copy(
+	const ReadFunction &read, const WriteFunction &write, const ProgressCallback &progressCallback)
+{
+	struct Block
+	{
+		size_t bufferIndex;
+		size_t size;
+	};
+
+	// Each buffer is always in exactly one of three places: the free queue, waiting to be filled
+	// by the reader; the filled queue, waiting to be written; or in the hands of one of the two
+	// threads.
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::queue<size_t> freeBuffers;
+	std::queue<Block> filledBlocks;
+	bool readFinished = false;
+	bool readFailed = false;
+	bool writeFinished = false;
+
+	for (size_t i = 0; i < m_buffers.size(); i++)
+	{
+		freeBuffers.push(i);
+	}
+
+	std::thread reader([&] {
+		while (true)
+		{
+			size_t bufferIndex;
+
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				condition.wait(lock, [&] { return !freeBuffers.empty() || writeFinished; });
+
+				if (writeFinished)
+				{
+					return;
+				}
+
+				bufferIndex = freeBuffers.front();
+				freeBuffers.pop();
+			}
+
+			std::optional<size_t> bytesRead;
+
+			if (!m_stopped)
+			{
+				bytesRead = read(m_buffers[bufferIndex].get(), m_bufferSize);
+			}
+
+			bool finished = m_stopped || !bytesRead || *bytesRead == 0;
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+
+				if (finished)
+				{
+					readFailed = !bytesRead && !m_stopped;
+					readFinished = true;
+				}
+				else
+				{
+					filledBlocks.push({ bufferIndex, std::min(*bytesRead, m_bufferSize) });
+				}
+			}
+
+			condition.notify_all();
+
+			if (finished)
+			{
+				return;
+			}
+		}
+	});
+
+	Result result = Result::Succeeded;
+	uint64_t bytesCopied = 0;
+
+	while (true)
+	{
+		Block block;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [&] { return !filledBlocks.empty() || readFinished; });
+
+			// There's no point writing out anything else if the source couldn't be read in full.
+			if (filledBlocks.empty() || readFailed)
+			{
+				break;
+			}
+
+			block = filledBlocks.front();
+			filledBlocks.pop();
+		}
+
+		if (m_stopped)
+		{
+			break;
+		}
+
+		if (!write(m_buffers[block.bufferIndex].get(), block.size))
+		{
+			result = Result::WriteFailed;
+			break;
+		}
+
+		bytesCopied += block.size;
+
+		if (progressCallback)
+		{
+			progressCallback(bytesCopied);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			freeBuffers.push(block.bufferIndex);
+		}
+
+		condition.notify_all();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		writeFinished = true;
+	}
+
+	condition.notify_all();
+	reader.join();
+
+	if (result == Result::WriteFailed)
+	{
+		return result;
+	}
+
+	if (m_stopped)
+	{
+		return Result::Stopped;
+	}
+
+	if (readFailed)
+	{
+		return Result::ReadFailed;
+	}
+
+	return result;
+}
+
+void StreamCopier::Stop()
+{
+	m_stopped = true;
+}
+
+bool StreamCopier::IsStopped() const
+{
+	return m_stopped;
+}
+
+size_t StreamCopier::GetBufferSize() const
+{
+	return m_bufferSize;
+}
+
+StreamCopier::ReadFunction StreamCopier::ReadFromFile(HANDLE file)
+{
+	return [file](void *buffer, size_t size) -> std::optional<size_t> {
+		DWORD bytesRead;
+		BOOL res = ReadFile(file, buffer, static_cast<DWORD>(std::min<size_t>(size, MAXDWORD)),
+			&bytesRead, nullptr);
+
+		if (!res)
+		{
+			return std::nullopt;
+		}
+
+		return bytesRead;
+	};
+}
+
+StreamCopier::WriteFunction StreamCopier::WriteToFile(HANDLE file)
+{
+	return [file](const void *buffer, size_t size) {
+		auto *data = static_cast<const std::byte *>(buffer);
+
+		while (size > 0)
+		{
+			DWORD bytesWritten;
+			BOOL res = WriteFile(file, data,
+				static_cast<DWORD>(std::min<size_t>(size, MAXDWORD)), &bytesWritten, nullptr);
+
+			if (!res || bytesWritten == 0)
+			{
+				return false;
+			}
+
+			data += bytesWritten;
+			size -= bytesWritten;
+		}
+
+		return true;
+	};
+}
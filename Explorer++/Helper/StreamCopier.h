@@ -0,0 +1,82 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+// Copies a stream of data from a source to a destination through a fixed set of buffers. The
+// source is read on a separate thread, so that reading the next block overlaps with writing the
+// previous one, and the amount of memory used is bounded, no matter how much data is copied.
+//
+// The copier itself knows nothing about files; the source and destination are supplied as
+// functions. The same copier (and its buffers) can be reused for any number of copies. Each
+// buffer starts on a page boundary, so the buffers can also be used for unbuffered I/O.
+class StreamCopier
+{
+public:
+	// Reads up to the specified number of bytes into the buffer. Returns the number of bytes read,
+	// which is 0 at the end of the stream, or std::nullopt if the read failed.
+	using ReadFunction = std::function<std::optional<size_t>(void *buffer, size_t size)>;
+
+	// Writes the entire buffer, returning false if the write failed.
+	using WriteFunction = std::function<bool(const void *buffer, size_t size)>;
+
+	// Called on the thread that started the copy, each time a block has been written, with the
+	// number of bytes written so far by the current copy.
+	using ProgressCallback = std::function<void(uint64_t bytesCopied)>;
+
+	enum class Result
+	{
+		Succeeded,
+		ReadFailed,
+		WriteFailed,
+		Stopped
+	};
+
+	static constexpr size_t DEFAULT_BUFFER_SIZE = 4 * 1024 * 1024;
+	static constexpr size_t DEFAULT_NUM_BUFFERS = 4;
+
+	// The alignment of each buffer. This is a multiple of any sector size that's likely to be
+	// encountered.
+	static constexpr size_t BUFFER_ALIGNMENT = 4096;
+
+	explicit StreamCopier(
+		size_t bufferSize = DEFAULT_BUFFER_SIZE, size_t numBuffers = DEFAULT_NUM_BUFFERS);
+
+	// Copies the source to the destination until the source is exhausted, either side fails or
+	// the copier is stopped. Blocks until the copy has finished.
+	Result Copy(const ReadFunction &read, const WriteFunction &write,
+		const ProgressCallback &progressCallback = nullptr);
+
+	// Can be called from any thread. Once stopped, a copier stays stopped, so any further copies
+	// will immediately return Result::Stopped.
+	void Stop();
+	bool IsStopped() const;
+
+	size_t GetBufferSize() const;
+
+	// Adapters for synchronous Win32 file handles.
+	static ReadFunction ReadFromFile(HANDLE file);
+	static WriteFunction WriteToFile(HANDLE file);
+
+private:
+	struct BufferDeleter
+	{
+		void operator()(std::byte *buffer) const;
+	};
+
+	using Buffer = std::unique_ptr<std::byte[], BufferDeleter>;
+
+	const size_t m_bufferSize;
+	std::vector<Buffer> m_buffers;
+
+	std::atomic<bool> m_stopped;
+};
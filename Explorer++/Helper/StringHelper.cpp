@@ -5,11 +5,9 @@
 #include "stdafx.h"
 #include "StringHelper.h"
 #include "Macros.h"
+#include "WildcardMatcher.h"
 #include <codecvt>
 
-BOOL CheckWildcardMatchInternal(
-	const TCHAR *szWildcard, const TCHAR *szString, BOOL bCaseSensitive);
-
 void FormatSizeString(ULARGE_INTEGER lFileSize, TCHAR *pszFileSize, size_t cchBuf)
 {
 	FormatSizeString(lFileSize, pszFileSize, cchBuf, FALSE, SizeDisplayFormat::None);
@@ -161,138 +159,10 @@ TCHAR *PrintCommaLargeNum(LARGE_INTEGER lPrint)
 
 BOOL CheckWildcardMatch(const TCHAR *szWildcard, const TCHAR *szString, BOOL bCaseSensitive)
 {
-	/* Handles multiple wildcard patterns. If the wildcard pattern contains ':',
-	split the pattern into multiple subpatterns.
-	For example "*.h: *.cpp" would match against "*.h" and "*.cpp" */
-	BOOL bMultiplePattern = FALSE;
-
-	for (int i = 0; i < lstrlen(szWildcard); i++)
-	{
-		if (szWildcard[i] == ':')
-		{
-			bMultiplePattern = TRUE;
-			break;
-		}
-	}
-
-	if (!bMultiplePattern)
-	{
-		return CheckWildcardMatchInternal(szWildcard, szString, bCaseSensitive);
-	}
-	else
-	{
-		TCHAR szWildcardPattern[512];
-		TCHAR *szSinglePattern = nullptr;
-		TCHAR *szSearchPattern = nullptr;
-		TCHAR *szRemainingPattern = nullptr;
-
-		StringCchCopy(szWildcardPattern, SIZEOF_ARRAY(szWildcardPattern), szWildcard);
-
-		szSinglePattern = wcstok_s(szWildcardPattern, _T(":"), &szRemainingPattern);
-		PathRemoveBlanks(szSinglePattern);
-
-		while (szSinglePattern != nullptr)
-		{
-			if (CheckWildcardMatchInternal(szSinglePattern, szString, bCaseSensitive))
-			{
-				return TRUE;
-			}
-
-			szSearchPattern = szRemainingPattern;
-			szSinglePattern = wcstok_s(szSearchPattern, _T(":"), &szRemainingPattern);
-			PathRemoveBlanks(szSinglePattern);
-		}
-	}
-
-	return FALSE;
-}
-
-BOOL CheckWildcardMatchInternal(const TCHAR *szWildcard, const TCHAR *szString, BOOL bCaseSensitive)
-{
-	BOOL bMatched;
-	BOOL bCurrentMatch = TRUE;
-
-	while (*szWildcard != '\0' && *szString != '\0' && bCurrentMatch)
-	{
-		switch (*szWildcard)
-		{
-			/* Match against the next part of the wildcard string.
-			If there is a match, then return true, else consume
-			the next character, and check again. */
-		case '*':
-			bMatched = FALSE;
-
-			if (*(szWildcard + 1) != '\0')
-			{
-				bMatched = CheckWildcardMatch(++szWildcard, szString, bCaseSensitive);
-			}
-
-			while (*szWildcard != '\0' && *szString != '\0' && !bMatched)
-			{
-				/* Consume one more character on the input string,
-				and keep (recursively) trying to match. */
-				bMatched = CheckWildcardMatch(szWildcard, ++szString, bCaseSensitive);
-			}
-
-			if (bMatched)
-			{
-				while (*szWildcard != '\0')
-				{
-					szWildcard++;
-				}
-
-				szWildcard--;
-
-				while (*szString != '\0')
-				{
-					szString++;
-				}
-			}
-
-			bCurrentMatch = bMatched;
-			break;
-
-		case '?':
-			szString++;
-			break;
-
-		default:
-			if (bCaseSensitive)
-			{
-				bCurrentMatch = (*szWildcard == *szString);
-			}
-			else
-			{
-				TCHAR szCharacter1[1];
-				LCMapString(LOCALE_USER_DEFAULT, LCMAP_LOWERCASE, szWildcard, 1, szCharacter1,
-					SIZEOF_ARRAY(szCharacter1));
-
-				TCHAR szCharacter2[1];
-				LCMapString(LOCALE_USER_DEFAULT, LCMAP_LOWERCASE, szString, 1, szCharacter2,
-					SIZEOF_ARRAY(szCharacter2));
-
-				bCurrentMatch = (szCharacter1[0] == szCharacter2[0]);
-			}
-
-			szString++;
-			break;
-		}
-
-		szWildcard++;
-	}
-
-	/* Skip past any trailing wildcards. */
-	while (*szWildcard == '*')
-	{
-		szWildcard++;
-	}
-
-	if (*szWildcard == '\0' && *szString == '\0' && bCurrentMatch)
-	{
-		return TRUE;
-	}
-
-	return FALSE;
+	/* Callers that match the same pattern against many strings
+	should construct a WildcardMatcher once and reuse it. */
+	WildcardMatcher matcher(szWildcard, bCaseSensitive);
+	return matcher.Match(szString);
 }
 
 void ReplaceCharacter(TCHAR *str, TCHAR ch, TCHAR chReplacement)
@@ -362,4 +232,30 @@ std::wstring utf8StrToWstr(const std::string &source)
 {
 	std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
 	return converter.from_bytes(source);
+}
+
+// Returns a key for the string that orders strings in (almost exactly) the same way as
+// StrCmpLogicalW(). That is, case is ignored and runs of digits are compared numerically. Keys can
+// be compared directly, which is much cheaper than comparing the strings themselves, so this is
+// useful when a large set of strings needs to be sorted more than once.
+std::string CreateNaturalSortKey(const std::wstring &str)
+{
+	const DWORD flags = LCMAP_SORTKEY | NORM_IGNORECASE | SORT_DIGITSASNUMBERS;
+
+	// When LCMAP_SORTKEY is used, the output is an array of bytes, with all sizes given in bytes.
+	int size = LCMapStringEx(LOCALE_NAME_USER_DEFAULT, flags, str.c_str(),
+		static_cast<int>(str.size()), nullptr, 0, nullptr, nullptr, 0);
+
+	if (size == 0)
+	{
+		return std::string();
+	}
+
+	std::string key(size, '\0');
+	size = LCMapStringEx(LOCALE_NAME_USER_DEFAULT, flags, str.c_str(),
+		static_cast<int>(str.size()), reinterpret_cast<LPWSTR>(key.data()), size, nullptr, nullptr,
+		0);
+	key.resize(size);
+
+	return key;
 }
\ No newline at end of file
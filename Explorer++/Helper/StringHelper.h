@@ -31,4 +31,5 @@ void TrimStringLeft(std::wstring &str, const std::wstring &strWhitespace);
 void TrimStringRight(std::wstring &str, const std::wstring &strWhitespace);
 void TrimString(std::wstring &str, const std::wstring &strWhitespace);
 std::string wstrToUtf8Str(const std::wstring &source);
-std::wstring utf8StrToWstr(const std::string &source);
\ No newline at end of file
+std::wstring utf8StrToWstr(const std::string &source);
+std::string CreateNaturalSortKey(const std::wstring &str);
\ No newline at end of file
@@ -0,0 +1,55 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ThroughputLimiter.h"
+#include <algorithm>
+#include <thread>
+
+ThroughputLimiter::ThroughputLimiter(unsigned long long bytesPerSecond) :
+	m_bytesPerSecond(bytesPerSecond),
+	m_nextAvailable(Clock::now())
+{
+}
+
+bool ThroughputLimiter::Acquire(unsigned long long numBytes, const StopCallback &stopCallback)
+{
+	if (m_bytesPerSecond == 0)
+	{
+		return true;
+	}
+
+	Clock::time_point startTime;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		// Time spent idle isn't banked, so a burst can never exceed the limit.
+		startTime = std::max(Clock::now(), m_nextAvailable);
+
+		auto duration = std::chrono::duration_cast<Clock::duration>(
+			std::chrono::duration<double>(static_cast<double>(numBytes) / m_bytesPerSecond));
+		m_nextAvailable = startTime + duration;
+	}
+
+	// Each caller waits for the slot it reserved, so callers are released in the order in which
+	// they called this method.
+	while (true)
+	{
+		if (stopCallback && stopCallback())
+		{
+			return false;
+		}
+
+		auto now = Clock::now();
+
+		if (now >= startTime)
+		{
+			return true;
+		}
+
+		std::this_thread::sleep_for(
+			std::min<Clock::duration>(startTime - now, MAX_WAIT_INTERVAL));
+	}
+}
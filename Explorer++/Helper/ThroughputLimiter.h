@@ -0,0 +1,39 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+
+// Limits the combined rate at which a set of threads reads data. Before reading a block, a thread
+// acquires the number of bytes it's about to read and is made to wait until the limit allows for
+// them. This is mainly useful for keeping background reads from saturating a slow (e.g. spinning)
+// disk.
+class ThroughputLimiter
+{
+public:
+	// Returns true if the caller no longer needs to wait.
+	using StopCallback = std::function<bool()>;
+
+	explicit ThroughputLimiter(unsigned long long bytesPerSecond);
+
+	// Blocks until the bytes can be read without exceeding the limit. Returns false if the stop
+	// callback signalled a stop while waiting. Can be called from any thread.
+	bool Acquire(unsigned long long numBytes, const StopCallback &stopCallback);
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	// The longest a waiting thread goes without checking the stop callback.
+	static constexpr std::chrono::milliseconds MAX_WAIT_INTERVAL = std::chrono::milliseconds(50);
+
+	const unsigned long long m_bytesPerSecond;
+
+	std::mutex m_mutex;
+
+	// The point at which all the bytes acquired so far will have been read at the target rate.
+	Clock::time_point m_nextAvailable;
+};
@@ -0,0 +1,52 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "TransferRateMeter.h"
+
+TransferRateMeter::TransferRateMeter(std::chrono::milliseconds window) :
+	m_window(window),
+	m_sampleInterval(window / 20)
+{
+}
+
+void TransferRateMeter::AddSample(Clock::time_point time, uint64_t totalBytes)
+{
+	// The last sample is only updated in place if there's an older sample to anchor the
+	// measurement, otherwise the first sample would keep moving forward.
+	if (m_samples.size() > 1 && (time - m_samples[m_samples.size() - 2].time) < m_sampleInterval)
+	{
+		m_samples.back() = { time, totalBytes };
+	}
+	else
+	{
+		m_samples.push_back({ time, totalBytes });
+	}
+
+	// One sample older than the window is kept, so that the window is always fully covered.
+	while (m_samples.size() > 2 && (time - m_samples[1].time) >= m_window)
+	{
+		m_samples.pop_front();
+	}
+}
+
+double TransferRateMeter::GetBytesPerSecond() const
+{
+	if (m_samples.size() < 2)
+	{
+		return 0;
+	}
+
+	const auto &first = m_samples.front();
+	const auto &last = m_samples.back();
+
+	std::chrono::duration<double> elapsed = last.time - first.time;
+
+	if (elapsed.count() <= 0)
+	{
+		return 0;
+	}
+
+	return static_cast<double>(last.totalBytes - first.totalBytes) / elapsed.count();
+}
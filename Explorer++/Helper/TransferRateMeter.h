@@ -0,0 +1,42 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+
+// Measures the rate at which data is being transferred, averaged over a short, sliding window.
+// The caller supplies the current time along with each sample, so that the meter can be driven
+// by a simulated clock. Not thread-safe.
+class TransferRateMeter
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr std::chrono::milliseconds DEFAULT_WINDOW = std::chrono::seconds(2);
+
+	explicit TransferRateMeter(std::chrono::milliseconds window = DEFAULT_WINDOW);
+
+	// Records the total number of bytes transferred as of the specified time. Samples are
+	// expected to be in chronological order. Samples that arrive within a short interval of each
+	// other are merged, which limits the number held.
+	void AddSample(Clock::time_point time, uint64_t totalBytes);
+
+	// Returns the average rate across the samples within the window, or 0 if there aren't enough
+	// samples yet.
+	double GetBytesPerSecond() const;
+
+private:
+	struct Sample
+	{
+		Clock::time_point time;
+		uint64_t totalBytes;
+	};
+
+	const std::chrono::milliseconds m_window;
+	const std::chrono::milliseconds m_sampleInterval;
+	std::deque<Sample> m_samples;
+};
@@ -0,0 +1,436 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "WildcardMatcher.h"
+#include "Macros.h"
+#include <algorithm>
+
+namespace
+{
+	const wchar_t PATTERN_SEPARATOR = ':';
+	const wchar_t WILDCARD_ANY_SEQUENCE = '*';
+	const wchar_t WILDCARD_ANY_CHARACTER = '?';
+	const wchar_t EXTENSION_SEPARATOR = '.';
+
+	std::wstring ToLowerCase(std::wstring_view str)
+	{
+		if (str.empty())
+		{
+			return std::wstring();
+		}
+
+		std::wstring output(str.size(), '\0');
+		int length = LCMapString(LOCALE_USER_DEFAULT, LCMAP_LOWERCASE, str.data(),
+			static_cast<int>(str.size()), output.data(), static_cast<int>(output.size()));
+		output.resize(length);
+
+		return output;
+	}
+
+	std::wstring_view TrimBlanks(std::wstring_view str)
+	{
+		size_t start = str.find_first_not_of(' ');
+
+		if (start == std::wstring_view::npos)
+		{
+			return std::wstring_view();
+		}
+
+		size_t end = str.find_last_not_of(' ');
+
+		return str.substr(start, end - start + 1);
+	}
+}
+
+WildcardMatcher::WildcardMatcher(std::wstring_view patternList, bool caseSensitive) :
+	m_caseSensitive(caseSensitive)
+{
+	std::wstring foldedPatternList;
+
+	if (!caseSensitive)
+	{
+		foldedPatternList = ToLowerCase(patternList);
+		patternList = foldedPatternList;
+	}
+
+	// As with previous versions, blanks around each sub-pattern are only removed when the pattern
+	// is actually a list of patterns.
+	if (patternList.find(PATTERN_SEPARATOR) == std::wstring_view::npos)
+	{
+		AddPattern(patternList);
+		return;
+	}
+
+	size_t start = 0;
+
+	while (start <= patternList.size())
+	{
+		size_t end = patternList.find(PATTERN_SEPARATOR, start);
+
+		if (end == std::wstring_view::npos)
+		{
+			end = patternList.size();
+		}
+
+		auto pattern = patternList.substr(start, end - start);
+
+		if (!pattern.empty())
+		{
+			AddPattern(TrimBlanks(pattern));
+		}
+
+		start = end + 1;
+	}
+}
+
+void WildcardMatcher::AddPattern(std::wstring_view pattern)
+{
+	m_patternSources.emplace_back(pattern);
+
+	auto compiledPattern = CompilePattern(pattern);
+
+	if (IsExtensionPattern(compiledPattern))
+	{
+		m_extensions.insert(compiledPattern.segments[0].substr(1));
+		return;
+	}
+
+	m_patterns.push_back(std::move(compiledPattern));
+}
+
+WildcardMatcher::CompiledPattern WildcardMatcher::CompilePattern(std::wstring_view pattern)
+{
+	CompiledPattern compiledPattern;
+	compiledPattern.anchoredAtStart = pattern.empty() || pattern.front() != WILDCARD_ANY_SEQUENCE;
+	compiledPattern.anchoredAtEnd = pattern.empty() || pattern.back() != WILDCARD_ANY_SEQUENCE;
+	compiledPattern.minLength = 0;
+
+	size_t start = 0;
+
+	// Runs of '*' are equivalent to a single '*', so empty segments are simply dropped.
+	while (start < pattern.size())
+	{
+		size_t end = pattern.find(WILDCARD_ANY_SEQUENCE, start);
+
+		if (end == std::wstring_view::npos)
+		{
+			end = pattern.size();
+		}
+
+		if (end > start)
+		{
+			compiledPattern.segments.emplace_back(pattern.substr(start, end - start));
+			compiledPattern.minLength += end - start;
+		}
+
+		start = end + 1;
+	}
+
+	if (pattern.find(WILDCARD_ANY_SEQUENCE) == std::wstring_view::npos)
+	{
+		compiledPattern.type = PatternType::Literal;
+
+		// An empty pattern only matches an empty string.
+		if (compiledPattern.segments.empty())
+		{
+			compiledPattern.segments.emplace_back();
+		}
+	}
+	else if (!compiledPattern.anchoredAtStart && compiledPattern.anchoredAtEnd
+		&& compiledPattern.segments.size() == 1)
+	{
+		compiledPattern.type = PatternType::Suffix;
+	}
+	else
+	{
+		compiledPattern.type = PatternType::General;
+	}
+
+	return compiledPattern;
+}
+
+// Returns true if the pattern is of the form "*.ext", where "ext" contains no further '.' or
+// wildcard characters. Such a pattern matches exactly those strings whose final extension is
+// "ext".
+bool WildcardMatcher::IsExtensionPattern(const CompiledPattern &pattern)
+{
+	if (pattern.type != PatternType::Suffix)
+	{
+		return false;
+	}
+
+	const auto &suffix = pattern.segments[0];
+
+	return suffix[0] == EXTENSION_SEPARATOR
+		&& suffix.find(EXTENSION_SEPARATOR, 1) == std::wstring::npos
+		&& suffix.find(WILDCARD_ANY_CHARACTER) == std::wstring::npos;
+}
+
+bool WildcardMatcher::Match(std::wstring_view str) const
+{
+	if (m_caseSensitive || str.empty())
+	{
+		return MatchFolded(str);
+	}
+
+	// The string is folded once, up front, so that each of the patterns can then be matched using
+	// plain character comparisons. Filenames longer than MAX_PATH are rare, so the stack buffer
+	// will almost always be sufficient.
+	wchar_t stackBuffer[MAX_PATH];
+	std::unique_ptr<wchar_t[]> heapBuffer;
+	wchar_t *buffer = stackBuffer;
+
+	if (str.size() > SIZEOF_ARRAY(stackBuffer))
+	{
+		heapBuffer = std::make_unique<wchar_t[]>(str.size());
+		buffer = heapBuffer.get();
+	}
+
+	int length = LCMapString(LOCALE_USER_DEFAULT, LCMAP_LOWERCASE, str.data(),
+		static_cast<int>(str.size()), buffer, static_cast<int>(str.size()));
+
+	if (length == 0)
+	{
+		return false;
+	}
+
+	return MatchFolded(std::wstring_view(buffer, length));
+}
+
+bool WildcardMatcher::MatchFolded(std::wstring_view str) const
+{
+	if (!m_extensions.empty())
+	{
+		size_t extensionSeparator = str.rfind(EXTENSION_SEPARATOR);
+
+		// Most extensions are short enough that constructing the key here won't allocate.
+		if (extensionSeparator != std::wstring_view::npos
+			&& m_extensions.count(std::wstring(str.substr(extensionSeparator + 1))) > 0)
+		{
+			return true;
+		}
+	}
+
+	for (const auto &pattern : m_patterns)
+	{
+		if (MatchPattern(pattern, str))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool WildcardMatcher::MatchPattern(const CompiledPattern &pattern, std::wstring_view str)
+{
+	if (str.size() < pattern.minLength)
+	{
+		return false;
+	}
+
+	switch (pattern.type)
+	{
+	case PatternType::Literal:
+		return str.size() == pattern.minLength && SegmentMatchesAt(pattern.segments[0], str, 0);
+
+	case PatternType::Suffix:
+		return SegmentMatchesAt(pattern.segments[0], str, str.size() - pattern.minLength);
+
+	case PatternType::General:
+		break;
+	}
+
+	size_t start = 0;
+	size_t end = str.size();
+	auto firstSegment = pattern.segments.begin();
+	auto lastSegment = pattern.segments.end();
+
+	if (pattern.anchoredAtStart)
+	{
+		if (!SegmentMatchesAt(*firstSegment, str, 0))
+		{
+			return false;
+		}
+
+		start += firstSegment->size();
+		++firstSegment;
+	}
+
+	if (pattern.anchoredAtEnd)
+	{
+		--lastSegment;
+
+		// The length check above guarantees that this segment can't overlap with the first.
+		if (!SegmentMatchesAt(*lastSegment, str, end - lastSegment->size()))
+		{
+			return false;
+		}
+
+		end -= lastSegment->size();
+	}
+
+	// Each of the remaining segments is surrounded by '*' wildcards. Matching each one at the
+	// earliest possible position leaves the most room for the segments that follow, so if this
+	// fails, there's no way the pattern could match.
+	for (auto itr = firstSegment; itr != lastSegment; ++itr)
+	{
+		size_t position = FindSegment(*itr, str, start, end);
+
+		if (position == std::wstring_view::npos)
+		{
+			return false;
+		}
+
+		start = position + itr->size();
+	}
+
+	return true;
+}
+
+bool WildcardMatcher::SegmentMatchesAt(
+	std::wstring_view segment, std::wstring_view str, size_t pos)
+{
+	for (size_t i = 0; i < segment.size(); i++)
+	{
+		if (segment[i] != WILDCARD_ANY_CHARACTER && segment[i] != str[pos + i])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+size_t WildcardMatcher::FindSegment(
+	std::wstring_view segment, std::wstring_view str, size_t start, size_t end)
+{
+	if (end < start || (end - start) < segment.size())
+	{
+		return std::wstring_view::npos;
+	}
+
+	auto window = str.substr(start, end - start);
+
+	if (segment.find(WILDCARD_ANY_CHARACTER) == std::wstring_view::npos)
+	{
+		size_t position = window.find(segment);
+		return position == std::wstring_view::npos ? position : start + position;
+	}
+
+	for (size_t i = 0; i + segment.size() <= window.size(); i++)
+	{
+		if (SegmentMatchesAt(segment, window, i))
+		{
+			return start + i;
+		}
+	}
+
+	return std::wstring_view::npos;
+}
+
+bool WildcardMatcher::IsSubsetOf(const WildcardMatcher &other) const
+{
+	if (m_caseSensitive != other.m_caseSensitive)
+	{
+		return false;
+	}
+
+	for (const auto &source : m_patternSources)
+	{
+		bool covered = std::any_of(other.m_patternSources.begin(), other.m_patternSources.end(),
+			[&source](const std::wstring &otherSource) {
+				return PatternCovers(otherSource, source);
+			});
+
+		if (!covered)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+std::vector<std::wstring> WildcardMatcher::GetRequiredLiterals() const
+{
+	// The sub-patterns are alternatives, so there's nothing that's required of every match
+	// unless there's only a single sub-pattern.
+	if (m_patternSources.size() != 1)
+	{
+		return {};
+	}
+
+	if (!m_extensions.empty())
+	{
+		return { EXTENSION_SEPARATOR + *m_extensions.begin() };
+	}
+
+	std::vector<std::wstring> literals;
+
+	for (const auto &segment : m_patterns[0].segments)
+	{
+		size_t start = 0;
+
+		while (start < segment.size())
+		{
+			size_t end = segment.find(WILDCARD_ANY_CHARACTER, start);
+
+			if (end == std::wstring::npos)
+			{
+				end = segment.size();
+			}
+
+			if (end > start)
+			{
+				literals.push_back(segment.substr(start, end - start));
+			}
+
+			start = end + 1;
+		}
+	}
+
+	return literals;
+}
+
+// Returns true if the general pattern matches every string that the specific pattern matches.
+// That's the case if the general pattern matches the text of the specific pattern, with the
+// restriction that a '*' in the specific pattern can only be matched by a '*' in the general
+// pattern and a '?' in the specific pattern can only be matched by a '?' or '*'.
+bool WildcardMatcher::PatternCovers(std::wstring_view general, std::wstring_view specific)
+{
+	// previousRow[j] indicates whether the first i - 1 characters of the general pattern cover
+	// the first j characters of the specific pattern. currentRow holds the same for i characters.
+	std::vector<bool> previousRow(specific.size() + 1, false);
+	std::vector<bool> currentRow(specific.size() + 1, false);
+	previousRow[0] = true;
+
+	for (wchar_t generalChar : general)
+	{
+		currentRow[0] = previousRow[0] && generalChar == WILDCARD_ANY_SEQUENCE;
+
+		for (size_t j = 1; j <= specific.size(); j++)
+		{
+			wchar_t specificChar = specific[j - 1];
+
+			if (generalChar == WILDCARD_ANY_SEQUENCE)
+			{
+				currentRow[j] = previousRow[j] || currentRow[j - 1];
+			}
+			else if (generalChar == WILDCARD_ANY_CHARACTER)
+			{
+				currentRow[j] = previousRow[j - 1] && specificChar != WILDCARD_ANY_SEQUENCE;
+			}
+			else
+			{
+				currentRow[j] = previousRow[j - 1] && specificChar == generalChar;
+			}
+		}
+
+		std::swap(previousRow, currentRow);
+	}
+
+	return previousRow[specific.size()];
+}
@@ -0,0 +1,88 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "FilenameMatcher.h"
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+// Compiles a wildcard pattern once, so that it can then be matched against any number of strings.
+// The pattern can contain multiple sub-patterns, separated by ':' (e.g. "*.h: *.cpp"), in which
+// case a string matches if it matches any of the sub-patterns.
+//
+// Within each sub-pattern, '*' matches any sequence of characters and '?' matches exactly one
+// character. Matching never backtracks over a '*', so the cost of a match is bounded by the
+// length of the string multiplied by the length of the pattern.
+//
+// Sub-patterns that simply match an extension (e.g. "*.txt") are merged into a single hashed set,
+// so a list made up of extensions costs one lookup per string, regardless of its length.
+class WildcardMatcher : public FilenameMatcher
+{
+public:
+	WildcardMatcher(std::wstring_view patternList, bool caseSensitive);
+
+	bool Match(std::wstring_view str) const override;
+
+	// Returns true if every string matched by this matcher is guaranteed to also be matched by
+	// the other matcher. This is a conservative check - a false result doesn't necessarily mean
+	// that the two sets of matches differ. It's intended to allow the results of a previous
+	// match to be reused when a pattern is refined (e.g. from "*abc*" to "*abcd*").
+	bool IsSubsetOf(const WildcardMatcher &other) const;
+
+	std::vector<std::wstring> GetRequiredLiterals() const override;
+
+private:
+	enum class PatternType
+	{
+		// The pattern contains no wildcards and has to match the entire string.
+		Literal,
+
+		// The pattern is '*' followed by a literal (e.g. "*.txt"). This is the most common form
+		// of pattern and only requires a single comparison against the end of the string.
+		Suffix,
+
+		// Any other pattern.
+		General
+	};
+
+	struct CompiledPattern
+	{
+		PatternType type;
+
+		// The literal pieces of the pattern, in order. The '*' wildcards are the implicit
+		// separators between the segments.
+		std::vector<std::wstring> segments;
+
+		bool anchoredAtStart;
+		bool anchoredAtEnd;
+
+		// The sum of the lengths of all the segments.
+		size_t minLength;
+	};
+
+	static CompiledPattern CompilePattern(std::wstring_view pattern);
+	static bool IsExtensionPattern(const CompiledPattern &pattern);
+	void AddPattern(std::wstring_view pattern);
+	static bool MatchPattern(const CompiledPattern &pattern, std::wstring_view str);
+	static bool SegmentMatchesAt(std::wstring_view segment, std::wstring_view str, size_t pos);
+	static size_t FindSegment(
+		std::wstring_view segment, std::wstring_view str, size_t start, size_t end);
+	static bool PatternCovers(std::wstring_view general, std::wstring_view specific);
+
+	bool MatchFolded(std::wstring_view str) const;
+
+	bool m_caseSensitive;
+
+	// Extensions (without the leading '.') from all sub-patterns of the form "*.ext".
+	std::unordered_set<std::wstring> m_extensions;
+
+	// All remaining sub-patterns.
+	std::vector<CompiledPattern> m_patterns;
+
+	// The original text of each sub-pattern (folded, if the matcher is case-insensitive).
+	std::vector<std::wstring> m_patternSources;
+};
@@ -0,0 +1,158 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "XxHash64.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	const uint64_t PRIME1 = 11400714785074694791ULL;
+	const uint64_t PRIME2 = 14029467366897019727ULL;
+	const uint64_t PRIME3 = 1609587929392839161ULL;
+	const uint64_t PRIME4 = 9650029242287828579ULL;
+	const uint64_t PRIME5 = 2870177450012600261ULL;
+
+	uint64_t RotateLeft(uint64_t value, int bits)
+	{
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+	// The algorithm is defined in terms of little-endian reads, which is what every platform this
+	// is built for uses natively.
+	uint64_t Read64(const unsigned char *data)
+	{
+		uint64_t value;
+		std::memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	uint32_t Read32(const unsigned char *data)
+	{
+		uint32_t value;
+		std::memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	uint64_t Round(uint64_t accumulator, uint64_t input)
+	{
+		accumulator += input * PRIME2;
+		accumulator = RotateLeft(accumulator, 31);
+		return accumulator * PRIME1;
+	}
+
+	uint64_t MergeAccumulator(uint64_t hash, uint64_t accumulator)
+	{
+		hash ^= Round(0, accumulator);
+		return hash * PRIME1 + PRIME4;
+	}
+}
+
+XxHash64::XxHash64(uint64_t seed) :
+	m_seed(seed),
+	m_accumulators{ seed + PRIME1 + PRIME2, seed + PRIME2, seed, seed - PRIME1 }
+{
+}
+
+void XxHash64::Update(const void *data, size_t size)
+{
+	auto *input = static_cast<const unsigned char *>(data);
+	m_totalSize += size;
+
+	if (m_bufferSize > 0)
+	{
+		size_t bytesToCopy = std::min(size, STRIPE_SIZE - m_bufferSize);
+		std::memcpy(m_buffer + m_bufferSize, input, bytesToCopy);
+		m_bufferSize += bytesToCopy;
+		input += bytesToCopy;
+		size -= bytesToCopy;
+
+		if (m_bufferSize < STRIPE_SIZE)
+		{
+			return;
+		}
+
+		ProcessStripe(m_buffer);
+		m_bufferSize = 0;
+	}
+
+	// Full stripes are processed straight from the input, without being copied.
+	while (size >= STRIPE_SIZE)
+	{
+		ProcessStripe(input);
+		input += STRIPE_SIZE;
+		size -= STRIPE_SIZE;
+	}
+
+	std::memcpy(m_buffer, input, size);
+	m_bufferSize = size;
+}
+
+void XxHash64::ProcessStripe(const unsigned char *stripe)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		m_accumulators[i] = Round(m_accumulators[i], Read64(stripe + i * sizeof(uint64_t)));
+	}
+}
+
+uint64_t XxHash64::GetHash() const
+{
+	uint64_t hash;
+
+	if (m_totalSize >= STRIPE_SIZE)
+	{
+		hash = RotateLeft(m_accumulators[0], 1) + RotateLeft(m_accumulators[1], 7)
+			+ RotateLeft(m_accumulators[2], 12) + RotateLeft(m_accumulators[3], 18);
+
+		for (uint64_t accumulator : m_accumulators)
+		{
+			hash = MergeAccumulator(hash, accumulator);
+		}
+	}
+	else
+	{
+		hash = m_seed + PRIME5;
+	}
+
+	hash += m_totalSize;
+
+	const unsigned char *remaining = m_buffer;
+	const unsigned char *end = m_buffer + m_bufferSize;
+
+	for (; remaining + sizeof(uint64_t) <= end; remaining += sizeof(uint64_t))
+	{
+		hash ^= Round(0, Read64(remaining));
+		hash = RotateLeft(hash, 27) * PRIME1 + PRIME4;
+	}
+
+	if (remaining + sizeof(uint32_t) <= end)
+	{
+		hash ^= Read32(remaining) * PRIME1;
+		hash = RotateLeft(hash, 23) * PRIME2 + PRIME3;
+		remaining += sizeof(uint32_t);
+	}
+
+	for (; remaining < end; remaining++)
+	{
+		hash ^= *remaining * PRIME5;
+		hash = RotateLeft(hash, 11) * PRIME1;
+	}
+
+	hash ^= hash >> 33;
+	hash *= PRIME2;
+	hash ^= hash >> 29;
+	hash *= PRIME3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
+
+uint64_t XxHash64::Hash(const void *data, size_t size, uint64_t seed)
+{
+	XxHash64 hash(seed);
+	hash.Update(data, size);
+	return hash.GetHash();
+}
@@ -0,0 +1,39 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// A streaming implementation of the 64-bit xxHash algorithm (XXH64). This is a non-cryptographic
+// hash that runs at close to memory speed, which makes it suitable for comparing the contents of
+// large files, where the time taken is dominated by reading the data. The output matches that of
+// the reference implementation.
+class XxHash64
+{
+public:
+	explicit XxHash64(uint64_t seed = 0);
+
+	void Update(const void *data, size_t size);
+
+	// Doesn't modify the state, so more data can still be added afterwards.
+	uint64_t GetHash() const;
+
+	static uint64_t Hash(const void *data, size_t size, uint64_t seed = 0);
+
+private:
+	static constexpr size_t STRIPE_SIZE = 32;
+
+	void ProcessStripe(const unsigned char *stripe);
+
+	uint64_t m_seed;
+	uint64_t m_accumulators[4];
+
+	// Data that doesn't yet make up a full stripe.
+	unsigned char m_buffer[STRIPE_SIZE];
+	size_t m_bufferSize = 0;
+
+	uint64_t m_totalSize = 0;
+};
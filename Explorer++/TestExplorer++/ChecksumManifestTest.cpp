@@ -0,0 +1,53 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/ChecksumManifest.h"
+#include <gtest/gtest.h>
+
+using namespace testing;
+
+TEST(ChecksumManifestTest, Format)
+{
+	std::vector<ChecksumManifest::Entry> entries = { { L"file.txt.part1", 0x0123456789ABCDEFULL },
+		{ L"file.txt.part2", 0x2AULL } };
+
+	EXPECT_EQ(ChecksumManifest::Format(entries),
+		"0123456789abcdef  file.txt.part1\n"
+		"000000000000002a  file.txt.part2\n");
+}
+
+TEST(ChecksumManifestTest, RoundTrip)
+{
+	std::vector<ChecksumManifest::Entry> entries = { { L"part1", 0xFFFFFFFFFFFFFFFFULL },
+		{ L"name with spaces", 0 }, { L"\u00e9t\u00e9.part3", 0xEF46DB3751D8E999ULL } };
+
+	auto parsedEntries = ChecksumManifest::Parse(ChecksumManifest::Format(entries));
+
+	ASSERT_EQ(parsedEntries.size(), entries.size());
+
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		EXPECT_EQ(parsedEntries[i].filename, entries[i].filename);
+		EXPECT_EQ(parsedEntries[i].hash, entries[i].hash);
+	}
+}
+
+TEST(ChecksumManifestTest, ParseVariations)
+{
+	// Windows line endings, upper-case digits and binary mode markers are all accepted, while
+	// lines that aren't in the expected format are skipped.
+	auto entries = ChecksumManifest::Parse("0123456789ABCDEF *part1\r\n"
+										   "\r\n"
+										   "not a checksum line\n"
+										   "0123456789abcdeg  part2\n"
+										   "0123456789abcdef part3\n"
+										   "0123456789abcdef  \n"
+										   "00000000000000ff  part4");
+
+	ASSERT_EQ(entries.size(), 2U);
+	EXPECT_EQ(entries[0].filename, L"part1");
+	EXPECT_EQ(entries[0].hash, 0x0123456789ABCDEFULL);
+	EXPECT_EQ(entries[1].filename, L"part4");
+	EXPECT_EQ(entries[1].hash, 0xFFULL);
+}
@@ -0,0 +1,131 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "TemporaryDirectoryHelper.h"
+#include "../Helper/DirectoryListing.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using namespace testing;
+
+class DirectoryListingTest : public Test
+{
+protected:
+	DirectoryListingTest() :
+		m_rootDirectory(m_temporaryDirectory.GetPath()),
+		m_listedDirectory(m_rootDirectory / L"listed")
+	{
+		m_temporaryDirectory.CreateTestFile(m_listedDirectory / L"file1", 10);
+		m_temporaryDirectory.CreateTestFile(m_listedDirectory / L"folder" / L"file2", 20);
+	}
+
+	std::string SaveListing(const DirectoryListing::Options &options)
+	{
+		auto outputPath = m_rootDirectory / L"listing";
+		EXPECT_TRUE(
+			DirectoryListing::Save(m_listedDirectory.wstring(), outputPath.wstring(), options));
+
+		std::ifstream stream(outputPath, std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(stream), {});
+	}
+
+	static WIN32_FIND_DATA BuildFindData(DWORD attributes, ULONGLONG size)
+	{
+		WIN32_FIND_DATA findData = {};
+		findData.dwFileAttributes = attributes;
+		findData.nFileSizeHigh = static_cast<DWORD>(size >> 32);
+		findData.nFileSizeLow = static_cast<DWORD>(size);
+
+		// 2020-01-02 03:04:05 UTC.
+		SYSTEMTIME systemTime = { 2020, 1, 4, 2, 3, 4, 5, 0 };
+		SystemTimeToFileTime(&systemTime, &findData.ftLastWriteTime);
+
+		return findData;
+	}
+
+	TemporaryDirectory m_temporaryDirectory;
+	std::filesystem::path m_rootDirectory;
+	std::filesystem::path m_listedDirectory;
+};
+
+TEST_F(DirectoryListingTest, AppendCsvEntry)
+{
+	std::string output;
+	DirectoryListing::AppendEntry(DirectoryListing::Format::Csv, L"a\\b, \"c\".txt",
+		BuildFindData(FILE_ATTRIBUTE_ARCHIVE, 0x100000001ULL), output);
+	DirectoryListing::AppendEntry(DirectoryListing::Format::Csv, L"folder",
+		BuildFindData(FILE_ATTRIBUTE_DIRECTORY, 0), output);
+
+	EXPECT_EQ(output,
+		"\"a\\b, \"\"c\"\".txt\",file,4294967297,2020-01-02T03:04:05Z,32\r\n"
+		"folder,folder,,2020-01-02T03:04:05Z,16\r\n");
+}
+
+TEST_F(DirectoryListingTest, AppendJsonEntry)
+{
+	std::string output;
+	DirectoryListing::AppendEntry(DirectoryListing::Format::JsonLines, L"a\\\"b\u00e9\t",
+		BuildFindData(FILE_ATTRIBUTE_ARCHIVE, 42), output);
+	DirectoryListing::AppendEntry(DirectoryListing::Format::JsonLines, L"folder",
+		BuildFindData(FILE_ATTRIBUTE_DIRECTORY, 0), output);
+
+	EXPECT_EQ(output,
+		"{\"path\":\"a\\\\\\\"b\xC3\xA9\\u0009\",\"type\":\"file\",\"size\":42,"
+		"\"modified\":\"2020-01-02T03:04:05Z\",\"attributes\":32}\n"
+		"{\"path\":\"folder\",\"type\":\"folder\",\"modified\":\"2020-01-02T03:04:05Z\","
+		"\"attributes\":16}\n");
+}
+
+TEST_F(DirectoryListingTest, SaveText)
+{
+	DirectoryListing::Options options;
+	auto listing = SaveListing(options);
+
+	// Folders are listed before files.
+	auto foldersPosition = listing.find("Folders\r\n-------\r\nfolder\r\n");
+	auto filesPosition = listing.find("Files\r\n-----\r\nfile1\r\n");
+	EXPECT_NE(foldersPosition, std::string::npos);
+	EXPECT_NE(filesPosition, std::string::npos);
+	EXPECT_LT(foldersPosition, filesPosition);
+
+	EXPECT_EQ(listing.find("file2"), std::string::npos);
+	EXPECT_NE(listing.find("Number of folders: 1\r\n"), std::string::npos);
+	EXPECT_NE(listing.find("Number of files: 1\r\n"), std::string::npos);
+}
+
+TEST_F(DirectoryListingTest, SaveRecursive)
+{
+	DirectoryListing::Options options;
+	options.format = DirectoryListing::Format::JsonLines;
+	options.recursive = true;
+	auto listing = SaveListing(options);
+
+	EXPECT_EQ(std::count(listing.begin(), listing.end(), '\n'), 3);
+	EXPECT_NE(listing.find("{\"path\":\"folder\",\"type\":\"folder\""), std::string::npos);
+	EXPECT_NE(
+		listing.find("{\"path\":\"file1\",\"type\":\"file\",\"size\":10,"), std::string::npos);
+	EXPECT_NE(listing.find("{\"path\":\"folder\\\\file2\",\"type\":\"file\",\"size\":20,"),
+		std::string::npos);
+}
+
+TEST_F(DirectoryListingTest, OutputFileNotListed)
+{
+	auto outputPath = m_listedDirectory / L"listing.csv";
+
+	DirectoryListing::Options options;
+	options.format = DirectoryListing::GetFormatForFileName(outputPath.wstring());
+	ASSERT_EQ(options.format, DirectoryListing::Format::Csv);
+	ASSERT_TRUE(
+		DirectoryListing::Save(m_listedDirectory.wstring(), outputPath.wstring(), options));
+
+	std::ifstream stream(outputPath, std::ios::binary);
+	std::string listing(std::istreambuf_iterator<char>(stream), {});
+
+	EXPECT_EQ(listing.find("listing.csv"), std::string::npos);
+	EXPECT_EQ(listing.rfind("\xEF\xBB\xBFPath,Type,Size,Modified,Attributes\r\n", 0), 0U);
+}
@@ -0,0 +1,191 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "TemporaryDirectoryHelper.h"
+#include "../Helper/DuplicateFileFinder.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <string>
+
+using namespace testing;
+
+class DuplicateFileFinderTest : public Test
+{
+protected:
+	DuplicateFileFinderTest() : m_rootDirectory(m_temporaryDirectory.GetPath())
+	{
+	}
+
+	std::wstring CreateTestFile(const std::filesystem::path &relativePath,
+		const std::string &contents)
+	{
+		return m_temporaryDirectory.CreateTestFile(relativePath, contents).wstring();
+	}
+
+	// Generates content that doesn't repeat over short distances, so that any change to it is
+	// significant.
+	static std::string GenerateContents(size_t size, unsigned int seed)
+	{
+		std::string contents(size, '\0');
+		unsigned int state = seed;
+
+		for (auto &c : contents)
+		{
+			state = state * 1103515245 + 12345;
+			c = static_cast<char>(state >> 16);
+		}
+
+		return contents;
+	}
+
+	TemporaryDirectory m_temporaryDirectory;
+	std::filesystem::path m_rootDirectory;
+};
+
+TEST_F(DuplicateFileFinderTest, SmallFiles)
+{
+	auto path1 = CreateTestFile(L"a.txt", "duplicate");
+	auto path2 = CreateTestFile(L"folder\\b.txt", "duplicate");
+
+	// The same size as the files above, but different contents.
+	CreateTestFile(L"c.txt", "different");
+
+	CreateTestFile(L"d.txt", "unique size");
+
+	DuplicateFileFinder finder(4);
+	auto duplicateSets = finder.Find(m_rootDirectory.wstring(), true);
+
+	ASSERT_EQ(duplicateSets.size(), 1U);
+	EXPECT_EQ(duplicateSets[0].size, 9U);
+	EXPECT_EQ(duplicateSets[0].paths, (std::vector<std::wstring>{ path1, path2 }));
+	EXPECT_EQ(finder.GetProgress().stage, DuplicateFileFinder::Stage::Finished);
+	EXPECT_EQ(finder.GetProgress().filesFound, 4);
+}
+
+TEST_F(DuplicateFileFinderTest, NonRecursive)
+{
+	CreateTestFile(L"a.txt", "duplicate");
+	CreateTestFile(L"folder\\b.txt", "duplicate");
+
+	DuplicateFileFinder finder(4);
+	auto duplicateSets = finder.Find(m_rootDirectory.wstring(), false);
+
+	EXPECT_TRUE(duplicateSets.empty());
+}
+
+TEST_F(DuplicateFileFinderTest, LargeFiles)
+{
+	size_t size = 4 * DuplicateFileFinder::PARTIAL_HASH_SIZE;
+	auto contents = GenerateContents(size, 1);
+
+	auto path1 = CreateTestFile(L"a.bin", contents);
+	auto path2 = CreateTestFile(L"b.bin", contents);
+
+	// This file only differs in the middle, so the partial hash won't be able to tell it apart
+	// from the files above.
+	auto modifiedContents = contents;
+	modifiedContents[size / 2] ^= 1;
+	CreateTestFile(L"c.bin", modifiedContents);
+
+	DuplicateFileFinder finder(4);
+	auto duplicateSets = finder.Find(m_rootDirectory.wstring(), true);
+
+	ASSERT_EQ(duplicateSets.size(), 1U);
+	EXPECT_EQ(duplicateSets[0].paths, (std::vector<std::wstring>{ path1, path2 }));
+}
+
+TEST_F(DuplicateFileFinderTest, SetOrder)
+{
+	auto smallContents = GenerateContents(1000, 1);
+	auto largeContents = GenerateContents(100000, 2);
+
+	auto smallPath1 = CreateTestFile(L"small1.bin", smallContents);
+	auto smallPath2 = CreateTestFile(L"small2.bin", smallContents);
+	auto smallPath3 = CreateTestFile(L"small3.bin", smallContents);
+	auto largePath1 = CreateTestFile(L"large1.bin", largeContents);
+	auto largePath2 = CreateTestFile(L"large2.bin", largeContents);
+
+	DuplicateFileFinder finder(4);
+	auto duplicateSets = finder.Find(m_rootDirectory.wstring(), true);
+
+	// The set that wastes the most space should come first, regardless of the number of files in
+	// it.
+	ASSERT_EQ(duplicateSets.size(), 2U);
+	EXPECT_EQ(duplicateSets[0].paths, (std::vector<std::wstring>{ largePath1, largePath2 }));
+	EXPECT_EQ(duplicateSets[1].paths,
+		(std::vector<std::wstring>{ smallPath1, smallPath2, smallPath3 }));
+}
+
+TEST_F(DuplicateFileFinderTest, HardLinks)
+{
+	auto path1 = CreateTestFile(L"a.txt", "duplicate");
+	auto path2 = (m_rootDirectory / L"b.txt").wstring();
+	ASSERT_TRUE(CreateHardLink(path2.c_str(), path1.c_str(), nullptr));
+
+	DuplicateFileFinder finder(4);
+	auto duplicateSets = finder.Find(m_rootDirectory.wstring(), true);
+
+	// Both paths refer to the same file, so removing one of them wouldn't free any space.
+	EXPECT_TRUE(duplicateSets.empty());
+
+	auto path3 = CreateTestFile(L"c.txt", "duplicate");
+
+	DuplicateFileFinder finder2(4);
+	duplicateSets = finder2.Find(m_rootDirectory.wstring(), true);
+
+	// Only the first link to the file should be returned.
+	ASSERT_EQ(duplicateSets.size(), 1U);
+	EXPECT_EQ(duplicateSets[0].paths, (std::vector<std::wstring>{ path1, path3 }));
+}
+
+TEST_F(DuplicateFileFinderTest, EmptyFiles)
+{
+	CreateTestFile(L"a.txt", "");
+	CreateTestFile(L"b.txt", "");
+
+	DuplicateFileFinder finder(4);
+	auto duplicateSets = finder.Find(m_rootDirectory.wstring(), true);
+
+	EXPECT_TRUE(duplicateSets.empty());
+}
+
+TEST_F(DuplicateFileFinderTest, ManyFiles)
+{
+	// Generates 10 sets of 3 duplicates, interleaved with unique files of the same sizes.
+	for (int i = 0; i < 10; i++)
+	{
+		auto contents = GenerateContents(100 + i, i);
+
+		for (int j = 0; j < 3; j++)
+		{
+			CreateTestFile(L"folder" + std::to_wstring(j) + L"\\dup" + std::to_wstring(i),
+				contents);
+		}
+
+		CreateTestFile(L"unique" + std::to_wstring(i), GenerateContents(100 + i, 100 + i));
+	}
+
+	DuplicateFileFinder finder(4);
+	auto duplicateSets = finder.Find(m_rootDirectory.wstring(), true);
+
+	ASSERT_EQ(duplicateSets.size(), 10U);
+
+	for (const auto &duplicateSet : duplicateSets)
+	{
+		EXPECT_EQ(duplicateSet.paths.size(), 3U);
+	}
+}
+
+TEST_F(DuplicateFileFinderTest, Stop)
+{
+	CreateTestFile(L"a.txt", "duplicate");
+	CreateTestFile(L"b.txt", "duplicate");
+
+	DuplicateFileFinder finder(4);
+	finder.Stop();
+	auto duplicateSets = finder.Find(m_rootDirectory.wstring(), true);
+
+	EXPECT_TRUE(finder.IsStopped());
+	EXPECT_TRUE(duplicateSets.empty());
+}
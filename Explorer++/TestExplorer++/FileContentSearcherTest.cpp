@@ -0,0 +1,125 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/FileContentSearcher.h"
+#include <gtest/gtest.h>
+
+using namespace testing;
+
+namespace
+{
+	std::string ToUtf16Contents(const std::wstring &text)
+	{
+		std::string contents = "\xFF\xFE";
+
+		for (wchar_t c : text)
+		{
+			contents += static_cast<char>(c & 0xFF);
+			contents += static_cast<char>((c >> 8) & 0xFF);
+		}
+
+		return contents;
+	}
+}
+
+TEST(FileContentSearcherTest, LineNumbers)
+{
+	FileContentSearcher searcher(L"error", true);
+
+	EXPECT_EQ(searcher.SearchContents("error\nok\nerror error\n\nan error"),
+		std::vector<int>({ 1, 3, 5 }));
+	EXPECT_EQ(searcher.SearchContents("ok\nok\n"), std::vector<int>());
+	EXPECT_EQ(searcher.SearchContents(""), std::vector<int>());
+}
+
+TEST(FileContentSearcherTest, CaseSensitivity)
+{
+	FileContentSearcher caseSensitiveSearcher(L"Error", true);
+	EXPECT_EQ(caseSensitiveSearcher.SearchContents("ERROR\nError\nerror"), std::vector<int>({ 2 }));
+
+	FileContentSearcher caseInsensitiveSearcher(L"Error", false);
+	EXPECT_EQ(caseInsensitiveSearcher.SearchContents("ERROR\nError\nerror"),
+		std::vector<int>({ 1, 2, 3 }));
+}
+
+TEST(FileContentSearcherTest, MatchesSpanningChunks)
+{
+	std::string contents = "first line\nsecond line\nthird line\nfourth line\n";
+
+	// Each possible chunk size splits the matches at a different point.
+	for (size_t chunkSize = 1; chunkSize < contents.size(); chunkSize++)
+	{
+		FileContentSearcher searcher(L"line\nthird", true,
+			FileContentSearcher::DEFAULT_MAX_FILE_SIZE, nullptr, chunkSize);
+		EXPECT_EQ(searcher.SearchContents(contents), std::vector<int>({ 2 })) << chunkSize;
+
+		FileContentSearcher lineSearcher(L"th line", false,
+			FileContentSearcher::DEFAULT_MAX_FILE_SIZE, nullptr, chunkSize);
+		EXPECT_EQ(lineSearcher.SearchContents(contents), std::vector<int>({ 4 })) << chunkSize;
+	}
+}
+
+TEST(FileContentSearcherTest, Utf16)
+{
+	std::string contents = ToUtf16Contents(L"one\r\ntwo\r\nTHREE");
+
+	// The first chunk needs to be large enough to contain the byte order mark.
+	for (size_t chunkSize = 2; chunkSize < contents.size(); chunkSize++)
+	{
+		FileContentSearcher searcher(
+			L"three", false, FileContentSearcher::DEFAULT_MAX_FILE_SIZE, nullptr, chunkSize);
+		EXPECT_EQ(searcher.SearchContents(contents), std::vector<int>({ 3 })) << chunkSize;
+	}
+}
+
+TEST(FileContentSearcherTest, Utf8)
+{
+	FileContentSearcher searcher(L"\u00E9t\u00E9", true);
+	EXPECT_EQ(searcher.SearchContents("summer\n\xC3\xA9t\xC3\xA9"), std::vector<int>({ 2 }));
+}
+
+TEST(FileContentSearcherTest, Utf8CaseInsensitive)
+{
+	// "ÉTÉ", followed by "été", then a fullwidth "ＡＢ" (which is encoded using three bytes per
+	// character).
+	std::string contents = "\xC3\x89T\xC3\x89\n\xC3\xA9t\xC3\xA9\n\xEF\xBC\xA1\xEF\xBC\xA2";
+
+	// Each possible chunk size splits the multi-byte sequences at a different point.
+	for (size_t chunkSize = 1; chunkSize < contents.size(); chunkSize++)
+	{
+		FileContentSearcher searcher(L"\u00C9t\u00E9", false,
+			FileContentSearcher::DEFAULT_MAX_FILE_SIZE, nullptr, chunkSize);
+		EXPECT_EQ(searcher.SearchContents(contents), std::vector<int>({ 1, 2 })) << chunkSize;
+
+		FileContentSearcher fullwidthSearcher(L"\uFF41\uFF42", false,
+			FileContentSearcher::DEFAULT_MAX_FILE_SIZE, nullptr, chunkSize);
+		EXPECT_EQ(fullwidthSearcher.SearchContents(contents), std::vector<int>({ 3 })) << chunkSize;
+	}
+
+	// Bytes that don't form a valid sequence don't prevent the text around them from being
+	// folded.
+	FileContentSearcher invalidSequenceSearcher(L"ab", false,
+		FileContentSearcher::DEFAULT_MAX_FILE_SIZE, nullptr, 2);
+	EXPECT_EQ(invalidSequenceSearcher.SearchContents("\xE0\x41\x42\n\xC3\x41\x42"),
+		std::vector<int>({ 1, 2 }));
+}
+
+TEST(FileContentSearcherTest, BinaryContents)
+{
+	FileContentSearcher searcher(L"text", true);
+	EXPECT_EQ(searcher.SearchContents(std::string("text\0text", 9)), std::vector<int>());
+}
+
+TEST(FileContentSearcherTest, MaxLineNumbers)
+{
+	std::string contents;
+
+	for (size_t i = 0; i < FileContentSearcher::MAX_LINE_NUMBERS * 2; i++)
+	{
+		contents += "match\n";
+	}
+
+	FileContentSearcher searcher(L"match", true);
+	EXPECT_EQ(searcher.SearchContents(contents).size(), FileContentSearcher::MAX_LINE_NUMBERS);
+}
@@ -0,0 +1,226 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "TemporaryDirectoryHelper.h"
+#include "../Helper/FileCopier.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string_view>
+#include <vector>
+
+using namespace testing;
+
+namespace
+{
+	std::vector<unsigned char> BuildData(size_t size)
+	{
+		std::vector<unsigned char> data(size);
+
+		for (size_t i = 0; i < data.size(); i++)
+		{
+			data[i] = static_cast<unsigned char>(i * 31 + 7);
+		}
+
+		return data;
+	}
+
+	StreamCopier::ReadFunction ReadFromVector(
+		const std::vector<unsigned char> &source, size_t &offset)
+	{
+		return [&source, &offset](void *buffer, size_t size) -> std::optional<size_t> {
+			size_t bytesToRead = std::min(size, source.size() - offset);
+			std::memcpy(buffer, source.data() + offset, bytesToRead);
+			offset += bytesToRead;
+			return bytesToRead;
+		};
+	}
+
+	StreamCopier::WriteFunction WriteToVector(std::vector<unsigned char> &destination)
+	{
+		return [&destination](const void *buffer, size_t size) {
+			auto *data = static_cast<const unsigned char *>(buffer);
+			destination.insert(destination.end(), data, data + size);
+			return true;
+		};
+	}
+}
+
+TEST(FileCopierStreamTest, CopyAndVerify)
+{
+	FileCopier copier(true, FileCopier::DEFAULT_UNBUFFERED_THRESHOLD, 64, 3);
+
+	for (size_t size : { 0, 1, 64, 1000, 10000 })
+	{
+		auto source = BuildData(size);
+		size_t sourceOffset = 0;
+		std::vector<unsigned char> destination;
+		size_t readBackOffset = 0;
+
+		auto result = copier.CopyStream(ReadFromVector(source, sourceOffset),
+			WriteToVector(destination), ReadFromVector(destination, readBackOffset));
+
+		EXPECT_EQ(result, FileCopier::Result::Succeeded);
+		EXPECT_EQ(destination, source);
+		EXPECT_EQ(readBackOffset, size);
+	}
+}
+
+TEST(FileCopierStreamTest, VerificationFailure)
+{
+	FileCopier copier(true, FileCopier::DEFAULT_UNBUFFERED_THRESHOLD, 64, 3);
+	auto source = BuildData(1000);
+
+	// A single corrupted byte.
+	size_t sourceOffset = 0;
+	std::vector<unsigned char> destination;
+	auto corrupted = source;
+	corrupted[500] ^= 0x01;
+	size_t readBackOffset = 0;
+
+	auto result = copier.CopyStream(ReadFromVector(source, sourceOffset),
+		WriteToVector(destination), ReadFromVector(corrupted, readBackOffset));
+	EXPECT_EQ(result, FileCopier::Result::VerificationFailed);
+
+	// A destination that's shorter than the source.
+	sourceOffset = 0;
+	destination.clear();
+	std::vector<unsigned char> truncated(source.begin(), source.begin() + 999);
+	readBackOffset = 0;
+
+	result = copier.CopyStream(ReadFromVector(source, sourceOffset), WriteToVector(destination),
+		ReadFromVector(truncated, readBackOffset));
+	EXPECT_EQ(result, FileCopier::Result::VerificationFailed);
+
+	// A destination that can't be read back.
+	sourceOffset = 0;
+	destination.clear();
+
+	result = copier.CopyStream(ReadFromVector(source, sourceOffset), WriteToVector(destination),
+		[](void *, size_t) -> std::optional<size_t> { return std::nullopt; });
+	EXPECT_EQ(result, FileCopier::Result::VerificationFailed);
+}
+
+TEST(FileCopierStreamTest, WithoutVerification)
+{
+	FileCopier copier(false, FileCopier::DEFAULT_UNBUFFERED_THRESHOLD, 64, 3);
+	auto source = BuildData(1000);
+	size_t sourceOffset = 0;
+	std::vector<unsigned char> destination;
+
+	// The destination is never read back, so no read function is needed.
+	auto result = copier.CopyStream(
+		ReadFromVector(source, sourceOffset), WriteToVector(destination), nullptr);
+
+	EXPECT_EQ(result, FileCopier::Result::Succeeded);
+	EXPECT_EQ(destination, source);
+}
+
+TEST(FileCopierStreamTest, Failures)
+{
+	FileCopier copier(true, FileCopier::DEFAULT_UNBUFFERED_THRESHOLD, 64, 3);
+	auto source = BuildData(1000);
+	size_t sourceOffset = 0;
+	std::vector<unsigned char> destination;
+	size_t readBackOffset = 0;
+
+	auto result = copier.CopyStream(
+		[](void *, size_t) -> std::optional<size_t> { return std::nullopt; },
+		WriteToVector(destination), ReadFromVector(destination, readBackOffset));
+	EXPECT_EQ(result, FileCopier::Result::ReadFailed);
+
+	result = copier.CopyStream(ReadFromVector(source, sourceOffset),
+		[](const void *, size_t) { return false; }, ReadFromVector(destination, readBackOffset));
+	EXPECT_EQ(result, FileCopier::Result::WriteFailed);
+
+	copier.Stop();
+
+	sourceOffset = 0;
+	result = copier.CopyStream(ReadFromVector(source, sourceOffset), WriteToVector(destination),
+		ReadFromVector(destination, readBackOffset));
+	EXPECT_EQ(result, FileCopier::Result::Stopped);
+}
+
+class FileCopierTest : public Test
+{
+protected:
+	FileCopierTest() : m_directory(m_temporaryDirectory.GetPath())
+	{
+	}
+
+	void CreateTestFile(const std::filesystem::path &path, const std::vector<unsigned char> &data)
+	{
+		m_temporaryDirectory.CreateTestFile(
+			path, std::string_view(reinterpret_cast<const char *>(data.data()), data.size()));
+	}
+
+	std::vector<unsigned char> ReadTestFile(const std::filesystem::path &path)
+	{
+		std::ifstream stream(path, std::ios::binary);
+		return std::vector<unsigned char>(
+			std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+	}
+
+	TemporaryDirectory m_temporaryDirectory;
+	std::filesystem::path m_directory;
+};
+
+TEST_F(FileCopierTest, Copy)
+{
+	// A threshold of 0 means that every file is copied with unbuffered I/O. In that case, sizes
+	// that aren't a multiple of the sector size exercise the padding of the final block.
+	for (uint64_t unbufferedThreshold : { FileCopier::DEFAULT_UNBUFFERED_THRESHOLD, uint64_t{ 0 } })
+	{
+		FileCopier copier(true, unbufferedThreshold, 64 * 1024, 3);
+
+		for (size_t size : { 0, 1, 4095, 4096, 65536, 200000 })
+		{
+			auto source = m_directory / (L"source" + std::to_wstring(size));
+			auto destination = m_directory / (L"destination" + std::to_wstring(size));
+			auto data = BuildData(size);
+			CreateTestFile(source, data);
+
+			uint64_t lastProgress = 0;
+			auto result = copier.Copy(source, destination,
+				[&lastProgress](uint64_t bytesCopied) { lastProgress = bytesCopied; });
+
+			EXPECT_EQ(result, FileCopier::Result::Succeeded);
+			EXPECT_EQ(ReadTestFile(destination), data);
+			EXPECT_EQ(lastProgress, size);
+			EXPECT_EQ(std::filesystem::last_write_time(destination),
+				std::filesystem::last_write_time(source));
+
+			std::filesystem::remove(source);
+			std::filesystem::remove(destination);
+		}
+	}
+}
+
+TEST_F(FileCopierTest, DestinationExists)
+{
+	FileCopier copier(true);
+	auto source = m_directory / L"source";
+	auto destination = m_directory / L"destination";
+	CreateTestFile(source, BuildData(100));
+
+	auto existingData = BuildData(10);
+	CreateTestFile(destination, existingData);
+
+	// The existing file should be left untouched.
+	EXPECT_EQ(copier.Copy(source, destination), FileCopier::Result::WriteFailed);
+	EXPECT_EQ(ReadTestFile(destination), existingData);
+}
+
+TEST_F(FileCopierTest, SourceMissing)
+{
+	FileCopier copier(true);
+	auto destination = m_directory / L"destination";
+
+	EXPECT_EQ(
+		copier.Copy(m_directory / L"source", destination), FileCopier::Result::ReadFailed);
+	EXPECT_FALSE(std::filesystem::exists(destination));
+}
@@ -0,0 +1,96 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "TemporaryDirectoryHelper.h"
+#include "../Helper/FileDestroyer.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <string>
+
+using namespace testing;
+
+class FileDestroyerTest : public Test
+{
+protected:
+	FileDestroyerTest() : m_rootDirectory(m_temporaryDirectory.GetPath())
+	{
+	}
+
+	std::wstring CreateTestFile(const std::wstring &name, size_t size)
+	{
+		return m_temporaryDirectory.CreateTestFile(name, size).wstring();
+	}
+
+	TemporaryDirectory m_temporaryDirectory;
+	std::filesystem::path m_rootDirectory;
+};
+
+TEST_F(FileDestroyerTest, OnePass)
+{
+	// The files are sized so that they cover an empty file, a partial block and multiple blocks.
+	std::vector<std::wstring> files = { CreateTestFile(L"empty", 0), CreateTestFile(L"small", 100),
+		CreateTestFile(L"large", 3 * 1024 * 1024 + 1) };
+
+	FileDestroyer fileDestroyer(NFileOperations::OverwriteMethod::OnePass, 2);
+	auto filesNotDestroyed = fileDestroyer.Destroy(files);
+
+	EXPECT_TRUE(filesNotDestroyed.empty());
+
+	for (const auto &file : files)
+	{
+		EXPECT_FALSE(std::filesystem::exists(file));
+	}
+
+	// Each file is overwritten at least once, in full.
+	auto progress = fileDestroyer.GetProgress();
+	EXPECT_GE(progress.bytesToWrite, 3 * 1024 * 1024 + 101U);
+	EXPECT_EQ(progress.bytesWritten, progress.bytesToWrite);
+}
+
+TEST_F(FileDestroyerTest, ThreePass)
+{
+	std::vector<std::wstring> files = { CreateTestFile(L"file", 100000) };
+
+	FileDestroyer fileDestroyer(NFileOperations::OverwriteMethod::ThreePass, 1);
+	auto filesNotDestroyed = fileDestroyer.Destroy(files);
+
+	EXPECT_TRUE(filesNotDestroyed.empty());
+	EXPECT_FALSE(std::filesystem::exists(files[0]));
+
+	auto progress = fileDestroyer.GetProgress();
+	EXPECT_GE(progress.bytesToWrite, 3 * 100000U);
+	EXPECT_EQ(progress.bytesToWrite % 3, 0U);
+	EXPECT_EQ(progress.bytesWritten, progress.bytesToWrite);
+}
+
+TEST_F(FileDestroyerTest, FilesNotDestroyed)
+{
+	auto folder = m_rootDirectory / L"folder";
+	std::filesystem::create_directory(folder);
+
+	auto missingFile = (m_rootDirectory / L"missing").wstring();
+
+	FileDestroyer fileDestroyer(NFileOperations::OverwriteMethod::OnePass, 1);
+	auto filesNotDestroyed = fileDestroyer.Destroy({ folder.wstring(), missingFile });
+
+	EXPECT_EQ(filesNotDestroyed, (std::vector<std::wstring>{ folder.wstring(), missingFile }));
+	EXPECT_TRUE(std::filesystem::exists(folder));
+}
+
+TEST_F(FileDestroyerTest, Stop)
+{
+	std::vector<std::wstring> files = { CreateTestFile(L"file1", 100),
+		CreateTestFile(L"file2", 100) };
+
+	FileDestroyer fileDestroyer(NFileOperations::OverwriteMethod::OnePass, 1);
+	fileDestroyer.Stop();
+	auto filesNotDestroyed = fileDestroyer.Destroy(files);
+
+	EXPECT_EQ(filesNotDestroyed, files);
+
+	for (const auto &file : files)
+	{
+		EXPECT_TRUE(std::filesystem::exists(file));
+	}
+}
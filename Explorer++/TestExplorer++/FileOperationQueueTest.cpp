@@ -0,0 +1,377 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/FileOperationQueue.h"
+#include "../Helper/TransferRateMeter.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace testing;
+
+namespace
+{
+	// Tracks a set of simulated operations. Each operation reports half of its progress and then
+	// blocks, until the test releases it.
+	class OperationTracker
+	{
+	public:
+		void OnStarted(const std::wstring &name)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_started.push_back(name);
+			m_numRunning++;
+			m_maxRunning = std::max(m_maxRunning, m_numRunning);
+			m_stateChanged.notify_all();
+		}
+
+		void OnFinished()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_numRunning--;
+		}
+
+		void WaitUntilReleased(const std::wstring &name)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_stateChanged.wait(lock, [this, &name] { return m_released.count(name) > 0; });
+		}
+
+		void Release(const std::wstring &name)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_released.insert(name);
+			m_stateChanged.notify_all();
+		}
+
+		void WaitUntilStarted(size_t numStarted)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_stateChanged.wait(
+				lock, [this, numStarted] { return m_started.size() >= numStarted; });
+		}
+
+		std::vector<std::wstring> GetStarted()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_started;
+		}
+
+		int GetMaxRunning()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_maxRunning;
+		}
+
+	private:
+		std::mutex m_mutex;
+		std::condition_variable m_stateChanged;
+		std::vector<std::wstring> m_started;
+		std::set<std::wstring> m_released;
+		int m_numRunning = 0;
+		int m_maxRunning = 0;
+	};
+
+	class TestOperation : public FileOperationQueue::Operation
+	{
+	public:
+		TestOperation(OperationTracker *tracker, const std::wstring &name, uint64_t size) :
+			m_tracker(tracker),
+			m_name(name),
+			m_size(size)
+		{
+		}
+
+		HRESULT Run(FileOperationQueue::OperationContext &context) override
+		{
+			context.ReportProgress(m_size / 2);
+
+			m_tracker->OnStarted(m_name);
+			m_tracker->WaitUntilReleased(m_name);
+
+			HRESULT hr = HRESULT_FROM_WIN32(ERROR_CANCELLED);
+
+			if (context.Checkpoint())
+			{
+				context.ReportProgress(m_size - (m_size / 2));
+				hr = S_OK;
+			}
+
+			m_tracker->OnFinished();
+
+			return hr;
+		}
+
+	private:
+		OperationTracker *const m_tracker;
+		const std::wstring m_name;
+		const uint64_t m_size;
+	};
+
+	class DestructionCounter : public FileOperationQueue::Operation
+	{
+	public:
+		DestructionCounter(int *numDestroyed, bool *run) : m_numDestroyed(numDestroyed), m_run(run)
+		{
+		}
+
+		~DestructionCounter()
+		{
+			(*m_numDestroyed)++;
+		}
+
+		HRESULT Run(FileOperationQueue::OperationContext &context) override
+		{
+			UNREFERENCED_PARAMETER(context);
+
+			*m_run = true;
+
+			return S_OK;
+		}
+
+	private:
+		int *const m_numDestroyed;
+		bool *const m_run;
+	};
+}
+
+class FileOperationQueueTest : public Test
+{
+protected:
+	FileOperationQueue::OperationId Queue(
+		const std::wstring &volume, const std::wstring &name, uint64_t size = 0)
+	{
+		return m_queue.QueueOperation(
+			volume, std::make_unique<TestOperation>(&m_tracker, name, size));
+	}
+
+	OperationTracker m_tracker;
+	FileOperationQueue m_queue;
+};
+
+TEST_F(FileOperationQueueTest, SameVolumeRunsInOrder)
+{
+	Queue(L"c:\\", L"a");
+	Queue(L"c:\\", L"b");
+	Queue(L"c:\\", L"c");
+
+	m_tracker.WaitUntilStarted(1);
+	EXPECT_EQ(m_tracker.GetStarted(), std::vector<std::wstring>({ L"a" }));
+
+	m_tracker.Release(L"a");
+	m_tracker.Release(L"b");
+	m_tracker.Release(L"c");
+	m_queue.WaitForIdle();
+
+	EXPECT_EQ(m_tracker.GetStarted(), std::vector<std::wstring>({ L"a", L"b", L"c" }));
+	EXPECT_EQ(m_tracker.GetMaxRunning(), 1);
+}
+
+TEST_F(FileOperationQueueTest, DifferentVolumesRunInParallel)
+{
+	Queue(L"c:\\", L"a");
+	Queue(L"d:\\", L"b");
+
+	// Both operations have to start before either is released.
+	m_tracker.WaitUntilStarted(2);
+
+	m_tracker.Release(L"a");
+	m_tracker.Release(L"b");
+	m_queue.WaitForIdle();
+
+	EXPECT_EQ(m_tracker.GetMaxRunning(), 2);
+}
+
+TEST_F(FileOperationQueueTest, ConcurrencyLimit)
+{
+	m_queue.SetMaxConcurrentOperationsPerVolume(2);
+	EXPECT_EQ(m_queue.GetMaxConcurrentOperationsPerVolume(), 2);
+
+	Queue(L"c:\\", L"a");
+	Queue(L"c:\\", L"b");
+	Queue(L"c:\\", L"c");
+
+	m_tracker.WaitUntilStarted(2);
+
+	auto operations = m_queue.GetOperations();
+	ASSERT_EQ(operations.size(), 3U);
+	EXPECT_EQ(operations[0].state, FileOperationQueue::OperationState::Running);
+	EXPECT_EQ(operations[1].state, FileOperationQueue::OperationState::Running);
+	EXPECT_EQ(operations[2].state, FileOperationQueue::OperationState::Queued);
+
+	m_tracker.Release(L"a");
+	m_tracker.Release(L"b");
+	m_tracker.Release(L"c");
+	m_queue.WaitForIdle();
+
+	EXPECT_EQ(m_tracker.GetMaxRunning(), 2);
+}
+
+TEST_F(FileOperationQueueTest, MoveOperation)
+{
+	Queue(L"c:\\", L"a");
+	Queue(L"c:\\", L"b");
+	auto idC = Queue(L"c:\\", L"c");
+
+	m_tracker.WaitUntilStarted(1);
+
+	EXPECT_TRUE(m_queue.MoveOperation(idC, 0));
+
+	m_tracker.Release(L"a");
+	m_tracker.Release(L"b");
+	m_tracker.Release(L"c");
+	m_queue.WaitForIdle();
+
+	EXPECT_EQ(m_tracker.GetStarted(), std::vector<std::wstring>({ L"a", L"c", L"b" }));
+
+	// The operation has finished, so can no longer be moved.
+	EXPECT_FALSE(m_queue.MoveOperation(idC, 0));
+}
+
+TEST_F(FileOperationQueueTest, PauseQueue)
+{
+	m_queue.Pause();
+	EXPECT_TRUE(m_queue.IsPaused());
+
+	Queue(L"c:\\", L"a", 100);
+	m_tracker.Release(L"a");
+
+	auto operations = m_queue.GetOperations();
+	ASSERT_EQ(operations.size(), 1U);
+	EXPECT_EQ(operations[0].state, FileOperationQueue::OperationState::Queued);
+
+	m_queue.Resume();
+	m_queue.WaitForIdle();
+
+	EXPECT_EQ(m_tracker.GetStarted(), std::vector<std::wstring>({ L"a" }));
+}
+
+TEST_F(FileOperationQueueTest, PauseOperation)
+{
+	auto idA = Queue(L"c:\\", L"a", 100);
+	auto idB = Queue(L"c:\\", L"b", 200);
+
+	m_tracker.WaitUntilStarted(1);
+
+	// Pausing the running operation means that it blocks at its next checkpoint, while still
+	// holding its slot. Pausing the queued operation stops it from starting.
+	EXPECT_TRUE(m_queue.PauseOperation(idA));
+	EXPECT_TRUE(m_queue.PauseOperation(idB));
+	m_tracker.Release(L"a");
+	m_tracker.Release(L"b");
+
+	auto operations = m_queue.GetOperations();
+	ASSERT_EQ(operations.size(), 2U);
+	EXPECT_TRUE(operations[0].paused);
+	EXPECT_EQ(operations[0].bytesTransferred, 50U);
+	EXPECT_EQ(operations[1].state, FileOperationQueue::OperationState::Queued);
+
+	EXPECT_TRUE(m_queue.ResumeOperation(idA));
+	EXPECT_TRUE(m_queue.ResumeOperation(idB));
+	m_queue.WaitForIdle();
+
+	EXPECT_EQ(m_tracker.GetStarted(), std::vector<std::wstring>({ L"a", L"b" }));
+	EXPECT_FALSE(m_queue.PauseOperation(idA));
+}
+
+TEST_F(FileOperationQueueTest, Progress)
+{
+	auto idA = Queue(L"c:\\", L"a", 100);
+	Queue(L"d:\\", L"b", 200);
+
+	m_tracker.WaitUntilStarted(2);
+	m_tracker.Release(L"b");
+
+	// Once b has finished, a will be the only remaining operation.
+	std::vector<FileOperationQueue::OperationInfo> operations;
+
+	do
+	{
+		operations = m_queue.GetOperations();
+	} while (operations.size() > 1);
+
+	ASSERT_EQ(operations.size(), 1U);
+	EXPECT_EQ(operations[0].id, idA);
+	EXPECT_EQ(operations[0].volume, L"c:\\");
+	EXPECT_EQ(operations[0].bytesTransferred, 50U);
+
+	m_tracker.Release(L"a");
+	m_queue.WaitForIdle();
+
+	EXPECT_TRUE(m_queue.GetOperations().empty());
+}
+
+TEST_F(FileOperationQueueTest, OperationFinishedCallback)
+{
+	std::mutex mutex;
+	std::vector<std::pair<FileOperationQueue::OperationId, HRESULT>> results;
+
+	m_queue.SetOperationFinishedCallback(
+		[&mutex, &results](FileOperationQueue::OperationId id, HRESULT result) {
+			std::lock_guard<std::mutex> lock(mutex);
+			results.emplace_back(id, result);
+		});
+
+	auto idA = Queue(L"c:\\", L"a");
+	auto idB = Queue(L"c:\\", L"b");
+
+	m_tracker.Release(L"a");
+	m_tracker.Release(L"b");
+	m_queue.WaitForIdle();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	EXPECT_EQ(results,
+		(std::vector<std::pair<FileOperationQueue::OperationId, HRESULT>>{
+			{ idA, S_OK }, { idB, S_OK } }));
+}
+
+TEST(FileOperationQueueShutdownTest, QueuedOperationsDiscarded)
+{
+	int numDestroyed = 0;
+	bool run = false;
+	bool reported = false;
+
+	{
+		FileOperationQueue queue;
+		queue.SetOperationFinishedCallback(
+			[&reported](FileOperationQueue::OperationId id, HRESULT result) {
+				UNREFERENCED_PARAMETER(id);
+				UNREFERENCED_PARAMETER(result);
+
+				reported = true;
+			});
+		queue.Pause();
+		queue.QueueOperation(L"c:\\", std::make_unique<DestructionCounter>(&numDestroyed, &run));
+	}
+
+	EXPECT_EQ(numDestroyed, 1);
+	EXPECT_FALSE(run);
+	EXPECT_FALSE(reported);
+}
+
+TEST(TransferRateMeterTest, Rate)
+{
+	TransferRateMeter meter(std::chrono::seconds(2));
+	auto start = TransferRateMeter::Clock::time_point();
+
+	EXPECT_EQ(meter.GetBytesPerSecond(), 0);
+
+	meter.AddSample(start, 0);
+	EXPECT_EQ(meter.GetBytesPerSecond(), 0);
+
+	meter.AddSample(start + std::chrono::seconds(1), 1000);
+	EXPECT_DOUBLE_EQ(meter.GetBytesPerSecond(), 1000);
+
+	// The rate is averaged across the window, so older samples eventually drop out.
+	meter.AddSample(start + std::chrono::seconds(2), 5000);
+	EXPECT_DOUBLE_EQ(meter.GetBytesPerSecond(), 2500);
+
+	meter.AddSample(start + std::chrono::seconds(4), 5000);
+	EXPECT_DOUBLE_EQ(meter.GetBytesPerSecond(), 0);
+}
@@ -0,0 +1,194 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/FilenameIndex.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <set>
+
+using namespace testing;
+
+class FilenameIndexTest : public Test
+{
+protected:
+	FilenameIndexTest() : m_index(L"C:\\Root")
+	{
+		m_index.AddEntries(L"C:\\Root",
+			{ MakeEntry(L"Readme.txt"), MakeEntry(L"Source", FILE_ATTRIBUTE_DIRECTORY) });
+		m_index.AddEntries(L"C:\\Root\\Source",
+			{ MakeEntry(L"Helper.cpp"), MakeEntry(L"Helper.h"), MakeEntry(L"Main.cpp"),
+				MakeEntry(L"Nested", FILE_ATTRIBUTE_DIRECTORY) });
+		m_index.AddEntries(L"C:\\Root\\Source\\Nested", { MakeEntry(L"Nested helper.txt") });
+	}
+
+	static FilenameIndex::Entry MakeEntry(
+		const std::wstring &name, DWORD attributes = FILE_ATTRIBUTE_NORMAL)
+	{
+		FilenameIndex::Entry entry;
+		entry.name = name;
+		entry.attributes = attributes;
+		entry.size = name.size();
+		entry.lastWriteTime = {};
+		return entry;
+	}
+
+	std::set<std::wstring> Query(
+		const std::vector<std::wstring> &requiredLiterals, bool recursive = true)
+	{
+		std::set<std::wstring> paths;
+
+		m_index.Query(requiredLiterals, recursive,
+			[&paths](const std::wstring &directory, const FilenameIndex::Entry &entry) {
+				paths.insert(directory + L"\\" + entry.name);
+				return true;
+			});
+
+		return paths;
+	}
+
+	FilenameIndex m_index;
+};
+
+TEST_F(FilenameIndexTest, Query)
+{
+	EXPECT_EQ(Query({ L"HELPER" }),
+		std::set<std::wstring>({ L"C:\\Root\\Source\\Helper.cpp", L"C:\\Root\\Source\\Helper.h",
+			L"C:\\Root\\Source\\Nested\\Nested helper.txt" }));
+	EXPECT_EQ(Query({ L"help", L".cpp" }),
+		std::set<std::wstring>({ L"C:\\Root\\Source\\Helper.cpp" }));
+	EXPECT_EQ(Query({ L"xyz" }), std::set<std::wstring>());
+
+	// Literals that are too short to contain a trigram don't narrow the results at all.
+	EXPECT_EQ(Query({ L"h" }).size(), 7U);
+	EXPECT_EQ(Query({}).size(), 7U);
+}
+
+TEST_F(FilenameIndexTest, NonRecursiveQuery)
+{
+	EXPECT_EQ(Query({}, false),
+		std::set<std::wstring>({ L"C:\\Root\\Readme.txt", L"C:\\Root\\Source" }));
+}
+
+TEST_F(FilenameIndexTest, AddAndRemove)
+{
+	m_index.AddEntry(L"C:\\Root", MakeEntry(L"Notes.txt"));
+	EXPECT_EQ(Query({ L"notes" }), std::set<std::wstring>({ L"C:\\Root\\Notes.txt" }));
+
+	// Adding an existing entry again should update it, rather than add a duplicate.
+	m_index.AddEntry(L"C:\\Root", MakeEntry(L"notes.txt"));
+	EXPECT_EQ(m_index.GetNumEntries(), 8U);
+
+	m_index.RemoveEntry(L"C:\\Root\\Notes.txt");
+	EXPECT_EQ(Query({ L"notes" }), std::set<std::wstring>());
+
+	// Removing a folder should remove everything within it.
+	m_index.RemoveEntry(L"C:\\Root\\Source");
+	EXPECT_EQ(Query({}), std::set<std::wstring>({ L"C:\\Root\\Readme.txt" }));
+	EXPECT_EQ(m_index.GetNumEntries(), 1U);
+
+	// A folder recreated at the same path shouldn't bring back any of the previous entries.
+	m_index.AddEntry(L"C:\\Root\\Source", MakeEntry(L"New.cpp"));
+	EXPECT_EQ(Query({ L".cpp" }), std::set<std::wstring>({ L"C:\\Root\\Source\\New.cpp" }));
+}
+
+TEST_F(FilenameIndexTest, RemoveFolderWithSimilarName)
+{
+	// The path of this folder starts with the path of the folder being removed, but it's not
+	// within that folder.
+	m_index.AddEntry(L"C:\\Root", MakeEntry(L"Source backup", FILE_ATTRIBUTE_DIRECTORY));
+	m_index.AddEntry(L"C:\\Root\\Source backup", MakeEntry(L"Backup.cpp"));
+
+	m_index.RemoveEntry(L"C:\\Root\\Source");
+	EXPECT_EQ(Query({ L".cpp" }),
+		std::set<std::wstring>({ L"C:\\Root\\Source backup\\Backup.cpp" }));
+}
+
+TEST_F(FilenameIndexTest, Compaction)
+{
+	std::vector<FilenameIndex::Entry> entries;
+
+	for (int i = 0; i < 10000; i++)
+	{
+		entries.push_back(MakeEntry(L"Generated " + std::to_wstring(i) + L".txt"));
+	}
+
+	m_index.AddEntry(L"C:\\Root", MakeEntry(L"Generated", FILE_ATTRIBUTE_DIRECTORY));
+	m_index.AddEntries(L"C:\\Root\\Generated", entries);
+	EXPECT_EQ(m_index.GetNumEntries(), 10008U);
+
+	// Removing the folder leaves far more removed entries than remaining ones, so the index
+	// should be compacted. The remaining entries should be unaffected.
+	m_index.RemoveEntry(L"C:\\Root\\Generated");
+	EXPECT_EQ(m_index.GetNumEntries(), 7U);
+	EXPECT_EQ(Query({ L"generated" }), std::set<std::wstring>());
+	EXPECT_EQ(Query({ L"HELPER" }),
+		std::set<std::wstring>({ L"C:\\Root\\Source\\Helper.cpp", L"C:\\Root\\Source\\Helper.h",
+			L"C:\\Root\\Source\\Nested\\Nested helper.txt" }));
+	EXPECT_EQ(Query({}, false),
+		std::set<std::wstring>({ L"C:\\Root\\Readme.txt", L"C:\\Root\\Source" }));
+
+	// Entries can still be added and removed afterwards.
+	m_index.AddEntry(L"C:\\Root\\Source", MakeEntry(L"New.cpp"));
+	m_index.RemoveEntry(L"C:\\Root\\Source\\Main.cpp");
+	EXPECT_EQ(Query({ L".cpp" }),
+		std::set<std::wstring>({ L"C:\\Root\\Source\\Helper.cpp", L"C:\\Root\\Source\\New.cpp" }));
+
+	m_index.RemoveEntry(L"C:\\Root\\Source\\Nested");
+	EXPECT_EQ(Query({ L"nested" }), std::set<std::wstring>());
+}
+
+TEST_F(FilenameIndexTest, SaveAndLoad)
+{
+	m_index.RemoveEntry(L"C:\\Root\\Source\\Main.cpp");
+	m_index.SetBuildInfo({ 0x1234567890ABCDEF, 0x12345678 });
+
+	auto filePath = (std::filesystem::temp_directory_path() / L"FilenameIndexTest.idx").wstring();
+	ASSERT_TRUE(m_index.Save(filePath));
+
+	auto loadedIndex = FilenameIndex::Load(filePath);
+	std::filesystem::remove(filePath);
+	ASSERT_NE(loadedIndex, nullptr);
+
+	EXPECT_EQ(loadedIndex->GetRootDirectory(), m_index.GetRootDirectory());
+	EXPECT_EQ(loadedIndex->GetNumEntries(), m_index.GetNumEntries());
+	EXPECT_EQ(loadedIndex->GetBuildInfo().buildTime, 0x1234567890ABCDEFU);
+	EXPECT_EQ(loadedIndex->GetBuildInfo().volumeSerialNumber, 0x12345678U);
+
+	std::set<std::wstring> paths;
+	loadedIndex->Query({ L".cpp" }, true,
+		[&paths](const std::wstring &directory, const FilenameIndex::Entry &entry) {
+			EXPECT_EQ(entry.size, entry.name.size());
+			paths.insert(directory + L"\\" + entry.name);
+			return true;
+		});
+	EXPECT_EQ(paths, std::set<std::wstring>({ L"C:\\Root\\Source\\Helper.cpp" }));
+}
+
+TEST_F(FilenameIndexTest, SaveAndLoadDifferentCase)
+{
+	// The first directory only differs from the root directory in case, so it should still be
+	// stored relative to the root. The second merely shares a prefix with the root, so it's outside
+	// the root and should be stored as is.
+	m_index.AddEntries(L"c:\\ROOT\\Other", { MakeEntry(L"Case.txt") });
+	m_index.AddEntries(L"C:\\Root2", { MakeEntry(L"Prefix.txt") });
+
+	auto filePath =
+		(std::filesystem::temp_directory_path() / L"FilenameIndexTestCase.idx").wstring();
+	ASSERT_TRUE(m_index.Save(filePath));
+
+	auto loadedIndex = FilenameIndex::Load(filePath);
+	std::filesystem::remove(filePath);
+	ASSERT_NE(loadedIndex, nullptr);
+
+	std::set<std::wstring> paths;
+	loadedIndex->Query({ L".txt" }, true,
+		[&paths](const std::wstring &directory, const FilenameIndex::Entry &entry) {
+			paths.insert(directory + L"\\" + entry.name);
+			return true;
+		});
+	EXPECT_EQ(paths,
+		std::set<std::wstring>({ L"C:\\Root\\Readme.txt",
+			L"C:\\Root\\Source\\Nested\\Nested helper.txt", L"C:\\Root\\Other\\Case.txt",
+			L"C:\\Root2\\Prefix.txt" }));
+}
@@ -0,0 +1,161 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "TemporaryDirectoryHelper.h"
+#include "../Helper/FolderSize.h"
+#include "../Helper/FolderSizeService.h"
+#include "../Helper/ParallelDirectoryWalker.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <string>
+#include <thread>
+
+using namespace testing;
+
+class FolderSizeTest : public Test
+{
+protected:
+	FolderSizeTest() : m_rootDirectory(m_temporaryDirectory.GetPath())
+	{
+		// Builds a tree that's 2 levels deep, with 2 subfolders and 3 files in each folder. That
+		// gives 6 subfolders and 21 files in total.
+		CreateTree(m_rootDirectory, 2);
+	}
+
+	void CreateTree(const std::filesystem::path &directory, int depth)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			m_temporaryDirectory.CreateTestFile(
+				directory / (L"file" + std::to_wstring(i)), i * 100);
+		}
+
+		if (depth == 0)
+		{
+			return;
+		}
+
+		for (int i = 0; i < 2; i++)
+		{
+			CreateTree(directory / (L"folder" + std::to_wstring(i)), depth - 1);
+		}
+	}
+
+	static void ExpectFolderInfo(const FolderInfo &folderInfo, std::uintmax_t size, int numFolders,
+		int numFiles)
+	{
+		EXPECT_EQ(folderInfo.size, size);
+		EXPECT_EQ(folderInfo.numFolders, numFolders);
+		EXPECT_EQ(folderInfo.numFiles, numFiles);
+	}
+
+	static constexpr auto CALLBACK_TIMEOUT = std::chrono::seconds(10);
+
+	TemporaryDirectory m_temporaryDirectory;
+	std::filesystem::path m_rootDirectory;
+};
+
+TEST_F(FolderSizeTest, GetFolderInfo)
+{
+	// Each of the 7 folders contains files of 0, 100 and 200 bytes.
+	ExpectFolderInfo(GetFolderInfo(m_rootDirectory.wstring()), 7 * 300, 6, 21);
+
+	ParallelDirectoryWalker walker(4);
+	ExpectFolderInfo(GetFolderInfo(walker, m_rootDirectory.wstring()), 7 * 300, 6, 21);
+}
+
+TEST_F(FolderSizeTest, ServiceCachesResult)
+{
+	// The promises are declared first, so that they outlive the service (and therefore any
+	// callbacks that are still pending).
+	std::promise<FolderInfo> promise1;
+	std::promise<FolderInfo> promise2;
+
+	FolderSizeService folderSizeService;
+
+	// The second request is made while the first is (most likely) still in progress, so both
+	// callbacks should be invoked with the result of a single calculation.
+	auto result1 = folderSizeService.GetFolderInfo(m_rootDirectory.wstring(),
+		[&promise1](const FolderInfo &folderInfo) { promise1.set_value(folderInfo); });
+	auto result2 = folderSizeService.GetFolderInfo(m_rootDirectory.wstring(),
+		[&promise2](const FolderInfo &folderInfo) { promise2.set_value(folderInfo); });
+
+	EXPECT_FALSE(result1.has_value());
+
+	auto future1 = promise1.get_future();
+	ASSERT_EQ(future1.wait_for(CALLBACK_TIMEOUT), std::future_status::ready);
+	ExpectFolderInfo(future1.get(), 7 * 300, 6, 21);
+
+	if (!result2)
+	{
+		auto future2 = promise2.get_future();
+		ASSERT_EQ(future2.wait_for(CALLBACK_TIMEOUT), std::future_status::ready);
+		ExpectFolderInfo(future2.get(), 7 * 300, 6, 21);
+	}
+
+	// Paths are compared case-insensitively and trailing backslashes are ignored.
+	auto cachedResult = folderSizeService.GetCachedFolderInfo(m_rootDirectory.wstring() + L"\\");
+	ASSERT_TRUE(cachedResult.has_value());
+	ExpectFolderInfo(*cachedResult, 7 * 300, 6, 21);
+}
+
+TEST_F(FolderSizeTest, ServiceInvalidatesResultOnChange)
+{
+	std::promise<FolderInfo> promise;
+	std::promise<FolderInfo> updatedPromise;
+
+	FolderSizeService folderSizeService;
+
+	folderSizeService.GetFolderInfo(m_rootDirectory.wstring(),
+		[&promise](const FolderInfo &folderInfo) { promise.set_value(folderInfo); });
+
+	auto future = promise.get_future();
+	ASSERT_EQ(future.wait_for(CALLBACK_TIMEOUT), std::future_status::ready);
+	ASSERT_TRUE(folderSizeService.GetCachedFolderInfo(m_rootDirectory.wstring()).has_value());
+
+	// A change anywhere within the folder should invalidate the result.
+	m_temporaryDirectory.CreateTestFile(L"folder0\\folder1\\newfile", 50);
+
+	// The change notification is delivered asynchronously, so it may take a moment for the
+	// cached result to be invalidated.
+	auto deadline = std::chrono::steady_clock::now() + CALLBACK_TIMEOUT;
+
+	while (folderSizeService.GetCachedFolderInfo(m_rootDirectory.wstring())
+		&& std::chrono::steady_clock::now() < deadline)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	EXPECT_FALSE(folderSizeService.GetCachedFolderInfo(m_rootDirectory.wstring()).has_value());
+
+	folderSizeService.GetFolderInfo(m_rootDirectory.wstring(),
+		[&updatedPromise](const FolderInfo &folderInfo) { updatedPromise.set_value(folderInfo); });
+
+	auto updatedFuture = updatedPromise.get_future();
+	ASSERT_EQ(updatedFuture.wait_for(CALLBACK_TIMEOUT), std::future_status::ready);
+	ExpectFolderInfo(updatedFuture.get(), 7 * 300 + 50, 6, 22);
+}
+
+TEST_F(FolderSizeTest, ServiceReleasesFolder)
+{
+	std::promise<FolderInfo> promise;
+
+	FolderSizeService folderSizeService;
+
+	folderSizeService.GetFolderInfo(m_rootDirectory.wstring(),
+		[&promise](const FolderInfo &folderInfo) { promise.set_value(folderInfo); });
+
+	auto future = promise.get_future();
+	ASSERT_EQ(future.wait_for(CALLBACK_TIMEOUT), std::future_status::ready);
+	ASSERT_TRUE(folderSizeService.GetCachedFolderInfo(m_rootDirectory.wstring()).has_value());
+
+	// A folder that merely shares a prefix with the cached folder shouldn't affect it.
+	folderSizeService.ReleaseFolder(m_rootDirectory.wstring() + L"0");
+	EXPECT_TRUE(folderSizeService.GetCachedFolderInfo(m_rootDirectory.wstring()).has_value());
+
+	folderSizeService.ReleaseFolder(m_rootDirectory.parent_path().wstring());
+	EXPECT_FALSE(folderSizeService.GetCachedFolderInfo(m_rootDirectory.wstring()).has_value());
+}
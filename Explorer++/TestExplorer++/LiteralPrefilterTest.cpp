@@ -0,0 +1,43 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/LiteralPrefilter.h"
+#include <gtest/gtest.h>
+
+TEST(LiteralPrefilterTest, CaseSensitive)
+{
+	LiteralPrefilter prefilter({ L"report", L".pdf" }, true);
+	EXPECT_TRUE(prefilter.MayMatch(L"report 2021.pdf"));
+	EXPECT_TRUE(prefilter.MayMatch(L".pdf report"));
+	EXPECT_FALSE(prefilter.MayMatch(L"Report 2021.pdf"));
+	EXPECT_FALSE(prefilter.MayMatch(L"report.docx"));
+	EXPECT_FALSE(prefilter.MayMatch(L""));
+}
+
+TEST(LiteralPrefilterTest, CaseInsensitive)
+{
+	LiteralPrefilter prefilter({ L"report", L".pdf" }, false);
+	EXPECT_TRUE(prefilter.MayMatch(L"REPORT 2021.PDF"));
+	EXPECT_TRUE(prefilter.MayMatch(L"rEpOrT.pdf"));
+	EXPECT_FALSE(prefilter.MayMatch(L"repor.pdf"));
+	EXPECT_FALSE(prefilter.MayMatch(L"report.pd"));
+}
+
+TEST(LiteralPrefilterTest, NoLiterals)
+{
+	LiteralPrefilter prefilter({}, true);
+	EXPECT_TRUE(prefilter.MayMatch(L""));
+	EXPECT_TRUE(prefilter.MayMatch(L"anything"));
+
+	// Empty literals don't place any constraint on the string.
+	LiteralPrefilter emptyLiteralPrefilter({ L"" }, false);
+	EXPECT_TRUE(emptyLiteralPrefilter.MayMatch(L""));
+}
+
+TEST(LiteralPrefilterTest, FoldCharacter)
+{
+	EXPECT_EQ(LiteralPrefilter::FoldCharacter('A'), 'a');
+	EXPECT_EQ(LiteralPrefilter::FoldCharacter('a'), 'a');
+	EXPECT_EQ(LiteralPrefilter::FoldCharacter('1'), '1');
+}
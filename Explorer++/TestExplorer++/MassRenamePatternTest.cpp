@@ -0,0 +1,69 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Explorer++/MassRenamePattern.h"
+#include <boost/locale.hpp>
+#include <gtest/gtest.h>
+
+TEST(MassRenamePatternTest, Literal)
+{
+	MassRenamePattern pattern(L"new name.txt");
+	EXPECT_EQ(pattern.Apply(L"file.doc", 0), L"new name.txt");
+
+	MassRenamePattern emptyPattern(L"");
+	EXPECT_EQ(emptyPattern.Apply(L"file.doc", 0), L"");
+}
+
+TEST(MassRenamePatternTest, NameTokens)
+{
+	MassRenamePattern pattern(L"/F - /B - /E");
+	EXPECT_EQ(pattern.Apply(L"archive.tar.gz", 0), L"archive.tar.gz - archive.tar - .gz");
+	EXPECT_EQ(pattern.Apply(L"readme", 0), L"readme - readme - ");
+
+	MassRenamePattern copyPattern(L"/B (copy)/E");
+	EXPECT_EQ(copyPattern.Apply(L"file.doc", 0), L"file (copy).doc");
+}
+
+TEST(MassRenamePatternTest, Counter)
+{
+	MassRenamePattern pattern(L"/N");
+	EXPECT_EQ(pattern.Apply(L"file.doc", 0), L"0");
+	EXPECT_EQ(pattern.Apply(L"file.doc", 123), L"123");
+
+	// The width is the number of zeros plus one.
+	MassRenamePattern paddedPattern(L"/B_/00N/E");
+	EXPECT_EQ(paddedPattern.Apply(L"file.doc", 7), L"file_007.doc");
+	EXPECT_EQ(paddedPattern.Apply(L"file.doc", 1234), L"file_1234.doc");
+
+	MassRenamePattern multiplePattern(L"/N-/0N");
+	EXPECT_EQ(multiplePattern.Apply(L"file.doc", 5), L"5-05");
+}
+
+TEST(MassRenamePatternTest, CaseConversion)
+{
+	std::locale locale = boost::locale::generator()("en_US.UTF-8");
+
+	MassRenamePattern lowercasePattern(L"Name - /L", locale);
+	EXPECT_EQ(lowercasePattern.Apply(L"FILE.DOC", 0), L"name - file.doc");
+
+	MassRenamePattern uppercasePattern(L"Name - /U", locale);
+	EXPECT_EQ(uppercasePattern.Apply(L"file.doc", 0), L"NAME - FILE.DOC");
+
+	MassRenamePattern multipleUppercasePattern(L"/U /U", locale);
+	EXPECT_EQ(multipleUppercasePattern.Apply(L"file.doc", 0), L"FILE.DOC FILE.DOC");
+
+	// Only the first /L is replaced.
+	MassRenamePattern multipleLowercasePattern(L"/L /L", locale);
+	EXPECT_EQ(multipleLowercasePattern.Apply(L"File.doc", 0), L"file.doc /l");
+
+	// Lowercase conversion wins, regardless of the order of the tokens, with each /U left as is.
+	MassRenamePattern mixedPattern(L"/U /L", locale);
+	EXPECT_EQ(mixedPattern.Apply(L"File.doc", 0), L"/u file.doc");
+}
+
+TEST(MassRenamePatternTest, UnrecognizedTokens)
+{
+	MassRenamePattern pattern(L"/X//F/0F/");
+	EXPECT_EQ(pattern.Apply(L"file.doc", 0), L"/X/file.doc/0F/");
+}
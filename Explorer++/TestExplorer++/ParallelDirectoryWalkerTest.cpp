@@ -0,0 +1,176 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "TemporaryDirectoryHelper.h"
+#include "../Helper/ParallelDirectoryWalker.h"
+#include <gtest/gtest.h>
+#include <wil/common.h>
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <set>
+
+using namespace testing;
+
+class ParallelDirectoryWalkerTest : public Test
+{
+protected:
+	ParallelDirectoryWalkerTest() : m_rootDirectory(m_temporaryDirectory.GetPath())
+	{
+		// Builds a tree that's 3 levels deep, with 3 subfolders and 4 files in each folder.
+		CreateTree(m_rootDirectory, 3);
+	}
+
+	void CreateTree(const std::filesystem::path &directory, int depth)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			auto path = m_temporaryDirectory.CreateTestFile(
+				directory / (L"file" + std::to_wstring(i) + L".txt"), "a");
+			m_expectedFiles.insert(path.wstring());
+		}
+
+		if (depth == 0)
+		{
+			return;
+		}
+
+		for (int i = 0; i < 3; i++)
+		{
+			auto path = directory / (L"folder" + std::to_wstring(i));
+			m_expectedFolders.insert(path.wstring());
+			CreateTree(path, depth - 1);
+		}
+	}
+
+	TemporaryDirectory m_temporaryDirectory;
+	std::filesystem::path m_rootDirectory;
+	std::set<std::wstring> m_expectedFiles;
+	std::set<std::wstring> m_expectedFolders;
+};
+
+TEST_F(ParallelDirectoryWalkerTest, FindsEveryEntryOnce)
+{
+	ParallelDirectoryWalker walker(4);
+
+	std::mutex mutex;
+	std::multiset<std::wstring> files;
+	std::multiset<std::wstring> folders;
+	std::multiset<std::wstring> directoriesEntered;
+
+	walker.Walk(m_rootDirectory.wstring(), true,
+		[&](int workerIndex, const std::wstring &directory) {
+			EXPECT_LT(workerIndex, walker.GetNumWorkers());
+
+			std::lock_guard<std::mutex> lock(mutex);
+			directoriesEntered.insert(directory);
+		},
+		[&](int workerIndex, const std::wstring &directory, const WIN32_FIND_DATA &findData) {
+			EXPECT_LT(workerIndex, walker.GetNumWorkers());
+
+			auto path = (std::filesystem::path(directory) / findData.cFileName).wstring();
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if (WI_IsFlagSet(findData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+			{
+				folders.insert(path);
+			}
+			else
+			{
+				files.insert(path);
+			}
+		});
+
+	EXPECT_EQ(files, std::multiset<std::wstring>(m_expectedFiles.begin(), m_expectedFiles.end()));
+	EXPECT_EQ(folders,
+		std::multiset<std::wstring>(m_expectedFolders.begin(), m_expectedFolders.end()));
+
+	// Every folder (including the root) should have been enumerated exactly once.
+	EXPECT_EQ(directoriesEntered.size(), m_expectedFolders.size() + 1);
+	EXPECT_EQ(directoriesEntered.count(m_rootDirectory.wstring()), 1U);
+}
+
+TEST_F(ParallelDirectoryWalkerTest, NonRecursive)
+{
+	ParallelDirectoryWalker walker(4);
+
+	std::mutex mutex;
+	int numEntries = 0;
+
+	walker.Walk(m_rootDirectory.wstring(), false, nullptr,
+		[&](int workerIndex, const std::wstring &directory, const WIN32_FIND_DATA &findData) {
+			UNREFERENCED_PARAMETER(workerIndex);
+			UNREFERENCED_PARAMETER(findData);
+
+			EXPECT_EQ(directory, m_rootDirectory.wstring());
+
+			std::lock_guard<std::mutex> lock(mutex);
+			numEntries++;
+		});
+
+	// 4 files and 3 folders.
+	EXPECT_EQ(numEntries, 7);
+}
+
+TEST_F(ParallelDirectoryWalkerTest, Stop)
+{
+	ParallelDirectoryWalker walker(4);
+	std::atomic<int> numEntries = 0;
+
+	walker.Walk(m_rootDirectory.wstring(), true, nullptr,
+		[&](int workerIndex, const std::wstring &directory, const WIN32_FIND_DATA &findData) {
+			UNREFERENCED_PARAMETER(workerIndex);
+			UNREFERENCED_PARAMETER(directory);
+			UNREFERENCED_PARAMETER(findData);
+
+			numEntries++;
+			walker.Stop();
+		});
+
+	EXPECT_TRUE(walker.IsStopped());
+
+	// Each worker checks the flag before processing the next entry, so at most one entry per
+	// worker can be processed once the walk has been stopped.
+	EXPECT_LE(numEntries, walker.GetNumWorkers());
+}
+
+TEST_F(ParallelDirectoryWalkerTest, SubdirectoryFilter)
+{
+	ParallelDirectoryWalker walker(4);
+
+	std::mutex mutex;
+	std::set<std::wstring> directoriesEntered;
+
+	walker.Walk(m_rootDirectory.wstring(), true,
+		[&](int workerIndex, const std::wstring &directory) {
+			UNREFERENCED_PARAMETER(workerIndex);
+
+			std::lock_guard<std::mutex> lock(mutex);
+			directoriesEntered.insert(directory);
+		},
+		[&](int workerIndex, const std::wstring &directory, const WIN32_FIND_DATA &findData) {
+			UNREFERENCED_PARAMETER(workerIndex);
+			UNREFERENCED_PARAMETER(directory);
+			UNREFERENCED_PARAMETER(findData);
+		},
+		[&](int workerIndex, const std::wstring &directory, const WIN32_FIND_DATA &findData,
+			int depth) {
+			UNREFERENCED_PARAMETER(workerIndex);
+			UNREFERENCED_PARAMETER(directory);
+
+			// Skips folder0 everywhere and never descends more than 2 levels.
+			return depth <= 2 && lstrcmp(findData.cFileName, L"folder0") != 0;
+		});
+
+	// The root, 2 folders at depth 1 and 2 * 2 folders at depth 2.
+	EXPECT_EQ(directoriesEntered.size(), 7U);
+	EXPECT_EQ(directoriesEntered.count(m_rootDirectory.wstring()), 1U);
+	EXPECT_EQ(directoriesEntered.count((m_rootDirectory / L"folder0").wstring()), 0U);
+	EXPECT_EQ(
+		directoriesEntered.count((m_rootDirectory / L"folder1" / L"folder2").wstring()), 1U);
+	EXPECT_EQ(directoriesEntered.count(
+				  (m_rootDirectory / L"folder1" / L"folder2" / L"folder1").wstring()),
+		0U);
+}
@@ -0,0 +1,122 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/RegexMatcher.h"
+#include <gtest/gtest.h>
+
+namespace
+{
+	const std::vector<std::wstring> TEST_NAMES = { L"", L"a", L"A", L"ab", L"abc", L"ABC",
+		L"aaa", L"abab", L"file.txt", L"File.TXT", L"file.txt.bak", L"report 2021.docx",
+		L"report_2022-final.pdf", L"IMG_0001.JPG", L"img_12.png", L"notes", L"x1y2z3",
+		L"a.b.c", L"  spaced  ", L"tab\tname", L"[brackets]", L"a+b=c", L"question?",
+		L"dollar$sign", L"^caret", L"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaab" };
+
+	// Checks that the matcher produces exactly the same results as std::regex_match.
+	void ExpectSameResultsAsStdRegex(const std::wstring &pattern, bool caseSensitive)
+	{
+		RegexMatcher matcher(pattern, caseSensitive);
+		EXPECT_TRUE(matcher.IsCompiled()) << pattern;
+
+		auto flags = std::regex_constants::ECMAScript;
+
+		if (!caseSensitive)
+		{
+			flags |= std::regex_constants::icase;
+		}
+
+		std::wregex regex(pattern, flags);
+
+		for (const auto &name : TEST_NAMES)
+		{
+			EXPECT_EQ(matcher.Match(name), std::regex_match(name, regex))
+				<< "Pattern: " << std::string(pattern.begin(), pattern.end()) << ", name index: "
+				<< (&name - TEST_NAMES.data());
+		}
+	}
+}
+
+TEST(RegexMatcherTest, MatchesSameAsStdRegex)
+{
+	const std::vector<std::wstring> patterns = { L"a", L"abc", L".*", L".+\\.txt", L"a*b?c+",
+		L"(ab)+", L"(?:ab)*", L"a|ab|abc", L"[a-c]+", L"[^a-z]+", L"[a\\-z]+", L"\\w+",
+		L"\\d{4}", L".*\\d{2,}.*", L"x\\dy\\dz\\d", L"a{2,3}", L"a{3}", L"(a|b)*c",
+		L"img_\\d+\\.(jpg|png)", L"report[ _]\\d{4}.*", L"\\S+\\s\\S+", L"[\\w.]+",
+		L"\\[.*\\]", L"a\\+b=c", L"question\\?", L"dollar\\$sign", L"\\^caret", L"^abc$",
+		L"(a*)*b", L"(a|aa)*b", L"\\x41BC", L"\\u0061bc", L"[\\d\\s]+", L"[^\\W_]+",
+		L"a*?b", L".*[.]txt", L"" };
+
+	for (const auto &pattern : patterns)
+	{
+		ExpectSameResultsAsStdRegex(pattern, true);
+		ExpectSameResultsAsStdRegex(pattern, false);
+	}
+}
+
+TEST(RegexMatcherTest, CaseInsensitive)
+{
+	RegexMatcher matcher(L"FILE\\.txt", false);
+	EXPECT_TRUE(matcher.Match(L"file.TXT"));
+	EXPECT_TRUE(matcher.Match(L"File.txt"));
+
+	RegexMatcher invertedMatcher(L"[^a]", false);
+	EXPECT_FALSE(invertedMatcher.Match(L"A"));
+	EXPECT_TRUE(invertedMatcher.Match(L"b"));
+}
+
+TEST(RegexMatcherTest, NoCatastrophicBacktracking)
+{
+	// This pattern takes exponential time with a backtracking engine.
+	RegexMatcher matcher(L"(a|a)*(a|a)*(a|a)*c", true);
+	ASSERT_TRUE(matcher.IsCompiled());
+	EXPECT_FALSE(matcher.Match(std::wstring(10000, 'a')));
+	EXPECT_TRUE(matcher.Match(std::wstring(10000, 'a') + L"c"));
+}
+
+TEST(RegexMatcherTest, LargeDfa)
+{
+	// The DFA for this pattern needs 2^16 states, so it should be matched using the NFA.
+	RegexMatcher matcher(L"(a|b)*a(a|b){15}", true);
+	ASSERT_TRUE(matcher.IsCompiled());
+	EXPECT_TRUE(matcher.Match(L"ba" + std::wstring(15, 'b')));
+	EXPECT_FALSE(matcher.Match(L"bb" + std::wstring(15, 'b')));
+}
+
+TEST(RegexMatcherTest, UnsupportedSyntax)
+{
+	// Backreferences and lookahead assertions aren't supported by the matcher itself, but should
+	// still work.
+	RegexMatcher backreferenceMatcher(L"(a+)b\\1", true);
+	EXPECT_FALSE(backreferenceMatcher.IsCompiled());
+	EXPECT_TRUE(backreferenceMatcher.Match(L"aabaa"));
+	EXPECT_FALSE(backreferenceMatcher.Match(L"aaba"));
+
+	RegexMatcher lookaheadMatcher(L"(?=.*\\.txt).*", true);
+	EXPECT_FALSE(lookaheadMatcher.IsCompiled());
+	EXPECT_TRUE(lookaheadMatcher.Match(L"file.txt"));
+	EXPECT_FALSE(lookaheadMatcher.Match(L"file.doc"));
+}
+
+TEST(RegexMatcherTest, InvalidPattern)
+{
+	EXPECT_THROW(RegexMatcher(L"(abc", true), std::regex_error);
+	EXPECT_THROW(RegexMatcher(L"a{3,2}", true), std::regex_error);
+	EXPECT_THROW(RegexMatcher(L"*a", true), std::regex_error);
+}
+
+TEST(RegexMatcherTest, RequiredLiterals)
+{
+	EXPECT_EQ(RegexMatcher(L"report.*\\.pdf", true).GetRequiredLiterals(),
+		std::vector<std::wstring>({ L"report", L".pdf" }));
+	EXPECT_EQ(RegexMatcher(L"IMG_\\d+\\.JPG", false).GetRequiredLiterals(),
+		std::vector<std::wstring>({ L"img_", L".jpg" }));
+	EXPECT_EQ(RegexMatcher(L"(abc)+x?def", true).GetRequiredLiterals(),
+		std::vector<std::wstring>({ L"abc", L"def" }));
+
+	// Alternatives don't have anything in common that's required.
+	EXPECT_EQ(RegexMatcher(L"abc|def", true).GetRequiredLiterals(), std::vector<std::wstring>());
+
+	// Patterns handled by std::wregex don't have any literals extracted.
+	EXPECT_EQ(RegexMatcher(L"(abc)\\1", true).GetRequiredLiterals(), std::vector<std::wstring>());
+}
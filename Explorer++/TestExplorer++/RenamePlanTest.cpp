@@ -0,0 +1,173 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/RenamePlan.h"
+#include <gtest/gtest.h>
+#include <map>
+#include <set>
+
+using namespace testing;
+
+namespace
+{
+	// Performs each of the steps in the plan against a simulated set of files, which maps each
+	// current path to the original path of the file. Each step must rename an existing file to a
+	// path that's not in use.
+	void PerformPlan(const RenamePlan &plan, std::map<std::wstring, std::wstring> &files)
+	{
+		auto performSteps = [&files](const std::vector<RenamePlan::Step> &steps) {
+			for (const auto &step : steps)
+			{
+				auto itr = files.find(step.oldPath);
+				ASSERT_NE(itr, files.end());
+				ASSERT_EQ(files.count(step.newPath), 0U);
+
+				std::wstring originalPath = itr->second;
+				files.erase(itr);
+				files[step.newPath] = originalPath;
+			}
+		};
+
+		performSteps(plan.GetSteps());
+		performSteps(plan.GetFinalSteps());
+	}
+
+	std::map<std::wstring, std::wstring> BuildFiles(const std::set<std::wstring> &paths)
+	{
+		std::map<std::wstring, std::wstring> files;
+
+		for (const auto &path : paths)
+		{
+			files[path] = path;
+		}
+
+		return files;
+	}
+
+	RenamePlan::PathExistsFunction PathExistsIn(const std::map<std::wstring, std::wstring> &files)
+	{
+		return [&files](const std::wstring &path) { return files.count(path) > 0; };
+	}
+}
+
+TEST(RenamePlanTest, IndependentRenames)
+{
+	auto files = BuildFiles({ L"c:\\a", L"c:\\b" });
+	RenamePlan plan({ { L"c:\\a", L"c:\\x" }, { L"c:\\b", L"c:\\y" } }, PathExistsIn(files));
+
+	ASSERT_EQ(plan.GetSteps().size(), 2U);
+	EXPECT_EQ(plan.GetSteps()[0].renameIndex, 0U);
+	EXPECT_EQ(plan.GetSteps()[1].renameIndex, 1U);
+	EXPECT_TRUE(plan.GetFinalSteps().empty());
+	EXPECT_TRUE(plan.GetRejectedRenames().empty());
+
+	PerformPlan(plan, files);
+	EXPECT_EQ(files, (std::map<std::wstring, std::wstring>{ { L"c:\\x", L"c:\\a" },
+						 { L"c:\\y", L"c:\\b" } }));
+}
+
+TEST(RenamePlanTest, Chain)
+{
+	// b has to be moved out of the way before a can take its name.
+	auto files = BuildFiles({ L"c:\\a", L"c:\\b" });
+	RenamePlan plan({ { L"c:\\a", L"c:\\b" }, { L"c:\\b", L"c:\\c" } }, PathExistsIn(files));
+
+	ASSERT_EQ(plan.GetSteps().size(), 2U);
+	EXPECT_EQ(plan.GetSteps()[0].renameIndex, 1U);
+	EXPECT_EQ(plan.GetSteps()[1].renameIndex, 0U);
+	EXPECT_TRUE(plan.GetFinalSteps().empty());
+
+	PerformPlan(plan, files);
+	EXPECT_EQ(files, (std::map<std::wstring, std::wstring>{ { L"c:\\b", L"c:\\a" },
+						 { L"c:\\c", L"c:\\b" } }));
+}
+
+TEST(RenamePlanTest, Swap)
+{
+	auto files = BuildFiles({ L"c:\\a", L"c:\\b" });
+	RenamePlan plan({ { L"c:\\a", L"c:\\b" }, { L"c:\\b", L"c:\\a" } }, PathExistsIn(files));
+
+	EXPECT_EQ(plan.GetSteps().size(), 2U);
+	ASSERT_EQ(plan.GetFinalSteps().size(), 1U);
+	EXPECT_EQ(plan.GetFinalSteps()[0].newPath, L"c:\\b");
+	EXPECT_TRUE(plan.GetRejectedRenames().empty());
+
+	PerformPlan(plan, files);
+	EXPECT_EQ(files, (std::map<std::wstring, std::wstring>{ { L"c:\\a", L"c:\\b" },
+						 { L"c:\\b", L"c:\\a" } }));
+}
+
+TEST(RenamePlanTest, Cycles)
+{
+	// Two separate cycles, along with a chain, all in the same set of renames.
+	auto files =
+		BuildFiles({ L"c:\\1", L"c:\\2", L"c:\\3", L"c:\\a", L"c:\\b", L"c:\\x", L"c:\\y" });
+	RenamePlan plan({ { L"c:\\1", L"c:\\2" }, { L"c:\\x", L"c:\\y" }, { L"c:\\2", L"c:\\3" },
+						{ L"c:\\a", L"c:\\b" }, { L"c:\\3", L"c:\\1" }, { L"c:\\y", L"c:\\z" },
+						{ L"c:\\b", L"c:\\a" } },
+		PathExistsIn(files));
+
+	EXPECT_EQ(plan.GetFinalSteps().size(), 2U);
+	EXPECT_TRUE(plan.GetRejectedRenames().empty());
+
+	PerformPlan(plan, files);
+	EXPECT_EQ(files,
+		(std::map<std::wstring, std::wstring>{ { L"c:\\1", L"c:\\3" }, { L"c:\\2", L"c:\\1" },
+			{ L"c:\\3", L"c:\\2" }, { L"c:\\a", L"c:\\b" }, { L"c:\\b", L"c:\\a" },
+			{ L"c:\\y", L"c:\\x" }, { L"c:\\z", L"c:\\y" } }));
+}
+
+TEST(RenamePlanTest, Collisions)
+{
+	auto files = BuildFiles({ L"c:\\a", L"c:\\b", L"c:\\c", L"c:\\d", L"c:\\e", L"c:\\existing" });
+
+	// 0 and 1 collide with each other, 2 collides with an existing file and 3 depends on 2. 4 is
+	// unaffected.
+	RenamePlan plan({ { L"c:\\a", L"c:\\x" }, { L"c:\\b", L"c:\\X" }, { L"c:\\c", L"c:\\existing" },
+						{ L"c:\\d", L"c:\\c" }, { L"c:\\e", L"c:\\f" } },
+		PathExistsIn(files));
+
+	EXPECT_EQ(plan.GetRejectedRenames(), (std::vector<size_t>{ 0, 1, 2, 3 }));
+	ASSERT_EQ(plan.GetSteps().size(), 1U);
+	EXPECT_EQ(plan.GetSteps()[0].renameIndex, 4U);
+	EXPECT_TRUE(plan.GetFinalSteps().empty());
+}
+
+TEST(RenamePlanTest, RejectedCycle)
+{
+	// Since a is listed twice, neither of its renames is performed. That means that b can't be
+	// renamed either, since a will still be using its name.
+	auto files = BuildFiles({ L"c:\\a", L"c:\\b" });
+	RenamePlan plan({ { L"c:\\a", L"c:\\b" }, { L"c:\\b", L"c:\\a" }, { L"c:\\A", L"c:\\c" } },
+		PathExistsIn(files));
+
+	EXPECT_EQ(plan.GetRejectedRenames(), (std::vector<size_t>{ 0, 1, 2 }));
+	EXPECT_TRUE(plan.GetSteps().empty());
+	EXPECT_TRUE(plan.GetFinalSteps().empty());
+}
+
+TEST(RenamePlanTest, UnchangedNames)
+{
+	// Renaming a to itself isn't a collision, but nothing else can take its name. A change that
+	// only affects the case of the name is performed as normal.
+	RenamePlan plan({ { L"c:\\a", L"c:\\a" }, { L"c:\\b", L"c:\\B" }, { L"c:\\c", L"c:\\a" } },
+		[](const std::wstring &path) { return path == L"c:\\a" || path == L"c:\\B"; });
+
+	EXPECT_EQ(plan.GetRejectedRenames(), (std::vector<size_t>{ 2 }));
+	ASSERT_EQ(plan.GetSteps().size(), 1U);
+	EXPECT_EQ(plan.GetSteps()[0].renameIndex, 1U);
+	EXPECT_EQ(plan.GetSteps()[0].newPath, L"c:\\B");
+}
+
+TEST(RenamePlanTest, TemporaryNameInUse)
+{
+	auto files = BuildFiles({ L"c:\\a", L"c:\\b", L"c:\\a~0.tmp" });
+	RenamePlan plan({ { L"c:\\a", L"c:\\b" }, { L"c:\\b", L"c:\\a" } }, PathExistsIn(files));
+
+	ASSERT_EQ(plan.GetFinalSteps().size(), 1U);
+	EXPECT_NE(plan.GetFinalSteps()[0].oldPath, L"c:\\a~0.tmp");
+
+	PerformPlan(plan, files);
+	EXPECT_EQ(files.at(L"c:\\a~0.tmp"), L"c:\\a~0.tmp");
+}
@@ -0,0 +1,230 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/SearchFilter.h"
+#include "../Helper/SearchPredicate.h"
+#include "../Helper/TimeHelper.h"
+#include "../Helper/WildcardMatcher.h"
+#include <gtest/gtest.h>
+
+namespace
+{
+	const ULONGLONG TICKS_PER_DAY = 24 * 60 * 60 * 10'000'000ULL;
+
+	// An arbitrary point in time that relative modification times are measured from.
+	const ULONGLONG CURRENT_TIME = 1000 * TICKS_PER_DAY;
+
+	SearchEntry MakeFile(std::wstring_view name, ULONGLONG size, ULONGLONG lastWriteTime,
+		DWORD attributes = FILE_ATTRIBUTE_ARCHIVE)
+	{
+		return { name, attributes, size, lastWriteTime };
+	}
+
+	SearchEntry MakeFolder(std::wstring_view name)
+	{
+		return { name, FILE_ATTRIBUTE_DIRECTORY, 0, CURRENT_TIME };
+	}
+
+	ULONGLONG GetLocalTime(WORD year, WORD month, WORD day, WORD hour = 0)
+	{
+		SYSTEMTIME localTime = {};
+		localTime.wYear = year;
+		localTime.wMonth = month;
+		localTime.wDay = day;
+		localTime.wHour = hour;
+
+		FILETIME fileTime;
+		EXPECT_TRUE(LocalSystemTimeToFileTime(&localTime, &fileTime));
+		return SearchEntry::FileTimeToTicks(fileTime);
+	}
+
+	AllOfPredicate ParseFilterPredicate(std::wstring_view text)
+	{
+		std::wstring invalidTerm;
+		auto filter = ParseSearchFilter(text, CURRENT_TIME, invalidTerm);
+		EXPECT_TRUE(filter.has_value()) << "Invalid term: " << invalidTerm;
+
+		AllOfPredicate predicate;
+
+		if (filter)
+		{
+			for (auto &filterPredicate : filter->predicates)
+			{
+				predicate.Add(std::move(filterPredicate));
+			}
+		}
+
+		return predicate;
+	}
+}
+
+TEST(SearchPredicateTest, Size)
+{
+	SizePredicate predicate(100, 200);
+	EXPECT_TRUE(predicate.Matches(MakeFile(L"a.txt", 100, 0)));
+	EXPECT_TRUE(predicate.Matches(MakeFile(L"a.txt", 200, 0)));
+	EXPECT_FALSE(predicate.Matches(MakeFile(L"a.txt", 99, 0)));
+	EXPECT_FALSE(predicate.Matches(MakeFile(L"a.txt", 201, 0)));
+
+	SizePredicate emptyPredicate(std::nullopt, 0);
+	EXPECT_TRUE(emptyPredicate.Matches(MakeFile(L"a.txt", 0, 0)));
+
+	// Folders don't have a size, so they never match.
+	EXPECT_FALSE(emptyPredicate.Matches(MakeFolder(L"folder")));
+}
+
+TEST(SearchPredicateTest, Date)
+{
+	DatePredicate predicate(10, std::nullopt);
+	EXPECT_TRUE(predicate.Matches(MakeFile(L"a.txt", 0, 10)));
+	EXPECT_FALSE(predicate.Matches(MakeFile(L"a.txt", 0, 9)));
+}
+
+TEST(SearchPredicateTest, Attributes)
+{
+	AttributePredicate predicate(FILE_ATTRIBUTE_HIDDEN, FILE_ATTRIBUTE_READONLY);
+	EXPECT_TRUE(predicate.Matches(MakeFile(L"a.txt", 0, 0, FILE_ATTRIBUTE_HIDDEN)));
+	EXPECT_FALSE(predicate.Matches(MakeFile(L"a.txt", 0, 0, FILE_ATTRIBUTE_ARCHIVE)));
+	EXPECT_FALSE(predicate.Matches(
+		MakeFile(L"a.txt", 0, 0, FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_READONLY)));
+}
+
+TEST(SearchPredicateTest, Combined)
+{
+	AllOfPredicate predicate;
+	EXPECT_TRUE(predicate.IsEmpty());
+	EXPECT_TRUE(predicate.Matches(MakeFile(L"anything", 0, 0)));
+
+	predicate.Add(std::make_unique<NamePredicate>(
+		std::make_unique<WildcardMatcher>(L"*.txt", false), false));
+	predicate.Add(
+		std::make_unique<NotPredicate>(std::make_unique<SizePredicate>(std::nullopt, 0)));
+	EXPECT_FALSE(predicate.IsEmpty());
+
+	EXPECT_TRUE(predicate.Matches(MakeFile(L"notes.TXT", 1, 0)));
+	EXPECT_FALSE(predicate.Matches(MakeFile(L"notes.txt", 0, 0)));
+	EXPECT_FALSE(predicate.Matches(MakeFile(L"notes.doc", 1, 0)));
+}
+
+TEST(SearchPredicateTest, DirectoryPruner)
+{
+	DirectoryPruner pruner({ L"node_modules", L".*" }, 2);
+	EXPECT_FALSE(pruner.IsEmpty());
+
+	EXPECT_TRUE(pruner.IsExcluded(L"Node_Modules"));
+	EXPECT_TRUE(pruner.IsExcluded(L".git"));
+	EXPECT_FALSE(pruner.IsExcluded(L"src"));
+
+	EXPECT_TRUE(pruner.ShouldDescend(L"src", 2));
+	EXPECT_FALSE(pruner.ShouldDescend(L"src", 3));
+	EXPECT_FALSE(pruner.ShouldDescend(L"node_modules", 1));
+
+	EXPECT_TRUE(DirectoryPruner({}, std::nullopt).IsEmpty());
+}
+
+TEST(SearchFilterTest, Size)
+{
+	auto predicate = ParseFilterPredicate(L"size:>1KB size:<=2kb");
+	EXPECT_FALSE(predicate.Matches(MakeFile(L"a.txt", 1024, 0)));
+	EXPECT_TRUE(predicate.Matches(MakeFile(L"a.txt", 1025, 0)));
+	EXPECT_TRUE(predicate.Matches(MakeFile(L"a.txt", 2048, 0)));
+	EXPECT_FALSE(predicate.Matches(MakeFile(L"a.txt", 2049, 0)));
+
+	auto fractionalPredicate = ParseFilterPredicate(L"size:>=1.5MB");
+	EXPECT_TRUE(fractionalPredicate.Matches(MakeFile(L"a.txt", 1536 * 1024, 0)));
+	EXPECT_FALSE(fractionalPredicate.Matches(MakeFile(L"a.txt", 1536 * 1024 - 1, 0)));
+
+	auto exactPredicate = ParseFilterPredicate(L"size:0");
+	EXPECT_TRUE(exactPredicate.Matches(MakeFile(L"a.txt", 0, 0)));
+	EXPECT_FALSE(exactPredicate.Matches(MakeFile(L"a.txt", 1, 0)));
+}
+
+TEST(SearchFilterTest, RelativeModified)
+{
+	auto recentPredicate = ParseFilterPredicate(L"modified:<7d");
+	EXPECT_TRUE(recentPredicate.Matches(MakeFile(L"a.txt", 0, CURRENT_TIME - TICKS_PER_DAY)));
+	EXPECT_FALSE(recentPredicate.Matches(MakeFile(L"a.txt", 0, CURRENT_TIME - 8 * TICKS_PER_DAY)));
+
+	auto oldPredicate = ParseFilterPredicate(L"modified:>1w");
+	EXPECT_FALSE(oldPredicate.Matches(MakeFile(L"a.txt", 0, CURRENT_TIME - TICKS_PER_DAY)));
+	EXPECT_TRUE(oldPredicate.Matches(MakeFile(L"a.txt", 0, CURRENT_TIME - 8 * TICKS_PER_DAY)));
+}
+
+TEST(SearchFilterTest, AbsoluteModified)
+{
+	ULONGLONG dayStart = GetLocalTime(2024, 1, 31);
+	ULONGLONG nextDayStart = GetLocalTime(2024, 2, 1);
+
+	auto predicate = ParseFilterPredicate(L"modified:2024-01-31");
+	EXPECT_TRUE(predicate.Matches(MakeFile(L"a.txt", 0, dayStart)));
+	EXPECT_TRUE(predicate.Matches(MakeFile(L"a.txt", 0, GetLocalTime(2024, 1, 31, 23))));
+	EXPECT_FALSE(predicate.Matches(MakeFile(L"a.txt", 0, dayStart - 1)));
+	EXPECT_FALSE(predicate.Matches(MakeFile(L"a.txt", 0, nextDayStart)));
+
+	auto laterPredicate = ParseFilterPredicate(L"modified:>2024-01-31");
+	EXPECT_FALSE(laterPredicate.Matches(MakeFile(L"a.txt", 0, nextDayStart - 1)));
+	EXPECT_TRUE(laterPredicate.Matches(MakeFile(L"a.txt", 0, nextDayStart)));
+}
+
+TEST(SearchFilterTest, AttributesAndNegation)
+{
+	auto predicate = ParseFilterPredicate(L"attrib:+h-r -size:0");
+	EXPECT_TRUE(predicate.Matches(MakeFile(L"a.txt", 1, 0, FILE_ATTRIBUTE_HIDDEN)));
+	EXPECT_FALSE(predicate.Matches(MakeFile(L"a.txt", 0, 0, FILE_ATTRIBUTE_HIDDEN)));
+	EXPECT_FALSE(predicate.Matches(
+		MakeFile(L"a.txt", 1, 0, FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_READONLY)));
+	EXPECT_FALSE(predicate.Matches(MakeFile(L"a.txt", 1, 0, FILE_ATTRIBUTE_ARCHIVE)));
+}
+
+TEST(SearchFilterTest, NegatedSize)
+{
+	auto predicate = ParseFilterPredicate(L"-size:>10MB");
+	EXPECT_TRUE(predicate.Matches(MakeFile(L"a.txt", 1024, 0)));
+	EXPECT_FALSE(predicate.Matches(MakeFile(L"a.txt", 20 * 1024 * 1024, 0)));
+
+	// Folders don't have a size, so they shouldn't match a negated size term either.
+	EXPECT_FALSE(predicate.Matches(MakeFolder(L"folder")));
+
+	auto folderPredicate = ParseFilterPredicate(L"-size:>10MB attrib:+d");
+	EXPECT_TRUE(folderPredicate.Matches(MakeFolder(L"folder")));
+}
+
+TEST(SearchFilterTest, DirectoryTerms)
+{
+	std::wstring invalidTerm;
+	auto filter = ParseSearchFilter(
+		L"  exclude:node_modules exclude:\"Program Files\"  depth:3 ", CURRENT_TIME, invalidTerm);
+	ASSERT_TRUE(filter.has_value());
+
+	EXPECT_TRUE(filter->predicates.empty());
+	EXPECT_EQ(filter->excludedDirectories,
+		(std::vector<std::wstring>{ L"node_modules", L"Program Files" }));
+	EXPECT_EQ(filter->maxDepth, 3);
+}
+
+TEST(SearchFilterTest, Empty)
+{
+	std::wstring invalidTerm;
+	auto filter = ParseSearchFilter(L"", CURRENT_TIME, invalidTerm);
+	ASSERT_TRUE(filter.has_value());
+
+	EXPECT_TRUE(filter->predicates.empty());
+	EXPECT_TRUE(filter->excludedDirectories.empty());
+	EXPECT_FALSE(filter->maxDepth.has_value());
+}
+
+TEST(SearchFilterTest, Invalid)
+{
+	const std::wstring invalidTerms[] = { L"size", L"size:", L"size:big", L"size:10PB",
+		L"size:<0", L"modified:7d", L"modified:<7x", L"modified:2024-13-01", L"attrib:q",
+		L"attrib:+h-h", L"depth:-1", L"-depth:2", L"-exclude:a", L"unknown:1" };
+
+	for (const auto &term : invalidTerms)
+	{
+		std::wstring invalidTerm;
+		auto filter = ParseSearchFilter(L"size:>1 " + term, CURRENT_TIME, invalidTerm);
+		EXPECT_FALSE(filter.has_value()) << term;
+		EXPECT_EQ(invalidTerm, term);
+	}
+}
@@ -0,0 +1,65 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Explorer++/ShellBrowser/SortHelper.h"
+#include <gtest/gtest.h>
+
+TEST(SortHelperTest, SortModeAffectedByChanges)
+{
+	ItemChanges renamed = { true, false, false, false, false };
+	EXPECT_TRUE(IsSortModeAffectedByChanges(SortMode::Name, renamed));
+	EXPECT_TRUE(IsSortModeAffectedByChanges(SortMode::Type, renamed));
+	EXPECT_TRUE(IsSortModeAffectedByChanges(SortMode::Extension, renamed));
+	EXPECT_FALSE(IsSortModeAffectedByChanges(SortMode::Size, renamed));
+	EXPECT_FALSE(IsSortModeAffectedByChanges(SortMode::DateModified, renamed));
+	EXPECT_FALSE(IsSortModeAffectedByChanges(SortMode::Owner, renamed));
+
+	ItemChanges modified = { false, true, true, false, true };
+	EXPECT_FALSE(IsSortModeAffectedByChanges(SortMode::Name, modified));
+	EXPECT_FALSE(IsSortModeAffectedByChanges(SortMode::Type, modified));
+	EXPECT_FALSE(IsSortModeAffectedByChanges(SortMode::Attributes, modified));
+	EXPECT_TRUE(IsSortModeAffectedByChanges(SortMode::Size, modified));
+	EXPECT_TRUE(IsSortModeAffectedByChanges(SortMode::DateModified, modified));
+	EXPECT_TRUE(IsSortModeAffectedByChanges(SortMode::FileVersion, modified));
+
+	ItemChanges attributesChanged = { false, false, false, true, false };
+	EXPECT_TRUE(IsSortModeAffectedByChanges(SortMode::Attributes, attributesChanged));
+	EXPECT_TRUE(IsSortModeAffectedByChanges(SortMode::Type, attributesChanged));
+	EXPECT_FALSE(IsSortModeAffectedByChanges(SortMode::Name, attributesChanged));
+}
+
+TEST(SortHelperTest, SortModeTextBased)
+{
+	EXPECT_TRUE(IsSortModeTextBased(SortMode::Name));
+	EXPECT_TRUE(IsSortModeTextBased(SortMode::Owner));
+	EXPECT_TRUE(IsSortModeTextBased(SortMode::MediaAlbum));
+	EXPECT_FALSE(IsSortModeTextBased(SortMode::Size));
+	EXPECT_FALSE(IsSortModeTextBased(SortMode::DateModified));
+	EXPECT_FALSE(IsSortModeTextBased(SortMode::Title));
+}
+
+TEST(SortHelperTest, SortFoldersBySize)
+{
+	BasicItemInfo_t folder1;
+	folder1.wfd = {};
+	folder1.wfd.dwFileAttributes = FILE_ATTRIBUTE_DIRECTORY;
+	folder1.isFindDataValid = true;
+
+	BasicItemInfo_t folder2 = folder1;
+
+	// Folders whose size is unknown compare equal, but are smaller than any folder whose size has
+	// been calculated.
+	EXPECT_EQ(SortBySize(folder1, folder2), 0);
+
+	folder2.folderSize = 0;
+	EXPECT_LT(SortBySize(folder1, folder2), 0);
+	EXPECT_GT(SortBySize(folder2, folder1), 0);
+
+	folder1.folderSize = 1024;
+	EXPECT_GT(SortBySize(folder1, folder2), 0);
+	EXPECT_LT(SortBySize(folder2, folder1), 0);
+
+	folder2.folderSize = 1024;
+	EXPECT_EQ(SortBySize(folder1, folder2), 0);
+}
@@ -0,0 +1,157 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/StreamCopier.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	std::vector<unsigned char> BuildData(size_t size)
+	{
+		std::vector<unsigned char> data(size);
+
+		for (size_t i = 0; i < data.size(); i++)
+		{
+			data[i] = static_cast<unsigned char>(i * 31 + 7);
+		}
+
+		return data;
+	}
+
+	// Reads from an in-memory buffer. Each read returns at most maxReadSize bytes, so that short
+	// reads can be simulated.
+	StreamCopier::ReadFunction ReadFromVector(
+		const std::vector<unsigned char> &source, size_t &offset, size_t maxReadSize = SIZE_MAX)
+	{
+		return [&source, &offset, maxReadSize](void *buffer, size_t size) -> std::optional<size_t> {
+			size_t bytesToRead = std::min({ size, maxReadSize, source.size() - offset });
+			std::memcpy(buffer, source.data() + offset, bytesToRead);
+			offset += bytesToRead;
+			return bytesToRead;
+		};
+	}
+
+	StreamCopier::WriteFunction WriteToVector(std::vector<unsigned char> &destination)
+	{
+		return [&destination](const void *buffer, size_t size) {
+			auto *data = static_cast<const unsigned char *>(buffer);
+			destination.insert(destination.end(), data, data + size);
+			return true;
+		};
+	}
+}
+
+TEST(StreamCopierTest, Copy)
+{
+	StreamCopier copier(64, 3);
+
+	// Covers an empty stream, a stream smaller than a buffer, streams that are exact multiples of
+	// the buffer size and a stream that needs many more blocks than there are buffers.
+	for (size_t size : { 0, 1, 63, 64, 128, 1000, 10000 })
+	{
+		auto source = BuildData(size);
+		size_t offset = 0;
+		std::vector<unsigned char> destination;
+
+		auto result = copier.Copy(ReadFromVector(source, offset), WriteToVector(destination));
+
+		EXPECT_EQ(result, StreamCopier::Result::Succeeded);
+		EXPECT_EQ(destination, source);
+	}
+}
+
+TEST(StreamCopierTest, ShortReads)
+{
+	StreamCopier copier(64, 2);
+	auto source = BuildData(1000);
+	size_t offset = 0;
+	std::vector<unsigned char> destination;
+
+	auto result = copier.Copy(ReadFromVector(source, offset, 17), WriteToVector(destination));
+
+	EXPECT_EQ(result, StreamCopier::Result::Succeeded);
+	EXPECT_EQ(destination, source);
+}
+
+TEST(StreamCopierTest, Progress)
+{
+	StreamCopier copier(64, 2);
+	auto source = BuildData(1000);
+	size_t offset = 0;
+	std::vector<unsigned char> destination;
+	std::vector<uint64_t> progressValues;
+
+	copier.Copy(ReadFromVector(source, offset), WriteToVector(destination),
+		[&progressValues](uint64_t bytesCopied) { progressValues.push_back(bytesCopied); });
+
+	ASSERT_FALSE(progressValues.empty());
+	EXPECT_TRUE(std::is_sorted(progressValues.begin(), progressValues.end()));
+	EXPECT_EQ(progressValues.back(), source.size());
+}
+
+TEST(StreamCopierTest, ReadFailure)
+{
+	StreamCopier copier(64, 2);
+	int numReads = 0;
+
+	auto result = copier.Copy(
+		[&numReads](void *buffer, size_t size) -> std::optional<size_t> {
+			if (++numReads > 3)
+			{
+				return std::nullopt;
+			}
+
+			std::memset(buffer, 0, size);
+			return size;
+		},
+		[](const void *, size_t) { return true; });
+
+	EXPECT_EQ(result, StreamCopier::Result::ReadFailed);
+}
+
+TEST(StreamCopierTest, WriteFailure)
+{
+	StreamCopier copier(64, 2);
+	auto source = BuildData(1000);
+	size_t offset = 0;
+	int numWrites = 0;
+
+	auto result = copier.Copy(ReadFromVector(source, offset), [&numWrites](const void *, size_t) {
+		return ++numWrites <= 2;
+	});
+
+	EXPECT_EQ(result, StreamCopier::Result::WriteFailed);
+	EXPECT_EQ(numWrites, 3);
+}
+
+TEST(StreamCopierTest, Stop)
+{
+	StreamCopier copier(64, 2);
+	auto source = BuildData(10000);
+	size_t offset = 0;
+	std::vector<unsigned char> destination;
+
+	auto result = copier.Copy(ReadFromVector(source, offset), WriteToVector(destination),
+		[&copier](uint64_t bytesCopied) {
+			if (bytesCopied >= 256)
+			{
+				copier.Stop();
+			}
+		});
+
+	EXPECT_EQ(result, StreamCopier::Result::Stopped);
+	EXPECT_TRUE(copier.IsStopped());
+	EXPECT_LT(destination.size(), source.size());
+
+	// A stopped copier doesn't copy anything further.
+	offset = 0;
+	destination.clear();
+	result = copier.Copy(ReadFromVector(source, offset), WriteToVector(destination));
+
+	EXPECT_EQ(result, StreamCopier::Result::Stopped);
+	EXPECT_TRUE(destination.empty());
+}
@@ -120,4 +120,12 @@ TEST(TrimString, Simple)
 	std::wstring text(L"  Test text  ");
 	TrimString(text, L" ");
 	EXPECT_EQ(text, L"Test text");
+}
+
+TEST(CreateNaturalSortKey, Order)
+{
+	EXPECT_LT(CreateNaturalSortKey(L"file2.txt"), CreateNaturalSortKey(L"file10.txt"));
+	EXPECT_LT(CreateNaturalSortKey(L"apple"), CreateNaturalSortKey(L"Banana"));
+	EXPECT_LT(CreateNaturalSortKey(L"a"), CreateNaturalSortKey(L"ab"));
+	EXPECT_EQ(CreateNaturalSortKey(L"README.md"), CreateNaturalSortKey(L"readme.md"));
 }
\ No newline at end of file
@@ -0,0 +1,65 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "TemporaryDirectoryHelper.h"
+#include <gtest/gtest.h>
+#include <windows.h>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <string>
+
+TemporaryDirectory::TemporaryDirectory()
+{
+	static std::atomic<int> nextId = 0;
+
+	std::string testName = "TestExplorer++";
+	const auto *testInfo = testing::UnitTest::GetInstance()->current_test_info();
+
+	if (testInfo)
+	{
+		testName = std::string(testInfo->test_suite_name()) + "." + testInfo->name();
+
+		// Parameterized tests have slashes in their names, which can't appear in a directory
+		// name.
+		std::replace(testName.begin(), testName.end(), '/', '_');
+	}
+
+	m_path = std::filesystem::temp_directory_path()
+		/ (std::filesystem::path(testName).wstring() + L"-" + std::to_wstring(GetCurrentProcessId())
+			+ L"-" + std::to_wstring(nextId++));
+
+	// The process ID may have been used by an earlier run that didn't get to clean up.
+	std::filesystem::remove_all(m_path);
+	std::filesystem::create_directories(m_path);
+}
+
+TemporaryDirectory::~TemporaryDirectory()
+{
+	std::error_code error;
+	std::filesystem::remove_all(m_path, error);
+}
+
+const std::filesystem::path &TemporaryDirectory::GetPath() const
+{
+	return m_path;
+}
+
+std::filesystem::path TemporaryDirectory::CreateTestFile(
+	const std::filesystem::path &path, std::string_view contents) const
+{
+	auto fullPath = m_path / path;
+	std::filesystem::create_directories(fullPath.parent_path());
+
+	std::ofstream stream(fullPath, std::ios::binary);
+	stream.write(contents.data(), contents.size());
+
+	return fullPath;
+}
+
+std::filesystem::path TemporaryDirectory::CreateTestFile(
+	const std::filesystem::path &path, size_t size) const
+{
+	return CreateTestFile(path, std::string(size, 'x'));
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <filesystem>
+#include <string_view>
+
+// An empty directory that's unique to the current test (and process), so that tests can create
+// files without interfering with each other. The directory, along with everything in it, is
+// removed when the object is destroyed.
+class TemporaryDirectory
+{
+public:
+	TemporaryDirectory();
+	~TemporaryDirectory();
+
+	TemporaryDirectory(const TemporaryDirectory &) = delete;
+	TemporaryDirectory &operator=(const TemporaryDirectory &) = delete;
+
+	const std::filesystem::path &GetPath() const;
+
+	// Creates a file (along with any parent directories that don't exist) and returns the full
+	// path to the file. A relative path is interpreted relative to the temporary directory.
+	std::filesystem::path CreateTestFile(
+		const std::filesystem::path &path, std::string_view contents) const;
+
+	// Creates a file of the specified size, filled with a single repeated character.
+	std::filesystem::path CreateTestFile(const std::filesystem::path &path, size_t size) const;
+
+private:
+	std::filesystem::path m_path;
+};
\ No newline at end of file
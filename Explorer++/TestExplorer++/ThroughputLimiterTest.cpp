@@ -0,0 +1,41 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/ThroughputLimiter.h"
+#include <gtest/gtest.h>
+
+using namespace testing;
+
+TEST(ThroughputLimiterTest, Unlimited)
+{
+	ThroughputLimiter limiter(0);
+
+	for (int i = 0; i < 10; i++)
+	{
+		EXPECT_TRUE(limiter.Acquire(1024 * 1024 * 1024, nullptr));
+	}
+}
+
+TEST(ThroughputLimiterTest, Limited)
+{
+	ThroughputLimiter limiter(1000);
+
+	auto startTime = std::chrono::steady_clock::now();
+
+	// The first block can be read immediately, but each block after that has to wait for the
+	// previous block to be paid for.
+	EXPECT_TRUE(limiter.Acquire(100, nullptr));
+	EXPECT_TRUE(limiter.Acquire(100, nullptr));
+	EXPECT_TRUE(limiter.Acquire(100, nullptr));
+
+	EXPECT_GE(std::chrono::steady_clock::now() - startTime, std::chrono::milliseconds(190));
+}
+
+TEST(ThroughputLimiterTest, Stop)
+{
+	ThroughputLimiter limiter(1);
+
+	EXPECT_TRUE(limiter.Acquire(1000000, nullptr));
+	EXPECT_FALSE(limiter.Acquire(1, [] { return true; }));
+}
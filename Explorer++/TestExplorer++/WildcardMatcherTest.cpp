@@ -0,0 +1,159 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/WildcardMatcher.h"
+#include <gtest/gtest.h>
+
+TEST(WildcardMatcherTest, LiteralPattern)
+{
+	WildcardMatcher matcher(L"file.txt", true);
+	EXPECT_TRUE(matcher.Match(L"file.txt"));
+	EXPECT_FALSE(matcher.Match(L"file.txt2"));
+	EXPECT_FALSE(matcher.Match(L"1file.txt"));
+	EXPECT_FALSE(matcher.Match(L"File.txt"));
+}
+
+TEST(WildcardMatcherTest, SingleCharacterWildcard)
+{
+	WildcardMatcher matcher(L"?.tx?", true);
+	EXPECT_TRUE(matcher.Match(L"1.txt"));
+	EXPECT_TRUE(matcher.Match(L"a.txa"));
+	EXPECT_FALSE(matcher.Match(L".txt"));
+	EXPECT_FALSE(matcher.Match(L"1.tx"));
+	EXPECT_FALSE(matcher.Match(L"12.txt"));
+}
+
+TEST(WildcardMatcherTest, SuffixPattern)
+{
+	WildcardMatcher matcher(L"*.txt", true);
+	EXPECT_TRUE(matcher.Match(L"Test.txt"));
+	EXPECT_TRUE(matcher.Match(L".txt"));
+	EXPECT_TRUE(matcher.Match(L"archive.tar.txt"));
+	EXPECT_FALSE(matcher.Match(L"txt"));
+	EXPECT_FALSE(matcher.Match(L"Test.txt.bak"));
+}
+
+TEST(WildcardMatcherTest, GeneralPattern)
+{
+	WildcardMatcher matcher1(L"?ab*cd.tx?", true);
+	EXPECT_TRUE(matcher1.Match(L"1abefghcd.txt"));
+	EXPECT_TRUE(matcher1.Match(L"1abcd.txt"));
+	EXPECT_FALSE(matcher1.Match(L"1abc.txt"));
+
+	WildcardMatcher matcher2(L"Test?1*txt", true);
+	EXPECT_TRUE(matcher2.Match(L"Test11test.txt"));
+
+	WildcardMatcher matcher3(L"a*b*c", true);
+	EXPECT_TRUE(matcher3.Match(L"abc"));
+	EXPECT_TRUE(matcher3.Match(L"aXbYbZc"));
+	EXPECT_FALSE(matcher3.Match(L"acb"));
+
+	// The prefix and suffix can't overlap.
+	WildcardMatcher matcher4(L"ab*ba", true);
+	EXPECT_FALSE(matcher4.Match(L"aba"));
+	EXPECT_TRUE(matcher4.Match(L"abba"));
+
+	WildcardMatcher matcher5(L"**", true);
+	EXPECT_TRUE(matcher5.Match(L""));
+	EXPECT_TRUE(matcher5.Match(L"anything"));
+}
+
+TEST(WildcardMatcherTest, EmptyPattern)
+{
+	WildcardMatcher matcher(L"", true);
+	EXPECT_TRUE(matcher.Match(L""));
+	EXPECT_FALSE(matcher.Match(L"file"));
+}
+
+TEST(WildcardMatcherTest, MultiplePatterns)
+{
+	WildcardMatcher matcher(L"*.h: *.cpp :readme", true);
+	EXPECT_TRUE(matcher.Match(L"Helper.h"));
+	EXPECT_TRUE(matcher.Match(L"Helper.cpp"));
+	EXPECT_TRUE(matcher.Match(L"readme"));
+	EXPECT_FALSE(matcher.Match(L"Helper.hpp"));
+	EXPECT_FALSE(matcher.Match(L" readme"));
+}
+
+TEST(WildcardMatcherTest, CaseInsensitive)
+{
+	WildcardMatcher matcher(L"*.TXT: Read?e", false);
+	EXPECT_TRUE(matcher.Match(L"file.txt"));
+	EXPECT_TRUE(matcher.Match(L"FILE.Txt"));
+	EXPECT_TRUE(matcher.Match(L"README"));
+	EXPECT_FALSE(matcher.Match(L"file.txt2"));
+
+	WildcardMatcher caseSensitiveMatcher(L"*.TXT", true);
+	EXPECT_FALSE(caseSensitiveMatcher.Match(L"file.txt"));
+}
+
+TEST(WildcardMatcherTest, PathologicalPattern)
+{
+	// With a backtracking implementation, this pattern takes exponential time to reject.
+	WildcardMatcher matcher(L"*a*a*a*a*a*a*a*a*a*a*a*a*a*a*a*a*b", true);
+	std::wstring str(10000, 'a');
+	EXPECT_FALSE(matcher.Match(str));
+
+	str.push_back('b');
+	EXPECT_TRUE(matcher.Match(str));
+}
+
+TEST(WildcardMatcherTest, ExtensionList)
+{
+	WildcardMatcher matcher(L"*.h: *.cpp: *.hpp: *.c: *.: *.tar.gz: *.t?t: data*", false);
+	EXPECT_TRUE(matcher.Match(L"Helper.h"));
+	EXPECT_TRUE(matcher.Match(L"Helper.CPP"));
+	EXPECT_TRUE(matcher.Match(L"archive.1.hpp"));
+	EXPECT_TRUE(matcher.Match(L".c"));
+	EXPECT_TRUE(matcher.Match(L"file."));
+	EXPECT_TRUE(matcher.Match(L"archive.tar.gz"));
+	EXPECT_TRUE(matcher.Match(L"notes.txt"));
+	EXPECT_TRUE(matcher.Match(L"database"));
+	EXPECT_FALSE(matcher.Match(L"h"));
+	EXPECT_FALSE(matcher.Match(L"Helper.hh"));
+	EXPECT_FALSE(matcher.Match(L"Helper.h.bak"));
+	EXPECT_FALSE(matcher.Match(L"archive.gz"));
+	EXPECT_FALSE(matcher.Match(L"file"));
+}
+
+TEST(WildcardMatcherTest, Subset)
+{
+	WildcardMatcher matcher(L"*abc*", false);
+
+	EXPECT_TRUE(WildcardMatcher(L"*abcd*", false).IsSubsetOf(matcher));
+	EXPECT_TRUE(WildcardMatcher(L"*xabc*", false).IsSubsetOf(matcher));
+	EXPECT_TRUE(WildcardMatcher(L"abc", false).IsSubsetOf(matcher));
+	EXPECT_TRUE(WildcardMatcher(L"*ABC*", false).IsSubsetOf(matcher));
+	EXPECT_FALSE(WildcardMatcher(L"*ab*", false).IsSubsetOf(matcher));
+	EXPECT_FALSE(WildcardMatcher(L"*a?c*", false).IsSubsetOf(matcher));
+	EXPECT_FALSE(WildcardMatcher(L"*abcd*", true).IsSubsetOf(matcher));
+
+	// A '?' in the general pattern covers any single character, but not a '*'.
+	WildcardMatcher singleCharacterMatcher(L"file?.txt", false);
+	EXPECT_TRUE(WildcardMatcher(L"file1.txt", false).IsSubsetOf(singleCharacterMatcher));
+	EXPECT_TRUE(WildcardMatcher(L"file?.txt", false).IsSubsetOf(singleCharacterMatcher));
+	EXPECT_FALSE(WildcardMatcher(L"file*.txt", false).IsSubsetOf(singleCharacterMatcher));
+
+	// Each of the sub-patterns has to be covered by at least one of the other sub-patterns.
+	WildcardMatcher listMatcher(L"*.h: *.cpp", false);
+	EXPECT_TRUE(WildcardMatcher(L"*.cpp", false).IsSubsetOf(listMatcher));
+	EXPECT_TRUE(WildcardMatcher(L"a*.h: b*.cpp", false).IsSubsetOf(listMatcher));
+	EXPECT_FALSE(WildcardMatcher(L"*.cpp: *.c", false).IsSubsetOf(listMatcher));
+	EXPECT_TRUE(listMatcher.IsSubsetOf(WildcardMatcher(L"*", false)));
+}
+
+TEST(WildcardMatcherTest, RequiredLiterals)
+{
+	using Literals = std::vector<std::wstring>;
+
+	EXPECT_EQ(WildcardMatcher(L"*abc*", true).GetRequiredLiterals(), Literals({ L"abc" }));
+	EXPECT_EQ(WildcardMatcher(L"*.TXT", false).GetRequiredLiterals(), Literals({ L".txt" }));
+	EXPECT_EQ(WildcardMatcher(L"ab?cd*e", true).GetRequiredLiterals(),
+		Literals({ L"ab", L"cd", L"e" }));
+	EXPECT_EQ(WildcardMatcher(L"*", true).GetRequiredLiterals(), Literals());
+	EXPECT_EQ(WildcardMatcher(L"???", true).GetRequiredLiterals(), Literals());
+
+	// Either of the sub-patterns can match, so neither literal is required.
+	EXPECT_EQ(WildcardMatcher(L"*.h: *.cpp", true).GetRequiredLiterals(), Literals());
+}
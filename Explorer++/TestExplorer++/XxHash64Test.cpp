@@ -0,0 +1,54 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/XxHash64.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <string_view>
+#include <vector>
+
+TEST(XxHash64Test, KnownValues)
+{
+	// These values come from the reference implementation. The last string is long enough to
+	// exercise the full stripe processing.
+	EXPECT_EQ(XxHash64::Hash("", 0), 0xEF46DB3751D8E999ULL);
+
+	std::string_view abc = "abc";
+	EXPECT_EQ(XxHash64::Hash(abc.data(), abc.size()), 0x44BC2CF5AD770999ULL);
+
+	std::string_view sentence = "Nobody inspects the spammish repetition";
+	EXPECT_EQ(XxHash64::Hash(sentence.data(), sentence.size()), 0xFBCEA83C8A378BF1ULL);
+}
+
+TEST(XxHash64Test, Streaming)
+{
+	std::vector<unsigned char> data(1000);
+
+	for (size_t i = 0; i < data.size(); i++)
+	{
+		data[i] = static_cast<unsigned char>(i * 31 + 7);
+	}
+
+	uint64_t expectedHash = XxHash64::Hash(data.data(), data.size());
+
+	// Splitting the data at different points means that the stripes will be split in different
+	// places.
+	for (size_t chunkSize : { 1, 3, 31, 32, 33, 100, 999 })
+	{
+		XxHash64 hash;
+
+		for (size_t offset = 0; offset < data.size(); offset += chunkSize)
+		{
+			hash.Update(data.data() + offset, std::min(chunkSize, data.size() - offset));
+		}
+
+		EXPECT_EQ(hash.GetHash(), expectedHash) << chunkSize;
+	}
+}
+
+TEST(XxHash64Test, Seed)
+{
+	std::string_view abc = "abc";
+	EXPECT_NE(XxHash64::Hash(abc.data(), abc.size(), 1), XxHash64::Hash(abc.data(), abc.size()));
+}